@@ -18,6 +18,7 @@ limitations under the License.
 #define ZITI_SDK_BUFFER_H
 
 #include <stdint.h>
+#include <uv.h>
 #include <ziti/ziti_buffer.h>
 
 #if !defined(__DEFINED_ssize_t) && !defined(__ssize_t_defined)
@@ -35,6 +36,7 @@ extern "C" {
 #endif
 
 typedef struct buffer_s buffer;
+typedef struct chunk_s buffer_chunk;
 
 buffer *new_buffer();
 void free_buffer(buffer *);
@@ -43,12 +45,77 @@ void buffer_cleanup(buffer *);
 ssize_t buffer_get_next(buffer *, size_t want, uint8_t **ptr);
 void buffer_push_back(buffer *, size_t);
 void buffer_append(buffer *, uint8_t *buf, size_t len);
+
+/**
+ * Append [len] bytes at [data] that belong to [owner] without copying.
+ * [release] is called with [owner] once the data is consumed.
+ */
+void buffer_append_owned(buffer *, uint8_t *data, size_t len, void *owner, void (*release)(void *));
+
+/**
+ * Number of queued chunks appended with buffer_append_owned(), i.e. owners not released yet.
+ */
+size_t buffer_owned_chunks(buffer *);
 size_t buffer_available(buffer *);
 
+/**
+ * Get contiguous data at the head of the buffer without consuming it.
+ * @return number of bytes available at [ptr], 0 if buffer is empty
+ */
+size_t buffer_peek(buffer *, uint8_t **ptr);
+
+#define BUFFER_IOV_MAX 8
+
+/**
+ * Get up to [max_iov] readable regions, in order, without consuming them.
+ * @return number of regions filled in [iov]
+ */
+int buffer_peek_iov(buffer *, uv_buf_t *iov, int max_iov);
+
+/**
+ * Consume [len] bytes from the head of the buffer, fully consumed chunks are released.
+ * @return number of bytes consumed
+ */
+size_t buffer_consume(buffer *, size_t len);
+
+/** Copy up to [len] bytes into [dst] and consume them. */
+size_t buffer_copy_out(buffer *, uint8_t *dst, size_t len);
+
+/**
+ * Take a reference on the chunk at the head of the buffer.
+ * Chunk memory stays valid after it is consumed until the reference is released.
+ */
+buffer_chunk *buffer_retain_head(buffer *);
+void buffer_chunk_release(buffer_chunk *);
+
+#define DEFAULT_SLAB_BUF_SIZE (64 * 1024)
+
+/**
+ * Slab of fixed size read buffers, recycled when buffer chunk referencing them is released.
+ * When the slab is exhausted buffers are allocated on demand and freed after use.
+ */
+typedef struct buffer_slab_s buffer_slab;
+
+buffer_slab *buffer_slab_new(size_t buf_size, size_t count);
+
+/** Free the slab. Buffers that are still in use are freed when released. */
+void buffer_slab_free(buffer_slab *);
+
+/** Get buffer from the slab, [slab] can be NULL, in which case buffer is allocated on demand. */
+uint8_t *buffer_slab_alloc(buffer_slab *, size_t *len);
+
+void buffer_slab_release(uint8_t *buf);
+
+void buffer_slab_stats(buffer_slab *, uint64_t *hits, uint64_t *misses);
+
+/** append buffer obtained from [buffer_slab_alloc], it is returned to its slab once consumed */
+void buffer_append_slab(buffer *, uint8_t *buf, size_t len);
+
 
 struct string_buf_s {
     buffer *buf;
     bool fixed;
+    bool grow; // single contiguous chunk, grown as needed
     size_t chunk_size;
     uint8_t *chunk;
     uint8_t *wp;
@@ -56,6 +123,12 @@ struct string_buf_s {
 
 void string_buf_init(string_buf_t *wb);
 
+/**
+ * Initialize string buffer that keeps its content in one contiguous allocation, starting at [size_hint] bytes.
+ * string_buf_to_string() hands that allocation over without copying.
+ */
+void string_buf_init_sized(string_buf_t *wb, size_t size_hint);
+
 void string_buf_init_fixed(string_buf_t *wb, char *outbuf, size_t max);
 
 void string_buf_free(string_buf_t *wb);
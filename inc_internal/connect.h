@@ -40,8 +40,40 @@ void init_transport_conn(struct ziti_conn *conn);
 
 int ziti_close_server(struct ziti_conn *conn);
 
+/**
+ * new transport connection for an incoming dial, recycled from [ztx] connection pool if possible.
+ * accepted connections return to the pool when they are closed
+ */
+struct ziti_conn *conn_pool_get(struct ziti_ctx *ztx);
+
+/** make sure there are at least [count] connections in the pool, ahead of incoming dials */
+void conn_pool_warm(struct ziti_ctx *ztx, size_t count);
+
+void conn_pool_free(struct ziti_ctx *ztx);
+
+/** allocate end-to-end encryption state (and key exchange material) of [conn], if not done yet */
+struct conn_crypto *conn_crypto_init(struct ziti_conn *conn);
+
+/** hibernate connections of [ztx] that did not transfer anything since the previous check */
+void conn_hibernate_idle(struct ziti_ctx *ztx);
+
+/** client of [server] was accepted [latency] ms after its Dial request arrived */
+void ziti_server_accepted(struct ziti_conn *server, uint64_t latency);
+
+/** [client] is no longer pending in its server's admission control: it is being accepted or closed */
+void ziti_server_pending_done(struct ziti_conn *client);
+
 message *create_message(struct ziti_conn *conn, uint32_t content, size_t body_len);
 
+/**
+ * Zero-copy alternative to ziti_conn_read() for connections in pull mode:
+ * received data is peeked in place, and consumed once it was used.
+ * Peeked regions stay valid until they are consumed.
+ */
+int conn_peek_iov(struct ziti_conn *conn, uv_buf_t *iov, int max_iov);
+
+size_t conn_consume(struct ziti_conn *conn, size_t len);
+
 #ifdef __cplusplus
 }
 #endif
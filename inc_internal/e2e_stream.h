@@ -0,0 +1,89 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_E2E_STREAM_H
+#define ZITI_SDK_E2E_STREAM_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+#include <sodium.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/*
+ * One direction of end-to-end encryption.
+ *
+ * Streams start with xchacha20poly1305 secretstream. AES-256-GCM is negotiated in band, so that peers
+ * that do not know about it are not affected:
+ * - a side that wants AES-256-GCM sends an empty secretstream message tagged PUSH (offer) right after its header,
+ *   peers that do not know it receive an empty message and ignore it
+ * - once a side has sent its offer and received the peer's, it sends an empty message tagged FINAL (switch),
+ *   and encrypts everything after it with AES-256-GCM
+ * - receiver of the switch decrypts everything after it with AES-256-GCM
+ *
+ * AES-256-GCM keys are derived from the secretstream session keys, nonces are message counters.
+ * Messages have the same overhead in both modes: AES-256-GCM messages carry a zero byte
+ * (authenticated as additional data) where secretstream has its encrypted tag byte.
+ */
+
+#define E2E_HEADER_BYTES crypto_secretstream_xchacha20poly1305_HEADERBYTES
+#define E2E_ABYTES crypto_secretstream_xchacha20poly1305_ABYTES
+
+struct e2e_stream {
+    uint8_t method; // enum crypto_method
+    bool local_offer; // this side offered AES-256-GCM, [gcm_key] is set until switch
+    bool peer_offer; // inbound only: peer offered AES-256-GCM
+    crypto_secretstream_xchacha20poly1305_state ss;
+    uint8_t gcm_key[crypto_aead_aes256gcm_KEYBYTES];
+    crypto_aead_aes256gcm_state *gcm; // expanded key, allocated on switch
+    uint64_t seq;
+};
+
+/** AES-256-GCM is hardware accelerated on this host */
+bool e2e_aes_available(void);
+
+/** start outbound stream, [header] is sent to the peer as the first message. */
+int e2e_init_push(struct e2e_stream *s, uint8_t header[E2E_HEADER_BYTES], const uint8_t *key, bool offer_aes);
+
+int e2e_init_pull(struct e2e_stream *s, const uint8_t header[E2E_HEADER_BYTES], const uint8_t *key, bool offer_aes);
+
+/** encrypt [mlen] bytes into [c] (mlen + E2E_ABYTES), [m] may be c + 1 */
+void e2e_push(struct e2e_stream *s, uint8_t *c, const uint8_t *m, size_t mlen);
+
+/** write AES-256-GCM offer (E2E_ABYTES) into [c] */
+void e2e_push_offer(struct e2e_stream *s, uint8_t *c);
+
+/** true once offers went both ways, and the switch has not been sent yet */
+bool e2e_switch_ready(const struct e2e_stream *out, const struct e2e_stream *in);
+
+/** write switch message (E2E_ABYTES) into [c], everything pushed after it is AES-256-GCM */
+int e2e_push_switch(struct e2e_stream *s, uint8_t *c);
+
+/**
+ * decrypt [clen] bytes of [c] into [m], [m] may be c + 1.
+ * offer and switch messages are consumed by the stream and produce no plain text
+ * @return 0 or -1 if message could not be authenticated
+ */
+int e2e_pull(struct e2e_stream *s, uint8_t *m, size_t *mlen, const uint8_t *c, size_t clen);
+
+void e2e_stream_free(struct e2e_stream *s);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_E2E_STREAM_H
@@ -0,0 +1,68 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef ZITI_SDK_INTERCEPT_INDEX_H
+#define ZITI_SDK_INTERCEPT_INDEX_H
+
+#include <ziti/ziti_model.h>
+
+#include "str_intern.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+struct cidr_node;
+
+/**
+ * Index of service intercept addresses.
+ * Intercept configs are parsed once (see ziti_service_get_config_ref()), lookups only evaluate services whose
+ * addresses can match: exact hostname table, wildcard domain table (walking the address suffixes),
+ * and binary radix trie for CIDR ranges.
+ */
+typedef struct intercept_index_s {
+    // map<service name, struct intercept_entry>
+    model_map services;
+    // map<lower case hostname, model_list<struct intercept_entry>>
+    model_map hosts;
+    // map<lower case wildcard domain, model_list<struct intercept_entry>>
+    model_map domains;
+    struct cidr_node *v4;
+    struct cidr_node *v6;
+    // service names are interned here, if set
+    str_intern *strings;
+} intercept_index;
+
+/**
+ * (re)index service, services without intercept configuration are removed from index.
+ * Index borrows parsed config from [service], so it must be updated (or entry removed) before service is freed.
+ */
+void intercept_index_update(intercept_index *idx, const ziti_service *service);
+
+void intercept_index_remove(intercept_index *idx, const char *service_name);
+
+void intercept_index_clear(intercept_index *idx);
+
+/**
+ * Find service with the best intercept match, see ziti_intercept_match2() for scoring.
+ * @return service name or NULL
+ */
+const char *intercept_index_lookup(const intercept_index *idx, ziti_protocol proto, const ziti_address *addr, int port);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_INTERCEPT_INDEX_H
@@ -38,7 +38,9 @@ XX(token, string, none, token, __VA_ARGS__)\
 XX(id, string, none, id, __VA_ARGS__) \
 XX(session_type, string, none, type, __VA_ARGS__) \
 XX(edge_routers, ziti_edge_router, list, edgeRouters, __VA_ARGS__) \
-XX(service_id, string, none, NULL, __VA_ARGS__)
+XX(service_id, string, none, NULL, __VA_ARGS__) \
+XX(fetched_at, duration, none, NULL, __VA_ARGS__) /* loop time(ms) of last update */ \
+XX(last_used, duration, none, NULL, __VA_ARGS__) /* loop time(ms) of last dial */
 
 #define ZITI_PROCESS_MODEL(XX, ...) \
 XX(path, string, none, path, __VA_ARGS__)
@@ -243,6 +245,29 @@ DECLARE_MODEL(ziti_create_api_cert_req, ZITI_CREATE_API_CERT_REQ)
 
 DECLARE_MODEL(ziti_create_api_cert_resp, ZITI_CREATE_API_CERT_RESP)
 
+/**
+ * Hash of service properties that are reported as service changes:
+ * updated_at, configs, and posture policies (expected after posture_query_map is populated).
+ * Map ordering does not affect the result.
+ */
+uint64_t ziti_service_content_hash(const ziti_service *service);
+
+/**
+ * Content hash computed once and kept with the service, service must not be modified afterwards.
+ */
+uint64_t ziti_service_cached_hash(ziti_service *service);
+
+#define ZITI_WARM_CACHE_MODEL(XX, ...) \
+XX(controller, string, none, controller, __VA_ARGS__) \
+XX(api_session, ziti_api_session, ptr, apiSession, __VA_ARGS__) \
+XX(api_session_expires, timestamp, ptr, apiSessionExpires, __VA_ARGS__) \
+XX(services, ziti_service, array, services, __VA_ARGS__) \
+XX(sessions, ziti_net_session, map, sessions, __VA_ARGS__) \
+XX(edge_routers, ziti_edge_router, array, edgeRouters, __VA_ARGS__) \
+XX(router_rtt, int, map, routerRtt, __VA_ARGS__)
+
+DECLARE_MODEL(ziti_warm_cache, ZITI_WARM_CACHE_MODEL)
+
 #ifdef __cplusplus
 }
 #endif
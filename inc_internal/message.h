@@ -16,6 +16,7 @@
 #define ZITI_SDK_MESSAGE_H
 
 #include "pool.h"
+#include "buffer.h"
 
 #include <stdlib.h>
 #include <stdint.h>
@@ -54,6 +55,18 @@ typedef struct {
     uint8_t *value;
 } hdr_t;
 
+// number of headers parsed without allocation
+#define MSG_INLINE_HDRS 8
+
+// frequently accessed headers, located during parsing
+enum msg_known_hdr {
+    MsgHdrReplyFor,
+    MsgHdrConnId,
+    MsgHdrSeq,
+    MsgHdrFlags,
+    MsgHdrKnownCount
+};
+
 typedef struct message_s {
     TAILQ_ENTRY(message_s) _next;
 
@@ -62,9 +75,17 @@ typedef struct message_s {
     uint8_t *body;
     hdr_t *hdrs;
     int nhdrs;
+    bool hdrs_indexed;
+    // index + 1 into hdrs, zero if header is not present
+    uint8_t known_hdrs[MsgHdrKnownCount];
+    hdr_t hdr_table[MSG_INLINE_HDRS];
 
     size_t msgbuflen;
     uint8_t *msgbufp;
+    // set if msgbufp points into a (shared) read chunk
+    buffer_chunk *chunk;
+    // references held in addition to the owner's, see message_retain()
+    int refs;
     uint8_t msgbuf[];
 } message;
 
@@ -83,6 +104,14 @@ void message_init(message *m);
 
 void message_free(message *m);
 
+/**
+ * Take an additional reference on the message.
+ * Message is returned to its pool when the last reference is dropped with [message_release].
+ */
+message *message_retain(message *m);
+
+void message_release(message *m);
+
 bool message_get_bool_header(message *m, int header_id, bool *v);
 
 bool message_get_int32_header(message *m, int header_id, int32_t *v);
@@ -95,12 +124,53 @@ uint8_t *write_hdr(const hdr_t *h, uint8_t *buf);
 
 int parse_hdrs(uint8_t *buf, uint32_t len, hdr_t **hp);
 
+/**
+ * Parse message headers into the inline header table (heap is used only if there are more than [MSG_INLINE_HDRS]),
+ * and index well-known headers for constant time lookup.
+ * @return number of headers
+ */
+int message_parse_hdrs(message *m);
+
 message *message_new_from_header(pool_t *pool, uint8_t buf[HEADER_SIZE]);
 
+/**
+ * Create message referencing a complete frame in place, no data is copied.
+ * The message takes ownership of the [chunk] reference, and releases it in [message_free].
+ */
+message *message_new_from_chunk(pool_t *pool, uint8_t *buf, buffer_chunk *chunk);
+
 message *message_new(pool_t *pool, uint32_t content, const hdr_t *headers, int nheaders, size_t body_len);
 
 void message_set_seq(message *m, uint32_t *seq);
 
+#define MSG_SIZE_CLASSES 4
+
+// number of messages allocated at once by message pools
+#define MSG_POOL_SLAB_COUNT 8
+
+/**
+ * Outbound message pools bucketed by message size.
+ * Messages that don't fit any class, or are allocated when their class is at capacity, are not pooled.
+ */
+typedef struct msg_pools_s msg_pools;
+
+struct msg_pool_stats {
+    size_t size;        // max message size (header, headers and body) in this class
+    uint64_t hits;      // allocations served from the pool
+    uint64_t misses;    // allocations made when the pool was at capacity
+    size_t high_water;  // max number of pooled messages in use at once
+};
+
+/** create pools, [cap] is the max number of pooled messages in use at once in each size class */
+msg_pools *msg_pools_new(size_t cap);
+
+void msg_pools_free(msg_pools *);
+
+/** same as [message_new], picks the pool by message size. [pools] can be NULL */
+message *message_new_out(msg_pools *pools, uint32_t content, const hdr_t *headers, int nheaders, size_t body_len);
+
+void msg_pools_stats(msg_pools *, struct msg_pool_stats stats[MSG_SIZE_CLASSES], uint64_t *oversize);
+
 
 #ifdef __cplusplus
 };
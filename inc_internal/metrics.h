@@ -55,8 +55,20 @@ typedef long atomic_long;
 #endif
 #endif
 
-struct rate_s {
+// updates go to a per-thread shard, so threads don't contend on the same cache line,
+// shards are summed on each tick
+#define RATE_SHARDS 8
+#define RATE_SHARD_PAD 64
+
+struct rate_shard {
     atomic_llong delta;
+    char _pad[RATE_SHARD_PAD - sizeof(long long)];
+};
+
+struct metrics_ticker;
+
+struct rate_s {
+    struct rate_shard shards[RATE_SHARDS];
     atomic_llong rate;
     atomic_llong param;
 
@@ -64,23 +76,66 @@ struct rate_s {
 
     atomic_long init;
     bool active;
+    struct metrics_ticker *ticker;
     LIST_ENTRY(rate_s) _next;
 };
 
 typedef struct rate_s rate_t;
 
+// log-linear histogram: values below HIST_SUB_BUCKETS are exact, larger values fall into
+// HIST_SUB_BUCKETS linear buckets per power of 2 (relative error < 1/HIST_SUB_BUCKETS)
+// not thread-safe, record and query on the loop thread
+#define HIST_SUB_BITS 4
+#define HIST_SUB_BUCKETS (1 << HIST_SUB_BITS)
+#define HIST_MAX_BITS 40 // larger values are counted in the last bucket
+#define HIST_BUCKETS ((HIST_MAX_BITS - HIST_SUB_BITS + 1) * HIST_SUB_BUCKETS)
+
+struct histogram_s {
+    uint64_t count;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+    uint32_t counts[HIST_BUCKETS];
+};
+
+typedef struct histogram_s histogram_t;
+
+// called on the loop's metrics tick, after rates are updated
+typedef struct metrics_tick_hook_s {
+    void (*cb)(struct metrics_tick_hook_s *hook);
+    void *data;
+    struct metrics_ticker *ticker;
+    LIST_ENTRY(metrics_tick_hook_s) _next;
+} metrics_tick_hook;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// start ticker for the loop, rates of each loop are ticked by their own timer
 extern void metrics_init(uv_loop_t *loop, long interval_secs);
 
+// rate ticked by the loop's ticker, it must be initialized and closed on the loop thread
+extern void metrics_rate_init_loop(uv_loop_t *loop, rate_t *r, rate_type type);
+
+// rate that is not bound to a loop, only ticked by tick_all()
 extern void metrics_rate_init(rate_t *r, rate_type type);
 extern void metrics_rate_close(rate_t* r);
 
 extern void metrics_rate_update(rate_t *r, long delta);
 extern double metrics_rate_get(rate_t *r);
 
+// hook must be added and removed on the loop thread, it is safe to remove it from its callback
+extern void metrics_tick_hook_add(uv_loop_t *loop, metrics_tick_hook *h);
+extern void metrics_tick_hook_remove(metrics_tick_hook *h);
+
+extern void metrics_hist_reset(histogram_t *h);
+extern void metrics_hist_record(histogram_t *h, uint64_t value);
+extern void metrics_hist_merge(histogram_t *into, const histogram_t *from);
+// value at or below which [pct] percent of recorded values are, 0 if empty
+extern uint64_t metrics_hist_percentile(const histogram_t *h, double pct);
+extern double metrics_hist_mean(const histogram_t *h);
+
 #ifdef __cplusplus
 }
 #endif
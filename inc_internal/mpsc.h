@@ -0,0 +1,102 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_MPSC_H
+#define ZITI_SDK_MPSC_H
+
+#include <stddef.h>
+
+#if _WIN32
+#include <uv.h> // brings in windows.h, in the right order
+#define mpsc_xchg(p, v) InterlockedExchangePointer((PVOID volatile *)(p), (v))
+#define mpsc_load(p) InterlockedCompareExchangePointer((PVOID volatile *)(p), NULL, NULL)
+#define mpsc_store(p, v) (void)InterlockedExchangePointer((PVOID volatile *)(p), (v))
+#else
+#define mpsc_xchg(p, v) __atomic_exchange_n((p), (v), __ATOMIC_ACQ_REL)
+#define mpsc_load(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define mpsc_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Intrusive multi-producer/single-consumer queue (D. Vyukov).
+ * Any thread can push, without locks; only the owning loop pops.
+ * Node is embedded in the queued element, use [container_of] to get it back.
+ */
+typedef struct mpsc_node_s {
+    struct mpsc_node_s *volatile next;
+} mpsc_node_t;
+
+typedef struct mpsc_queue_s {
+    mpsc_node_t *volatile head; // producers
+    mpsc_node_t *tail;          // consumer
+    mpsc_node_t stub;
+} mpsc_queue_t;
+
+static inline void mpsc_init(mpsc_queue_t *q) {
+    q->stub.next = NULL;
+    q->head = &q->stub;
+    q->tail = &q->stub;
+}
+
+static inline void mpsc_push(mpsc_queue_t *q, mpsc_node_t *n) {
+    n->next = NULL;
+    mpsc_node_t *prev = (mpsc_node_t *) mpsc_xchg(&q->head, n);
+    mpsc_store(&prev->next, n);
+}
+
+/**
+ * Pop from consumer thread.
+ * Returns NULL if queue is empty, or if a producer is in the middle of its push --
+ * producers signal the consumer after push is done, so the element is picked up on the next wakeup.
+ */
+static inline mpsc_node_t *mpsc_pop(mpsc_queue_t *q) {
+    mpsc_node_t *tail = q->tail;
+    mpsc_node_t *next = (mpsc_node_t *) mpsc_load(&tail->next);
+
+    if (tail == &q->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        q->tail = next;
+        tail = next;
+        next = (mpsc_node_t *) mpsc_load(&next->next);
+    }
+
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+
+    if (tail != mpsc_load(&q->head)) {
+        return NULL;
+    }
+
+    mpsc_push(q, &q->stub);
+    next = (mpsc_node_t *) mpsc_load(&tail->next);
+    if (next) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_MPSC_H
@@ -18,6 +18,7 @@
 
 #include <stddef.h>
 #include <stdbool.h>
+#include <stdint.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -28,6 +29,21 @@ typedef struct pool_s pool_t;
 
 pool_t *pool_new(size_t objsize, size_t count, void (*clear_func)(void *));
 
+/**
+ * Create pool that allocates its objects in contiguous slabs of [slab_count] objects.
+ * Only the first [clear_size] bytes of an object are zeroed when it is returned to the pool (0 - whole object),
+ * the rest of the object retains previous content.
+ * If [hugepages] is set large slabs are backed by huge pages where supported.
+ */
+pool_t *pool_new_slab(size_t objsize, size_t count, size_t slab_count, size_t clear_size, bool hugepages,
+                      void (*clear_func)(void *));
+
+/**
+ * Preallocate objects, so that up to [n] objects can be allocated without hitting the allocator.
+ * @return number of objects available in the pool
+ */
+size_t pool_reserve(pool_t *pool, size_t n);
+
 void pool_destroy(pool_t *pool);
 
 bool pool_has_available(pool_t *p);
@@ -44,6 +60,34 @@ size_t pool_mem_size(pool_t *pool);
 
 size_t pool_obj_size(void *obj);
 
+// number of objects currently allocated from the pool, and the max ever allocated at once
+void pool_usage(pool_t *pool, size_t *out, size_t *max_out);
+
+// max number of objects that can be allocated from the pool at once
+size_t pool_capacity(pool_t *pool);
+
+/**
+ * Thread-safe pool of fixed size objects.
+ * Every thread allocates from and frees into its own cache of object magazines, full and empty magazines are
+ * exchanged with a lock-free shared depot. Objects can be freed by a thread other than the one that allocated them.
+ * Cache of a thread is returned to the depot when the thread exits.
+ * Objects are zeroed when allocated.
+ */
+typedef struct mt_pool_s mt_pool_t;
+
+/** [capacity] is the (approximate) number of free objects kept by the pool */
+mt_pool_t *mt_pool_new(size_t objsize, size_t capacity);
+
+/** all objects must be returned before the pool is destroyed */
+void mt_pool_destroy(mt_pool_t *pool);
+
+void *mt_pool_alloc(mt_pool_t *pool);
+
+void mt_pool_free(void *obj);
+
+/** number of allocations served from the pool, and the number that fell back to the allocator */
+void mt_pool_stats(mt_pool_t *pool, uint64_t *hits, uint64_t *misses);
+
 #ifdef __cplusplus
 }
 #endif
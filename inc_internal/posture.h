@@ -22,21 +22,39 @@
 extern "C" {
 #endif
 
+// posture change notification sources
+enum {
+    PC_NOTIFY_MAC = 1,
+    PC_NOTIFY_PROCESS = 1 << 1,
+};
+
+struct posture_notify;
+
 struct posture_checks {
     uv_timer_t *timer;
+    // polling interval(millis) when posture data is not covered by change notifications
+    uint64_t interval;
+    struct posture_notify *notify;
 
     // map<type/process_path,response>
     model_map responses;
 
-    // map<type/process_path, is errored
-    model_map error_states;
-
     char *previous_api_session_id;
     char *controller_instance_id;
-    bool must_send;
     bool must_send_every_time;
+    // loop time of last full resubmission
+    uint64_t last_full_sync;
+    // posture submissions not completed yet
+    int sends_in_flight;
+    // set while ziti_send_posture_data() starts collection, responses collected later are sent when all are in
+    bool collecting;
 
     model_map active_work;
+    // process checks waiting for a free job slot
+    model_list pending_work;
+
+    // map<process_path, struct process_hash> results of last process hashing
+    model_map process_hashes;
 };
 
 void ziti_posture_init(ziti_context ztx, long interval_secs);
@@ -47,6 +65,18 @@ void ziti_send_posture_data(ziti_context ztx);
 
 bool ziti_service_has_query_with_timeout(ziti_service *service);
 
+// collect posture data soon, something has changed
+void ziti_posture_changed(ziti_context ztx, const char *what);
+
+struct posture_notify *ziti_posture_notify_start(ziti_context ztx);
+
+int ziti_posture_notify_sources(const struct posture_notify *pn);
+
+// set processes (map<path, ...>) to report start/exit of
+void ziti_posture_notify_watch(struct posture_notify *pn, model_map *processes);
+
+void ziti_posture_notify_stop(struct posture_notify *pn);
+
 #ifdef __cplusplus
 }
 #endif
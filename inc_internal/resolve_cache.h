@@ -0,0 +1,83 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_RESOLVE_CACHE_H
+#define ZITI_SDK_RESOLVE_CACHE_H
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RESOLVE_CACHE_SLOTS 512
+#define RESOLVE_CACHE_STR_WORDS 16 // strings up to 127 chars
+
+/**
+ * Cache of (socket type, host, port) => (context, service, assigned address) lookups.
+ *
+ * Readers never block or allocate: every slot is a seqlock, values are copied out and
+ * discarded if a writer changed the slot in the meantime.
+ * Writers that find the slot busy just skip caching.
+ * Cache is invalidated as a whole by bumping its generation.
+ */
+typedef struct resolve_slot_s {
+    uint64_t seq; // odd while slot is being written
+    uint64_t gen;
+    uint64_t key;
+    uint64_t ztx;
+    uint64_t addr;
+    uint64_t host[RESOLVE_CACHE_STR_WORDS];
+    uint64_t service[RESOLVE_CACHE_STR_WORDS];
+} resolve_slot;
+
+typedef struct resolve_cache_s {
+    uint64_t gen;
+    resolve_slot slots[RESOLVE_CACHE_SLOTS];
+} resolve_cache;
+
+void resolve_cache_init(resolve_cache *cache);
+
+/**
+ * drop all entries, called on service or context changes
+ */
+void resolve_cache_invalidate(resolve_cache *cache);
+
+/**
+ * current generation, capture it before the lookup that produces entry for [resolve_cache_put]
+ */
+uint64_t resolve_cache_gen(resolve_cache *cache);
+
+/**
+ * @param service (output) buffer of at least [RESOLVE_CACHE_STR_WORDS * 8] bytes
+ * @param addr (output, optional) address assigned to [host], 0 if none yet
+ * @return true if entry was found
+ */
+bool resolve_cache_get(resolve_cache *cache, int type, const char *host, uint16_t port,
+                       void **ztx, char *service, uint32_t *addr);
+
+/**
+ * Entry is stored with [gen], so that a result computed before invalidation is never returned.
+ * Hosts and service names that do not fit into a slot are not cached.
+ */
+void resolve_cache_put(resolve_cache *cache, uint64_t gen, int type, const char *host, uint16_t port,
+                       void *ztx, const char *service, uint32_t addr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_RESOLVE_CACHE_H
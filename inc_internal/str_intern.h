@@ -0,0 +1,65 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_STR_INTERN_H
+#define ZITI_SDK_STR_INTERN_H
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include <ziti/model_collections.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Table of reference counted strings (service names and IDs).
+ * Every distinct string is allocated once, strings interned in the same table
+ * are equal if and only if their pointers are equal.
+ * Not thread-safe, table is owned by the context loop.
+ */
+typedef struct str_intern_s {
+    // map<string, struct interned_str>
+    model_map strings;
+} str_intern;
+
+/**
+ * Get interned copy of [s], adding a reference.
+ * With NULL table this is just strdup(), so that table-less owners can use the same calls.
+ * @return interned string or NULL if [s] is NULL
+ */
+const char *str_intern_get(str_intern *t, const char *s);
+
+/**
+ * Drop reference to string returned by str_intern_get(), string is freed with the last reference.
+ */
+void str_intern_release(str_intern *t, const char *s);
+
+/** number of distinct strings in the table */
+size_t str_intern_size(const str_intern *t);
+
+/** number of references held on [s], 0 if it is not in the table */
+size_t str_intern_refs(const str_intern *t, const char *s);
+
+/**
+ * Free all strings, regardless of outstanding references.
+ */
+void str_intern_clear(str_intern *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_STR_INTERN_H
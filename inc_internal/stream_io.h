@@ -0,0 +1,89 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_STREAM_IO_H
+#define ZITI_SDK_STREAM_IO_H
+
+#include <stddef.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Single-producer/single-consumer byte ring, producer and consumer may run on different threads.
+ * Ring positions are free running, [size] must be a power of 2.
+ * Not available on Windows.
+ */
+typedef struct stream_ring_s stream_ring;
+
+stream_ring *stream_ring_new(size_t size);
+
+void stream_ring_free(stream_ring *r);
+
+// producer: contiguous free space at [p]
+size_t stream_ring_free_region(stream_ring *r, uint8_t **p);
+
+// producer: publish [len] bytes written into free region
+void stream_ring_produce(stream_ring *r, size_t len);
+
+// producer: copy in as much of [data] as fits
+size_t stream_ring_write(stream_ring *r, const uint8_t *data, size_t len);
+
+// consumer: copy out and release up to [len] bytes
+size_t stream_ring_read(stream_ring *r, uint8_t *buf, size_t len);
+
+/**
+ * consumer: contiguous data published at or after [pos], without releasing it.
+ * Lets consumer hand out ring memory and release it later with [stream_ring_release()].
+ */
+size_t stream_ring_peek(stream_ring *r, size_t pos, uint8_t **p);
+
+// consumer: release [len] bytes at the tail
+void stream_ring_release(stream_ring *r, size_t len);
+
+/**
+ * Doorbell for an application thread waiting on the loop.
+ * Loop bumps the sequence whenever the waiter may be able to make progress, the descriptor is signaled only
+ * if the waiter is armed. Not available on Windows.
+ */
+typedef struct stream_bell_s stream_bell;
+
+// returns NULL with errno set on failure
+stream_bell *stream_bell_new(void);
+
+void stream_bell_free(stream_bell *b);
+
+// descriptor that becomes readable when an armed waiter is notified
+int stream_bell_fd(stream_bell *b);
+
+// waiter: snapshot taken before checking stream state
+unsigned int stream_bell_seq(stream_bell *b);
+
+// loop: something changed
+void stream_bell_notify(stream_bell *b);
+
+/**
+ * waiter: arm the bell and wait for a change after [seq] was taken.
+ * @return true if something changed, false if nothing did and [block] is not set
+ */
+bool stream_bell_wait(stream_bell *b, unsigned int seq, bool block);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_STREAM_IO_H
@@ -0,0 +1,80 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+
+#ifndef ZITI_SDK_TIMER_WHEEL_H
+#define ZITI_SDK_TIMER_WHEEL_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <uv.h>
+#include <tlsuv/queue.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TW_LEVELS 4
+#define TW_SLOT_BITS 6
+#define TW_SLOTS (1 << TW_SLOT_BITS)
+
+typedef struct timer_wheel_s timer_wheel_t;
+typedef struct wheel_timer_s wheel_timer_t;
+
+typedef void (*wheel_timer_cb)(wheel_timer_t *t);
+
+/**
+ * Coarse timer, meant to be embedded in the object it times out.
+ * Arming and cancelling are O(1) and do not allocate.
+ */
+struct wheel_timer_s {
+    LIST_ENTRY(wheel_timer_s) _next;
+    timer_wheel_t *wheel; // set while timer is armed
+    uint64_t expire;      // in wheel ticks
+    wheel_timer_cb cb;
+    void *data;
+};
+
+/**
+ * Hierarchical timer wheel driven by a single libuv timer.
+ * The libuv timer only runs while there are armed timers.
+ */
+struct timer_wheel_s {
+    uv_timer_t *timer;
+    uint64_t resolution;
+    uint64_t start;
+    uint64_t tick;
+    size_t active;
+    LIST_HEAD(tw_slot, wheel_timer_s) slots[TW_LEVELS][TW_SLOTS];
+};
+
+int timer_wheel_init(timer_wheel_t *tw, uv_loop_t *loop, uint64_t resolution_ms);
+
+/** Disarm all timers (without invoking callbacks) and release libuv resources. */
+void timer_wheel_close(timer_wheel_t *tw);
+
+/**
+ * Arm (or re-arm) [t] to fire after [timeout_ms] rounded up to wheel resolution.
+ */
+void wheel_timer_start(timer_wheel_t *tw, wheel_timer_t *t, uint64_t timeout_ms, wheel_timer_cb cb, void *data);
+
+void wheel_timer_stop(wheel_timer_t *t);
+
+bool wheel_timer_is_active(const wheel_timer_t *t);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_TIMER_WHEEL_H
@@ -23,6 +23,7 @@
 #include <tlsuv/queue.h>
 #include <ziti/ziti_log.h>
 #include "ziti/model_collections.h"
+#include "ziti_alloc.h"
 
 #ifdef __cplusplus
 extern "C" {
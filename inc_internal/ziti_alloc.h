@@ -0,0 +1,77 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_ZITI_ALLOC_H
+#define ZITI_SDK_ZITI_ALLOC_H
+
+// system declarations have to be seen before the names are redirected below
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Heap allocation counters of the SDK.
+ *
+ * With ZITI_ALLOC_TRACKING build option malloc/calloc/realloc/free/strdup/strndup called by SDK sources
+ * that include utils.h (all of the data path) go through the counting wrappers.
+ * Allocations made by dependencies (libuv, tlsuv, libsodium) are not counted,
+ * neither are frees done through `free` passed as a function pointer.
+ * Without the option counters stay at zero.
+ */
+typedef struct ziti_alloc_stats_s {
+    uint64_t allocs; // malloc, calloc, strdup, strndup, realloc(NULL, ...)
+    uint64_t reallocs;
+    uint64_t frees;
+    uint64_t bytes; // requested by allocs and reallocs
+} ziti_alloc_stats;
+
+void ziti_alloc_get_stats(ziti_alloc_stats *stats);
+
+void *ziti_alloc_malloc(size_t size);
+
+void *ziti_alloc_calloc(size_t count, size_t size);
+
+void *ziti_alloc_realloc(void *ptr, size_t size);
+
+void ziti_alloc_free(void *ptr);
+
+char *ziti_alloc_strdup(const char *s);
+
+char *ziti_alloc_strndup(const char *s, size_t n);
+
+#ifdef __cplusplus
+}
+#endif
+
+// note: function-like macros, calls through struct members (e.g. `pk->free(pk)`) have to be written as `(pk->free)(pk)`
+#if defined(ZITI_ALLOC_TRACKING) && !defined(ZITI_ALLOC_IMPL) && !defined(__cplusplus)
+#undef malloc
+#undef calloc
+#undef realloc
+#undef free
+#undef strdup
+#undef strndup
+#define malloc(s) ziti_alloc_malloc(s)
+#define calloc(c, s) ziti_alloc_calloc(c, s)
+#define realloc(p, s) ziti_alloc_realloc(p, s)
+#define free(p) ziti_alloc_free(p)
+#define strdup(s) ziti_alloc_strdup(s)
+#define strndup(s, n) ziti_alloc_strndup(s, n)
+#endif
+
+#endif //ZITI_SDK_ZITI_ALLOC_H
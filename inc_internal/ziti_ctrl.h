@@ -18,6 +18,7 @@
 
 #include <tlsuv/http.h>
 #include "internal_model.h"
+#include "metrics.h"
 #include "ziti/ziti_model.h"
 #include "zt_internal.h"
 
@@ -34,13 +35,34 @@ extern const char* const PC_ENDPOINT_STATE_TYPE;
 
 typedef void (*ziti_ctrl_redirect_cb)(const char *new_address, void *ctx);
 
+// dial path requests use a separate connection, so they don't wait behind background traffic
+enum ctrl_lane {
+    CTRL_LANE_DIAL,
+    CTRL_LANE_DEFAULT,
+    CTRL_LANES,
+};
+
+// list pages are requested on their own connections, this bounds concurrent page requests
+#define CTRL_PAGE_CLIENTS 4
+
+// request latency(millis) from submission to completion
+struct ctrl_req_stats {
+    unsigned int errors;
+    uint64_t last;
+    histogram_t latency;
+};
+
 typedef struct ziti_controller_s {
     uv_loop_t *loop;
     tlsuv_http_t *client;
+    tlsuv_http_t *dial_client;
+    tlsuv_http_t *page_clients[CTRL_PAGE_CLIENTS];
+    unsigned int page_reqs[CTRL_PAGE_CLIENTS]; // in-flight page requests per page client
     char *url;
 
     // tuning options
     unsigned int page_size;
+    unsigned int page_window; // max concurrent page requests, up to CTRL_PAGE_CLIENTS
 
     ziti_version version;
 
@@ -49,18 +71,40 @@ typedef struct ziti_controller_s {
 
     ziti_ctrl_redirect_cb redirect_cb;
     void *redirect_ctx;
+
+    struct ctrl_req_stats stats[CTRL_LANES];
+
+    // map<path, etag> of last complete list responses, used for conditional requests
+    model_map etags;
+    // services list path, filtered to subscribed services
+    char *services_path;
 } ziti_controller;
 
 int ziti_ctrl_init(uv_loop_t *loop, ziti_controller *ctrl, const char *url, tls_context *tls);
 
 int ziti_ctrl_cancel(ziti_controller *ctrl);
 
+void ziti_ctrl_set_tls(ziti_controller *ctrl, tls_context *tls);
+
+const char *ziti_ctrl_lane_name(enum ctrl_lane lane);
+
 void ziti_ctrl_set_page_size(ziti_controller *ctrl, unsigned int size);
 
+void ziti_ctrl_set_page_window(ziti_controller *ctrl, unsigned int window);
+
+/** only fetch listed services (NULL terminated), all services if NULL */
+void ziti_ctrl_set_service_filter(ziti_controller *ctrl, const char **service_names);
+
+/** forget list ETags, the following list requests are unconditional */
+void ziti_ctrl_reset_etags(ziti_controller *ctrl);
+
 void ziti_ctrl_set_redirect_cb(ziti_controller *ctrl, ziti_ctrl_redirect_cb cb, void *ctx);
 
 int ziti_ctrl_close(ziti_controller *ctrl);
 
+/** use api session (e.g. restored from cache) without logging in */
+void ziti_ctrl_set_api_session(ziti_controller *ctrl, const ziti_api_session *session);
+
 void ziti_ctrl_clear_api_session(ziti_controller *ctrl);
 
 void ziti_ctrl_get_version(ziti_controller *ctrl, void (*ver_cb)(ziti_version *, const ziti_error *, void *), void *ctx);
@@ -23,11 +23,16 @@
 #include <ziti/ziti.h>
 #include "buffer.h"
 #include "pool.h"
+#include "mpsc.h"
+#include "timer_wheel.h"
+#include "intercept_index.h"
+#include "str_intern.h"
 #include "message.h"
 #include "ziti_enroll.h"
 #include "ziti_ctrl.h"
 #include "metrics.h"
 #include "edge_protocol.h"
+#include "e2e_stream.h"
 #include "posture.h"
 #include "authenticators.h"
 
@@ -41,6 +46,9 @@
 
 #define ZTX_LOG(lvl, fmt, ...) ZITI_LOG(lvl, "ztx[%u] " fmt, ztx->id, ##__VA_ARGS__)
 
+// lines per second allowed from log sites that can be hit for every message, see ZITI_LOG_RATE
+#define LOG_RATE_PER_SEC 10
+
 extern const char *APP_ID;
 extern const char *APP_VERSION;
 
@@ -68,6 +76,21 @@ typedef void (*ch_notify_state)(ziti_channel_t *ch, ziti_router_status status, v
 typedef int ch_state;
 typedef int conn_state;
 
+/**
+ * In-process replacement for TLS connections to edge routers (mock router test harness).
+ * Only available in builds with ZITI_TEST_TRANSPORT (on in developer mode), otherwise channels always use TLS.
+ * [connect] is completed with ziti_channel_transport_connected(), inbound bytes are delivered with
+ * ziti_channel_transport_input(). [write] is complete when it returns, neither [write] nor [close]
+ * may call back into the channel.
+ */
+typedef struct ziti_channel_transport_s {
+    int (*connect)(void *ctx, ziti_channel_t *ch, const char *host, int port);
+    int (*write)(void *ctx, ziti_channel_t *ch, const uint8_t *data, size_t len);
+    void (*close)(void *ctx, ziti_channel_t *ch);
+} ziti_channel_transport;
+
+#define CH_RTT_SAMPLES 64
+
 typedef struct ziti_channel {
     uv_loop_t *loop;
     struct ziti_ctx *ctx;
@@ -88,15 +111,52 @@ typedef struct ziti_channel {
     uv_timer_t *timer;
 
     uint64_t latency;
+    // smoothed RTT and RTT variation, zero until first sample
+    uint64_t srtt;
+    uint64_t rttvar;
+    // recent RTT samples (ring), and count since connect
+    uint64_t rtt_samples[CH_RTT_SAMPLES];
+    uint32_t rtt_count;
+    uint64_t rtt_min; // best RTT since connect, baseline for health score
+    // unanswered requests and probes, halved every CH_HEALTH_ERROR_DECAY
+    uint32_t health_errors;
+    uint64_t health_errors_ts;
+    bool degraded; // see ziti_channel_health()
     struct waiter_s *latency_waiter;
     uint64_t last_read;
     uint64_t last_write;
     uint64_t last_write_delay;
+    histogram_t write_delay; // millis
     size_t out_q;
     size_t out_q_bytes;
+    bool write_blocked; // out_q_bytes crossed channel_write_high_water, see conn_channel_writable()
+    // messages waiting to be flushed (coalesced) on the next loop iteration
+    TAILQ_HEAD(, ziti_write_req_s) out_pending;
+    // control messages, flushed ahead of data
+    TAILQ_HEAD(, ziti_write_req_s) ctrl_pending;
+    // bytes handed to transport and not completed yet
+    size_t out_inflight;
+    pool_t *batch_pool;
+    uv_idle_t *flusher;
 
     ch_state state;
     uint32_t reconnect_count;
+    // previous reconnect delay (decorrelated jitter)
+    uint64_t reconnect_delay;
+    // connections lost on last disconnect, channels that had them reconnect first
+    size_t lost_conns;
+    // counted against context handshake limit
+    bool handshaking;
+    // waiting for a handshake slot
+    bool reconnect_queued;
+    uint64_t queued_at;
+    LIST_ENTRY(ziti_channel) reconnect_next;
+
+    // TLS connect/handshake timing: start of current attempt, completed handshakes, and their duration(ms)
+    uint64_t connect_start;
+    uint32_t handshakes;
+    uint64_t handshake_last;
+    uint64_t handshake_total;
 
     LIST_HEAD(conn_reqs, ch_conn_req) conn_reqs;
     uint32_t msg_seq;
@@ -106,13 +166,23 @@ typedef struct ziti_channel {
     pool_t *in_msg_pool;
     message *in_next;
     size_t in_body_offset;
+    // header of the frame waiting to be assembled
+    uint8_t in_hdr[HEADER_SIZE];
+    bool in_hdr_read;
 
     // map[id->msg_receiver]
     model_map receivers;
-    LIST_HEAD(waiter, waiter_s) waiters;
+    // map[seq->waiter_s]
+    model_map waiters;
 
     ch_notify_state notify_cb;
     void *notify_ctx;
+
+    // additional connections to the same edge router (see ziti_options.router_connections)
+    // stripes are owned by the primary channel, only primary is in ztx->channels
+    struct ziti_channel *primary;
+    struct ziti_channel **stripes;
+    int num_stripes;
 } ziti_channel_t;
 
 struct ziti_write_req_s {
@@ -120,15 +190,25 @@ struct ziti_write_req_s {
     struct ziti_channel *ch;
     uint8_t *buf;
     size_t len;
+    uv_buf_t *iov;
+    unsigned int iov_count;
     bool eof;
     bool close;
 
     struct message_s *message;
+    // writes coalesced into the same message, completed after this one
+    struct ziti_write_req_s *batch;
     ziti_write_cb cb;
-    uv_timer_t *timeout;
+    wheel_timer_t timeout;
     uint64_t start_ts;
 
     void *ctx;
+    size_t queued; // counted in connection write_q_bytes
+    bool ch_queued; // counted in connection ch_out_pending
+
+    // segments of a split write, see ziti_write_iov()
+    struct ziti_write_req_s *segment_of;
+    int segment_err; // first error of earlier segments
 
     TAILQ_ENTRY(ziti_write_req_s) _next;
 };
@@ -145,29 +225,82 @@ struct key_exchange {
 
 int init_key_pair(struct key_pair *kp);
 
+/**
+ * Key pairs generated ahead of use on the libuv thread pool.
+ * Pool is refilled in the background when it runs low, and falls back to generating a key pair inline when empty.
+ */
+typedef struct key_pool_s key_pool;
+
+/**
+ * Pools and controller CA bundle shared by contexts running on the same loop, see ziti_options.share_resources
+ */
+typedef struct ztx_share_s ztx_share;
+
 int init_crypto(struct key_exchange *key_ex, struct key_pair *kp, uint8_t *peer_key, bool server);
 
 void free_key_exchange(struct key_exchange *key_ex);
 
+// dial phases tracked with ziti_options.dial_timings, each measured from the end of the previous one
+enum dial_phase {
+    DIAL_PHASE_SESSION, // ziti_dial() -> service and session available
+    DIAL_PHASE_CHANNEL, // -> edge router channel connected
+    DIAL_PHASE_CONNECT, // -> edge router connect reply
+    DIAL_PHASE_CRYPTO, // -> key exchange completed
+    DIAL_PHASES,
+};
+
 enum ziti_conn_type {
     None,
     Transport,
     Server,
 };
 
+// key exchange material, released once both directions of the stream are initialized
+struct conn_keys {
+    struct key_pair key_pair;
+    struct key_exchange key_ex;
+};
+
+// end-to-end encryption state, only allocated for encrypted connections
+struct conn_crypto {
+    struct e2e_stream crypt_o;
+    struct e2e_stream crypt_i;
+    struct conn_keys *keys;
+};
+
 struct ziti_conn {
+    // fields used for every message are kept together in the first cache line
     struct ziti_ctx *ziti_ctx;
+    uint32_t conn_id;
+    conn_state state;
     enum ziti_conn_type type;
-    char *service;
+    int write_reqs;
+    int ch_out_pending; // messages waiting in channel out_pending, control messages must not overtake them
+    ziti_channel_t *channel;
+    TAILQ_HEAD(, message_s) in_q;
+    TAILQ_HEAD(, ziti_write_req_s) wreqs;
+
+    bool close;
+    TAILQ_ENTRY(ziti_conn) close_next; // see ziti_ctx.close_queue
+    bool encrypted;
+    bool datagram; // one message per datagram, inbound data is not buffered
+    bool coalesce; // small queued writes are merged, see ziti_dial_opts.coalesce_writes
+    // connection is processed by ztx flusher, see flush_connection()
+    bool flush_enabled;
+    bool flush_queued;
+    TAILQ_ENTRY(ziti_conn) flush_next;
+
+    const char *service; // interned in ziti_ctx.strings
     char *source_identity;
-    uint32_t conn_id;
     void *data;
 
     int (*disposer)(struct ziti_conn *self);
 
     ziti_close_cb close_cb;
-    bool close;
-    bool encrypted;
+    LIST_ENTRY(ziti_conn) pool_next;
+
+    // per service counters, shared by all connections of the service (NULL if disabled)
+    struct service_xfer *svc_xfer;
 
     union {
         struct {
@@ -185,39 +318,94 @@ struct ziti_conn {
             uv_timer_t *timer;
             unsigned int attempt;
             char listener_id[32];
+
+            // adaptive bindings, see ziti_listen_opts.max_bindings
+            bool adaptive;
+            int min_bindings;
+            int target_bindings;
+            wheel_timer_t scale_timer;
+            unsigned int dials; // since last scaling check
+            unsigned int accepts;
+            uint64_t accept_latency; // total, of [accepts]
+            unsigned int idle_checks;
+
+            // admission control, see ziti_listen_opts.max_pending
+            int max_pending;
+            int pending; // children passed to client_cb, not accepted yet
+            int dial_rate;
+            int dial_burst;
+            uint64_t dial_tokens; // 1/1000 of a dial
+            uint64_t dial_tokens_ts;
+            uint16_t load_cost;
+            uint16_t cost_sent; // terminator cost last sent to edge routers
+            wheel_timer_t load_timer;
+
+            // bindings on degraded edge routers are moved, see migrate_bindings()
+            wheel_timer_t health_timer;
         } server;
 
         struct {
-            struct key_pair key_pair;
-            struct ziti_conn_req *conn_req;
-
-            uint32_t edge_msg_seq;
-
-            ziti_channel_t *channel;
             ziti_data_cb data_cb;
-            conn_state state;
-            bool fin_sent;
+            // pull mode, see ziti_conn_set_readable_cb()
+            ziti_readable_cb readable_cb;
+            // write backpressure, see ziti_options.conn_write_high_water
+            ziti_writable_cb writable_cb;
+            size_t write_q_bytes;
+            // map<buffer, message> allocated with ziti_alloc_write_buf() and not yet handed back
+            model_map write_bufs;
+            bool write_blocked;
+            LIST_ENTRY(ziti_conn) blocked_next;
+            buffer *inbound;
+            uint32_t edge_msg_seq;
             int fin_recv; // 0 - not received, 1 - received, 2 - called app data cb
+            bool read_notify;
+            bool read_paused;
+            bool fin_sent;
             bool disconnecting;
+            bool recv_overflow; // receive window was exceeded, connection is aborted
+            bool accept_pending; // counted in parent's server.pending
+            bool crypto_offload; // see ziti_options.crypto_offload_rate
+            bool early_data; // Connect is sent, writes may follow before the reply, see ziti_dial_opts.early_data
+            bool early_sent; // data went out before the reply, dial cannot be retried
+            bool hibernated; // idle, inbound buffer is released, see conn_hibernate_idle()
             int timeout;
-
-            TAILQ_HEAD(, message_s) in_q;
-            buffer *inbound;
-            uv_idle_t *flusher;
-            TAILQ_HEAD(, ziti_write_req_s) wreqs;
-            int write_reqs;
-
+            size_t inbound_max; // high-water mark of buffered inbound data
+
+            // NULL if not encrypted, see conn_crypto_init()
+            struct conn_crypto *crypto;
+            // jobs in flight, worker owns crypt_o/crypt_i until they complete
+            struct crypto_job_s *crypt_out_job;
+            struct crypto_job_s *crypt_in_job;
+
+            // data transferred by this connection
+            uint64_t bytes_up;
+            uint64_t bytes_down;
+            uint64_t msgs_up;
+            uint64_t msgs_down;
+            uint64_t offload_ts; // start of current crypto offload rate interval
+            uint64_t offload_mark; // bytes transferred at offload_ts
+            uint64_t idle_mark; // messages transferred at the last hibernation check
+
+            // set up during dial or accept
+            struct ziti_conn_req *conn_req;
             struct ziti_conn *parent;
             uint32_t dial_req_seq;
+            uint64_t accept_start; // Dial request was received by the server
 
-            struct key_exchange key_ex;
-
-            crypto_secretstream_xchacha20poly1305_state crypt_o;
-            crypto_secretstream_xchacha20poly1305_state crypt_i;
+            // dial phase timestamps, only allocated with ziti_options.dial_timings
+            ziti_dial_timings *timings;
         };
     };
+};
 
-
+// aggregated transfer counters of a service, see ziti_options.service_metrics
+struct service_xfer {
+    uint64_t bytes_up;
+    uint64_t bytes_down;
+    uint64_t msgs_up;
+    uint64_t msgs_down;
+    rate_t up_rate;
+    rate_t down_rate;
 };
 
 struct process {
@@ -231,13 +419,11 @@ struct process {
 typedef void (*ztx_work_f)(ziti_context ztx, void *w_ctx);
 
 struct ztx_work_s {
+    mpsc_node_t _node;
     ztx_work_f w;
     void *w_data;
-    STAILQ_ENTRY(ztx_work_s) _next;
 };
 
-typedef STAILQ_HEAD(work_q, ztx_work_s) ztx_work_q;
-
 struct ziti_ctx {
     ziti_config config;
     ziti_options opts;
@@ -262,23 +448,97 @@ struct ziti_ctx {
     ziti_identity_data *identity_data;
 
     bool services_loaded;
+    // service names and IDs shared by connections, requests and the intercept index
+    str_intern strings;
     // map<name,ziti_service>
     model_map services;
+    intercept_index intercepts;
     // map<service_id,ziti_net_session>
     model_map sessions;
+    // in-flight session requests shared by concurrent dials, map<service_id/type, struct session_fetch>
+    model_map session_fetches;
+    // background refresh of busy sessions
+    wheel_timer_t session_refresh_timer;
+    bool session_refresh_active;
 
     // map<service_id,*bool>
     model_map service_forced_updates;
 
+    // changes not reported yet, see ziti_options.service_event_window
+    model_map service_changes; // map<name, enum service_change>
+    model_map services_removed; // map<name, ziti_service>
+    wheel_timer_t service_event_timer;
+    // map<name, struct service_subs_s>, see ziti_service_subscribe()
+    model_map service_subs;
+
     bool no_service_updates_api; // controller API has no last-update endpoint
     bool no_bulk_posture_response_api; // controller API does not support bulk posture response submission
     bool no_current_edge_routers;
+    // last edge router list received from controller
+    ziti_edge_router_array edge_routers;
+    // map<router name, int> last smoothed RTT(ms) of edge routers, kept in warm start cache
+    model_map router_rtt;
+    // time(millis) from ziti_dial() to connection established
+    histogram_t dial_time;
+    // time(millis) spent in each dial phase, see ziti_options.dial_timings
+    histogram_t dial_phases[DIAL_PHASES];
+    // size of the last ziti_dump_json() output, used to size the next one
+    size_t dump_json_size;
+    // routers waiting to be connected, best RTT first (borrowed from edge_routers)
+    ziti_edge_router **pending_routers;
+    int pending_router_idx;
+    wheel_timer_t router_connect_timer;
+    // channels waiting to start reconnecting, and handshakes in progress
+    LIST_HEAD(, ziti_channel) reconnect_q;
+    unsigned int handshakes_inflight;
+    // debounces warm start cache writes
+    wheel_timer_t cache_timer;
+    // cache write running on threadpool
+    struct cache_write_s *cache_write;
 
     char *last_update;
 
     uv_timer_t *api_session_timer;
     uv_timer_t *service_refresh_timer;
     uv_prepare_t *prepper;
+    // shared coarse timers: write, connect and reply timeouts
+    timer_wheel_t timers;
+
+    // connections with pending inbound or outbound data, drained once per loop iteration
+    uv_idle_t *conn_flusher;
+    TAILQ_HEAD(, ziti_conn) flush_queue;
+    size_t flush_queue_len;
+
+    // connections closed by application, disposed by grim_reaper() once per loop iteration
+    TAILQ_HEAD(, ziti_conn) close_queue;
+    size_t close_queue_len;
+
+    // graceful drain, see ziti_drain()
+    bool draining;
+    struct ztx_drain_s *drain; // set until drain completes
+    uv_idle_t *drainer; // sends FIN to drained connections, a batch per loop iteration
+
+    // connections that are not writable, see conn_check_writable()
+    LIST_HEAD(, ziti_conn) write_blocked;
+
+    // closed accepted connections, reused for incoming dials, see conn_pool_get()
+    LIST_HEAD(, ziti_conn) conn_pool;
+    size_t conn_pool_size;
+
+    // key pairs for end-to-end encryption, see key_pool_get()
+    key_pool *keys;
+
+    // set with ziti_options.share_resources, keys, read_bufs and out_msgs may belong to the share
+    ztx_share *share;
+    LIST_ENTRY(ziti_ctx) share_next;
+
+    // memory budget, see ziti_options.memory_limit
+    wheel_timer_t mem_timer;
+    bool mem_over; // new dials are rejected
+    bool mem_read_paused; // channels stop reading
+
+    // idle connections check, see ziti_options.conn_hibernate_ms
+    wheel_timer_t hibernate_timer;
 
     uv_loop_t *loop;
     uv_thread_t loop_thread;
@@ -296,6 +556,28 @@ struct ziti_ctx {
     /* context wide metrics */
     rate_t up_rate;
     rate_t down_rate;
+    // map<service name, struct service_xfer>, kept until context is freed
+    model_map service_xfers;
+    // application metrics sink, see ziti_set_metrics_sink()
+    ziti_metrics_sink metrics_sink;
+    void *metrics_sink_ctx;
+    metrics_tick_hook metrics_hook;
+    // reused between ticks
+    ziti_metric *metrics_batch;
+    size_t metrics_batch_cap;
+
+    // data path counters, updated on the loop thread
+    ziti_path_stats path_stats;
+
+    /* shared by all channels */
+    buffer_slab *read_bufs;
+    msg_pools *out_msgs;
+    pool_t *write_reqs;
+#if defined(ZITI_TEST_TRANSPORT)
+    // replaces TLS to edge routers if set, see ziti_set_channel_transport()
+    const ziti_channel_transport *ch_transport;
+    void *ch_transport_ctx;
+#endif
 
     /* posture check support */
     struct posture_checks *posture_checks;
@@ -303,8 +585,8 @@ struct ziti_ctx {
     /* auth query (MFA) support */
     struct auth_queries *auth_queries;
 
-    ztx_work_q w_queue;
-    uv_mutex_t w_lock;
+    // work submitted from other threads
+    mpsc_queue_t w_queue;
     uv_async_t w_async;
 };
 
@@ -312,6 +594,34 @@ struct ziti_ctx {
 extern "C" {
 #endif
 
+key_pool *key_pool_new(uv_loop_t *loop);
+
+/** take a key pair from [pool] (NULL pool generates one inline) */
+int key_pool_get(key_pool *pool, struct key_pair *kp);
+
+size_t key_pool_available(const key_pool *pool);
+
+void key_pool_free(key_pool *pool);
+
+/** join resource share of the context loop, sets pools of [ztx] (shared if its options match the share) */
+void ztx_share_join(ziti_context ztx);
+
+/** release shared pools of [ztx], share is freed with its last context */
+void ztx_share_leave(ziti_context ztx);
+
+/**
+ * Check if another context of the share has fetched (or is fetching) CA bundle from the same controller
+ * trusting the same CA. Recently fetched bundle is applied to [ztx] right away.
+ * @return false if [ztx] has to fetch CA bundle itself, and report it with ztx_share_ca_bundle_done()
+ */
+bool ztx_share_ca_bundle_lookup(ziti_context ztx);
+
+/** apply fetched CA bundle ([pem] is NULL on failure) to all contexts of the share waiting for it */
+void ztx_share_ca_bundle_done(ziti_context ztx, const char *pem);
+
+/** switch context to updated CA bundle, no-op if [pem] is the one in use */
+void ztx_update_ca_bundle(ziti_context ztx, const char *pem);
+
 bool ziti_is_session_valid(ziti_context ztx, ziti_net_session *session, const char *service_id, ziti_session_type type);
 
 void
@@ -327,10 +637,44 @@ bool ziti_channel_is_connected(ziti_channel_t *ch);
 
 uint64_t ziti_channel_latency(ziti_channel_t *ch);
 
+/** fill in load of the channel, including all its stripes */
+void ziti_channel_load(ziti_channel_t *ch, ziti_router_load *load);
+
+/**
+ * health score of the channel (0-100), from write delay, RTT relative to the best one seen since connect,
+ * and recent unanswered requests. Updates degraded flag: set under CH_HEALTH_DEGRADED,
+ * cleared once the score is back to CH_HEALTH_RECOVERED.
+ */
+int ziti_channel_health(ziti_channel_t *ch);
+
+static inline bool ziti_channel_is_degraded(ziti_channel_t *ch) {
+    ziti_channel_health(ch);
+    return ch->degraded;
+}
+
+void ziti_channel_rtt_stats(ziti_channel_t *ch, ziti_rtt_stats *stats);
+
 int ziti_channel_connect(ziti_context ztx, const char *name, const char *url, ch_connect_cb, void *ctx);
 
 int ziti_channel_prepare(ziti_channel_t *ch);
 
+#if defined(ZITI_TEST_TRANSPORT)
+/** route channels of [ztx] over [transport], must be set before any channel is connected */
+void ziti_set_channel_transport(ziti_context ztx, const ziti_channel_transport *transport, void *ctx);
+
+/** complete ziti_channel_transport.connect() */
+void ziti_channel_transport_connected(ziti_channel_t *ch, int status);
+
+/** deliver bytes received from transport, negative [len] is an error (UV_EOF when peer closed) */
+void ziti_channel_transport_input(ziti_channel_t *ch, const uint8_t *data, ssize_t len);
+#endif
+
+/**
+ * Select connection of the (striped) channel to carry ziti connection [conn_id].
+ * Falls back to primary channel if the selected stripe is not connected.
+ */
+ziti_channel_t *ziti_channel_for_conn(ziti_channel_t *ch, uint32_t conn_id);
+
 int ziti_channel_close(ziti_channel_t *ch, int err);
 
 void ziti_channel_add_receiver(ziti_channel_t *ch, int id, void *receiver, void (*receive_f)(void *, message *, int));
@@ -363,6 +707,14 @@ void conn_inbound_data_msg(ziti_connection conn, message *msg);
 
 void on_write_completed(struct ziti_conn *conn, struct ziti_write_req_s *req, int status);
 
+/** outbound queue of [ch] drained below channel_write_low_water, blocked connections using it may be writable again */
+void conn_channel_writable(struct ziti_ctx *ztx, ziti_channel_t *ch);
+
+/** allocate write request from the context pool (falls back to the heap), release with write_req_free() */
+struct ziti_write_req_s *write_req_new(struct ziti_ctx *ztx);
+
+void write_req_free(struct ziti_write_req_s *req);
+
 
 const char *ziti_conn_state(ziti_connection conn);
 
@@ -391,6 +743,49 @@ const ziti_env_info* get_env_info();
 
 extern uv_timer_t *new_ztx_timer(ziti_context ztx);
 
+// transfer counters for service, NULL if ziti_options.service_metrics is not set
+struct service_xfer *ziti_service_xfer(ziti_context ztx, const char *service);
+
+const char *ziti_dial_phase_name(enum dial_phase phase);
+
+// unregister metrics sink and release its resources
+void ziti_metrics_sink_free(ziti_context ztx);
+
+/**
+ * Read warm start cache for this context (identity and controller).
+ * @return cached state or NULL if cache is disabled, missing, or its api session is about to expire
+ */
+ziti_warm_cache *ziti_cache_read(ziti_context ztx);
+
+/** schedule write of current context state to warm start cache */
+void ziti_cache_update(ziti_context ztx);
+
+/** remove warm start cache file, e.g. when identity can no longer authenticate */
+void ziti_cache_remove(ziti_context ztx);
+
+/** detach cache write in progress from context that is being freed */
+void ziti_cache_free(ziti_context ztx);
+
+/** send service event to application and service subscribers */
+void ztx_service_event(ziti_context ztx, ziti_event_t *ev);
+
+/**
+ * report service changes of a refresh, right away or coalesced with others within
+ * [ziti_options.service_event_window]. Removed services are owned (and freed) by this function
+ */
+void ztx_services_update(ziti_context ztx, ziti_event_t *ev);
+
+/** report coalesced service changes now */
+void ztx_service_events_flush(ziti_context ztx);
+
+void ztx_service_events_free(ziti_context ztx);
+
+/** request Dial session for the service ahead of use, shared with dials started while it is in flight */
+void ziti_prefetch_session(ziti_context ztx, const char *service_id);
+
+/** start periodic background refresh of sessions used by recent dials (no-op if already running) */
+void ziti_session_refresh_schedule(ziti_context ztx);
+
 #ifdef __cplusplus
 }
 #endif
@@ -105,6 +105,10 @@ is offline or did not respond to the request*/
 #define ZITI_INVALID_AUTHENTICATOR_CERT                         (-33)
 /** returned when attempting to set the current certificate and key being used by a ztx when it could not be parsed/applied */
 #define ZITI_INVALID_CERT_KEY_PAIR                              (-34)
+/** operation rejected because ziti_context is over its memory budget, see ziti_options.memory_limit */
+#define ZITI_MEMORY_LIMIT                                       (-35)
+/** an argument passed to the function is not valid */
+#define ZITI_INVALID_ARGUMENT                                   (-36)
 
 // Put new error codes here and add error string in error.c
 
@@ -27,6 +27,7 @@
 #include "externs.h"
 #include "model_collections.h"
 #include "types.h"
+#include "ziti_buffer.h"
 
 #if !defined(__DEFINED_ssize_t) && !defined(__ssize_t_defined)
 #if _WIN32
@@ -177,6 +178,7 @@ typedef struct type_meta {
     _parse_f parser;
     _to_json_f jsonifier;
     _free_f destroyer;
+    void *field_index; // field lookup table, built on first use
 } type_meta;
 
 #define MODEL_PARSE_INVALID (-2)
@@ -194,10 +196,54 @@ ZITI_FUNC int model_parse_array(void ***arp, const char *json, size_t len, type_
 
 ZITI_FUNC int model_parse_list(model_list *list, const char *json, size_t len, type_meta *meta);
 
+/**
+ * Reusable JSON token storage.
+ * Parse functions without an arena use a per-thread one.
+ */
+typedef struct model_tok_arena_s model_tok_arena;
+
+ZITI_FUNC model_tok_arena *model_tok_arena_new(size_t initial_tokens);
+
+ZITI_FUNC void model_tok_arena_free(model_tok_arena *arena);
+
+ZITI_FUNC int model_parse_with_toks(void *obj, const char *json, size_t len, type_meta *meta, model_tok_arena *arena);
+
+ZITI_FUNC int model_parse_array_with_toks(void ***arp, const char *json, size_t len, type_meta *meta,
+                                           model_tok_arena *arena);
+
+ZITI_FUNC int model_parse_list_with_toks(model_list *list, const char *json, size_t len, type_meta *meta,
+                                          model_tok_arena *arena);
+
+/**
+ * Memory arena for parsed models.
+ * All allocations made while parsing into an arena come from a few large blocks.
+ * Objects parsed into an arena must not be freed with model_free() (or free_<type>() functions),
+ * they stay valid until model_arena_free() releases all of them at once.
+ */
+typedef struct model_arena_s model_arena;
+
+/** [block_size] 0 selects default block size */
+ZITI_FUNC model_arena *model_arena_new(size_t block_size);
+
+ZITI_FUNC void model_arena_free(model_arena *arena);
+
+ZITI_FUNC int model_parse_arena(void *obj, const char *json, size_t len, type_meta *meta, model_arena *arena);
+
+ZITI_FUNC int model_parse_array_arena(void ***arp, const char *json, size_t len, type_meta *meta, model_arena *arena);
+
+ZITI_FUNC int model_parse_list_arena(model_list *list, const char *json, size_t len, type_meta *meta,
+                                     model_arena *arena);
+
 ZITI_FUNC char *model_to_json(const void *obj, const type_meta *meta, int flags, size_t *len);
 
 ZITI_FUNC ssize_t model_to_json_r(const void *obj, const type_meta *meta, int flags, char *outbuf, size_t max);
 
+/**
+ * Write JSON representation of [obj] into caller supplied string buffer.
+ * @return 0 on success, -1 if buffer ran out of space
+ */
+ZITI_FUNC int model_to_json_buf(const void *obj, const type_meta *meta, int flags, string_buf_t *buf);
+
 ZITI_FUNC extern type_meta *get_bool_meta();
 
 ZITI_FUNC extern type_meta *get_int_meta();
@@ -83,12 +83,13 @@ typedef struct ziti_conn *ziti_connection;
 /**
  * @brief Service status callback.
  *
- * This callback is invoked on the conclusion of ziti_service_available(). The result of the function
+ * This callback is invoked on the conclusion of ziti_service_available(), and on changes of services
+ * subscribed to with ziti_service_subscribe(). The result of the function
  * may be an error condition so it is important to verify the status code in this callback. In the
  * event the service does not exist or the identity has not been given the access to the service the
  * #ZITI_SERVICE_UNAVAILABLE error code will be returned otherwise #ZITI_OK is expected.
  *
- * @see ziti_service_available(), ZITI_ERRORS
+ * @see ziti_service_available(), ziti_service_subscribe(), ZITI_ERRORS
  */
 typedef void (*ziti_service_cb)(ziti_context ztx, ziti_service *, int status, void *data);
 
@@ -229,12 +230,80 @@ typedef struct ziti_options_s {
     bool disabled; // if true initial state will be disabled
     const char **config_types;
 
+    // NULL terminated list of service names to subscribe to, only these services are fetched
+    // and refreshed (NULL - all services available to the identity)
+    const char **service_names;
+
     unsigned int api_page_size;
+    unsigned int api_page_window; // max concurrent page requests when fetching lists from controller, default and maximum 4
     long refresh_interval; //the duration in seconds between checking for updates from the controller
     rate_type metrics_type; //an enum describing the metrics to collect
 
     int router_keepalive;
 
+    unsigned int router_connections; // number of parallel TLS connections to each edge router, default 1
+    // connect to this many edge routers with the best known RTT first, a little apart (happy eyeballs),
+    // and to the rest slowly in the background (0 - connect to all at once, the default)
+    unsigned int router_connect_first;
+    unsigned int router_handshake_limit; // max edge router connections being established at once, default 16
+    unsigned int read_buf_size; // size of pooled edge router read buffers
+    unsigned int read_buf_count; // number of read buffers kept for reuse
+    unsigned int max_frame_size; // edge router connection is dropped if it sends a larger message
+    // max received data buffered for a connection that application is not reading,
+    // connection is aborted when exceeded (0 - unbounded, the default)
+    unsigned int conn_recv_window;
+    unsigned int out_msg_pool_cap; // max pooled outbound messages in use at once, per size class
+    // end-to-end encryption and decryption of connections moving more than this many bytes per second
+    // is done on the libuv thread pool, in order, instead of the loop thread (0 - disabled, the default)
+    unsigned int crypto_offload_rate;
+    // memory budget for buffered data, queued writes and pools (bytes, 0 - unlimited, the default),
+    // sampled periodically, over the limit new dials are rejected and reading is paused, see ZitiMemoryEvent
+    size_t memory_limit;
+
+    // directory for warm start cache: api session, services, sessions, and edge routers are saved there
+    // and restored on the next start, while being revalidated with the controller (disabled if NULL)
+    const char *cache_dir;
+
+    // max process posture checks (file hashing) running at once on the thread pool, default 2
+    unsigned int pq_process_jobs;
+
+    // collect posture data when the OS reports a change (network interfaces, process start/exit)
+    // and only poll at a long safety interval for data covered this way, default false
+    bool pq_change_notify;
+
+    // keep aggregated transfer counters and rates per service, see ziti_service_get_transfer_stats()
+    bool service_metrics;
+
+    // connections that transfer nothing for this long (1-2x, milliseconds) release their inbound buffer,
+    // it is allocated again on the next frame in either direction (0 - disabled, the default)
+    unsigned int conn_hibernate_ms;
+
+    // record dial phase timestamps and per-phase latency histograms, see ziti_conn_timings()
+    bool dial_timings;
+
+    // share pools (e2e key pairs, read buffers, outgoing messages) with other contexts on the same loop
+    // that set this option, and fetch controller CA bundle once for those using the same controller and CA.
+    // Pools are sized by options of the first context on the loop. Default false
+    bool share_resources;
+
+    // use AES-256-GCM for end-to-end encryption when this host has AES hardware support (AES-NI, ARMv8 crypto)
+    // and the peer agrees, otherwise XChaCha20-Poly1305 is used. Default false
+    bool e2e_aes_gcm;
+
+    // service changes found by refreshes within this many milliseconds from the first one are reported
+    // in a single ZitiServiceEvent (0 - event is sent after each refresh, the default).
+    // Initial service list is always reported right away
+    unsigned int service_event_window;
+
+    // write backpressure (bytes, 0 - disabled, the default): connection stops being writable when its queued writes
+    // exceed conn_write_high_water, or outbound queue of its edge router connection exceeds channel_write_high_water,
+    // and is writable again once both are down to their low marks (default: half of the high mark),
+    // see ziti_conn_set_writable_cb()
+    size_t conn_write_high_water;
+    size_t conn_write_low_water;
+    size_t channel_write_high_water;
+    size_t channel_write_low_water;
+
     //posture query cbs
     ziti_pq_mac_cb pq_mac_cb;
     ziti_pq_os_cb pq_os_cb;
@@ -262,11 +331,47 @@ typedef struct ziti_enroll_opts_s {
     const char *jwt_content;
 } ziti_enroll_opts;
 
+/**
+ * \brief Edge router load information used for selecting router for new connection.
+ */
+typedef struct ziti_router_load_s {
+    const char *name;
+    const char *url;
+    uint64_t rtt; // smoothed round trip time (ms)
+    uint64_t rtt_var; // round trip time variation (ms)
+    size_t queued_bytes; // outbound data not yet written
+    size_t connections; // active connections
+    int health; // 0-100, from write delay, RTT against the best seen since connect, and unanswered requests
+    bool degraded; // health went low and has not recovered yet, default policy avoids degraded routers
+} ziti_router_load;
+
+/**
+ * \brief Edge router selection policy.
+ *
+ * @param routers array of connected edge routers
+ * @param count number of elements in [routers]
+ * @param ctx policy context
+ * @return index of selected router, default policy is used if return value is out of range
+ */
+typedef int (*ziti_router_select_cb)(const ziti_router_load *routers, int count, void *ctx);
+
 typedef struct ziti_dial_opts_s {
     int connect_timeout_seconds;
     char *identity;
     void *app_data;
     size_t app_data_sz;
+    ziti_router_select_cb router_select; // override default edge router selection
+    void *router_select_ctx;
+    bool datagram; // datagram mode, see #ziti_data_cb
+    bool coalesce_writes; // merge small writes queued in the same loop iteration into one message, see ziti_write()
+    // send writes issued before the dial completes right behind the Connect request instead of waiting for the reply,
+    // saving a round trip for short requests. Ignored for end-to-end encrypted services (crypto needs the reply).
+    // Data sent this way is lost if the dial fails, even though its write callbacks may have already completed.
+    bool early_data;
+    // racing dials: if the Connect is not answered within race_delay_ms another Connect is sent on the next best
+    // connected edge router, the first one to connect is used and the other attempt is closed (0 - disabled).
+    // Ignored with early_data, the data could only go to one of the attempts.
+    int race_delay_ms;
 } ziti_dial_opts;
 
 typedef struct ziti_client_ctx_s {
@@ -288,6 +393,19 @@ typedef struct ziti_listen_opts_s {
     int max_connections;
     char *identity;
     bool bind_using_edge_identity;
+    bool datagram; // accepted connections are in datagram mode, see #ziti_data_cb
+    bool coalesce_writes; // accepted connections coalesce small writes, see ziti_dial_opts.coalesce_writes
+    // adaptive bindings: if max_bindings is set, number of edge routers the service is bound on
+    // follows dial rate and accept latency between min_bindings (default 1) and max_bindings,
+    // and bindings are kept on routers with the lowest round trip time. max_connections is ignored
+    int min_bindings;
+    int max_bindings;
+    // admission control: dials over these limits are rejected right away, client_cb is not called
+    int max_pending; // dials passed to client_cb that are not accepted or closed yet (0 - unlimited)
+    int max_dial_rate; // dials per second (0 - unlimited)
+    int dial_burst; // dials allowed at once over max_dial_rate (default max_dial_rate)
+    // terminator cost is raised by up to load_cost as service gets loaded, see ziti_listen_load()
+    uint16_t load_cost;
 } ziti_listen_opts;
 
 /**
@@ -299,6 +417,10 @@ typedef struct ziti_listen_opts_s {
  * Return value should indicate how much data was consumed by the application. This callback will
  * be called again at some later time and as many times as needed for application to accept the rest.
  *
+ * Connections in datagram mode (see ziti_dial_opts.datagram and ziti_listen_opts.datagram) keep message boundaries:
+ * every ziti_write() or ziti_writev() is sent as one message, and the callback receives one message at a time.
+ * Received data is not buffered, a message that the application does not fully consume is dropped.
+ *
  * @param conn The Ziti connection which received the data
  * @param data incoming data buffer
  * @param length size of data or error code as defined in #ZITI_ERRORS (will receive #ZITI_EOF
@@ -309,6 +431,30 @@ typedef struct ziti_listen_opts_s {
  */
 typedef ssize_t (*ziti_data_cb)(ziti_connection conn, const uint8_t *data, ssize_t length);
 
+/**
+ * @brief Readable callback.
+ *
+ * Invoked in pull mode (see ziti_conn_set_readable_cb()) when new data arrives on the connection.
+ * Application should read it with ziti_conn_read(). The callback is not repeated until more data arrives,
+ * or reading is resumed with ziti_conn_resume_read().
+ *
+ * @param conn The Ziti connection which received the data
+ * @param available number of bytes that can be read
+ */
+typedef void (*ziti_readable_cb)(ziti_connection conn, size_t available);
+
+/**
+ * @brief Writable callback.
+ *
+ * Invoked when connection crosses write backpressure marks (see ziti_options.conn_write_high_water),
+ * with \p writable false when the high mark is crossed (it may be called from ziti_write()), and true when queued data
+ * drained to the low mark. Writes are still accepted while the connection is not writable.
+ *
+ * @param conn The Ziti connection
+ * @param writable
+ */
+typedef void (*ziti_writable_cb)(ziti_connection conn, bool writable);
+
 /**
  * @brief Connection callback.
  * 
@@ -542,6 +688,227 @@ extern const ziti_identity *ziti_get_identity(ziti_context ztx);
 ZITI_FUNC
 extern void ziti_get_transfer_rates(ziti_context ztx, double *up, double *down);
 
+/**
+ * \brief Data transfer counters.
+ */
+typedef struct ziti_transfer_stats_s {
+    uint64_t bytes_up;
+    uint64_t bytes_down;
+    uint64_t msgs_up; // writes
+    uint64_t msgs_down; // received data messages
+    double rate_up; // bytes/second, only reported for services
+    double rate_down; // bytes/second, only reported for services
+} ziti_transfer_stats;
+
+/**
+ * @brief Retrieve data transfer counters of a connection.
+ *
+ * @param conn ziti connection
+ * @param stats receives connection counters
+ * @return ZITI_OK or ZITI_INVALID_STATE if the connection does not transfer data (e.g. server connection)
+ */
+ZITI_FUNC
+extern int ziti_conn_get_transfer_stats(ziti_connection conn, ziti_transfer_stats *stats);
+
+/**
+ * \brief Dial phase timeline of a connection, see ziti_conn_timings().
+ *
+ * Timestamps are milliseconds of the context loop time, zero if the phase was not reached.
+ * If the connection attempt was restarted (e.g. session became invalid) phases show the last attempt.
+ */
+typedef struct ziti_dial_timings_s {
+    uint64_t start; // ziti_dial() was called
+    uint64_t session; // service and dial session are available (from cache or controller)
+    uint64_t channel; // edge router channel is selected and connected
+    uint64_t connected; // edge router replied to the connect request
+    uint64_t established; // end-to-end key exchange completed (same as connected for unencrypted services)
+} ziti_dial_timings;
+
+/**
+ * @brief Retrieve dial phase timestamps of a connection.
+ *
+ * Requires [ziti_options.dial_timings]. Timings are complete when [ziti_conn_cb] of ziti_dial() is called,
+ * and remain available for the life of the connection.
+ * @param conn ziti connection
+ * @return dial timings, or NULL if dial timings are not enabled or connection was not dialed
+ */
+ZITI_FUNC
+extern const ziti_dial_timings *ziti_conn_timings(ziti_connection conn);
+
+/**
+ * @brief Retrieve data transfer counters and rates of a service, aggregated over all its connections
+ * (dialed and accepted).
+ *
+ * Requires [ziti_options.service_metrics]. Rates are calculated with [ziti_options.metrics_type].
+ * @param ztx ziti context
+ * @param service service name
+ * @param stats receives service counters
+ * @return ZITI_OK, ZITI_INVALID_STATE if service metrics are not enabled,
+ *         or ZITI_SERVICE_UNAVAILABLE if service had no connections
+ */
+ZITI_FUNC
+extern int ziti_service_get_transfer_stats(ziti_context ztx, const char *service, ziti_transfer_stats *stats);
+
+/**
+ * @brief Retrieve read buffer pool statistics.
+ *
+ * Reads from edge routers use buffers from a pool sized with [ziti_options.read_buf_count].
+ * @param ztx ziti context
+ * @param hits number of reads served from the pool
+ * @param misses number of reads that required buffer allocation
+ */
+ZITI_FUNC
+extern void ziti_get_read_buf_stats(ziti_context ztx, uint64_t *hits, uint64_t *misses);
+
+/**
+ * @brief Retrieve outbound message pool statistics.
+ *
+ * Outbound messages are allocated from pools bucketed by message size, each capped at
+ * [ziti_options.out_msg_pool_cap] messages in use at once. Per size class details are in ziti_dump() output.
+ * @param ztx ziti context
+ * @param hits number of messages allocated from the pools
+ * @param misses number of messages allocated outside of the pools (pool at capacity or message too large)
+ * @param high_water sum of per size class max number of pooled messages in use at once
+ */
+ZITI_FUNC
+extern void ziti_get_out_msg_stats(ziti_context ztx, uint64_t *hits, uint64_t *misses, size_t *high_water);
+
+/**
+ * \brief Data path counters of a context, counted since the context was created.
+ */
+typedef struct ziti_path_stats_s {
+    uint64_t msgs_framed; // messages parsed from edge router reads
+    uint64_t msgs_framed_in_place; // of those, dispatched without copying out of read buffers
+    uint64_t msgs_data; // dispatched data messages
+    uint64_t msgs_state; // dispatched connection control messages (connect, close, dial, bind, etc)
+    uint64_t msgs_replies; // dispatched replies to requests
+    uint64_t msgs_other; // dispatched channel control and unexpected messages
+    uint64_t bytes_copied; // bytes copied on the data path (frame assembly, write gathering, inbound copies)
+    uint64_t allocs; // heap allocations on the data path (pool misses for write requests and batches, inbound copies)
+    uint64_t read_stalls; // edge router reads paused because inbound message pool was exhausted
+    uint64_t flush_budget_hits; // deliveries to the application that stopped at the per-pass budget
+    uint64_t bridge_writes; // writes to bridged local streams
+    uint64_t bridge_write_chunks; // received chunks carried by those writes, chunks/writes is the coalescing ratio
+    uint64_t dgrams_dropped; // messages dropped by datagram mode connections that were not ready to take them
+    uint64_t dials_shed; // incoming dials rejected by admission control, see ziti_listen_opts.max_pending
+    uint64_t writes_coalesced; // writes sent in a message together with preceding writes, see ziti_dial_opts.coalesce_writes
+    uint64_t crypto_offloaded; // messages encrypted or decrypted on the thread pool, see ziti_options.crypto_offload_rate
+    uint64_t early_writes; // writes sent before the dial completed, see ziti_dial_opts.early_data
+    uint64_t raced_dials; // dials that sent a second Connect, see ziti_dial_opts.race_delay_ms
+    uint64_t race_wins; // of those, dials completed by the second Connect
+    uint64_t conns_hibernated; // idle connections that released their buffers, see ziti_options.conn_hibernate_ms
+    uint64_t conns_woken; // hibernated connections that sent or received data again
+    uint64_t bind_migrations; // bindings moved off degraded edge routers
+    uint64_t e2e_aes_gcm; // end-to-end encrypted streams switched to AES-256-GCM, see ziti_options.e2e_aes_gcm
+    uint64_t write_blocks; // connections that stopped being writable, see ziti_options.conn_write_high_water
+} ziti_path_stats;
+
+/**
+ * @brief Retrieve data path counters.
+ *
+ * Counters are always maintained, they are meant for confirming performance changes in production.
+ * @param ztx ziti context
+ * @param stats receives counters
+ */
+ZITI_FUNC
+extern void ziti_get_path_stats(ziti_context ztx, ziti_path_stats *stats);
+
+/**
+ * \brief Memory held by a ziti context, in bytes.
+ */
+typedef struct ziti_memory_usage_s {
+    size_t channels; // data received from edge routers, not yet processed
+    size_t inbound; // data received on connections, not yet delivered to the application
+    size_t outbound; // writes queued on connections and edge router channels
+    size_t pools; // idle pooled objects: connections, key pairs, messages, read buffers
+    size_t total;
+    size_t limit; // ziti_options.memory_limit
+} ziti_memory_usage;
+
+/**
+ * @brief Retrieve current memory usage.
+ *
+ * Usage is calculated on every call, it is meant for monitoring rather than per-operation checks.
+ * @param ztx ziti context
+ * @param usage receives memory usage by category
+ * @return ZITI_OK or error code
+ */
+ZITI_FUNC
+extern int ziti_get_memory_usage(ziti_context ztx, ziti_memory_usage *usage);
+
+typedef enum {
+    ziti_metric_counter, // monotonic count since the context was created
+    ziti_metric_gauge, // current value
+    ziti_metric_histogram, // latency distribution (milliseconds) since the context was created
+} ziti_metric_type;
+
+/**
+ * \brief Single metric reported to [ziti_metrics_sink].
+ */
+typedef struct ziti_metric_s {
+    const char *name; // e.g. "channel.out_q"
+    const char *label; // qualifier if the metric is reported per entity (channel, service, request lane), or NULL
+    ziti_metric_type type;
+    union {
+        uint64_t counter;
+        double gauge;
+        struct {
+            uint64_t count;
+            uint64_t sum;
+            uint64_t max;
+            uint64_t p50;
+            uint64_t p90;
+            uint64_t p99;
+        } histogram;
+    };
+} ziti_metric;
+
+/**
+ * \brief Metrics sink, called on every metrics tick with a batch of all SDK metrics.
+ *
+ * The batch and its strings are only valid for the duration of the call.
+ */
+typedef void (*ziti_metrics_sink)(ziti_context ztx, const ziti_metric *metrics, size_t count, void *ctx);
+
+/**
+ * @brief Register metrics sink for the context.
+ *
+ * The sink is called from the context loop, at the metrics tick interval, right after rates are updated.
+ * It can be used to export metrics to Prometheus, StatsD, OpenTelemetry, etc.
+ * Metrics reported per service require [ziti_options.service_metrics],
+ * dial phase histograms require [ziti_options.dial_timings].
+ *
+ * @param ztx ziti context
+ * @param sink callback, NULL to unregister current sink
+ * @param ctx passed to every [sink] invocation
+ * @return ZITI_OK
+ */
+ZITI_FUNC
+extern int ziti_set_metrics_sink(ziti_context ztx, ziti_metrics_sink sink, void *ctx);
+
+/**
+ * \brief Round trip time statistics of an edge router connection, in milliseconds.
+ */
+typedef struct ziti_rtt_stats_s {
+    uint64_t min;
+    uint64_t avg;
+    uint64_t p50;
+    uint64_t p99;
+    size_t samples; // number of samples the stats are based on
+} ziti_rtt_stats;
+
+/**
+ * @brief Retrieve round trip time statistics for an edge router.
+ *
+ * Statistics are computed over recent latency probes since the last (re)connect.
+ * @param ztx ziti context
+ * @param router edge router name or URL
+ * @param stats output
+ * @return ZITI_OK, or ZITI_NOT_FOUND if there is no connection to the router
+ */
+ZITI_FUNC
+extern int ziti_get_router_rtt(ziti_context ztx, const char *router, ziti_rtt_stats *stats);
+
 /**
  * @brief Sets connect and write timeouts(in millis).
  *
@@ -570,6 +937,37 @@ extern int ziti_set_timeout(ziti_context ztx, int timeout);
 ZITI_FUNC
 extern int ziti_shutdown(ziti_context ztx);
 
+/**
+ * @brief Callback for ziti_drain().
+ *
+ * @param ztx the Ziti Edge identity context
+ * @param remaining number of connections still open when the drain completed, 0 if all of them closed before the deadline
+ * @param ctx context passed into ziti_drain()
+ */
+typedef void (*ziti_drain_cb)(ziti_context ztx, int remaining, void *ctx);
+
+/**
+ * @brief Gracefully drain Ziti Edge identity context before shutting it down.
+ *
+ * Draining context:
+ * - rejects new dials and binds with #ZITI_DISABLED
+ * - removes terminators of all bound services, and rejects incoming dials
+ * - half-closes (see ziti_close_write()) all established connections, a batch at a time so that the loop stays responsive
+ * - waits until the peers close the connections, or [timeout] expires, and calls [drain_cb]
+ *
+ * Connections are not closed by the drain, application is still expected to ziti_close() them as they complete.
+ * Context remains drained, application would normally call ziti_shutdown() from [drain_cb].
+ *
+ * @param ztx the Ziti Edge identity context
+ * @param timeout max time(in millis) to wait for connections to close
+ * @param drain_cb callback called when all connections are closed, or the timeout expires
+ * @param ctx passed into [drain_cb]
+ *
+ * @return #ZITI_OK or #ZITI_INVALID_STATE if context is already draining or shutting down
+ */
+ZITI_FUNC
+extern int ziti_drain(ziti_context ztx, uint64_t timeout, ziti_drain_cb drain_cb, void *ctx);
+
 /**
  * @brief Shutdown Ziti Edge identity context and reclaim the memory from the provided #ziti_context.
  *
@@ -588,6 +986,22 @@ extern int ziti_shutdown(ziti_context ztx);
 ZITI_FUNC
 extern void ziti_dump(ziti_context ztx, int (*printer)(void *ctx, const char *fmt, ...), void *ctx);
 
+/**
+ * @brief Produce machine-readable (JSON) snapshot of the context internals.
+ *
+ * In addition to the summary provided by ziti_dump(), the snapshot has controller request and dial latency
+ * histograms, pool statistics, per-channel queue depths (`out_q`, `out_q_bytes`), inbound message pool usage,
+ * and per-connection buffered inbound bytes and pending writes.
+ * Building the snapshot does not allocate beyond the output string, it is suitable for periodic scraping.
+ * Must be called on the context loop thread.
+ *
+ * @param ztx the Ziti Edge identity context
+ * @param len (optional) receives length of the output
+ * @return JSON string, caller is responsible for freeing it
+ */
+ZITI_FUNC
+extern char *ziti_dump_json(ziti_context ztx, size_t *len);
+
 ZITI_FUNC
 const char *ziti_get_appdata_raw(ziti_context ztx, const char *key);
 
@@ -658,6 +1072,74 @@ extern void ziti_conn_set_data(ziti_connection conn, void *data);
 ZITI_FUNC
 extern void ziti_conn_set_data_cb(ziti_connection conn, ziti_data_cb cb);
 
+/**
+ * @brief Switch connection to pull mode.
+ *
+ * In pull mode data is not passed to #ziti_data_cb, instead \p cb is invoked when data is available and
+ * application copies data into its own buffers with ziti_conn_read(). #ziti_data_cb is still invoked
+ * to signal EOF and errors, after all received data was read.
+ * Not supported for connections in datagram mode.
+ *
+ * @param conn
+ * @param cb readable callback, or NULL to switch back to push mode
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_conn_set_readable_cb(ziti_connection conn, ziti_readable_cb cb);
+
+/**
+ * @brief Read received data into application buffer.
+ *
+ * @param conn
+ * @param buf destination buffer
+ * @param len size of \p buf
+ * @return number of bytes copied, 0 if no data is available,
+ *         #ZITI_EOF if peer closed the connection and all data was read.
+ */
+ZITI_FUNC
+extern ssize_t ziti_conn_read(ziti_connection conn, uint8_t *buf, size_t len);
+
+/**
+ * @brief Set callback notified about write backpressure.
+ *
+ * Requires [ziti_options.conn_write_high_water] or [ziti_options.channel_write_high_water].
+ *
+ * @param conn
+ * @param cb writable callback, or NULL
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_conn_set_writable_cb(ziti_connection conn, ziti_writable_cb cb);
+
+/**
+ * @brief Number of bytes written by application, and not completed yet.
+ */
+ZITI_FUNC
+extern size_t ziti_conn_write_queue_size(ziti_connection conn);
+
+/**
+ * @brief Check connection write backpressure state.
+ *
+ * @return false if connection is over write high mark (or its edge router connection is), and did not drain yet
+ */
+ZITI_FUNC
+extern bool ziti_conn_is_writable(ziti_connection conn);
+
+/**
+ * @brief Stop delivering received data to application.
+ *
+ * Neither #ziti_data_cb nor #ziti_readable_cb is invoked while reading is paused. Data that was received
+ * can still be read with ziti_conn_read().
+ */
+ZITI_FUNC
+extern int ziti_conn_pause_read(ziti_connection conn);
+
+/**
+ * @brief Resume delivery of received data paused with ziti_conn_pause_read().
+ */
+ZITI_FUNC
+extern int ziti_conn_resume_read(ziti_connection conn);
+
 /**
  * @brief Get the identity of the client that initiated the #ziti_connection.
  *
@@ -683,6 +1165,34 @@ extern const char *ziti_conn_source_identity(ziti_connection conn);
 ZITI_FUNC
 extern int ziti_service_available(ziti_context ztx, const char *service, ziti_service_cb cb, void *ctx);
 
+/**
+ * @brief Subscribes to availability changes of a service.
+ *
+ * [cb] is called with #ZITI_OK when the service becomes available or is changed, and with #ZITI_SERVICE_UNAVAILABLE
+ * when it is removed. If the service is already available [cb] is called before this function returns.
+ * Changes are delivered along with #ZitiServiceEvent (see ziti_options.service_event_window), only for
+ * the services application subscribed to. Callback may unsubscribe itself.
+ *
+ * Must be called on the loop thread, or before ziti_context_run().
+ *
+ * @param ztx the Ziti Edge identity context
+ * @param service service name
+ * @param cb callback
+ * @param ctx passed into [cb]
+ *
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_service_subscribe(ziti_context ztx, const char *service, ziti_service_cb cb, void *ctx);
+
+/**
+ * @brief Removes subscription made with ziti_service_subscribe() with the same [cb] and [ctx].
+ *
+ * @return #ZITI_OK or #ZITI_NOT_FOUND
+ */
+ZITI_FUNC
+extern int ziti_service_unsubscribe(ziti_context ztx, const char *service, ziti_service_cb cb, void *ctx);
+
 ZITI_FUNC
 extern const ziti_service *ziti_service_for_addr_str(ziti_context ztx, ziti_protocol proto, const char *addr, int port);
 
@@ -745,6 +1255,20 @@ ZITI_FUNC
 extern int ziti_listen_with_options(ziti_connection serv_conn, const char *service, ziti_listen_opts *listen_opts,
                                     ziti_listen_cb lcb, ziti_client_cb cb);
 
+/**
+ * @brief Current load of a hosted service.
+ *
+ * Load is based on the admission control limits set in #ziti_listen_opts: the larger of pending dials
+ * relative to `max_pending` and the used part of the `max_dial_rate` burst.
+ * Applications can use it to adjust terminator precedence and cost, or set `ziti_listen_opts.load_cost`
+ * to have terminator cost follow it.
+ *
+ * @param serv_conn server connection
+ * @return load in percent (0-100), 0 if no limits are set, or #ZITI_INVALID_STATE if not a server connection
+ */
+ZITI_FUNC
+extern int ziti_listen_load(ziti_connection serv_conn);
+
 /**
  * @brief Completes client connection.
  *
@@ -828,11 +1352,71 @@ extern int ziti_close_write(ziti_connection conn);
 ZITI_FUNC
 extern int ziti_write(ziti_connection conn, uint8_t *data, size_t length, ziti_write_cb write_cb, void *write_ctx);
 
+/**
+ * @brief Send data from multiple buffers to the connection peer.
+ *
+ * Works like ziti_write(), but gathers data from \p nbufs buffers. Data is sent in segments of bounded size,
+ * so large writes do not require application to split them. Buffers must stay valid until #ziti_write_cb is
+ * invoked; the array of buffers descriptors is copied and can be released immediately.
+ *
+ * @param conn the #ziti_connection used to write data to
+ * @param bufs array of buffers to send
+ * @param nbufs number of buffers in \p bufs
+ * @param write_cb a callback invoked once, after all data was sent
+ * @param write_ctx additional context to be passed to the #ziti_write_cb callback
+ *
+ * @return #ZITI_OK or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_writev(ziti_connection conn, const uv_buf_t bufs[], unsigned int nbufs,
+                       ziti_write_cb write_cb, void *write_ctx);
+
+/**
+ * @brief Allocate a buffer that can be handed over to the SDK with ziti_write_buf().
+ *
+ * Returned buffer has room reserved for message headers and encryption overhead, so data written into it
+ * is sent without extra copies. Connection must be established before the buffer is allocated.
+ *
+ * @param conn connected #ziti_connection
+ * @param len maximum amount of data to be written into the buffer
+ *
+ * @return buffer of \p len bytes or NULL if connection is not connected
+ * @see ziti_write_buf(), ziti_free_write_buf()
+ */
+ZITI_FUNC
+extern uint8_t *ziti_alloc_write_buf(ziti_connection conn, size_t len);
+
+/**
+ * @brief Release buffer allocated with ziti_alloc_write_buf() that will not be written.
+ */
+ZITI_FUNC
+extern void ziti_free_write_buf(ziti_connection conn, uint8_t *buf);
+
+/**
+ * @brief Send data in buffer allocated with ziti_alloc_write_buf().
+ *
+ * Ownership of the buffer is transferred to the SDK (even if an error is returned), application must not
+ * access or free it after this call.
+ *
+ * @param conn the #ziti_connection used to write data to
+ * @param buf buffer obtained from ziti_alloc_write_buf() for the same connection
+ * @param length the length of data in the buffer, must not exceed allocated size
+ * @param write_cb a callback invoked after data is sent
+ * @param write_ctx additional context to be passed to the #ziti_write_cb callback
+ *
+ * @return #ZITI_OK, #ZITI_INVALID_ARGUMENT if \p buf is not an outstanding buffer of \p conn,
+ *         or corresponding #ZITI_ERRORS
+ */
+ZITI_FUNC
+extern int ziti_write_buf(ziti_connection conn, uint8_t *buf, size_t length, ziti_write_cb write_cb, void *write_ctx);
+
 /**
  * @brief Bridge [ziti_connection] to a given IO stream
  *
  * This sets up the connection bridge: all bytes read from ziti_connection are forwarded to the IO stream, and vice a versa.
  * Both ziti_connection and stream have to be established prior to this call.
+ * For streams, data received from ziti during one loop iteration is written with a single write
+ * (see `bridge_writes` and `bridge_write_chunks` in #ziti_path_stats).
  *
  * [on_close] is called after the bridge is terminated and ziti_connection was closed.
  *
@@ -853,10 +1437,28 @@ extern int ziti_conn_bridge(ziti_connection conn, uv_handle_t *handle, uv_close_
 ZITI_FUNC
 extern int ziti_conn_bridge_idle_timeout(ziti_connection conn, unsigned long millis);
 
+/**
+ * set input buffer size limits on bridged stream connection.
+ *
+ * Bridge reads its input in [min_size] buffers, and grows them (up to [max_size]) while reads keep filling them up,
+ * then shrinks them back when traffic slows down. Total size of input buffers in flight stays the same.
+ * Setting [min_size] and [max_size] to the same value disables adaptive sizing.
+ * Default is 32K - 128K. Datagram bridges always use fixed size buffers.
+ * @param conn ziti_connection previously bridged wtih [ziti_conn_bridge] or [ziti_conn_bridge_fds]
+ * @param min_size smallest buffer size, at least 1K
+ * @param max_size largest buffer size, at most 128 times [min_size]
+ * @return 0 on success, error code on failure
+ */
+ZITI_FUNC
+extern int ziti_conn_bridge_buffers(ziti_connection conn, size_t min_size, size_t max_size);
+
 /**
  * @brief Bridge [ziti_connection] to given IO file descriptors.
  *
  * All bytes read from ziti_connection are written to output fd, all bytes read from input fd are sent to ziti_connection.
+ * On Linux, datagram sockets are read and written in batches (recvmmsg/sendmmsg, UDP GSO if supported).
+ * On POSIX systems, regular file input is read on the libuv threadpool directly into message buffers,
+ * without blocking the loop or copying data in user space.
  *
  * @param conn
  * @param input
@@ -33,6 +33,7 @@ typedef enum {
     ZitiServiceEvent = 1 << 2,
     ZitiMfaAuthEvent = 1 << 3,
     ZitiAPIEvent = 1 << 4,
+    ZitiMemoryEvent = 1 << 5,
 } ziti_event_type;
 
 /**
@@ -46,6 +47,7 @@ typedef enum {
     EdgeRouterDisconnected,
     EdgeRouterRemoved,
     EdgeRouterUnavailable,
+    EdgeRouterReconnecting,
 } ziti_router_status;
 
 /**
@@ -62,6 +64,20 @@ struct ziti_api_event {
     const char *new_ctrl_address;
     const char *new_ca_bundle;
 };
+/**
+ * \brief Memory budget event.
+ *
+ * Sent when context memory usage crosses [ziti_options.memory_limit], and when it drops back below it.
+ * While over the limit new dials are rejected with ZITI_MEMORY_LIMIT and reading from edge routers may be paused.
+ *
+ * \see ziti_get_memory_usage()
+ */
+struct ziti_memory_event {
+    bool over_limit;
+    size_t limit;
+    size_t used;
+};
+
 /**
  * \brief Edge Router Event.
  *
@@ -72,6 +88,8 @@ struct ziti_router_event {
     const char *name;
     const char *address;
     const char *version;
+    unsigned int reconnect_attempt; // attempts since last connected
+    uint64_t reconnect_delay; // (ms) before next attempt, set with EdgeRouterReconnecting
 };
 
 /**
@@ -120,6 +138,7 @@ typedef struct ziti_event_s {
         struct ziti_service_event service;
         struct ziti_mfa_auth_event mfa_auth_event;
         struct ziti_api_event api;
+        struct ziti_memory_event memory;
     } event;
 } ziti_event_t;
 
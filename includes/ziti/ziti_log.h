@@ -19,6 +19,7 @@
 #ifndef ZITI_SDK_ZITI_LOG_H
 #define ZITI_SDK_ZITI_LOG_H
 
+#include <stdbool.h>
 #include <uv.h>
 
 #include "externs.h"
@@ -57,14 +58,42 @@ enum DebugLevel {
 #define ZITI_LOG_MODULE NULL
 #endif
 
+// log statements more verbose than ZITI_LOG_MIN_LEVEL are compiled out,
+// set with -DZITI_LOG_MIN_LEVEL=<level> (see ZITI_LOG_MIN_LEVEL CMake option)
+#ifndef ZITI_LOG_MIN_LEVEL
+#define ZITI_LOG_MIN_LEVEL TRACE
+#endif
+
 #define ZITI_LOG(level, fmt, ...) do { \
-if (level <= ziti_log_level(ZITI_LOG_MODULE, __FILENAME__)) { ziti_logger(level, ZITI_LOG_MODULE, __FILENAME__, __LINE__, __func__, fmt, ##__VA_ARGS__); }\
+if (level <= ZITI_LOG_MIN_LEVEL && level <= ziti_log_level(ZITI_LOG_MODULE, __FILENAME__)) { ziti_logger(level, ZITI_LOG_MODULE, __FILENAME__, __LINE__, __func__, fmt, ##__VA_ARGS__); }\
+} while(0)
+
+// rate limited ZITI_LOG: at most [max_per_sec] lines per second are logged from the call site,
+// the number of suppressed lines is reported before the next line that gets through
+#define ZITI_LOG_RATE(level, max_per_sec, fmt, ...) do { \
+if (level <= ZITI_LOG_MIN_LEVEL && level <= ziti_log_level(ZITI_LOG_MODULE, __FILENAME__)) { \
+    static ziti_log_limit ziti_log_site_limit; \
+    unsigned int ziti_log_suppressed; \
+    if (ziti_log_limit_check(&ziti_log_site_limit, (max_per_sec), &ziti_log_suppressed)) { \
+        if (ziti_log_suppressed > 0) { \
+            ziti_logger(level, ZITI_LOG_MODULE, __FILENAME__, __LINE__, __func__, "suppressed %u similar messages", ziti_log_suppressed); \
+        } \
+        ziti_logger(level, ZITI_LOG_MODULE, __FILENAME__, __LINE__, __func__, fmt, ##__VA_ARGS__); \
+    } \
+}\
 } while(0)
 
 #ifdef __cplusplus
 extern "C" {
 #endif
 
+// state of a rate limited log call site, see ZITI_LOG_RATE
+typedef struct ziti_log_limit_s {
+    uint64_t window_start;
+    unsigned int count;
+    unsigned int suppressed;
+} ziti_log_limit;
+
 #if _MSC_VER >= 1400
 # include <sal.h>
 # if _MSC_VER > 1400
@@ -98,12 +127,27 @@ ZITI_FUNC extern void ziti_log_init(uv_loop_t *loop, int level, log_writer logge
 
 ZITI_FUNC extern void ziti_log_set_logger(log_writer logger);
 
+// write log messages from a background thread, so that logging threads do not block on output.
+// messages are queued in a ring of [capacity] records (rounded up to a power of 2), and dropped if the ring is full.
+// capacity = 0 drains queued messages and returns to synchronous logging.
+// can also be enabled with ZITI_LOG_ASYNC=<capacity> environment variable.
+// safe to call while other threads are logging, but not from two threads at once
+// returns 0 or UV error code
+ZITI_FUNC extern int ziti_log_set_async(size_t capacity);
+
+// number of messages dropped by async logging because its ring was full
+ZITI_FUNC extern uint64_t ziti_log_dropped(void);
+
 // use ZITI_LOG_DEFAULT_LEVEL to reset to default(INFO) or ZITI_LOG env var
+// marker is a module, a source file, or a subsystem (channel, connection, controller, posture)
 ZITI_FUNC extern void ziti_log_set_level(int level, const char *marker);
 
 // don't use directly
 ZITI_FUNC extern int ziti_log_level(const char *module, const char *file);
 
+// don't use directly, see ZITI_LOG_RATE
+ZITI_FUNC extern bool ziti_log_limit_check(ziti_log_limit *limit, unsigned int max_per_sec, unsigned int *suppressed);
+
 ZITI_FUNC extern void ziti_log_set_level_by_label(const char *log_level);
 
 ZITI_FUNC extern const char *ziti_log_level_label();
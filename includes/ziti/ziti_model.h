@@ -98,7 +98,8 @@ XX(perm_flags, int, none, NULL, __VA_ARGS__) \
 XX(config, json, map, config, __VA_ARGS__) \
 XX(posture_query_set, ziti_posture_query_set, array, postureQueries, __VA_ARGS__) \
 XX(posture_query_map, ziti_posture_query_set, map, posturePolicies, __VA_ARGS__) \
-XX(updated_at,string, none, updatedAt, __VA_ARGS__)
+XX(updated_at,string, none, updatedAt, __VA_ARGS__) \
+XX(config_cache, ziti_config_cache, ptr, NULL, __VA_ARGS__)
 
 #define ZITI_CLIENT_CFG_V1_MODEL(XX, ...) \
 XX(hostname, ziti_address, none, hostname, __VA_ARGS__) \
@@ -199,6 +200,11 @@ ZITI_FUNC int ziti_address_match_array(const char *addr, ziti_address **range);
 
 DECLARE_MODEL_FUNCS(ziti_address)
 
+/** parsed service configs, see ziti_service_get_config_ref() */
+typedef struct ziti_config_cache_s ziti_config_cache;
+
+ZITI_FUNC type_meta *get_ziti_config_cache_meta();
+
 DECLARE_ENUM(ziti_protocol, ZITI_PROTOCOL_ENUM)
 
 ZITI_FUNC bool ziti_protocol_match(ziti_protocol proto, const model_list *proto_list);
@@ -253,6 +259,22 @@ typedef int (*parse_service_cfg_f)(void *, const char *, size_t);
 ZITI_FUNC int ziti_service_get_config(ziti_service *service, const char *cfg_type, void *cfg,
                                       parse_service_cfg_f parse_func);
 
+/**
+ * @brief Get parsed service config without copying.
+ *
+ * Config is parsed on first access and cached with the service, subsequent calls return the same object.
+ * The returned config is owned by the service and stays valid until the service is freed,
+ * i.e. until the next service update that changes or removes it.
+ *
+ * @param service service
+ * @param cfg_type config type name, e.g. #ZITI_INTERCEPT_CFG_V1
+ * @param meta model type of the config, e.g. `get_ziti_intercept_cfg_v1_meta()`
+ * @param cfg set to parsed config on success
+ * @return #ZITI_OK, #ZITI_CONFIG_NOT_FOUND, or #ZITI_INVALID_CONFIG
+ */
+ZITI_FUNC int ziti_service_get_config_ref(ziti_service *service, const char *cfg_type, type_meta *meta,
+                                          const void **cfg);
+
 ZITI_FUNC int ziti_intercept_from_client_cfg(ziti_intercept_cfg_v1 *intercept, const ziti_client_cfg_v1 *client_cfg);
 
 ZITI_FUNC int
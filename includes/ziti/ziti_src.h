@@ -39,6 +39,50 @@ extern "C" {
  */
 int ziti_src_init(uv_loop_t *l, tlsuv_src_t *zl, const char *svc, ziti_context ztx);
 
+/**
+ * Pool of idle keep-alive ziti connections shared by pooled `ziti_src` sources.
+ *
+ * A pooled source returns its connection to the pool when the HTTP client closes the link,
+ * instead of closing it, and later connects to the same service and target address reuse it without a new dial.
+ * Idle connections are closed when the peer closes them or sends unsolicited data, after [idle_timeout_ms],
+ * and when the per target or total limits are exceeded (least recently used first).
+ *
+ * Only for plain HTTP: a source used for HTTPS carries TLS session state of the client that owned it.
+ */
+typedef struct ziti_src_pool_s ziti_src_pool;
+
+typedef struct ziti_src_pool_opts_s {
+    int max_idle_per_target; // idle connections kept per service and target address (default 4)
+    int max_idle; // idle connections kept by the pool (default 64)
+    uint64_t idle_timeout_ms; // (default 30000)
+} ziti_src_pool_opts;
+
+typedef struct ziti_src_pool_stats_s {
+    uint64_t hits; // connects served with an idle connection
+    uint64_t misses; // connects that dialed
+    uint64_t returned; // connections parked in the pool
+    uint64_t evicted; // idle connections closed for limits, timeout, or failed health check
+    size_t idle; // connections idle right now
+} ziti_src_pool_stats;
+
+/**
+ * Create connection pool, [opts] may be NULL for defaults.
+ */
+ziti_src_pool *ziti_src_pool_new(uv_loop_t *l, ziti_context ztx, const ziti_src_pool_opts *opts);
+
+/**
+ * Initialize a `tlsuv_src_t` handle that takes connections from [pool] and returns them to it.
+ */
+int ziti_src_init_pooled(uv_loop_t *l, tlsuv_src_t *zl, const char *svc, ziti_src_pool *pool);
+
+void ziti_src_pool_get_stats(ziti_src_pool *pool, ziti_src_pool_stats *stats);
+
+/**
+ * Close idle connections and free the pool once its handles are closed.
+ * Sources using the pool must be released before.
+ */
+void ziti_src_pool_free(ziti_src_pool *pool);
+
 #ifdef __cplusplus
 }
 #endif
@@ -21,6 +21,7 @@
 extern "C" {
 #endif
 
+#include <stddef.h>
 #include "externs.h"
 #include "errors.h"
 
@@ -39,10 +40,26 @@ typedef int ziti_socket_t;
  * @brief Initialize Ziti library.
  *
  * Creates a background processing thread for Ziti processing.
+ * Number of processing threads can be set with `ZITI_LIB_LOOPS` environment variable,
+ * see [Ziti_lib_init_loops].
  */
 ZITI_FUNC
 void Ziti_lib_init(void);
 
+/**
+ * @brief Initialize Ziti library with multiple processing threads.
+ *
+ * Each thread runs its own loop. Every loaded context is assigned to one of the loops
+ * (by the hash of its identity location), and that loop handles the context's channels
+ * and all sockets connected or bound through it.
+ * A single context is always processed by one thread, load several identities to spread the load.
+ *
+ * Has no effect if library is already initialized.
+ * @param count number of processing threads, `0` starts one per CPU
+ */
+ZITI_FUNC
+void Ziti_lib_init_loops(int count);
+
 /**
  * @brief return Ziti error code for last failed operation.
  * Use [ziti_errorstr] to get error message.
@@ -91,7 +108,9 @@ int Ziti_close(ziti_socket_t socket);
 /**
  * Check if the given socket handle/fd is attached to a Ziti connection via `Ziti_connect()`/`Ziti_bind()`
  * @param socket
- * @return 0 - not a ziti socket, 1 - connected ziti socket, 2 - ziti server socket
+ * @return 0 - not a ziti socket, 1 - connected ziti socket, 2 - ziti server socket,
+ *         3 - non-blocking connect is in progress,
+ *         -1 - non-blocking connect failed, use [Ziti_last_error()] to get the actual error code
  */
 ZITI_FUNC
 int Ziti_check_socket(ziti_socket_t socket);
@@ -103,6 +122,10 @@ int Ziti_check_socket(ziti_socket_t socket);
  * @param service service name provided by [ztx]
  * @param terminator (optional) specific terminator to connect to
  * @return 0 on success, negative error code on failure
+ *
+ * If [socket] is marked non-blocking, returns -1 right away with [Ziti_last_error()] set to EINPROGRESS.
+ * The socket becomes writable once connection is established; if it fails the socket is hung up,
+ * and [Ziti_check_socket()] reports the error.
  */
 ZITI_FUNC
 int Ziti_connect(ziti_socket_t socket, ziti_context ztx, const char *service, const char *terminator);
@@ -112,7 +135,9 @@ int Ziti_connect(ziti_socket_t socket, ziti_context ztx, const char *service, co
  * @param socket socket handle created with [Ziti_socket()]
  * @param host target hostname
  * @param port target port
- * @return
+ * @return 0 on success, negative error code on failure
+ *
+ * Non-blocking [socket] is connected asynchronously, the same way as with [Ziti_connect()].
  */
 ZITI_FUNC
 int Ziti_connect_addr(ziti_socket_t socket, const char *host, unsigned int port);
@@ -144,6 +169,8 @@ int Ziti_listen(ziti_socket_t socket, int backlog);
  *
  * If no pending connection requests are present, behavior depends on whether [socket] is marked non-blocking.
  * - marked as non-blocking: fails with error code EAGAIN or EWOULDBLOCK.
+ *   Incoming connections are accepted in the background up to the [Ziti_listen()] backlog,
+ *   [socket] becomes readable when one is ready to be picked up.
  * - not marked as non-blocking: blocks until a connection request is present.
  *
  * @param socket socket created with [Ziti_socket()], bound to a service with [Ziti_bind()] or [Ziti_bind_addr()], and is listening after [Ziti_listen()]
@@ -154,6 +181,96 @@ int Ziti_listen(ziti_socket_t socket, int backlog);
 ZITI_FUNC
 ziti_socket_t Ziti_accept(ziti_socket_t socket, char *caller, int caller_len);
 
+/**
+ * @brief client connection accepted with [Ziti_accept_many()]
+ */
+typedef struct ziti_accepted_s {
+    ziti_socket_t socket;
+    char caller[256]; // caller ID (dialing identity name), truncated if longer
+} ziti_accepted;
+
+/**
+ * @brief accept multiple client Ziti connections in one call
+ *
+ * Non-blocking [socket] is readable while clients accepted in the background are ready to be picked up,
+ * this call takes up to [count] of them at once, and fails with EAGAIN or EWOULDBLOCK if there are none.
+ * On a blocking [socket] it waits for one client, the same way as [Ziti_accept()].
+ *
+ * @param socket socket created with [Ziti_socket()], bound to a service, and listening after [Ziti_listen()]
+ * @param out array to store accepted connections
+ * @param count number of elements in [out]
+ * @return number of accepted connections, or -1 on error, use [Ziti_last_error()] to get actual error code.
+ */
+ZITI_FUNC
+int Ziti_accept_many(ziti_socket_t socket, ziti_accepted out[], int count);
+
+/**
+ * @brief Ziti connection accessed directly, without a socket.
+ *
+ * Data is exchanged with the Ziti processing thread through in-memory rings, so it does not go through
+ * the kernel twice the way bridged [Ziti_socket()] connections do.
+ * A stream can be read by one thread and written by another, but not read (or written) by two threads at once.
+ *
+ * Not available on Windows.
+ */
+typedef struct ziti_stream_s *ziti_stream;
+
+/**
+ * @brief Connect a stream to a Ziti service
+ * @param ztx Ziti context
+ * @param service service name provided by [ztx]
+ * @param terminator (optional) specific terminator to connect to
+ * @return stream handle, or NULL on failure -- use [Ziti_last_error()] to get the actual error code.
+ */
+ZITI_FUNC
+ziti_stream Ziti_stream_connect(ziti_context ztx, const char *service, const char *terminator);
+
+/**
+ * @brief read data from the stream
+ *
+ * Blocks until some data is available, unless stream was made non-blocking with [Ziti_stream_set_nonblocking()].
+ * @return number of bytes read, 0 if peer closed the connection,
+ *         -1 on error (EWOULDBLOCK for non-blocking stream), use [Ziti_last_error()] to get actual error code.
+ */
+ZITI_FUNC
+long Ziti_stream_read(ziti_stream stream, void *buf, size_t len);
+
+/**
+ * @brief write data to the stream
+ *
+ * Blocks until at least some data can be written, unless stream was made non-blocking.
+ * @return number of bytes written (may be less than [len]), -1 on error, use [Ziti_last_error()] to get actual error code.
+ */
+ZITI_FUNC
+long Ziti_stream_write(ziti_stream stream, const void *buf, size_t len);
+
+/**
+ * @brief set stream non-blocking mode
+ */
+ZITI_FUNC
+int Ziti_stream_set_nonblocking(ziti_stream stream, int nonblocking);
+
+/**
+ * @brief file descriptor to wait on with poll()/select()
+ *
+ * The descriptor becomes readable once a non-blocking [Ziti_stream_read()] or [Ziti_stream_write()] that failed
+ * with EWOULDBLOCK can make progress. It must not be read or closed by application.
+ */
+ZITI_FUNC
+int Ziti_stream_fd(ziti_stream stream);
+
+/**
+ * @brief close the write side of the stream, after all written data is sent.
+ */
+ZITI_FUNC
+int Ziti_stream_shutdown(ziti_stream stream);
+
+/**
+ * @brief close the stream. Stream handle must not be used after this call.
+ */
+ZITI_FUNC
+int Ziti_stream_close(ziti_stream stream);
+
 /**
  * @brief Shutdown Ziti library.
  *
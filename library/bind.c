@@ -14,6 +14,7 @@
 
 
 #include <assert.h>
+#include <inttypes.h>
 #include "ziti/ziti.h"
 #include "endian_internal.h"
 #include "win32_compat.h"
@@ -26,6 +27,25 @@
 #define REBIND_DELAY 1000
 #define REFRESH_DELAY (60 * 5 * 1000)
 
+// adaptive bindings
+#define BIND_SCALE_INTERVAL (10 * 1000)
+#define BIND_SCALE_UP_RATE 10 // dials per second per binding
+#define BIND_SCALE_UP_LATENCY 250 // average accept latency (ms)
+#define BIND_IDLE_CHECKS 6 // idle intervals before a binding is dropped
+// bindings are moved off routers with RTT worse than BIND_RTT_FACTOR * best + BIND_RTT_MARGIN (ms)
+#define BIND_RTT_FACTOR 2
+#define BIND_RTT_MARGIN 20
+
+// bindings on degraded routers are checked for migration this often
+#define BIND_HEALTH_INTERVAL (5 * 1000)
+
+// connections kept ready for incoming dials once service is bound
+#define BIND_CONN_POOL 32
+
+// terminator cost follows load in BIND_LOAD_STEP (%) steps, updated at most every BIND_LOAD_INTERVAL
+#define BIND_LOAD_STEP 10
+#define BIND_LOAD_INTERVAL 1000
+
 #define CONN_LOG(lvl, fmt, ...) ZITI_LOG(lvl, "server[%u.%u] " fmt, conn->ziti_ctx->id, conn->conn_id, ##__VA_ARGS__)
 
 struct binding_s {
@@ -33,7 +53,20 @@ struct binding_s {
     ziti_channel_t *ch;
     struct key_pair key_pair;
     bool bound;
+    bool unbinding;
     struct waiter_s *waiter;
+
+    // make-before-break migration off a degraded router: new binding [replaces] the old one,
+    // old one is unbound once its [replacement] is bound
+    struct binding_s *replaces;
+    struct binding_s *replacement;
+};
+
+struct bind_candidate_s {
+    const char *url;
+    ziti_channel_t *ch;
+    uint64_t rtt; // 0 if not known yet
+    bool degraded;
 };
 
 
@@ -55,22 +88,31 @@ static void session_cb(ziti_net_session *session, const ziti_error *err, void *c
 
 static void notify_status(struct ziti_conn *conn, int err);
 
+static void update_load(struct ziti_conn *conn);
+
 int ziti_bind(ziti_connection conn, const char *service, const ziti_listen_opts *listen_opts,
               ziti_listen_cb listen_cb, ziti_client_cb on_clt_cb) {
 
     assert(conn->type == None);
     assert(conn->ziti_ctx != NULL);
 
-    if (!conn->ziti_ctx->enabled) return ZITI_DISABLED;
+    if (!conn->ziti_ctx->enabled || conn->ziti_ctx->draining) return ZITI_DISABLED;
 
     conn->type = Server;
     conn->disposer = dispose;
-    conn->service = strdup(service);
+    conn->service = str_intern_get(&conn->ziti_ctx->strings, service);
+    conn->svc_xfer = ziti_service_xfer(conn->ziti_ctx, service);
     uv_random(NULL, NULL, conn->server.listener_id, sizeof(conn->server.listener_id), 0 , NULL);
     conn->server.cost = get_terminator_cost(listen_opts, service, conn->ziti_ctx);
     conn->server.precedence = get_terminator_precedence(listen_opts, service, conn->ziti_ctx);
     conn->server.max_bindings = listen_opts && listen_opts->max_connections > 0 ?
                                 listen_opts->max_connections : DEFAULT_MAX_BINDINGS;
+    if (listen_opts && listen_opts->max_bindings > 0) {
+        conn->server.adaptive = true;
+        conn->server.max_bindings = listen_opts->max_bindings;
+        conn->server.min_bindings = MAX(1, MIN(listen_opts->min_bindings, listen_opts->max_bindings));
+        conn->server.target_bindings = conn->server.min_bindings;
+    }
     conn->server.timer = calloc(1, sizeof(uv_timer_t));
     conn->server.timer->data = conn;
     uv_timer_init(conn->ziti_ctx->loop, conn->server.timer);
@@ -81,7 +123,17 @@ int ziti_bind(ziti_connection conn, const char *service, const ziti_listen_opts
         } else if (listen_opts->identity) {
             conn->server.identity = strdup(listen_opts->identity);
         }
+
+        conn->server.max_pending = MAX(0, listen_opts->max_pending);
+        conn->server.dial_rate = MAX(0, listen_opts->max_dial_rate);
+        conn->server.dial_burst = listen_opts->dial_burst > 0 ? listen_opts->dial_burst : conn->server.dial_rate;
+        conn->server.dial_tokens = (uint64_t) conn->server.dial_burst * 1000;
+        conn->server.dial_tokens_ts = uv_now(conn->ziti_ctx->loop);
+        conn->server.load_cost = listen_opts->load_cost;
     }
+    conn->server.cost_sent = conn->server.cost;
+    conn->datagram = listen_opts && listen_opts->datagram;
+    conn->coalesce = listen_opts && listen_opts->coalesce_writes && !conn->datagram;
     conn->server.listen_cb = listen_cb;
     conn->server.client_cb = on_clt_cb;
 
@@ -104,51 +156,434 @@ static void rebind_delay_cb(uv_timer_t *t) {
 static struct binding_s* new_binding(struct ziti_conn *conn) {
     NEWP(b, struct binding_s);
     b->conn = conn;
-    init_key_pair(&b->key_pair);
+    key_pool_get(conn->ziti_ctx->keys, &b->key_pair);
     return b;
 }
 
-static void process_bindings(struct ziti_conn *conn) {
+static int cmp_candidate(const void *a, const void *b) {
+    const struct bind_candidate_s *lc = a;
+    const struct bind_candidate_s *rc = b;
+    // degraded routers go last
+    if (lc->degraded != rc->degraded) {
+        return lc->degraded ? 1 : -1;
+    }
+    // then routers with unknown RTT
+    uint64_t l = lc->rtt - 1;
+    uint64_t r = rc->rtt - 1;
+    return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+/**
+ * adaptive mode: keeps [target_bindings] bindings on connected routers with the lowest RTT.
+ * existing bindings stay where they are unless their router's RTT is far off the best one.
+ * @return number of bindings still missing
+ */
+static size_t balance_bindings(struct ziti_conn *conn) {
     ziti_net_session *ns = conn->server.session;
     struct ziti_ctx *ztx = conn->ziti_ctx;
 
-    size_t target = MIN(conn->server.max_bindings, model_map_size(&ztx->channels));
-
     ziti_edge_router *er;
-    const char *proto;
+    __attribute__((unused)) const char *proto;
     const char *url;
+    size_t count = 0;
+    MODEL_LIST_FOREACH(er, ns->edge_routers) {
+        count += model_map_size(&er->protocols);
+    }
+
+    struct bind_candidate_s *cand = calloc(count > 0 ? count : 1, sizeof(*cand));
+    size_t n = 0;
     MODEL_LIST_FOREACH(er, ns->edge_routers) {
         MODEL_MAP_FOREACH(proto, url, &er->protocols) {
-            CONN_LOG(DEBUG, "checking %s[%s]", er->name, url);
             ziti_channel_t *ch = model_map_get(&ztx->channels, url);
             if (ch == NULL || !ziti_channel_is_connected(ch)) {
-                CONN_LOG(DEBUG, "%s[%s] is not connected", er->name, url);
                 continue;
             }
+            ziti_router_load load;
+            ziti_channel_load(ch, &load);
+            cand[n++] = (struct bind_candidate_s) {.url = url, .ch = ch, .rtt = load.rtt, .degraded = load.degraded};
+        }
+    }
+    qsort(cand, n, sizeof(*cand), cmp_candidate);
+
+    size_t target = MIN((size_t) conn->server.target_bindings, model_map_size(&ztx->channels));
+    uint64_t max_rtt = n > 0 && cand[0].rtt > 0 ? cand[0].rtt * BIND_RTT_FACTOR + BIND_RTT_MARGIN : UINT64_MAX;
+
+    size_t active = 0;
+    for (size_t i = 0; i < n; i++) {
+        struct binding_s *b = model_map_get(&conn->server.bindings, cand[i].url);
+        if (b == NULL || b->ch != cand[i].ch || b->unbinding || !(b->bound || b->waiter)) {
+            continue;
+        }
+
+        if (active < target && cand[i].rtt <= max_rtt) {
+            active++;
+        } else {
+            CONN_LOG(DEBUG, "dropping binding[%s] rtt[%" PRIu64 "ms] target[%zu]", cand[i].url, cand[i].rtt, target);
+            stop_binding(b);
+        }
+    }
+
+    for (size_t i = 0; i < n && active < target; i++) {
+        struct binding_s *b = model_map_get(&conn->server.bindings, cand[i].url);
+        if (b == NULL) {
+            b = new_binding(conn);
+            model_map_set(&conn->server.bindings, cand[i].url, b);
+        } else if (b->bound || b->waiter) {
+            continue; // kept above, or still unbinding
+        }
+        CONN_LOG(DEBUG, "adding binding[%s] rtt[%" PRIu64 "ms]", cand[i].url, cand[i].rtt);
+        start_binding(b, cand[i].ch);
+        active++;
+    }
+    free(cand);
+
+    return target - active;
+}
+
+static void on_scale_check(wheel_timer_t *t) {
+    struct ziti_conn *conn = t->data;
+    int target = conn->server.target_bindings;
+    unsigned int dials = conn->server.dials;
+    uint64_t latency = conn->server.accepts ? conn->server.accept_latency / conn->server.accepts : 0;
+
+    bool busy = dials >= (unsigned int) (BIND_SCALE_UP_RATE * (BIND_SCALE_INTERVAL / 1000) * target) ||
+                latency > BIND_SCALE_UP_LATENCY;
+    if (busy) {
+        conn->server.idle_checks = 0;
+        target = MIN(target + 1, conn->server.max_bindings);
+    } else if (dials == 0) {
+        if (++conn->server.idle_checks >= BIND_IDLE_CHECKS) {
+            conn->server.idle_checks = 0;
+            target = MAX(target - 1, conn->server.min_bindings);
+        }
+    } else {
+        conn->server.idle_checks = 0;
+    }
+
+    if (target != conn->server.target_bindings) {
+        CONN_LOG(INFO, "scaling bindings %d => %d (dials[%u] accept latency[%" PRIu64 "ms])",
+                 conn->server.target_bindings, target, dials, latency);
+        conn->server.target_bindings = target;
+    }
+    conn->server.dials = 0;
+    conn->server.accepts = 0;
+    conn->server.accept_latency = 0;
+
+    if (conn->server.session) {
+        balance_bindings(conn);
+    }
+    wheel_timer_start(&conn->ziti_ctx->timers, &conn->server.scale_timer, BIND_SCALE_INTERVAL, on_scale_check, conn);
+}
+
+void ziti_server_accepted(struct ziti_conn *server, uint64_t latency) {
+    if (server->type == Server) {
+        server->server.accepts++;
+        server->server.accept_latency += latency;
+    }
+}
+
+void ziti_server_pending_done(struct ziti_conn *client) {
+    if (!client->accept_pending) {
+        return;
+    }
+    client->accept_pending = false;
+    client->parent->server.pending--;
+    update_load(client->parent);
+}
+
+static void refill_dial_tokens(struct ziti_conn *conn) {
+    uint64_t now = uv_now(conn->ziti_ctx->loop);
+    uint64_t max = (uint64_t) conn->server.dial_burst * 1000;
+    conn->server.dial_tokens = MIN(max, conn->server.dial_tokens +
+                                        (now - conn->server.dial_tokens_ts) * conn->server.dial_rate);
+    conn->server.dial_tokens_ts = now;
+}
+
+static int server_load(struct ziti_conn *conn) {
+    int load = 0;
+    if (conn->server.max_pending > 0) {
+        load = MIN(100, conn->server.pending * 100 / conn->server.max_pending);
+    }
+    if (conn->server.dial_rate > 0) {
+        refill_dial_tokens(conn);
+        uint64_t max = (uint64_t) conn->server.dial_burst * 1000;
+        load = MAX(load, (int) ((max - conn->server.dial_tokens) * 100 / max));
+    }
+    return load;
+}
+
+int ziti_listen_load(ziti_connection conn) {
+    if (conn == NULL || conn->type != Server) {
+        return ZITI_INVALID_STATE;
+    }
+    return server_load(conn);
+}
+
+// reason for rejection, or NULL if dial is admitted
+static const char *admit_dial(struct ziti_conn *conn) {
+    if (conn->ziti_ctx->draining) {
+        return "service is shutting down";
+    }
+
+    if (conn->ziti_ctx->mem_over) {
+        return "service overloaded: memory limit reached";
+    }
+
+    if (conn->server.max_pending > 0 && conn->server.pending >= conn->server.max_pending) {
+        return "service overloaded: too many pending connections";
+    }
+
+    if (conn->server.dial_rate > 0) {
+        refill_dial_tokens(conn);
+        if (conn->server.dial_tokens < 1000) {
+            return "service overloaded: dial rate exceeded";
+        }
+        conn->server.dial_tokens -= 1000;
+    }
+    return NULL;
+}
+
+static uint16_t load_terminator_cost(struct ziti_conn *conn) {
+    int load = server_load(conn) / BIND_LOAD_STEP * BIND_LOAD_STEP;
+    return (uint16_t) MIN(UINT16_MAX, conn->server.cost + conn->server.load_cost * load / 100);
+}
+
+static void send_cost_update(struct ziti_conn *conn, uint16_t cost) {
+    ziti_net_session *s = conn->server.session;
+    if (s == NULL) {
+        return;
+    }
+
+    CONN_LOG(DEBUG, "updating terminator cost %u => %u", conn->server.cost_sent, cost);
+    conn->server.cost_sent = cost;
+
+    int32_t conn_id = htole32(conn->conn_id);
+    uint16_t cost_le = htole16(cost);
+    hdr_t headers[] = {
+            {
+                    .header_id = ConnIdHeader,
+                    .length = sizeof(conn_id),
+                    .value = (uint8_t *) &conn_id
+            },
+            {
+                    .header_id = CostHeader,
+                    .length = sizeof(cost_le),
+                    .value = (uint8_t *) &cost_le
+            },
+    };
+
+    __attribute__((unused)) const char *url;
+    struct binding_s *b;
+    MODEL_MAP_FOREACH(url, b, &conn->server.bindings) {
+        if (b->bound && ziti_channel_is_connected(b->ch)) {
+            ziti_channel_send(b->ch, ContentTypeUpdateBind, headers, 2,
+                              (const uint8_t *) s->token, strlen(s->token), NULL);
+        }
+    }
+}
+
+static void on_load_check(wheel_timer_t *t) {
+    struct ziti_conn *conn = t->data;
+    uint16_t cost = load_terminator_cost(conn);
+    if (cost != conn->server.cost_sent) {
+        send_cost_update(conn, cost);
+    }
+
+    // keep checking until cost is back to normal, load decays without any dial or accept events
+    if (conn->server.cost_sent != conn->server.cost) {
+        wheel_timer_start(&conn->ziti_ctx->timers, &conn->server.load_timer, BIND_LOAD_INTERVAL,
+                          on_load_check, conn);
+    }
+}
+
+static void update_load(struct ziti_conn *conn) {
+    if (conn->server.load_cost == 0 || wheel_timer_is_active(&conn->server.load_timer)) {
+        return;
+    }
+
+    uint16_t cost = load_terminator_cost(conn);
+    if (cost != conn->server.cost_sent) {
+        send_cost_update(conn, cost);
+        wheel_timer_start(&conn->ziti_ctx->timers, &conn->server.load_timer, BIND_LOAD_INTERVAL,
+                          on_load_check, conn);
+    }
+}
+
+static void unlink_migration(struct binding_s *b) {
+    if (b->replaces) {
+        b->replaces->replacement = NULL;
+        b->replaces = NULL;
+    }
+    if (b->replacement) {
+        b->replacement->replaces = NULL;
+        b->replacement = NULL;
+    }
+}
 
+static bool can_migrate(struct binding_s *b) {
+    return b->bound && !b->unbinding && b->replacement == NULL && b->replaces == NULL &&
+           ziti_channel_is_degraded(b->ch);
+}
+
+// connected healthy router without a binding, best health first
+static ziti_channel_t *healthiest_free_router(struct ziti_conn *conn, const char **url_out) {
+    ziti_net_session *ns = conn->server.session;
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+
+    ziti_channel_t *best = NULL;
+    int best_health = -1;
+    ziti_edge_router *er;
+    __attribute__((unused)) const char *proto;
+    const char *url;
+    MODEL_LIST_FOREACH(er, ns->edge_routers) {
+        MODEL_MAP_FOREACH(proto, url, &er->protocols) {
+            ziti_channel_t *ch = model_map_get(&ztx->channels, url);
+            if (ch == NULL || !ziti_channel_is_connected(ch) || ziti_channel_is_degraded(ch)) {
+                continue;
+            }
             struct binding_s *b = model_map_get(&conn->server.bindings, url);
-            if (b != NULL) {
-                if (b->bound) {
-                    target--;
-                } else {
+            if (b != NULL && (b->bound || b->waiter)) {
+                continue;
+            }
+            int health = ziti_channel_health(ch);
+            if (health > best_health) {
+                best = ch;
+                best_health = health;
+                *url_out = url;
+            }
+        }
+    }
+    return best;
+}
+
+/**
+ * make-before-break: a binding on a degraded router gets a replacement on the healthiest connected router
+ * without one, the old binding is stopped after the replacement is bound (see bind_reply_cb()).
+ * Bindings stay where they are if there is no healthy router to move to.
+ */
+static void migrate_bindings(struct ziti_conn *conn) {
+    if (conn->server.session == NULL) {
+        return;
+    }
+
+    __attribute__((unused)) const char *url;
+    struct binding_s *b;
+    size_t count = 0;
+    MODEL_MAP_FOREACH(url, b, &conn->server.bindings) {
+        count += can_migrate(b);
+    }
+    if (count == 0) {
+        return;
+    }
+
+    // bindings map is not changed while iterating
+    struct binding_s **moving = calloc(count, sizeof(*moving));
+    size_t n = 0;
+    MODEL_MAP_FOREACH(url, b, &conn->server.bindings) {
+        if (n < count && can_migrate(b)) {
+            moving[n++] = b;
+        }
+    }
+
+    for (size_t i = 0; i < n; i++) {
+        b = moving[i];
+        const char *new_url = NULL;
+        ziti_channel_t *ch = healthiest_free_router(conn, &new_url);
+        if (ch == NULL) {
+            CONN_LOG(DEBUG, "binding[%s] is on degraded router, no healthy router to move to", b->ch->url);
+            break;
+        }
+
+        struct binding_s *nb = model_map_get(&conn->server.bindings, new_url);
+        if (nb == NULL) {
+            nb = new_binding(conn);
+            model_map_set(&conn->server.bindings, new_url, nb);
+        }
+        CONN_LOG(INFO, "moving binding[%s] off degraded router to [%s]", b->ch->url, new_url);
+        nb->replaces = b;
+        b->replacement = nb;
+        start_binding(nb, ch);
+    }
+    free(moving);
+}
+
+static void on_health_check(wheel_timer_t *t) {
+    struct ziti_conn *conn = t->data;
+    migrate_bindings(conn);
+    wheel_timer_start(&conn->ziti_ctx->timers, &conn->server.health_timer, BIND_HEALTH_INTERVAL,
+                      on_health_check, conn);
+}
+
+static void process_bindings(struct ziti_conn *conn) {
+    ziti_net_session *ns = conn->server.session;
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+
+    // drained server stays unbound, see ziti_drain()
+    if (ztx->draining) {
+        return;
+    }
+
+    if (!wheel_timer_is_active(&conn->server.health_timer)) {
+        wheel_timer_start(&ztx->timers, &conn->server.health_timer, BIND_HEALTH_INTERVAL, on_health_check, conn);
+    }
+
+    if (conn->server.adaptive) {
+        size_t missing = balance_bindings(conn);
+        if (!wheel_timer_is_active(&conn->server.scale_timer)) {
+            wheel_timer_start(&ztx->timers, &conn->server.scale_timer, BIND_SCALE_INTERVAL, on_scale_check, conn);
+        }
+        schedule_rebind(conn, missing > 0);
+        return;
+    }
+
+    size_t target = MIN(conn->server.max_bindings, model_map_size(&ztx->channels));
+
+    ziti_edge_router *er;
+    const char *proto;
+    const char *url;
+    // new bindings go to healthy routers first, degraded ones are only used if there are not enough of them
+    for (int pass = 0; pass < 2 && target > 0; pass++) {
+        MODEL_LIST_FOREACH(er, ns->edge_routers) {
+            MODEL_MAP_FOREACH(proto, url, &er->protocols) {
+                ziti_channel_t *ch = model_map_get(&ztx->channels, url);
+                if (ch == NULL || !ziti_channel_is_connected(ch)) {
+                    if (pass == 0) {
+                        CONN_LOG(DEBUG, "%s[%s] is not connected", er->name, url);
+                    }
+                    continue;
+                }
+
+                // first pass: healthy routers and existing bindings, second pass: the rest of degraded routers
+                struct binding_s *b = model_map_get(&conn->server.bindings, url);
+                bool first_pass = !ziti_channel_is_degraded(ch) || (b != NULL && b->bound);
+                if (first_pass != (pass == 0)) {
+                    continue;
+                }
+                CONN_LOG(DEBUG, "checking %s[%s]", er->name, url);
+
+                if (b != NULL) {
+                    if (b->bound) {
+                        target--;
+                    } else {
+                        start_binding(b, ch);
+                        target--;
+                    }
+                } else  {
+                    b = new_binding(conn);
+                    model_map_set(&conn->server.bindings, url, b);
                     start_binding(b, ch);
                     target--;
                 }
-            } else  {
-                b = new_binding(conn);
-                model_map_set(&conn->server.bindings, url, b);
-                start_binding(b, ch);
-                target--;
             }
+            if (target <= 0) break;
         }
-        if (target <= 0) break;
     }
 
     schedule_rebind(conn, target > 0);
 }
 
 static void schedule_rebind(struct ziti_conn *conn, bool now) {
-    if (!ziti_is_enabled(conn->ziti_ctx)) {
+    if (!ziti_is_enabled(conn->ziti_ctx) || conn->ziti_ctx->draining) {
         uv_timer_stop(conn->server.timer);
         return;
     }
@@ -261,11 +696,15 @@ static uint8_t get_terminator_precedence(const ziti_listen_opts *opts, const cha
 
 static int dispose(ziti_connection server) {
     assert(server->type == Server);
+    wheel_timer_stop(&server->server.scale_timer);
+    wheel_timer_stop(&server->server.load_timer);
+    wheel_timer_stop(&server->server.health_timer);
 
     model_map_iter it = model_map_iterator(&server->server.bindings);
     while(it) {
         struct binding_s *b = model_map_it_value(it);
         if (!b->bound && b->waiter == NULL) {
+            unlink_migration(b);
             it = model_map_it_remove(it);
             free(b);
         } else {
@@ -290,7 +729,7 @@ static int dispose(ziti_connection server) {
     }
 
     free_ziti_net_session_ptr(server->server.session);
-    free(server->service);
+    str_intern_release(&server->ziti_ctx->strings, server->service);
     free(server);
     return 1;
 }
@@ -308,13 +747,20 @@ static void process_dial(struct binding_s *b, message *msg) {
         return;
     }
 
-    ziti_connection client;
-    ziti_conn_init(conn->ziti_ctx, &client, NULL);
-    init_transport_conn(client);
+    const char *overload = admit_dial(conn);
+    if (overload) {
+        CONN_LOG(VERBOSE, "rejecting dial: %s", overload);
+        conn->ziti_ctx->path_stats.dials_shed++;
+        reject_dial_request(0, b->ch, msg->header.seq, overload);
+        update_load(conn);
+        return;
+    }
+
+    ziti_connection client = conn_pool_get(conn->ziti_ctx);
 
     if (peer_key_sent) {
         client->encrypted = true;
-        if (init_crypto(&client->key_ex, &b->key_pair, peer_key, true) != 0) {
+        if (init_crypto(&conn_crypto_init(client)->keys->key_ex, &b->key_pair, peer_key, true) != 0) {
             reject_dial_request(0, b->ch, msg->header.seq, "failed to establish crypto");
             ziti_close(client, NULL);
             return;
@@ -323,7 +769,15 @@ static void process_dial(struct binding_s *b, message *msg) {
     client->state = Accepting;
     client->channel = b->ch;
     client->parent = conn;
+    client->svc_xfer = conn->svc_xfer;
+    client->datagram = conn->datagram;
+    client->coalesce = conn->coalesce;
+    client->accept_start = uv_now(conn->ziti_ctx->loop);
+    conn->server.dials++;
     model_map_setl(&conn->server.children, (long) client->conn_id, client);
+    client->accept_pending = true;
+    conn->server.pending++;
+    update_load(conn);
 
     client->dial_req_seq = msg->header.seq;
     uint8_t *source_identity = NULL;
@@ -376,14 +830,25 @@ static void bind_reply_cb(void *ctx, message *msg, int code) {
     struct ziti_conn *conn = b->conn;
 
     b->waiter = NULL;
-    CONN_LOG(TRACE, "received msg ct[%X] code[%d]", msg->header.content, code);
+    CONN_LOG(TRACE, "received msg ct[%X] code[%d]", msg ? msg->header.content : 0, code);
     if (code == ZITI_OK && msg->header.content == ContentTypeStateConnected) {
         CONN_LOG(DEBUG, "bound successfully over ch[%s]", b->ch->url);
+        conn_pool_warm(conn->ziti_ctx, BIND_CONN_POOL);
         ziti_channel_add_receiver(b->ch, (int)conn->conn_id, b,
                                   (void (*)(void *, message *, int)) on_message);
         b->bound = true;
+
+        struct binding_s *old = b->replaces;
+        if (old) {
+            unlink_migration(b);
+            CONN_LOG(INFO, "binding moved from degraded router[%s] to [%s]", old->ch ? old->ch->url : "<none>",
+                     b->ch->url);
+            conn->ziti_ctx->path_stats.bind_migrations++;
+            stop_binding(old);
+        }
     } else {
         CONN_LOG(DEBUG, "failed to bind over ch[%s]", b->ch->url);
+        unlink_migration(b);
         b->bound = false;
         ziti_channel_rem_receiver(b->ch, conn->conn_id);
         b->ch = NULL;
@@ -396,6 +861,7 @@ void start_binding(struct binding_s *b, ziti_channel_t *ch) {
     CONN_LOG(TRACE, "ch[%d] => Edge Bind request token[%s]", ch->id, s->token);
 
     b->ch = ch;
+    b->unbinding = false;
 
     int32_t conn_id = htole32(conn->conn_id);
     int32_t msg_seq = htole32(0);
@@ -446,8 +912,8 @@ void start_binding(struct binding_s *b, ziti_channel_t *ch) {
         nheaders++;
     }
 
-    if (conn->server.cost > 0) {
-        uint16_t cost = htole16(conn->server.cost);
+    if (conn->server.cost_sent > 0) {
+        uint16_t cost = htole16(conn->server.cost_sent);
         headers[nheaders].header_id = CostHeader;
         headers[nheaders].value = (uint8_t *) &cost;
         headers[nheaders].length = sizeof(cost);
@@ -487,17 +953,19 @@ void on_unbind(void *ctx, message *m, int code) {
                         .value = (uint8_t *) &conn_id
                 },
         };
-        message *close_msg = message_new(NULL, ContentTypeStateClosed, headers, 1, 0);
+        message *close_msg = message_new_out(b->conn->ziti_ctx->out_msgs, ContentTypeStateClosed, headers, 1, 0);
         ziti_channel_send_message(b->ch, close_msg, NULL);
     } else {
         CONN_LOG(TRACE, "failed to receive unbind response because channel was disconnected: %d/%s", code, ziti_errorstr(code));
     }
     ziti_channel_rem_receiver(b->ch, b->conn->conn_id);
     b->bound = false;
+    b->unbinding = false;
     b->ch = NULL;
 }
 
 static void stop_binding(struct binding_s *b) {
+    unlink_migration(b);
 
     if (b->ch == NULL) {
         return;
@@ -538,12 +1006,16 @@ static void stop_binding(struct binding_s *b) {
                                             s->token, strlen(s->token),
                                             on_unbind, b);
     b->bound = false;
+    b->unbinding = true;
 }
 
 int ziti_close_server(struct ziti_conn *conn) {
     const char *id;
     struct binding_s *b;
     uv_timer_stop(conn->server.timer);
+    wheel_timer_stop(&conn->server.scale_timer);
+    wheel_timer_stop(&conn->server.load_timer);
+    wheel_timer_stop(&conn->server.health_timer);
     MODEL_MAP_FOREACH(id, b, &conn->server.bindings) {
         CONN_LOG(VERBOSE, "stopping binding[%s]", id);
         stop_binding(b);
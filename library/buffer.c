@@ -26,12 +26,19 @@
 #include <stdarg.h>
 
 #include "buffer.h"
+#include "pool.h"
 
 
 /** incoming data chunk */
 typedef struct chunk_s {
     uint8_t *buf;
     int len;
+    // buffer holds one reference while chunk is queued,
+    // zero-copy readers (see buffer_retain_head()) hold the rest
+    int refs;
+    // passed to free_buf, it is the buffer itself unless data is owned by another object
+    void *owner;
+    void (*free_buf)(void *);
 
     STAILQ_ENTRY(chunk_s) next;
 } chunk_t;
@@ -40,13 +47,55 @@ struct buffer_s {
     STAILQ_HEAD(incoming, chunk_s) chunks;
     int head_offset;
     size_t available;
+    // queued chunks with data owned by another object, see buffer_append_owned()
+    size_t owned;
 };
 
+// chunk nodes are recycled, retained chunks may be released on a different loop than the one that queued them
+#define CHUNK_POOL_CAPACITY 1024
+static uv_once_t chunk_pool_init = UV_ONCE_INIT;
+static mt_pool_t *chunk_pool;
+
+static void init_chunk_pool(void) {
+    chunk_pool = mt_pool_new(sizeof(chunk_t), CHUNK_POOL_CAPACITY);
+}
+
+
+static void chunk_release(chunk_t *chunk) {
+    if (--chunk->refs > 0) {
+        return;
+    }
+    chunk->free_buf(chunk->owner);
+    mt_pool_free(chunk);
+}
+
+static void chunk_dequeue(buffer *b, chunk_t *chunk) {
+    STAILQ_REMOVE_HEAD(&b->chunks, next);
+    b->head_offset = 0;
+    if (chunk->owner != chunk->buf) {
+        b->owned--;
+    }
+    chunk_release(chunk);
+}
+
+// drop fully consumed chunk(s) from the head of the buffer
+static chunk_t *head_chunk(buffer *b) {
+    while (!STAILQ_EMPTY(&b->chunks)) {
+        chunk_t *chunk = STAILQ_FIRST(&b->chunks);
+        if (chunk->len != b->head_offset) {
+            return chunk;
+        }
+        chunk_dequeue(b, chunk);
+    }
+    return NULL;
+}
 
 buffer *new_buffer() {
+    uv_once(&chunk_pool_init, init_chunk_pool);
     buffer *b = malloc(sizeof(buffer));
     b->head_offset = 0;
     b->available = 0;
+    b->owned = 0;
     STAILQ_INIT(&b->chunks);
 
     return b;
@@ -57,8 +106,7 @@ void free_buffer(buffer* b) {
     while (!STAILQ_EMPTY(&b->chunks)) {
         chunk_t *chunk = STAILQ_FIRST(&b->chunks);
         STAILQ_REMOVE_HEAD(&b->chunks, next);
-        free(chunk->buf);
-        free(chunk);
+        chunk_release(chunk);
     }
     free(b);
 }
@@ -71,10 +119,7 @@ void buffer_cleanup(buffer *b) {
 
     chunk_t *chunk = STAILQ_FIRST(&b->chunks);
     if (chunk->len == b->head_offset) {
-        STAILQ_REMOVE_HEAD(&b->chunks, next);
-        b->head_offset = 0;
-        free(chunk->buf);
-        free(chunk);
+        chunk_dequeue(b, chunk);
     }
 }
 
@@ -84,23 +129,11 @@ void buffer_push_back(buffer* b, size_t count) {
 }
 
 ssize_t buffer_get_next(buffer* b, size_t want, uint8_t** ptr) {
-    if (STAILQ_EMPTY(&b->chunks)) {
+    chunk_t *chunk = head_chunk(b);
+    if (chunk == NULL) {
         return -1;
     }
 
-    chunk_t *chunk = STAILQ_FIRST(&b->chunks);
-    if (chunk->len == b->head_offset) {
-        STAILQ_REMOVE_HEAD(&b->chunks, next);
-        b->head_offset = 0;
-        free(chunk->buf);
-        free(chunk);
-
-        if (STAILQ_EMPTY(&b->chunks)) {
-            return -1;
-        }
-
-        chunk = STAILQ_FIRST(&b->chunks);
-    }
     int len = MIN(chunk->len - b->head_offset, want);
     *ptr = chunk->buf + b->head_offset;
     b->head_offset += len;
@@ -109,31 +142,264 @@ ssize_t buffer_get_next(buffer* b, size_t want, uint8_t** ptr) {
     return len;
 }
 
-void buffer_append(buffer* b, uint8_t *buf, size_t len) {
-    chunk_t *e = malloc(sizeof(chunk_t));
+size_t buffer_owned_chunks(buffer *b) {
+    return b->owned;
+}
+
+size_t buffer_peek(buffer *b, uint8_t **ptr) {
+    chunk_t *chunk = head_chunk(b);
+    if (chunk == NULL) {
+        return 0;
+    }
+
+    *ptr = chunk->buf + b->head_offset;
+    return chunk->len - b->head_offset;
+}
+
+int buffer_peek_iov(buffer *b, uv_buf_t *iov, int max_iov) {
+    if (b == NULL) return 0;
+    int count = 0;
+    chunk_t *chunk = head_chunk(b);
+    int offset = b->head_offset;
+    while (chunk && count < max_iov) {
+        if (chunk->len > offset) {
+            iov[count].base = (char *) chunk->buf + offset;
+            iov[count].len = chunk->len - offset;
+            count++;
+        }
+        offset = 0;
+        chunk = STAILQ_NEXT(chunk, next);
+    }
+    return count;
+}
+
+size_t buffer_consume(buffer *b, size_t len) {
+    if (b == NULL) return 0;
+    size_t consumed = 0;
+    chunk_t *chunk;
+    while (consumed < len && (chunk = head_chunk(b)) != NULL) {
+        size_t n = MIN((size_t) (chunk->len - b->head_offset), len - consumed);
+        b->head_offset += (int) n;
+        b->available -= n;
+        consumed += n;
+    }
+    // release fully consumed chunk right away
+    head_chunk(b);
+    return consumed;
+}
+
+size_t buffer_copy_out(buffer *b, uint8_t *dst, size_t len) {
+    uv_buf_t iov[BUFFER_IOV_MAX];
+    size_t copied = 0;
+    while (copied < len) {
+        int count = buffer_peek_iov(b, iov, BUFFER_IOV_MAX);
+        if (count == 0) {
+            break;
+        }
+        size_t batch = 0;
+        for (int i = 0; i < count && copied + batch < len; i++) {
+            size_t n = MIN(iov[i].len, len - copied - batch);
+            memcpy(dst + copied + batch, iov[i].base, n);
+            batch += n;
+        }
+        copied += buffer_consume(b, batch);
+    }
+    return copied;
+}
+
+buffer_chunk *buffer_retain_head(buffer *b) {
+    chunk_t *chunk = head_chunk(b);
+    if (chunk) {
+        chunk->refs++;
+    }
+    return chunk;
+}
+
+void buffer_chunk_release(buffer_chunk *chunk) {
+    if (chunk) {
+        chunk_release(chunk);
+    }
+}
+
+static void append_chunk(buffer *b, uint8_t *buf, size_t len, void *owner, void (*free_buf)(void *)) {
+    chunk_t *e = mt_pool_alloc(chunk_pool);
     e->buf = buf;
     e->len = len;
+    e->refs = 1;
+    e->owner = owner;
+    e->free_buf = free_buf;
     b->available += len;
+    if (owner != buf) {
+        b->owned++;
+    }
 
     STAILQ_INSERT_TAIL(&b->chunks, e, next);
 }
 
+void buffer_append(buffer* b, uint8_t *buf, size_t len) {
+    append_chunk(b, buf, len, buf, free);
+}
+
+void buffer_append_owned(buffer *b, uint8_t *data, size_t len, void *owner, void (*release)(void *)) {
+    append_chunk(b, data, len, owner, release);
+}
+
+void buffer_append_slab(buffer *b, uint8_t *buf, size_t len) {
+    append_chunk(b, buf, len, buf, (void (*)(void *)) buffer_slab_release);
+}
+
 size_t buffer_available(buffer *b) {
     return b ? b->available : 0;
 }
 
+/** slab buffer header, data is handed out to the reader */
+struct slab_buf_s {
+    buffer_slab *slab;
+    bool pooled;
+    SLIST_ENTRY(slab_buf_s) next;
+    uint8_t data[];
+};
+
+struct buffer_slab_s {
+    SLIST_HEAD(free_bufs, slab_buf_s) free_list;
+    size_t buf_size;
+    size_t capacity;
+    size_t allocated;
+    size_t out;
+    bool closed;
+
+    uint64_t hits;
+    uint64_t misses;
+};
+
+buffer_slab *buffer_slab_new(size_t buf_size, size_t count) {
+    buffer_slab *slab = calloc(1, sizeof(buffer_slab));
+    SLIST_INIT(&slab->free_list);
+    slab->buf_size = buf_size;
+    slab->capacity = count;
+    return slab;
+}
+
+static void slab_free(buffer_slab *slab) {
+    while (!SLIST_EMPTY(&slab->free_list)) {
+        struct slab_buf_s *sb = SLIST_FIRST(&slab->free_list);
+        SLIST_REMOVE_HEAD(&slab->free_list, next);
+        free(sb);
+    }
+    free(slab);
+}
+
+void buffer_slab_free(buffer_slab *slab) {
+    if (slab == NULL) { return; }
+
+    // buffers still referenced by incoming chunks are released later
+    slab->closed = true;
+    if (slab->out == 0) {
+        slab_free(slab);
+    }
+}
+
+uint8_t *buffer_slab_alloc(buffer_slab *slab, size_t *len) {
+    struct slab_buf_s *sb = NULL;
+    size_t size = slab ? slab->buf_size : DEFAULT_SLAB_BUF_SIZE;
+
+    if (slab && !SLIST_EMPTY(&slab->free_list)) {
+        sb = SLIST_FIRST(&slab->free_list);
+        SLIST_REMOVE_HEAD(&slab->free_list, next);
+        slab->hits++;
+    } else {
+        sb = malloc(sizeof(struct slab_buf_s) + size);
+        if (sb == NULL) {
+            *len = 0;
+            return NULL;
+        }
+        sb->slab = slab;
+        sb->pooled = false;
+        if (slab) {
+            slab->misses++;
+            if (slab->allocated < slab->capacity) {
+                slab->allocated++;
+                sb->pooled = true;
+            }
+        }
+    }
+
+    if (slab) {
+        slab->out++;
+    }
+    *len = size;
+    return sb->data;
+}
+
+void buffer_slab_release(uint8_t *buf) {
+    if (buf == NULL) { return; }
+
+    struct slab_buf_s *sb = container_of(buf, struct slab_buf_s, data);
+    buffer_slab *slab = sb->slab;
+    if (slab == NULL) {
+        free(sb);
+        return;
+    }
+
+    slab->out--;
+    if (sb->pooled && !slab->closed) {
+        SLIST_INSERT_HEAD(&slab->free_list, sb, next);
+        return;
+    }
+
+    free(sb);
+    if (slab->closed && slab->out == 0) {
+        slab_free(slab);
+    }
+}
+
+void buffer_slab_stats(buffer_slab *slab, uint64_t *hits, uint64_t *misses) {
+    *hits = slab ? slab->hits : 0;
+    *misses = slab ? slab->misses : 0;
+}
+
 #define WRITE_BUF_CHUNK_SIZE 1024
 
+// current chunk is full: grow it (contiguous mode), or queue it and start a new one
+static void next_chunk(string_buf_t *wb, size_t need) {
+    if (wb->grow) {
+        size_t used = wb->wp - wb->chunk;
+        size_t size = wb->chunk_size > 0 ? wb->chunk_size : WRITE_BUF_CHUNK_SIZE;
+        while (size < used + need) {
+            size *= 2;
+        }
+        wb->chunk = realloc(wb->chunk, size);
+        wb->wp = wb->chunk + used;
+        wb->chunk_size = size;
+        return;
+    }
+
+    buffer_append(wb->buf, wb->chunk, wb->wp - wb->chunk);
+    wb->chunk = malloc(wb->chunk_size);
+    wb->wp = wb->chunk;
+}
+
 void string_buf_init(string_buf_t *wb) {
     wb->fixed = false;
+    wb->grow = false;
     wb->chunk_size = WRITE_BUF_CHUNK_SIZE;
     wb->chunk = malloc(wb->chunk_size);
     wb->buf = new_buffer();
     wb->wp = wb->chunk;
 }
 
+void string_buf_init_sized(string_buf_t *wb, size_t size_hint) {
+    wb->fixed = false;
+    wb->grow = true;
+    wb->chunk_size = size_hint > 0 ? size_hint : WRITE_BUF_CHUNK_SIZE;
+    wb->chunk = malloc(wb->chunk_size);
+    wb->wp = wb->chunk;
+    wb->buf = NULL;
+}
+
 void string_buf_init_fixed(string_buf_t *wb, char *outbuf, size_t max) {
     wb->fixed = true;
+    wb->grow = false;
     wb->chunk = (uint8_t *) outbuf;
     wb->wp = wb->chunk;
     wb->chunk_size = max;
@@ -149,9 +415,7 @@ int string_buf_append_byte(string_buf_t *wb, char c) {
 
         if (wb->fixed) { return -1; }
 
-        buffer_append(wb->buf, wb->chunk, wb->wp - wb->chunk);
-        wb->chunk = malloc(wb->chunk_size);
-        wb->wp = wb->chunk;
+        next_chunk(wb, 1);
     }
     *wb->wp++ = c;
     return 0;
@@ -173,9 +437,7 @@ int string_buf_appendn(string_buf_t *wb, const char *str, size_t len) {
     if (len > 0) {
         if (wb->fixed) { return -1; }
 
-        buffer_append(wb->buf, wb->chunk, wb->wp - wb->chunk);
-        wb->chunk = malloc(wb->chunk_size);
-        wb->wp = wb->chunk;
+        next_chunk(wb, len);
         goto copy;
     }
 
@@ -191,9 +453,7 @@ int string_buf_append(string_buf_t *wb, const char *str) {
     if (*s != 0) {
         if (wb->fixed) { return -1; }
 
-        buffer_append(wb->buf, wb->chunk, wb->wp - wb->chunk);
-        wb->chunk = malloc(wb->chunk_size);
-        wb->wp = wb->chunk;
+        next_chunk(wb, 1);
         goto copy;
     }
 
@@ -201,6 +461,23 @@ int string_buf_append(string_buf_t *wb, const char *str) {
 }
 
 char *string_buf_to_string(string_buf_t *wb, size_t *outlen) {
+    if (wb->grow) {
+        // hand over contiguous chunk instead of copying it
+        size_t used = wb->wp - wb->chunk;
+        if (used + 1 > wb->chunk_size) {
+            next_chunk(wb, 1);
+        }
+        char *result = (char *) wb->chunk;
+        result[used] = 0;
+        if (outlen) {
+            *outlen = used;
+        }
+        wb->chunk = NULL;
+        wb->wp = NULL;
+        wb->chunk_size = 0;
+        return result;
+    }
+
     size_t bytes_in_buffer = buffer_available(wb->buf);
     char *result = malloc(bytes_in_buffer + (wb->wp - wb->chunk) + 1);
 
@@ -265,6 +542,15 @@ int string_buf_fmt(string_buf_t *wb, FORMAT_STRING(const char *fmt), ...) {
     // can't allocate any more memory
     if (wb->fixed) return -1;
 
+    if (wb->grow) {
+        next_chunk(wb, len + 1);
+        va_start(argp, fmt);
+        len = vsnprintf((char *) wb->wp, wb->chunk + wb->chunk_size - wb->wp, fmt, argp);
+        va_end(argp);
+        wb->wp += len;
+        return len;
+    }
+
     // current chunk is not empty push into buffer
     if (wb->chunk != wb->wp) {
         buffer_append(wb->buf, wb->chunk, wb->wp - wb->chunk);
@@ -28,14 +28,37 @@
 #define CONNECT_TIMEOUT (20*1000)
 #define LATENCY_TIMEOUT (10*1000)
 #define LATENCY_INTERVAL (60*1000) /* 1 minute */
+#define LATENCY_FAST_INTERVAL (1000) /* right after connect */
+#define LATENCY_FAST_PROBES (5)
+#define LATENCY_IDLE_INTERVAL (5*60*1000) /* no active connections */
+#define WAITER_TIMEOUT (30 * 1000)
 #define BACKOFF_TIME 5000 /* 5 seconds */
 #define MAX_BACKOFF 5 /* max reconnection timeout: (1 << MAX_BACKOFF) * BACKOFF_TIME = 160 seconds */
+#define RECONNECT_BASE 1000 /* min reconnection timeout */
+#define RECONNECT_CAP ((1U << MAX_BACKOFF) * BACKOFF_TIME)
 #define WRITE_DELAY_WARNING (1000)
 
+// channel health score, see ziti_channel_health()
+#define CH_HEALTH_DEGRADED 60
+#define CH_HEALTH_RECOVERED 80
+#define CH_HEALTH_RTT_MARGIN 20 // ms, RTT up to 2 * best + margin is normal
+#define CH_HEALTH_ERROR_DECAY (10*1000)
+
 #define POOLED_MESSAGE_SIZE (32 * 1024)
 #define INBOUND_POOL_SIZE (32)
 
 #define CH_LOG(lvl, fmt, ...) ZITI_LOG(lvl, "ch[%d] " fmt, ch->id, ##__VA_ARGS__)
+// for messages that can be logged for every received message
+#define CH_LOG_RATE(lvl, fmt, ...) ZITI_LOG_RATE(lvl, LOG_RATE_PER_SEC, "ch[%d] " fmt, ch->id, ##__VA_ARGS__)
+
+#if defined(ZITI_TEST_TRANSPORT)
+#define CH_TRANSPORT(ch) ((ch)->ctx->ch_transport)
+#define CH_TRANSPORT_CTX(ch) ((ch)->ctx->ch_transport_ctx)
+#else
+// channels always use TLS, transport branches are compiled out
+#define CH_TRANSPORT(ch) ((const ziti_channel_transport *) NULL)
+#define CH_TRANSPORT_CTX(ch) NULL
+#endif
 
 enum ChannelState {
     Initial,
@@ -66,6 +89,8 @@ static const char *get_timeout_cb(ziti_channel_t *ch);
 static void reconnect_channel(ziti_channel_t *ch, bool now);
 
 static void reconnect_cb(uv_timer_t *t);
+static void handshake_done(ziti_channel_t *ch);
+static void dequeue_reconnect(ziti_channel_t *ch);
 
 static void on_channel_connect_internal(uv_connect_t *req, int status);
 
@@ -73,6 +98,10 @@ static struct msg_receiver *find_receiver(ziti_channel_t *ch, uint32_t conn_id);
 
 static void on_channel_close(ziti_channel_t *ch, int ziti_err, ssize_t uv_err);
 
+static void fail_pending_writes(ziti_channel_t *ch, int err);
+
+static void on_channel_flush(uv_idle_t *fl);
+
 static void send_latency_probe(uv_timer_t *t);
 
 static void ch_connect_timeout(uv_timer_t *t);
@@ -86,9 +115,22 @@ static void process_inbound(ziti_channel_t *ch);
 // global channel sequence
 static uint32_t channel_counter = 0;
 
-struct ch_write_req {
-    uv_buf_t buf;
+// pending messages are coalesced into a single write up to this size
+#define WRITE_BATCH_SIZE (64 * 1024)
+
+// data bytes allowed to be outstanding in the transport,
+// keeps control messages (and latency probes) from queueing behind bulk data
+#define WRITE_INFLIGHT_MAX (4 * WRITE_BATCH_SIZE)
+
+// write batches kept for reuse: enough to keep WRITE_INFLIGHT_MAX in flight, plus control messages
+#define WRITE_BATCH_POOL_SIZE 8
+
+struct ch_write_batch {
+    uv_write_t req;
     ziti_channel_t *ch;
+    size_t len;
+    TAILQ_HEAD(, ziti_write_req_s) reqs;
+    uint8_t data[];
 };
 
 struct waiter_s {
@@ -96,7 +138,8 @@ struct waiter_s {
     reply_cb cb;
     void *reply_ctx;
 
-    LIST_ENTRY(waiter_s) next;
+    ziti_channel_t *ch;
+    wheel_timer_t timeout;
 };
 
 struct ch_conn_req {
@@ -113,7 +156,7 @@ struct msg_receiver {
 };
 
 static void ch_init_stream(ziti_channel_t *ch) {
-    if (ch->connection == NULL) {
+    if (ch->connection == NULL && CH_TRANSPORT(ch) == NULL) {
         ch->connection = calloc(1, sizeof(*ch->connection));
         tlsuv_stream_init(ch->loop, ch->connection, ch->ctx->tlsCtx);
         tlsuv_stream_keepalive(ch->connection, true, 30);
@@ -123,14 +166,18 @@ static void ch_init_stream(ziti_channel_t *ch) {
 }
 
 int ziti_channel_prepare(ziti_channel_t *ch) {
+    for (int i = 0; i < ch->num_stripes; i++) {
+        ziti_channel_prepare(ch->stripes[i]);
+    }
+
     process_inbound(ch);
 
     // process_inbound() may consume all message buffers from the pool,
     // but it will put ziti connection(s) into `flush` state
     // activating uv_idle_t handle, causing zero-timeout IO
     // and a flush attempt on the next loop iteration
-    if (ch->state == Connected) {
-        if (pool_has_available(ch->in_msg_pool) || ch->in_next != NULL) {
+    if (ch->state == Connected && ch->connection) {
+        if (!ch->ctx->mem_read_paused && (pool_has_available(ch->in_msg_pool) || ch->in_next != NULL)) {
             tlsuv_stream_read_start(ch->connection, channel_alloc_cb, on_channel_data);
         } else {
             tlsuv_stream_read_stop(ch->connection);
@@ -158,9 +205,21 @@ static int ziti_channel_init(struct ziti_ctx *ctx, ziti_channel_t *ch, uint32_t
     ch->in_next = NULL;
     ch->in_body_offset = 0;
     ch->incoming = new_buffer();
-    ch->in_msg_pool = pool_new(POOLED_MESSAGE_SIZE, INBOUND_POOL_SIZE, (void (*)(void *)) message_free);
-
-    LIST_INIT(&ch->waiters);
+    // only message header needs clearing on reuse, frame buffer is always overwritten
+    ch->in_msg_pool = pool_new_slab(POOLED_MESSAGE_SIZE, INBOUND_POOL_SIZE, MSG_POOL_SLAB_COUNT, sizeof(message), false,
+                                    (void (*)(void *)) message_free);
+
+    TAILQ_INIT(&ch->out_pending);
+    TAILQ_INIT(&ch->ctrl_pending);
+    ch->out_inflight = 0;
+    ch->batch_pool = pool_new_slab(sizeof(struct ch_write_batch) + WRITE_BATCH_SIZE, WRITE_BATCH_POOL_SIZE, 0,
+                                   sizeof(struct ch_write_batch), false, NULL);
+    // idle rather than prepare/check: messages are also sent from prepare callbacks (ztx_prepare() dispatching
+    // inbound messages, bridge flushers), a prepare flusher that already ran would leave them queued while
+    // the loop blocks in poll. idle runs before prepare, and only keeps poll from blocking while writes are pending
+    ch->flusher = calloc(1, sizeof(uv_idle_t));
+    uv_idle_init(ch->loop, ch->flusher);
+    ch->flusher->data = ch;
 
     ch->timer = calloc(1, sizeof(uv_timer_t));
     uv_timer_init(ch->loop, ch->timer);
@@ -173,9 +232,13 @@ static int ziti_channel_init(struct ziti_ctx *ctx, ziti_channel_t *ch, uint32_t
 }
 
 void ziti_channel_free(ziti_channel_t *ch) {
+    FREE(ch->stripes);
+    model_map_clear(&ch->waiters, free);
     free_buffer(ch->incoming);
     pool_destroy(ch->in_msg_pool);
     ch->in_msg_pool = NULL;
+    pool_destroy(ch->batch_pool);
+    ch->batch_pool = NULL;
     FREE(ch->name);
     FREE(ch->url);
     FREE(ch->version);
@@ -217,6 +280,31 @@ static void close_handle_cb(uv_handle_t *h) {
     free(ch);
 }
 
+// channel over in-process transport is freed with its last handle
+static void close_flusher_cb(uv_handle_t *h) {
+    ziti_channel_t *ch = h->data;
+    free(h);
+
+    ziti_channel_free(ch);
+    free(ch);
+}
+
+static void ch_close_stream(ziti_channel_t *ch) {
+    if (CH_TRANSPORT(ch)) {
+        CH_TRANSPORT(ch)->close(CH_TRANSPORT_CTX(ch), ch);
+    } else if (ch->connection) {
+        tlsuv_stream_close(ch->connection, on_tls_close);
+    }
+    ch->connection = NULL;
+}
+
+#if defined(ZITI_TEST_TRANSPORT)
+void ziti_set_channel_transport(ziti_context ztx, const ziti_channel_transport *transport, void *ctx) {
+    ztx->ch_transport = transport;
+    ztx->ch_transport_ctx = ctx;
+}
+#endif
+
 int ziti_channel_close(ziti_channel_t *ch, int err) {
     int r = 0;
     if (ch->state != Closed) {
@@ -224,11 +312,28 @@ int ziti_channel_close(ziti_channel_t *ch, int err) {
 
         on_channel_close(ch, err, 0);
         ch->state = Closed;
-        ziti_on_channel_event(ch, EdgeRouterRemoved, ch->ctx);
+        dequeue_reconnect(ch);
+        if (ch->primary == NULL) {
+            ziti_on_channel_event(ch, EdgeRouterRemoved, ch->ctx);
+        }
+
+        for (int i = 0; i < ch->num_stripes; i++) {
+            // stripe frees itself once closed
+            ziti_channel_close(ch->stripes[i], err);
+        }
+        ch->num_stripes = 0;
 
         uv_close((uv_handle_t *) ch->timer, (uv_close_cb) free);
         ch->timer = NULL;
-        tlsuv_stream_close(ch->connection, close_handle_cb);
+        fail_pending_writes(ch, UV_ECANCELED);
+        if (CH_TRANSPORT(ch)) {
+            ch_close_stream(ch);
+            uv_close((uv_handle_t *) ch->flusher, close_flusher_cb);
+        } else {
+            uv_close((uv_handle_t *) ch->flusher, (uv_close_cb) free);
+            tlsuv_stream_close(ch->connection, close_handle_cb);
+        }
+        ch->flusher = NULL;
     }
     return r;
 }
@@ -260,12 +365,142 @@ uint64_t ziti_channel_latency(ziti_channel_t *ch) {
     return ch->latency;
 }
 
-static ziti_channel_t *new_ziti_channel(ziti_context ztx, const char *ch_name, const char *url) {
+void ziti_channel_load(ziti_channel_t *ch, ziti_router_load *load) {
+    load->name = ch->name;
+    load->url = ch->url;
+    load->rtt = ch->srtt ? ch->srtt : ch->latency;
+    load->rtt_var = ch->rttvar;
+    load->queued_bytes = ch->out_q_bytes;
+    load->connections = model_map_size(&ch->receivers);
+    for (int i = 0; i < ch->num_stripes; i++) {
+        load->queued_bytes += ch->stripes[i]->out_q_bytes;
+        load->connections += model_map_size(&ch->stripes[i]->receivers);
+    }
+    load->health = ziti_channel_health(ch);
+    load->degraded = ch->degraded;
+}
+
+// errors are tracked on the primary channel for all its stripes
+static void health_error(ziti_channel_t *ch) {
+    ziti_channel_t *base = ch->primary ? ch->primary : ch;
+    if (base->health_errors == 0) {
+        base->health_errors_ts = uv_now(base->loop);
+    }
+    base->health_errors++;
+}
+
+int ziti_channel_health(ziti_channel_t *ch) {
+    if (ch->state != Connected) {
+        return 0;
+    }
+
+    uint64_t now = uv_now(ch->loop);
+    while (ch->health_errors > 0 && now - ch->health_errors_ts >= CH_HEALTH_ERROR_DECAY) {
+        ch->health_errors /= 2;
+        ch->health_errors_ts += CH_HEALTH_ERROR_DECAY;
+    }
+
+    // each signal takes up to 40 points
+    uint64_t write_delay = ch->last_write_delay;
+    for (int i = 0; i < ch->num_stripes; i++) {
+        write_delay = MAX(write_delay, ch->stripes[i]->last_write_delay);
+    }
+    int delay_penalty = (int) MIN(40, write_delay * 10 / WRITE_DELAY_WARNING);
+
+    int rtt_penalty = 0;
+    if (ch->rtt_min > 0) {
+        uint64_t normal = 2 * ch->rtt_min + CH_HEALTH_RTT_MARGIN;
+        if (ch->srtt > normal) {
+            rtt_penalty = (int) MIN(40, 40 * (ch->srtt - normal) / normal);
+        }
+    }
+
+    int error_penalty = (int) MIN(40, ch->health_errors * 10);
+
+    int health = MAX(0, 100 - delay_penalty - rtt_penalty - error_penalty);
+    bool degraded = ch->degraded ? health < CH_HEALTH_RECOVERED : health < CH_HEALTH_DEGRADED;
+    if (degraded != ch->degraded) {
+        CH_LOG(INFO, "%s: health[%d] write_delay[%" PRIu64 "ms] srtt[%" PRIu64 "ms] rtt_min[%" PRIu64 "ms] errors[%u]",
+               degraded ? "degraded" : "recovered", health, write_delay, ch->srtt, ch->rtt_min, ch->health_errors);
+        ch->degraded = degraded;
+    }
+    return health;
+}
+
+static int cmp_u64(const void *a, const void *b) {
+    uint64_t l = *(const uint64_t *) a;
+    uint64_t r = *(const uint64_t *) b;
+    return l < r ? -1 : (l > r ? 1 : 0);
+}
+
+void ziti_channel_rtt_stats(ziti_channel_t *ch, ziti_rtt_stats *stats) {
+    memset(stats, 0, sizeof(*stats));
+    size_t n = MIN(ch->rtt_count, CH_RTT_SAMPLES);
+    if (n == 0) {
+        return;
+    }
+
+    uint64_t sorted[CH_RTT_SAMPLES];
+    uint64_t sum = 0;
+    memcpy(sorted, ch->rtt_samples, n * sizeof(uint64_t));
+    qsort(sorted, n, sizeof(uint64_t), cmp_u64);
+    for (size_t i = 0; i < n; i++) {
+        sum += sorted[i];
+    }
+
+    stats->samples = n;
+    stats->min = sorted[0];
+    stats->avg = sum / n;
+    stats->p50 = sorted[(n - 1) / 2];
+    stats->p99 = sorted[(n * 99 - 1) / 100];
+}
+
+// probe often until we have a few samples, rarely if there is nothing going on
+static uint64_t next_probe_interval(ziti_channel_t *ch) {
+    if (ch->rtt_count < LATENCY_FAST_PROBES) {
+        return LATENCY_FAST_INTERVAL;
+    }
+    if (model_map_size(&ch->receivers) == 0) {
+        return LATENCY_IDLE_INTERVAL;
+    }
+    return LATENCY_INTERVAL;
+}
+
+// RFC 6298 style smoothing
+static void update_rtt(ziti_channel_t *ch, uint64_t sample) {
+    ch->latency = sample;
+    ch->rtt_samples[ch->rtt_count % CH_RTT_SAMPLES] = sample;
+    ch->rtt_count++;
+    if (ch->rtt_min == 0 || sample < ch->rtt_min) {
+        ch->rtt_min = MAX(sample, 1);
+    }
+    if (ch->srtt == 0) {
+        ch->srtt = sample;
+        ch->rttvar = sample / 2;
+    } else {
+        uint64_t delta = ch->srtt > sample ? ch->srtt - sample : sample - ch->srtt;
+        ch->rttvar = (3 * ch->rttvar + delta) / 4;
+        ch->srtt = (7 * ch->srtt + sample) / 8;
+    }
+
+    // remembered for ordering router connections on the next start
+    int *rtt = model_map_get(&ch->ctx->router_rtt, ch->name);
+    if (rtt == NULL) {
+        rtt = malloc(sizeof(int));
+        model_map_set(&ch->ctx->router_rtt, ch->name, rtt);
+    }
+    *rtt = (int) ch->srtt;
+}
+
+static void stripe_notify(ziti_channel_t *ch, ziti_router_status status, void *ctx) {
+    CH_LOG(DEBUG, "stripe of ch[%d] status[%d]", ch->primary->id, status);
+}
+
+static ziti_channel_t *alloc_channel(ziti_context ztx, const char *ch_name, const char *url) {
     ziti_channel_t *ch = calloc(1, sizeof(ziti_channel_t));
     ziti_channel_init(ztx, ch, channel_counter++, ztx->tlsCtx);
     ch->name = strdup(ch_name);
     ch->url = strdup(url);
-    CH_LOG(INFO, "(%s) new channel for ztx[%d] identity[%s]", ch->name, ztx->id, ztx->api_session->identity->name);
 
     struct tlsuv_url_s ingress;
     tlsuv_parse_url(&ingress, url);
@@ -273,10 +508,41 @@ static ziti_channel_t *new_ziti_channel(ziti_context ztx, const char *ch_name, c
     ch->host = calloc(1, ingress.hostname_len + 1);
     snprintf(ch->host, ingress.hostname_len + 1, "%.*s", (int) ingress.hostname_len, ingress.hostname);
     ch->port = ingress.port;
+    return ch;
+}
+
+static ziti_channel_t *new_ziti_channel(ziti_context ztx, const char *ch_name, const char *url) {
+    ziti_channel_t *ch = alloc_channel(ztx, ch_name, url);
+    CH_LOG(INFO, "(%s) new channel for ztx[%d] identity[%s]", ch->name, ztx->id, ztx->api_session->identity->name);
+
+    if (ztx->opts.router_connections > 1) {
+        ch->num_stripes = (int) ztx->opts.router_connections - 1;
+        ch->stripes = calloc(ch->num_stripes, sizeof(ziti_channel_t *));
+        for (int i = 0; i < ch->num_stripes; i++) {
+            ziti_channel_t *stripe = alloc_channel(ztx, ch_name, url);
+            stripe->primary = ch;
+            stripe->notify_cb = stripe_notify;
+            ch->stripes[i] = stripe;
+        }
+        CH_LOG(INFO, "using %d connections to %s", ch->num_stripes + 1, url);
+    }
+
     model_map_set(&ztx->channels, url, ch);
     return ch;
 }
 
+ziti_channel_t *ziti_channel_for_conn(ziti_channel_t *ch, uint32_t conn_id) {
+    if (ch->num_stripes == 0) {
+        return ch;
+    }
+
+    uint32_t idx = conn_id % (ch->num_stripes + 1);
+    if (idx > 0 && ziti_channel_is_connected(ch->stripes[idx - 1])) {
+        return ch->stripes[idx - 1];
+    }
+    return ch;
+}
+
 static void check_connecting_state(ziti_channel_t *ch) {
     // verify channel state
     bool reset = false;
@@ -342,15 +608,17 @@ int ziti_channel_connect(ziti_context ztx, const char *ch_name, const char *url,
     if (ch->state == Initial || ch->state == Disconnected) {
         reconnect_channel(ch, true);
     }
+
+    for (int i = 0; i < ch->num_stripes; i++) {
+        ziti_channel_t *stripe = ch->stripes[i];
+        if (stripe->state == Initial || stripe->state == Disconnected) {
+            reconnect_channel(stripe, true);
+        }
+    }
     return ZITI_OK;
 }
 
-void on_channel_send(uv_write_t *w, int status) {
-    struct ziti_write_req_s *zwreq = w->data;
-
-    ziti_channel_t *ch = zwreq->ch;
-    uint64_t now = uv_now(ch->loop);
-
+static void complete_write(ziti_channel_t *ch, struct ziti_write_req_s *zwreq, uint64_t now, int status) {
     // time to get on-wire
     uint64_t write_delay = now - zwreq->start_ts;
     if (write_delay > WRITE_DELAY_WARNING && ch->last_write_delay < WRITE_DELAY_WARNING) {
@@ -360,56 +628,215 @@ void on_channel_send(uv_write_t *w, int status) {
         CH_LOG(TRACE, "write delay = %" PRIu64 ".%03" PRIu64 "d q=%ld qs=%ld",
                write_delay / 1000L, write_delay % 1000L, ch->out_q, ch->out_q_bytes);
     }
-    ch->last_write = now;
     ch->last_write_delay = write_delay;
+    metrics_hist_record(&ch->write_delay, write_delay);
     ch->out_q--;
     ch->out_q_bytes -= zwreq->message->msgbuflen;
 
     pool_return_obj(zwreq->message);
     zwreq->message = NULL;
 
+    if (ch->write_blocked) {
+        size_t high = ch->ctx->opts.channel_write_high_water;
+        size_t low = ch->ctx->opts.channel_write_low_water ? ch->ctx->opts.channel_write_low_water : high / 2;
+        if (ch->out_q_bytes <= low) {
+            CH_LOG(VERBOSE, "outbound queue drained to %zu bytes", ch->out_q_bytes);
+            ch->write_blocked = false;
+            conn_channel_writable(ch->ctx, ch);
+        }
+    }
+
     if (zwreq->conn) {
         on_write_completed(zwreq->conn, zwreq, status);
     } else {
-        free(zwreq);
+        write_req_free(zwreq);
+    }
+}
+
+static void out_pending_remove(ziti_channel_t *ch, struct ziti_write_req_s *r) {
+    TAILQ_REMOVE(&ch->out_pending, r, _next);
+    if (r->ch_queued) {
+        r->ch_queued = false;
+        r->conn->ch_out_pending--;
+    }
+}
+
+static void fail_pending_writes(ziti_channel_t *ch, int err) {
+    uint64_t now = uv_now(ch->loop);
+    struct ziti_write_req_s *zwreq;
+    while ((zwreq = TAILQ_FIRST(&ch->ctrl_pending)) != NULL) {
+        TAILQ_REMOVE(&ch->ctrl_pending, zwreq, _next);
+        complete_write(ch, zwreq, now, err);
+    }
+    while ((zwreq = TAILQ_FIRST(&ch->out_pending)) != NULL) {
+        out_pending_remove(ch, zwreq);
+        complete_write(ch, zwreq, now, err);
+    }
+}
+
+static void on_channel_send(uv_write_t *w, int status) {
+    struct ch_write_batch *batch = w->data;
+    ziti_channel_t *ch = batch->ch;
+    uint64_t now = uv_now(ch->loop);
+
+    ch->last_write = now;
+    ch->out_inflight -= batch->len;
+    while (!TAILQ_EMPTY(&batch->reqs)) {
+        struct ziti_write_req_s *zwreq = TAILQ_FIRST(&batch->reqs);
+        TAILQ_REMOVE(&batch->reqs, zwreq, _next);
+        complete_write(ch, zwreq, now, status);
     }
 
     if (status < 0) {
         CH_LOG(ERROR, "write failed [%d/%s]", status, uv_strerror(status));
+        health_error(ch);
         on_channel_close(ch, ZITI_CONN_CLOSED, status);
+    } else if (ch->flusher && !TAILQ_EMPTY(&ch->out_pending) && ch->out_inflight < WRITE_INFLIGHT_MAX) {
+        // data was held back
+        uv_idle_start(ch->flusher, on_channel_flush);
     }
 
-    free(w);
+    pool_return_obj(batch);
+}
+
+// select next batch: control messages go first, data is only handed to the transport
+// while it has less than WRITE_INFLIGHT_MAX outstanding
+static int next_batch(ziti_channel_t *ch, size_t *len) {
+    struct ziti_write_req_s *r;
+    size_t total = 0;
+    int count = 0;
+    TAILQ_FOREACH(r, &ch->ctrl_pending, _next) {
+        if (count > 0 && total + r->message->msgbuflen > WRITE_BATCH_SIZE) {
+            goto done;
+        }
+        total += r->message->msgbuflen;
+        count++;
+    }
+
+    TAILQ_FOREACH(r, &ch->out_pending, _next) {
+        if (ch->out_inflight + total >= WRITE_INFLIGHT_MAX ||
+            (count > 0 && total + r->message->msgbuflen > WRITE_BATCH_SIZE)) {
+            break;
+        }
+        total += r->message->msgbuflen;
+        count++;
+    }
+
+    done:
+    *len = total;
+    return count;
+}
+
+// write out pending messages, consecutive messages are gathered into one buffer
+// to reduce the number of writes (and TLS records)
+static void flush_pending_writes(ziti_channel_t *ch) {
+    size_t len;
+    int count;
+    while ((count = next_batch(ch, &len)) > 0) {
+        // single message is written directly from its own buffer
+        struct ch_write_batch *batch = pool_alloc_obj(ch->batch_pool);
+        if (batch == NULL) {
+            batch = alloc_unpooled_obj(sizeof(struct ch_write_batch) + (count > 1 ? len : 0), NULL);
+            ch->ctx->path_stats.allocs++;
+        }
+        if (count > 1) {
+            ch->ctx->path_stats.bytes_copied += len;
+        }
+        batch->ch = ch;
+        batch->req.data = batch;
+        batch->len = len;
+        TAILQ_INIT(&batch->reqs);
+
+        uint8_t *p = batch->data;
+        for (int i = 0; i < count; i++) {
+            struct ziti_write_req_s *r = TAILQ_FIRST(&ch->ctrl_pending);
+            if (r) {
+                TAILQ_REMOVE(&ch->ctrl_pending, r, _next);
+            } else {
+                r = TAILQ_FIRST(&ch->out_pending);
+                out_pending_remove(ch, r);
+            }
+            TAILQ_INSERT_TAIL(&batch->reqs, r, _next);
+            if (count > 1) {
+                memcpy(p, r->message->msgbufp, r->message->msgbuflen);
+                p += r->message->msgbuflen;
+            }
+        }
+
+        uv_buf_t buf;
+        if (count == 1) {
+            message *m = TAILQ_FIRST(&batch->reqs)->message;
+            buf = uv_buf_init((char *) m->msgbufp, m->msgbuflen);
+        } else {
+            buf = uv_buf_init((char *) batch->data, len);
+        }
+
+        CH_LOG(TRACE, "writing %d message(s) len[%zd]", count, len);
+        ch->out_inflight += len;
+        if (CH_TRANSPORT(ch)) {
+            int rc = CH_TRANSPORT(ch)->write(CH_TRANSPORT_CTX(ch), ch, (const uint8_t *) buf.base, buf.len);
+            on_channel_send(&batch->req, rc);
+            continue;
+        }
+
+        int rc = ch->connection ? tlsuv_stream_write(&batch->req, ch->connection, &buf, on_channel_send) : UV_ENOTCONN;
+        if (rc != 0) {
+            on_channel_send(&batch->req, rc);
+        }
+    }
+}
+
+static void on_channel_flush(uv_idle_t *fl) {
+    ziti_channel_t *ch = fl->data;
+    uv_idle_stop(fl);
+    flush_pending_writes(ch);
 }
 
 int ziti_channel_send_message(ziti_channel_t *ch, message *msg, struct ziti_write_req_s *ziti_write) {
-    uv_buf_t buf = uv_buf_init((char *) msg->msgbufp, msg->msgbuflen);
     message_set_seq(msg, &ch->msg_seq);
     CH_LOG(TRACE, "=> ct[%04X] seq[%d] len[%d]", msg->header.content, msg->header.seq, msg->header.body_len);
 
-    NEWP(req, uv_write_t);
     if (ziti_write == NULL) {
-        ziti_write = calloc(1, sizeof(struct ziti_write_req_s));
+        ziti_write = write_req_new(ch->ctx);
     }
     ziti_write->ch = ch;
-
-    req->data = ziti_write;
     ziti_write->message = msg;
     ziti_write->start_ts = uv_now(ch->loop);
     ch->out_q++;
-    ch->out_q_bytes += buf.len;
-    int rc = tlsuv_stream_write(req, ch->connection, &buf, on_channel_send);
-    if (rc != 0) {
-        on_channel_send(req, rc);
+    ch->out_q_bytes += msg->msgbuflen;
+
+    size_t high = ch->ctx->opts.channel_write_high_water;
+    if (high > 0 && !ch->write_blocked && ch->out_q_bytes > high) {
+        CH_LOG(VERBOSE, "outbound queue is over high mark: %zu bytes", ch->out_q_bytes);
+        ch->write_blocked = true;
+    }
+
+    if (ch->flusher == NULL) { // channel is closed
+        complete_write(ch, ziti_write, ziti_write->start_ts, UV_ECANCELED);
+        return 0;
     }
-    return 0;
 
+    // control messages bypass queued data,
+    // unless it is a close that must follow data queued for the same connection
+    bool ctrl = msg->header.content != ContentTypeData &&
+                !(ziti_write->conn && ziti_write->conn->ch_out_pending > 0);
+    if (ctrl) {
+        TAILQ_INSERT_TAIL(&ch->ctrl_pending, ziti_write, _next);
+    } else {
+        TAILQ_INSERT_TAIL(&ch->out_pending, ziti_write, _next);
+        if (ziti_write->conn) {
+            ziti_write->ch_queued = true;
+            ziti_write->conn->ch_out_pending++;
+        }
+    }
+    uv_idle_start(ch->flusher, on_channel_flush);
+    return 0;
 }
 
 int ziti_channel_send(ziti_channel_t *ch, uint32_t content, const hdr_t *hdrs, int nhdrs, const uint8_t *body,
                       uint32_t body_len,
                       struct ziti_write_req_s *ziti_write) {
-    message *m = message_new(NULL, content, hdrs, nhdrs, body_len);
+    message *m = message_new_out(ch->ctx->out_msgs, content, hdrs, nhdrs, body_len);
     message_set_seq(m, &ch->msg_seq);
     CH_LOG(TRACE, "=> ct[%04X] seq[%d] len[%d]", content, m->header.seq, body_len);
     memcpy(m->body, body, body_len);
@@ -419,17 +846,35 @@ int ziti_channel_send(ziti_channel_t *ch, uint32_t content, const hdr_t *hdrs, i
 
 void ziti_channel_remove_waiter(ziti_channel_t *ch, struct waiter_s *waiter) {
     if (waiter) {
-        LIST_REMOVE(waiter, next);
+        model_map_removel(&ch->waiters, waiter->seq);
+        wheel_timer_stop(&waiter->timeout);
         free(waiter);
     }
 }
 
+static void on_waiter_timeout(wheel_timer_t *t) {
+    struct waiter_s *w = t->data;
+    ziti_channel_t *ch = w->ch;
+
+    model_map_removel(&ch->waiters, w->seq);
+    CH_LOG(WARN, "timed out waiting for reply to seq[%d]", w->seq);
+    health_error(ch);
+    w->cb(w->reply_ctx, NULL, ZITI_TIMEOUT);
+    free(w);
+}
+
+static void add_waiter(ziti_channel_t *ch, struct waiter_s *w) {
+    w->ch = ch;
+    model_map_setl(&ch->waiters, w->seq, w);
+    wheel_timer_start(&ch->ctx->timers, &w->timeout, WAITER_TIMEOUT, on_waiter_timeout, w);
+}
+
 struct waiter_s *
 ziti_channel_send_for_reply(ziti_channel_t *ch, uint32_t content, const hdr_t *hdrs, int nhdrs, const uint8_t *body,
                             uint32_t body_len,
                             reply_cb rep_cb, void *reply_ctx) {
     struct waiter_s *result = NULL;
-    message *m = message_new(NULL, content, hdrs, nhdrs, body_len);
+    message *m = message_new_out(ch->ctx->out_msgs, content, hdrs, nhdrs, body_len);
     message_set_seq(m, &ch->msg_seq);
     memcpy(m->body, body, body_len);
 
@@ -439,7 +884,7 @@ ziti_channel_send_for_reply(ziti_channel_t *ch, uint32_t content, const hdr_t *h
         w->cb = rep_cb;
         w->reply_ctx = reply_ctx;
 
-        LIST_INSERT_HEAD(&ch->waiters, w, next);
+        add_waiter(ch, w);
         result = w;
     }
 
@@ -474,42 +919,46 @@ static bool is_edge(uint32_t content) {
 static void dispatch_message(ziti_channel_t *ch, message *m) {
     struct waiter_s *w = NULL;
 
-    m->nhdrs = parse_hdrs(m->headers, m->header.headers_len, &m->hdrs);
+    message_parse_hdrs(m);
 
     int32_t reply_to;
     bool is_reply = message_get_int32_header(m, ReplyForHeader, &reply_to);
 
     uint32_t ct = m->header.content;
+    ziti_path_stats *stats = &ch->ctx->path_stats;
     if (is_reply) {
-        LIST_FOREACH(w, &ch->waiters, next) {
-            if (w->seq == reply_to) {
-                break;
-            }
-        }
+        w = model_map_removel(&ch->waiters, reply_to);
 
         if (w) {
-            LIST_REMOVE(w, next);
+            stats->msgs_replies++;
+            wheel_timer_stop(&w->timeout);
             w->cb(w->reply_ctx, m, 0);
             free(w);
             pool_return_obj(m);
             return;
         }
 
-        CH_LOG(ERROR, "could not find waiter for reply_to = %d ct[%X]", reply_to, ct);
+        CH_LOG_RATE(ERROR, "could not find waiter for reply_to = %d ct[%X]", reply_to, ct);
     }
 
     if (ch->state == Connecting) {
         if (ct == ContentTypeResultType) {
             CH_LOG(WARN, "lost hello reply waiter");
+            stats->msgs_other++;
             hello_reply_cb(ch, m, ZITI_OK);
             pool_return_obj(m);
             return;
         }
 
-        CH_LOG(ERROR, "received unexpected message ct[%04X] in Connecting state", ct);
+        CH_LOG_RATE(ERROR, "received unexpected message ct[%04X] in Connecting state", ct);
     }
 
     if (is_edge(ct)) {
+        if (ct == ContentTypeData) {
+            stats->msgs_data++;
+        } else {
+            stats->msgs_state++;
+        }
         int32_t conn_id = 0;
         bool has_conn_id = message_get_int32_header(m, ConnIdHeader, &conn_id);
         struct msg_receiver *conn = has_conn_id ? find_receiver(ch, conn_id) : NULL;
@@ -519,39 +968,91 @@ static void dispatch_message(ziti_channel_t *ch, message *m) {
         } else {
             // close confirmation is OK if connection is gone already
             if (ct != ContentTypeStateClosed) {
-                CH_LOG(WARN, "received message without conn_id or for unknown connection ct[%04X] conn_id[%d]",
+                CH_LOG_RATE(WARN, "received message without conn_id or for unknown connection ct[%04X] conn_id[%d]",
                        ct, conn_id);
             }
             pool_return_obj(m);
         }
     } else {
-        CH_LOG(WARN, "unsupported content type [%04X]", ct);
+        stats->msgs_other++;
+        CH_LOG_RATE(WARN, "unsupported content type [%04X]", ct);
         pool_return_obj(m);
     }
 }
 
+static bool check_frame_size(ziti_channel_t *ch, const header_t *h) {
+    size_t max = ch->ctx->opts.max_frame_size;
+    size_t frame_len = HEADER_SIZE + (size_t) h->headers_len + h->body_len;
+    if (max > 0 && frame_len > max) {
+        CH_LOG(ERROR, "frame ct[%04X] seq[%d] size[%zd] exceeds limit[%zd], closing channel",
+               h->content, h->seq, frame_len, max);
+        ch_close_stream(ch);
+        on_channel_close(ch, ZITI_CONNABORT, UV_EMSGSIZE);
+        return false;
+    }
+    return true;
+}
+
 static void process_inbound(ziti_channel_t *ch) {
     uint8_t *ptr;
     ssize_t len;
     do {
         if (ch->in_next == NULL && pool_has_available(ch->in_msg_pool)) {
-            if (buffer_available(ch->incoming) < HEADER_SIZE) {
-                break;
+            if (!ch->in_hdr_read) {
+                if (buffer_available(ch->incoming) < HEADER_SIZE) {
+                    break;
+                }
+
+                // fast path: complete frame is in the head chunk, dispatch it in place
+                uint8_t *frame;
+                size_t contiguous = buffer_peek(ch->incoming, &frame);
+                if (contiguous >= HEADER_SIZE) {
+                    header_t h;
+                    header_from_buffer(&h, frame);
+                    if (!check_frame_size(ch, &h)) {
+                        return;
+                    }
+                    size_t frame_len = HEADER_SIZE + (size_t) h.headers_len + h.body_len;
+                    if (contiguous >= frame_len) {
+                        buffer_chunk *chunk = buffer_retain_head(ch->incoming);
+                        message *m = message_new_from_chunk(ch->in_msg_pool, frame, chunk);
+                        buffer_consume(ch->incoming, frame_len);
+                        ch->ctx->path_stats.msgs_framed++;
+                        ch->ctx->path_stats.msgs_framed_in_place++;
+
+                        CH_LOG(TRACE, "<= ct[%04X] seq[%d] len[%d] hdrs[%d] (in place)", m->header.content,
+                               m->header.seq, m->header.body_len, m->header.headers_len);
+                        dispatch_message(ch, m);
+                        continue;
+                    }
+                }
+
+                // header spans chunks
+                size_t header_read = buffer_copy_out(ch->incoming, ch->in_hdr, HEADER_SIZE);
+                ch->ctx->path_stats.bytes_copied += header_read;
+
+                assert(header_read == HEADER_SIZE);
+                ch->in_hdr_read = true;
             }
 
-            uint8_t header_buf[HEADER_SIZE];
-            size_t header_read = 0;
-
-            while (header_read < HEADER_SIZE) {
-                len = buffer_get_next(ch->incoming, HEADER_SIZE - header_read, &ptr);
-                memcpy(header_buf + header_read, ptr, len);
-                header_read += len;
+            header_t h;
+            header_from_buffer(&h, ch->in_hdr);
+            if (!check_frame_size(ch, &h)) {
+                return;
             }
 
-            assert(header_read == HEADER_SIZE);
+            // frames that do not fit into pooled message are assembled only after all of their bytes arrived,
+            // until then they stay in (recycled) read buffers, so that memory use follows bytes received
+            size_t rest = (size_t) h.headers_len + h.body_len;
+            if (sizeof(message) + HEADER_SIZE + rest > pool_mem_size(ch->in_msg_pool) &&
+                buffer_available(ch->incoming) < rest) {
+                break;
+            }
 
-            ch->in_next = message_new_from_header(ch->in_msg_pool, header_buf);
+            ch->in_next = message_new_from_header(ch->in_msg_pool, ch->in_hdr);
+            ch->ctx->path_stats.msgs_framed++;
             ch->in_body_offset = 0;
+            ch->in_hdr_read = false;
 
             CH_LOG(TRACE, "<= ct[%04X] seq[%d] len[%d] hdrs[%d]", ch->in_next->header.content,
                    ch->in_next->header.seq,
@@ -572,6 +1073,7 @@ static void process_inbound(ziti_channel_t *ch) {
         }
         if (len > 0) {
             memcpy(ch->in_next->headers + ch->in_body_offset, ptr, (size_t) len);
+            ch->ctx->path_stats.bytes_copied += len;
             ch->in_body_offset += len;
 
             if (ch->in_body_offset == total) {
@@ -590,6 +1092,7 @@ static void process_inbound(ziti_channel_t *ch) {
 
 static void latency_reply_cb(void *ctx, message *reply, int err) {
     ziti_channel_t *ch = ctx;
+    ch->latency_waiter = NULL;
 
     if (err) {
         CH_LOG(DEBUG, "latency probe was canceled: %d(%s)", err, ziti_errorstr(err));
@@ -600,18 +1103,20 @@ static void latency_reply_cb(void *ctx, message *reply, int err) {
     uint64_t ts;
     if (reply->header.content == ContentTypeResultType &&
         message_get_uint64_header(reply, LatencyProbeTime, &ts)) {
-        ch->latency = uv_now(ch->loop) - ts;
-        CH_LOG(VERBOSE, "latency is now %llu", (unsigned long long)ch->latency);
+        update_rtt(ch, uv_now(ch->loop) - ts);
+        CH_LOG(VERBOSE, "latency is now %llu srtt[%llu] rttvar[%llu]", (unsigned long long) ch->latency,
+               (unsigned long long) ch->srtt, (unsigned long long) ch->rttvar);
     } else {
         CH_LOG(WARN, "invalid latency probe result ct[%04X]", reply->header.content);
     }
-    uv_timer_start(ch->timer, send_latency_probe, LATENCY_INTERVAL, 0);
+    uv_timer_start(ch->timer, send_latency_probe, next_probe_interval(ch), 0);
 }
 
 static void latency_timeout(uv_timer_t *t) {
     ziti_channel_t *ch = t->data;
     if (uv_now(t->loop) - MAX(ch->last_read, ch->last_write) < LATENCY_TIMEOUT) {
         CH_LOG(DEBUG, "latency timeout on active channel, extending timeout");
+        health_error(ch);
         uv_timer_start(t, latency_timeout, LATENCY_TIMEOUT, 0);
     }
     else {
@@ -621,8 +1126,7 @@ static void latency_timeout(uv_timer_t *t) {
         ch->latency_waiter = NULL;
         ch->latency = UINT64_MAX;
 
-        tlsuv_stream_close(ch->connection, on_tls_close);
-        ch->connection = NULL;
+        ch_close_stream(ch);
         on_channel_close(ch, ZITI_TIMEOUT, UV_ETIMEDOUT);
     }
 }
@@ -648,6 +1152,7 @@ static void hello_reply_cb(void *ctx, message *msg, int err) {
     int cb_code = ZITI_OK;
     ziti_channel_t *ch = ctx;
     bool success = false;
+    handshake_done(ch);
 
     if (msg && msg->header.content == ContentTypeResultType) {
         message_get_bool_header(msg, ResultSuccessHeader, &success);
@@ -670,8 +1175,8 @@ static void hello_reply_cb(void *ctx, message *msg, int err) {
         FREE(ch->version);
         ch->version = strndup(erVersion, erVersionLen);
         ch->notify_cb(ch, EdgeRouterConnected, ch->notify_ctx);
-        ch->latency = uv_now(ch->loop) - ch->latency;
-        uv_timer_start(ch->timer, send_latency_probe, LATENCY_INTERVAL, 0);
+        update_rtt(ch, uv_now(ch->loop) - ch->latency);
+        uv_timer_start(ch->timer, send_latency_probe, next_probe_interval(ch), 0);
     }
     else {
         if (msg)
@@ -679,8 +1184,7 @@ static void hello_reply_cb(void *ctx, message *msg, int err) {
 
         ch->state = Disconnected;
         ch->notify_cb(ch, EdgeRouterUnavailable, ch->notify_ctx);
-        tlsuv_stream_close(ch->connection, on_tls_close);
-        ch->connection = NULL;
+        ch_close_stream(ch);
         reconnect_channel(ch, false);
     }
 
@@ -708,19 +1212,66 @@ static void send_hello(ziti_channel_t *ch, ziti_api_session *session) {
 static void ch_connect_timeout(uv_timer_t *t) {
     ziti_channel_t *ch = t->data;
     CH_LOG(ERROR, "connect timeout");
+    handshake_done(ch);
 
     if (ch->state == Closed) {
         return;
     }
 
     ch->state = Disconnected;
-    if (ch->connection->conn_req == NULL) {
+    if (ch->connection && ch->connection->conn_req == NULL) {
         // diagnostics
         CH_LOG(WARN, "diagnostics: no conn_req in connect timeout");
     }
     reconnect_channel(ch, false);
-    tlsuv_stream_close(ch->connection, on_tls_close);
-    ch->connection = NULL;
+    ch_close_stream(ch);
+}
+
+// channels waiting for pending dials go first, then the ones that lost connections, then the longest waiting
+static bool reconnect_before(ziti_channel_t *lh, ziti_channel_t *rh) {
+    bool lh_dial = !LIST_EMPTY(&lh->conn_reqs);
+    bool rh_dial = !LIST_EMPTY(&rh->conn_reqs);
+    if (lh_dial != rh_dial) return lh_dial;
+
+    bool lh_conns = lh->lost_conns > 0;
+    bool rh_conns = rh->lost_conns > 0;
+    if (lh_conns != rh_conns) return lh_conns;
+
+    return lh->queued_at <= rh->queued_at;
+}
+
+static bool handshake_limit_reached(ziti_context ztx) {
+    return ztx->opts.router_handshake_limit > 0 && ztx->handshakes_inflight >= ztx->opts.router_handshake_limit;
+}
+
+static void dequeue_reconnect(ziti_channel_t *ch) {
+    if (ch->reconnect_queued) {
+        LIST_REMOVE(ch, reconnect_next);
+        ch->reconnect_queued = false;
+    }
+}
+
+static void handshake_done(ziti_channel_t *ch) {
+    if (!ch->handshaking) {
+        return;
+    }
+
+    ziti_context ztx = ch->ctx;
+    ch->handshaking = false;
+    ztx->handshakes_inflight--;
+
+    while (!handshake_limit_reached(ztx) && !LIST_EMPTY(&ztx->reconnect_q)) {
+        ziti_channel_t *next = LIST_FIRST(&ztx->reconnect_q);
+        ziti_channel_t *c;
+        LIST_FOREACH(c, &ztx->reconnect_q, reconnect_next) {
+            if (reconnect_before(c, next)) {
+                next = c;
+            }
+        }
+        dequeue_reconnect(next);
+        ZTX_LOG(DEBUG, "ch[%d] handshake slot available", next->id);
+        reconnect_cb(next->timer);
+    }
 }
 
 static void reconnect_cb(uv_timer_t *t) {
@@ -731,7 +1282,16 @@ static void reconnect_cb(uv_timer_t *t) {
         CH_LOG(ERROR, "ziti context is not fully authenticated (api_session_state[%d]), delaying re-connect", ztx->api_session_state);
         reconnect_channel(ch, false);
     }
+    else if (handshake_limit_reached(ztx)) {
+        CH_LOG(DEBUG, "%u handshakes in progress, waiting to reconnect", ztx->handshakes_inflight);
+        dequeue_reconnect(ch);
+        ch->reconnect_queued = true;
+        ch->queued_at = uv_now(ch->loop);
+        LIST_INSERT_HEAD(&ztx->reconnect_q, ch, reconnect_next);
+    }
     else {
+        ch->handshaking = true;
+        ztx->handshakes_inflight++;
         ch->msg_seq = 0;
 
         uv_connect_t *req = calloc(1, sizeof(uv_connect_t));
@@ -742,8 +1302,17 @@ static void reconnect_cb(uv_timer_t *t) {
 
         CH_LOG(DEBUG, "connecting to %s", ch->url);
 
-        int rc = tlsuv_stream_connect(req, ch->connection, ch->host, ch->port, on_channel_connect_internal);
-        if (rc != 0) {
+        // every connect is a full TLS handshake: session tickets are not resumed, since tlsuv has no API
+        // to export/import TLS sessions. handshakes/handshake_total in ziti_dump measure the cost
+        ch->connect_start = uv_now(ch->loop);
+        int rc = CH_TRANSPORT(ch) ?
+                 CH_TRANSPORT(ch)->connect(CH_TRANSPORT_CTX(ch), ch, ch->host, ch->port) :
+                 tlsuv_stream_connect(req, ch->connection, ch->host, ch->port, on_channel_connect_internal);
+        if (CH_TRANSPORT(ch) && rc == 0) {
+            // completed by ziti_channel_transport_connected()
+            free(req);
+            uv_timer_start(ch->timer, ch_connect_timeout, CONNECT_TIMEOUT, 0);
+        } else if (rc != 0) {
             on_channel_connect_internal(req, rc);
         } else {
             uv_timer_start(ch->timer, ch_connect_timeout, CONNECT_TIMEOUT, 0);
@@ -757,16 +1326,24 @@ static void reconnect_channel(ziti_channel_t *ch, bool now) {
         return;
     }
 
+    // not waiting for handshake slot anymore, timer decides
+    dequeue_reconnect(ch);
+
     uint64_t timeout = 0;
     if (!now) {
         ch->reconnect_count++;
-        int backoff = MIN(ch->reconnect_count, MAX_BACKOFF);
 
+        // decorrelated jitter: random between base and 3x previous delay,
+        // keeps clients that lost routers at the same time from reconnecting in lockstep
+        uint64_t prev = MAX(ch->reconnect_delay, RECONNECT_BASE);
         uint32_t random;
         uv_random(ch->loop, NULL, &random, sizeof(random), 0, NULL);
 
-        timeout = random % ((1U << backoff) * BACKOFF_TIME);
+        timeout = RECONNECT_BASE + random % (prev * 3 - RECONNECT_BASE + 1);
+        timeout = MIN(timeout, RECONNECT_CAP);
+        ch->reconnect_delay = timeout;
         CH_LOG(INFO, "reconnecting in %" PRIu64 "ms (attempt = %d)", timeout, ch->reconnect_count);
+        ch->notify_cb(ch, EdgeRouterReconnecting, ch->notify_ctx);
     }
     else {
         CH_LOG(INFO, "reconnecting NOW");
@@ -784,16 +1361,28 @@ static void on_channel_close(ziti_channel_t *ch, int ziti_err, ssize_t uv_err) {
     if (ch->state == Connected) {
         ch->notify_cb(ch, EdgeRouterDisconnected, ch->notify_ctx);
     }
+    handshake_done(ch);
     ch->state = Disconnected;
+    ch->lost_conns = model_map_size(&ch->receivers);
+    fail_pending_writes(ch, (int) (uv_err ? uv_err : UV_ECANCELED));
 
     ch->latency = UINT64_MAX;
+    ch->srtt = 0;
+    ch->rttvar = 0;
+    ch->rtt_count = 0;
+    ch->rtt_min = 0;
+    ch->health_errors = 0;
+    ch->degraded = false;
     if (uv_is_active((const uv_handle_t *) &ch->timer)) {
         uv_timer_stop(ch->timer);
     }
 
-    while (!LIST_EMPTY(&ch->waiters)) {
-        struct waiter_s *w = LIST_FIRST(&ch->waiters);
-        LIST_REMOVE(w, next);
+    // callbacks may remove other waiters, so start over every time
+    while (model_map_size(&ch->waiters) > 0) {
+        model_map_iter it = model_map_iterator(&ch->waiters);
+        struct waiter_s *w = model_map_it_value(it);
+        model_map_it_remove(it);
+        wheel_timer_stop(&w->timeout);
         w->cb(w->reply_ctx, NULL, ziti_err);
         free(w);
     }
@@ -814,6 +1403,7 @@ static void on_channel_close(ziti_channel_t *ch, int ziti_err, ssize_t uv_err) {
         pool_return_obj(ch->in_next);
         ch->in_next = NULL;
     }
+    ch->in_hdr_read = false;
 
     if (ch->state != Closed) {
         if (uv_err == UV_EOF) {
@@ -828,15 +1418,17 @@ static void channel_alloc_cb(uv_handle_t *handle, size_t suggested_size, uv_buf_
     tlsuv_stream_t *mbed = (tlsuv_stream_t *) handle;
     ziti_channel_t *ch = mbed->data;
     if (ch->in_next || pool_has_available(ch->in_msg_pool)) {
-        buf->base = (char *) malloc(suggested_size);
+        size_t len;
+        buf->base = (char *) buffer_slab_alloc(ch->ctx->read_bufs, &len);
         if (buf->base == NULL) {
-            ZITI_LOG(ERROR, "failed to allocate %zd bytes. Prepare for crash", suggested_size);
+            ZITI_LOG(ERROR, "failed to allocate read buffer. Prepare for crash");
             buf->len = 0;
         } else {
-            buf->len = suggested_size;
+            buf->len = len;
         }
     } else {
         CH_LOG(DEBUG, "message pool is empty. stop reading until available");
+        ch->ctx->path_stats.read_stalls++;
 
         buf->len = 0;
         buf->base = NULL;
@@ -848,7 +1440,7 @@ static void on_channel_data(uv_stream_t *s, ssize_t len, const uv_buf_t *buf) {
     ziti_channel_t *ch = ssl->data;
 
     if (len < 0) {
-        free(buf->base);
+        buffer_slab_release((uint8_t *) buf->base);
         switch (len) {
             case UV_ENOBUFS:
                 tlsuv_stream_read_stop(ssl);
@@ -872,33 +1464,70 @@ static void on_channel_data(uv_stream_t *s, ssize_t len, const uv_buf_t *buf) {
         }
     } else if (len == 0) {
         // sometimes SSL message has no payload
-        free(buf->base);
+        buffer_slab_release((uint8_t *) buf->base);
     } else {
         CH_LOG(TRACE, "on_data [len=%zd]", len);
         ch->last_read = uv_now(ch->loop);
-        buffer_append(ch->incoming, buf->base, (uint32_t) len);
+        buffer_append_slab(ch->incoming, (uint8_t *) buf->base, (uint32_t) len);
         process_inbound(ch);
     }
 }
 
+#if defined(ZITI_TEST_TRANSPORT)
+void ziti_channel_transport_input(ziti_channel_t *ch, const uint8_t *data, ssize_t len) {
+    if (len < 0) {
+        CH_LOG(INFO, "channel was closed [%zd/%s]", len, uv_strerror((int) len));
+        on_channel_close(ch, ZITI_CONNABORT, len);
+        ch_close_stream(ch);
+        return;
+    }
+
+    CH_LOG(TRACE, "on_data [len=%zd]", len);
+    ch->last_read = uv_now(ch->loop);
+    while (len > 0) {
+        size_t cap;
+        uint8_t *slab = buffer_slab_alloc(ch->ctx->read_bufs, &cap);
+        size_t n = MIN(cap, (size_t) len);
+        memcpy(slab, data, n);
+        buffer_append_slab(ch->incoming, slab, (uint32_t) n);
+        data += n;
+        len -= (ssize_t) n;
+    }
+    process_inbound(ch);
+}
+
+void ziti_channel_transport_connected(ziti_channel_t *ch, int status) {
+    uv_connect_t *req = calloc(1, sizeof(uv_connect_t));
+    req->data = ch;
+    on_channel_connect_internal(req, status);
+}
+#endif
+
 static void on_channel_connect_internal(uv_connect_t *req, int status) {
     ziti_channel_t *ch = req->data;
 
     if (status == 0) {
         if (ch->ctx->api_session != NULL && ch->ctx->api_session->token != NULL) {
-            CH_LOG(DEBUG, "connected");
-            tlsuv_stream_t *mbed = (tlsuv_stream_t *) req->handle;
-            tlsuv_stream_read_start(mbed, channel_alloc_cb, on_channel_data);
+            ch->handshakes++;
+            ch->handshake_last = uv_now(ch->loop) - ch->connect_start;
+            ch->handshake_total += ch->handshake_last;
+            CH_LOG(DEBUG, "connected in %" PRIu64 "ms", ch->handshake_last);
+            if (ch->connection) {
+                tlsuv_stream_read_start(ch->connection, channel_alloc_cb, on_channel_data);
+            }
             ch->reconnect_count = 0;
+            ch->reconnect_delay = 0;
+            ch->lost_conns = 0;
             send_hello(ch, ch->ctx->api_session);
         } else {
             CH_LOG(WARN, "api session invalidated, while connecting");
-            tlsuv_stream_close(ch->connection, on_tls_close);
-            ch->connection = NULL;
+            handshake_done(ch);
+            ch_close_stream(ch);
             reconnect_channel(ch, false);
         }
     } else {
         CH_LOG(ERROR, "failed to connect to ER[%s] [%d/%s]", ch->name, status, uv_strerror(status));
+        handshake_done(ch);
 
         while (!LIST_EMPTY(&ch->conn_reqs)) {
             struct ch_conn_req *r = LIST_FIRST(&ch->conn_reqs);
@@ -907,8 +1536,7 @@ static void on_channel_connect_internal(uv_connect_t *req, int status) {
             free(r);
         }
 
-        tlsuv_stream_close(ch->connection, on_tls_close);
-        ch->connection = NULL;
+        ch_close_stream(ch);
 
         if (ch->state != Closed) {
             ch->state = Disconnected;
@@ -12,12 +12,47 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#if defined(__linux__)
+#define _GNU_SOURCE // recvmmsg/sendmmsg
+#endif
+
 #include "zt_internal.h"
 #include "utils.h"
+#include "connect.h"
+
+#if defined(__linux__)
+#include <netinet/udp.h>
+#include <sys/socket.h>
+#define BRIDGE_UDP_BATCH 16
+// stays under the max size of a GSO send
+#define BRIDGE_UDP_TX_SIZE (60 * 1024)
+#define BRIDGE_GSO_MAX_SEGMENTS 64
+// larger segments would not fit typical path MTU, kernel rejects those
+#define BRIDGE_GSO_MAX_SEG_SIZE 1472
+#endif
 
 #define BRIDGE_MSG_SIZE (32 * 1024)
 #define BRIDGE_POOL_SIZE 16
 
+// stream input buffers grow and shrink between these (see ziti_conn_bridge_buffers())
+#define BRIDGE_MIN_BUF_SIZE 1024
+#define BRIDGE_DEFAULT_MAX_BUF_SIZE (128 * 1024)
+#define BRIDGE_SIZE_CLASSES 8
+// total input of a stream bridge in flight, regardless of buffer size
+#define BRIDGE_INPUT_WINDOW (BRIDGE_POOL_SIZE * BRIDGE_MSG_SIZE)
+// consecutive full reads before buffer is grown, and short reads (less than 1/4 of buffer) before it is shrunk
+#define BRIDGE_GROW_READS 4
+#define BRIDGE_SHRINK_READS 16
+
+// max received chunks gathered into a single write to the local stream
+#define BRIDGE_OUT_IOV 32
+
+#if !defined(_WIN32)
+#include <sys/stat.h>
+// regular file input, read with a single preadv on the threadpool
+#define BRIDGE_FILE_IOV 4
+#endif
+
 #define BR_LOG(lvl, fmt, ...) ZITI_LOG(lvl, "br[%d.%d] " fmt, \
 br ? br->conn->ziti_ctx->id : -1, br ? br->conn->conn_id : -1, ##__VA_ARGS__)
 
@@ -30,6 +65,22 @@ struct fd_bridge_s {
     void *ctx;
 };
 
+#if defined(BRIDGE_UDP_BATCH)
+// bridged datagram fd, polled directly so that it can be read and written in batches
+struct udp_batch_s {
+    uv_os_fd_t fd;
+    int events;
+    bool gso;
+    uv_prepare_t *flusher;
+
+    // datagrams from ziti, sent on the next flush
+    unsigned int tx_count;
+    size_t tx_used;
+    struct iovec tx_iov[BRIDGE_UDP_BATCH];
+    char tx_buf[BRIDGE_UDP_TX_SIZE];
+};
+#endif
+
 struct ziti_bridge_s {
     bool closed;
     bool ziti_eof;
@@ -44,16 +95,103 @@ struct ziti_bridge_s {
     bool input_throttle;
     unsigned long idle_timeout;
     uv_timer_t *idle_timer;
+
+    // adaptive stream input buffers
+    size_t buf_min;
+    size_t buf_max;
+    size_t buf_size;
+    size_t in_flight;
+    int full_reads;
+    int short_reads;
+    pool_t *size_pools[BRIDGE_SIZE_CLASSES];
+
+    // data from ziti is written to the local stream once per loop iteration
+    uv_prepare_t *out_flusher;
+    int out_pending;
+    bool free_pending;
+
+#if defined(BRIDGE_UDP_BATCH)
+    struct udp_batch_s *udp;
+#endif
+#if defined(BRIDGE_FILE_IOV)
+    struct file_input_s *file;
+#endif
+};
+
+#if defined(BRIDGE_FILE_IOV)
+// regular files cannot be polled, they are read straight into ziti message buffers instead
+struct file_input_s {
+    uv_fs_t req;
+    uv_file fd;
+    bool reading;
+    uv_buf_t bufs[BRIDGE_FILE_IOV];
+};
+#endif
+
+// remainder of a coalesced write that the stream did not take right away
+struct bridge_write_s {
+    uv_write_t req;
+    struct ziti_bridge_s *br;
+    char data[];
 };
 
 static ssize_t on_ziti_data(ziti_connection conn, const uint8_t *data, ssize_t len);
+static void on_ziti_readable(ziti_connection conn, size_t available);
 
 static void bridge_alloc(uv_handle_t *h, size_t req, uv_buf_t *b);
 static void close_bridge(struct ziti_bridge_s *br);
+static int bridge_start_input(struct ziti_bridge_s *br);
 
 static void on_input(uv_stream_t *s, ssize_t len, const uv_buf_t *b);
+static void on_ziti_write(ziti_connection conn, ssize_t status, void *ctx);
 static void on_udp_input(uv_udp_t *udp, ssize_t len, const uv_buf_t *b, const struct sockaddr *addr, unsigned int flags);
 
+#if defined(BRIDGE_UDP_BATCH)
+static void on_udp_poll(uv_poll_t *p, int status, int events);
+#endif
+
+#if defined(BRIDGE_FILE_IOV)
+static int file_read(struct ziti_bridge_s *br);
+static void file_close(struct ziti_bridge_s *br);
+#endif
+
+static bool is_dgram(const struct ziti_bridge_s *br) {
+    return br->input->type == UV_UDP || br->input->type == UV_POLL;
+}
+
+static struct ziti_bridge_s *new_bridge(ziti_connection conn, uv_handle_t *input, uv_handle_t *output) {
+    NEWP(br, struct ziti_bridge_s);
+    br->conn = conn;
+    br->input = input;
+    br->output = output;
+    br->buf_min = BRIDGE_MSG_SIZE;
+    br->buf_max = BRIDGE_DEFAULT_MAX_BUF_SIZE;
+    br->buf_size = br->buf_min;
+    if (is_dgram(br)) {
+        br->input_pool = pool_new(BRIDGE_MSG_SIZE, BRIDGE_POOL_SIZE, NULL);
+    }
+    return br;
+}
+
+static int bridge_connect(struct ziti_bridge_s *br) {
+    ziti_conn_set_data(br->conn, br);
+    ziti_conn_set_data_cb(br->conn, on_ziti_data);
+    if (!is_dgram(br)) {
+        // pull mode: received data is gathered and written to the stream in one go,
+        // EOF and errors still come through on_ziti_data()
+        ziti_conn_set_readable_cb(br->conn, on_ziti_readable);
+    }
+
+    int rc = bridge_start_input(br);
+    if (rc != 0) {
+        BR_LOG(WARN, "failed to start reading handle: %d/%s", rc, uv_strerror(rc));
+        close_bridge(br);
+    } else {
+        BR_LOG(DEBUG, "connected");
+    }
+    return ZITI_OK;
+}
+
 extern int ziti_conn_bridge(ziti_connection conn, uv_handle_t *handle, uv_close_cb on_close) {
     if (handle == NULL) return UV_EINVAL;
 
@@ -72,30 +210,12 @@ extern int ziti_conn_bridge(ziti_connection conn, uv_handle_t *handle, uv_close_
         }
     }
 
-    NEWP(br, struct ziti_bridge_s);
-    br->conn = conn;
-    br->input = handle;
-    br->output = handle;
+    struct ziti_bridge_s *br = new_bridge(conn, handle, handle);
     br->close_cb = on_close;
     br->data = uv_handle_get_data(handle);
-    br->input_pool = pool_new(BRIDGE_MSG_SIZE, BRIDGE_POOL_SIZE, NULL);
 
     uv_handle_set_data(handle, br);
-    ziti_conn_set_data(conn, br);
-
-    ziti_conn_set_data_cb(conn, on_ziti_data);
-    int rc = (br->input->type == UV_UDP) ?
-             uv_udp_recv_start((uv_udp_t *) br->input, bridge_alloc, on_udp_input) :
-             uv_read_start((uv_stream_t *) br->input, bridge_alloc, on_input);
-
-    if (rc != 0) {
-        BR_LOG(WARN, "failed to start reading handle: %d/%s", rc, uv_strerror(rc));
-        close_bridge(br);
-    } else {
-        BR_LOG(DEBUG, "connected");
-    }
-
-    return ZITI_OK;
+    return bridge_connect(br);
 }
 
 static void on_sock_close(uv_handle_t *h) {
@@ -121,6 +241,52 @@ static void on_pipes_close(uv_handle_t *h) {
     }
 }
 
+#if defined(BRIDGE_UDP_BATCH)
+static void on_udp_poll_close(uv_handle_t *h) {
+    // uv_poll does not own the fd, close it the same way uv_udp would
+    int fd;
+    if (uv_fileno(h, (uv_os_fd_t *) &fd) == 0) {
+        uv_poll_stop((uv_poll_t *) h);
+        close(fd);
+    }
+    on_sock_close(h);
+}
+
+static int bridge_udp_fd(ziti_connection conn, uv_loop_t *l, uv_os_fd_t fd, struct fd_bridge_s *fdbr) {
+    struct sockaddr_storage peer;
+    socklen_t len = sizeof(peer);
+    if (getpeername(fd, (struct sockaddr *) &peer, &len) != 0) {
+        ZITI_LOG(ERROR, "cannot bridge unconnected socket: %d/%s", errno, strerror(errno));
+        return UV_EINVAL;
+    }
+
+    uv_poll_t *poll = calloc(1, sizeof(uv_poll_t));
+    int rc = uv_poll_init(l, poll, fd);
+    if (rc != 0) {
+        free(poll);
+        return rc;
+    }
+    poll->data = fdbr;
+
+    struct ziti_bridge_s *br = new_bridge(conn, (uv_handle_t *) poll, (uv_handle_t *) poll);
+    br->close_cb = on_udp_poll_close;
+    br->data = fdbr;
+
+    NEWP(udp, struct udp_batch_s);
+    udp->fd = fd;
+    udp->flusher = calloc(1, sizeof(uv_prepare_t));
+    uv_prepare_init(l, udp->flusher);
+    udp->flusher->data = br;
+#if defined(UDP_SEGMENT)
+    udp->gso = peer.ss_family == AF_INET || peer.ss_family == AF_INET6;
+#endif
+    br->udp = udp;
+
+    uv_handle_set_data((uv_handle_t *) poll, br);
+    return bridge_connect(br);
+}
+#endif
+
 extern int ziti_conn_bridge_fds(ziti_connection conn, uv_os_fd_t input, uv_os_fd_t output, void (*close_cb)(void *ctx), void *ctx) {
     uv_loop_t *l = ziti_conn_context(conn)->loop;
 
@@ -140,9 +306,18 @@ extern int ziti_conn_bridge_fds(ziti_connection conn, uv_os_fd_t input, uv_os_fd
                 uv_tcp_init(l, (uv_tcp_t *) sock);
                 uv_tcp_open((uv_tcp_t *) sock, input);
             } else if (type == SOCK_DGRAM) {
+#if defined(BRIDGE_UDP_BATCH)
+                // uv_poll_init() makes it non-blocking
+                int rc = bridge_udp_fd(conn, l, input, fdbr);
+                if (rc != 0) {
+                    free(fdbr);
+                }
+                return rc;
+#else
                 sock = calloc(1, sizeof(uv_udp_t));
                 uv_udp_init(l, (uv_udp_t *) sock);
                 uv_udp_open((uv_udp_t *) sock, input);
+#endif
             }
         }
         if (sock) {
@@ -155,16 +330,30 @@ extern int ziti_conn_bridge_fds(ziti_connection conn, uv_os_fd_t input, uv_os_fd
         return ziti_conn_bridge(conn, sock, on_sock_close);
     }
 
-    NEWP(br, struct ziti_bridge_s);
-    br->conn = conn;
-    br->input = calloc(1, sizeof(uv_pipe_t));
-    br->output = calloc(1, sizeof(uv_pipe_t));
-    br->input_pool = pool_new(BRIDGE_MSG_SIZE, BRIDGE_POOL_SIZE, NULL);
-
-    uv_pipe_init(l, (uv_pipe_t *) br->input, 0);
-    uv_pipe_init(l, (uv_pipe_t *) br->output, 0);
-    uv_pipe_open((uv_pipe_t *) br->input, input);
-    uv_pipe_open((uv_pipe_t *) br->output, output);
+    uv_handle_t *in = calloc(1, sizeof(uv_pipe_t));
+    uv_handle_t *out = calloc(1, sizeof(uv_pipe_t));
+    uv_pipe_init(l, (uv_pipe_t *) in, 0);
+    uv_pipe_init(l, (uv_pipe_t *) out, 0);
+    uv_pipe_open((uv_pipe_t *) out, output);
+
+#if defined(BRIDGE_FILE_IOV)
+    struct file_input_s *file = NULL;
+    struct stat st;
+    if (fstat(input, &st) == 0 && S_ISREG(st.st_mode)) {
+        // [in] stays unopened, it only stands for the input side
+        file = calloc(1, sizeof(*file));
+        file->fd = input;
+#if defined(POSIX_FADV_SEQUENTIAL)
+        posix_fadvise(input, 0, 0, POSIX_FADV_SEQUENTIAL);
+#endif
+    } else
+#endif
+    uv_pipe_open((uv_pipe_t *) in, input);
+
+    struct ziti_bridge_s *br = new_bridge(conn, in, out);
+#if defined(BRIDGE_FILE_IOV)
+    br->file = file;
+#endif
     br->input->data = br;
     br->output->data = br;
 
@@ -174,17 +363,7 @@ extern int ziti_conn_bridge_fds(ziti_connection conn, uv_os_fd_t input, uv_os_fd
     br->fdbr = fdbr;
 
     uv_handle_set_data(br->input, br);
-    ziti_conn_set_data(conn, br);
-
-    ziti_conn_set_data_cb(conn, on_ziti_data);
-    int rc = uv_read_start((uv_stream_t *) br->input, bridge_alloc, on_input);
-    if (rc != 0) {
-        BR_LOG(WARN, "failed to start reading handle: %d/%s", rc, uv_strerror(rc));
-        close_bridge(br);
-    } else {
-        BR_LOG(DEBUG, "connected");
-    }
-    return ZITI_OK;
+    return bridge_connect(br);
 }
 
 static void on_bridge_idle(uv_timer_t *t) {
@@ -213,18 +392,116 @@ int ziti_conn_bridge_idle_timeout(ziti_connection conn, unsigned long millis) {
     return 0;
 }
 
-static void on_ziti_close(ziti_connection conn) {
+static void destroy_size_pools(struct ziti_bridge_s *br) {
+    for (int i = 0; i < BRIDGE_SIZE_CLASSES; i++) {
+        if (br->size_pools[i]) {
+            // buffers still in flight are freed when returned
+            pool_destroy(br->size_pools[i]);
+            br->size_pools[i] = NULL;
+        }
+    }
+}
+
+int ziti_conn_bridge_buffers(ziti_connection conn, size_t min_size, size_t max_size) {
     struct ziti_bridge_s *br = ziti_conn_data(conn);
-    pool_destroy(br->input_pool);
+    if (br == NULL) return UV_EINVAL;
+
+    if (min_size < BRIDGE_MIN_BUF_SIZE || max_size < min_size ||
+        max_size > (min_size << (BRIDGE_SIZE_CLASSES - 1))) {
+        return UV_EINVAL;
+    }
+
+    // size classes are relative to min_size
+    destroy_size_pools(br);
+    br->buf_min = min_size;
+    br->buf_max = max_size;
+    br->buf_size = MIN(MAX(br->buf_size, min_size), max_size);
+    br->full_reads = 0;
+    br->short_reads = 0;
+    return 0;
+}
+
+// buffers of each size class come from their own pool
+static pool_t *size_pool(struct ziti_bridge_s *br, size_t size) {
+    int idx = 0;
+    for (size_t s = br->buf_min; s < size && idx < BRIDGE_SIZE_CLASSES - 1; s = MIN(s * 2, br->buf_max)) {
+        idx++;
+    }
+
+    if (br->size_pools[idx] == NULL) {
+        br->size_pools[idx] = pool_new(size, BRIDGE_INPUT_WINDOW / size + 1, NULL);
+    }
+    return br->size_pools[idx];
+}
+
+// input that keeps filling up its buffers gets larger ones: fewer reads and writes per byte
+static void bridge_adapt(struct ziti_bridge_s *br, size_t len, size_t buf_len) {
+    if (br->buf_min == br->buf_max) {
+        return;
+    }
+
+    if (len == buf_len) {
+        br->short_reads = 0;
+        if (++br->full_reads >= BRIDGE_GROW_READS && br->buf_size < br->buf_max) {
+            br->buf_size = MIN(br->buf_size * 2, br->buf_max);
+            br->full_reads = 0;
+            BR_LOG(TRACE, "input buffer size => %zu", br->buf_size);
+        }
+    } else if (len < buf_len / 4) {
+        br->full_reads = 0;
+        if (++br->short_reads >= BRIDGE_SHRINK_READS && br->buf_size > br->buf_min) {
+            br->buf_size = MAX(br->buf_size / 2, br->buf_min);
+            br->short_reads = 0;
+            BR_LOG(TRACE, "input buffer size => %zu", br->buf_size);
+        }
+    } else {
+        br->full_reads = 0;
+        br->short_reads = 0;
+    }
+}
+
+static void free_bridge(struct ziti_bridge_s *br) {
+    if (br->input_pool) {
+        pool_destroy(br->input_pool);
+    }
+    destroy_size_pools(br);
+#if defined(BRIDGE_UDP_BATCH)
+    free(br->udp);
+#endif
+#if defined(BRIDGE_FILE_IOV)
+    free(br->file);
+#endif
     free(br);
 }
 
+static void on_ziti_close(ziti_connection conn) {
+    struct ziti_bridge_s *br = ziti_conn_data(conn);
+    if (br->out_pending > 0) {
+        // output writes still reference the bridge
+        br->free_pending = true;
+        return;
+    }
+    free_bridge(br);
+}
+
 static void close_bridge(struct ziti_bridge_s *br) {
     if (br == NULL || br->closed) { return; }
 
     BR_LOG(DEBUG, "closing");
     br->closed = true;
 
+    if (br->out_flusher) {
+        uv_close((uv_handle_t *) br->out_flusher, (uv_close_cb) free);
+        br->out_flusher = NULL;
+    }
+
+#if defined(BRIDGE_UDP_BATCH)
+    if (br->udp && br->udp->flusher) {
+        uv_close((uv_handle_t *) br->udp->flusher, (uv_close_cb) free);
+        br->udp->flusher = NULL;
+    }
+#endif
+
     if (br->input) {
         uv_handle_set_data((uv_handle_t *) br->input, br->data);
         br->close_cb((uv_handle_t *) br->input);
@@ -236,6 +513,15 @@ static void close_bridge(struct ziti_bridge_s *br) {
         br->idle_timer = NULL;
     }
 
+#if defined(BRIDGE_FILE_IOV)
+    if (br->file) {
+        if (br->file->reading) {
+            // read buffers belong to the connection, it is closed once the read completes
+            return;
+        }
+        file_close(br);
+    }
+#endif
     ziti_close(br->conn, on_ziti_close);
 }
 
@@ -250,6 +536,356 @@ static void on_shutdown(uv_shutdown_t *sr, int status) {
     free(sr);
 }
 
+#if defined(BRIDGE_UDP_BATCH)
+static void udp_poll_update(struct ziti_bridge_s *br) {
+    // u->events only tracks waiting for writable, readable follows input throttle
+    int events = br->udp->events & UV_WRITABLE;
+    if (!br->input_throttle) {
+        events |= UV_READABLE;
+    }
+    if (events == 0) {
+        uv_poll_stop((uv_poll_t *) br->input);
+    } else {
+        uv_poll_start((uv_poll_t *) br->input, events, on_udp_poll);
+    }
+}
+
+static void udp_tx_consume(struct udp_batch_s *u, unsigned int count) {
+    if (count >= u->tx_count) {
+        u->tx_count = 0;
+        u->tx_used = 0;
+        return;
+    }
+    memmove(u->tx_iov, u->tx_iov + count, (u->tx_count - count) * sizeof(u->tx_iov[0]));
+    u->tx_count -= count;
+}
+
+#if defined(UDP_SEGMENT)
+// same size datagrams (the last one may be shorter) go out in a single GSO send
+static int udp_send_gso(struct udp_batch_s *u) {
+    size_t seg = u->tx_iov[0].iov_len;
+    if (u->tx_count < 2 || u->tx_count > BRIDGE_GSO_MAX_SEGMENTS || seg > BRIDGE_GSO_MAX_SEG_SIZE) {
+        return -1;
+    }
+    for (unsigned int i = 1; i < u->tx_count; i++) {
+        size_t l = u->tx_iov[i].iov_len;
+        if (l > seg || (l < seg && i != u->tx_count - 1)) {
+            return -1;
+        }
+    }
+
+    char ctrl[CMSG_SPACE(sizeof(uint16_t))] = {0};
+    struct msghdr msg = {
+            .msg_iov = u->tx_iov,
+            .msg_iovlen = u->tx_count,
+            .msg_control = ctrl,
+            .msg_controllen = sizeof(ctrl),
+    };
+    struct cmsghdr *cm = CMSG_FIRSTHDR(&msg);
+    cm->cmsg_level = SOL_UDP;
+    cm->cmsg_type = UDP_SEGMENT;
+    cm->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+    uint16_t seg_size = (uint16_t) seg;
+    memcpy(CMSG_DATA(cm), &seg_size, sizeof(seg_size));
+
+    ssize_t rc = sendmsg(u->fd, &msg, MSG_DONTWAIT);
+    if (rc < 0) {
+        if (errno != EIO && errno != EINVAL && errno != ENOPROTOOPT) {
+            return -2; // errno is handled by the caller, same as for plain sends
+        }
+        // no GSO support for this socket/device, use plain batches from now on
+        ZITI_LOG(DEBUG, "disabling UDP GSO on fd[%d]: %d/%s", u->fd, errno, strerror(errno));
+        u->gso = false;
+        return -1;
+    }
+    return (int) u->tx_count;
+}
+#endif
+
+static void udp_flush(struct ziti_bridge_s *br) {
+    struct udp_batch_s *u = br->udp;
+
+    while (u->tx_count > 0) {
+        int sent = -1;
+#if defined(UDP_SEGMENT)
+        if (u->gso) {
+            sent = udp_send_gso(u);
+        }
+        if (sent == -2) {
+            sent = -1;
+        } else
+#endif
+        if (sent < 0) {
+            struct mmsghdr msgs[BRIDGE_UDP_BATCH];
+            memset(msgs, 0, sizeof(msgs));
+            for (unsigned int i = 0; i < u->tx_count; i++) {
+                msgs[i].msg_hdr.msg_iov = &u->tx_iov[i];
+                msgs[i].msg_hdr.msg_iovlen = 1;
+            }
+            sent = sendmmsg(u->fd, msgs, u->tx_count, MSG_DONTWAIT);
+        }
+
+        if (sent < 0) {
+            // ECONNREFUSED: ICMP port unreachable for an earlier datagram, reporting it clears the error
+            if (errno == EINTR || errno == ECONNREFUSED) continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                // wait for the socket to drain
+                u->events |= UV_WRITABLE;
+                udp_poll_update(br);
+                return;
+            }
+            BR_LOG(WARN, "write failed: %d(%s)", errno, strerror(errno));
+            close_bridge(br);
+            return;
+        }
+
+        BR_LOG(TRACE, "sent %d datagrams", sent);
+        udp_tx_consume(u, (unsigned int) sent);
+    }
+
+    if (u->flusher) {
+        uv_prepare_stop(u->flusher);
+    }
+    if (u->events & UV_WRITABLE) {
+        u->events &= ~UV_WRITABLE;
+        udp_poll_update(br);
+    }
+}
+
+// flushed right before the loop polls again, so datagrams delivered in one loop iteration share a send
+static void on_udp_flush(uv_prepare_t *p) {
+    struct ziti_bridge_s *br = p->data;
+    udp_flush(br);
+}
+
+static ssize_t udp_queue(struct ziti_bridge_s *br, const uint8_t *data, size_t len) {
+    struct udp_batch_s *u = br->udp;
+    if (br->closed) {
+        return (ssize_t) len;
+    }
+    if (len > sizeof(u->tx_buf)) {
+        BR_LOG(WARN, "dropping oversized datagram[%zu bytes]", len);
+        return (ssize_t) len;
+    }
+
+    if (u->tx_count == BRIDGE_UDP_BATCH || u->tx_used + len > sizeof(u->tx_buf)) {
+        udp_flush(br);
+        if (br->closed || u->tx_count > 0) {
+            return 0; // EWOULDBLOCK
+        }
+    }
+
+    memcpy(u->tx_buf + u->tx_used, data, len);
+    u->tx_iov[u->tx_count].iov_base = u->tx_buf + u->tx_used;
+    u->tx_iov[u->tx_count].iov_len = len;
+    u->tx_count++;
+    u->tx_used += len;
+
+    if ((u->events & UV_WRITABLE) == 0) {
+        uv_prepare_start(u->flusher, on_udp_flush);
+    }
+    return (ssize_t) len;
+}
+
+static void udp_recv_batch(struct ziti_bridge_s *br) {
+    struct udp_batch_s *u = br->udp;
+    struct mmsghdr msgs[BRIDGE_UDP_BATCH];
+    struct iovec iov[BRIDGE_UDP_BATCH];
+    void *bufs[BRIDGE_UDP_BATCH];
+
+    unsigned int count = 0;
+    while (count < BRIDGE_UDP_BATCH && (bufs[count] = pool_alloc_obj(br->input_pool)) != NULL) {
+        iov[count].iov_base = bufs[count];
+        iov[count].iov_len = pool_obj_size(bufs[count]);
+        memset(&msgs[count], 0, sizeof(msgs[count]));
+        msgs[count].msg_hdr.msg_iov = &iov[count];
+        msgs[count].msg_hdr.msg_iovlen = 1;
+        count++;
+    }
+
+    if (count == 0) {
+        BR_LOG(TRACE, "stalled");
+        br->input_throttle = true;
+        udp_poll_update(br);
+        return;
+    }
+
+    int rc = recvmmsg(u->fd, msgs, count, MSG_DONTWAIT, NULL);
+    int err = rc < 0 ? errno : 0;
+    unsigned int received = rc > 0 ? (unsigned int) rc : 0;
+
+    if (received > 0 && br->idle_timer) { // reset idle timer
+        uv_timer_start(br->idle_timer, on_bridge_idle, br->idle_timeout, 0);
+    }
+
+    unsigned int i = 0;
+    for (; i < received; i++) {
+        int wrc = ziti_write(br->conn, bufs[i], msgs[i].msg_len, on_ziti_write, bufs[i]);
+        if (wrc != ZITI_OK) {
+            BR_LOG(WARN, "ziti_write failed: %d/%s", wrc, ziti_errorstr(wrc));
+            pool_return_obj(bufs[i++]);
+            err = -1;
+            break;
+        }
+    }
+    BR_LOG(TRACE, "received %u datagrams", received);
+
+    for (; i < count; i++) {
+        pool_return_obj(bufs[i]);
+    }
+
+    if (err == -1) {
+        close_bridge(br);
+    } else if (err == ECONNREFUSED) {
+        // peer is not listening (yet), UDP bridge stays up
+        BR_LOG(DEBUG, "peer refused datagram");
+    } else if (err != 0 && err != EAGAIN && err != EWOULDBLOCK && err != EINTR) {
+        BR_LOG(WARN, "err = %d/%s", err, strerror(err));
+        close_bridge(br);
+    }
+}
+
+static void on_udp_poll(uv_poll_t *p, int status, int events) {
+    struct ziti_bridge_s *br = p->data;
+    if (status < 0) {
+        BR_LOG(WARN, "poll failed: %d/%s", status, uv_strerror(status));
+        close_bridge(br);
+        return;
+    }
+
+    if (events & UV_WRITABLE) {
+        udp_flush(br);
+    }
+    if (!br->closed && (events & UV_READABLE)) {
+        udp_recv_batch(br);
+    }
+}
+#endif
+
+static void bridge_flush_out(struct ziti_bridge_s *br);
+
+static void on_out_flush(uv_prepare_t *p) {
+    bridge_flush_out(p->data);
+}
+
+static void on_out_write(uv_write_t *req, int status) {
+    struct bridge_write_s *wr = (struct bridge_write_s *) req;
+    struct ziti_bridge_s *br = wr->br;
+    free(wr);
+
+    br->out_pending--;
+    if (br->free_pending) {
+        if (br->out_pending == 0) {
+            free_bridge(br);
+        }
+        return;
+    }
+
+    if (status != 0) {
+        if (status != UV_ECANCELED) {
+            BR_LOG(WARN, "write failed: %d(%s)", status, uv_strerror(status));
+        }
+        close_bridge(br);
+        return;
+    }
+
+    if (br->out_flusher) {
+        uv_prepare_start(br->out_flusher, on_out_flush);
+    }
+}
+
+/**
+ * writes everything received from ziti so far with as few writes as the stream allows.
+ * whatever the stream does not take right away is copied into a single queued write,
+ * nothing else is written until it completes
+ */
+static void bridge_flush_out(struct ziti_bridge_s *br) {
+    ziti_context ztx = br->conn->ziti_ctx;
+    uv_stream_t *out = (uv_stream_t *) br->output;
+    uv_buf_t iov[BRIDGE_OUT_IOV];
+
+    while (!br->closed && br->out_pending == 0) {
+        int count = conn_peek_iov(br->conn, iov, BRIDGE_OUT_IOV);
+        if (count == 0) {
+            break;
+        }
+
+        size_t total = 0;
+        for (int i = 0; i < count; i++) {
+            total += iov[i].len;
+        }
+
+        int rc = uv_try_write(out, iov, count);
+        if (rc == UV_EAGAIN) {
+            rc = 0;
+        } else if (rc < 0) {
+            BR_LOG(WARN, "write failed: %d(%s)", rc, uv_strerror(rc));
+            close_bridge(br);
+            return;
+        }
+        ztx->path_stats.bridge_writes++;
+        ztx->path_stats.bridge_write_chunks += count;
+        BR_LOG(TRACE, "wrote %d/%zu bytes in %d chunks", rc, total, count);
+
+        size_t written = (size_t) rc;
+        if (written < total) {
+            size_t rest = total - written;
+            struct bridge_write_s *wr = malloc(sizeof(*wr) + rest);
+            wr->br = br;
+            size_t off = 0, skip = written;
+            for (int i = 0; i < count; i++) {
+                if (skip >= iov[i].len) {
+                    skip -= iov[i].len;
+                    continue;
+                }
+                memcpy(wr->data + off, iov[i].base + skip, iov[i].len - skip);
+                off += iov[i].len - skip;
+                skip = 0;
+            }
+            ztx->path_stats.bytes_copied += rest;
+            ztx->path_stats.allocs++;
+
+            uv_buf_t b = uv_buf_init(wr->data, (unsigned int) rest);
+            rc = uv_write(&wr->req, out, &b, 1, on_out_write);
+            if (rc != 0) {
+                free(wr);
+                BR_LOG(WARN, "write failed: %d(%s)", rc, uv_strerror(rc));
+                close_bridge(br);
+                return;
+            }
+            br->out_pending++;
+        }
+        conn_consume(br->conn, total);
+    }
+
+    if (br->out_flusher) {
+        uv_prepare_stop(br->out_flusher);
+    }
+}
+
+static void on_ziti_readable(ziti_connection conn, size_t available) {
+    struct ziti_bridge_s *br = ziti_conn_data(conn);
+    if (br == NULL || br->closed) {
+        return;
+    }
+
+    if (br->idle_timer) { // reset idle timer
+        uv_timer_start(br->idle_timer, on_bridge_idle, br->idle_timeout, 0);
+    }
+
+    BR_LOG(TRACE, "%zu bytes available from ziti", available);
+    // flushed right before the loop polls for I/O again, so that everything that arrived
+    // in this iteration goes out in one write
+    if (br->out_flusher == NULL) {
+        br->out_flusher = calloc(1, sizeof(uv_prepare_t));
+        uv_prepare_init(br->conn->ziti_ctx->loop, br->out_flusher);
+        br->out_flusher->data = br;
+    }
+    if (br->out_pending == 0) {
+        uv_prepare_start(br->out_flusher, on_out_flush);
+    }
+}
+
 ssize_t on_ziti_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
     struct ziti_bridge_s *br = ziti_conn_data(conn);
 
@@ -264,11 +900,20 @@ ssize_t on_ziti_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
 
     if (len > 0) {
         BR_LOG(TRACE, "received %zd bytes from ziti", len);
+#if defined(BRIDGE_UDP_BATCH)
+        if (br->udp) {
+            return udp_queue(br, data, (size_t) len);
+        }
+#endif
         uv_buf_t b = uv_buf_init((char *) data, len);
 
         ssize_t rc = br->output->type == UV_UDP ?
                      uv_udp_try_send((uv_udp_t *) br->output, &b, 1, NULL) :
                      uv_try_write((uv_stream_t *) br->output, &b, 1);
+        if (rc == UV_ECONNREFUSED) {
+            // reported for an earlier datagram, the error is cleared now
+            rc = uv_udp_try_send((uv_udp_t *) br->output, &b, 1, NULL);
+        }
 
         if (rc >= 0) {
             return rc;
@@ -285,7 +930,7 @@ ssize_t on_ziti_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
     } else if (len == ZITI_EOF) {
         BR_LOG(VERBOSE, "received EOF from ziti");
         br->ziti_eof = true;
-        if (br->input_eof || br->input->type == UV_UDP) {
+        if (br->input_eof || is_dgram(br)) {
             BR_LOG(VERBOSE, "both sides are EOF");
             close_bridge(br);
         }
@@ -314,7 +959,14 @@ void bridge_alloc(uv_handle_t *h, size_t req, uv_buf_t *b) {
 
     BR_LOG(TRACE, "alloc %s", br->input_throttle ? "stalled" : "live");
 
-    b->base = pool_alloc_obj(br->input_pool);
+    if (is_dgram(br)) {
+        b->base = pool_alloc_obj(br->input_pool);
+    } else if (br->in_flight == 0 || br->in_flight + br->buf_size <= BRIDGE_INPUT_WINDOW) {
+        b->base = pool_alloc_obj(size_pool(br, br->buf_size));
+        br->in_flight += pool_obj_size(b->base);
+    } else {
+        b->base = NULL;
+    }
     b->len = pool_obj_size(b->base);
     if (b->base != NULL) {
         if (br->input_throttle) {
@@ -324,9 +976,39 @@ void bridge_alloc(uv_handle_t *h, size_t req, uv_buf_t *b) {
     }
 }
 
+static void bridge_release(struct ziti_bridge_s *br, void *buf) {
+    if (buf && !is_dgram(br)) {
+        br->in_flight -= pool_obj_size(buf);
+    }
+    pool_return_obj(buf);
+}
+
+static int bridge_start_input(struct ziti_bridge_s *br) {
+#if defined(BRIDGE_FILE_IOV)
+    if (br->file) {
+        return file_read(br);
+    }
+#endif
+    switch (br->input->type) {
+        case UV_UDP:
+            return uv_udp_recv_start((uv_udp_t *) br->input, bridge_alloc, on_udp_input);
+#if defined(BRIDGE_UDP_BATCH)
+        case UV_POLL:
+            udp_poll_update(br);
+            return 0;
+#endif
+        default:
+            return uv_read_start((uv_stream_t *) br->input, bridge_alloc, on_input);
+    }
+}
+
 static void on_ziti_write(ziti_connection conn, ssize_t status, void *ctx) {
-    pool_return_obj(ctx);
     struct ziti_bridge_s *br = ziti_conn_data(conn);
+    if (br && br->input) {
+        bridge_release(br, ctx);
+    } else {
+        pool_return_obj(ctx);
+    }
 
     if (status < ZITI_OK) {
         BR_LOG(DEBUG, "ziti_write failed: %zd/%s", status, ziti_errorstr(status));
@@ -335,9 +1017,7 @@ static void on_ziti_write(ziti_connection conn, ssize_t status, void *ctx) {
     else if (br->input) {
         if (br->input_throttle) {
             br->input_throttle = false;
-            int rc = br->input->type == UV_UDP ?
-                     uv_udp_recv_start((uv_udp_t *) br->input, bridge_alloc, on_udp_input) :
-                     uv_read_start((uv_stream_t *) br->input, bridge_alloc, on_input);
+            int rc = bridge_start_input(br);
 
             if (rc != 0) {
                 BR_LOG(WARN, "failed to start reading handle: %d/%s", rc, uv_strerror(rc));
@@ -370,6 +1050,9 @@ void on_udp_input(uv_udp_t *udp, ssize_t len, const uv_buf_t *b, const struct so
                 br->input_throttle = true;
                 uv_udp_recv_stop(udp);
             }
+        } else if (len == UV_ECONNREFUSED) {
+            // peer is not listening (yet), UDP bridge stays up
+            BR_LOG(DEBUG, "peer refused datagram");
         } else if (len < 0) {
             BR_LOG(WARN, "err = %zd/%s", len, uv_strerror(len));
             close_bridge(br);
@@ -377,6 +1060,16 @@ void on_udp_input(uv_udp_t *udp, ssize_t len, const uv_buf_t *b, const struct so
     }
 }
 
+static void bridge_input_eof(struct ziti_bridge_s *br) {
+    br->input_eof = true;
+    if (br->ziti_eof) {
+        BR_LOG(VERBOSE, "both sides are EOF");
+        close_bridge(br);
+    } else {
+        ziti_close_write(br->conn);
+    }
+}
+
 void on_input(uv_stream_t *s, ssize_t len, const uv_buf_t *b) {
     struct ziti_bridge_s *br = s->data;
 
@@ -385,13 +1078,21 @@ void on_input(uv_stream_t *s, ssize_t len, const uv_buf_t *b) {
     }
 
     if (len > 0) {
-        int rc = ziti_write(br->conn, b->base, len, on_ziti_write, b->base);
+        bridge_adapt(br, (size_t) len, b->len);
+        int rc;
+        if (len <= BRIDGE_MSG_SIZE) {
+            rc = ziti_write(br->conn, b->base, len, on_ziti_write, b->base);
+        } else {
+            // large reads are sent as multiple messages
+            uv_buf_t wb = uv_buf_init(b->base, (unsigned int) len);
+            rc = ziti_writev(br->conn, &wb, 1, on_ziti_write, b->base);
+        }
         if (rc != ZITI_OK) {
             BR_LOG(WARN, "ziti_write failed: %d/%s", rc, ziti_errorstr(rc));
             close_bridge(br);
         }
     } else {
-        pool_return_obj(b->base);
+        bridge_release(br, b->base);
         if (len == UV_ENOBUFS) {
             if (!br->input_throttle) {
                 BR_LOG(TRACE, "stalled");
@@ -399,16 +1100,138 @@ void on_input(uv_stream_t *s, ssize_t len, const uv_buf_t *b) {
                 uv_read_stop(s);
             }
         } else if (len == UV_EOF) {
-            br->input_eof = true;
-            if (br->ziti_eof) {
-                BR_LOG(VERBOSE, "both sides are EOF");
-                close_bridge(br);
-            } else {
-                ziti_close_write(br->conn);
-            }
+            bridge_input_eof(br);
         } else if (len < 0) {
             BR_LOG(WARN, "err = %zd", len);
             close_bridge(br);
         }
     }
 }
+
+#if defined(BRIDGE_FILE_IOV)
+static void file_free_bufs(struct ziti_bridge_s *br) {
+    for (int i = 0; i < BRIDGE_FILE_IOV; i++) {
+        ziti_free_write_buf(br->conn, (uint8_t *) br->file->bufs[i].base);
+        br->file->bufs[i] = uv_buf_init(NULL, 0);
+    }
+}
+
+static void file_close(struct ziti_bridge_s *br) {
+    if (br->file->fd >= 0) {
+        close(br->file->fd);
+        br->file->fd = -1;
+    }
+}
+
+static void on_file_write(ziti_connection conn, ssize_t status, void *ctx) {
+    struct ziti_bridge_s *br = ziti_conn_data(conn);
+    br->in_flight -= (size_t) (uintptr_t) ctx;
+
+    if (status < ZITI_OK) {
+        BR_LOG(DEBUG, "ziti_write failed: %zd/%s", status, ziti_errorstr(status));
+        close_bridge(br);
+    } else if (!br->closed) {
+        int rc = file_read(br);
+        if (rc != 0) {
+            BR_LOG(WARN, "failed to read file: %d/%s", rc, uv_strerror(rc));
+            close_bridge(br);
+        }
+    }
+}
+
+static void on_file_read(uv_fs_t *req) {
+    struct ziti_bridge_s *br = req->data;
+    struct file_input_s *f = br->file;
+    ssize_t len = req->result;
+    uv_fs_req_cleanup(req);
+    f->reading = false;
+
+    if (br->closed) {
+        file_free_bufs(br);
+        file_close(br);
+        ziti_close(br->conn, on_ziti_close);
+        return;
+    }
+
+    if (br->idle_timer) { // reset idle timer
+        uv_timer_start(br->idle_timer, on_bridge_idle, br->idle_timeout, 0);
+    }
+
+    if (len < 0) {
+        BR_LOG(WARN, "failed to read file: %zd/%s", len, uv_strerror((int) len));
+        file_free_bufs(br);
+        close_bridge(br);
+        return;
+    }
+
+    if (len == 0) {
+        file_free_bufs(br);
+        bridge_input_eof(br);
+        return;
+    }
+
+    BR_LOG(TRACE, "read %zd bytes from file", len);
+    size_t left = (size_t) len;
+    for (int i = 0; i < BRIDGE_FILE_IOV; i++) {
+        uint8_t *buf = (uint8_t *) f->bufs[i].base;
+        size_t part = MIN(left, f->bufs[i].len);
+        f->bufs[i] = uv_buf_init(NULL, 0);
+        if (part == 0) {
+            ziti_free_write_buf(br->conn, buf);
+            continue;
+        }
+        left -= part;
+        br->in_flight += part;
+        int rc = ziti_write_buf(br->conn, buf, part, on_file_write, (void *) (uintptr_t) part);
+        if (rc != ZITI_OK) {
+            br->in_flight -= part;
+            BR_LOG(WARN, "ziti_write failed: %d/%s", rc, ziti_errorstr(rc));
+            for (i++; i < BRIDGE_FILE_IOV; i++) {
+                ziti_free_write_buf(br->conn, (uint8_t *) f->bufs[i].base);
+                f->bufs[i] = uv_buf_init(NULL, 0);
+            }
+            close_bridge(br);
+            return;
+        }
+    }
+
+    int rc = file_read(br);
+    if (rc != 0) {
+        BR_LOG(WARN, "failed to read file: %d/%s", rc, uv_strerror(rc));
+        close_bridge(br);
+    }
+}
+
+/**
+ * reads next part of the file directly into message buffers, unless enough of it is already in flight.
+ * file data is copied once (by the kernel), and the loop never blocks on disk
+ */
+static int file_read(struct ziti_bridge_s *br) {
+    struct file_input_s *f = br->file;
+    if (f->reading || br->closed || br->input_eof) {
+        return 0;
+    }
+
+    if (br->in_flight > 0 && br->in_flight + BRIDGE_FILE_IOV * BRIDGE_MSG_SIZE > BRIDGE_INPUT_WINDOW) {
+        return 0; // resumes when writes complete
+    }
+
+    for (int i = 0; i < BRIDGE_FILE_IOV; i++) {
+        uint8_t *buf = ziti_alloc_write_buf(br->conn, BRIDGE_MSG_SIZE);
+        if (buf == NULL) {
+            file_free_bufs(br);
+            return UV_ENOTCONN;
+        }
+        f->bufs[i] = uv_buf_init((char *) buf, BRIDGE_MSG_SIZE);
+    }
+
+    f->req.data = br;
+    int rc = uv_fs_read(br->conn->ziti_ctx->loop, &f->req, f->fd, f->bufs, BRIDGE_FILE_IOV, -1, on_file_read);
+    if (rc != 0) {
+        file_free_bufs(br);
+        return rc;
+    }
+    f->reading = true;
+    return 0;
+}
+#endif
@@ -15,6 +15,7 @@
 #include <stdlib.h>
 #include <posture.h>
 #include <assert.h>
+#include <inttypes.h>
 
 #include "endian_internal.h"
 #include "win32_compat.h"
@@ -23,7 +24,39 @@
 static const char *INVALID_SESSION = "Invalid Session";
 static const int MAX_CONNECT_RETRY = 3;
 
+// max payload of a single Data message produced by ziti_writev()
+#define WRITE_SEGMENT_SIZE (32 * 1024)
+
+// crypto offload: rate is checked every CRYPTO_RATE_INTERVAL (ms),
+// queued messages are sent to a worker in batches of at least CRYPTO_OFFLOAD_MIN bytes, smaller ones are done inline
+#define CRYPTO_RATE_INTERVAL 1000
+#define CRYPTO_OFFLOAD_MIN (16 * 1024)
+#define CRYPTO_JOB_MAX 64
+
+// writes up to this size are merged with other queued writes on connections with coalescing enabled
+#define COALESCE_WRITE_MAX (4 * 1024)
+
+// per connection work done in one flusher pass, so that busy connections do not starve others
+#define FLUSH_WRITE_BUDGET 64
+#define FLUSH_READ_BUDGET 32
+// max bytes delivered to data callback at once
+#define FLUSH_CHUNK_SIZE (16 * 1024)
+
+// inbound data pending delivery, above which received messages are no longer retained
+#define INBOUND_HANDOFF_LIMIT (64 * 1024)
+// max channel pool messages retained by one connection
+#define INBOUND_PINNED_MAX 4
+// channel pool share (1/N) that must stay available for other connections
+#define INBOUND_POOL_RESERVE 2
+
+// max closed accepted connections kept for reuse
+#define CONN_POOL_MAX 256
+
+// wire size of ConnId and Seq headers of a Data message
+#define DATA_HDRS_LEN (2 * (2 * sizeof(uint32_t) + sizeof(int32_t)))
+
 #define CONN_LOG(lvl, fmt, ...) ZITI_LOG(lvl, "conn[%u.%u/%s] " fmt, conn->ziti_ctx->id, conn->conn_id, conn_state_str[conn->state], ##__VA_ARGS__)
+#define CONN_LOG_RATE(lvl, fmt, ...) ZITI_LOG_RATE(lvl, LOG_RATE_PER_SEC, "conn[%u.%u/%s] " fmt, conn->ziti_ctx->id, conn->conn_id, conn_state_str[conn->state], ##__VA_ARGS__)
 
 
 
@@ -35,20 +68,42 @@ static const char *conn_state_str[] = {
 
 struct ziti_conn_req {
     ziti_session_type session_type;
-    char *service_id;
+    const char *service_id; // interned
     ziti_net_session *session;
     ziti_conn_cb cb;
     ziti_dial_opts *dial_opts;
     ziti_listen_opts *listen_opts;
 
     int retry_count;
-    uv_timer_t *conn_timeout;
+    uint64_t start; // dial start, loop time
+    wheel_timer_t conn_timeout;
     struct waiter_s *waiter;
     bool failed;
+
+    // racing dial, see ziti_dial_opts.race_delay_ms
+    wheel_timer_t race_timer;
+    ziti_channel_t *race_ch; // second attempt, until one of them replies
+    struct waiter_s *race_waiter;
+
+    // waiting for session request
+    struct ziti_conn *conn;
+    struct session_fetch *fetch;
+    TAILQ_ENTRY(ziti_conn_req) fetch_next;
+};
+
+// single controller request for a session, completes all connections waiting for it
+struct session_fetch {
+    ziti_context ztx;
+    char *key;
+    const char *service_id; // interned
+    ziti_session_type session_type;
+    TAILQ_HEAD(fetch_waiters, ziti_conn_req) waiters;
 };
 
 static void flush_connection(ziti_connection conn);
 
+static void conn_count_down(ziti_connection conn, size_t len);
+
 static bool flush_to_service(ziti_connection conn);
 
 static bool flush_to_client(ziti_connection conn);
@@ -67,9 +122,19 @@ static int ziti_disconnect(ziti_connection conn);
 
 static void restart_connect(struct ziti_conn *conn);
 
-static void free_handle(uv_handle_t *h) {
-    free(h);
-}
+static void race_abandon(struct ziti_conn *conn);
+
+static bool race_settle(struct ziti_conn *conn, message *msg);
+
+static void free_write_req(struct ziti_write_req_s *req);
+
+static void ziti_write_req(struct ziti_write_req_s *req);
+
+static void update_crypto_offload(struct ziti_conn *conn);
+
+static bool crypto_offload_outbound(struct ziti_conn *conn);
+
+static bool crypto_offload_inbound(struct ziti_conn *conn);
 
 const char *ziti_conn_state(ziti_connection conn) {
     return conn ? conn_state_str[conn->state] : "<NULL>";
@@ -126,9 +191,12 @@ static void free_ziti_listen_opts(ziti_listen_opts *ln_opts) {
     free(ln_opts);
 }
 
-static void free_conn_req(struct ziti_conn_req *r) {
-    if (r->conn_timeout != NULL) {
-        uv_close((uv_handle_t *) r->conn_timeout, free_handle);
+static void free_conn_req(struct ziti_ctx *ztx, struct ziti_conn_req *r) {
+    wheel_timer_stop(&r->conn_timeout);
+    wheel_timer_stop(&r->race_timer);
+    if (r->fetch) {
+        TAILQ_REMOVE(&r->fetch->waiters, r, fetch_next);
+        r->fetch = NULL;
     }
 
     if (r->session_type == ziti_session_types.Bind && r->session) {
@@ -138,23 +206,81 @@ static void free_conn_req(struct ziti_conn_req *r) {
 
     free_ziti_dial_opts(r->dial_opts);
     free_ziti_listen_opts(r->listen_opts);
-    FREE(r->service_id);
+    str_intern_release(&ztx->strings, r->service_id);
     free(r);
 }
 
+static void conn_pool_put(struct ziti_conn *conn);
+
+struct conn_crypto *conn_crypto_init(struct ziti_conn *conn) {
+    if (conn->crypto == NULL) {
+        conn->crypto = calloc(1, sizeof(*conn->crypto));
+        conn->crypto->keys = calloc(1, sizeof(*conn->crypto->keys));
+    }
+    return conn->crypto;
+}
+
+static void conn_keys_free(struct conn_crypto *crypto) {
+    if (crypto->keys) {
+        free_key_exchange(&crypto->keys->key_ex);
+        sodium_memzero(crypto->keys, sizeof(*crypto->keys));
+        FREE(crypto->keys);
+    }
+}
+
+// only stream states are needed once both directions are initialized
+static void conn_keys_done(struct conn_crypto *crypto) {
+    if (crypto->keys && crypto->keys->key_ex.rx == NULL && crypto->keys->key_ex.tx == NULL) {
+        conn_keys_free(crypto);
+    }
+}
+
+// peer crypto header is expected before data
+static inline bool conn_crypto_header_pending(struct ziti_conn *conn) {
+    return conn->crypto->keys != NULL && conn->crypto->keys->key_ex.rx != NULL;
+}
+
+// restore state released by conn_hibernate_idle() on the next frame in either direction
+static inline void conn_wake(struct ziti_conn *conn) {
+    if (conn->hibernated) {
+        conn->hibernated = false;
+        if (conn->inbound == NULL) {
+            conn->inbound = new_buffer();
+        }
+        conn->ziti_ctx->path_stats.conns_woken++;
+        CONN_LOG(VERBOSE, "woken up");
+    }
+}
+
+static void conn_crypto_free(struct ziti_conn *conn) {
+    if (conn->crypto) {
+        conn_keys_free(conn->crypto);
+        e2e_stream_free(&conn->crypto->crypt_o);
+        e2e_stream_free(&conn->crypto->crypt_i);
+        sodium_memzero(conn->crypto, sizeof(*conn->crypto));
+        FREE(conn->crypto);
+    }
+}
+
 static int close_conn_internal(struct ziti_conn *conn) {
     assert(conn->type == Transport);
 
-    if (conn->state == Closed && conn->write_reqs <= 0) {
+    if (conn->state == Closed && conn->write_reqs <= 0 &&
+        conn->crypt_out_job == NULL && conn->crypt_in_job == NULL) {
         CONN_LOG(DEBUG, "removing");
 
+        if (conn->write_blocked) {
+            LIST_REMOVE(conn, blocked_next);
+            conn->write_blocked = false;
+        }
+
         while (!TAILQ_EMPTY(&conn->wreqs)) {
             struct ziti_write_req_s *req = TAILQ_FIRST(&conn->wreqs);
             TAILQ_REMOVE(&conn->wreqs, req, _next);
             if (req->cb) {
                 req->cb(conn, ZITI_INVALID_STATE, req->ctx);
             }
-            free(req);
+            free_write_req(req);
         }
 
         if (conn->close_cb) {
@@ -166,20 +292,25 @@ static int close_conn_internal(struct ziti_conn *conn) {
         }
 
         if (conn->conn_req) {
+            race_abandon(conn);
             ziti_channel_remove_waiter(conn->channel, conn->conn_req->waiter);
-            free_conn_req(conn->conn_req);
+            free_conn_req(conn->ziti_ctx, conn->conn_req);
         }
 
         if (conn->parent) {
+            ziti_server_pending_done(conn);
             model_map_removel(&conn->parent->server.children, conn->conn_id);
         }
 
-        free_key_exchange(&conn->key_ex);
+        conn_crypto_free(conn);
+        FREE(conn->timings);
+        model_map_clear(&conn->write_bufs, pool_return_obj);
 
-        if (conn->flusher) {
-            conn->flusher->data = NULL;
-            uv_close((uv_handle_t *) conn->flusher, free_handle);
-            conn->flusher = NULL;
+        conn->flush_enabled = false;
+        if (conn->flush_queued) {
+            TAILQ_REMOVE(&conn->ziti_ctx->flush_queue, conn, flush_next);
+            conn->ziti_ctx->flush_queue_len--;
+            conn->flush_queued = false;
         }
 
         int count = 0;
@@ -196,30 +327,89 @@ static int close_conn_internal(struct ziti_conn *conn) {
         if (buffer_available(conn->inbound) > 0) {
             CONN_LOG(WARN, "dumping %zd bytes of undelivered data", buffer_available(conn->inbound));
         }
+        str_intern_release(&conn->ziti_ctx->strings, conn->service);
+        conn->service = NULL;
+        FREE(conn->source_identity);
+        if (conn->parent && conn->ziti_ctx->conn_pool_size < CONN_POOL_MAX) {
+            CONN_LOG(TRACE, "is being recycled");
+            conn_pool_put(conn);
+            return 1;
+        }
         free_buffer(conn->inbound);
         CONN_LOG(TRACE, "is being free()'d");
-        FREE(conn->service);
-        FREE(conn->source_identity);
         FREE(conn);
         return 1;
     }
     return 0;
 }
 
-void on_write_completed(struct ziti_conn *conn, struct ziti_write_req_s *req, int status) {
+static void conn_write_release(struct ziti_conn *conn, struct ziti_write_req_s *req) {
+    conn->write_q_bytes -= req->queued;
+    req->queued = 0;
+}
+
+/**
+ * write backpressure: connection is not writable while its queued writes are over conn_write_high_water,
+ * or its channel is over channel_write_high_water, until both are down to their low marks.
+ */
+static void conn_check_writable(struct ziti_conn *conn) {
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+    size_t high = ztx->opts.conn_write_high_water;
+    if (high == 0 && ztx->opts.channel_write_high_water == 0) {
+        return;
+    }
+
+    size_t low = ztx->opts.conn_write_low_water ? ztx->opts.conn_write_low_water : high / 2;
+    size_t mark = conn->write_blocked ? low : high;
+    bool blocked = (conn->channel && conn->channel->write_blocked) || (high > 0 && conn->write_q_bytes > mark);
+    if (blocked == conn->write_blocked) {
+        return;
+    }
+
+    conn->write_blocked = blocked;
+    if (blocked) {
+        LIST_INSERT_HEAD(&ztx->write_blocked, conn, blocked_next);
+        ztx->path_stats.write_blocks++;
+    } else {
+        LIST_REMOVE(conn, blocked_next);
+    }
+    CONN_LOG(VERBOSE, "%s, %zu bytes queued", blocked ? "is not writable" : "is writable again", conn->write_q_bytes);
+
+    if (conn->writable_cb) {
+        conn->writable_cb(conn, !blocked);
+    }
+}
+
+void conn_channel_writable(struct ziti_ctx *ztx, ziti_channel_t *ch) {
+    struct ziti_conn *conn = LIST_FIRST(&ztx->write_blocked);
+    while (conn != NULL) {
+        struct ziti_conn *next = LIST_NEXT(conn, blocked_next);
+        if (conn->channel == ch) {
+            conn_check_writable(conn);
+        }
+        conn = next;
+    }
+}
+
+static void complete_write_req(struct ziti_conn *conn, struct ziti_write_req_s *req, int status) {
+    // segments complete in order, the last one (original request) reports the first failure
+    if (req->segment_of && status < 0 && req->segment_of->segment_err == 0) {
+        req->segment_of->segment_err = status;
+    }
+    if (status == 0 && req->segment_err != 0) {
+        status = req->segment_err;
+    }
+
     if (req->conn == NULL) {
         ZITI_LOG(DEBUG, "write completed for timed out or closed connection");
-        free(req);
+        write_req_free(req);
         return;
     }
     CONN_LOG(TRACE, "status %d", status);
     conn->write_reqs--;
+    conn_write_release(conn, req);
 
-    if (req->timeout != NULL) {
-        uv_timer_stop(req->timeout);
-        uv_close((uv_handle_t *) req->timeout, free_handle);
-        req->timeout = NULL;
-    }
+    wheel_timer_stop(&req->timeout);
 
     if (status < 0) {
         conn_set_state(conn, Disconnected);
@@ -234,10 +424,22 @@ void on_write_completed(struct ziti_conn *conn, struct ziti_write_req_s *req, in
         req->cb(conn, status, req->ctx);
     }
 
-    free(req);
+    write_req_free(req);
+    conn_check_writable(conn);
 }
 
-message *create_message(struct ziti_conn *conn, uint32_t content, size_t body_len) {
+void on_write_completed(struct ziti_conn *conn, struct ziti_write_req_s *req, int status) {
+    struct ziti_write_req_s *batch = req->batch;
+    complete_write_req(conn, req, status);
+
+    while (batch) {
+        struct ziti_write_req_s *next = batch->batch;
+        complete_write_req(conn, batch, status);
+        batch = next;
+    }
+}
+
+static void write_data_headers(struct ziti_conn *conn, message *m) {
     int32_t conn_id = htole32(conn->conn_id);
     int32_t msg_seq = htole32(conn->edge_msg_seq++);
     hdr_t headers[] = {
@@ -252,7 +454,58 @@ message *create_message(struct ziti_conn *conn, uint32_t content, size_t body_le
                     .value = (uint8_t *) &msg_seq
             }
     };
-    return message_new(NULL, content, headers, 2, body_len);
+    uint8_t *p = m->headers;
+    for (int i = 0; i < 2; i++) {
+        p = write_hdr(&headers[i], p);
+    }
+}
+
+static message *new_data_message(struct ziti_ctx *ztx, uint32_t content, size_t body_len) {
+    int32_t placeholder = 0;
+    hdr_t headers[] = {
+            {
+                    .header_id = ConnIdHeader,
+                    .length = sizeof(placeholder),
+                    .value = (uint8_t *) &placeholder
+            },
+            {
+                    .header_id = SeqHeader,
+                    .length = sizeof(placeholder),
+                    .value = (uint8_t *) &placeholder
+            }
+    };
+    return message_new_out(ztx->out_msgs, content, headers, 2, body_len);
+}
+
+message *create_message(struct ziti_conn *conn, uint32_t content, size_t body_len) {
+    message *m = new_data_message(conn->ziti_ctx, content, body_len);
+    write_data_headers(conn, m);
+    return m;
+}
+
+/**
+ * write requests come from the context pool, steady state writes do not hit the allocator
+ */
+struct ziti_write_req_s *write_req_new(struct ziti_ctx *ztx) {
+    struct ziti_write_req_s *req = pool_alloc_obj(ztx->write_reqs);
+    if (req == NULL) {
+        req = alloc_unpooled_obj(sizeof(struct ziti_write_req_s), NULL);
+        ztx->path_stats.allocs++;
+    }
+    return req;
+}
+
+void write_req_free(struct ziti_write_req_s *req) {
+    pool_return_obj(req);
+}
+
+static void free_write_req(struct ziti_write_req_s *req) {
+    // request was never sent, it may still own application provided message
+    if (req->message) {
+        pool_return_obj(req->message);
+    }
+    FREE(req->iov);
+    write_req_free(req);
 }
 
 static int send_message(struct ziti_conn *conn, message *m, struct ziti_write_req_s *wr) {
@@ -289,15 +542,75 @@ static void on_channel_connected(ziti_channel_t *ch, void *ctx, int status) {
     }
 }
 
+static inline void conn_mark(struct ziti_conn *conn, enum dial_phase phase) {
+    if (conn->type != Transport || conn->timings == NULL) {
+        return;
+    }
+
+    uint64_t now = uv_now(conn->ziti_ctx->loop);
+    switch (phase) {
+        case DIAL_PHASE_SESSION: conn->timings->session = now; break;
+        case DIAL_PHASE_CHANNEL: conn->timings->channel = now; break;
+        case DIAL_PHASE_CONNECT: conn->timings->connected = now; break;
+        case DIAL_PHASE_CRYPTO: conn->timings->established = now; break;
+        default: break;
+    }
+}
+
+static void record_dial_phases(struct ziti_conn *conn) {
+    ziti_context ztx = conn->ziti_ctx;
+    const ziti_dial_timings *t = conn->timings;
+    uint64_t marks[DIAL_PHASES] = {
+            [DIAL_PHASE_SESSION] = t->session,
+            [DIAL_PHASE_CHANNEL] = t->channel,
+            [DIAL_PHASE_CONNECT] = t->connected,
+            [DIAL_PHASE_CRYPTO] = t->established,
+    };
+
+    uint64_t prev = t->start;
+    for (int i = 0; i < DIAL_PHASES; i++) {
+        if (marks[i] == 0 || marks[i] < prev) {
+            break;
+        }
+        metrics_hist_record(&ztx->dial_phases[i], marks[i] - prev);
+        prev = marks[i];
+    }
+}
+
+const char *ziti_dial_phase_name(enum dial_phase phase) {
+    switch (phase) {
+        case DIAL_PHASE_SESSION: return "session";
+        case DIAL_PHASE_CHANNEL: return "channel";
+        case DIAL_PHASE_CONNECT: return "connect";
+        case DIAL_PHASE_CRYPTO: return "crypto";
+        default: return "unknown";
+    }
+}
+
+const ziti_dial_timings *ziti_conn_timings(ziti_connection conn) {
+    if (conn == NULL || conn->type != Transport ||
+        conn->timings == NULL || conn->timings->start == 0) {
+        return NULL;
+    }
+    return conn->timings;
+}
+
 static void complete_conn_req(struct ziti_conn *conn, int code) {
     if (conn->conn_req && conn->conn_req->cb) {
         if (code != ZITI_OK) {
             conn_set_state(conn, code == ZITI_TIMEOUT ? Timedout : Disconnected);
             conn->conn_req->failed = true;
             conn->data_cb = NULL;
+            race_abandon(conn);
         }
-        if (conn->conn_req->conn_timeout != NULL) {
-            uv_timer_stop(conn->conn_req->conn_timeout);
+        wheel_timer_stop(&conn->conn_req->conn_timeout);
+        if (code == ZITI_OK && conn->conn_req->start != 0) {
+            ziti_context ztx = conn->ziti_ctx;
+            metrics_hist_record(&ztx->dial_time, uv_now(ztx->loop) - conn->conn_req->start);
+            if (conn->type == Transport && conn->timings != NULL) {
+                conn_mark(conn, DIAL_PHASE_CRYPTO);
+                record_dial_phases(conn);
+            }
         }
         conn->conn_req->cb(conn, code);
         conn->conn_req->cb = NULL;
@@ -310,7 +623,7 @@ static void complete_conn_req(struct ziti_conn *conn, int code) {
                 if (req->cb) {
                     req->cb(conn, code, req->ctx);
                 }
-                free(req);
+                free_write_req(req);
             }
         }
 
@@ -320,12 +633,10 @@ static void complete_conn_req(struct ziti_conn *conn, int code) {
     }
 }
 
-static void connect_timeout(uv_timer_t *timer) {
+static void connect_timeout(wheel_timer_t *timer) {
     struct ziti_conn *conn = timer->data;
 
     ziti_channel_t *ch = conn->channel;
-    uv_close((uv_handle_t *) timer, free_handle);
-    conn->conn_req->conn_timeout = NULL;
 
     if (conn->state == Connecting) {
         if (ch == NULL) {
@@ -342,6 +653,33 @@ static void connect_timeout(uv_timer_t *timer) {
     }
 }
 
+/*
+ * default edge router selection: lowest expected delay
+ * - RTT estimate (srtt + 4 * rttvar)
+ * - 1ms for every 16K of data queued to the router
+ * - 1ms for every 8 active connections
+ */
+// degraded routers are only used if all are
+#define DEGRADED_ROUTER_COST (UINT64_MAX / 2)
+
+static int select_router(const ziti_router_load *loads, int count) {
+    int best = 0;
+    uint64_t best_cost = UINT64_MAX;
+    for (int i = 0; i < count; i++) {
+        uint64_t cost = loads[i].rtt + 4 * loads[i].rtt_var +
+                        loads[i].queued_bytes / (16 * 1024) +
+                        loads[i].connections / 8;
+        if (loads[i].degraded) {
+            cost = DEGRADED_ROUTER_COST + MIN(cost, DEGRADED_ROUTER_COST - 1);
+        }
+        if (cost < best_cost) {
+            best = i;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
 static int ziti_connect(struct ziti_ctx *ztx, const ziti_net_session *session, struct ziti_conn *conn) {
     // verify ziti context is still authorized
     if (ztx->api_session == NULL) {
@@ -359,10 +697,13 @@ static int ziti_connect(struct ziti_ctx *ztx, const ziti_net_session *session, s
     conn->channel = NULL;
 
     ziti_edge_router *er;
-    ziti_channel_t *best_ch = NULL;
-    uint64_t best_latency = UINT64_MAX;
     uintptr_t conn_id = conn->conn_id;
 
+    size_t num_ers = model_list_size(&session->edge_routers);
+    ziti_channel_t **candidates = calloc(num_ers, sizeof(ziti_channel_t *));
+    ziti_router_load *loads = calloc(num_ers, sizeof(ziti_router_load));
+    int count = 0;
+
     MODEL_LIST_FOREACH(er, session->edge_routers) {
         const char *tls = model_map_get(&er->protocols, "tls");
         if (tls == NULL) {
@@ -373,10 +714,9 @@ static int ziti_connect(struct ziti_ctx *ztx, const ziti_net_session *session, s
             ziti_channel_t *ch = model_map_get(&ztx->channels, tls);
 
             if (ch != NULL && ch->state == Connected) {
-                if (ch->latency < best_latency) {
-                    best_ch = ch;
-                    best_latency = ch->latency;
-                }
+                candidates[count] = ch;
+                ziti_channel_load(ch, &loads[count]);
+                count++;
             } else {
                 CONN_LOG(TRACE, "connecting to %s(%s) for session[%s]", er->name, tls, session->id);
                 ziti_channel_connect(ztx, er->name, tls, on_channel_connected, (void *) conn_id);
@@ -384,12 +724,26 @@ static int ziti_connect(struct ziti_ctx *ztx, const ziti_net_session *session, s
         }
     }
 
-    if (best_ch) {
-        CONN_LOG(DEBUG, "selected ch[%s@%s] for best latency(%llu ms)", best_ch->name, best_ch->url,
-                 (unsigned long long) best_ch->latency);
+    if (count > 0) {
+        ziti_dial_opts *opts = conn->conn_req->dial_opts;
+        int idx = -1;
+        if (opts && opts->router_select) {
+            idx = opts->router_select(loads, count, opts->router_select_ctx);
+        }
+        if (idx < 0 || idx >= count) {
+            idx = select_router(loads, count);
+        }
+
+        ziti_channel_t *best_ch = candidates[idx];
+        CONN_LOG(DEBUG, "selected ch[%s@%s] rtt[%llu+/-%llums] queued[%zd] conns[%zd] health[%d]",
+                 best_ch->name, best_ch->url,
+                 (unsigned long long) loads[idx].rtt, (unsigned long long) loads[idx].rtt_var,
+                 loads[idx].queued_bytes, loads[idx].connections, loads[idx].health);
         on_channel_connected(best_ch, (void *) conn_id, ZITI_OK);
     }
 
+    free(candidates);
+    free(loads);
     return 0;
 }
 
@@ -406,7 +760,7 @@ static void connect_get_service_cb(ziti_context ztx, ziti_service *s, int status
             return;
         }
 
-        req->service_id = strdup(s->id);
+        req->service_id = str_intern_get(&ztx->strings, s->id);
         conn->encrypted = s->encryption;
         process_connect(conn);
     } else if (status == ZITI_SERVICE_UNAVAILABLE) {
@@ -418,10 +772,8 @@ static void connect_get_service_cb(ziti_context ztx, ziti_service *s, int status
     }
 }
 
-static void connect_get_net_session_cb(ziti_net_session *s, const ziti_error *err, void *ctx) {
-    struct ziti_conn *conn = ctx;
+static void connect_get_net_session_cb(struct ziti_conn *conn, ziti_net_session *s, const ziti_error *err) {
     struct ziti_conn_req *req = conn->conn_req;
-    struct ziti_ctx *ztx = conn->ziti_ctx;
 
     if (err != NULL) {
         int e = err->err == ZITI_NOT_FOUND ? ZITI_SERVICE_UNAVAILABLE : err->err;
@@ -429,35 +781,112 @@ static void connect_get_net_session_cb(ziti_net_session *s, const ziti_error *er
                  ziti_session_types.name(req->session_type), conn->service, err->code, err->message);
 
         if (err->err == ZITI_NOT_AUTHORIZED) {
-            ziti_force_api_session_refresh(ztx);
             restart_connect(conn);
         } else {
             complete_conn_req(conn, e);
         }
     } else {
+        CONN_LOG(DEBUG, "got session[%s] for service[%s]", s->id, conn->service);
         req->session = s;
-        s->service_id = strdup(req->service_id);
-        if (req->session_type == ziti_session_types.Dial) {
-            ziti_net_session *existing = model_map_get(&ztx->sessions, req->service_id);
-            // this happens with concurrent connection requests for the same service (common with browsers)
-            if (existing) {
-                CONN_LOG(DEBUG, "found session[%s] for service[%s]", existing->id, conn->service);
-                free_ziti_net_session(s);
-                free(s);
-                req->session = existing;
-            } else {
-                CONN_LOG(DEBUG, "got session[%s] for service[%s]", s->id, conn->service);
-                model_map_set(&ztx->sessions, s->service_id, s);
-            }
-        }
         process_connect(conn);
     }
 }
 
+static void session_fetch_cb(ziti_net_session *s, const ziti_error *err, void *ctx) {
+    struct session_fetch *f = ctx;
+    struct ziti_ctx *ztx = f->ztx;
+    model_map_remove(&ztx->session_fetches, f->key);
+
+    if (s) {
+        s->service_id = strdup(f->service_id);
+        ziti_net_session *existing = model_map_get(&ztx->sessions, f->service_id);
+        // session could have been acquired by other means while request was in flight
+        if (existing) {
+            free_ziti_net_session(s);
+            free(s);
+            s = existing;
+        } else {
+            s->fetched_at = (duration) uv_now(ztx->loop);
+            model_map_set(&ztx->sessions, s->service_id, s);
+            ziti_cache_update(ztx);
+            ziti_session_refresh_schedule(ztx);
+        }
+        if (!TAILQ_EMPTY(&f->waiters)) {
+            s->last_used = (duration) uv_now(ztx->loop);
+        }
+    }
+
+    if (err && err->err == ZITI_NOT_AUTHORIZED) {
+        ziti_force_api_session_refresh(ztx);
+    }
+
+    // waiting connections may get closed while others are completed
+    while (!TAILQ_EMPTY(&f->waiters)) {
+        struct ziti_conn_req *req = TAILQ_FIRST(&f->waiters);
+        TAILQ_REMOVE(&f->waiters, req, fetch_next);
+        req->fetch = NULL;
+        connect_get_net_session_cb(req->conn, s, err);
+    }
+
+    free(f->key);
+    str_intern_release(&ztx->strings, f->service_id);
+    free(f);
+}
+
+static struct session_fetch *get_session_fetch(struct ziti_ctx *ztx, const char *service_id,
+                                               ziti_session_type type, bool *started) {
+    char key[128];
+    snprintf(key, sizeof(key), "%s/%s", service_id, ziti_session_types.name(type));
+
+    struct session_fetch *f = model_map_get(&ztx->session_fetches, key);
+    *started = f == NULL;
+    if (f == NULL) {
+        f = calloc(1, sizeof(*f));
+        f->ztx = ztx;
+        f->key = strdup(key);
+        f->service_id = str_intern_get(&ztx->strings, service_id);
+        f->session_type = type;
+        TAILQ_INIT(&f->waiters);
+        model_map_set(&ztx->session_fetches, f->key, f);
+        ziti_ctrl_create_session(&ztx->controller, service_id, type, session_fetch_cb, f);
+    }
+    return f;
+}
+
+void ziti_prefetch_session(struct ziti_ctx *ztx, const char *service_id) {
+    bool started;
+    get_session_fetch(ztx, service_id, ziti_session_types.Dial, &started);
+    if (started) {
+        ZTX_LOG(DEBUG, "prefetching '%s' session for service_id[%s]", ziti_session_types.name(ziti_session_types.Dial),
+                service_id);
+    }
+}
+
+static void request_session(struct ziti_conn *conn) {
+    struct ziti_conn_req *req = conn->conn_req;
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+
+    // connect requests are for Dial sessions only, those are shared by all connections to the service
+    assert(req->session_type == ziti_session_types.Dial);
+
+    bool started;
+    struct session_fetch *f = get_session_fetch(ztx, req->service_id, req->session_type, &started);
+    if (started) {
+        CONN_LOG(DEBUG, "requesting '%s' session for service[%s]", ziti_session_types.name(req->session_type),
+                 conn->service);
+    } else {
+        CONN_LOG(DEBUG, "waiting for in-flight '%s' session request for service[%s]",
+                 ziti_session_types.name(req->session_type), conn->service);
+    }
+
+    req->conn = conn;
+    req->fetch = f;
+    TAILQ_INSERT_TAIL(&f->waiters, req, fetch_next);
+}
+
 static void process_connect(struct ziti_conn *conn) {
     struct ziti_conn_req *req = conn->conn_req;
     struct ziti_ctx *ztx = conn->ziti_ctx;
-    uv_loop_t *loop = ztx->loop;
 
 
     // find service
@@ -473,19 +902,17 @@ static void process_connect(struct ziti_conn *conn) {
     ziti_send_posture_data(ztx);
     if (req->session == NULL && req->session_type == ziti_session_types.Dial) {
         req->session = model_map_get(&ztx->sessions, req->service_id);
+        if (req->session) {
+            req->session->last_used = (duration) uv_now(ztx->loop);
+        }
     }
 
     if (req->session == NULL) {
-        CONN_LOG(DEBUG, "requesting '%s' session for service[%s]", ziti_session_types.name(req->session_type),
-                 conn->service);
-        ziti_ctrl_create_session(&ztx->controller, req->service_id, req->session_type, connect_get_net_session_cb,
-                                 conn);
+        request_session(conn);
         return;
     } else {
-        req->conn_timeout = calloc(1, sizeof(uv_timer_t));
-        uv_timer_init(loop, req->conn_timeout);
-        req->conn_timeout->data = conn;
-        uv_timer_start(req->conn_timeout, connect_timeout, conn->timeout, 0);
+        conn_mark(conn, DIAL_PHASE_SESSION);
+        wheel_timer_start(&ztx->timers, &req->conn_timeout, conn->timeout, connect_timeout, conn);
 
         CONN_LOG(DEBUG, "starting %s connection for service[%s] with session[%s]",
                  ziti_session_types.name(req->session_type), conn->service, req->session->id);
@@ -495,6 +922,14 @@ static void process_connect(struct ziti_conn *conn) {
 
 static int do_ziti_dial(ziti_connection conn, const char *service, ziti_dial_opts *dial_opts, ziti_conn_cb conn_cb, ziti_data_cb data_cb) {
     if (!conn->ziti_ctx->enabled) { return ZITI_DISABLED; }
+    if (conn->ziti_ctx->mem_over) {
+        CONN_LOG(WARN, "rejecting dial to service[%s]: memory limit reached", service);
+        return ZITI_MEMORY_LIMIT;
+    }
+    if (conn->ziti_ctx->draining) {
+        CONN_LOG(WARN, "rejecting dial to service[%s]: context is draining", service);
+        return ZITI_DISABLED;
+    }
 
     assert(conn->type == None);
     init_transport_conn(conn);
@@ -510,16 +945,27 @@ static int do_ziti_dial(ziti_connection conn, const char *service, ziti_dial_opt
     }
 
     NEWP(req, struct ziti_conn_req);
-    conn->service = strdup(service);
+    conn->service = str_intern_get(&conn->ziti_ctx->strings, service);
+    conn->svc_xfer = ziti_service_xfer(conn->ziti_ctx, service);
     conn->conn_req = req;
 
     req->session_type = ziti_session_types.Dial;
     req->cb = conn_cb;
+    req->start = uv_now(conn->ziti_ctx->loop);
+    if (conn->ziti_ctx->opts.dial_timings) {
+        if (conn->timings == NULL) {
+            conn->timings = malloc(sizeof(*conn->timings));
+        }
+        *conn->timings = (ziti_dial_timings) {.start = req->start};
+    }
 
     if (dial_opts != NULL) {
         // clone dial_opts to survive the async request
         req->dial_opts = clone_ziti_dial_opts(dial_opts);
 
+        conn->datagram = dial_opts->datagram;
+        // datagrams keep their boundaries
+        conn->coalesce = dial_opts->coalesce_writes && !dial_opts->datagram;
         // override connection timeout if set in dial_opts
         if (dial_opts->connect_timeout_seconds > 0) {
             conn->timeout = dial_opts->connect_timeout_seconds * 1000;
@@ -529,9 +975,7 @@ static int do_ziti_dial(ziti_connection conn, const char *service, ziti_dial_opt
     conn->data_cb = data_cb;
     conn_set_state(conn, Connecting);
 
-    conn->flusher = calloc(1, sizeof(uv_idle_t));
-    uv_idle_init(conn->ziti_ctx->loop, conn->flusher);
-    conn->flusher->data = conn;
+    conn->flush_enabled = true;
 
     process_connect(conn);
     return ZITI_OK;
@@ -550,20 +994,162 @@ int ziti_dial_with_options(ziti_connection conn, const char *service, ziti_dial_
     return do_ziti_dial(conn, service, dial_opts, conn_cb, data_cb);
 }
 
-static void ziti_write_timeout(uv_timer_t *t) {
+static void ziti_write_timeout(wheel_timer_t *t) {
     struct ziti_write_req_s *req = t->data;
     struct ziti_conn *conn = req->conn;
 
     conn->write_reqs--;
-    req->timeout = NULL;
+    conn_write_release(conn, req);
+    if (req->ch_queued) { // still in channel queue, nothing is counted without the connection
+        req->ch_queued = false;
+        conn->ch_out_pending--;
+    }
     req->conn = NULL;
 
     if (conn->state < Disconnected) {
         conn_set_state(conn, Disconnected);
         req->cb(conn, ZITI_TIMEOUT, req->ctx);
     }
+}
+
+/**
+ * sends buffer obtained with ziti_alloc_write_buf().
+ * headers are written into reserved headroom, encryption (if any) is done in place:
+ * plaintext is placed one byte past the body start, so that e2e_push() output
+ * (one tag byte ahead of ciphertext) never overtakes its input
+ */
+static void ziti_write_owned_buf(struct ziti_conn *conn, struct ziti_write_req_s *req) {
+    message *m = req->message;
+    req->message = NULL;
+
+    write_data_headers(conn, m);
+    if (conn->encrypted) {
+        e2e_push(&conn->crypto->crypt_o, m->body, m->body + 1, req->len);
+    }
+
+    send_message(conn, m, req);
+}
+
+/**
+ * gathers application buffers into Data messages of at most WRITE_SEGMENT_SIZE.
+ * intermediate segments are sent with internal requests, original request completes with the last segment
+ * and the status of the first failed segment
+ */
+static void ziti_write_iov(struct ziti_conn *conn, struct ziti_write_req_s *req) {
+    size_t abytes = conn->encrypted ? E2E_ABYTES : 0;
+    size_t left = req->len;
+    unsigned int idx = 0;
+    size_t off = 0;
+
+    do {
+        // datagrams are never split
+        size_t seg_len = conn->datagram ? left : MIN(left, WRITE_SEGMENT_SIZE);
+        message *m = create_message(conn, ContentTypeData, seg_len + abytes);
+
+        // gather past the tag byte, then encrypt in place
+        uint8_t *seg = conn->encrypted ? m->body + 1 : m->body;
+        uint8_t *p = seg;
+        size_t need = seg_len;
+        while (need > 0) {
+            size_t n = MIN(need, req->iov[idx].len - off);
+            memcpy(p, req->iov[idx].base + off, n);
+            conn->ziti_ctx->path_stats.bytes_copied += n;
+            p += n;
+            off += n;
+            need -= n;
+            if (off == req->iov[idx].len) {
+                idx++;
+                off = 0;
+            }
+        }
+
+        if (conn->encrypted) {
+            e2e_push(&conn->crypto->crypt_o, m->body, seg, seg_len);
+        }
+
+        left -= seg_len;
+        struct ziti_write_req_s *wr = req;
+        if (left > 0) {
+            wr = write_req_new(conn->ziti_ctx);
+            wr->conn = conn;
+            wr->len = seg_len;
+            wr->segment_of = req;
+            conn->write_reqs++;
+        } else {
+            FREE(req->iov);
+            req->iov_count = 0;
+        }
+        send_message(conn, m, wr);
+    } while (left > 0);
+}
+
+static bool can_coalesce(struct ziti_write_req_s *req) {
+    return !req->eof && !req->close && req->message == NULL && req->len <= COALESCE_WRITE_MAX;
+}
+
+/**
+ * sends [first] and writes chained to it in one Data message.
+ * message is carried by an internal request, so that writes that time out do not take it along,
+ * every merged write completes with its own callback
+ */
+static void ziti_write_batch(struct ziti_conn *conn, struct ziti_write_req_s *first, size_t total) {
+    size_t abytes = conn->encrypted ? E2E_ABYTES : 0;
+    message *m = create_message(conn, ContentTypeData, total + abytes);
+
+    uint8_t *seg = conn->encrypted ? m->body + 1 : m->body;
+    uint8_t *p = seg;
+    for (struct ziti_write_req_s *r = first; r != NULL; r = r->batch) {
+        if (r->cb) {
+            wheel_timer_start(&conn->ziti_ctx->timers, &r->timeout, conn->timeout, ziti_write_timeout, r);
+        }
+
+        if (r->iov) {
+            for (unsigned int i = 0; i < r->iov_count; i++) {
+                memcpy(p, r->iov[i].base, r->iov[i].len);
+                p += r->iov[i].len;
+            }
+            FREE(r->iov);
+            r->iov_count = 0;
+        } else {
+            memcpy(p, r->buf, r->len);
+            p += r->len;
+        }
+    }
+    conn->ziti_ctx->path_stats.bytes_copied += total;
+
+    if (conn->encrypted) {
+        e2e_push(&conn->crypto->crypt_o, m->body, seg, total);
+    }
+
+    struct ziti_write_req_s *wr = write_req_new(conn->ziti_ctx);
+    wr->conn = conn;
+    wr->batch = first;
+    conn->write_reqs++;
+    send_message(conn, m, wr);
+}
+
+/**
+ * merges small writes queued after [first] into one message, up to WRITE_SEGMENT_SIZE.
+ */
+static void ziti_write_coalesced(struct ziti_conn *conn, struct ziti_write_req_s *first) {
+    size_t total = first->len;
+    struct ziti_write_req_s *last = first;
+    struct ziti_write_req_s *next;
+    while ((next = TAILQ_FIRST(&conn->wreqs)) != NULL && can_coalesce(next) &&
+           total + next->len <= WRITE_SEGMENT_SIZE) {
+        TAILQ_REMOVE(&conn->wreqs, next, _next);
+        conn->write_reqs++;
+        conn->ziti_ctx->path_stats.writes_coalesced++;
+        last->batch = next;
+        last = next;
+        total += next->len;
+    }
 
-    uv_close((uv_handle_t *) t, free_handle);
+    if (last == first) {
+        ziti_write_req(first);
+    } else {
+        ziti_write_batch(conn, first, total);
+    }
 }
 
 static void ziti_write_req(struct ziti_write_req_s *req) {
@@ -573,7 +1159,7 @@ static void ziti_write_req(struct ziti_write_req_s *req) {
         conn_set_state(conn, CloseWrite);
         send_fin_message(conn);
         conn->write_reqs--;
-        free(req);
+        write_req_free(req);
         return;
     } else if (req->close) {
         // conn->state will be set on_disconnect callback
@@ -584,19 +1170,27 @@ static void ziti_write_req(struct ziti_write_req_s *req) {
     }
 
     if (req->cb) {
-        req->timeout = calloc(1, sizeof(uv_timer_t));
-        uv_timer_init(conn->ziti_ctx->loop, req->timeout);
-        req->timeout->data = req;
-        uv_timer_start(req->timeout, ziti_write_timeout, conn->timeout, 0);
+        wheel_timer_start(&conn->ziti_ctx->timers, &req->timeout, conn->timeout, ziti_write_timeout, req);
     }
 
-    size_t total_len = req->len + (conn->encrypted ? crypto_secretstream_xchacha20poly1305_abytes() : 0);
+    if (req->message) {
+        ziti_write_owned_buf(conn, req);
+        return;
+    }
+
+    if (req->iov) {
+        ziti_write_iov(conn, req);
+        return;
+    }
+
+    size_t total_len = req->len + (conn->encrypted ? E2E_ABYTES : 0);
     message *m = create_message(conn, ContentTypeData, total_len);
 
     if (conn->encrypted) {
-        crypto_secretstream_xchacha20poly1305_push(&conn->crypt_o, m->body, NULL, req->buf, req->len, NULL, 0, 0);
+        e2e_push(&conn->crypto->crypt_o, m->body, req->buf, req->len);
     } else {
         memcpy(m->body, req->buf, req->len);
+        conn->ziti_ctx->path_stats.bytes_copied += req->len;
     }
 
     send_message(conn, m, req);
@@ -623,7 +1217,7 @@ static void ziti_disconnect_async(struct ziti_conn *conn) {
         case Connected:
         case CloseWrite:
         case Timedout: {
-            NEWP(wr, struct ziti_write_req_s);
+            struct ziti_write_req_s *wr = write_req_new(conn->ziti_ctx);
             wr->conn = conn;
             wr->close = true;
             wr->cb = on_disconnect;
@@ -693,76 +1287,153 @@ int establish_crypto(ziti_connection conn, message *msg) {
         }
     }
 
-    int rc = init_crypto(&conn->key_ex, &conn->key_pair, peer_key, conn->state == Accepting);
+    struct conn_keys *keys = conn->crypto->keys;
+    int rc = init_crypto(&keys->key_ex, &keys->key_pair, peer_key, conn->state == Accepting);
 
     if (rc != 0) {
         CONN_LOG(ERROR, "failed to establish encryption: crypto error");
-        free_key_exchange(&conn->key_ex);
+        free_key_exchange(&keys->key_ex);
         return ZITI_CRYPTO_FAIL;
     }
     return ZITI_OK;
 }
 
+static void send_crypto_msg(ziti_connection conn, message *m) {
+    struct ziti_write_req_s *wr = write_req_new(conn->ziti_ctx);
+    wr->conn = conn;
+    wr->cb = crypto_wr_cb;
+    conn->write_reqs++;
+    send_message(conn, m, wr);
+}
+
+/**
+ * switches outbound stream to AES-256-GCM once both sides offered it, see e2e_stream.h.
+ * offloaded jobs own both streams until they are done, crypto_out_done/crypto_in_done check again
+ */
+static void conn_e2e_switch(struct ziti_conn *conn) {
+    struct conn_crypto *crypto = conn->crypto;
+    if (crypto == NULL || conn->crypt_out_job != NULL || conn->crypt_in_job != NULL ||
+        !e2e_switch_ready(&crypto->crypt_o, &crypto->crypt_i) ||
+        conn->fin_sent || conn->state < Connecting || conn->state > Accepting) {
+        return;
+    }
+
+    message *m = create_message(conn, ContentTypeData, E2E_ABYTES);
+    if (e2e_push_switch(&crypto->crypt_o, m->body) != 0) {
+        CONN_LOG(ERROR, "failed to start AES-256-GCM stream");
+        message_release(m);
+        conn_set_state(conn, Disconnected);
+        conn->data_cb(conn, NULL, ZITI_CRYPTO_FAIL);
+        return;
+    }
+    CONN_LOG(DEBUG, "switching to AES-256-GCM");
+    conn->ziti_ctx->path_stats.e2e_aes_gcm++;
+    send_crypto_msg(conn, m);
+}
+
 static int send_crypto_header(ziti_connection conn) {
     if (conn->encrypted) {
-        size_t crypto_header_len = crypto_secretstream_xchacha20poly1305_headerbytes();
-        message *m = create_message(conn, ContentTypeData, crypto_header_len);
-        crypto_secretstream_xchacha20poly1305_init_push(&conn->crypt_o, m->body, conn->key_ex.tx);
-        NEWP(wr, struct ziti_write_req_s);
-        wr->conn = conn;
-        wr->cb = crypto_wr_cb;
-        conn->write_reqs++;
-        send_message(conn, m, wr);
+        message *m = create_message(conn, ContentTypeData, E2E_HEADER_BYTES);
+        e2e_init_push(&conn->crypto->crypt_o, m->body, conn->crypto->keys->key_ex.tx, conn->ziti_ctx->opts.e2e_aes_gcm);
+        FREE(conn->crypto->keys->key_ex.tx);
+        conn_keys_done(conn->crypto);
+        send_crypto_msg(conn, m);
+
+        if (conn->crypto->crypt_o.local_offer) {
+            m = create_message(conn, ContentTypeData, E2E_ABYTES);
+            e2e_push_offer(&conn->crypto->crypt_o, m->body);
+            send_crypto_msg(conn, m);
+            // peer's offer may have arrived already
+            conn_e2e_switch(conn);
+        }
     }
     return ZITI_OK;
 }
 
 static void on_flush(uv_idle_t *fl) {
-    ziti_connection conn = fl->data;
-    if (conn == NULL) {
-        uv_close((uv_handle_t *) fl, (uv_close_cb) free);
-        return;
-    }
+    ziti_context ztx = fl->data;
+
+    // only process connections queued before this pass,
+    // connections with more pending data go to the back of the queue
+    size_t count = ztx->flush_queue_len;
+    while (count-- > 0 && !TAILQ_EMPTY(&ztx->flush_queue)) {
+        ziti_connection conn = TAILQ_FIRST(&ztx->flush_queue);
+        TAILQ_REMOVE(&ztx->flush_queue, conn, flush_next);
+        ztx->flush_queue_len--;
+        conn->flush_queued = false;
+
+        bool more_to_client = flush_to_client(conn);
+        bool more_to_service = flush_to_service(conn);
 
-    bool more_to_client = flush_to_client(conn);
-    bool more_to_service = flush_to_service(conn);
+        if (more_to_client || more_to_service) {
+            flush_connection(conn);
+        }
+    }
 
-    if (!more_to_client && !more_to_service) {
-        CONN_LOG(TRACE, "stopping flusher");
+    if (TAILQ_EMPTY(&ztx->flush_queue)) {
+        ZTX_LOG(TRACE, "stopping connection flusher");
         uv_idle_stop(fl);
     }
 }
 
 static void flush_connection(ziti_connection conn) {
-    if (conn->flusher) {
-        CONN_LOG(TRACE, "starting flusher");
-        uv_idle_start(conn->flusher, on_flush);
+    if (!conn->flush_enabled || conn->flush_queued) {
+        return;
     }
+
+    ziti_context ztx = conn->ziti_ctx;
+    CONN_LOG(TRACE, "scheduling flush");
+    conn->flush_queued = true;
+    TAILQ_INSERT_TAIL(&ztx->flush_queue, conn, flush_next);
+    ztx->flush_queue_len++;
+    uv_idle_start(ztx->conn_flusher, on_flush);
 }
 
 static bool flush_to_service(ziti_connection conn) {
 
     // still connecting
     if (conn->channel == NULL) { return false; }
-    if (conn->state < Connected || conn->state == Accepting) { return false; }
+    bool early = conn->state == Connecting && conn->early_data;
+    if ((conn->state < Connected && !early) || conn->state == Accepting) { return false; }
+
+    update_crypto_offload(conn);
 
     int count = 0;
-    while (!TAILQ_EMPTY(&conn->wreqs)) {
+    while (!TAILQ_EMPTY(&conn->wreqs) && count < FLUSH_WRITE_BUDGET) {
+        // worker owns outbound crypto state, writes are resumed once its job completes
+        if (conn->crypt_out_job) {
+            return false;
+        }
+
+        if (conn->crypto_offload && conn->state == Connected && crypto_offload_outbound(conn)) {
+            count++;
+            continue;
+        }
+
         struct ziti_write_req_s *req = TAILQ_FIRST(&conn->wreqs);
         TAILQ_REMOVE(&conn->wreqs, req, _next);
 
-        if (conn->state == Connected) {
+        if (conn->state == Connected || early) {
             conn->write_reqs++;
-            ziti_write_req(req);
+            if (early) {
+                conn->early_sent = true;
+                conn->ziti_ctx->path_stats.early_writes++;
+            }
+            if (conn->coalesce && can_coalesce(req)) {
+                ziti_write_coalesced(conn, req);
+            } else {
+                ziti_write_req(req);
+            }
             count++;
         } else {
             CONN_LOG(DEBUG, "got write req in invalid state[%s]", conn_state_str[conn->state]);
             conn->write_reqs--;
+            conn_write_release(conn, req);
 
             if (req->cb) {
                 req->cb(conn, ZITI_INVALID_STATE, req->ctx);
             }
-            free(req);
+            free_write_req(req);
         }
     }
     CONN_LOG(TRACE, "flushed %d messages", count);
@@ -772,32 +1443,75 @@ static bool flush_to_service(ziti_connection conn) {
 
 static bool flush_to_client(ziti_connection conn) {
     while (!TAILQ_EMPTY(&conn->in_q)) {
+        // messages wait for decryption of the ones ahead of them
+        if (conn->crypt_in_job || (conn->crypto_offload && crypto_offload_inbound(conn))) {
+            break;
+        }
         message *m = TAILQ_FIRST(&conn->in_q);
         TAILQ_REMOVE(&conn->in_q, m, _next);
         process_edge_message(conn, m);
-        pool_return_obj(m);
+        message_release(m);
+    }
+
+    if (conn->read_paused) {
+        CONN_LOG(VERBOSE, "reading paused: %zu bytes buffered", buffer_available(conn->inbound));
+        return false;
     }
 
     CONN_LOG(VERBOSE, "%zu bytes available", buffer_available(conn->inbound));
-    int flushes = 128;
-    while (buffer_available(conn->inbound) > 0 && (flushes--) > 0) {
-        uint8_t *chunk;
-        ssize_t chunk_len = buffer_get_next(conn->inbound, 16 * 1024, &chunk);
-        ssize_t consumed = conn->data_cb(conn, chunk, chunk_len);
-        CONN_LOG(TRACE, "client consumed %zd out of %zd bytes", consumed, chunk_len);
-
-        if (consumed < 0) {
-            CONN_LOG(WARN, "client indicated error[%zd] accepting data (%zd bytes buffered)",
-                     consumed, buffer_available(conn->inbound));
-        } else if (consumed < chunk_len) {
-            buffer_push_back(conn->inbound, (chunk_len - consumed));
-            CONN_LOG(VERBOSE, "client stalled: %zd bytes buffered", buffer_available(conn->inbound));
-            break;
+    if (conn->readable_cb) {
+        size_t avail = buffer_available(conn->inbound);
+        if (avail > 0) {
+            // app is notified once, it pulls data with ziti_conn_read() when it is ready
+            if (conn->read_notify) {
+                conn->read_notify = false;
+                conn->readable_cb(conn, avail);
+            }
+            return false;
         }
     }
 
-    if (buffer_available(conn->inbound) > 0) {
-        CONN_LOG(VERBOSE, "%zu bytes still available", buffer_available(conn->inbound));
+    int flushes = FLUSH_READ_BUDGET;
+    bool stalled = false;
+    uv_buf_t iov[BUFFER_IOV_MAX];
+    while (conn->readable_cb == NULL && !stalled && flushes > 0) {
+        int count = buffer_peek_iov(conn->inbound, iov, BUFFER_IOV_MAX);
+        if (count == 0) {
+            break;
+        }
+
+        size_t total = 0;
+        for (int i = 0; i < count && !stalled && flushes > 0; i++) {
+            size_t off = 0;
+            while (off < iov[i].len && flushes-- > 0) {
+                size_t chunk_len = MIN(iov[i].len - off, FLUSH_CHUNK_SIZE);
+                ssize_t consumed = conn->data_cb(conn, (uint8_t *) iov[i].base + off, chunk_len);
+                CONN_LOG(TRACE, "client consumed %zd out of %zu bytes", consumed, chunk_len);
+
+                if (consumed < 0) {
+                    CONN_LOG(WARN, "client indicated error[%zd] accepting data (%zu bytes buffered)",
+                             consumed, buffer_available(conn->inbound));
+                    consumed = (ssize_t) chunk_len;
+                }
+                off += consumed;
+                total += consumed;
+                if ((size_t) consumed < chunk_len) {
+                    stalled = true;
+                    break;
+                }
+            }
+        }
+        buffer_consume(conn->inbound, total);
+        if (flushes <= 0 && buffer_available(conn->inbound) > 0) {
+            conn->ziti_ctx->path_stats.flush_budget_hits++;
+        }
+        if (stalled) {
+            CONN_LOG(VERBOSE, "client stalled: %zd bytes buffered", buffer_available(conn->inbound));
+        }
+    }
+
+    if (buffer_available(conn->inbound) > 0) {
+        CONN_LOG(VERBOSE, "%zu bytes still available", buffer_available(conn->inbound));
 
         return true;
     }
@@ -809,60 +1523,385 @@ static bool flush_to_client(ziti_connection conn) {
 
     if (conn->state == Disconnected) {
         if (conn->data_cb) {
-            conn->data_cb(conn, NULL, ZITI_CONN_CLOSED);
+            conn->data_cb(conn, NULL, conn->recv_overflow ? ZITI_CONNABORT : ZITI_CONN_CLOSED);
         }
     }
     return false;
 }
 
+/**
+ * channel stops reading when its message pool is exhausted, so pooled messages are retained only while
+ * the connection holds a few of them and the pool is not running low
+ */
+static bool can_retain_msg(struct ziti_conn *conn) {
+    if (buffer_available(conn->inbound) >= INBOUND_HANDOFF_LIMIT ||
+        buffer_owned_chunks(conn->inbound) >= INBOUND_PINNED_MAX) {
+        return false;
+    }
+
+    ziti_channel_t *ch = conn->channel;
+    if (ch == NULL || ch->in_msg_pool == NULL) {
+        return true;
+    }
+
+    size_t in_use, cap = pool_capacity(ch->in_msg_pool);
+    pool_usage(ch->in_msg_pool, &in_use, NULL);
+    return in_use < cap - cap / INBOUND_POOL_RESERVE;
+}
+
+/**
+ * hands message data over to the inbound buffer, the message is released once the data is consumed.
+ * inbound messages come from the channel pool, so a connection that is not drained by the application
+ * only pins a limited number of them, the rest of the data is copied
+ */
+static void conn_inbound_append(struct ziti_conn *conn, message *msg, uint8_t *data, size_t len) {
+    conn->read_notify = true;
+    if (can_retain_msg(conn)) {
+        buffer_append_owned(conn->inbound, data, len, message_retain(msg), (void (*)(void *)) message_release);
+    } else {
+        uint8_t *copy = malloc(len);
+        memcpy(copy, data, len);
+        conn->ziti_ctx->path_stats.allocs++;
+        conn->ziti_ctx->path_stats.bytes_copied += len;
+        buffer_append(conn->inbound, copy, len);
+    }
+    conn->inbound_max = MAX(conn->inbound_max, buffer_available(conn->inbound));
+}
+
+/**
+ * edge protocol has no per-connection flow control, so a connection that application is not reading
+ * is shed once its buffered data exceeds receive window, other connections on the channel are not affected
+ */
+static bool check_recv_window(struct ziti_conn *conn, message *msg) {
+    size_t window = conn->ziti_ctx->opts.conn_recv_window;
+    size_t buffered = buffer_available(conn->inbound);
+    if (window == 0 || buffered + msg->header.body_len <= window) {
+        return true;
+    }
+
+    CONN_LOG(WARN, "receive window[%zu] exceeded with %zu bytes buffered, aborting connection", window, buffered);
+    conn->recv_overflow = true;
+    ziti_disconnect(conn);
+    flush_connection(conn);
+    return false;
+}
+
+/**
+ * datagram mode: message is handed to the application right away, or dropped if it is not ready for it.
+ * a late datagram is worth less than the next one, so nothing is queued
+ */
+static void conn_inbound_datagram(struct ziti_conn *conn, uint8_t *data, size_t len) {
+    ssize_t consumed = conn->read_paused ? 0 : conn->data_cb(conn, data, (ssize_t) len);
+    if (consumed < 0) {
+        CONN_LOG(WARN, "client indicated error[%zd] accepting datagram", consumed);
+    } else if ((size_t) consumed < len) {
+        CONN_LOG_RATE(DEBUG, "dropped datagram[%zu bytes]", len);
+        conn->ziti_ctx->path_stats.dgrams_dropped++;
+    }
+}
+
+static void conn_inbound_payload(struct ziti_conn *conn, message *msg, uint8_t *data, size_t len) {
+    if (conn->datagram) {
+        conn_inbound_datagram(conn, data, len);
+    } else {
+        conn_inbound_append(conn, msg, data, len);
+    }
+}
+
+static void conn_inbound_flags(struct ziti_conn *conn, message *msg) {
+    int32_t flags;
+    if (message_get_int32_header(msg, FlagsHeader, &flags) && (flags & EDGE_FIN)) {
+        conn->fin_recv = true;
+    }
+}
+
 void conn_inbound_data_msg(ziti_connection conn, message *msg) {
-    uint8_t *plain_text = NULL;
-    if (conn->state >= Disconnected || conn->fin_recv) {
-        CONN_LOG(WARN, "inbound data on closed connection");
+    if (conn->state >= Disconnected || conn->fin_recv || conn->recv_overflow) {
+        CONN_LOG_RATE(WARN, "inbound data on closed connection");
+        return;
+    }
+
+    if (msg->header.body_len > 0 && !conn->datagram && !check_recv_window(conn, msg)) {
         return;
     }
 
     if (conn->encrypted) {
         PREP(crypto);
         // first message is expected to be peer crypto header
-        if (conn->key_ex.rx != NULL) {
+        if (conn_crypto_header_pending(conn)) {
+            struct key_exchange *key_ex = &conn->crypto->keys->key_ex;
             CONN_LOG(VERBOSE, "processing crypto header(%d bytes)", msg->header.body_len);
-            TRY(crypto, msg->header.body_len != crypto_secretstream_xchacha20poly1305_HEADERBYTES);
-            TRY(crypto, crypto_secretstream_xchacha20poly1305_init_pull(&conn->crypt_i, msg->body, conn->key_ex.rx));
+            TRY(crypto, msg->header.body_len != E2E_HEADER_BYTES);
+            TRY(crypto, e2e_init_pull(&conn->crypto->crypt_i, msg->body, key_ex->rx, conn->ziti_ctx->opts.e2e_aes_gcm));
             CONN_LOG(VERBOSE, "processed crypto header");
-            FREE(conn->key_ex.rx);
+            FREE(key_ex->rx);
+            conn_keys_done(conn->crypto);
         } else {
-            unsigned long long plain_len;
-            unsigned char tag;
+            size_t plain_len;
             if (msg->header.body_len > 0) {
-                plain_text = malloc(msg->header.body_len - crypto_secretstream_xchacha20poly1305_ABYTES);
+                // decrypt in place: plain text replaces cipher text right after the tag byte
+                uint8_t *plain_text = msg->body + 1;
                 CONN_LOG(VERBOSE, "decrypting %d bytes", msg->header.body_len);
-                TRY(crypto, crypto_secretstream_xchacha20poly1305_pull(&conn->crypt_i,
-                                                                       plain_text, &plain_len, &tag,
-                                                                       msg->body, msg->header.body_len, NULL, 0));
-                CONN_LOG(VERBOSE, "decrypted %lld bytes", plain_len);
-                buffer_append(conn->inbound, plain_text, plain_len);
-                metrics_rate_update(&conn->ziti_ctx->down_rate, (int64_t) plain_len);
+                TRY(crypto, e2e_pull(&conn->crypto->crypt_i, plain_text, &plain_len, msg->body, msg->header.body_len));
+                CONN_LOG(VERBOSE, "decrypted %zu bytes", plain_len);
+                if (plain_len > 0) {
+                    conn_inbound_payload(conn, msg, plain_text, plain_len);
+                } else {
+                    conn_e2e_switch(conn);
+                }
+                conn_count_down(conn, plain_len);
             }
         }
 
         CATCH(crypto) {
-            FREE(plain_text);
             conn_set_state(conn, Disconnected);
             conn->data_cb(conn, NULL, ZITI_CRYPTO_FAIL);
             return;
         }
     } else if (msg->header.body_len > 0) {
-        plain_text = malloc(msg->header.body_len);
-        memcpy(plain_text, msg->body, msg->header.body_len);
-        buffer_append(conn->inbound, plain_text, msg->header.body_len);
-        metrics_rate_update(&conn->ziti_ctx->down_rate, msg->header.body_len);
+        conn_inbound_payload(conn, msg, msg->body, msg->header.body_len);
+        conn_count_down(conn, msg->header.body_len);
     }
 
-    int32_t flags;
-    if (message_get_int32_header(msg, FlagsHeader, &flags) && (flags & EDGE_FIN)) {
-        conn->fin_recv = true;
+    conn_inbound_flags(conn, msg);
+}
+
+static void update_crypto_offload(struct ziti_conn *conn) {
+    unsigned int threshold = conn->ziti_ctx->opts.crypto_offload_rate;
+    if (threshold == 0 || !conn->encrypted) {
+        return;
+    }
+
+    uint64_t now = uv_now(conn->ziti_ctx->loop);
+    uint64_t elapsed = now - conn->offload_ts;
+    if (elapsed < CRYPTO_RATE_INTERVAL) {
+        return;
+    }
+
+    uint64_t bytes = conn->bytes_up + conn->bytes_down;
+    uint64_t rate = (bytes - conn->offload_mark) * 1000 / elapsed;
+    // turns off at half the rate, so that flows around the threshold do not flap
+    bool offload = conn->crypto_offload ? rate * 2 >= threshold : rate >= threshold;
+    if (offload != conn->crypto_offload) {
+        CONN_LOG(DEBUG, "crypto offload %s at %" PRIu64 " bytes/s", offload ? "enabled" : "disabled", rate);
+        conn->crypto_offload = offload;
+    }
+    conn->offload_ts = now;
+    conn->offload_mark = bytes;
+}
+
+/**
+ * e2e streams are sequential, so every connection has at most one job per direction in flight,
+ * and new messages queue up behind it. parallelism comes from offloaded connections running side by side
+ */
+struct crypto_job_s {
+    uv_work_t w;
+    struct ziti_conn *conn;
+    bool outbound;
+    int count;
+    int failed; // index of the first message that failed to decrypt, [count] if none
+    struct {
+        message *msg;
+        struct ziti_write_req_s *req; // outbound only
+        size_t len; // plain text length
+    } items[CRYPTO_JOB_MAX];
+};
+
+static void crypto_job_work(uv_work_t *w) {
+    struct crypto_job_s *job = w->data;
+    struct ziti_conn *conn = job->conn;
+
+    for (int i = 0; i < job->count; i++) {
+        message *m = job->items[i].msg;
+        if (job->outbound) {
+            e2e_push(&conn->crypto->crypt_o, m->body, m->body + 1, job->items[i].len);
+        } else {
+            if (e2e_pull(&conn->crypto->crypt_i, m->body + 1, &job->items[i].len, m->body, m->header.body_len) != 0) {
+                job->failed = i;
+                return;
+            }
+        }
+    }
+}
+
+static void crypto_out_done(struct crypto_job_s *job) {
+    struct ziti_conn *conn = job->conn;
+    conn->crypt_out_job = NULL;
+
+    for (int i = 0; i < job->count; i++) {
+        struct ziti_write_req_s *req = job->items[i].req;
+        message *m = job->items[i].msg;
+        if (conn->state == Connected && conn->channel != NULL) {
+            if (req->cb) {
+                wheel_timer_start(&conn->ziti_ctx->timers, &req->timeout, conn->timeout, ziti_write_timeout, req);
+            }
+            send_message(conn, m, req);
+        } else {
+            req->message = m;
+            conn->write_reqs--;
+            conn_write_release(conn, req);
+            if (req->cb) {
+                req->cb(conn, ZITI_INVALID_STATE, req->ctx);
+            }
+            free_write_req(req);
+        }
     }
+    conn_e2e_switch(conn);
+}
+
+static void crypto_in_done(struct crypto_job_s *job) {
+    struct ziti_conn *conn = job->conn;
+    conn->crypt_in_job = NULL;
+
+    for (int i = 0; i < job->count; i++) {
+        message *m = job->items[i].msg;
+        bool open = conn->state < Disconnected && !conn->fin_recv && !conn->recv_overflow;
+        if (open && i == job->failed) {
+            CONN_LOG(ERROR, "failed to decrypt message");
+            conn_set_state(conn, Disconnected);
+            conn->data_cb(conn, NULL, ZITI_CRYPTO_FAIL);
+        } else if (open && (conn->datagram || check_recv_window(conn, m))) {
+            size_t len = job->items[i].len;
+            if (len > 0) {
+                conn_inbound_payload(conn, m, m->body + 1, len);
+            }
+            conn_count_down(conn, len);
+            conn_inbound_flags(conn, m);
+        }
+        message_release(m);
+    }
+    conn_e2e_switch(conn);
+}
+
+static void crypto_job_done(uv_work_t *w, int status) {
+    struct crypto_job_s *job = w->data;
+    struct ziti_conn *conn = job->conn;
+
+    conn->ziti_ctx->path_stats.crypto_offloaded += job->count;
+    if (job->outbound) {
+        crypto_out_done(job);
+    } else {
+        crypto_in_done(job);
+    }
+    free(job);
+
+    flush_connection(conn);
+}
+
+static void crypto_job_start(struct crypto_job_s *job) {
+    job->w.data = job;
+    job->failed = job->count;
+    job->conn->ziti_ctx->path_stats.allocs++;
+    uv_queue_work(job->conn->ziti_ctx->loop, &job->w, crypto_job_work, crypto_job_done);
+}
+
+// write request that can be encrypted in a single message
+static bool can_offload_write(struct ziti_conn *conn, struct ziti_write_req_s *req) {
+    if (req->eof || req->close) {
+        return false;
+    }
+    return req->message != NULL || req->iov == NULL || conn->datagram || req->len <= WRITE_SEGMENT_SIZE;
+}
+
+/**
+ * moves queued writes to a worker, if enough of them can go at once.
+ * messages get their headers (and edge sequence) now, and are sent in order when encrypted
+ */
+static bool crypto_offload_outbound(struct ziti_conn *conn) {
+    if (!conn->encrypted) {
+        return false;
+    }
+
+    size_t total = 0;
+    int count = 0;
+    struct ziti_write_req_s *req;
+    TAILQ_FOREACH(req, &conn->wreqs, _next) {
+        if (count == CRYPTO_JOB_MAX || !can_offload_write(conn, req)) {
+            break;
+        }
+        total += req->len;
+        count++;
+    }
+    if (total < CRYPTO_OFFLOAD_MIN) {
+        return false;
+    }
+
+    size_t abytes = E2E_ABYTES;
+    NEWP(job, struct crypto_job_s);
+    job->conn = conn;
+    job->outbound = true;
+    for (int i = 0; i < count; i++) {
+        req = TAILQ_FIRST(&conn->wreqs);
+        TAILQ_REMOVE(&conn->wreqs, req, _next);
+        conn->write_reqs++;
+
+        message *m = req->message;
+        req->message = NULL;
+        if (m) {
+            write_data_headers(conn, m);
+        } else {
+            // plain text goes right past the tag byte, as with ziti_alloc_write_buf()
+            m = create_message(conn, ContentTypeData, req->len + abytes);
+            uint8_t *p = m->body + 1;
+            if (req->iov) {
+                for (unsigned int j = 0; j < req->iov_count; j++) {
+                    memcpy(p, req->iov[j].base, req->iov[j].len);
+                    p += req->iov[j].len;
+                }
+                FREE(req->iov);
+                req->iov_count = 0;
+            } else {
+                memcpy(p, req->buf, req->len);
+            }
+            conn->ziti_ctx->path_stats.bytes_copied += req->len;
+        }
+        job->items[i].msg = m;
+        job->items[i].req = req;
+        job->items[i].len = req->len;
+    }
+    job->count = count;
+
+    conn->crypt_out_job = job;
+    crypto_job_start(job);
+    return true;
+}
+
+/**
+ * moves received Data messages at the head of the inbound queue to a worker, if enough of them can go at once.
+ * messages behind them (including close) are processed after they are delivered
+ */
+static bool crypto_offload_inbound(struct ziti_conn *conn) {
+    if (!conn->encrypted || conn->datagram || conn_crypto_header_pending(conn) ||
+        (conn->state != Connected && conn->state != CloseWrite)) {
+        return false;
+    }
+
+    size_t total = 0;
+    int count = 0;
+    message *m;
+    TAILQ_FOREACH(m, &conn->in_q, _next) {
+        if (count == CRYPTO_JOB_MAX || m->header.content != ContentTypeData || m->header.body_len == 0) {
+            break;
+        }
+        total += m->header.body_len;
+        count++;
+    }
+    if (total < CRYPTO_OFFLOAD_MIN) {
+        return false;
+    }
+
+    NEWP(job, struct crypto_job_s);
+    job->conn = conn;
+    for (int i = 0; i < count; i++) {
+        m = TAILQ_FIRST(&conn->in_q);
+        TAILQ_REMOVE(&conn->in_q, m, _next);
+        job->items[i].msg = m;
+    }
+    job->count = count;
+
+    conn->crypt_in_job = job;
+    crypto_job_start(job);
+    return true;
 }
 
 static void restart_connect(struct ziti_conn *conn) {
@@ -878,20 +1917,29 @@ static void restart_connect(struct ziti_conn *conn) {
     }
 
     CONN_LOG(DEBUG, "restarting connect sequence");
+    race_abandon(conn);
     conn->channel = NULL;
+    conn->early_data = false;
 
     process_connect(conn);
 }
 
+static void conn_accepted(struct ziti_conn *conn) {
+    if (conn->parent && conn->accept_start) {
+        ziti_server_accepted(conn->parent, uv_now(conn->ziti_ctx->loop) - conn->accept_start);
+    }
+}
+
 void connect_reply_cb(void *ctx, message *msg, int err) {
     struct ziti_conn *conn = ctx;
     struct ziti_conn_req *req = conn->conn_req;
 
-    if (req->conn_timeout) {
-        uv_timer_stop(req->conn_timeout);
+    req->waiter = NULL;
+    if (race_settle(conn, msg)) {
+        return;
     }
 
-    req->waiter = NULL;
+    wheel_timer_stop(&req->conn_timeout);
     if (err != 0 && msg == NULL) {
         CONN_LOG(ERROR, "failed to %s [%d/%s]", "connect", err, uv_strerror(err));
         conn_set_state(conn, Disconnected);
@@ -918,6 +1966,13 @@ void connect_reply_cb(void *ctx, message *msg, int err) {
 
                 ziti_channel_rem_receiver(conn->channel, conn->conn_id);
                 conn->channel = NULL;
+                if (conn->early_sent) {
+                    // early data went to the failed attempt and cannot be replayed
+                    CONN_LOG(WARN, "cannot retry connect after sending early data");
+                    conn_set_state(conn, Disconnected);
+                    complete_conn_req(conn, ZITI_CONN_CLOSED);
+                    break;
+                }
                 restart_connect(conn);
             } else {
                 CONN_LOG(ERROR, "failed to %s, reason=%*.*s",
@@ -931,6 +1986,7 @@ void connect_reply_cb(void *ctx, message *msg, int err) {
         case ContentTypeStateConnected:
             if (conn->state == Connecting) {
                 CONN_LOG(TRACE, "connected");
+                conn_mark(conn, DIAL_PHASE_CONNECT);
                 int rc = ZITI_OK;
                 if (conn->encrypted) {
                     rc = establish_crypto(conn, msg);
@@ -945,6 +2001,7 @@ void connect_reply_cb(void *ctx, message *msg, int err) {
                 if (conn->encrypted) {
                     send_crypto_header(conn);
                 }
+                conn_accepted(conn);
                 conn_set_state(conn, Connected);
                 complete_conn_req(conn, ZITI_OK);
             } else if (conn->state >= Timedout) {
@@ -959,39 +2016,11 @@ void connect_reply_cb(void *ctx, message *msg, int err) {
     }
 }
 
-static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t *ch) {
+static struct waiter_s *send_connect(struct ziti_conn *conn, ziti_channel_t *ch, uint32_t content_type,
+                                     reply_cb cb, bool new_key) {
     struct ziti_conn_req *req = conn->conn_req;
     ziti_net_session *s = req->session;
 
-    uint32_t content_type;
-    switch (conn->state) {
-        case Connecting:
-            content_type = ContentTypeConnect;
-            break;
-        case Disconnected:
-            CONN_LOG(WARN, "channel did not connect in time");
-            return ZITI_OK;
-        default:
-            CONN_LOG(ERROR, "in unexpected state[%d]", conn->state);
-            return ZITI_WTF;
-    }
-
-    if (!ziti_is_session_valid(conn->ziti_ctx, s, req->service_id, req->session_type)) {
-        CONN_LOG(DEBUG, "session is no longer valid");
-        if (req->session_type == ziti_session_types.Bind) {
-            free_ziti_net_session(req->session);
-            FREE(req->session);
-        }
-        req->session = NULL;
-        restart_connect(conn);
-        return ZITI_OK;
-    }
-
-    CONN_LOG(TRACE, "ch[%d] => Edge Connect request token[%s]", ch->id, s->token);
-    conn->channel = ch;
-    ziti_channel_add_receiver(ch, conn->conn_id, conn,
-                              (void (*)(void *, message *, int)) queue_edge_message);
-
     int32_t conn_id = htole32(conn->conn_id);
     int32_t msg_seq = htole32(0);
 
@@ -1011,11 +2040,6 @@ static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t
                     .length = strlen(conn->ziti_ctx->api_session->identity->name),
                     .value = conn->ziti_ctx->api_session->identity->name,
             },
-            {
-                    .header_id = PublicKeyHeader,
-                    .length = sizeof(conn->key_pair.pk),
-                    .value = conn->key_pair.pk,
-            },
             // blank hdr_t's to be filled in if needed by options
             {
                     .header_id = -1,
@@ -1035,7 +2059,14 @@ static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t
     };
     int nheaders = 3;
     if (conn->encrypted) {
-        init_key_pair(&conn->key_pair);
+        // raced attempt offers the same key, so that either reply completes the key exchange
+        struct conn_crypto *crypto = conn_crypto_init(conn);
+        if (new_key) {
+            key_pool_get(conn->ziti_ctx->keys, &crypto->keys->key_pair);
+        }
+        headers[nheaders].header_id = PublicKeyHeader;
+        headers[nheaders].length = sizeof(crypto->keys->key_pair.pk);
+        headers[nheaders].value = crypto->keys->key_pair.pk;
         nheaders++;
     }
     if (req->dial_opts != NULL) {
@@ -1053,14 +2084,235 @@ static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t
         }
     }
 
-    req->waiter = ziti_channel_send_for_reply(ch, content_type, headers, nheaders,
-                                              s->token, strlen(s->token), connect_reply_cb, conn);
+    return ziti_channel_send_for_reply(ch, content_type, headers, nheaders,
+                                       s->token, strlen(s->token), cb, conn);
+}
+
+// close our side of a connect attempt that lost the race (or was abandoned)
+static void race_close(struct ziti_conn *conn, ziti_channel_t *ch) {
+    ziti_channel_rem_receiver(ch, conn->conn_id);
+
+    int32_t conn_id = htole32(conn->conn_id);
+    hdr_t headers[] = {
+            {
+                    .header_id = ConnIdHeader,
+                    .length = sizeof(conn_id),
+                    .value = (uint8_t *) &conn_id
+            },
+    };
+    message *m = message_new_out(conn->ziti_ctx->out_msgs, ContentTypeStateClosed, headers, 1, 0);
+    ziti_channel_send_message(ch, m, NULL);
+}
+
+static void race_abandon(struct ziti_conn *conn) {
+    struct ziti_conn_req *req = conn->conn_req;
+    wheel_timer_stop(&req->race_timer);
+    if (req->race_ch) {
+        ziti_channel_remove_waiter(req->race_ch, req->race_waiter);
+        race_close(conn, req->race_ch);
+        req->race_waiter = NULL;
+        req->race_ch = NULL;
+    }
+}
+
+/**
+ * first attempt got its reply: the raced attempt is closed if this one connected,
+ * or takes over if this one failed.
+ * @return true if the raced attempt is still pending
+ */
+static bool race_settle(struct ziti_conn *conn, message *msg) {
+    struct ziti_conn_req *req = conn->conn_req;
+    wheel_timer_stop(&req->race_timer);
+    if (req->race_ch == NULL) {
+        return false;
+    }
+
+    if (msg != NULL && msg->header.content == ContentTypeStateConnected) {
+        CONN_LOG(DEBUG, "ch[%d] won connect race over ch[%d]", conn->channel->id, req->race_ch->id);
+        race_abandon(conn);
+        return false;
+    }
+
+    CONN_LOG(DEBUG, "connect failed on ch[%d], continuing on ch[%d]", conn->channel->id, req->race_ch->id);
+    ziti_channel_rem_receiver(conn->channel, conn->conn_id);
+    conn->channel = req->race_ch;
+    ziti_channel_add_receiver(conn->channel, conn->conn_id, conn,
+                              (void (*)(void *, message *, int)) queue_edge_message);
+    req->waiter = req->race_waiter;
+    req->race_waiter = NULL;
+    req->race_ch = NULL;
+    return true;
+}
+
+static void race_reply_cb(void *ctx, message *msg, int err) {
+    struct ziti_conn *conn = ctx;
+    struct ziti_conn_req *req = conn->conn_req;
+    ziti_channel_t *ch = req->race_ch;
+
+    // took over after the first attempt failed
+    if (ch == NULL) {
+        connect_reply_cb(ctx, msg, err);
+        return;
+    }
+
+    req->race_waiter = NULL;
+    req->race_ch = NULL;
+    if (msg == NULL || msg->header.content != ContentTypeStateConnected || conn->state != Connecting) {
+        CONN_LOG(DEBUG, "raced connect on ch[%d] did not succeed", ch->id);
+        if (msg != NULL && msg->header.content == ContentTypeStateConnected) {
+            race_close(conn, ch);
+        }
+        return;
+    }
+
+    CONN_LOG(DEBUG, "ch[%d] won connect race over ch[%d]", ch->id, conn->channel->id);
+    conn->ziti_ctx->path_stats.race_wins++;
+    ziti_channel_remove_waiter(conn->channel, req->waiter);
+    req->waiter = NULL;
+    race_close(conn, conn->channel);
+
+    conn->channel = ch;
+    ziti_channel_add_receiver(ch, conn->conn_id, conn,
+                              (void (*)(void *, message *, int)) queue_edge_message);
+    connect_reply_cb(ctx, msg, err);
+}
+
+// next best connected edge router of the session, other than the one the first attempt went to
+static ziti_channel_t *race_select_channel(struct ziti_conn *conn) {
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+    struct ziti_conn_req *req = conn->conn_req;
+    ziti_channel_t *current = conn->channel->primary ? conn->channel->primary : conn->channel;
+
+    size_t num_ers = model_list_size(&req->session->edge_routers);
+    ziti_channel_t **candidates = calloc(num_ers, sizeof(ziti_channel_t *));
+    ziti_router_load *loads = calloc(num_ers, sizeof(ziti_router_load));
+    int count = 0;
+
+    ziti_edge_router *er;
+    MODEL_LIST_FOREACH(er, req->session->edge_routers) {
+        const char *tls = model_map_get(&er->protocols, "tls");
+        if (tls == NULL) {
+            tls = model_map_get(&er->ingress, "tls");
+        }
+
+        ziti_channel_t *ch = tls ? model_map_get(&ztx->channels, tls) : NULL;
+        if (ch != NULL && ch != current && ch->state == Connected) {
+            candidates[count] = ch;
+            ziti_channel_load(ch, &loads[count]);
+            count++;
+        }
+    }
+
+    ziti_channel_t *result = NULL;
+    if (count > 0) {
+        ziti_dial_opts *opts = req->dial_opts;
+        int idx = -1;
+        if (opts->router_select) {
+            idx = opts->router_select(loads, count, opts->router_select_ctx);
+        }
+        if (idx < 0 || idx >= count) {
+            idx = select_router(loads, count);
+        }
+        result = candidates[idx];
+    }
+
+    free(candidates);
+    free(loads);
+    return result;
+}
+
+static void race_timeout(wheel_timer_t *t) {
+    struct ziti_conn *conn = t->data;
+    struct ziti_conn_req *req = conn->conn_req;
+
+    if (conn->state != Connecting || conn->channel == NULL || req->waiter == NULL || req->race_ch != NULL) {
+        return;
+    }
+
+    ziti_channel_t *ch = race_select_channel(conn);
+    if (ch == NULL) {
+        CONN_LOG(DEBUG, "no reply in %dms, no other edge router to try", req->dial_opts->race_delay_ms);
+        return;
+    }
+
+    ch = ziti_channel_for_conn(ch, conn->conn_id);
+    CONN_LOG(DEBUG, "no reply from ch[%d] in %dms, racing connect on ch[%d]",
+             conn->channel->id, req->dial_opts->race_delay_ms, ch->id);
+    conn->ziti_ctx->path_stats.raced_dials++;
+    req->race_ch = ch;
+    req->race_waiter = send_connect(conn, ch, ContentTypeConnect, race_reply_cb, false);
+}
+
+static int ziti_channel_start_connection(struct ziti_conn *conn, ziti_channel_t *ch) {
+    struct ziti_conn_req *req = conn->conn_req;
+    ziti_net_session *s = req->session;
+
+    uint32_t content_type;
+    switch (conn->state) {
+        case Connecting:
+            content_type = ContentTypeConnect;
+            break;
+        case Disconnected:
+            CONN_LOG(WARN, "channel did not connect in time");
+            return ZITI_OK;
+        default:
+            CONN_LOG(ERROR, "in unexpected state[%d]", conn->state);
+            return ZITI_WTF;
+    }
+
+    if (!ziti_is_session_valid(conn->ziti_ctx, s, req->service_id, req->session_type)) {
+        CONN_LOG(DEBUG, "session is no longer valid");
+        if (req->session_type == ziti_session_types.Bind) {
+            free_ziti_net_session(req->session);
+            FREE(req->session);
+        }
+        req->session = NULL;
+        restart_connect(conn);
+        return ZITI_OK;
+    }
+
+    ch = ziti_channel_for_conn(ch, conn->conn_id);
+    conn_mark(conn, DIAL_PHASE_CHANNEL);
+    CONN_LOG(TRACE, "ch[%d] => Edge Connect request token[%s]", ch->id, s->token);
+    conn->channel = ch;
+    ziti_channel_add_receiver(ch, conn->conn_id, conn,
+                              (void (*)(void *, message *, int)) queue_edge_message);
+
+    req->waiter = send_connect(conn, ch, content_type, connect_reply_cb, true);
+
+    if (req->dial_opts && req->dial_opts->race_delay_ms > 0 && !req->dial_opts->early_data) {
+        wheel_timer_start(&conn->ziti_ctx->timers, &req->race_timer, req->dial_opts->race_delay_ms,
+                          race_timeout, conn);
+    }
+
+    // end-to-end encryption needs the peer key from the reply
+    if (req->dial_opts && req->dial_opts->early_data && !conn->encrypted) {
+        conn->early_data = true;
+        if (!TAILQ_EMPTY(&conn->wreqs)) {
+            CONN_LOG(DEBUG, "sending early data");
+            flush_connection(conn);
+        }
+    }
 
     return ZITI_OK;
 }
 
 
 
+int ziti_conn_get_transfer_stats(ziti_connection conn, ziti_transfer_stats *stats) {
+    if (conn->type != Transport) {
+        return ZITI_INVALID_STATE;
+    }
+
+    *stats = (ziti_transfer_stats) {
+            .bytes_up = conn->bytes_up,
+            .bytes_down = conn->bytes_down,
+            .msgs_up = conn->msgs_up,
+            .msgs_down = conn->msgs_down,
+    };
+    return ZITI_OK;
+}
+
 int ziti_accept(ziti_connection conn, ziti_conn_cb cb, ziti_data_cb data_cb) {
 
     if (conn->state == Disconnected) {
@@ -1071,14 +2323,12 @@ int ziti_accept(ziti_connection conn, ziti_conn_cb cb, ziti_data_cb data_cb) {
         return ZITI_INVALID_STATE;
     }
 
+    ziti_server_pending_done(conn);
     ziti_channel_t *ch = conn->channel;
     conn->data_cb = data_cb;
 
     TAILQ_INIT(&conn->in_q);
-    conn->flusher = calloc(1, sizeof(uv_idle_t));
-    uv_idle_init(conn->ziti_ctx->loop, conn->flusher);
-    conn->flusher->data = conn;
-    uv_unref((uv_handle_t *) &conn->flusher);
+    conn->flush_enabled = true;
 
     ziti_channel_add_receiver(ch, conn->conn_id, conn, (void (*)(void *, message *, int)) queue_edge_message);
 
@@ -1119,32 +2369,262 @@ int ziti_accept(ziti_connection conn, ziti_conn_cb cb, ziti_data_cb data_cb) {
     return ZITI_OK;
 }
 
-int ziti_write(ziti_connection conn, uint8_t *data, size_t length, ziti_write_cb write_cb, void *write_ctx) {
+static int check_write_state(ziti_connection conn) {
     if (conn->fin_sent) {
-        CONN_LOG(ERROR, "attempted write after ziti_close_write()");
+        CONN_LOG_RATE(ERROR, "attempted write after ziti_close_write()");
         return ZITI_INVALID_STATE;
     }
 
     if (conn->state != Connected && conn->state != Connecting) {
-        CONN_LOG(ERROR, "attempted write in invalid state[%s]", ziti_conn_state(conn));
+        CONN_LOG_RATE(ERROR, "attempted write in invalid state[%s]", ziti_conn_state(conn));
         return ZITI_INVALID_STATE;
     }
+    return ZITI_OK;
+}
+
+static void conn_count_down(ziti_connection conn, size_t len) {
+    metrics_rate_update(&conn->ziti_ctx->down_rate, (long) len);
+    conn->bytes_down += len;
+    conn->msgs_down++;
+
+    struct service_xfer *x = conn->svc_xfer;
+    if (x) {
+        metrics_rate_update(&x->down_rate, (long) len);
+        x->bytes_down += len;
+        x->msgs_down++;
+    }
+}
+
+static void queue_write_req(ziti_connection conn, struct ziti_write_req_s *req) {
+    conn_wake(conn);
+    metrics_rate_update(&conn->ziti_ctx->up_rate, req->len);
+    conn->bytes_up += req->len;
+    conn->msgs_up++;
+
+    struct service_xfer *x = conn->svc_xfer;
+    if (x) {
+        metrics_rate_update(&x->up_rate, req->len);
+        x->bytes_up += req->len;
+        x->msgs_up++;
+    }
+    req->queued = req->len;
+    conn->write_q_bytes += req->len;
 
-    NEWP(req, struct ziti_write_req_s);
+    TAILQ_INSERT_TAIL(&conn->wreqs, req, _next);
+    flush_connection(conn);
+    conn_check_writable(conn);
+}
+
+int ziti_write(ziti_connection conn, uint8_t *data, size_t length, ziti_write_cb write_cb, void *write_ctx) {
+    int rc = check_write_state(conn);
+    if (rc != ZITI_OK) {
+        return rc;
+    }
+
+    struct ziti_write_req_s *req = write_req_new(conn->ziti_ctx);
     req->conn = conn;
     req->buf = data;
     req->len = length;
     req->cb = write_cb;
     req->ctx = write_ctx;
     CONN_LOG(TRACE, "write %zd bytes", length);
-    metrics_rate_update(&conn->ziti_ctx->up_rate, length);
+    queue_write_req(conn, req);
 
-    TAILQ_INSERT_TAIL(&conn->wreqs, req, _next);
-    flush_connection(conn);
+    return 0;
+}
+
+int ziti_writev(ziti_connection conn, const uv_buf_t bufs[], unsigned int nbufs, ziti_write_cb write_cb, void *write_ctx) {
+    int rc = check_write_state(conn);
+    if (rc != ZITI_OK) {
+        return rc;
+    }
+
+    if (bufs == NULL && nbufs > 0) {
+        return ZITI_INVALID_ARGUMENT;
+    }
+
+    struct ziti_write_req_s *req = write_req_new(conn->ziti_ctx);
+    req->conn = conn;
+    req->cb = write_cb;
+    req->ctx = write_ctx;
+    req->iov_count = nbufs;
+    req->iov = calloc(nbufs > 0 ? nbufs : 1, sizeof(uv_buf_t));
+    for (unsigned int i = 0; i < nbufs; i++) {
+        req->iov[i] = bufs[i];
+        req->len += bufs[i].len;
+    }
+    CONN_LOG(TRACE, "writev %zd bytes in %u buffers", req->len, nbufs);
+    queue_write_req(conn, req);
 
     return 0;
 }
 
+static size_t write_buf_offset(ziti_connection conn) {
+    return offsetof(message, msgbuf) + HEADER_SIZE + DATA_HDRS_LEN + (conn->encrypted ? 1 : 0);
+}
+
+uint8_t *ziti_alloc_write_buf(ziti_connection conn, size_t len) {
+    if (conn->state != Connected) {
+        CONN_LOG(ERROR, "cannot allocate write buffer in state[%s]", ziti_conn_state(conn));
+        return NULL;
+    }
+
+    size_t abytes = conn->encrypted ? E2E_ABYTES : 0;
+    // headers are written when the buffer is sent to preserve message ordering
+    message *m = new_data_message(conn->ziti_ctx, ContentTypeData, len + abytes);
+
+    uint8_t *buf = (uint8_t *) m + write_buf_offset(conn);
+    model_map_set_key(&conn->write_bufs, &buf, sizeof(buf), m);
+    return buf;
+}
+
+// takes buffer back from application, NULL if it is not an outstanding buffer of this connection
+static message *write_buf_message(ziti_connection conn, uint8_t *buf) {
+    return model_map_remove_key(&conn->write_bufs, &buf, sizeof(buf));
+}
+
+void ziti_free_write_buf(ziti_connection conn, uint8_t *buf) {
+    if (buf == NULL) {
+        return;
+    }
+    message *m = write_buf_message(conn, buf);
+    if (m == NULL) {
+        CONN_LOG(ERROR, "buffer was not allocated with ziti_alloc_write_buf()");
+        return;
+    }
+    pool_return_obj(m);
+}
+
+int ziti_write_buf(ziti_connection conn, uint8_t *buf, size_t length, ziti_write_cb write_cb, void *write_ctx) {
+    if (buf == NULL) {
+        return ZITI_INVALID_ARGUMENT;
+    }
+
+    message *m = write_buf_message(conn, buf);
+    if (m == NULL) {
+        CONN_LOG(ERROR, "buffer was not allocated with ziti_alloc_write_buf()");
+        return ZITI_INVALID_ARGUMENT;
+    }
+
+    size_t abytes = conn->encrypted ? E2E_ABYTES : 0;
+    if (length + abytes > m->header.body_len) {
+        CONN_LOG(ERROR, "write length[%zd] exceeds buffer size", length);
+        pool_return_obj(m);
+        return ZITI_INVALID_ARGUMENT;
+    }
+
+    int rc = check_write_state(conn);
+    if (rc != ZITI_OK) {
+        pool_return_obj(m);
+        return rc;
+    }
+
+    // trim message to actual payload
+    m->header.body_len = (uint32_t) (length + abytes);
+    m->msgbuflen = HEADER_SIZE + m->header.headers_len + m->header.body_len;
+
+    struct ziti_write_req_s *req = write_req_new(conn->ziti_ctx);
+    req->conn = conn;
+    req->buf = buf;
+    req->len = length;
+    req->message = m;
+    req->cb = write_cb;
+    req->ctx = write_ctx;
+    CONN_LOG(TRACE, "write %zd bytes from owned buffer", length);
+    queue_write_req(conn, req);
+
+    return 0;
+}
+
+int ziti_conn_set_readable_cb(ziti_connection conn, ziti_readable_cb cb) {
+    if (conn == NULL || conn->type != Transport || (conn->datagram && cb != NULL)) {
+        return ZITI_INVALID_STATE;
+    }
+
+    conn->readable_cb = cb;
+    conn->read_notify = true;
+    flush_connection(conn);
+    return ZITI_OK;
+}
+
+ssize_t ziti_conn_read(ziti_connection conn, uint8_t *buf, size_t len) {
+    if (conn == NULL || conn->type != Transport) {
+        return ZITI_INVALID_STATE;
+    }
+    if (conn->inbound == NULL) {
+        return conn->hibernated ? 0 : ZITI_INVALID_STATE;
+    }
+
+    // fully consumed messages are returned to their pool right away
+    size_t total = buffer_copy_out(conn->inbound, buf, len);
+
+    if (buffer_available(conn->inbound) == 0) {
+        if (total == 0 && conn->fin_recv) {
+            return ZITI_EOF;
+        }
+        // let flusher deliver EOF/close notification
+        flush_connection(conn);
+    }
+    CONN_LOG(TRACE, "read %zd bytes", total);
+    return (ssize_t) total;
+}
+
+int ziti_conn_set_writable_cb(ziti_connection conn, ziti_writable_cb cb) {
+    if (conn == NULL || conn->type != Transport) {
+        return ZITI_INVALID_STATE;
+    }
+
+    conn->writable_cb = cb;
+    return ZITI_OK;
+}
+
+size_t ziti_conn_write_queue_size(ziti_connection conn) {
+    return conn && conn->type == Transport ? conn->write_q_bytes : 0;
+}
+
+bool ziti_conn_is_writable(ziti_connection conn) {
+    return conn && conn->type == Transport && !conn->write_blocked;
+}
+
+int conn_peek_iov(struct ziti_conn *conn, uv_buf_t *iov, int max_iov) {
+    if (conn == NULL || conn->type != Transport || conn->inbound == NULL) {
+        return 0;
+    }
+    return buffer_peek_iov(conn->inbound, iov, max_iov);
+}
+
+size_t conn_consume(struct ziti_conn *conn, size_t len) {
+    if (conn == NULL || conn->type != Transport || conn->inbound == NULL) {
+        return 0;
+    }
+
+    size_t total = buffer_consume(conn->inbound, len);
+    if (buffer_available(conn->inbound) == 0) {
+        // let flusher deliver EOF/close notification
+        flush_connection(conn);
+    }
+    CONN_LOG(TRACE, "consumed %zd bytes", total);
+    return total;
+}
+
+int ziti_conn_pause_read(ziti_connection conn) {
+    if (conn == NULL || conn->type != Transport) {
+        return ZITI_INVALID_STATE;
+    }
+    conn->read_paused = true;
+    return ZITI_OK;
+}
+
+int ziti_conn_resume_read(ziti_connection conn) {
+    if (conn == NULL || conn->type != Transport) {
+        return ZITI_INVALID_STATE;
+    }
+    conn->read_paused = false;
+    conn->read_notify = true;
+    flush_connection(conn);
+    return ZITI_OK;
+}
+
 static int send_fin_message(ziti_connection conn) {
     CONN_LOG(DEBUG, "sending FIN");
     ziti_channel_t *ch = conn->channel;
@@ -1168,8 +2648,8 @@ static int send_fin_message(ziti_connection conn) {
                     .value = (uint8_t *) &flags
             },
     };
-    NEWP(wr, struct ziti_write_req_s);
-    message *m = message_new(NULL, ContentTypeData, headers, 3, 0);
+    struct ziti_write_req_s *wr = write_req_new(conn->ziti_ctx);
+    message *m = message_new_out(conn->ziti_ctx->out_msgs, ContentTypeData, headers, 3, 0);
     return ziti_channel_send_message(ch, m, wr);
 }
 
@@ -1180,6 +2660,8 @@ int ziti_close(ziti_connection conn, ziti_close_cb close_cb) {
 
     conn->close = true;
     conn->close_cb = close_cb;
+    TAILQ_INSERT_TAIL(&conn->ziti_ctx->close_queue, conn, close_next);
+    conn->ziti_ctx->close_queue_len++;
 
     if (conn->type == Server) {
         return ziti_close_server(conn);
@@ -1193,7 +2675,7 @@ int ziti_close_write(ziti_connection conn) {
         return ZITI_OK;
     }
 
-    NEWP(req, struct ziti_write_req_s);
+    struct ziti_write_req_s *req = write_req_new(conn->ziti_ctx);
     req->conn = conn;
     req->eof = true;
 
@@ -1229,7 +2711,7 @@ void reject_dial_request(uint32_t conn_id, ziti_channel_t *ch, int32_t req_id, c
             },
     };
 
-    message *m = message_new(NULL, ContentTypeDialFailed, headers, 3, strlen(reason));
+    message *m = message_new_out(ch->ctx->out_msgs, ContentTypeDialFailed, headers, 3, strlen(reason));
     memcpy(m->body, reason, strlen(reason));
 
     ziti_channel_send_message(ch, m, NULL);
@@ -1256,6 +2738,7 @@ static void queue_edge_message(struct ziti_conn *conn, message *msg, int code) {
         return;
     }
 
+    conn_wake(conn);
     TAILQ_INSERT_TAIL(&conn->in_q, msg, _next);
     flush_connection(conn);
 }
@@ -1326,7 +2809,7 @@ static void process_edge_message(struct ziti_conn *conn, message *msg) {
                     break;
                 default:
                     if (msg->header.body_len > 0) {
-                        CONN_LOG(WARN, "data[%d bytes] received in state[%s]", msg->header.body_len, ziti_conn_state(conn));
+                        CONN_LOG_RATE(WARN, "data[%d bytes] received in state[%s]", msg->header.body_len, ziti_conn_state(conn));
                     }
             }
             break;
@@ -1345,6 +2828,7 @@ static void process_edge_message(struct ziti_conn *conn, message *msg) {
                 if (conn->encrypted) {
                     send_crypto_header(conn);
                 }
+                conn_accepted(conn);
                 conn_set_state(conn, Connected);
                 complete_conn_req(conn, ZITI_OK);
             } else if (conn->state >= Timedout) {
@@ -1354,7 +2838,7 @@ static void process_edge_message(struct ziti_conn *conn, message *msg) {
             break;
 
         default:
-            CONN_LOG(ERROR, "received unexpected content_type[%d]", msg->header.content);
+            CONN_LOG_RATE(ERROR, "received unexpected content_type[%d]", msg->header.content);
     }
 }
 
@@ -1364,5 +2848,100 @@ void init_transport_conn(struct ziti_conn *c) {
 
     TAILQ_INIT(&c->in_q);
     TAILQ_INIT(&c->wreqs);
-    c->inbound = new_buffer();
+    if (c->inbound == NULL) {
+        c->inbound = new_buffer();
+    }
+}
+
+static void conn_pool_put(struct ziti_conn *conn) {
+    struct ziti_ctx *ztx = conn->ziti_ctx;
+    buffer *inbound = conn->inbound;
+    buffer_consume(inbound, buffer_available(inbound));
+
+    // also wipes session keys and stream state
+    memset(conn, 0, sizeof(*conn));
+    conn->ziti_ctx = ztx;
+    conn->inbound = inbound;
+    LIST_INSERT_HEAD(&ztx->conn_pool, conn, pool_next);
+    ztx->conn_pool_size++;
+}
+
+struct ziti_conn *conn_pool_get(struct ziti_ctx *ztx) {
+    struct ziti_conn *c = LIST_FIRST(&ztx->conn_pool);
+    if (c == NULL) {
+        ziti_conn_init(ztx, &c, NULL);
+    } else {
+        LIST_REMOVE(c, pool_next);
+        ztx->conn_pool_size--;
+        c->timeout = ztx->ziti_timeout;
+        c->conn_id = ztx->conn_seq++;
+        model_map_setl(&ztx->connections, (long) c->conn_id, c);
+    }
+    init_transport_conn(c);
+    return c;
+}
+
+void conn_pool_warm(struct ziti_ctx *ztx, size_t count) {
+    count = MIN(count, CONN_POOL_MAX);
+    while (ztx->conn_pool_size < count) {
+        NEWP(c, struct ziti_conn);
+        c->ziti_ctx = ztx;
+        c->inbound = new_buffer();
+        LIST_INSERT_HEAD(&ztx->conn_pool, c, pool_next);
+        ztx->conn_pool_size++;
+    }
+}
+
+/**
+ * connections that did not send or receive a message since the previous check, and have nothing buffered or queued,
+ * release the inbound buffer and their completed dial/accept request. Key exchange material is already gone by then
+ * (see conn_keys_done()), so a hibernated connection keeps only its identity, stream states, and counters.
+ */
+void conn_hibernate_idle(struct ziti_ctx *ztx) {
+    size_t count = 0;
+    __attribute__((unused)) const char *id;
+    struct ziti_conn *conn;
+    MODEL_MAP_FOREACH(id, conn, &ztx->connections) {
+        if (conn->type != Transport || conn->hibernated) {
+            continue;
+        }
+
+        uint64_t msgs = conn->msgs_up + conn->msgs_down;
+        bool idle = msgs == conn->idle_mark;
+        conn->idle_mark = msgs;
+
+        struct ziti_conn_req *req = conn->conn_req;
+        if (!idle || conn->state != Connected || conn->close ||
+            (req && (req->cb || req->waiter || req->race_ch)) ||
+            conn->write_reqs > 0 || conn->crypt_out_job || conn->crypt_in_job || conn->flush_queued ||
+            !TAILQ_EMPTY(&conn->in_q) || !TAILQ_EMPTY(&conn->wreqs) || buffer_available(conn->inbound) > 0 ||
+            (conn->crypto && conn->crypto->keys)) {
+            continue;
+        }
+
+        // dial or accept is complete, nothing refers to its request anymore
+        if (req) {
+            free_conn_req(ztx, req);
+            conn->conn_req = NULL;
+        }
+        free_buffer(conn->inbound);
+        conn->inbound = NULL;
+        conn->hibernated = true;
+        count++;
+    }
+
+    if (count > 0) {
+        ztx->path_stats.conns_hibernated += count;
+        ZTX_LOG(DEBUG, "hibernated %zu idle connections", count);
+    }
+}
+
+void conn_pool_free(struct ziti_ctx *ztx) {
+    while (!LIST_EMPTY(&ztx->conn_pool)) {
+        struct ziti_conn *c = LIST_FIRST(&ztx->conn_pool);
+        LIST_REMOVE(c, pool_next);
+        free_buffer(c->inbound);
+        free(c);
+    }
+    ztx->conn_pool_size = 0;
 }
@@ -15,10 +15,116 @@
 #include <sodium.h>
 #include "zt_internal.h"
 
+#define KEY_POOL_SIZE 32
+#define KEY_POOL_LOW_WATER 8
+
+struct key_pool_s {
+    uv_loop_t *loop;
+    struct key_pair keys[KEY_POOL_SIZE];
+    size_t count;
+
+    // refill runs on the libuv thread pool, it only touches [batch]
+    uv_work_t refill;
+    bool refilling;
+    bool closed; // freed while refill was in flight
+    struct key_pair batch[KEY_POOL_SIZE];
+    size_t batch_count;
+};
+
+static void key_pool_refill(key_pool *pool);
+
 int init_key_pair(struct key_pair *kp) {
     return crypto_kx_keypair(kp->pk, kp->sk);
 }
 
+key_pool *key_pool_new(uv_loop_t *loop) {
+    if (sodium_init() < 0) {
+        return NULL;
+    }
+    NEWP(pool, key_pool);
+    pool->loop = loop;
+    pool->refill.data = pool;
+    key_pool_refill(pool);
+    return pool;
+}
+
+static void refill_work(uv_work_t *w) {
+    key_pool *pool = w->data;
+    for (size_t i = 0; i < pool->batch_count; i++) {
+        crypto_kx_keypair(pool->batch[i].pk, pool->batch[i].sk);
+    }
+}
+
+static void refill_done(uv_work_t *w, int status) {
+    key_pool *pool = w->data;
+    pool->refilling = false;
+
+    if (pool->closed) {
+        sodium_memzero(pool, sizeof(*pool));
+        free(pool);
+        return;
+    }
+
+    if (status == 0) {
+        size_t n = MIN(pool->batch_count, KEY_POOL_SIZE - pool->count);
+        memcpy(pool->keys + pool->count, pool->batch, n * sizeof(struct key_pair));
+        pool->count += n;
+    }
+    sodium_memzero(pool->batch, sizeof(pool->batch));
+    pool->batch_count = 0;
+
+    // keys were taken while refill was running
+    key_pool_refill(pool);
+}
+
+static void key_pool_refill(key_pool *pool) {
+    if (pool->refilling || pool->count >= KEY_POOL_SIZE) {
+        return;
+    }
+
+    pool->batch_count = KEY_POOL_SIZE - pool->count;
+    if (uv_queue_work(pool->loop, &pool->refill, refill_work, refill_done) == 0) {
+        pool->refilling = true;
+    }
+}
+
+int key_pool_get(key_pool *pool, struct key_pair *kp) {
+    if (pool == NULL || pool->count == 0) {
+        if (pool) {
+            key_pool_refill(pool);
+        }
+        return init_key_pair(kp);
+    }
+
+    struct key_pair *k = &pool->keys[--pool->count];
+    *kp = *k;
+    sodium_memzero(k, sizeof(*k));
+
+    if (pool->count < KEY_POOL_LOW_WATER) {
+        key_pool_refill(pool);
+    }
+    return 0;
+}
+
+size_t key_pool_available(const key_pool *pool) {
+    return pool ? pool->count : 0;
+}
+
+void key_pool_free(key_pool *pool) {
+    if (pool == NULL) {
+        return;
+    }
+
+    if (pool->refilling) {
+        // refill_done() is called even if work is canceled, it releases the pool
+        uv_cancel((uv_req_t *) &pool->refill);
+        pool->closed = true;
+        return;
+    }
+    sodium_memzero(pool, sizeof(*pool));
+    free(pool);
+}
+
 int init_crypto(struct key_exchange *key_ex, struct key_pair *kp, uint8_t *peer_key, bool server) {
     free(key_ex->rx);
     free(key_ex->tx);
@@ -35,4 +141,124 @@ int init_crypto(struct key_exchange *key_ex, struct key_pair *kp, uint8_t *peer_
 void free_key_exchange(struct key_exchange *key_ex) {
     FREE(key_ex->rx);
     FREE(key_ex->tx);
-}
\ No newline at end of file
+}
+/*
+ * end-to-end streams, see e2e_stream.h
+ */
+
+static const char E2E_GCM_KEY_CONTEXT[] = "ziti-e2e-aes256gcm";
+
+bool e2e_aes_available(void) {
+    return sodium_init() >= 0 && crypto_aead_aes256gcm_is_available();
+}
+
+static void derive_gcm_key(struct e2e_stream *s, const uint8_t *key) {
+    crypto_generichash(s->gcm_key, sizeof(s->gcm_key),
+                       (const uint8_t *) E2E_GCM_KEY_CONTEXT, sizeof(E2E_GCM_KEY_CONTEXT) - 1,
+                       key, crypto_secretstream_xchacha20poly1305_KEYBYTES);
+    s->local_offer = true;
+}
+
+static int start_gcm(struct e2e_stream *s) {
+    // state needs 16 byte alignment, AES-256-GCM is only available on 64-bit platforms where malloc provides it
+    s->gcm = calloc(1, sizeof(*s->gcm));
+    int rc = crypto_aead_aes256gcm_beforenm(s->gcm, s->gcm_key);
+    sodium_memzero(s->gcm_key, sizeof(s->gcm_key));
+    s->method = CryptoMethodAES256GCM;
+    s->seq = 0;
+    return rc;
+}
+
+static inline void gcm_nonce(struct e2e_stream *s, uint8_t nonce[crypto_aead_aes256gcm_NPUBBYTES]) {
+    memset(nonce, 0, crypto_aead_aes256gcm_NPUBBYTES);
+    uint64_t seq = s->seq++;
+    for (int i = 0; i < 8; i++) {
+        nonce[i] = (uint8_t) (seq >> (8 * i));
+    }
+}
+
+int e2e_init_push(struct e2e_stream *s, uint8_t header[E2E_HEADER_BYTES], const uint8_t *key, bool offer_aes) {
+    memset(s, 0, sizeof(*s));
+    s->method = CryptoMethodLibsodium;
+    if (offer_aes && e2e_aes_available()) {
+        derive_gcm_key(s, key);
+    }
+    return crypto_secretstream_xchacha20poly1305_init_push(&s->ss, header, key);
+}
+
+int e2e_init_pull(struct e2e_stream *s, const uint8_t header[E2E_HEADER_BYTES], const uint8_t *key, bool offer_aes) {
+    memset(s, 0, sizeof(*s));
+    s->method = CryptoMethodLibsodium;
+    if (offer_aes && e2e_aes_available()) {
+        derive_gcm_key(s, key);
+    }
+    return crypto_secretstream_xchacha20poly1305_init_pull(&s->ss, header, key);
+}
+
+void e2e_push(struct e2e_stream *s, uint8_t *c, const uint8_t *m, size_t mlen) {
+    if (s->method == CryptoMethodAES256GCM) {
+        uint8_t nonce[crypto_aead_aes256gcm_NPUBBYTES];
+        gcm_nonce(s, nonce);
+        c[0] = 0;
+        crypto_aead_aes256gcm_encrypt_detached_afternm(c + 1, c + 1 + mlen, NULL, m, mlen, c, 1, NULL, nonce, s->gcm);
+    } else {
+        crypto_secretstream_xchacha20poly1305_push(&s->ss, c, NULL, m, mlen, NULL, 0, 0);
+    }
+}
+
+void e2e_push_offer(struct e2e_stream *s, uint8_t *c) {
+    crypto_secretstream_xchacha20poly1305_push(&s->ss, c, NULL, NULL, 0, NULL, 0,
+                                               crypto_secretstream_xchacha20poly1305_TAG_PUSH);
+}
+
+bool e2e_switch_ready(const struct e2e_stream *out, const struct e2e_stream *in) {
+    return out->method == CryptoMethodLibsodium && out->local_offer && in->peer_offer;
+}
+
+int e2e_push_switch(struct e2e_stream *s, uint8_t *c) {
+    crypto_secretstream_xchacha20poly1305_push(&s->ss, c, NULL, NULL, 0, NULL, 0,
+                                               crypto_secretstream_xchacha20poly1305_TAG_FINAL);
+    return start_gcm(s);
+}
+
+int e2e_pull(struct e2e_stream *s, uint8_t *m, size_t *mlen, const uint8_t *c, size_t clen) {
+    if (clen < E2E_ABYTES) {
+        return -1;
+    }
+
+    if (s->method == CryptoMethodAES256GCM) {
+        size_t len = clen - E2E_ABYTES;
+        uint8_t nonce[crypto_aead_aes256gcm_NPUBBYTES];
+        gcm_nonce(s, nonce);
+        if (crypto_aead_aes256gcm_decrypt_detached_afternm(m, NULL, c + 1, len, c + 1 + len, c, 1, nonce, s->gcm) != 0) {
+            return -1;
+        }
+        *mlen = len;
+        return 0;
+    }
+
+    unsigned long long plain_len;
+    unsigned char tag;
+    if (crypto_secretstream_xchacha20poly1305_pull(&s->ss, m, &plain_len, &tag, c, clen, NULL, 0) != 0) {
+        return -1;
+    }
+    *mlen = (size_t) plain_len;
+
+    if (plain_len == 0 && tag == crypto_secretstream_xchacha20poly1305_TAG_PUSH) {
+        s->peer_offer = true;
+    } else if (plain_len == 0 && tag == crypto_secretstream_xchacha20poly1305_TAG_FINAL) {
+        // peer can only switch after receiving our offer
+        if (!s->local_offer || start_gcm(s) != 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void e2e_stream_free(struct e2e_stream *s) {
+    if (s->gcm) {
+        sodium_memzero(s->gcm, sizeof(*s->gcm));
+        FREE(s->gcm);
+    }
+    sodium_memzero(s, sizeof(*s));
+}
@@ -50,6 +50,8 @@
     XX(INVALID_AUTHENTICATOR_TYPE, "the authenticator could not be extended as it is the incorrect type")                  \
     XX(INVALID_AUTHENTICATOR_CERT, "the authenticator could not be extended as the current client certificate does not match") \
     XX(INVALID_CERT_KEY_PAIR, "the active certificate and key could not be set, invalid pair, or could not parse") \
+    XX(MEMORY_LIMIT, "ziti context is over its memory limit") \
+    XX(INVALID_ARGUMENT, "invalid argument") \
     XX(WTF, "WTF: programming error")
 
 
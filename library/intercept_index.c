@@ -0,0 +1,260 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "intercept_index.h"
+
+#include <ctype.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "utils.h"
+#include "ziti/errors.h"
+
+#if _WIN32
+#include <ws2tcpip.h>
+#else
+#include <sys/socket.h>
+#include <netinet/in.h>
+#endif
+
+struct intercept_entry {
+    const char *service; // interned
+    const ziti_intercept_cfg_v1 *intercept; // borrowed from service config cache, or [own]
+    ziti_intercept_cfg_v1 *own;
+};
+
+struct cidr_node {
+    struct cidr_node *child[2];
+    model_list entries;
+};
+
+static void lower_key(char *out, const char *in, size_t max) {
+    size_t i = 0;
+    for (; in[i] != '\0' && i < max - 1; i++) {
+        out[i] = (char) tolower((unsigned char) in[i]);
+    }
+    out[i] = '\0';
+}
+
+static const char *wildcard_domain(const char *hostname) {
+    // same as ziti_address_match(): '*.' prefix is skipped
+    return strlen(hostname) >= 2 ? hostname + 2 : "";
+}
+
+static int addr_bit(const struct in6_addr *ip, unsigned int bit) {
+    return (ip->s6_addr[bit / 8] >> (7 - bit % 8)) & 1;
+}
+
+static struct cidr_node **cidr_root(intercept_index *idx, int af) {
+    return af == AF_INET ? &idx->v4 : &idx->v6;
+}
+
+static struct cidr_node *cidr_find(intercept_index *idx, const ziti_address *range, bool create) {
+    struct cidr_node **n = cidr_root(idx, range->addr.cidr.af);
+    for (unsigned int bit = 0;; bit++) {
+        if (*n == NULL) {
+            if (!create) return NULL;
+            *n = calloc(1, sizeof(struct cidr_node));
+        }
+        if (bit == range->addr.cidr.bits) {
+            return *n;
+        }
+        n = &(*n)->child[addr_bit(&range->addr.cidr.ip, bit)];
+    }
+}
+
+static void cidr_free(struct cidr_node *n) {
+    if (n == NULL) return;
+    cidr_free(n->child[0]);
+    cidr_free(n->child[1]);
+    model_list_clear(&n->entries, NULL);
+    free(n);
+}
+
+static void list_remove(model_list *l, struct intercept_entry *e) {
+    model_list_iter it = model_list_iterator(l);
+    while (it) {
+        if (model_list_it_element(it) == e) {
+            it = model_list_it_remove(it);
+        } else {
+            it = model_list_it_next(it);
+        }
+    }
+}
+
+static void table_add(model_map *table, const char *key, struct intercept_entry *e) {
+    model_list *l = model_map_get(table, key);
+    if (l == NULL) {
+        l = calloc(1, sizeof(model_list));
+        model_map_set(table, key, l);
+    }
+    model_list_append(l, e);
+}
+
+static void table_remove(model_map *table, const char *key, struct intercept_entry *e) {
+    model_list *l = model_map_get(table, key);
+    if (l == NULL) return;
+
+    list_remove(l, e);
+    if (model_list_size(l) == 0) {
+        model_map_remove(table, key);
+        free(l);
+    }
+}
+
+static void free_entry_list(void *l) {
+    model_list_clear(l, NULL);
+    free(l);
+}
+
+static void index_entry(intercept_index *idx, struct intercept_entry *e, bool add) {
+    char key[sizeof(((ziti_address *) 0)->addr.hostname)];
+    const ziti_address *addr;
+    model_list *addresses = (model_list *) &e->intercept->addresses; // list iterator does not take const
+    MODEL_LIST_FOREACH(addr, *addresses) {
+        if (addr->type == ziti_address_hostname) {
+            bool wildcard = addr->addr.hostname[0] == '*';
+            model_map *table = wildcard ? &idx->domains : &idx->hosts;
+            lower_key(key, wildcard ? wildcard_domain(addr->addr.hostname) : addr->addr.hostname, sizeof(key));
+            if (add) {
+                table_add(table, key, e);
+            } else {
+                table_remove(table, key, e);
+            }
+        } else if (addr->type == ziti_address_cidr) {
+            struct cidr_node *n = cidr_find(idx, addr, add);
+            if (n == NULL) continue;
+            if (add) {
+                model_list_append(&n->entries, e);
+            } else {
+                list_remove(&n->entries, e);
+            }
+        }
+    }
+}
+
+static void free_entry(intercept_index *idx, struct intercept_entry *e) {
+    if (e->own) {
+        free_ziti_intercept_cfg_v1(e->own);
+        free(e->own);
+    }
+    str_intern_release(idx->strings, e->service);
+    free(e);
+}
+
+void intercept_index_remove(intercept_index *idx, const char *service_name) {
+    struct intercept_entry *e = model_map_remove(&idx->services, service_name);
+    if (e == NULL) return;
+
+    index_entry(idx, e, false);
+    free_entry(idx, e);
+}
+
+void intercept_index_update(intercept_index *idx, const ziti_service *service) {
+    // take the name reference first, so that re-indexing the same service does not reallocate it
+    NEWP(e, struct intercept_entry);
+    e->service = str_intern_get(idx->strings, service->name);
+    intercept_index_remove(idx, service->name);
+
+    ziti_service *srv = (ziti_service *) service;
+    const void *cfg = NULL;
+    if (ziti_service_get_config_ref(srv, ZITI_INTERCEPT_CFG_V1, get_ziti_intercept_cfg_v1_meta(), &cfg) == ZITI_OK) {
+        e->intercept = cfg;
+    } else if (ziti_service_get_config_ref(srv, ZITI_CLIENT_CFG_V1, get_ziti_client_cfg_v1_meta(), &cfg) == ZITI_OK) {
+        e->own = alloc_ziti_intercept_cfg_v1();
+        if (ziti_intercept_from_client_cfg(e->own, cfg) != ZITI_OK) {
+            free_entry(idx, e);
+            return;
+        }
+        e->intercept = e->own;
+    } else {
+        free_entry(idx, e);
+        return;
+    }
+
+    model_map_set(&idx->services, e->service, e);
+    index_entry(idx, e, true);
+}
+
+void intercept_index_clear(intercept_index *idx) {
+    model_map_clear(&idx->hosts, free_entry_list);
+    model_map_clear(&idx->domains, free_entry_list);
+    cidr_free(idx->v4);
+    cidr_free(idx->v6);
+    idx->v4 = NULL;
+    idx->v6 = NULL;
+    model_map_iter it = model_map_iterator(&idx->services);
+    while (it != NULL) {
+        free_entry(idx, model_map_it_value(it));
+        it = model_map_it_remove(it);
+    }
+}
+
+struct best_match {
+    const struct intercept_entry *entry;
+    int score;
+};
+
+static void check_candidates(model_list *l, ziti_protocol proto, const ziti_address *addr, int port,
+                             struct best_match *best) {
+    const struct intercept_entry *e;
+    MODEL_LIST_FOREACH(e, *l) {
+        int score = ziti_intercept_match2(e->intercept, proto, addr, port);
+        if (score == -1) continue;
+
+        // ties go to first service by name, so that result does not depend on indexing order
+        if (best->entry == NULL || score < best->score ||
+            (score == best->score && strcmp(e->service, best->entry->service) < 0)) {
+            best->entry = e;
+            best->score = score;
+        }
+    }
+}
+
+const char *intercept_index_lookup(const intercept_index *idx, ziti_protocol proto, const ziti_address *addr,
+                                   int port) {
+    struct best_match best = {0};
+
+    if (addr->type == ziti_address_hostname) {
+        char host[sizeof(addr->addr.hostname)];
+        lower_key(host, addr->addr.hostname, sizeof(host));
+
+        model_list *l = model_map_get(&idx->hosts, host);
+        if (l) {
+            check_candidates(l, proto, addr, port, &best);
+        }
+
+        // wildcards match the domain itself and any of its sub-domains
+        const char *suffix = host;
+        while (suffix != NULL) {
+            l = model_map_get(&idx->domains, suffix);
+            if (l) {
+                check_candidates(l, proto, addr, port, &best);
+            }
+            suffix = strchr(suffix, '.');
+            if (suffix) suffix++;
+        }
+    } else if (addr->type == ziti_address_cidr) {
+        struct cidr_node *n = addr->addr.cidr.af == AF_INET ? idx->v4 :
+                                    addr->addr.cidr.af == AF_INET6 ? idx->v6 : NULL;
+        // every node on the path is a range containing the address
+        for (unsigned int bit = 0; n != NULL; bit++) {
+            check_candidates(&n->entries, proto, addr, port, &best);
+            if (bit == addr->addr.cidr.bits) break;
+            n = n->child[addr_bit(&addr->addr.cidr.ip, bit)];
+        }
+    }
+
+    return best.entry ? best.entry->service : NULL;
+}
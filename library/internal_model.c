@@ -141,6 +141,8 @@ IMPL_MODEL(ziti_create_api_cert_req, ZITI_CREATE_API_CERT_REQ)
 
 IMPL_MODEL(ziti_create_api_cert_resp, ZITI_CREATE_API_CERT_RESP)
 
+IMPL_MODEL(ziti_warm_cache, ZITI_WARM_CACHE_MODEL)
+
 bool ziti_service_has_permission(const ziti_service *service, ziti_session_type sessionType) {
     if (sessionType == ziti_session_types.Dial) {
         return (service->perm_flags & ZITI_CAN_DIAL) != 0;
@@ -171,6 +173,153 @@ int ziti_service_get_config(ziti_service *service, const char *cfg_type, void *c
     return ZITI_OK;
 }
 
+struct cfg_cache_entry {
+    struct cfg_cache_entry *next;
+    char *cfg_type;
+    type_meta *meta;
+    void *cfg;
+    int status;
+};
+
+// per-service state derived from service content
+struct ziti_config_cache_s {
+    struct cfg_cache_entry *entries;
+    bool hashed;
+    uint64_t content_hash;
+};
+
+static void free_config_cache(ziti_config_cache *cache) {
+    while (cache->entries) {
+        struct cfg_cache_entry *e = cache->entries;
+        cache->entries = e->next;
+        if (e->cfg) {
+            model_free(e->cfg, e->meta);
+            free(e->cfg);
+        }
+        free(e->cfg_type);
+        free(e);
+    }
+}
+
+// cache is derived from service content, it is never a difference between services
+static int cmp_config_cache(const ziti_config_cache *lh, const ziti_config_cache *rh) {
+    return 0;
+}
+
+static type_meta ziti_config_cache_META = {
+        .name = "ziti_config_cache",
+        .size = sizeof(ziti_config_cache),
+        .comparer = (_cmp_f) cmp_config_cache,
+        .destroyer = (_free_f) free_config_cache,
+};
+
+type_meta *get_ziti_config_cache_meta() {
+    return &ziti_config_cache_META;
+}
+
+static ziti_config_cache *service_cache(ziti_service *service) {
+    if (service->config_cache == NULL) {
+        service->config_cache = calloc(1, sizeof(ziti_config_cache));
+    }
+    return service->config_cache;
+}
+
+int ziti_service_get_config_ref(ziti_service *service, const char *cfg_type, type_meta *meta, const void **cfg) {
+    ziti_config_cache *cache = service_cache(service);
+
+    struct cfg_cache_entry *e;
+    for (e = cache->entries; e != NULL; e = e->next) {
+        if (e->meta == meta && strcmp(e->cfg_type, cfg_type) == 0) {
+            break;
+        }
+    }
+
+    if (e == NULL) {
+        e = calloc(1, sizeof(*e));
+        e->cfg_type = strdup(cfg_type);
+        e->meta = meta;
+
+        const char *cfg_json = ziti_service_get_raw_config(service, cfg_type);
+        if (cfg_json == NULL) {
+            e->status = ZITI_CONFIG_NOT_FOUND;
+        } else {
+            e->cfg = calloc(1, meta->size);
+            if (model_parse(e->cfg, cfg_json, strlen(cfg_json), meta) < 0) {
+                model_free(e->cfg, meta);
+                free(e->cfg);
+                e->cfg = NULL;
+                e->status = ZITI_INVALID_CONFIG;
+            } else {
+                e->status = ZITI_OK;
+            }
+        }
+        e->next = cache->entries;
+        cache->entries = e;
+    }
+
+    if (cfg) {
+        *cfg = e->cfg;
+    }
+    return e->status;
+}
+
+#define HASH_INIT 14695981039346656037ULL
+
+static uint64_t hash_bytes(uint64_t h, const void *data, size_t len) {
+    const uint8_t *p = data;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+static uint64_t hash_str(uint64_t h, const char *s) {
+    // terminator is included so that adjacent strings cannot run into each other
+    return s ? hash_bytes(h, s, strlen(s) + 1) : h * 31;
+}
+
+static uint64_t hash_int(uint64_t h, int v) {
+    return hash_bytes(h, &v, sizeof(v));
+}
+
+uint64_t ziti_service_content_hash(const ziti_service *service) {
+    uint64_t h = hash_str(HASH_INIT, service->updated_at);
+
+    // map entries are summed, so that order of entries does not matter
+    uint64_t sum = 0;
+    const char *k;
+    const char *cfg;
+    MODEL_MAP_FOREACH(k, cfg, &service->config) {
+        sum += hash_str(hash_str(HASH_INIT, k), cfg);
+    }
+    h = hash_bytes(h, &sum, sizeof(sum));
+
+    sum = 0;
+    const ziti_posture_query_set *set;
+    MODEL_MAP_FOREACH(k, set, &service->posture_query_map) {
+        uint64_t ph = hash_int(hash_str(HASH_INIT, k), set->is_passing);
+        for (int i = 0; set->posture_queries && set->posture_queries[i] != NULL; i++) {
+            const ziti_posture_query *q = set->posture_queries[i];
+            ph = hash_str(ph, q->id);
+            ph = hash_int(ph, q->timeout);
+            ph = hash_str(ph, q->updated_at);
+        }
+        sum += ph;
+    }
+    h = hash_bytes(h, &sum, sizeof(sum));
+
+    return h;
+}
+
+uint64_t ziti_service_cached_hash(ziti_service *service) {
+    ziti_config_cache *cache = service_cache(service);
+    if (!cache->hashed) {
+        cache->content_hash = ziti_service_content_hash(service);
+        cache->hashed = true;
+    }
+    return cache->content_hash;
+}
+
 static uv_once_t info_once;
 static ziti_env_info s_info;
 static void ziti_info_init() {
@@ -18,6 +18,7 @@
 
 #include "utils.h"
 #include "endian_internal.h"
+#include "edge_protocol.h"
 
 static const uint8_t *read_int32(const uint8_t *p, uint32_t *val) {
     *val = le32toh(*(uint32_t *) p);
@@ -63,10 +64,17 @@ void message_init(message* m) {
 
 void message_free(message* m) {
     if (m != NULL) {
-        if (m->msgbufp != m->msgbuf) {
+        m->refs = 0;
+        if (m->chunk) {
+            buffer_chunk_release(m->chunk);
+            m->chunk = NULL;
+        }
+        else if (m->msgbufp != m->msgbuf) {
             free(m->msgbufp);
         }
-        FREE(m->hdrs);
+        if (m->hdrs != m->hdr_table) {
+            FREE(m->hdrs);
+        }
     }
 }
 
@@ -107,7 +115,70 @@ int parse_hdrs(uint8_t *buf, uint32_t len, hdr_t **hp) {
     return count;
 }
 
+static int known_hdr_slot(uint32_t header_id) {
+    switch (header_id) {
+        case ReplyForHeader: return MsgHdrReplyFor;
+        case ConnIdHeader: return MsgHdrConnId;
+        case SeqHeader: return MsgHdrSeq;
+        case FlagsHeader: return MsgHdrFlags;
+        default: return -1;
+    }
+}
+
+int message_parse_hdrs(message *m) {
+    const uint8_t *p = m->headers;
+    const uint8_t *end = m->headers + m->header.headers_len;
+
+    hdr_t *headers = m->hdr_table;
+    int capacity = MSG_INLINE_HDRS;
+    int count = 0;
+    memset(m->known_hdrs, 0, sizeof(m->known_hdrs));
+
+    while (p < end) {
+        if (count == capacity) {
+            capacity *= 2;
+            if (headers == m->hdr_table) {
+                headers = malloc(capacity * sizeof(hdr_t));
+                memcpy(headers, m->hdr_table, sizeof(m->hdr_table));
+            } else {
+                headers = realloc(headers, capacity * sizeof(hdr_t));
+            }
+        }
+
+        hdr_t *h = &headers[count];
+        p = read_int32(p, &h->header_id);
+        p = read_int32(p, &h->length);
+        h->value = (uint8_t *) p;
+        p += h->length;
+
+        int slot = known_hdr_slot(h->header_id);
+        // index is stored in uint8_t, anything beyond is found by scanning
+        if (slot >= 0 && m->known_hdrs[slot] == 0 && count < UINT8_MAX) {
+            m->known_hdrs[slot] = (uint8_t) (count + 1);
+        }
+        count++;
+    }
+
+    m->hdrs = headers;
+    m->nhdrs = count;
+    m->hdrs_indexed = true;
+    return count;
+}
+
 static hdr_t *find_header(message *m, int header_id) {
+    if (m->hdrs_indexed) {
+        int slot = known_hdr_slot(header_id);
+        if (slot >= 0) {
+            uint8_t idx = m->known_hdrs[slot];
+            if (idx != 0) {
+                return &m->hdrs[idx - 1];
+            }
+            if (m->nhdrs < UINT8_MAX) {
+                return NULL;
+            }
+        }
+    }
+
     for (int i = 0; i < m->nhdrs; i++) {
         if (m->hdrs[i].header_id == header_id) {
             return &m->hdrs[i];
@@ -116,6 +187,25 @@ static hdr_t *find_header(message *m, int header_id) {
     return NULL;
 }
 
+message *message_retain(message *m) {
+    if (m) {
+        m->refs++;
+    }
+    return m;
+}
+
+void message_release(message *m) {
+    if (m == NULL) {
+        return;
+    }
+
+    if (m->refs > 0) {
+        m->refs--;
+        return;
+    }
+    pool_return_obj(m);
+}
+
 bool message_get_bool_header(message *m, int header_id, bool *v) {
     hdr_t *h = find_header(m, header_id);
     if (h != NULL) {
@@ -186,12 +276,33 @@ message *message_new_from_header(pool_t *pool, uint8_t buf[HEADER_SIZE]) {
     return m;
 }
 
-message *message_new(pool_t *pool, uint32_t content, const hdr_t *hdrs, int nhdrs, size_t body_len) {
+message *message_new_from_chunk(pool_t *pool, uint8_t *buf, buffer_chunk *chunk) {
+    header_t h;
+    header_from_buffer(&h, buf);
+
+    size_t msgbuflen = HEADER_SIZE + h.headers_len + h.body_len;
+    message *m = pool ? pool_alloc_obj(pool) : alloc_unpooled_obj(sizeof(message), (void (*)(void *)) message_free);
+
+    memcpy(&m->header, &h, sizeof(h));
+    m->msgbuflen = msgbuflen;
+    m->msgbufp = buf;
+    m->chunk = chunk;
+    m->headers = m->msgbufp + HEADER_SIZE;
+    m->body = m->headers + h.headers_len;
+    return m;
+}
+
+static uint32_t hdrs_wire_len(const hdr_t *hdrs, int nhdrs) {
     uint32_t hdrs_len = 0;
     for (int i = 0; i < nhdrs; i++) {
         // wire format length: header id + val(length) + length
         hdrs_len += sizeof(hdrs[i].header_id) + sizeof(hdrs[i].length) + hdrs[i].length;
     }
+    return hdrs_len;
+}
+
+message *message_new(pool_t *pool, uint32_t content, const hdr_t *hdrs, int nhdrs, size_t body_len) {
+    uint32_t hdrs_len = hdrs_wire_len(hdrs, nhdrs);
 
     size_t msgbuflen = HEADER_SIZE + hdrs_len + body_len;
     size_t msgsize = sizeof(message) + msgbuflen;
@@ -237,3 +348,78 @@ void message_set_seq(message *m, uint32_t *seq) {
     }
     header_to_buffer(&m->header, m->msgbufp);
 }
+
+// payload size plus room for frame header, edge headers and encryption overhead
+#define MSG_CLASS_HEADROOM 256
+static const size_t msg_size_classes[MSG_SIZE_CLASSES] = {
+        256,
+        4 * 1024 + MSG_CLASS_HEADROOM,
+        32 * 1024 + MSG_CLASS_HEADROOM,
+        64 * 1024 + MSG_CLASS_HEADROOM,
+};
+
+struct msg_pools_s {
+    pool_t *pools[MSG_SIZE_CLASSES];
+    uint64_t hits[MSG_SIZE_CLASSES];
+    uint64_t misses[MSG_SIZE_CLASSES];
+    uint64_t oversize;
+};
+
+msg_pools *msg_pools_new(size_t cap) {
+    msg_pools *p = calloc(1, sizeof(msg_pools));
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        p->pools[i] = pool_new_slab(sizeof(message) + msg_size_classes[i], cap, MSG_POOL_SLAB_COUNT, sizeof(message),
+                                    false, (void (*)(void *)) message_free);
+    }
+    return p;
+}
+
+void msg_pools_free(msg_pools *p) {
+    if (p == NULL) {
+        return;
+    }
+
+    // messages still in flight are freed when returned
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        pool_destroy(p->pools[i]);
+    }
+    free(p);
+}
+
+message *message_new_out(msg_pools *p, uint32_t content, const hdr_t *hdrs, int nhdrs, size_t body_len) {
+    if (p == NULL) {
+        return message_new(NULL, content, hdrs, nhdrs, body_len);
+    }
+
+    size_t msgbuflen = HEADER_SIZE + hdrs_wire_len(hdrs, nhdrs) + body_len;
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        if (msgbuflen > msg_size_classes[i]) {
+            continue;
+        }
+
+        if (pool_has_available(p->pools[i])) {
+            p->hits[i]++;
+            return message_new(p->pools[i], content, hdrs, nhdrs, body_len);
+        }
+        p->misses[i]++;
+        return message_new(NULL, content, hdrs, nhdrs, body_len);
+    }
+
+    p->oversize++;
+    return message_new(NULL, content, hdrs, nhdrs, body_len);
+}
+
+void msg_pools_stats(msg_pools *p, struct msg_pool_stats stats[MSG_SIZE_CLASSES], uint64_t *oversize) {
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        stats[i].size = msg_size_classes[i];
+        stats[i].hits = p ? p->hits[i] : 0;
+        stats[i].misses = p ? p->misses[i] : 0;
+        stats[i].high_water = 0;
+        if (p) {
+            pool_usage(p->pools[i], NULL, &stats[i].high_water);
+        }
+    }
+    if (oversize) {
+        *oversize = p ? p->oversize : 0;
+    }
+}
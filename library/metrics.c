@@ -19,6 +19,7 @@ limitations under the License.
 #define _USE_MATH_DEFINES
 
 #include <math.h>
+#include <stdlib.h>
 #include <string.h>
 #include <uv.h>
 
@@ -30,57 +31,129 @@ limitations under the License.
 #   define InterlockedAdd64(p, v) (*p) += (v)
 #   define InterlockedExchange64(p, v) (*p) = (v)
 #   define InterlockedExchange(p, v) (*p) = (v)
+#   define InterlockedSwap64(p, v) __sync_lock_test_and_set(p, v)
 # else
 #include <stdatomic.h>
 #define InterlockedAdd64(p, v) atomic_fetch_add(p,v)
 #define InterlockedExchange64(p, v) atomic_store(p,v)
 #define InterlockedExchange(p, v) atomic_store(p,v)
+#define InterlockedSwap64(p, v) atomic_exchange(p,v)
 # endif
+#define THREAD_LOCAL __thread
+#elif _WIN32
+#define InterlockedSwap64(p, v) InterlockedExchange64(p, v)
+#define THREAD_LOCAL __declspec(thread)
 #endif
 
 #define NANOS(s) ((s) * 1e9)
 #define MILLIS(s) ((s) * 1000)
 
-static const double SECOND = NANOS(1); // one second in nanos
+#define DEFAULT_INTERVAL 5 // seconds
 
-static uv_timer_t ticker;
-static double interval = 5; // 5 seconds is default
-static double intervalNanos = NANOS(5);
+static const double SECOND = NANOS(1); // one second in nanos
 
-static LIST_HEAD(meters, rate_s) all_rates = LIST_HEAD_INITIALIZER(all_rates);
+struct metrics_ticker {
+    uv_loop_t *loop;
+    uv_timer_t *timer;
+    double interval;
+    double interval_nanos;
+    LIST_HEAD(meters, rate_s) rates;
+    LIST_HEAD(hooks, metrics_tick_hook_s) hooks;
+    LIST_ENTRY(metrics_ticker) _next;
+};
+
+// not bound to a loop, see tick_all()
+static struct metrics_ticker default_ticker = {
+        .interval = DEFAULT_INTERVAL,
+        .interval_nanos = NANOS(DEFAULT_INTERVAL),
+};
+
+static LIST_HEAD(tickers, metrics_ticker) all_tickers = LIST_HEAD_INITIALIZER(all_tickers);
+static uv_once_t tickers_once = UV_ONCE_INIT;
+static uv_mutex_t tickers_lock;
+
+static atomic_llong shard_seq;
+static THREAD_LOCAL int shard_id = -1;
 
 static void ticker_cb(uv_timer_t *t);
 static void tick_ewma(rate_t *ewma);
 static void tick_cma(rate_t *cma);
 static void tick_instant(rate_t *inst);
 
-extern void metrics_init(uv_loop_t *loop, long interval_secs) {
+static void init_tickers_lock(void) {
+    uv_mutex_init(&tickers_lock);
+}
+
+static struct metrics_ticker *get_ticker(uv_loop_t *loop, long interval_secs) {
+    uv_once(&tickers_once, init_tickers_lock);
+    uv_mutex_lock(&tickers_lock);
+
+    struct metrics_ticker *t;
+    LIST_FOREACH(t, &all_tickers, _next) {
+        if (t->loop == loop) {
+            break;
+        }
+    }
 
-    if (!uv_is_active((uv_handle_t*)&ticker)) {
+    if (t == NULL) {
+        t = calloc(1, sizeof(*t));
+        t->loop = loop;
+        t->interval = (double) interval_secs;
+        t->interval_nanos = NANOS(t->interval);
+        LIST_INIT(&t->rates);
+        LIST_INIT(&t->hooks);
+
+        t->timer = calloc(1, sizeof(uv_timer_t));
+        uv_timer_init(loop, t->timer);
+        t->timer->data = t;
+        uv_timer_start(t->timer, ticker_cb, MILLIS(interval_secs), MILLIS(interval_secs));
+        uv_unref((uv_handle_t *) t->timer);
+
+        LIST_INSERT_HEAD(&all_tickers, t, _next);
+    }
 
-        interval = (double)interval_secs;
-        intervalNanos = NANOS(interval);
+    uv_mutex_unlock(&tickers_lock);
+    return t;
+}
 
-        uv_timer_init(loop, &ticker);
-        uv_timer_start(&ticker, ticker_cb, MILLIS(interval_secs), MILLIS(interval_secs));
-        uv_unref((uv_handle_t*)&ticker);
+static void free_ticker_timer(uv_handle_t *h) {
+    free(h);
+}
+
+// ticker goes away with its last rate and hook, so it does not keep its loop from closing
+static void release_ticker(struct metrics_ticker *t) {
+    if (t == &default_ticker || !LIST_EMPTY(&t->rates) || !LIST_EMPTY(&t->hooks)) {
+        return;
     }
 
+    uv_mutex_lock(&tickers_lock);
+    LIST_REMOVE(t, _next);
+    uv_mutex_unlock(&tickers_lock);
+
+    uv_close((uv_handle_t *) t->timer, free_ticker_timer);
+    free(t);
+}
+
+extern void metrics_init(uv_loop_t *loop, long interval_secs) {
+    get_ticker(loop, interval_secs);
 }
 
 extern void metrics_rate_close(rate_t* r) {
     if (r->active) {
         r->active = false;
         LIST_REMOVE(r, _next);
+        release_ticker(r->ticker);
+        r->ticker = NULL;
     }
 }
 
-extern void metrics_rate_init(rate_t *r, rate_type type) {
+static void rate_init(struct metrics_ticker *t, rate_t *r, rate_type type) {
     if (r->active) {
         metrics_rate_close(r);
     }
 
     memset(r, 0, sizeof(rate_t));
+    double interval = t->interval;
     switch (type) {
         case EWMA_5s:
             r->tick_fn = tick_ewma;
@@ -117,11 +190,27 @@ extern void metrics_rate_init(rate_t *r, rate_type type) {
     }
 
     r->active = true;
-    LIST_INSERT_HEAD(&all_rates, r, _next);
+    r->ticker = t;
+    LIST_INSERT_HEAD(&t->rates, r, _next);
+}
+
+extern void metrics_rate_init_loop(uv_loop_t *loop, rate_t *r, rate_type type) {
+    rate_init(get_ticker(loop, DEFAULT_INTERVAL), r, type);
+}
+
+extern void metrics_rate_init(rate_t *r, rate_type type) {
+    rate_init(&default_ticker, r, type);
+}
+
+static inline int rate_shard(void) {
+    if (shard_id < 0) {
+        shard_id = (int) (InterlockedAdd64(&shard_seq, 1) % RATE_SHARDS);
+    }
+    return shard_id;
 }
 
 extern void metrics_rate_update(rate_t *r, long delta) {
-    InterlockedAdd64(&r->delta, delta);
+    InterlockedAdd64(&r->shards[rate_shard()].delta, delta);
 }
 
 extern double metrics_rate_get(rate_t *r) {
@@ -130,24 +219,57 @@ extern double metrics_rate_get(rate_t *r) {
     return rate;
 }
 
-void tick_all() {
+static void tick_rates(struct metrics_ticker *t) {
     rate_t *r;
-    LIST_FOREACH(r, &all_rates, _next) {
+    LIST_FOREACH(r, &t->rates, _next) {
         if (r->tick_fn) {
             r->tick_fn(r);
         }
     }
+}
 
+void tick_all() {
+    tick_rates(&default_ticker);
 }
 
 static void ticker_cb(uv_timer_t *t) {
-    tick_all();
+    struct metrics_ticker *ticker = t->data;
+    tick_rates(ticker);
+
+    // hook may remove itself
+    metrics_tick_hook *h = LIST_FIRST(&ticker->hooks);
+    while (h != NULL) {
+        metrics_tick_hook *next = LIST_NEXT(h, _next);
+        h->cb(h);
+        h = next;
+    }
+}
+
+extern void metrics_tick_hook_add(uv_loop_t *loop, metrics_tick_hook *h) {
+    if (h->ticker != NULL) {
+        return;
+    }
+    h->ticker = get_ticker(loop, DEFAULT_INTERVAL);
+    LIST_INSERT_HEAD(&h->ticker->hooks, h, _next);
+}
+
+extern void metrics_tick_hook_remove(metrics_tick_hook *h) {
+    struct metrics_ticker *t = h->ticker;
+    if (t == NULL) {
+        return;
+    }
+    LIST_REMOVE(h, _next);
+    h->ticker = NULL;
+    release_ticker(t);
 }
 
+// collect and reset deltas of all shards
 static double instant_rate(rate_t *r) {
-    int64_t c = r->delta;
-    InterlockedAdd64(&r->delta, -c);
-    return ((double) c) / (intervalNanos);
+    int64_t c = 0;
+    for (int i = 0; i < RATE_SHARDS; i++) {
+        c += InterlockedSwap64(&r->shards[i].delta, 0);
+    }
+    return ((double) c) / (r->ticker->interval_nanos);
 }
 
 static void tick_cma(rate_t *cma) {
@@ -174,6 +296,99 @@ static void tick_ewma(rate_t *ewma) {
 
 static void tick_instant(rate_t *inst) {
     double r = instant_rate(inst);
-    InterlockedExchange64(&inst->delta, 0); //reset the delta
     InterlockedExchange64(&inst->rate, *(int64_t*)(&r));
 }
+
+static int hist_msb(uint64_t v) {
+#if defined(_MSC_VER)
+    unsigned long idx;
+    _BitScanReverse64(&idx, v);
+    return (int) idx;
+#else
+    return 63 - __builtin_clzll(v);
+#endif
+}
+
+static unsigned int hist_index(uint64_t v) {
+    if (v < HIST_SUB_BUCKETS) {
+        return (unsigned int) v;
+    }
+
+    int msb = hist_msb(v);
+    if (msb >= HIST_MAX_BITS) {
+        return HIST_BUCKETS - 1;
+    }
+    int shift = msb - HIST_SUB_BITS;
+    return (unsigned int) ((shift + 1) * HIST_SUB_BUCKETS + (v >> shift) - HIST_SUB_BUCKETS);
+}
+
+// highest value that falls into bucket [idx]
+static uint64_t hist_bucket_value(unsigned int idx) {
+    if (idx < HIST_SUB_BUCKETS) {
+        return idx;
+    }
+    unsigned int shift = idx / HIST_SUB_BUCKETS - 1;
+    uint64_t low = (uint64_t) (HIST_SUB_BUCKETS + idx % HIST_SUB_BUCKETS) << shift;
+    return low + ((uint64_t) 1 << shift) - 1;
+}
+
+extern void metrics_hist_reset(histogram_t *h) {
+    memset(h, 0, sizeof(*h));
+}
+
+extern void metrics_hist_record(histogram_t *h, uint64_t value) {
+    if (h->count == 0 || value < h->min) {
+        h->min = value;
+    }
+    if (value > h->max) {
+        h->max = value;
+    }
+    h->count++;
+    h->sum += value;
+    h->counts[hist_index(value)]++;
+}
+
+extern void metrics_hist_merge(histogram_t *into, const histogram_t *from) {
+    if (from->count == 0) {
+        return;
+    }
+    if (into->count == 0 || from->min < into->min) {
+        into->min = from->min;
+    }
+    if (from->max > into->max) {
+        into->max = from->max;
+    }
+    into->count += from->count;
+    into->sum += from->sum;
+    for (unsigned int i = 0; i < HIST_BUCKETS; i++) {
+        into->counts[i] += from->counts[i];
+    }
+}
+
+extern uint64_t metrics_hist_percentile(const histogram_t *h, double pct) {
+    if (h->count == 0) {
+        return 0;
+    }
+
+    uint64_t target = (uint64_t) ceil(pct / 100.0 * (double) h->count);
+    if (target == 0) {
+        return h->min;
+    }
+
+    uint64_t seen = 0;
+    for (unsigned int i = 0; i < HIST_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= target) {
+            // last bucket is open ended
+            uint64_t v = i == HIST_BUCKETS - 1 ? h->max : hist_bucket_value(i);
+            if (v > h->max) v = h->max;
+            if (v < h->min) v = h->min;
+            return v;
+        }
+    }
+    return h->max;
+}
+
+extern double metrics_hist_mean(const histogram_t *h) {
+    return h->count ? (double) h->sum / (double) h->count : 0;
+}
@@ -0,0 +1,182 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+
+#include "zt_internal.h"
+
+struct batch {
+    ziti_context ztx;
+    size_t count;
+};
+
+static ziti_metric *next_metric(struct batch *b, const char *name, const char *label, ziti_metric_type type) {
+    ziti_context ztx = b->ztx;
+    if (b->count == ztx->metrics_batch_cap) {
+        size_t cap = ztx->metrics_batch_cap ? ztx->metrics_batch_cap * 2 : 64;
+        ziti_metric *m = realloc(ztx->metrics_batch, cap * sizeof(ziti_metric));
+        if (m == NULL) {
+            return NULL;
+        }
+        ztx->metrics_batch = m;
+        ztx->metrics_batch_cap = cap;
+    }
+
+    ziti_metric *m = &ztx->metrics_batch[b->count++];
+    m->name = name;
+    m->label = label;
+    m->type = type;
+    return m;
+}
+
+static void add_counter(struct batch *b, const char *name, const char *label, uint64_t v) {
+    ziti_metric *m = next_metric(b, name, label, ziti_metric_counter);
+    if (m) m->counter = v;
+}
+
+static void add_gauge(struct batch *b, const char *name, const char *label, double v) {
+    ziti_metric *m = next_metric(b, name, label, ziti_metric_gauge);
+    if (m) m->gauge = v;
+}
+
+static void add_histogram(struct batch *b, const char *name, const char *label, const histogram_t *h) {
+    ziti_metric *m = next_metric(b, name, label, ziti_metric_histogram);
+    if (m == NULL) return;
+
+    m->histogram.count = h->count;
+    m->histogram.sum = h->sum;
+    m->histogram.max = h->max;
+    m->histogram.p50 = metrics_hist_percentile(h, 50);
+    m->histogram.p90 = metrics_hist_percentile(h, 90);
+    m->histogram.p99 = metrics_hist_percentile(h, 99);
+}
+
+static void add_channel(struct batch *b, ziti_channel_t *ch) {
+    const char *label = ch->name;
+    add_gauge(b, "channel.connected", label, ziti_channel_is_connected(ch) ? 1 : 0);
+    add_gauge(b, "channel.latency", label, (double) ch->latency);
+    add_gauge(b, "channel.out_q", label, (double) ch->out_q);
+    add_gauge(b, "channel.out_q_bytes", label, (double) ch->out_q_bytes);
+    add_gauge(b, "channel.connections", label, (double) model_map_size(&ch->receivers));
+    add_counter(b, "channel.reconnects", label, ch->reconnect_count);
+    add_histogram(b, "channel.write_delay", label, &ch->write_delay);
+}
+
+static void sink_tick(metrics_tick_hook *hook) {
+    ziti_context ztx = hook->data;
+    if (ztx->metrics_sink == NULL) {
+        return;
+    }
+
+    struct batch b = {.ztx = ztx};
+
+    add_gauge(&b, "ztx.rate_up", NULL, metrics_rate_get(&ztx->up_rate));
+    add_gauge(&b, "ztx.rate_down", NULL, metrics_rate_get(&ztx->down_rate));
+    add_gauge(&b, "ztx.services", NULL, (double) model_map_size(&ztx->services));
+    add_gauge(&b, "ztx.sessions", NULL, (double) model_map_size(&ztx->sessions));
+    add_gauge(&b, "ztx.connections", NULL, (double) model_map_size(&ztx->connections));
+
+    for (int lane = 0; lane < CTRL_LANES; lane++) {
+        const struct ctrl_req_stats *st = &ztx->controller.stats[lane];
+        const char *label = ziti_ctrl_lane_name(lane);
+        add_counter(&b, "ctrl.errors", label, st->errors);
+        add_histogram(&b, "ctrl.latency", label, &st->latency);
+    }
+
+    add_histogram(&b, "dial.time", NULL, &ztx->dial_time);
+    for (int i = 0; ztx->opts.dial_timings && i < DIAL_PHASES; i++) {
+        add_histogram(&b, "dial.phase", ziti_dial_phase_name(i), &ztx->dial_phases[i]);
+    }
+
+    uint64_t hits, misses;
+    size_t high_water;
+    ziti_get_read_buf_stats(ztx, &hits, &misses);
+    add_counter(&b, "pool.read_buf.hits", NULL, hits);
+    add_counter(&b, "pool.read_buf.misses", NULL, misses);
+    ziti_get_out_msg_stats(ztx, &hits, &misses, &high_water);
+    add_counter(&b, "pool.out_msg.hits", NULL, hits);
+    add_counter(&b, "pool.out_msg.misses", NULL, misses);
+    add_gauge(&b, "pool.out_msg.high_water", NULL, (double) high_water);
+
+    const ziti_path_stats *ps = &ztx->path_stats;
+    add_counter(&b, "path.msgs_framed", NULL, ps->msgs_framed);
+    add_counter(&b, "path.msgs_framed_in_place", NULL, ps->msgs_framed_in_place);
+    add_counter(&b, "path.msgs_dispatched", "data", ps->msgs_data);
+    add_counter(&b, "path.msgs_dispatched", "state", ps->msgs_state);
+    add_counter(&b, "path.msgs_dispatched", "reply", ps->msgs_replies);
+    add_counter(&b, "path.msgs_dispatched", "other", ps->msgs_other);
+    add_counter(&b, "path.bytes_copied", NULL, ps->bytes_copied);
+    add_counter(&b, "path.allocs", NULL, ps->allocs);
+    add_counter(&b, "path.read_stalls", NULL, ps->read_stalls);
+    add_counter(&b, "path.flush_budget_hits", NULL, ps->flush_budget_hits);
+    add_counter(&b, "path.bridge_writes", NULL, ps->bridge_writes);
+    add_counter(&b, "path.bridge_write_chunks", NULL, ps->bridge_write_chunks);
+    add_counter(&b, "path.dgrams_dropped", NULL, ps->dgrams_dropped);
+    add_counter(&b, "path.dials_shed", NULL, ps->dials_shed);
+    add_counter(&b, "path.writes_coalesced", NULL, ps->writes_coalesced);
+    add_counter(&b, "path.crypto_offloaded", NULL, ps->crypto_offloaded);
+    add_counter(&b, "path.early_writes", NULL, ps->early_writes);
+    add_counter(&b, "path.raced_dials", NULL, ps->raced_dials);
+    add_counter(&b, "path.race_wins", NULL, ps->race_wins);
+    add_counter(&b, "path.conns_hibernated", NULL, ps->conns_hibernated);
+    add_counter(&b, "path.conns_woken", NULL, ps->conns_woken);
+    add_counter(&b, "path.bind_migrations", NULL, ps->bind_migrations);
+    add_counter(&b, "path.e2e_aes_gcm", NULL, ps->e2e_aes_gcm);
+    add_counter(&b, "path.write_blocks", NULL, ps->write_blocks);
+
+    const char *name;
+    ziti_channel_t *ch;
+    MODEL_MAP_FOREACH(name, ch, &ztx->channels) {
+        add_channel(&b, ch);
+        for (int i = 0; i < ch->num_stripes; i++) {
+            add_channel(&b, ch->stripes[i]);
+        }
+    }
+
+    struct service_xfer *x;
+    MODEL_MAP_FOREACH(name, x, &ztx->service_xfers) {
+        add_counter(&b, "service.bytes_up", name, x->bytes_up);
+        add_counter(&b, "service.bytes_down", name, x->bytes_down);
+        add_counter(&b, "service.msgs_up", name, x->msgs_up);
+        add_counter(&b, "service.msgs_down", name, x->msgs_down);
+        add_gauge(&b, "service.rate_up", name, metrics_rate_get(&x->up_rate));
+        add_gauge(&b, "service.rate_down", name, metrics_rate_get(&x->down_rate));
+    }
+
+    ztx->metrics_sink(ztx, ztx->metrics_batch, b.count, ztx->metrics_sink_ctx);
+}
+
+int ziti_set_metrics_sink(ziti_context ztx, ziti_metrics_sink sink, void *ctx) {
+    ztx->metrics_sink = sink;
+    ztx->metrics_sink_ctx = ctx;
+
+    if (sink == NULL) {
+        ziti_metrics_sink_free(ztx);
+        return ZITI_OK;
+    }
+
+    ztx->metrics_hook.cb = sink_tick;
+    ztx->metrics_hook.data = ztx;
+    metrics_tick_hook_add(ztx->loop, &ztx->metrics_hook);
+    ZTX_LOG(DEBUG, "metrics sink registered");
+    return ZITI_OK;
+}
+
+void ziti_metrics_sink_free(ziti_context ztx) {
+    metrics_tick_hook_remove(&ztx->metrics_hook);
+    ztx->metrics_sink = NULL;
+    ztx->metrics_sink_ctx = NULL;
+    FREE(ztx->metrics_batch);
+    ztx->metrics_batch_cap = 0;
+}
@@ -14,6 +14,7 @@
 
 #include <ziti/model_collections.h>
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdlib.h>
@@ -22,73 +23,178 @@
 #include <tlsuv/queue.h>
 #include "utils.h"
 
+// keys shorter than this are stored in the entry
+#define MAP_INLINE_KEY 24
+#define MAP_INIT_SLOTS 16
+#define MAP_INIT_BLOCK 8
+#define MAP_MAX_BLOCK 256
+
 struct model_map_entry {
-    void *key;
-    char key_pad[2];
-    size_t key_len;
-    uint32_t key_hash;
-    void *value;
     LIST_ENTRY(model_map_entry) _next;
-    LIST_ENTRY(model_map_entry) _tnext;
     model_map *_map;
+    void *value;
+    size_t key_len;
+    uint32_t key_hash;
+    union {
+        char *ptr;
+        char small[MAP_INLINE_KEY];
+    } key;
 };
 
-#define ENTRY_KEY(e) ((e)->key_len > sizeof((e)->key) ? (e)->key : &(e)->key)
+#define ENTRY_KEY(e) ((e)->key_len < MAP_INLINE_KEY ? (e)->key.small : (e)->key.ptr)
 
-typedef LIST_HEAD(entries_s, model_map_entry) entries_t;
+struct map_slot {
+    uint32_t hash;
+    struct model_map_entry *entry;
+};
+
+// entries are carved from blocks, so that they never move and iterators stay valid
+struct entry_block {
+    struct entry_block *next;
+    size_t count;
+    size_t used;
+    struct model_map_entry entries[];
+};
 
 struct model_impl_s {
-    entries_t entries;
-    entries_t *table;
-    int buckets;
+    LIST_HEAD(entries_s, model_map_entry) entries;
+    // open addressing with linear probing, deletion shifts following entries back (no tombstones)
+    struct map_slot *slots;
+    uint32_t mask;
     size_t size;
+
+    struct entry_block *blocks;
+    struct model_map_entry *free_entries;
 };
 
 static uint32_t key_hash0(const uint8_t *key, size_t key_len) {
-    uint32_t h = 0;
+    // integer keys (model_map_setl)
+    if (key_len == sizeof(long)) {
+        long k;
+        memcpy(&k, key, sizeof(k));
+        uint64_t h = (uint64_t) k * 0x9E3779B97F4A7C15ULL;
+        return (uint32_t) (h >> 32);
+    }
+
+    // FNV-1a, folded to 32 bits
+    uint64_t h = 14695981039346656037ULL;
     for (size_t idx = 0; idx < key_len; idx++) {
-        h = ((h << 5U) + h) + key[idx];
+        h = (h ^ key[idx]) * 1099511628211ULL;
     }
-    return h;
+    return (uint32_t) (h ^ (h >> 32));
 }
 
-static const int DEFAULT_MAP_BUCKETS = 16;
-
 static uint32_t (*key_hash)(const uint8_t *key, size_t key_len) = key_hash0;
 
-static void map_resize_table(model_map *m) {
-    if (m->impl == NULL) { return; }
+static struct model_map_entry *alloc_entry(struct model_impl_s *impl) {
+    struct model_map_entry *e = impl->free_entries;
+    if (e != NULL) {
+        impl->free_entries = LIST_NEXT(e, _next);
+        memset(e, 0, sizeof(*e));
+        return e;
+    }
 
-    int orig_buckets = m->impl->buckets;
-    m->impl->buckets *= 2;
-    m->impl->table = realloc(m->impl->table, m->impl->buckets * sizeof(entries_t));
-    memset(m->impl->table, 0, sizeof(entries_t) * m->impl->buckets);
+    struct entry_block *b = impl->blocks;
+    if (b == NULL || b->used == b->count) {
+        size_t count = b ? b->count * 2 : MAP_INIT_BLOCK;
+        if (count > MAP_MAX_BLOCK) count = MAP_MAX_BLOCK;
+        b = calloc(1, sizeof(struct entry_block) + count * sizeof(struct model_map_entry));
+        b->count = count;
+        b->next = impl->blocks;
+        impl->blocks = b;
+    }
+    return &b->entries[b->used++];
+}
 
-    struct model_map_entry *el;
-    LIST_FOREACH(el, &m->impl->entries, _next) {
-        uint32_t idx = el->key_hash % m->impl->buckets;
-        entries_t *bucket = m->impl->table + idx;
-        LIST_INSERT_HEAD(bucket, el, _tnext);
+static void free_entry(struct model_impl_s *impl, struct model_map_entry *e) {
+    if (e->key_len >= MAP_INLINE_KEY) {
+        free(e->key.ptr);
     }
+    e->_next.le_next = impl->free_entries;
+    impl->free_entries = e;
 }
 
-static struct model_map_entry *find_map_entry(const model_map *m, const uint8_t *key, size_t key_len, uint32_t *hash_out) {
-    uint32_t kh = key_hash(key, key_len);
-    if (hash_out) {
-        *hash_out = kh;
+static void free_impl(model_map *m) {
+    struct model_impl_s *impl = m->impl;
+    while (impl->blocks) {
+        struct entry_block *b = impl->blocks;
+        impl->blocks = b->next;
+        free(b);
     }
-    uint32_t idx = kh % m->impl->buckets;
-    entries_t *bucket = m->impl->table + idx;
-    struct model_map_entry *entry;
-    LIST_FOREACH(entry, bucket, _tnext) {
-        if (key_len == entry->key_len && kh == entry->key_hash) {
-            void *ekey = ENTRY_KEY(entry);
-            if (memcmp(key, ekey, key_len) == 0) {
-                return entry;
-            }
+    free(impl->slots);
+    free(impl);
+    m->impl = NULL;
+}
+
+static int find_slot(const struct model_impl_s *impl, const uint8_t *key, size_t key_len, uint32_t kh) {
+    uint32_t idx = kh & impl->mask;
+    struct map_slot *slot;
+    while ((slot = &impl->slots[idx])->entry != NULL) {
+        if (slot->hash == kh && slot->entry->key_len == key_len &&
+            memcmp(key, ENTRY_KEY(slot->entry), key_len) == 0) {
+            return (int) idx;
         }
+        idx = (idx + 1) & impl->mask;
+    }
+    return -1;
+}
+
+static void insert_slot(struct model_impl_s *impl, struct model_map_entry *e) {
+    uint32_t idx = e->key_hash & impl->mask;
+    while (impl->slots[idx].entry != NULL) {
+        idx = (idx + 1) & impl->mask;
+    }
+    impl->slots[idx].hash = e->key_hash;
+    impl->slots[idx].entry = e;
+}
+
+static void map_resize_table(model_map *m) {
+    struct model_impl_s *impl = m->impl;
+    free(impl->slots);
+    impl->mask = impl->mask * 2 + 1;
+    impl->slots = calloc(impl->mask + 1, sizeof(struct map_slot));
+
+    struct model_map_entry *el;
+    LIST_FOREACH(el, &impl->entries, _next) {
+        insert_slot(impl, el);
+    }
+}
+
+static void remove_slot(struct model_impl_s *impl, uint32_t i) {
+    uint32_t j = i;
+    for (;;) {
+        j = (j + 1) & impl->mask;
+        struct map_slot *s = &impl->slots[j];
+        if (s->entry == NULL) {
+            break;
+        }
+
+        // entry at j can fill the hole at i unless its home slot lies cyclically in (i, j]
+        uint32_t k = s->hash & impl->mask;
+        bool stays = (i <= j) ? (i < k && k <= j) : (i < k || k <= j);
+        if (!stays) {
+            impl->slots[i] = *s;
+            i = j;
+        }
+    }
+    impl->slots[i].entry = NULL;
+    impl->slots[i].hash = 0;
+}
+
+static void remove_entry(model_map *m, struct model_map_entry *e) {
+    struct model_impl_s *impl = m->impl;
+    int idx = find_slot(impl, (const uint8_t *) ENTRY_KEY(e), e->key_len, e->key_hash);
+    if (idx >= 0) {
+        remove_slot(impl, (uint32_t) idx);
+    }
+    LIST_REMOVE(e, _next);
+    free_entry(impl, e);
+    impl->size--;
+
+    // last element removed
+    if (impl->size == 0) {
+        free_impl(m);
     }
-    return NULL;
 }
 
 size_t model_map_size(const model_map *m) {
@@ -107,39 +213,40 @@ void *model_map_set_key(model_map *m, const void *key, size_t key_len, void *val
 
     if (m->impl == NULL) {
         m->impl = calloc(1, sizeof(struct model_impl_s));
-        m->impl->buckets = DEFAULT_MAP_BUCKETS;
-        m->impl->table = calloc(m->impl->buckets, sizeof(entries_t));
+        m->impl->mask = MAP_INIT_SLOTS - 1;
+        m->impl->slots = calloc(MAP_INIT_SLOTS, sizeof(struct map_slot));
     }
 
-    uint32_t kh;
-    struct model_map_entry *el = find_map_entry(m, key, key_len, &kh);
-    if (el != NULL) {
+    struct model_impl_s *impl = m->impl;
+    uint32_t kh = key_hash(key, key_len);
+    int idx = find_slot(impl, key, key_len, kh);
+    if (idx >= 0) {
+        struct model_map_entry *el = impl->slots[idx].entry;
         void *old_val = el->value;
         el->value = val;
         return old_val;
     }
 
-    el = calloc(1, sizeof(*el));
+    // keep load factor under 3/4
+    if ((impl->size + 1) * 4 > (impl->mask + 1) * 3) {
+        map_resize_table(m);
+    }
+
+    struct model_map_entry *el = alloc_entry(impl);
     el->value = val;
     el->key_len = key_len;
-    if (key_len > sizeof(el->key)) {
-        el->key = calloc(1, key_len + 1);
-        memcpy(el->key, key, key_len);
+    if (key_len >= MAP_INLINE_KEY) {
+        el->key.ptr = calloc(1, key_len + 1);
+        memcpy(el->key.ptr, key, key_len);
     } else {
-        memcpy(&el->key, key, key_len);
+        memcpy(el->key.small, key, key_len);
     }
     el->key_hash = kh;
     el->_map = m;
-    uint32_t idx = el->key_hash % m->impl->buckets;
 
-    entries_t *bucket = m->impl->table + idx;
-    LIST_INSERT_HEAD(&m->impl->entries, el, _next);
-    LIST_INSERT_HEAD(bucket, el, _tnext);
-    m->impl->size++;
-
-    if (m->impl->size > m->impl->buckets * 2) {
-        map_resize_table(m);
-    }
+    LIST_INSERT_HEAD(&impl->entries, el, _next);
+    insert_slot(impl, el);
+    impl->size++;
 
     return NULL;
 }
@@ -157,8 +264,8 @@ void *model_map_get_key(const model_map *m, const void *key, size_t key_len) {
         return NULL;
     }
 
-    struct model_map_entry *el = find_map_entry(m, key, key_len, NULL);
-    return el ? el->value : NULL;
+    int idx = find_slot(m->impl, key, key_len, key_hash(key, key_len));
+    return idx >= 0 ? m->impl->slots[idx].entry->value : NULL;
 }
 
 void *model_map_removel(model_map *m, long key) {
@@ -174,23 +281,14 @@ void *model_map_remove_key(model_map *m, const void *key, size_t key_len) {
         return NULL;
     }
 
-    void *val = NULL;
-    struct model_map_entry *el = find_map_entry(m, key, key_len, NULL);
-    if (el != NULL) {
-        val = el->value;
-        LIST_REMOVE(el, _next);
-        LIST_REMOVE(el, _tnext);
-        if (el->key_len > sizeof(el->key)) {
-            free(el->key);
-        }
-        free(el);
-        m->impl->size--;
+    int idx = find_slot(m->impl, key, key_len, key_hash(key, key_len));
+    if (idx < 0) {
+        return NULL;
     }
 
-    if (m->impl->size == 0) {
-        FREE(m->impl->table);
-        FREE(m->impl);
-    }
+    struct model_map_entry *el = m->impl->slots[idx].entry;
+    void *val = el->value;
+    remove_entry(m, el);
     return val;
 }
 
@@ -200,16 +298,14 @@ void model_map_clear(model_map *map, void (*val_free_func)(void *)) {
     while (!LIST_EMPTY(&map->impl->entries)) {
         struct model_map_entry *el = LIST_FIRST(&map->impl->entries);
         LIST_REMOVE(el, _next);
-        if (el->key_len > sizeof(el->key)) {
-            FREE(el->key);
+        if (el->key_len >= MAP_INLINE_KEY) {
+            FREE(el->key.ptr);
         }
         if (val_free_func) {
             val_free_func(el->value);
         }
-        FREE(el);
     }
-    FREE(map->impl->table);
-    FREE(map->impl);
+    free_impl(map);
 }
 
 model_map_iter model_map_iterator(const model_map *m) {
@@ -233,8 +329,9 @@ const void *model_map_it_key_s(model_map_iter it, size_t *key_len) {
 }
 
 long model_map_it_lkey(model_map_iter it) {
-    const long *keyp = model_map_it_key_s(it, NULL);
-    return *keyp;
+    long key;
+    memcpy(&key, model_map_it_key_s(it, NULL), sizeof(key));
+    return key;
 }
 
 void *model_map_it_value(model_map_iter it) {
@@ -249,20 +346,7 @@ model_map_iter model_map_it_remove(model_map_iter it) {
     model_map_iter next = model_map_it_next(it);
     if (it != NULL) {
         struct model_map_entry *e = (struct model_map_entry *) it;
-        model_map *m = e->_map;
-        m->impl->size--;
-        LIST_REMOVE(e, _next);
-        LIST_REMOVE(e, _tnext);
-        if (e->key_len > sizeof(e->key)) {
-            free(e->key);
-        }
-        free(e);
-
-        // last element removed
-        if (m->impl->size == 0) {
-            FREE(m->impl->table);
-            FREE(m->impl);
-        }
+        remove_entry(e->_map, e);
     }
     return next;
 }
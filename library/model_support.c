@@ -21,18 +21,28 @@
 
 #include <jsmn.h>
 
+#include <uv.h>
 #include <ziti/model_support.h>
 #include <buffer.h>
 #include <utils.h>
 
 #if _WIN32
+#include <windows.h>
 #include <time.h>
 #define timegm(v) _mkgmtime(v)
+#define index_load(p) InterlockedCompareExchangePointer((p), NULL, NULL)
+#define index_publish(p, idx) (InterlockedCompareExchangePointer((p), (idx), NULL) == NULL)
 #else
 #define _GNU_SOURCE //add time.h include after defining _GNU_SOURCE
 
 #include <time.h>
+#include <stdatomic.h>
 
+#define index_load(p) atomic_load_explicit((_Atomic(void *) *) (p), memory_order_acquire)
+static inline bool index_publish(void **p, void *idx) {
+    void *expected = NULL;
+    return atomic_compare_exchange_strong((_Atomic(void *) *) p, &expected, idx);
+}
 #endif
 
 #define RUNE_MASK 0b00111111
@@ -47,33 +57,309 @@
     if ((rh) == NULL) { return 1; }
 
 static int parse_obj(void *obj, const char *json, jsmntok_t *tok, type_meta *meta);
+static bool arena_owned_type(const type_meta *meta);
+
+#define TOK_ARENA_INIT 256
+// per-thread arena is shrunk after parsing very large documents
+#define TOK_ARENA_KEEP (64 * 1024)
+
+struct model_tok_arena_s {
+    jsmntok_t *toks;
+    size_t cap;
+    bool in_use;
+};
+
+static uv_once_t arena_init = UV_ONCE_INIT;
+static uv_key_t arena_key;
 
-jsmntok_t* parse_tokens(jsmn_parser *parser, const char *json, size_t len, size_t *ntok) {
-    size_t tok_cap = 256;
-    jsmn_init(parser);
+static uv_key_t mem_arena_key;
 
-    jsmntok_t *toks = calloc(tok_cap, sizeof(jsmntok_t));
+static void init_arena_key(void) {
+    uv_key_create(&arena_key);
+    uv_key_create(&mem_arena_key);
+}
 
-    int rc = jsmn_parse(parser, json, len, toks, tok_cap);
-    while (rc == JSMN_ERROR_NOMEM) {
-        toks = realloc(toks, (tok_cap *= 2) * sizeof(jsmntok_t));
-        ZITI_LOG(TRACE, "reallocating token array, new size = %zd", tok_cap);
-        rc = jsmn_parse(parser, json, len, toks, tok_cap);
+model_tok_arena *model_tok_arena_new(size_t initial_tokens) {
+    NEWP(arena, model_tok_arena);
+    if (initial_tokens > 0) {
+        arena->cap = initial_tokens;
+        arena->toks = calloc(arena->cap, sizeof(jsmntok_t));
+    }
+    return arena;
+}
+
+void model_tok_arena_free(model_tok_arena *arena) {
+    if (arena == NULL) return;
+    FREE(arena->toks);
+    free(arena);
+}
+
+static model_tok_arena *thread_arena(void) {
+    uv_once(&arena_init, init_arena_key);
+    model_tok_arena *arena = uv_key_get(&arena_key);
+    if (arena == NULL) {
+        arena = model_tok_arena_new(TOK_ARENA_INIT);
+        uv_key_set(&arena_key, arena);
+    }
+    return arena;
+}
+
+static model_tok_arena *acquire_arena(model_tok_arena *arena) {
+    if (arena == NULL) {
+        arena = thread_arena();
+        // nested parse (from a custom parser) gets its own tokens
+        if (arena->in_use) {
+            arena = model_tok_arena_new(TOK_ARENA_INIT);
+        }
+    }
+    arena->in_use = true;
+    return arena;
+}
+
+static void release_arena(model_tok_arena *arena, model_tok_arena *requested) {
+    if (requested != NULL) {
+        arena->in_use = false;
+        return;
+    }
+
+    if (arena != uv_key_get(&arena_key)) {
+        model_tok_arena_free(arena);
+        return;
+    }
+
+    arena->in_use = false;
+    if (arena->cap > TOK_ARENA_KEEP) {
+        free(arena->toks);
+        arena->cap = TOK_ARENA_INIT;
+        arena->toks = calloc(arena->cap, sizeof(jsmntok_t));
+    }
+}
+
+static jsmntok_t *parse_tokens(model_tok_arena *arena, const char *json, size_t len, size_t *ntok) {
+    jsmn_parser parser;
+    jsmn_init(&parser);
+
+    if (arena->cap < 2) {
+        arena->cap = TOK_ARENA_INIT;
+        arena->toks = realloc(arena->toks, arena->cap * sizeof(jsmntok_t));
+    }
+
+    // last slot is reserved for terminating token
+    // when parser runs out of tokens it resumes where it stopped, so document is only tokenized once
+    int rc;
+    while ((rc = jsmn_parse(&parser, json, len, arena->toks, arena->cap - 1)) == JSMN_ERROR_NOMEM) {
+        arena->cap *= 2;
+        arena->toks = realloc(arena->toks, arena->cap * sizeof(jsmntok_t));
+        ZITI_LOG(TRACE, "reallocating token array, new size = %zd", arena->cap);
     }
 
     *ntok = rc;
     if (rc < 0) {
         int lvl = (rc == JSMN_ERROR_PART) ? DEBUG : ERROR;
         ZITI_LOG(lvl, "jsmn_parse() failed: %d", rc);
-        free(toks);
-        toks = NULL;
-    } else {
-        if (*ntok == tok_cap) {
-            toks = realloc(toks, (tok_cap + 1) * sizeof(jsmntok_t));
+        return NULL;
+    }
+
+    arena->toks[*ntok].type = JSMN_UNDEFINED;
+    return arena->toks;
+}
+
+#define MEM_ARENA_BLOCK (64 * 1024)
+#define MEM_ARENA_ALIGN 16
+
+struct arena_block_s {
+    struct arena_block_s *next;
+    uint8_t *ptr;
+    uint8_t *end;
+    uint8_t data[];
+};
+
+// cleanup of memory that is not owned by arena, e.g. model_map/model_list internals
+struct arena_cleanup_s {
+    struct arena_cleanup_s *next;
+    void (*fn)(void *);
+    void *obj;
+};
+
+struct model_arena_s {
+    size_t block_size;
+    struct arena_block_s *blocks;
+    struct arena_cleanup_s *cleanups;
+};
+
+// arena used by current parse on this thread, NULL for regular allocations
+static model_arena *mem_arena(void) {
+    return uv_key_get(&mem_arena_key);
+}
+
+static model_arena *set_mem_arena(model_arena *arena) {
+    uv_once(&arena_init, init_arena_key);
+    model_arena *prev = uv_key_get(&mem_arena_key);
+    uv_key_set(&mem_arena_key, arena);
+    return prev;
+}
+
+static struct arena_block_s *arena_block(size_t size) {
+    struct arena_block_s *b = malloc(sizeof(struct arena_block_s) + size + MEM_ARENA_ALIGN);
+    b->ptr = b->data;
+    b->end = b->data + size + MEM_ARENA_ALIGN;
+    b->next = NULL;
+    return b;
+}
+
+static void *arena_alloc(model_arena *arena, size_t size) {
+    size = (size + MEM_ARENA_ALIGN - 1) & ~(size_t) (MEM_ARENA_ALIGN - 1);
+
+    struct arena_block_s *b = arena->blocks;
+    uint8_t *p = b ? (uint8_t *) (((uintptr_t) b->ptr + MEM_ARENA_ALIGN - 1) & ~(uintptr_t) (MEM_ARENA_ALIGN - 1)) : NULL;
+    if (b == NULL || p + size > b->end) {
+        if (size > arena->block_size / 4) {
+            // large allocation gets its own block, current block keeps serving small ones
+            struct arena_block_s *big = arena_block(size);
+            if (b) {
+                big->next = b->next;
+                b->next = big;
+            } else {
+                arena->blocks = big;
+            }
+            p = (uint8_t *) (((uintptr_t) big->ptr + MEM_ARENA_ALIGN - 1) & ~(uintptr_t) (MEM_ARENA_ALIGN - 1));
+            big->ptr = p + size;
+            memset(p, 0, size);
+            return p;
+        }
+
+        b = arena_block(arena->block_size);
+        b->next = arena->blocks;
+        arena->blocks = b;
+        p = (uint8_t *) (((uintptr_t) b->ptr + MEM_ARENA_ALIGN - 1) & ~(uintptr_t) (MEM_ARENA_ALIGN - 1));
+    }
+    b->ptr = p + size;
+    memset(p, 0, size);
+    return p;
+}
+
+static void arena_defer(model_arena *arena, void (*fn)(void *), void *obj) {
+    struct arena_cleanup_s *c = arena_alloc(arena, sizeof(*c));
+    c->fn = fn;
+    c->obj = obj;
+    c->next = arena->cleanups;
+    arena->cleanups = c;
+}
+
+static void *model_alloc(size_t count, size_t size) {
+    model_arena *arena = mem_arena();
+    return arena ? arena_alloc(arena, count * size) : calloc(count, size);
+}
+
+static void model_dealloc(void *p) {
+    if (mem_arena() == NULL) {
+        free(p);
+    }
+}
+
+model_arena *model_arena_new(size_t block_size) {
+    NEWP(arena, model_arena);
+    arena->block_size = block_size > 0 ? block_size : MEM_ARENA_BLOCK;
+    return arena;
+}
+
+void model_arena_free(model_arena *arena) {
+    if (arena == NULL) return;
+
+    while (arena->cleanups) {
+        struct arena_cleanup_s *c = arena->cleanups;
+        arena->cleanups = c->next;
+        c->fn(c->obj);
+    }
+
+    while (arena->blocks) {
+        struct arena_block_s *b = arena->blocks;
+        arena->blocks = b->next;
+        free(b);
+    }
+    free(arena);
+}
+
+static void clear_list(void *list) {
+    model_list_clear(list, NULL);
+}
+
+static void clear_map(void *map) {
+    model_map_clear(map, NULL);
+}
+
+/**
+ * Field lookup table for a model type: open addressing on the hash of the JSON key.
+ * Replaces per key linear scan of field names.
+ */
+struct field_index_s {
+    size_t mask;
+    size_t *path_len;
+    // size of last JSON produced for the type, used to size output buffer, races are harmless
+    volatile size_t json_size_hint;
+    int slots[]; // field index + 1, 0 is empty
+};
+
+#define INTERNAL_FIELD ((size_t) -1)
+
+static uint32_t key_hash(const char *key, size_t len) {
+    uint32_t h = 2166136261u;
+    for (size_t i = 0; i < len; i++) {
+        h = (h ^ (uint8_t) key[i]) * 16777619u;
+    }
+    return h;
+}
+
+static struct field_index_s *field_index(type_meta *meta) {
+    struct field_index_s *idx = index_load(&meta->field_index);
+    if (idx != NULL) {
+        return idx;
+    }
+
+    size_t cap = 4;
+    while (cap < (size_t) meta->field_count * 2) cap <<= 1;
+
+    idx = calloc(1, sizeof(struct field_index_s) + cap * sizeof(int));
+    idx->mask = cap - 1;
+    idx->path_len = calloc(meta->field_count + 1, sizeof(size_t));
+    for (int i = 0; i < meta->field_count; i++) {
+        const char *path = meta->fields[i].path;
+        // fields declared with NULL path are internal, they are not mapped to JSON
+        if (strcmp(path, "NULL") == 0) {
+            idx->path_len[i] = INTERNAL_FIELD;
+            continue;
+        }
+        size_t len = strlen(path);
+        idx->path_len[i] = len;
+
+        size_t slot = key_hash(path, len) & idx->mask;
+        while (idx->slots[slot] != 0) {
+            slot = (slot + 1) & idx->mask;
         }
-        toks[*ntok].type = JSMN_UNDEFINED;
+        idx->slots[slot] = i + 1;
     }
-    return toks;
+
+    // another thread may have built it concurrently
+    if (!index_publish(&meta->field_index, idx)) {
+        free(idx->path_len);
+        free(idx);
+        idx = index_load(&meta->field_index);
+    }
+    return idx;
+}
+
+static field_meta *find_field(type_meta *meta, const char *key, size_t len) {
+    struct field_index_s *idx = field_index(meta);
+    size_t slot = key_hash(key, len) & idx->mask;
+    int f;
+    while ((f = idx->slots[slot]) != 0) {
+        field_meta *fm = &meta->fields[f - 1];
+        if (idx->path_len[f - 1] == len && memcmp(fm->path, key, len) == 0) {
+            return fm;
+        }
+        slot = (slot + 1) & idx->mask;
+    }
+    return NULL;
 }
 
 int model_cmp(const void *lh, const void *rh, type_meta *meta) {
@@ -169,12 +455,13 @@ int model_cmp(const void *lh, const void *rh, type_meta *meta) {
     return rc;
 }
 
-int model_parse_list(model_list *list, const char *json, size_t len, type_meta *meta) {
-    jsmn_parser parser;
+static int parse_list_doc(model_list *list, const char *json, size_t len, type_meta *meta, model_tok_arena *arena) {
+    model_tok_arena *a = acquire_arena(arena);
+    model_arena *mem = mem_arena();
     size_t ntoks;
     int result = -1;
     int children = 0;
-    jsmntok_t *tokens = parse_tokens(&parser, json, len, &ntoks);
+    jsmntok_t *tokens = parse_tokens(a, json, len, &ntoks);
     if (tokens == NULL) {
         result = ntoks;
         goto done;
@@ -184,11 +471,14 @@ int model_parse_list(model_list *list, const char *json, size_t len, type_meta *
     if (tok->type != JSMN_ARRAY) {
         goto done;
     }
+    if (mem) {
+        arena_defer(mem, clear_list, list);
+    }
     result = tokens[0].end;
     children = tok->size;
     tok++;
     for (int i = 0; i < children; i++) {
-        void *el = calloc(1, meta->size);
+        void *el = model_alloc(1, meta->size);
         int rc = parse_obj(el, json, tok, meta);
         if (rc < 0) {
             result = rc;
@@ -198,7 +488,8 @@ int model_parse_list(model_list *list, const char *json, size_t len, type_meta *
         tok += rc;
     }
     done:
-    if (result < 0) {
+    // arena parse results are released with the arena
+    if (result < 0 && mem == NULL) {
         model_list_iter it = model_list_iterator(list);
         while (it != NULL) {
             void *el = model_list_it_element(it);
@@ -209,16 +500,17 @@ int model_parse_list(model_list *list, const char *json, size_t len, type_meta *
             }
         }
     }
-    FREE(tokens);
+    release_arena(a, arena);
     return result;
 }
 
-int model_parse_array(void ***arrp, const char *json, size_t len, type_meta *meta) {
-    jsmn_parser parser;
+static int parse_array_doc(void ***arrp, const char *json, size_t len, type_meta *meta, model_tok_arena *arena) {
+    model_tok_arena *a = acquire_arena(arena);
+    model_arena *mem = mem_arena();
     size_t ntoks;
     int result = -1;
     int children = 0;
-    jsmntok_t *tokens = parse_tokens(&parser, json, len, &ntoks);
+    jsmntok_t *tokens = parse_tokens(a, json, len, &ntoks);
     void **arr = NULL;
     if (tokens == NULL) {
         result = ntoks;
@@ -231,10 +523,10 @@ int model_parse_array(void ***arrp, const char *json, size_t len, type_meta *met
     }
     result = tokens[0].end;
     children = tok->size;
-    arr = calloc(tokens[0].size + 1, sizeof(void *));
+    arr = model_alloc(tokens[0].size + 1, sizeof(void *));
     tok++;
     for (int i = 0; i < children; i++) {
-        arr[i] = calloc(1, meta->size);
+        arr[i] = model_alloc(1, meta->size);
         int rc = parse_obj(arr[i], json, tok, meta);
         if (rc < 0) {
             result = rc;
@@ -244,7 +536,7 @@ int model_parse_array(void ***arrp, const char *json, size_t len, type_meta *met
     }
     *arrp = arr;
     done:
-    if (result < 0) {
+    if (result < 0 && mem == NULL) {
         if (arr != NULL) {
             for (int i = 0; i < children; i++) {
                 if (arr[i] != NULL) {
@@ -255,20 +547,74 @@ int model_parse_array(void ***arrp, const char *json, size_t len, type_meta *met
             FREE(arr);
         }
     }
-    FREE(tokens);
+    release_arena(a, arena);
     return result;
 }
 
-int model_parse(void *obj, const char *json, size_t len, type_meta *meta) {
-    jsmn_parser parser;
+static int parse_doc(void *obj, const char *json, size_t len, type_meta *meta, model_tok_arena *arena) {
+    model_tok_arena *a = acquire_arena(arena);
     size_t ntoks;
-    jsmntok_t *tokens = parse_tokens(&parser, json, len, &ntoks);
-    int res = tokens != NULL ? parse_obj(obj, json, tokens, meta) : ntoks;
+    jsmntok_t *tokens = parse_tokens(a, json, len, &ntoks);
+    int res = tokens != NULL ? parse_obj(obj, json, tokens, meta) : (int) ntoks;
     int result = res > 0 ? tokens[0].end : res;
-    FREE(tokens);
+    release_arena(a, arena);
     return result;
 }
 
+int model_parse_list(model_list *list, const char *json, size_t len, type_meta *meta) {
+    return model_parse_list_with_toks(list, json, len, meta, NULL);
+}
+
+int model_parse_list_with_toks(model_list *list, const char *json, size_t len, type_meta *meta, model_tok_arena *arena) {
+    model_arena *prev = set_mem_arena(NULL);
+    int rc = parse_list_doc(list, json, len, meta, arena);
+    set_mem_arena(prev);
+    return rc;
+}
+
+int model_parse_list_arena(model_list *list, const char *json, size_t len, type_meta *meta, model_arena *arena) {
+    model_arena *prev = set_mem_arena(arena);
+    int rc = parse_list_doc(list, json, len, meta, NULL);
+    set_mem_arena(prev);
+    return rc;
+}
+
+int model_parse_array(void ***arrp, const char *json, size_t len, type_meta *meta) {
+    return model_parse_array_with_toks(arrp, json, len, meta, NULL);
+}
+
+int model_parse_array_with_toks(void ***arrp, const char *json, size_t len, type_meta *meta, model_tok_arena *arena) {
+    model_arena *prev = set_mem_arena(NULL);
+    int rc = parse_array_doc(arrp, json, len, meta, arena);
+    set_mem_arena(prev);
+    return rc;
+}
+
+int model_parse_array_arena(void ***arrp, const char *json, size_t len, type_meta *meta, model_arena *arena) {
+    model_arena *prev = set_mem_arena(arena);
+    int rc = parse_array_doc(arrp, json, len, meta, NULL);
+    set_mem_arena(prev);
+    return rc;
+}
+
+int model_parse(void *obj, const char *json, size_t len, type_meta *meta) {
+    return model_parse_with_toks(obj, json, len, meta, NULL);
+}
+
+int model_parse_with_toks(void *obj, const char *json, size_t len, type_meta *meta, model_tok_arena *arena) {
+    model_arena *prev = set_mem_arena(NULL);
+    int rc = parse_doc(obj, json, len, meta, arena);
+    set_mem_arena(prev);
+    return rc;
+}
+
+int model_parse_arena(void *obj, const char *json, size_t len, type_meta *meta, model_arena *arena) {
+    model_arena *prev = set_mem_arena(arena);
+    int rc = parse_doc(obj, json, len, meta, NULL);
+    set_mem_arena(prev);
+    return rc;
+}
+
 static int write_model_to_buf(const void *obj, const type_meta *meta, string_buf_t *buf, int indent, int flags);
 
 char *model_to_json(const void *obj, const type_meta *meta, int flags, size_t *len) {
@@ -277,16 +623,30 @@ char *model_to_json(const void *obj, const type_meta *meta, int flags, size_t *l
         return NULL;
     }
 
+    // JSON is written into one allocation sized after previous output of the same type,
+    // that allocation becomes the result
+    struct field_index_s *idx = field_index((type_meta *) meta);
+    size_t hint = idx->json_size_hint;
     string_buf_t json;
-    string_buf_init(&json);
+    string_buf_init_sized(&json, hint > 0 ? hint + hint / 8 + 1 : 0);
     char *result = NULL;
+    size_t result_len = 0;
     if (write_model_to_buf(obj, meta, &json, 0, flags) == 0) {
-        result = string_buf_to_string(&json, len);
+        result = string_buf_to_string(&json, &result_len);
+        idx->json_size_hint = result_len;
     }
     string_buf_free(&json);
+    if (len) *len = result_len;
     return result;
 }
 
+int model_to_json_buf(const void *obj, const type_meta *meta, int flags, string_buf_t *buf) {
+    if (obj == NULL) {
+        return 0;
+    }
+    return write_model_to_buf(obj, meta, buf, 0, flags);
+}
+
 ssize_t model_to_json_r(const void *obj, const type_meta *meta, int flags, char *outbuf, size_t max) {
     if (obj == NULL) {
         return 0;
@@ -320,6 +680,7 @@ if ((flags & MODEL_JSON_COMPACT) == 0) BUF_APPEND_B(b, '\n'); \
 int write_model_to_buf(const void *obj, const type_meta *meta, string_buf_t *buf, int indent, int flags) {
 
     BUF_APPEND_S(buf, "{");
+    struct field_index_s *index = field_index((type_meta *) meta);
     char *last_coma = NULL;
     bool comma = false;
     for (int i = 0; i < meta->field_count; i++) {
@@ -333,7 +694,7 @@ int write_model_to_buf(const void *obj, const type_meta *meta, string_buf_t *buf
             f_ptr = (void *) (*f_addr);
         }
 
-        if (f_ptr == NULL) {
+        if (f_ptr == NULL || index->path_len[i] == INTERNAL_FIELD) {
             continue;
         }
 
@@ -345,7 +706,7 @@ int write_model_to_buf(const void *obj, const type_meta *meta, string_buf_t *buf
         PRETTY_INDENT(buf, indent);
 
         BUF_APPEND_B(buf, '\"');
-        BUF_APPEND_S(buf, fm->path);
+        CHECK_APPEND(string_buf_appendn(buf, fm->path, index->path_len[i]));
         BUF_APPEND_S(buf, "\":");
 
         if (fm->mod == none_mod || fm->mod == ptr_mod) {
@@ -554,7 +915,7 @@ static int parse_array(void **arr, const char *json, jsmntok_t *tok, type_meta *
         return -1;
     }
     int children = tok->size;
-    void **elems = calloc(children + 1, sizeof(void *));
+    void **elems = model_alloc(children + 1, sizeof(void *));
     *arr = elems;
     int idx;
     int rc = 0;
@@ -563,16 +924,12 @@ static int parse_array(void **arr, const char *json, jsmntok_t *tok, type_meta *
     for (idx = 0; idx < children; idx++) {
         void *el;
         if (el_meta != get_string_meta()) {
-            el = calloc(1, el_meta->size);
+            el = model_alloc(1, el_meta->size);
             elems[idx] = el;
         } else {
             el = &elems[idx];
         }
-        if (el_meta->parser != NULL) {
-            rc = el_meta->parser(el, json, tok);
-        } else {
-            rc = parse_obj(el, json, tok, el_meta);
-        }
+        rc = parse_obj(el, json, tok, el_meta);
         if (rc < 0) {
             return rc;
         }
@@ -593,6 +950,9 @@ static int parse_list(void *field, const char *json, jsmntok_t *tok, type_meta *
     }
     int children = tok->size;
     model_list *list = field;
+    if (mem_arena()) {
+        arena_defer(mem_arena(), clear_list, list);
+    }
     int idx;
     int rc = 0;
     int processed = 1;
@@ -606,10 +966,8 @@ static int parse_list(void *field, const char *json, jsmntok_t *tok, type_meta *
             el_meta == get_bool_meta()) {
             rc = el_meta->parser(&value, json, tok);
         } else {
-            value = calloc(1, el_meta->size);
-            rc = el_meta->parser ?
-                 el_meta->parser(value, json, tok) :
-                 parse_obj(value, json, tok, el_meta);
+            value = model_alloc(1, el_meta->size);
+            rc = parse_obj(value, json, tok, el_meta);
         }
         if (rc < 0) {
             return rc;
@@ -627,6 +985,9 @@ static int parse_map(void *mapp, const char *json, jsmntok_t *tok, type_meta *el
         return -1;
     }
     model_map *map = mapp;
+    if (mem_arena()) {
+        arena_defer(mem_arena(), clear_map, map);
+    }
     int tokens_processed = 1;
     int children = tok->size;
     tok++;
@@ -649,13 +1010,11 @@ static int parse_map(void *mapp, const char *json, jsmntok_t *tok, type_meta *el
             rc = get_json_meta()->parser(&value, json, tok);
         }
         else {
-            value = calloc(1, el_meta->size);
-            rc = el_meta->parser ?
-                 el_meta->parser(value, json, tok) :
-                 parse_obj(value, json, tok, el_meta);
+            value = model_alloc(1, el_meta->size);
+            rc = parse_obj(value, json, tok, el_meta);
         }
         if (rc < 0) {
-            FREE(value);
+            model_dealloc(value);
             return rc;
         }
         tok += rc;
@@ -668,7 +1027,13 @@ static int parse_map(void *mapp, const char *json, jsmntok_t *tok, type_meta *el
 static int parse_obj(void *obj, const char *json, jsmntok_t *tok, type_meta *meta) {
     memset(obj, 0, meta->size);
     if (meta->parser) {
-        return meta->parser(obj, json, tok);
+        int rc = meta->parser(obj, json, tok);
+        // custom parsers allocate on their own, their destroyer runs when arena is released
+        model_arena *mem = mem_arena();
+        if (rc >= 0 && mem && meta->destroyer && !arena_owned_type(meta)) {
+            arena_defer(mem, meta->destroyer, obj);
+        }
+        return rc;
     }
 
     if (tok->type != JSMN_OBJECT) {
@@ -682,13 +1047,7 @@ static int parse_obj(void *obj, const char *json, jsmntok_t *tok, type_meta *met
             ZITI_LOG(ERROR, "parsing[%s] error: unexpected token starting at `%.*s'", meta->name, 20, json + tok->start);
             return -1;
         }
-        field_meta *fm = NULL;
-        for (int i = 0; i < meta->field_count; i++) {
-            if (strncmp(meta->fields[i].path, json + tok->start, tok->end - tok->start) == 0) {
-                fm = &meta->fields[i];
-                break;
-            }
-        }
+        field_meta *fm = find_field(meta, json + tok->start, tok->end - tok->start);
         tokens_processed++;
 
         int rc;
@@ -709,7 +1068,7 @@ static int parse_obj(void *obj, const char *json, jsmntok_t *tok, type_meta *met
                 if (fm->mod == none_mod) {
                     memobj = (char *) (field);
                 } else if (fm->mod == ptr_mod) {
-                    memobj = (char *) calloc(1, fm->meta()->size);
+                    memobj = (char *) model_alloc(1, fm->meta()->size);
                     *(char **) field = memobj;
                 }
                 if (memobj == NULL) {
@@ -717,11 +1076,7 @@ static int parse_obj(void *obj, const char *json, jsmntok_t *tok, type_meta *met
                     return -1;
                 }
 
-                if (fm->meta()->parser != NULL) {
-                    rc = fm->meta()->parser(memobj, json, tok);
-                } else {
-                    rc = parse_obj(memobj, json, tok, fm->meta());
-                }
+                rc = parse_obj(memobj, json, tok, fm->meta());
             }
             if (rc < 0) {
                 return rc;
@@ -774,7 +1129,7 @@ static int _parse_json(char **val, const char *json, jsmntok_t *tok) {
     int end = tok->type == JSMN_STRING ? tok->end + 1 : tok->end;
 
     int json_len = end - start;
-    *val = calloc(1, json_len + 1);
+    *val = model_alloc(1, json_len + 1);
     strncpy(*val, json + start, json_len);
 
     int processed = 0;
@@ -789,7 +1144,7 @@ static int _parse_json(char **val, const char *json, jsmntok_t *tok) {
 
 static int _parse_string(char **val, const char *json, jsmntok_t *tok) {
     if (tok->type == JSMN_STRING) {
-        *val = (char *) calloc(1, tok->end - tok->start + 1);
+        *val = (char *) model_alloc(1, tok->end - tok->start + 1);
 
         const char *endp = json + tok->end;
         char *out = *val;
@@ -903,7 +1258,7 @@ static int _parse_timeval(timestamp *t, const char *json, jsmntok_t *tok) {
 
     t->tv_sec = timegm(&t2);
 
-    free(date_str);
+    model_dealloc(date_str);
     return 1;
 }
 
@@ -1198,6 +1553,9 @@ static int _parse_map(model_map *m, const char *json, jsmntok_t *tok) {
         return -1;
     }
 
+    if (mem_arena()) {
+        arena_defer(mem_arena(), clear_map, m);
+    }
     int tokens_processed = 1;
     int children = tok->size;
     tok++;
@@ -1227,6 +1585,14 @@ static void _free_map(model_map *m) {
     model_map_clear(m, free);
 }
 
+// built-in types allocate from parse arena
+static bool arena_owned_type(const type_meta *meta) {
+    return meta->destroyer == _free_noop ||
+           meta->destroyer == (_free_f) _free_string ||
+           meta->destroyer == (_free_f) _free_tag ||
+           meta->destroyer == (_free_f) _free_map;
+}
+
 static type_meta bool_META = {
         .name = "bool",
         .size = sizeof(bool),
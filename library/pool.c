@@ -17,54 +17,197 @@
 
 #include <stdlib.h>
 #include <string.h>
-#include <tlsuv/queue.h>
 #include <assert.h>
 
+#include <uv.h>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#endif
+
+#if _WIN32
+#include <windows.h>
+typedef volatile LONG64 tagged_head_t;
+#define head_load(h) InterlockedCompareExchange64((h), 0, 0)
+#define head_cas(h, old, new) (InterlockedCompareExchange64((h), (LONG64)(new), (LONG64)(old)) == (LONG64)(old))
+
+// fiber local storage calls destructor on thread exit, unlike TLS
+typedef DWORD cache_key_t;
+#define CACHE_DTOR WINAPI
+#define cache_key_create(k, dtor) ((*(k) = FlsAlloc(dtor)) == FLS_OUT_OF_INDEXES ? -1 : 0)
+#define cache_key_delete(k) FlsFree(*(k))
+#define cache_key_get(k) FlsGetValue(*(k))
+#define cache_key_set(k, v) FlsSetValue(*(k), (v))
+#else
+#include <stdatomic.h>
+#include <pthread.h>
+typedef _Atomic uint64_t tagged_head_t;
+#define head_load(h) atomic_load(h)
+#define head_cas(h, old, new) atomic_compare_exchange_weak((h), &(old), (new))
+
+typedef pthread_key_t cache_key_t;
+#define CACHE_DTOR
+#define cache_key_create(k, dtor) pthread_key_create((k), (dtor))
+#define cache_key_delete(k) pthread_key_delete(*(k))
+#define cache_key_get(k) pthread_getspecific(*(k))
+#define cache_key_set(k, v) pthread_setspecific(*(k), (v))
+#endif
+
+#define HUGEPAGE_SIZE (2 * 1024 * 1024)
+// keep objects carved out of a slab 16-byte aligned
+#define SLOT_ALIGN 16
+
 struct pool_obj_s {
     pool_t *pool;
     size_t size;
+    bool in_slab;
 
-    LIST_ENTRY(pool_obj_s) _next;
     void (*clear_func)(void *);
     char obj[];
 };
 
 struct pool_s {
-    LIST_HEAD(objs, pool_obj_s) pool;
+    // LIFO of available objects, most recently returned (cache-hot) object is reused first
+    struct pool_obj_s **free_stack;
+    size_t free_count;
+
     size_t memsize;
     size_t capacity;
+    size_t allocated;
     size_t out;
+    size_t max_out;
     bool is_closed;
 
+    // slab mode
+    size_t slab_count;
+    size_t clear_size;
+    bool hugepages;
+    void **slabs;
+    size_t num_slabs;
+
     void (*clear_func)(void *);
 };
 
 pool_t *pool_new(size_t objsize, size_t count, void (*clear_func)(void *)) {
+    return pool_new_slab(objsize, count, 0, 0, false, clear_func);
+}
+
+pool_t *pool_new_slab(size_t objsize, size_t count, size_t slab_count, size_t clear_size, bool hugepages,
+                      void (*clear_func)(void *)) {
     pool_t *p = calloc(1, sizeof(pool_t));
     p->memsize = objsize;
     p->capacity = count;
     p->clear_func = clear_func;
+    p->slab_count = slab_count;
+    p->clear_size = clear_size < objsize ? clear_size : 0;
+    p->hugepages = hugepages;
+    p->free_stack = calloc(count > 0 ? count : 1, sizeof(struct pool_obj_s *));
     return p;
 }
 
+static size_t slot_size(pool_t *pool) {
+    size_t sz = sizeof(struct pool_obj_s) + pool->memsize;
+    return (sz + SLOT_ALIGN - 1) & ~((size_t) SLOT_ALIGN - 1);
+}
+
+static void *alloc_slab(pool_t *pool, size_t len) {
+    void *slab = NULL;
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (pool->hugepages && len >= HUGEPAGE_SIZE) {
+        len = (len + HUGEPAGE_SIZE - 1) & ~((size_t) HUGEPAGE_SIZE - 1);
+        if (posix_memalign(&slab, HUGEPAGE_SIZE, len) == 0) {
+            madvise(slab, len, MADV_HUGEPAGE);
+            memset(slab, 0, len);
+            return slab;
+        }
+    }
+#endif
+    slab = calloc(1, len);
+    return slab;
+}
+
+// carve out up to [n] objects in a single slab and make them available
+static size_t pool_grow_slab(pool_t *pool, size_t n) {
+    size_t slot = slot_size(pool);
+    uint8_t *slab = alloc_slab(pool, n * slot);
+    if (slab == NULL) {
+        return 0;
+    }
+
+    pool->slabs = realloc(pool->slabs, (pool->num_slabs + 1) * sizeof(void *));
+    pool->slabs[pool->num_slabs++] = slab;
+
+    for (size_t i = 0; i < n; i++) {
+        struct pool_obj_s *m = (struct pool_obj_s *) (slab + i * slot);
+        m->size = pool->memsize;
+        m->pool = pool;
+        m->in_slab = true;
+        m->clear_func = pool->clear_func;
+        // push in reverse, so that objects are handed out in address order
+        pool->free_stack[pool->free_count + n - 1 - i] = m;
+    }
+    pool->free_count += n;
+    pool->allocated += n;
+    return n;
+}
+
+static struct pool_obj_s *pool_new_member(pool_t *pool) {
+    struct pool_obj_s *member = calloc(1, sizeof(struct pool_obj_s) + pool->memsize);
+    member->size = pool->memsize;
+    member->pool = pool;
+    member->clear_func = pool->clear_func;
+    pool->allocated++;
+    return member;
+}
+
+size_t pool_reserve(pool_t *pool, size_t n) {
+    assert(pool);
+    assert(!pool->is_closed);
+    if (n > pool->capacity) {
+        n = pool->capacity;
+    }
+
+    if (pool->allocated < n) {
+        size_t need = n - pool->allocated;
+        if (pool->slab_count > 0) {
+            pool_grow_slab(pool, need);
+        } else {
+            while (need-- > 0) {
+                pool->free_stack[pool->free_count++] = pool_new_member(pool);
+            }
+        }
+    }
+    return pool->free_count;
+}
+
+static void pool_free(pool_t *pool) {
+    for (size_t i = 0; i < pool->num_slabs; i++) {
+        free(pool->slabs[i]);
+    }
+    free(pool->slabs);
+    free(pool->free_stack);
+    free(pool);
+}
+
 void pool_destroy(pool_t *pool) {
     pool->is_closed = true;
 
-    while (!LIST_EMPTY(&pool->pool)) {
-        struct pool_obj_s *m = LIST_FIRST(&pool->pool);
-        LIST_REMOVE(m, _next);
-        free(m);
+    while (pool->free_count > 0) {
+        struct pool_obj_s *m = pool->free_stack[--pool->free_count];
+        if (!m->in_slab) {
+            free(m);
+        }
     }
 
     if (pool->out == 0) {
-        free(pool);
+        pool_free(pool);
     }
 }
 
 bool pool_has_available(pool_t *pool) {
     assert(pool);
     assert(!pool->is_closed);
-    return !LIST_EMPTY(&pool->pool) || pool->capacity > pool->out;
+    return pool->free_count > 0 || pool->capacity > pool->out;
 }
 
 void *alloc_unpooled_obj(size_t size, void (*clear_func)(void *)) {
@@ -84,20 +227,21 @@ void *pool_alloc_obj(pool_t *pool) {
     }
     assert(!pool->is_closed);
 
-    struct pool_obj_s *member = NULL;
-    if (!LIST_EMPTY(&pool->pool)) {
-        member = LIST_FIRST(&pool->pool);
-        LIST_REMOVE(member, _next);
-    }
-    else if (pool->capacity > pool->out) {
-        member = calloc(1, sizeof(struct pool_obj_s) + pool->memsize);
-        member->size = pool->memsize;
-        member->pool = pool;
-        member->clear_func = pool->clear_func;
+    if (pool->free_count == 0 && pool->capacity > pool->allocated) {
+        if (pool->slab_count > 0) {
+            size_t n = MIN(pool->slab_count, pool->capacity - pool->allocated);
+            pool_grow_slab(pool, n);
+        } else {
+            pool->free_stack[pool->free_count++] = pool_new_member(pool);
+        }
     }
 
-    if (member) {
+    if (pool->free_count > 0) {
+        struct pool_obj_s *member = pool->free_stack[--pool->free_count];
         pool->out++;
+        if (pool->out > pool->max_out) {
+            pool->max_out = pool->out;
+        }
         return &member->obj;
     }
 
@@ -108,6 +252,19 @@ size_t pool_mem_size(pool_t *pool) {
     return pool ? pool->memsize : 0;
 }
 
+void pool_usage(pool_t *pool, size_t *out, size_t *max_out) {
+    if (out) {
+        *out = pool ? pool->out : 0;
+    }
+    if (max_out) {
+        *max_out = pool ? pool->max_out : 0;
+    }
+}
+
+size_t pool_capacity(pool_t *pool) {
+    return pool ? pool->capacity : 0;
+}
+
 size_t pool_obj_size(void *o) {
     if (o == NULL) { return 0; }
 
@@ -128,15 +285,249 @@ void pool_return_obj(void *o) {
         return;
     }
 
-    memset(o, 0, m->size);
+    memset(o, 0, pool->clear_size ? pool->clear_size : m->size);
     pool->out--;
 
     if (pool->is_closed) {
-        free(m);
+        if (!m->in_slab) {
+            free(m);
+        }
         if (pool->out == 0) {
-            free(pool);
+            pool_free(pool);
         }
     } else {
-        LIST_INSERT_HEAD(&pool->pool, m, _next);
+        pool->free_stack[pool->free_count++] = m;
+    }
+}
+
+#define MT_MAG_SIZE 32
+// magazines set aside for thread caches, in addition to those needed to hold [capacity] objects
+#define MT_CACHE_MAGS 32
+#define MT_NONE UINT32_MAX
+
+struct mt_obj_s {
+    mt_pool_t *pool;
+    size_t size;
+    char obj[];
+};
+
+struct mt_mag_s {
+    uint32_t next; // index + 1 of the next magazine in depot stack
+    uint32_t count;
+    struct mt_obj_s *objs[MT_MAG_SIZE];
+};
+
+struct mt_cache_s {
+    mt_pool_t *pool;
+    uint32_t loaded;
+    uint32_t prev;
+    uint64_t hits;
+    uint64_t misses;
+};
+
+struct mt_pool_s {
+    size_t objsize;
+
+    struct mt_mag_s *mags;
+    uint32_t num_mags;
+
+    // depot: stacks of magazines, head is (ABA tag << 32 | magazine index + 1)
+    tagged_head_t full;
+    tagged_head_t empty;
+
+    // thread cache is returned to depot when its thread exits, see mt_cache_release()
+    cache_key_t cache_key;
+    bool destroying;
+    // guards list of thread caches, taken once per thread and for stats
+    uv_mutex_t lock;
+    struct mt_cache_s **caches;
+    size_t num_caches;
+    // stats of released caches
+    uint64_t released_hits;
+    uint64_t released_misses;
+};
+
+static void depot_push(mt_pool_t *p, tagged_head_t *head, uint32_t idx) {
+    uint64_t old = head_load(head);
+    uint64_t new;
+    do {
+        p->mags[idx].next = (uint32_t) old;
+        new = (((old >> 32) + 1) << 32) | (idx + 1);
+    } while (!head_cas(head, old, new) && ((old = head_load(head)), true));
+}
+
+static uint32_t depot_pop(mt_pool_t *p, tagged_head_t *head) {
+    uint64_t old = head_load(head);
+    uint64_t new;
+    uint32_t top;
+    do {
+        top = (uint32_t) old;
+        if (top == 0) {
+            return MT_NONE;
+        }
+        new = (((old >> 32) + 1) << 32) | p->mags[top - 1].next;
+    } while (!head_cas(head, old, new) && ((old = head_load(head)), true));
+    return top - 1;
+}
+
+// thread exit destructor: magazines (and objects in them) go back to depot, so other threads can use them
+static void CACHE_DTOR mt_cache_release(void *arg) {
+    struct mt_cache_s *c = arg;
+    mt_pool_t *p = c->pool;
+    // key is being deleted, caches are freed by mt_pool_destroy()
+    if (p->destroying) {
+        return;
+    }
+
+    uint32_t mags[] = {c->loaded, c->prev};
+    for (int i = 0; i < 2; i++) {
+        if (mags[i] != MT_NONE) {
+            depot_push(p, p->mags[mags[i]].count > 0 ? &p->full : &p->empty, mags[i]);
+        }
+    }
+
+    uv_mutex_lock(&p->lock);
+    for (size_t i = 0; i < p->num_caches; i++) {
+        if (p->caches[i] == c) {
+            p->caches[i] = p->caches[--p->num_caches];
+            break;
+        }
+    }
+    p->released_hits += c->hits;
+    p->released_misses += c->misses;
+    uv_mutex_unlock(&p->lock);
+    free(c);
+}
+
+static struct mt_cache_s *mt_cache(mt_pool_t *p) {
+    struct mt_cache_s *c = cache_key_get(&p->cache_key);
+    if (c == NULL) {
+        c = calloc(1, sizeof(*c));
+        c->pool = p;
+        c->loaded = depot_pop(p, &p->empty);
+        c->prev = depot_pop(p, &p->empty);
+        cache_key_set(&p->cache_key, c);
+
+        uv_mutex_lock(&p->lock);
+        p->caches = realloc(p->caches, (p->num_caches + 1) * sizeof(c));
+        p->caches[p->num_caches++] = c;
+        uv_mutex_unlock(&p->lock);
+    }
+    return c;
+}
+
+mt_pool_t *mt_pool_new(size_t objsize, size_t capacity) {
+    mt_pool_t *p = calloc(1, sizeof(mt_pool_t));
+    p->objsize = objsize;
+    p->num_mags = (uint32_t) ((capacity + MT_MAG_SIZE - 1) / MT_MAG_SIZE + MT_CACHE_MAGS);
+    p->mags = calloc(p->num_mags, sizeof(struct mt_mag_s));
+    cache_key_create(&p->cache_key, mt_cache_release);
+    uv_mutex_init(&p->lock);
+
+    for (uint32_t i = 0; i < p->num_mags; i++) {
+        depot_push(p, &p->empty, i);
+    }
+    return p;
+}
+
+void mt_pool_destroy(mt_pool_t *p) {
+    if (p == NULL) {
+        return;
+    }
+
+    p->destroying = true;
+    cache_key_delete(&p->cache_key);
+    for (uint32_t i = 0; i < p->num_mags; i++) {
+        struct mt_mag_s *mag = &p->mags[i];
+        while (mag->count > 0) {
+            free(mag->objs[--mag->count]);
+        }
     }
-}
\ No newline at end of file
+    for (size_t i = 0; i < p->num_caches; i++) {
+        free(p->caches[i]);
+    }
+    free(p->caches);
+    free(p->mags);
+    uv_mutex_destroy(&p->lock);
+    free(p);
+}
+
+void *mt_pool_alloc(mt_pool_t *p) {
+    struct mt_cache_s *c = mt_cache(p);
+    if (c->loaded != MT_NONE) {
+        if (p->mags[c->loaded].count == 0) {
+            if (c->prev != MT_NONE && p->mags[c->prev].count > 0) {
+                uint32_t tmp = c->loaded;
+                c->loaded = c->prev;
+                c->prev = tmp;
+            } else {
+                uint32_t full = depot_pop(p, &p->full);
+                if (full != MT_NONE) {
+                    depot_push(p, &p->empty, c->loaded);
+                    c->loaded = full;
+                }
+            }
+        }
+
+        struct mt_mag_s *mag = &p->mags[c->loaded];
+        if (mag->count > 0) {
+            struct mt_obj_s *o = mag->objs[--mag->count];
+            c->hits++;
+            memset(o->obj, 0, o->size);
+            return o->obj;
+        }
+    }
+
+    c->misses++;
+    struct mt_obj_s *o = calloc(1, sizeof(struct mt_obj_s) + p->objsize);
+    o->pool = p;
+    o->size = p->objsize;
+    return o->obj;
+}
+
+void mt_pool_free(void *obj) {
+    if (obj == NULL) {
+        return;
+    }
+
+    struct mt_obj_s *o = container_of((char *) obj, struct mt_obj_s, obj);
+    mt_pool_t *p = o->pool;
+    struct mt_cache_s *c = mt_cache(p);
+    if (c->loaded != MT_NONE) {
+        if (p->mags[c->loaded].count == MT_MAG_SIZE) {
+            if (c->prev != MT_NONE && p->mags[c->prev].count < MT_MAG_SIZE) {
+                uint32_t tmp = c->loaded;
+                c->loaded = c->prev;
+                c->prev = tmp;
+            } else {
+                uint32_t empty = depot_pop(p, &p->empty);
+                if (empty != MT_NONE) {
+                    depot_push(p, &p->full, c->loaded);
+                    c->loaded = empty;
+                }
+            }
+        }
+
+        struct mt_mag_s *mag = &p->mags[c->loaded];
+        if (mag->count < MT_MAG_SIZE) {
+            mag->objs[mag->count++] = o;
+            return;
+        }
+    }
+
+    // depot is full
+    free(o);
+}
+
+void mt_pool_stats(mt_pool_t *p, uint64_t *hits, uint64_t *misses) {
+    uv_mutex_lock(&p->lock);
+    uint64_t h = p->released_hits, m = p->released_misses;
+    for (size_t i = 0; i < p->num_caches; i++) {
+        h += p->caches[i]->hits;
+        m += p->caches[i]->misses;
+    }
+    uv_mutex_unlock(&p->lock);
+
+    if (hits) *hits = h;
+    if (misses) *misses = m;
+}
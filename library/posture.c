@@ -14,6 +14,7 @@
 
 #include "posture.h"
 #include <utils.h>
+#include <inttypes.h>
 
 #if _WIN32
 #include <winnt.h>
@@ -40,10 +41,16 @@
 #define NANOS(s) ((s) * 1e9)
 #define MILLIS(s) ((s) * 1000)
 
-const int NO_TIMEOUTS = -1;
+// posture data is still collected this often when change notifications cover it
+#define PR_SAFETY_INTERVAL MILLIS(10 * 60)
+
+// coalesce bursts of change notifications
+#define PR_CHANGE_DELAY 500
 
-const bool IS_ERRORED = true;
-const bool IS_NOT_ERRORED = false;
+// all posture responses are resubmitted this often, even if they did not change
+#define PR_FULL_RESYNC_INTERVAL MILLIS(60 * 60)
+
+const int NO_TIMEOUTS = -1;
 
 struct query_info {
     ziti_service *service;
@@ -54,16 +61,33 @@ struct query_info {
 struct pr_info_s {
     char *id;
     char *obj;
-    bool should_send;
+    // last response accepted by controller
+    char *acked;
     bool pending;
     bool obsolete;
 };
 
 typedef struct pr_info_s pr_info;
 
+// responses in a submission: map<id, obj>
 struct pr_cb_ctx_s {
     ziti_context ztx;
-    pr_info *info;
+    model_map sent;
+};
+
+// file identity, hash is reused until any of these change
+struct file_stamp {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    uv_timespec_t mtime;
+};
+
+struct process_hash {
+    struct file_stamp stamp;
+    char *sha512;
+    char **signers;
+    int num_signers;
 };
 
 struct process_work {
@@ -74,6 +98,11 @@ struct process_work {
     ziti_context ztx;
     ziti_pr_process_cb cb;
 
+    // stamp of the cached hash (if any) on input, current file stamp on output
+    bool has_stamp;
+    struct file_stamp stamp;
+    bool use_cached;
+
     bool is_running;
     char *sha512;
     char **signers;
@@ -100,8 +129,6 @@ static void ziti_pr_send_bulk(ziti_context ztx);
 
 static void ziti_pr_send_individually(ziti_context ztx);
 
-static bool ziti_pr_is_info_errored(ziti_context ztx, const char *id);
-
 static void default_pq_os(ziti_context ztx, const char *id, ziti_pr_os_cb response_cb);
 
 static void default_pq_mac(ziti_context ztx, const char *id, ziti_pr_mac_cb response_cb);
@@ -116,14 +143,38 @@ static int hash_sha512(ziti_context ztx, uv_loop_t *loop, const char *path, unsi
 
 static bool check_running(uv_loop_t *loop, const char *path);
 
+static void free_signers(char **signers, int num_signers) {
+    if (signers) {
+        for (int i = 0; i < num_signers; i++) {
+            free(signers[i]);
+        }
+        free(signers);
+    }
+}
+
+static void free_process_hash(struct process_hash *ph) {
+    FREE(ph->sha512);
+    free_signers(ph->signers, ph->num_signers);
+    free(ph);
+}
+
+static void free_process_work(struct process_work *pcw) {
+    free(pcw->id);
+    free(pcw->path);
+    FREE(pcw->sha512);
+    free_signers(pcw->signers, pcw->num_signers);
+    free(pcw);
+}
+
 static void ziti_pr_free_pr_info(pr_info *info) {
     FREE(info->id);
     FREE(info->obj);
+    FREE(info->acked);
     FREE(info);
 }
 
 static void ziti_pr_free_pr_cb_ctx(pr_cb_ctx *ctx) {
-    ziti_pr_free_pr_info(ctx->info);
+    model_map_clear(&ctx->sent, free);
     FREE(ctx);
 }
 
@@ -135,13 +186,46 @@ void ziti_posture_init(ziti_context ztx, long interval_secs) {
         pc->previous_api_session_id = NULL;
         pc->controller_instance_id = NULL;
         pc->must_send_every_time = true;
-        pc->must_send = false;
+        pc->interval = MILLIS(interval_secs);
+
+        if (ztx->opts.pq_change_notify) {
+            pc->notify = ziti_posture_notify_start(ztx);
+        }
 
         ztx->posture_checks = pc;
     }
 
     if (!uv_is_active((uv_handle_t *) ztx->posture_checks->timer)) {
-        uv_timer_start(ztx->posture_checks->timer, ziti_pr_ticker_cb, MILLIS(1)/*fire on startup*/, MILLIS(interval_secs));
+        uv_timer_start(ztx->posture_checks->timer, ziti_pr_ticker_cb, MILLIS(1)/*fire on startup*/, ztx->posture_checks->interval);
+    }
+}
+
+void ziti_posture_changed(ziti_context ztx, const char *what) {
+    struct posture_checks *pc = ztx->posture_checks;
+    if (pc == NULL || !uv_is_active((uv_handle_t *) pc->timer)) {
+        return;
+    }
+
+    if (uv_timer_get_due_in(pc->timer) > PR_CHANGE_DELAY) {
+        ZTX_LOG(DEBUG, "posture change detected[%s]", what);
+        uv_timer_start(pc->timer, ziti_pr_ticker_cb, PR_CHANGE_DELAY, uv_timer_get_repeat(pc->timer));
+    }
+}
+
+// poll slowly if all collected posture data is covered by change notifications,
+// OS and domain do not change without a restart
+static void ziti_pr_update_interval(ziti_context ztx, bool has_mac, bool has_process) {
+    struct posture_checks *pc = ztx->posture_checks;
+    int sources = ziti_posture_notify_sources(pc->notify);
+
+    bool polled = pc->notify == NULL || pc->must_send_every_time ||
+                  (has_mac && (ztx->opts.pq_mac_cb != NULL || (sources & PC_NOTIFY_MAC) == 0)) ||
+                  (has_process && (ztx->opts.pq_process_cb != NULL || (sources & PC_NOTIFY_PROCESS) == 0));
+
+    uint64_t interval = polled ? pc->interval : PR_SAFETY_INTERVAL;
+    if (uv_timer_get_repeat(pc->timer) != interval) {
+        ZTX_LOG(DEBUG, "posture data collection interval set to %" PRIu64 "s", interval / 1000);
+        uv_timer_set_repeat(pc->timer, interval);
     }
 }
 
@@ -153,14 +237,17 @@ void ziti_posture_checks_free(struct posture_checks *pcs) {
     if (pcs != NULL) {
         uv_close((uv_handle_t *) pcs->timer, ziti_posture_checks_timer_free);
         pcs->timer = NULL;
+        ziti_posture_notify_stop(pcs->notify);
+        pcs->notify = NULL;
         model_map_clear(&pcs->responses, (_free_f) ziti_pr_free_pr_info);
-        model_map_clear(&pcs->error_states, NULL);
         model_map_iter it = model_map_iterator(&pcs->active_work);
         while (it) {
             struct process_work *pwk = model_map_it_value(it);
             pwk->canceled = true;
             it = model_map_it_remove(it);
         }
+        model_list_clear(&pcs->pending_work, (void (*)(void *)) free_process_work);
+        model_map_clear(&pcs->process_hashes, (_free_f) free_process_hash);
         FREE(pcs->previous_api_session_id);
         FREE(pcs->controller_instance_id);
         FREE(pcs);
@@ -194,6 +281,7 @@ void ziti_send_posture_data(ziti_context ztx) {
     }
 
     ZTX_LOG(VERBOSE, "starting to send posture data");
+    __attribute__((unused)) const char *name;
     bool new_session_id = ztx->posture_checks->previous_api_session_id == NULL || strcmp(ztx->posture_checks->previous_api_session_id, ztx->api_session->id) != 0;
 
     bool new_controller_instance = (ztx->posture_checks->controller_instance_id == NULL && ztx->controller.instance_id != NULL) || strcmp(ztx->posture_checks->controller_instance_id, ztx->controller.instance_id) != 0;
@@ -202,33 +290,36 @@ void ziti_send_posture_data(ziti_context ztx) {
         ZTX_LOG(INFO, "first run or potential controller restart detected");
     }
 
-    if (new_session_id || ztx->posture_checks->must_send_every_time || new_controller_instance) {
-        ZTX_LOG(DEBUG, "posture checks must_send set to TRUE, new_session_id[%s], must_send_every_time[%s], new_controller_instance[%s]",
+    uint64_t now = uv_now(ztx->loop);
+    bool resync_due = now - ztx->posture_checks->last_full_sync >= PR_FULL_RESYNC_INTERVAL;
+
+    if (new_session_id || new_controller_instance || resync_due) {
+        ZTX_LOG(DEBUG, "posture checks full resync, new_session_id[%s], new_controller_instance[%s], resync_due[%s]",
                 new_session_id ? "TRUE" : "FALSE",
-                ztx->posture_checks->must_send_every_time ? "TRUE" : "FALSE",
-                new_controller_instance ? "TRUE" : "FALSE");
+                new_controller_instance ? "TRUE" : "FALSE",
+                resync_due ? "TRUE" : "FALSE");
+
+        // controller state is unknown, forget what it has acknowledged
+        pr_info *info;
+        MODEL_MAP_FOREACH(name, info, &ztx->posture_checks->responses) {
+            FREE(info->acked);
+        }
+        ztx->posture_checks->last_full_sync = now;
 
-        ztx->posture_checks->must_send = true;
         FREE(ztx->posture_checks->previous_api_session_id);
         FREE(ztx->posture_checks->controller_instance_id);
         ztx->posture_checks->previous_api_session_id = strdup(ztx->api_session->id);
         ztx->posture_checks->controller_instance_id = strdup(ztx->controller.instance_id);
-    } else {
-        ZTX_LOG(DEBUG, "posture checks must_send set to FALSE, new_session_id[%s], must_send_every_time[%s], new_controller_instance[%s]",
-                new_session_id ? "TRUE" : "FALSE",
-                ztx->posture_checks->must_send_every_time ? "TRUE" : "FALSE",
-                new_controller_instance ? "TRUE" : "FALSE");
-
-        ztx->posture_checks->must_send = false;
     }
 
+    ztx->posture_checks->collecting = true;
+
     NEWP(domainInfo, struct query_info);
     NEWP(osInfo, struct query_info);
     NEWP(macInfo, struct query_info);
 
     struct model_map processes = {NULL};
 
-    __attribute__((unused)) const char *name;
     ziti_service *service;
 
     ZTX_LOG(VERBOSE, "checking posture queries on %zd service(s)", model_map_size(&ztx->services));
@@ -294,7 +385,7 @@ void ziti_send_posture_data(ziti_context ztx) {
     // mark responses obsolete in case they were removed
     pr_info *resp;
     MODEL_MAP_FOREACH(name, resp, &ztx->posture_checks->responses) {
-        if (!resp->pending && !resp->should_send) {
+        if (!resp->pending) {
             resp->obsolete = true;
         }
     }
@@ -381,7 +472,7 @@ void ziti_send_posture_data(ziti_context ztx) {
     while (it) {
         resp = model_map_it_value(it);
         if (resp->obsolete) {
-            ZTX_LOG(DEBUG, "removing obsolete posture resp[%s],  should_send = %s, pending = %s: %s", resp->id, resp->should_send ? "true" : "false", resp->pending ? "true" : "false", resp->obj);
+            ZTX_LOG(DEBUG, "removing obsolete posture resp[%s], pending = %s: %s", resp->id, resp->pending ? "true" : "false", resp->obj);
             it = model_map_it_remove(it);
             ziti_pr_free_pr_info(resp);
         } else {
@@ -389,12 +480,33 @@ void ziti_send_posture_data(ziti_context ztx) {
         }
     }
 
+    ziti_posture_notify_watch(ztx->posture_checks->notify, &processes);
+    ziti_pr_update_interval(ztx, macInfo->query != NULL, model_map_size(&processes) > 0);
+
     model_map_clear(&processes, free);
 
     free(domainInfo);
     free(osInfo);
     free(macInfo);
 
+    ztx->posture_checks->collecting = false;
+    ziti_pr_send(ztx);
+}
+
+// responses of asynchronous checks (e.g. started by a change notification) arrive after the tick,
+// they are submitted as soon as the last pending one is collected instead of waiting for the next tick
+static void ziti_pr_collected(ziti_context ztx) {
+    if (ztx->posture_checks->collecting || ztx->api_session_state != ZitiApiSessionStateFullyAuthenticated) {
+        return;
+    }
+
+    __attribute__((unused)) const char *key;
+    pr_info *info;
+    MODEL_MAP_FOREACH(key, info, &ztx->posture_checks->responses) {
+        if (info->pending) {
+            return;
+        }
+    }
     ziti_pr_send(ztx);
 }
 
@@ -411,19 +523,19 @@ static void ziti_collect_pr(ziti_context ztx, const char *pr_obj_key, char *pr_o
     if (current_info != NULL) {
         current_info->pending = false;
 
-        bool changed = current_info->obj == NULL || strcmp(current_info->obj, pr_obj) != 0;
-        if (changed) {
+        if (current_info->obj == NULL || strcmp(current_info->obj, pr_obj) != 0) {
             FREE(current_info->obj);
             current_info->obj = pr_obj;
         } else {
             free(pr_obj);
         }
-
-        current_info->should_send = ztx->posture_checks->must_send_every_time || ziti_pr_is_info_errored(ztx, current_info->id) || changed;
     } else {
         ZTX_LOG(WARN, "response info not found, posture check obsolete? id[%s]", pr_obj_key);
         free(pr_obj);
+        return;
     }
+
+    ziti_pr_collected(ztx);
 }
 
 static void handle_pr_resp_timer_events(ziti_context ztx, ziti_pr_response *pr_resp){
@@ -445,69 +557,103 @@ static void handle_pr_resp_timer_events(ziti_context ztx, ziti_pr_response *pr_r
     ZTX_LOG(DEBUG, "handle_pr_resp_timer_events: done");
 }
 
+// record responses accepted by controller, the rest is retried on the next tick
+static void ziti_pr_acked(ziti_context ztx, pr_cb_ctx *pr_ctx) {
+    model_map_iter it = model_map_iterator(&pr_ctx->sent);
+    while (it) {
+        pr_info *info = model_map_get(&ztx->posture_checks->responses, model_map_it_key(it));
+        char *obj = model_map_it_value(it);
+        if (info) {
+            FREE(info->acked);
+            info->acked = obj;
+        } else {
+            free(obj);
+        }
+        it = model_map_it_remove(it);
+    }
+}
+
+// data collected or changed while a submission was in flight is sent when it completes, not on the next tick
+static void ziti_pr_send_changed(ziti_context ztx) {
+    if (ztx->posture_checks->sends_in_flight > 0) {
+        return;
+    }
+
+    __attribute__((unused)) const char *key;
+    pr_info *info;
+    MODEL_MAP_FOREACH(key, info, &ztx->posture_checks->responses) {
+        if (info->obj != NULL && (info->acked == NULL || strcmp(info->obj, info->acked) != 0)) {
+            ziti_pr_send(ztx);
+            return;
+        }
+    }
+}
+
 static void ziti_pr_post_bulk_cb(ziti_pr_response *pr_resp, const ziti_error *err, void *ctx) {
-    ziti_context ztx = ctx;
+    pr_cb_ctx *pr_ctx = ctx;
+    ziti_context ztx = pr_ctx->ztx;
 
     ZTX_LOG(DEBUG, "ziti_pr_post_bulk_cb: starting");
 
     // if ztx is disabled this request is cancelled and posture_checks is cleared
     if (ztx->posture_checks) {
+        ztx->posture_checks->sends_in_flight--;
         if (err != NULL) {
             ZTX_LOG(ERROR, "error during bulk posture response submission (%d) %s", err->http_code, err->message);
-            ztx->posture_checks->must_send = true; //error, must try again
             if (err->http_code == 404) {
                 ztx->no_bulk_posture_response_api = true;
+                ziti_pr_send(ztx);
             }
         } else {
-            ztx->posture_checks->must_send = false; //did not error, can skip submissions
+            ziti_pr_acked(ztx, pr_ctx);
             handle_pr_resp_timer_events(ztx, pr_resp);
             ziti_services_refresh(ztx, true);
             ZTX_LOG(DEBUG, "done with bulk posture response submission");
+            ziti_pr_send_changed(ztx);
         }
     }
 
+    ziti_pr_free_pr_cb_ctx(pr_ctx);
     free_ziti_pr_response_ptr(pr_resp);
 }
 
-static void ziti_pr_set_info_errored(ziti_context ztx, const char *id) {
-    model_map_set(&ztx->posture_checks->error_states, id, (void *) &IS_ERRORED);
-}
-
-static void ziti_pr_set_info_success(ziti_context ztx, const char *id) {
-    model_map_set(&ztx->posture_checks->error_states, id, (void *) &IS_NOT_ERRORED);
-}
-
-static bool ziti_pr_is_info_errored(ziti_context ztx, const char *id) {
-    bool *is_errored = model_map_get(&ztx->posture_checks->error_states, id);
-    if (is_errored == NULL) {
-        return false;
-    }
-
-    return *is_errored;
-}
-
 static void ziti_pr_post_cb(ziti_pr_response *pr_resp, const ziti_error *err, void *ctx) {
     pr_cb_ctx *pr_ctx = ctx;
     ziti_context ztx = pr_ctx->ztx;
 
     ZTX_LOG(DEBUG, "ziti_pr_post_cb: starting");
 
-    if (err != NULL) {
-        ZTX_LOG(ERROR, "error during individual posture response submission (%d) %s - object: %s", err->http_code,
-                 err->message, pr_ctx->info->obj);
-        ziti_pr_set_info_errored(pr_ctx->ztx, pr_ctx->info->id);
-    } else {
-        ziti_pr_set_info_success(pr_ctx->ztx, pr_ctx->info->id);
-        handle_pr_resp_timer_events(ztx, pr_resp);
-        ziti_services_refresh(ztx, true);
-        ZTX_LOG(TRACE, "done with one pr response submission, object: %s", pr_ctx->info->obj);
+    if (ztx->posture_checks) {
+        ztx->posture_checks->sends_in_flight--;
+        if (err != NULL) {
+            ZTX_LOG(ERROR, "error during individual posture response submission (%d) %s", err->http_code,
+                    err->message);
+        } else {
+            ziti_pr_acked(ztx, pr_ctx);
+            handle_pr_resp_timer_events(ztx, pr_resp);
+            ziti_services_refresh(ztx, true);
+            ZTX_LOG(TRACE, "done with one pr response submission");
+            ziti_pr_send_changed(ztx);
+        }
     }
 
-    ziti_pr_free_pr_cb_ctx(ctx);
+    ziti_pr_free_pr_cb_ctx(pr_ctx);
     free_ziti_pr_response_ptr(pr_resp);
 }
 
+static bool ziti_pr_needs_send(ziti_context ztx, const pr_info *info) {
+    if (info->obj == NULL) {
+        return false;
+    }
+    return ztx->posture_checks->must_send_every_time || info->acked == NULL || strcmp(info->obj, info->acked) != 0;
+}
+
 static void ziti_pr_send(ziti_context ztx) {
+    if (ztx->posture_checks->sends_in_flight > 0) {
+        ZTX_LOG(VERBOSE, "previous posture submission is not complete");
+        return;
+    }
+
     if (ztx->no_bulk_posture_response_api) {
         ziti_pr_send_individually(ztx);
     } else {
@@ -515,54 +661,60 @@ static void ziti_pr_send(ziti_context ztx) {
     }
 }
 
+// one request with responses that changed since controller acknowledged them
 static void ziti_pr_send_bulk(ziti_context ztx) {
     size_t body_len = 0;
     char *body;
 
-    bool send = false;
     __attribute__((unused)) const char *key;
     pr_info *info;
+
+    size_t body_size = 2;
+    int obj_count = 0;
     MODEL_MAP_FOREACH(key, info, &ztx->posture_checks->responses) {
-        if (info->should_send) {
-            send = true;
-            break;
+        if (ziti_pr_needs_send(ztx, info)) {
+            body_size += strlen(info->obj) + 1;
+            obj_count++;
         }
     }
 
-    if (!send) {
+    if (obj_count == 0) {
         ZTX_LOG(VERBOSE, "no change in posture data, not sending");
         return; //nothing to send
     }
 
+    NEWP(pr_ctx, pr_cb_ctx);
+    pr_ctx->ztx = ztx;
+
+    // body is assembled in a single allocation that is handed to the request
     string_buf_t buf;
-    string_buf_init(&buf);
+    string_buf_init_sized(&buf, body_size + 1);
     string_buf_append_byte(&buf, '[');
 
     bool needs_comma = false;
-    int obj_count = 0;
     MODEL_MAP_FOREACH(key, info, &ztx->posture_checks->responses) {
-        if (info->should_send) {
-            ZTX_LOG(VERBOSE, "sending posture response [%s], should_send = true: %s", info->id, info->obj);
-            obj_count++;
+        if (ziti_pr_needs_send(ztx, info)) {
+            ZTX_LOG(VERBOSE, "sending posture response [%s]: %s", info->id, info->obj);
             if (needs_comma) {
                 string_buf_append_byte(&buf, ',');
             } else {
                 needs_comma = true;
             }
             string_buf_append(&buf, info->obj);
-            info->should_send = false;
+            model_map_set(&pr_ctx->sent, info->id, strdup(info->obj));
         } else {
-            ZTX_LOG(VERBOSE, "not sending posture response [%s], should_send = false, pending = %s: %s", info->id, info->pending ? "true" : "false", info->obj);
+            ZTX_LOG(VERBOSE, "not sending posture response [%s], pending = %s: %s", info->id, info->pending ? "true" : "false", info->obj);
         }
     }
 
     string_buf_append_byte(&buf, ']');
 
     body = string_buf_to_string(&buf, &body_len);
-    ZTX_LOG(DEBUG, "sending posture responses [%d]", obj_count);
+    ZTX_LOG(DEBUG, "sending posture responses [%d of %zd]", obj_count, model_map_size(&ztx->posture_checks->responses));
     ZTX_LOG(TRACE, "bulk posture response: %s", body);
 
-    ziti_pr_post_bulk(&ztx->controller, body, body_len, ziti_pr_post_bulk_cb, ztx);
+    ztx->posture_checks->sends_in_flight++;
+    ziti_pr_post_bulk(&ztx->controller, body, body_len, ziti_pr_post_bulk_cb, pr_ctx);
     string_buf_free(&buf);
 }
 
@@ -572,21 +724,15 @@ static void ziti_pr_send_individually(ziti_context ztx) {
     pr_info *info;
 
     MODEL_MAP_FOREACH(key, info, &ztx->posture_checks->responses) {
-        if (info->should_send) {
+        if (ziti_pr_needs_send(ztx, info)) {
             char *body = strdup(info->obj);
 
-            NEWP(new_info, pr_info);
-            memcpy(new_info, info, sizeof(pr_info));
-
-            new_info->id = strdup(info->id);
-            new_info->obj = strdup(info->obj);
-
             NEWP(cb_ctx, pr_cb_ctx);
-            cb_ctx->info = new_info;
             cb_ctx->ztx = ztx;
+            model_map_set(&cb_ctx->sent, info->id, strdup(info->obj));
 
+            ztx->posture_checks->sends_in_flight++;
             ziti_pr_post(&ztx->controller, body, strlen(body), ziti_pr_post_cb, cb_ctx);
-            info->should_send = false;
         }
     }
 }
@@ -783,24 +929,70 @@ static void default_pq_domain(ziti_context ztx, const char *id, ziti_pr_domain_c
 
 static void process_check_work(uv_work_t *w);
 
+static void process_check_done(uv_work_t *w, int status);
+
+static void start_process_work(ziti_context ztx) {
+    struct posture_checks *pcs = ztx->posture_checks;
+    while (model_list_size(&pcs->pending_work) > 0 &&
+           (ztx->opts.pq_process_jobs == 0 || model_map_size(&pcs->active_work) < ztx->opts.pq_process_jobs)) {
+        struct process_work *wr = model_list_pop(&pcs->pending_work);
+
+        struct process_hash *ph = model_map_get(&pcs->process_hashes, wr->path);
+        if (ph) {
+            wr->has_stamp = true;
+            wr->stamp = ph->stamp;
+        }
+
+        model_map_set_key(&pcs->active_work, &wr, sizeof(uintptr_t), wr);
+        uv_queue_work(ztx->loop, &wr->w, process_check_work, process_check_done);
+    }
+}
+
 static void process_check_done(uv_work_t *w, int status) {
     struct process_work *pcw = container_of(w, struct process_work, w);
     if (!pcw->canceled) {
-        model_map_remove_key(&pcw->ztx->posture_checks->active_work, &pcw, sizeof(uintptr_t));
-        pcw->cb(pcw->ztx, pcw->id, pcw->path, pcw->is_running, pcw->sha512, pcw->signers, pcw->num_signers);
+        ziti_context ztx = pcw->ztx;
+        struct posture_checks *pcs = ztx->posture_checks;
+        model_map_remove_key(&pcs->active_work, &pcw, sizeof(uintptr_t));
+
+        struct process_hash *ph = model_map_get(&pcs->process_hashes, pcw->path);
+        if (pcw->use_cached && ph) {
+            ZITI_LOG(VERBOSE, "file(%s) is not changed, using cached hash", pcw->path);
+            pcw->cb(ztx, pcw->id, pcw->path, pcw->is_running, ph->sha512, ph->signers, ph->num_signers);
+        } else {
+            if (pcw->has_stamp && pcw->sha512) {
+                if (ph == NULL) {
+                    ph = calloc(1, sizeof(*ph));
+                    model_map_set(&pcs->process_hashes, pcw->path, ph);
+                } else {
+                    FREE(ph->sha512);
+                    free_signers(ph->signers, ph->num_signers);
+                }
+                ph->stamp = pcw->stamp;
+                ph->sha512 = pcw->sha512;
+                ph->signers = pcw->signers;
+                ph->num_signers = pcw->num_signers;
+                pcw->sha512 = NULL;
+                pcw->signers = NULL;
+                pcw->num_signers = 0;
+            } else if (ph != NULL) {
+                // file is gone or could not be hashed
+                free_process_hash(model_map_remove(&pcs->process_hashes, pcw->path));
+                ph = NULL;
+            }
+
+            if (ph) {
+                pcw->cb(ztx, pcw->id, pcw->path, pcw->is_running, ph->sha512, ph->signers, ph->num_signers);
+            } else {
+                pcw->cb(ztx, pcw->id, pcw->path, pcw->is_running, pcw->sha512, pcw->signers, pcw->num_signers);
+            }
+        }
+
+        start_process_work(ztx);
     } else {
         ZITI_LOG(INFO, "process check path[%s] was cancelled", pcw->path);
     }
-    free(pcw->id);
-    free(pcw->path);
-    FREE(pcw->sha512);
-    if (pcw->signers) {
-        for (int i = 0; i < pcw->num_signers; i++) {
-            free(pcw->signers[i]);
-        }
-        free(pcw->signers);
-    }
-    free(pcw);
+    free_process_work(pcw);
 }
 
 bool ziti_service_has_query_with_timeout(ziti_service *service) {
@@ -825,14 +1017,19 @@ bool ziti_service_has_query_with_timeout(ziti_service *service) {
     return false;
 }
 
+static bool same_stamp(const struct file_stamp *l, const struct file_stamp *r) {
+    return l->dev == r->dev && l->ino == r->ino && l->size == r->size &&
+           l->mtime.tv_sec == r->mtime.tv_sec && l->mtime.tv_nsec == r->mtime.tv_nsec;
+}
+
 static void default_pq_process(ziti_context ztx, const char *id, const char *path, ziti_pr_process_cb cb) {
     NEWP(wr, struct process_work);
     wr->id = strdup(id);
     wr->path = strdup(path);
     wr->cb = cb;
     wr->ztx = ztx;
-    model_map_set_key(&ztx->posture_checks->active_work, &wr, sizeof(uintptr_t), wr);
-    uv_queue_work(ztx->loop, &wr->w, process_check_work, process_check_done);
+    model_list_append(&ztx->posture_checks->pending_work, wr);
+    start_process_work(ztx);
 }
 
 static void process_check_work(uv_work_t *w) {
@@ -845,10 +1042,27 @@ static void process_check_work(uv_work_t *w) {
     uv_fs_t file;
     int rc = uv_fs_stat(w->loop, &file, path, NULL);
     if (rc != 0) {
+        uv_fs_req_cleanup(&file);
+        pcw->has_stamp = false;
         return;
     }
 
+    struct file_stamp stamp = {
+            .dev = file.statbuf.st_dev,
+            .ino = file.statbuf.st_ino,
+            .size = file.statbuf.st_size,
+            .mtime = file.statbuf.st_mtim,
+    };
+    uv_fs_req_cleanup(&file);
+
     pcw->is_running = check_running(w->loop, path);
+    pcw->use_cached = pcw->has_stamp && same_stamp(&stamp, &pcw->stamp);
+    pcw->has_stamp = true;
+    pcw->stamp = stamp;
+    if (pcw->use_cached) {
+        return;
+    }
+
     if (hash_sha512(ztx, w->loop, path, &digest, &digest_len) == 0) {
         hexify(digest, digest_len, 0, &pcw->sha512);
         ZITI_LOG(VERBOSE, "file(%s) hash = %s", path, pcw->sha512);
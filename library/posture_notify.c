@@ -0,0 +1,438 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// OS notification sources for posture data changes:
+//  - MAC addresses: netlink(Linux), routing socket(macOS/BSD), NotifyIpInterfaceChange(Windows)
+//  - process start/exit: netlink process connector(Linux, requires CAP_NET_ADMIN)
+// posture data not covered by an active source is still polled
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "posture.h"
+#include "utils.h"
+
+#if _WIN32
+#include <winsock2.h>
+#include <iphlpapi.h>
+#elif __linux || __linux__
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include <linux/rtnetlink.h>
+#include <linux/connector.h>
+#include <linux/cn_proc.h>
+#elif __APPLE__ || __FreeBSD__ || __OpenBSD__ || __NetBSD__
+#include <unistd.h>
+#include <errno.h>
+#include <sys/socket.h>
+#include <net/if.h>
+#include <net/route.h>
+#define ROUTE_SOCKET 1
+#endif
+
+#if !_WIN32
+// poll handle and the descriptor it owns, descriptor is closed once the handle is closed
+struct notify_poll {
+    uv_poll_t poll;
+    uv_os_fd_t fd;
+};
+#endif
+
+struct posture_notify {
+    ziti_context ztx;
+    int sources;
+    int open_handles;
+
+#if _WIN32
+    HANDLE mac_handle;
+    uv_async_t mac_async;
+#elif __linux || __linux__
+    struct notify_poll mac_poll;
+    struct notify_poll proc_poll;
+
+    // watched process paths: map<path, path>
+    model_map paths;
+    // watched processes seen running: map<pid, path>
+    model_map pids;
+#elif ROUTE_SOCKET
+    struct notify_poll mac_poll;
+#endif
+};
+
+static void notify_close_cb(uv_handle_t *h) {
+    struct posture_notify *pn = h->data;
+    if (--pn->open_handles == 0) {
+#if __linux || __linux__
+        model_map_clear(&pn->paths, free);
+        model_map_clear(&pn->pids, free);
+#endif
+        free(pn);
+    }
+}
+
+#if !_WIN32
+static void poll_close_cb(uv_handle_t *h) {
+    struct notify_poll *np = (struct notify_poll *) h;
+    close(np->fd);
+    notify_close_cb(h);
+}
+
+static void close_poll(struct posture_notify *pn, struct notify_poll *np) {
+    uv_poll_stop(&np->poll);
+    uv_close((uv_handle_t *) &np->poll, poll_close_cb);
+}
+
+static int start_poll(struct posture_notify *pn, struct notify_poll *np, int fd, uv_poll_cb cb) {
+    int rc = uv_poll_init(pn->ztx->loop, &np->poll, fd);
+    if (rc != 0) {
+        close(fd);
+        return rc;
+    }
+    np->fd = fd;
+    np->poll.data = pn;
+    pn->open_handles++;
+    uv_unref((uv_handle_t *) &np->poll);
+    rc = uv_poll_start(&np->poll, UV_READABLE, cb);
+    if (rc != 0) {
+        close_poll(pn, np);
+    }
+    return rc;
+}
+#endif
+
+#if _WIN32
+static void mac_async_cb(uv_async_t *a) {
+    struct posture_notify *pn = a->data;
+    ziti_posture_changed(pn->ztx, PC_MAC_TYPE);
+}
+
+// called on a system thread
+static void CALLBACK ip_interface_change_cb(PVOID ctx, PMIB_IPINTERFACE_ROW row, MIB_NOTIFICATION_TYPE type) {
+    struct posture_notify *pn = ctx;
+    uv_async_send(&pn->mac_async);
+}
+
+static int start_mac_notify(struct posture_notify *pn) {
+    ziti_context ztx = pn->ztx;
+    if (uv_async_init(pn->ztx->loop, &pn->mac_async, mac_async_cb) != 0) {
+        return -1;
+    }
+    pn->mac_async.data = pn;
+    pn->open_handles++;
+    uv_unref((uv_handle_t *) &pn->mac_async);
+
+    DWORD rc = NotifyIpInterfaceChange(AF_UNSPEC, ip_interface_change_cb, pn, FALSE, &pn->mac_handle);
+    if (rc != NO_ERROR) {
+        ZTX_LOG(DEBUG, "NotifyIpInterfaceChange failed: %lu", rc);
+        uv_close((uv_handle_t *) &pn->mac_async, notify_close_cb);
+        return -1;
+    }
+    return 0;
+}
+
+static void stop_notify(struct posture_notify *pn) {
+    if (pn->sources & PC_NOTIFY_MAC) {
+        // waits for callbacks in progress
+        CancelMibChangeNotify2(pn->mac_handle);
+        uv_close((uv_handle_t *) &pn->mac_async, notify_close_cb);
+    }
+}
+
+#elif __linux || __linux__
+
+static void mac_notify_cb(uv_poll_t *p, int status, int events) {
+    struct posture_notify *pn = p->data;
+    uv_os_fd_t fd;
+    uv_fileno((uv_handle_t *) p, &fd);
+
+    char buf[8 * 1024];
+    bool changed = false;
+    ssize_t len;
+    while ((len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        for (struct nlmsghdr *nh = (struct nlmsghdr *) buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type == RTM_NEWLINK || nh->nlmsg_type == RTM_DELLINK) {
+                changed = true;
+            }
+        }
+    }
+
+    if (changed) {
+        ziti_posture_changed(pn->ztx, PC_MAC_TYPE);
+    }
+}
+
+static int start_mac_notify(struct posture_notify *pn) {
+    ziti_context ztx = pn->ztx;
+    int fd = socket(AF_NETLINK, SOCK_RAW | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_ROUTE);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_nl addr = {
+            .nl_family = AF_NETLINK,
+            .nl_groups = RTMGRP_LINK,
+    };
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        ZTX_LOG(DEBUG, "failed to subscribe to link changes: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return start_poll(pn, &pn->mac_poll, fd, mac_notify_cb);
+}
+
+static char *process_exe(int pid) {
+    char proc_path[64];
+    snprintf(proc_path, sizeof(proc_path), "/proc/%d/exe", pid);
+    uv_fs_t ex;
+    char *exe = NULL;
+    if (uv_fs_readlink(NULL, &ex, proc_path, NULL) == 0) {
+        exe = strdup((const char *) ex.ptr);
+    }
+    uv_fs_req_cleanup(&ex);
+    return exe;
+}
+
+static void proc_notify_cb(uv_poll_t *p, int status, int events) {
+    struct posture_notify *pn = p->data;
+    ziti_context ztx = pn->ztx;
+    uv_os_fd_t fd;
+    uv_fileno((uv_handle_t *) p, &fd);
+
+    char buf[8 * 1024];
+    const char *changed = NULL;
+    ssize_t len;
+    while ((len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        for (struct nlmsghdr *nh = (struct nlmsghdr *) buf; NLMSG_OK(nh, len); nh = NLMSG_NEXT(nh, len)) {
+            if (nh->nlmsg_type != NLMSG_DONE) {
+                continue;
+            }
+            struct cn_msg *msg = NLMSG_DATA(nh);
+            struct proc_event *ev = (struct proc_event *) msg->data;
+            char pid_key[16];
+
+            if (ev->what == PROC_EVENT_EXEC) {
+                int pid = ev->event_data.exec.process_tgid;
+                if (pid != ev->event_data.exec.process_pid || model_map_size(&pn->paths) == 0) {
+                    continue;
+                }
+                char *exe = process_exe(pid);
+                if (exe && model_map_get(&pn->paths, exe)) {
+                    snprintf(pid_key, sizeof(pid_key), "%d", pid);
+                    free(model_map_set(&pn->pids, pid_key, exe));
+                    changed = model_map_get(&pn->paths, exe);
+                    ZTX_LOG(VERBOSE, "watched process[%s] started pid[%d]", exe, pid);
+                } else {
+                    free(exe);
+                }
+            } else if (ev->what == PROC_EVENT_EXIT) {
+                int pid = ev->event_data.exit.process_tgid;
+                if (pid != ev->event_data.exit.process_pid) {
+                    continue;
+                }
+                snprintf(pid_key, sizeof(pid_key), "%d", pid);
+                char *exe = model_map_remove(&pn->pids, pid_key);
+                if (exe) {
+                    ZTX_LOG(VERBOSE, "watched process[%s] exited pid[%d]", exe, pid);
+                    changed = model_map_get(&pn->paths, exe);
+                    free(exe);
+                }
+            }
+        }
+    }
+
+    if (changed) {
+        ziti_posture_changed(pn->ztx, changed);
+    }
+}
+
+static int start_proc_notify(struct posture_notify *pn) {
+    ziti_context ztx = pn->ztx;
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, NETLINK_CONNECTOR);
+    if (fd < 0) {
+        return -1;
+    }
+
+    struct sockaddr_nl addr = {
+            .nl_family = AF_NETLINK,
+            .nl_groups = CN_IDX_PROC,
+    };
+
+    struct {
+        struct nlmsghdr nh;
+        struct cn_msg msg;
+        enum proc_cn_mcast_op op;
+    } __attribute__((packed)) req = {
+            .nh = {
+                    .nlmsg_len = sizeof(req),
+                    .nlmsg_type = NLMSG_DONE,
+                    .nlmsg_pid = getpid(),
+            },
+            .msg = {
+                    .id = {.idx = CN_IDX_PROC, .val = CN_VAL_PROC},
+                    .len = sizeof(enum proc_cn_mcast_op),
+            },
+            .op = PROC_CN_MCAST_LISTEN,
+    };
+
+    // not permitted without CAP_NET_ADMIN
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0 ||
+        send(fd, &req, sizeof(req), 0) != sizeof(req)) {
+        ZTX_LOG(DEBUG, "process events are not available: %s", strerror(errno));
+        close(fd);
+        return -1;
+    }
+    return start_poll(pn, &pn->proc_poll, fd, proc_notify_cb);
+}
+
+static void stop_notify(struct posture_notify *pn) {
+    if (pn->sources & PC_NOTIFY_MAC) {
+        close_poll(pn, &pn->mac_poll);
+    }
+    if (pn->sources & PC_NOTIFY_PROCESS) {
+        close_poll(pn, &pn->proc_poll);
+    }
+}
+
+#elif ROUTE_SOCKET
+
+static void mac_notify_cb(uv_poll_t *p, int status, int events) {
+    struct posture_notify *pn = p->data;
+    uv_os_fd_t fd;
+    uv_fileno((uv_handle_t *) p, &fd);
+
+    char buf[8 * 1024];
+    bool changed = false;
+    ssize_t len;
+    while ((len = recv(fd, buf, sizeof(buf), MSG_DONTWAIT)) > 0) {
+        struct rt_msghdr *rtm = (struct rt_msghdr *) buf;
+        if ((size_t) len >= sizeof(*rtm) && (rtm->rtm_type == RTM_IFINFO
+#ifdef RTM_IFANNOUNCE
+                                             || rtm->rtm_type == RTM_IFANNOUNCE
+#endif
+        )) {
+            changed = true;
+        }
+    }
+
+    if (changed) {
+        ziti_posture_changed(pn->ztx, PC_MAC_TYPE);
+    }
+}
+
+static int start_mac_notify(struct posture_notify *pn) {
+    int fd = socket(PF_ROUTE, SOCK_RAW, AF_UNSPEC);
+    if (fd < 0) {
+        return -1;
+    }
+    return start_poll(pn, &pn->mac_poll, fd, mac_notify_cb);
+}
+
+static void stop_notify(struct posture_notify *pn) {
+    if (pn->sources & PC_NOTIFY_MAC) {
+        close_poll(pn, &pn->mac_poll);
+    }
+}
+
+#else
+
+static int start_mac_notify(struct posture_notify *pn) {
+    return -1;
+}
+
+static void stop_notify(struct posture_notify *pn) {}
+
+#endif
+
+#if !(__linux || __linux__)
+static int start_proc_notify(struct posture_notify *pn) {
+    return -1;
+}
+#endif
+
+struct posture_notify *ziti_posture_notify_start(ziti_context ztx) {
+    NEWP(pn, struct posture_notify);
+    pn->ztx = ztx;
+
+    if (start_mac_notify(pn) == 0) {
+        pn->sources |= PC_NOTIFY_MAC;
+    }
+    if (start_proc_notify(pn) == 0) {
+        pn->sources |= PC_NOTIFY_PROCESS;
+    }
+
+    ZTX_LOG(DEBUG, "posture change notifications: mac[%s] process[%s]",
+            pn->sources & PC_NOTIFY_MAC ? "on" : "off",
+            pn->sources & PC_NOTIFY_PROCESS ? "on" : "off");
+
+    if (pn->open_handles == 0) {
+        free(pn);
+        return NULL;
+    }
+    return pn;
+}
+
+int ziti_posture_notify_sources(const struct posture_notify *pn) {
+    return pn ? pn->sources : 0;
+}
+
+void ziti_posture_notify_watch(struct posture_notify *pn, model_map *processes) {
+#if __linux || __linux__
+    if (pn == NULL || (pn->sources & PC_NOTIFY_PROCESS) == 0) {
+        return;
+    }
+
+    bool same = model_map_size(processes) == model_map_size(&pn->paths);
+    const char *path;
+    __attribute__((unused)) void *v;
+    MODEL_MAP_FOREACH(path, v, processes) {
+        if (!same) break;
+        same = model_map_get(&pn->paths, path) != NULL;
+    }
+    if (same) {
+        return;
+    }
+
+    model_map_clear(&pn->paths, free);
+    model_map_clear(&pn->pids, free);
+    MODEL_MAP_FOREACH(path, v, processes) {
+        model_map_set(&pn->paths, path, strdup(path));
+    }
+
+    // find watched processes that were started before we started listening
+    uv_fs_t fs_proc;
+    uv_dirent_t de;
+    if (uv_fs_scandir(NULL, &fs_proc, "/proc", 0, NULL) >= 0) {
+        while (uv_fs_scandir_next(&fs_proc, &de) != UV_EOF) {
+            if (de.type != UV_DIRENT_DIR || de.name[0] < '1' || de.name[0] > '9') {
+                continue;
+            }
+            char *exe = process_exe(atoi(de.name));
+            if (exe && model_map_get(&pn->paths, exe)) {
+                model_map_set(&pn->pids, de.name, exe);
+            } else {
+                free(exe);
+            }
+        }
+    }
+    uv_fs_req_cleanup(&fs_proc);
+#endif
+}
+
+void ziti_posture_notify_stop(struct posture_notify *pn) {
+    if (pn) {
+        stop_notify(pn);
+    }
+}
@@ -0,0 +1,154 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <string.h>
+
+#include "resolve_cache.h"
+
+#if _WIN32
+#include <uv.h> // brings in windows.h, in the right order
+// aligned 64-bit volatile access is atomic (with acquire/release semantics) on supported targets
+#define rc_load(p) (*(volatile uint64_t *)(p))
+#define rc_load_acq(p) (*(volatile uint64_t *)(p))
+#define rc_store(p, v) (*(volatile uint64_t *)(p) = (v))
+#define rc_store_rel(p, v) (*(volatile uint64_t *)(p) = (v))
+#define rc_cas(p, e, v) (InterlockedCompareExchange64((volatile LONG64 *)(p), (LONG64)(v), (LONG64)(e)) == (LONG64)(e))
+#define rc_inc(p) InterlockedIncrement64((volatile LONG64 *)(p))
+#define rc_fence_acq() MemoryBarrier()
+#define rc_fence_rel() MemoryBarrier()
+#else
+#define rc_load(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#define rc_load_acq(p) __atomic_load_n((p), __ATOMIC_ACQUIRE)
+#define rc_store(p, v) __atomic_store_n((p), (v), __ATOMIC_RELAXED)
+#define rc_store_rel(p, v) __atomic_store_n((p), (v), __ATOMIC_RELEASE)
+#define rc_cas(p, e, v) __extension__({ uint64_t _e = (e); \
+    __atomic_compare_exchange_n((p), &_e, (v), false, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED); })
+#define rc_inc(p) __atomic_add_fetch((p), 1, __ATOMIC_RELEASE)
+#define rc_fence_acq() __atomic_thread_fence(__ATOMIC_ACQUIRE)
+#define rc_fence_rel() __atomic_thread_fence(__ATOMIC_RELEASE)
+#endif
+
+#define STR_MAX (RESOLVE_CACHE_STR_WORDS * sizeof(uint64_t))
+
+// NUL-padded copy of [s], false if it does not fit
+static bool to_words(uint64_t words[RESOLVE_CACHE_STR_WORDS], const char *s) {
+    size_t len = strlen(s);
+    if (len >= STR_MAX) {
+        return false;
+    }
+    memset(words, 0, STR_MAX);
+    memcpy(words, s, len);
+    return true;
+}
+
+static uint64_t slot_key(int type, uint16_t port) {
+    return ((uint64_t) (uint32_t) type << 16) | port;
+}
+
+static resolve_slot *find_slot(resolve_cache *cache, const uint64_t host[RESOLVE_CACHE_STR_WORDS], uint64_t key) {
+    uint64_t h = 14695981039346656037ULL ^ key;
+    for (int i = 0; i < RESOLVE_CACHE_STR_WORDS && host[i] != 0; i++) {
+        h = (h ^ host[i]) * 1099511628211ULL;
+    }
+    h ^= h >> 29;
+    return &cache->slots[h % RESOLVE_CACHE_SLOTS];
+}
+
+void resolve_cache_init(resolve_cache *cache) {
+    memset(cache, 0, sizeof(*cache));
+    cache->gen = 1; // empty slots have gen 0
+}
+
+void resolve_cache_invalidate(resolve_cache *cache) {
+    rc_inc(&cache->gen);
+}
+
+uint64_t resolve_cache_gen(resolve_cache *cache) {
+    return rc_load_acq(&cache->gen);
+}
+
+bool resolve_cache_get(resolve_cache *cache, int type, const char *host, uint16_t port,
+                       void **ztx, char *service, uint32_t *addr) {
+    uint64_t host_w[RESOLVE_CACHE_STR_WORDS];
+    if (host == NULL || !to_words(host_w, host)) {
+        return false;
+    }
+
+    uint64_t key = slot_key(type, port);
+    resolve_slot *slot = find_slot(cache, host_w, key);
+    uint64_t gen = rc_load_acq(&cache->gen);
+
+    uint64_t seq = rc_load_acq(&slot->seq);
+    if (seq & 1) {
+        return false;
+    }
+
+    if (rc_load(&slot->gen) != gen || rc_load(&slot->key) != key) {
+        return false;
+    }
+    for (int i = 0; i < RESOLVE_CACHE_STR_WORDS; i++) {
+        if (rc_load(&slot->host[i]) != host_w[i]) {
+            return false;
+        }
+    }
+
+    uint64_t svc_w[RESOLVE_CACHE_STR_WORDS];
+    for (int i = 0; i < RESOLVE_CACHE_STR_WORDS; i++) {
+        svc_w[i] = rc_load(&slot->service[i]);
+    }
+    uint64_t z = rc_load(&slot->ztx);
+    uint64_t a = rc_load(&slot->addr);
+
+    rc_fence_acq();
+    if (rc_load(&slot->seq) != seq) {
+        return false;
+    }
+
+    memcpy(service, svc_w, STR_MAX);
+    service[STR_MAX - 1] = 0;
+    *ztx = (void *) (uintptr_t) z;
+    if (addr) {
+        *addr = (uint32_t) a;
+    }
+    return true;
+}
+
+void resolve_cache_put(resolve_cache *cache, uint64_t gen, int type, const char *host, uint16_t port,
+                       void *ztx, const char *service, uint32_t addr) {
+    uint64_t host_w[RESOLVE_CACHE_STR_WORDS];
+    uint64_t svc_w[RESOLVE_CACHE_STR_WORDS];
+    if (host == NULL || service == NULL || !to_words(host_w, host) || !to_words(svc_w, service)) {
+        return;
+    }
+
+    uint64_t key = slot_key(type, port);
+    resolve_slot *slot = find_slot(cache, host_w, key);
+
+    uint64_t seq = rc_load(&slot->seq);
+    if ((seq & 1) || !rc_cas(&slot->seq, seq, seq + 1)) {
+        return; // another writer has it
+    }
+    rc_fence_rel();
+
+    rc_store(&slot->gen, gen);
+    rc_store(&slot->key, key);
+    rc_store(&slot->ztx, (uint64_t) (uintptr_t) ztx);
+    rc_store(&slot->addr, (uint64_t) addr);
+    for (int i = 0; i < RESOLVE_CACHE_STR_WORDS; i++) {
+        rc_store(&slot->host[i], host_w[i]);
+        rc_store(&slot->service[i], svc_w[i]);
+    }
+
+    rc_store_rel(&slot->seq, seq + 2);
+}
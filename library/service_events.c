@@ -0,0 +1,243 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "utils.h"
+#include "zt_internal.h"
+
+// pending change of a service, see ziti_ctx.service_changes
+enum service_change {
+    ServiceAdded = 1,
+    ServiceChanged,
+    ServiceRemoved,
+};
+
+struct service_sub_s {
+    ziti_service_cb cb;
+    void *ctx;
+    LIST_ENTRY(service_sub_s) _next;
+};
+
+LIST_HEAD(service_subs_s, service_sub_s);
+
+#define CHANGE(c) ((void *) (uintptr_t) (c))
+
+static void notify_subscribers(ziti_context ztx, ziti_service **services, int status) {
+    for (int i = 0; services && services[i] != NULL; i++) {
+        struct service_subs_s *subs = model_map_get(&ztx->service_subs, services[i]->name);
+        if (subs == NULL) {
+            continue;
+        }
+
+        // callback may unsubscribe itself
+        struct service_sub_s *sub = LIST_FIRST(subs);
+        while (sub != NULL) {
+            struct service_sub_s *next = LIST_NEXT(sub, _next);
+            sub->cb(ztx, services[i], status, sub->ctx);
+            sub = next;
+        }
+    }
+}
+
+void ztx_service_event(ziti_context ztx, ziti_event_t *ev) {
+    ziti_send_event(ztx, ev);
+
+    if (model_map_size(&ztx->service_subs) > 0) {
+        notify_subscribers(ztx, ev->event.service.removed, ZITI_SERVICE_UNAVAILABLE);
+        notify_subscribers(ztx, ev->event.service.changed, ZITI_OK);
+        notify_subscribers(ztx, ev->event.service.added, ZITI_OK);
+    }
+}
+
+static void free_removed(ziti_service **removed) {
+    for (int i = 0; removed && removed[i] != NULL; i++) {
+        free_ziti_service(removed[i]);
+        free(removed[i]);
+    }
+}
+
+void ztx_service_events_flush(ziti_context ztx) {
+    wheel_timer_stop(&ztx->service_event_timer);
+
+    size_t count = model_map_size(&ztx->service_changes);
+    if (count == 0) {
+        return;
+    }
+
+    size_t addIdx = 0, chIdx = 0, remIdx = 0;
+    ziti_event_t ev = {
+            .type = ZitiServiceEvent,
+            .event.service = {
+                    .removed = calloc(count + 1, sizeof(ziti_service *)),
+                    .changed = calloc(count + 1, sizeof(ziti_service *)),
+                    .added = calloc(count + 1, sizeof(ziti_service *)),
+            }
+    };
+
+    model_map_iter it = model_map_iterator(&ztx->service_changes);
+    while (it != NULL) {
+        const char *name = model_map_it_key(it);
+        enum service_change change = (enum service_change) (uintptr_t) model_map_it_value(it);
+        if (change == ServiceRemoved) {
+            ev.event.service.removed[remIdx++] = model_map_remove(&ztx->services_removed, name);
+        } else {
+            // services are cleared without an event on logout
+            ziti_service *s = model_map_get(&ztx->services, name);
+            if (s != NULL && change == ServiceAdded) {
+                ev.event.service.added[addIdx++] = s;
+            } else if (s != NULL) {
+                ev.event.service.changed[chIdx++] = s;
+            }
+        }
+        it = model_map_it_remove(it);
+    }
+
+    ZTX_LOG(DEBUG, "sending coalesced service event %zd added, %zd removed, %zd changed", addIdx, remIdx, chIdx);
+    ztx_service_event(ztx, &ev);
+
+    free_removed(ev.event.service.removed);
+    free(ev.event.service.removed);
+    free(ev.event.service.added);
+    free(ev.event.service.changed);
+}
+
+static void on_service_event_window(wheel_timer_t *t) {
+    ztx_service_events_flush(t->data);
+}
+
+static void queue_change(ziti_context ztx, ziti_service *s, enum service_change change) {
+    enum service_change prev = (enum service_change) (uintptr_t) model_map_get(&ztx->service_changes, s->name);
+
+    switch (change) {
+        case ServiceAdded:
+            if (prev == ServiceRemoved) {
+                // application has not been told it was gone
+                ziti_service *removed = model_map_remove(&ztx->services_removed, s->name);
+                if (removed) {
+                    free_ziti_service_ptr(removed);
+                }
+                change = ServiceChanged;
+            }
+            break;
+        case ServiceChanged:
+            if (prev == ServiceAdded) {
+                change = ServiceAdded;
+            }
+            break;
+        case ServiceRemoved:
+            if (prev == ServiceAdded) {
+                // application has not been told it was there
+                model_map_remove(&ztx->service_changes, s->name);
+                free_ziti_service_ptr(s);
+                return;
+            }
+            model_map_set(&ztx->services_removed, s->name, s);
+            break;
+    }
+    model_map_set(&ztx->service_changes, s->name, CHANGE(change));
+}
+
+void ztx_services_update(ziti_context ztx, ziti_event_t *ev) {
+    struct ziti_service_event *se = &ev->event.service;
+    if (ztx->opts.service_event_window == 0 || !ztx->services_loaded) {
+        ztx_service_events_flush(ztx);
+        ztx_service_event(ztx, ev);
+        free_removed(se->removed);
+        return;
+    }
+
+    for (int i = 0; se->removed && se->removed[i] != NULL; i++) {
+        queue_change(ztx, se->removed[i], ServiceRemoved);
+    }
+    for (int i = 0; se->changed && se->changed[i] != NULL; i++) {
+        queue_change(ztx, se->changed[i], ServiceChanged);
+    }
+    for (int i = 0; se->added && se->added[i] != NULL; i++) {
+        queue_change(ztx, se->added[i], ServiceAdded);
+    }
+
+    // window starts with the first change, later changes do not extend it
+    if (model_map_size(&ztx->service_changes) > 0 && !wheel_timer_is_active(&ztx->service_event_timer)) {
+        wheel_timer_start(&ztx->timers, &ztx->service_event_timer, ztx->opts.service_event_window,
+                          on_service_event_window, ztx);
+    }
+}
+
+void ztx_service_events_free(ziti_context ztx) {
+    model_map_clear(&ztx->service_changes, NULL);
+    model_map_clear(&ztx->services_removed, (_free_f) free_ziti_service_ptr);
+
+    model_map_iter it = model_map_iterator(&ztx->service_subs);
+    while (it != NULL) {
+        struct service_subs_s *subs = model_map_it_value(it);
+        while (!LIST_EMPTY(subs)) {
+            struct service_sub_s *sub = LIST_FIRST(subs);
+            LIST_REMOVE(sub, _next);
+            free(sub);
+        }
+        free(subs);
+        it = model_map_it_remove(it);
+    }
+}
+
+int ziti_service_subscribe(ziti_context ztx, const char *service, ziti_service_cb cb, void *ctx) {
+    if (ztx == NULL || service == NULL || cb == NULL) {
+        return ZITI_INVALID_STATE;
+    }
+
+    struct service_subs_s *subs = model_map_get(&ztx->service_subs, service);
+    if (subs == NULL) {
+        subs = calloc(1, sizeof(*subs));
+        LIST_INIT(subs);
+        model_map_set(&ztx->service_subs, service, subs);
+    }
+
+    NEWP(sub, struct service_sub_s);
+    sub->cb = cb;
+    sub->ctx = ctx;
+    LIST_INSERT_HEAD(subs, sub, _next);
+
+    ziti_service *s = model_map_get(&ztx->services, service);
+    if (s != NULL) {
+        cb(ztx, s, ZITI_OK, ctx);
+    }
+    return ZITI_OK;
+}
+
+int ziti_service_unsubscribe(ziti_context ztx, const char *service, ziti_service_cb cb, void *ctx) {
+    struct service_subs_s *subs = ztx && service ? model_map_get(&ztx->service_subs, service) : NULL;
+    if (subs == NULL) {
+        return ZITI_NOT_FOUND;
+    }
+
+    struct service_sub_s *sub;
+    LIST_FOREACH(sub, subs, _next) {
+        if (sub->cb == cb && sub->ctx == ctx) {
+            break;
+        }
+    }
+    if (sub == NULL) {
+        return ZITI_NOT_FOUND;
+    }
+
+    LIST_REMOVE(sub, _next);
+    free(sub);
+    if (LIST_EMPTY(subs)) {
+        model_map_remove(&ztx->service_subs, service);
+        free(subs);
+    }
+    return ZITI_OK;
+}
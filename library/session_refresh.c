@@ -0,0 +1,147 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "zt_internal.h"
+
+// how often sessions are checked
+#define SESSION_REFRESH_INTERVAL (60 * 1000)
+
+// sessions older than this are refreshed, if they are busy
+#define SESSION_MAX_AGE (5 * 60 * 1000)
+
+// session is busy if it was used for a dial within this window
+#define SESSION_BUSY_WINDOW (10 * 60 * 1000)
+
+static void session_refresh_tick(wheel_timer_t *t);
+
+static bool session_is_busy(const ziti_net_session *s, uint64_t now) {
+    return s->last_used > 0 && now - (uint64_t) s->last_used < SESSION_BUSY_WINDOW;
+}
+
+static bool session_needs_refresh(const ziti_net_session *s, uint64_t now) {
+    return session_is_busy(s, now) && now - (uint64_t) s->fetched_at >= SESSION_MAX_AGE;
+}
+
+void ziti_session_refresh_schedule(ziti_context ztx) {
+    if (ztx->closing || ztx->session_refresh_active || wheel_timer_is_active(&ztx->session_refresh_timer)) {
+        return;
+    }
+    wheel_timer_start(&ztx->timers, &ztx->session_refresh_timer, SESSION_REFRESH_INTERVAL,
+                      session_refresh_tick, ztx);
+}
+
+static void sessions_refresh_cb(ziti_net_session **sessions, const ziti_error *err, void *ctx) {
+    ziti_context ztx = ctx;
+    ztx->session_refresh_active = false;
+
+    if (err) {
+        ZTX_LOG(WARN, "failed to refresh sessions: %s[%s]", err->message, err->code);
+        if (err->err == ZITI_NOT_AUTHORIZED) {
+            ziti_force_api_session_refresh(ztx);
+        }
+        ziti_session_refresh_schedule(ztx);
+        return;
+    }
+
+    model_map current = {0};
+    for (int i = 0; sessions && sessions[i]; i++) {
+        model_map_set(&current, sessions[i]->id, sessions[i]);
+    }
+
+    uint64_t now = uv_now(ztx->loop);
+    size_t count = model_map_size(&ztx->sessions);
+    ziti_net_session **gone = calloc(count + 1, sizeof(ziti_net_session *));
+    int refreshed = 0, removed = 0;
+
+    __attribute__((unused)) const char *service_id;
+    ziti_net_session *s;
+    MODEL_MAP_FOREACH(service_id, s, &ztx->sessions) {
+        ziti_net_session *fresh = model_map_get(&current, s->id);
+        if (fresh == NULL) {
+            gone[removed++] = s;
+            continue;
+        }
+
+        // update in place: connections in progress hold on to the session
+        if (model_list_size(&fresh->edge_routers) > 0) {
+            model_list routers = s->edge_routers;
+            s->edge_routers = fresh->edge_routers;
+            fresh->edge_routers = routers;
+        }
+        s->fetched_at = (duration) now;
+        refreshed++;
+    }
+
+    for (int i = 0; i < removed; i++) {
+        s = gone[i];
+        bool busy = session_is_busy(s, now);
+        char *id = strdup(s->service_id);
+
+        ZTX_LOG(DEBUG, "session[%s] for service_id[%s] is no longer valid", s->id, id);
+        ziti_invalidate_session(ztx, s, id, ziti_session_types.Dial);
+        if (busy) {
+            ziti_prefetch_session(ztx, id);
+        }
+        free(id);
+    }
+
+    ZTX_LOG(DEBUG, "refreshed %d sessions, %d removed", refreshed, removed);
+
+    free(gone);
+    model_map_clear(&current, NULL);
+    free_ziti_net_session_array(&sessions);
+
+    if (refreshed > 0 || removed > 0) {
+        ziti_cache_update(ztx);
+    }
+    ziti_session_refresh_schedule(ztx);
+}
+
+static void session_refresh_tick(wheel_timer_t *t) {
+    ziti_context ztx = t->data;
+
+    if (model_map_size(&ztx->sessions) == 0) {
+        ZTX_LOG(VERBOSE, "no sessions, stopping session refresh");
+        return;
+    }
+
+    if (!ztx->enabled || ztx->api_session_state != ZitiApiSessionStateFullyAuthenticated) {
+        ziti_session_refresh_schedule(ztx);
+        return;
+    }
+
+    uint64_t now = uv_now(ztx->loop);
+    bool need_refresh = false;
+    __attribute__((unused)) const char *service_id;
+    ziti_net_session *s;
+    MODEL_MAP_FOREACH(service_id, s, &ztx->sessions) {
+        if (session_needs_refresh(s, now)) {
+            need_refresh = true;
+            break;
+        }
+    }
+
+    if (!need_refresh) {
+        ziti_session_refresh_schedule(ztx);
+        return;
+    }
+
+    // one bulk request covers all sessions of the api session
+    ZTX_LOG(DEBUG, "refreshing sessions");
+    ztx->session_refresh_active = true;
+    ziti_ctrl_get_sessions(&ztx->controller, sessions_refresh_cb, ztx);
+}
@@ -0,0 +1,82 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "str_intern.h"
+
+struct interned_str {
+    size_t refs;
+    char str[];
+};
+
+const char *str_intern_get(str_intern *t, const char *s) {
+    if (s == NULL) {
+        return NULL;
+    }
+
+    if (t == NULL) {
+        return strdup(s);
+    }
+
+    struct interned_str *e = model_map_get(&t->strings, s);
+    if (e == NULL) {
+        size_t len = strlen(s);
+        e = malloc(sizeof(*e) + len + 1);
+        e->refs = 0;
+        memcpy(e->str, s, len + 1);
+        model_map_set(&t->strings, e->str, e);
+    }
+    e->refs++;
+    return e->str;
+}
+
+void str_intern_release(str_intern *t, const char *s) {
+    if (s == NULL) {
+        return;
+    }
+
+    if (t == NULL) {
+        free((char *) s);
+        return;
+    }
+
+    struct interned_str *e = model_map_get(&t->strings, s);
+    // only strings handed out by this table
+    if (e == NULL || e->str != s) {
+        return;
+    }
+
+    if (--e->refs == 0) {
+        model_map_remove(&t->strings, s);
+        free(e);
+    }
+}
+
+size_t str_intern_size(const str_intern *t) {
+    return t ? model_map_size(&t->strings) : 0;
+}
+
+size_t str_intern_refs(const str_intern *t, const char *s) {
+    if (t == NULL || s == NULL) {
+        return 0;
+    }
+    struct interned_str *e = model_map_get(&t->strings, s);
+    return e ? e->refs : 0;
+}
+
+void str_intern_clear(str_intern *t) {
+    model_map_clear(&t->strings, free);
+}
@@ -0,0 +1,184 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "stream_io.h"
+
+#if !_WIN32
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <stdatomic.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#if defined(__linux__)
+#include <sys/eventfd.h>
+#endif
+
+#include "utils.h"
+
+struct stream_ring_s {
+    atomic_size_t head; // written by producer
+    atomic_size_t tail; // written by consumer
+    size_t size;
+    uint8_t buf[];
+};
+
+stream_ring *stream_ring_new(size_t size) {
+    stream_ring *r = malloc(sizeof(stream_ring) + size);
+    atomic_init(&r->head, 0);
+    atomic_init(&r->tail, 0);
+    r->size = size;
+    return r;
+}
+
+void stream_ring_free(stream_ring *r) {
+    free(r);
+}
+
+size_t stream_ring_free_region(stream_ring *r, uint8_t **p) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_relaxed);
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_acquire);
+    size_t off = head & (r->size - 1);
+    *p = r->buf + off;
+    return MIN(r->size - (head - tail), r->size - off);
+}
+
+void stream_ring_produce(stream_ring *r, size_t len) {
+    atomic_fetch_add_explicit(&r->head, len, memory_order_release);
+}
+
+size_t stream_ring_write(stream_ring *r, const uint8_t *data, size_t len) {
+    size_t total = 0;
+    uint8_t *p;
+    size_t avail;
+    while (total < len && (avail = stream_ring_free_region(r, &p)) > 0) {
+        size_t n = MIN(avail, len - total);
+        memcpy(p, data + total, n);
+        stream_ring_produce(r, n);
+        total += n;
+    }
+    return total;
+}
+
+size_t stream_ring_read(stream_ring *r, uint8_t *buf, size_t len) {
+    size_t tail = atomic_load_explicit(&r->tail, memory_order_relaxed);
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t total = MIN(head - tail, len);
+    size_t off = tail & (r->size - 1);
+    size_t first = MIN(total, r->size - off);
+    memcpy(buf, r->buf + off, first);
+    memcpy(buf + first, r->buf, total - first);
+    atomic_store_explicit(&r->tail, tail + total, memory_order_release);
+    return total;
+}
+
+size_t stream_ring_peek(stream_ring *r, size_t pos, uint8_t **p) {
+    size_t head = atomic_load_explicit(&r->head, memory_order_acquire);
+    size_t off = pos & (r->size - 1);
+    *p = r->buf + off;
+    return MIN(head - pos, r->size - off);
+}
+
+void stream_ring_release(stream_ring *r, size_t len) {
+    atomic_fetch_add_explicit(&r->tail, len, memory_order_release);
+}
+
+struct stream_bell_s {
+    int fd_r;
+    int fd_w;
+    atomic_uint seq;
+    atomic_bool waiting;
+};
+
+stream_bell *stream_bell_new(void) {
+    stream_bell *b = calloc(1, sizeof(*b));
+#if defined(__linux__)
+    b->fd_r = b->fd_w = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (b->fd_r < 0) {
+        free(b);
+        return NULL;
+    }
+#else
+    int fds[2];
+    if (pipe(fds) != 0) {
+        free(b);
+        return NULL;
+    }
+    fcntl(fds[0], F_SETFL, fcntl(fds[0], F_GETFL) | O_NONBLOCK);
+    fcntl(fds[1], F_SETFL, fcntl(fds[1], F_GETFL) | O_NONBLOCK);
+    b->fd_r = fds[0];
+    b->fd_w = fds[1];
+#endif
+    return b;
+}
+
+void stream_bell_free(stream_bell *b) {
+    if (b == NULL) return;
+    close(b->fd_r);
+    if (b->fd_w != b->fd_r) {
+        close(b->fd_w);
+    }
+    free(b);
+}
+
+int stream_bell_fd(stream_bell *b) {
+    return b->fd_r;
+}
+
+unsigned int stream_bell_seq(stream_bell *b) {
+    return atomic_load(&b->seq);
+}
+
+static void bell_ring(stream_bell *b) {
+    uint64_t one = 1;
+    ssize_t rc = write(b->fd_w, &one, b->fd_r == b->fd_w ? sizeof(one) : 1);
+    (void) rc; // full pipe(or eventfd counter) is already signaled
+}
+
+static void bell_drain(stream_bell *b) {
+    uint64_t v;
+    while (read(b->fd_r, &v, sizeof(v)) > 0) {}
+}
+
+void stream_bell_notify(stream_bell *b) {
+    atomic_fetch_add(&b->seq, 1);
+    if (atomic_exchange(&b->waiting, false)) {
+        bell_ring(b);
+    }
+}
+
+bool stream_bell_wait(stream_bell *b, unsigned int seq, bool block) {
+    // clear earlier rings before re-arming, otherwise the descriptor stays readable for poll() users
+    bell_drain(b);
+    atomic_store(&b->waiting, true);
+    if (atomic_load(&b->seq) != seq) {
+        // something changed since caller looked
+        return true;
+    }
+
+    if (!block) {
+        return false;
+    }
+
+    struct pollfd pfd = {
+            .fd = b->fd_r,
+            .events = POLLIN,
+    };
+    while (poll(&pfd, 1, -1) < 0 && errno == EINTR) {}
+    bell_drain(b);
+    return true;
+}
+
+#endif // !_WIN32
@@ -0,0 +1,163 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "timer_wheel.h"
+
+#include <stdlib.h>
+
+#define TW_SLOT_MASK (TW_SLOTS - 1)
+#define TW_LEVEL_SHIFT(l) (TW_SLOT_BITS * (l))
+// max distance (in ticks) that can be scheduled
+#define TW_MAX_TICKS ((1ULL << TW_LEVEL_SHIFT(TW_LEVELS)) - 1)
+
+static void on_wheel_tick(uv_timer_t *t);
+
+static uint64_t now_tick(timer_wheel_t *tw) {
+    return (uv_now(tw->timer->loop) - tw->start) / tw->resolution;
+}
+
+static void wheel_insert(timer_wheel_t *tw, wheel_timer_t *t) {
+    uint64_t delta = t->expire > tw->tick ? t->expire - tw->tick : 0;
+    if (delta > TW_MAX_TICKS) {
+        delta = TW_MAX_TICKS;
+        t->expire = tw->tick + delta;
+    }
+
+    int level = 0;
+    while (level < TW_LEVELS - 1 && delta >= (1ULL << TW_LEVEL_SHIFT(level + 1))) {
+        level++;
+    }
+
+    // overdue timers go into the slot processed on the current tick
+    uint64_t expire = delta == 0 ? tw->tick : t->expire;
+    size_t slot = (expire >> TW_LEVEL_SHIFT(level)) & TW_SLOT_MASK;
+    LIST_INSERT_HEAD(&tw->slots[level][slot], t, _next);
+}
+
+static void wheel_cascade(timer_wheel_t *tw, int level) {
+    // timers from level N slot always land in lower levels, so the slot can be drained in place
+    struct tw_slot *slot = &tw->slots[level][(tw->tick >> TW_LEVEL_SHIFT(level)) & TW_SLOT_MASK];
+    while (!LIST_EMPTY(slot)) {
+        wheel_timer_t *t = LIST_FIRST(slot);
+        LIST_REMOVE(t, _next);
+        wheel_insert(tw, t);
+    }
+}
+
+static void wheel_advance(timer_wheel_t *tw) {
+    tw->tick++;
+
+    // higher levels first, timers cascading all the way down must be in level 0 before it is expired
+    int top = 0;
+    while (top < TW_LEVELS - 1 && (tw->tick & ((1ULL << TW_LEVEL_SHIFT(top + 1)) - 1)) == 0) {
+        top++;
+    }
+    for (int level = top; level > 0; level--) {
+        wheel_cascade(tw, level);
+    }
+
+    struct tw_slot *slot = &tw->slots[0][tw->tick & TW_SLOT_MASK];
+    while (!LIST_EMPTY(slot)) {
+        wheel_timer_t *t = LIST_FIRST(slot);
+        LIST_REMOVE(t, _next);
+        t->wheel = NULL;
+        tw->active--;
+        t->cb(t);
+    }
+}
+
+int timer_wheel_init(timer_wheel_t *tw, uv_loop_t *loop, uint64_t resolution_ms) {
+    tw->timer = calloc(1, sizeof(uv_timer_t));
+    uv_timer_init(loop, tw->timer);
+    tw->timer->data = tw;
+    tw->resolution = resolution_ms > 0 ? resolution_ms : 1;
+    tw->start = uv_now(loop);
+    tw->tick = 0;
+    tw->active = 0;
+    for (int l = 0; l < TW_LEVELS; l++) {
+        for (int s = 0; s < TW_SLOTS; s++) {
+            LIST_INIT(&tw->slots[l][s]);
+        }
+    }
+    return 0;
+}
+
+void timer_wheel_close(timer_wheel_t *tw) {
+    if (tw->timer == NULL) {
+        return;
+    }
+
+    for (int l = 0; l < TW_LEVELS; l++) {
+        for (int s = 0; s < TW_SLOTS; s++) {
+            while (!LIST_EMPTY(&tw->slots[l][s])) {
+                wheel_timer_t *t = LIST_FIRST(&tw->slots[l][s]);
+                LIST_REMOVE(t, _next);
+                t->wheel = NULL;
+            }
+        }
+    }
+    tw->active = 0;
+
+    tw->timer->data = NULL;
+    uv_close((uv_handle_t *) tw->timer, (uv_close_cb) free);
+    tw->timer = NULL;
+}
+
+void wheel_timer_start(timer_wheel_t *tw, wheel_timer_t *t, uint64_t timeout_ms, wheel_timer_cb cb, void *data) {
+    wheel_timer_stop(t);
+    if (tw->timer == NULL) {
+        return;
+    }
+
+    if (!uv_is_active((const uv_handle_t *) tw->timer)) {
+        // wheel is idle, catch up with the clock without walking the ticks
+        tw->tick = now_tick(tw);
+        uv_timer_start(tw->timer, on_wheel_tick, tw->resolution, tw->resolution);
+    }
+
+    uint64_t ticks = (timeout_ms + tw->resolution - 1) / tw->resolution;
+    t->cb = cb;
+    t->data = data;
+    t->wheel = tw;
+    t->expire = now_tick(tw) + (ticks > 0 ? ticks : 1);
+    tw->active++;
+    wheel_insert(tw, t);
+}
+
+void wheel_timer_stop(wheel_timer_t *t) {
+    if (t->wheel == NULL) {
+        return;
+    }
+
+    LIST_REMOVE(t, _next);
+    t->wheel->active--;
+    t->wheel = NULL;
+}
+
+bool wheel_timer_is_active(const wheel_timer_t *t) {
+    return t->wheel != NULL;
+}
+
+static void on_wheel_tick(uv_timer_t *timer) {
+    timer_wheel_t *tw = timer->data;
+    uint64_t target = now_tick(tw);
+
+    while (tw->active > 0 && tw->tick < target) {
+        wheel_advance(tw);
+    }
+
+    if (tw->active == 0) {
+        uv_timer_stop(timer);
+    }
+}
@@ -137,6 +137,9 @@ static uv_key_t logbufs;
 static uv_prepare_t log_flusher;
 static log_writer logger = NULL;
 
+// default number of records of async logging ring, see ziti_log_set_async()
+#define LOG_RING_DEFAULT 1024
+
 static void init_debug(uv_loop_t *loop);
 
 static void init_uv_mbed_log();
@@ -171,6 +174,37 @@ void ziti_log_init(uv_loop_t *loop, int level, log_writer log_func) {
 
 }
 
+// subsystems can be used as log level markers, they set the level of their source files
+static const struct log_subsystem {
+    const char *name;
+    const char *files[4];
+} log_subsystems[] = {
+        {"channel", {"channel.c", NULL}},
+        {"connection", {"connect.c", "bind.c", "conn_bridge.c", NULL}},
+        {"controller", {"ziti_ctrl.c", NULL}},
+        {"posture", {"posture.c", "posture_notify.c", NULL}},
+};
+
+static void set_marker_level(const char *marker, int level) {
+    for (size_t i = 0; i < sizeof(log_subsystems) / sizeof(log_subsystems[0]); i++) {
+        if (strcmp(marker, log_subsystems[i].name) == 0) {
+            for (int f = 0; log_subsystems[i].files[f]; f++) {
+                set_marker_level(log_subsystems[i].files[f], level);
+            }
+            return;
+        }
+    }
+
+    if (level == ZITI_LOG_DEFAULT_LEVEL) {
+        model_map_remove(&log_levels, marker);
+    } else {
+        model_map_set(&log_levels, marker, (void *) (uintptr_t) level);
+        if (strcmp(marker, TLSUV_MODULE) == 0) {
+            tlsuv_set_debug(level, tlsuv_logger);
+        }
+    }
+}
+
 void ziti_log_set_level(int level, const char *marker) {
     if (level > TRACE) {
         level = TRACE;
@@ -178,26 +212,38 @@ void ziti_log_set_level(int level, const char *marker) {
         level = ZITI_LOG_DEFAULT_LEVEL;
     }
 
-    if (level == ZITI_LOG_DEFAULT_LEVEL) {
-        if (marker) {
-            model_map_remove(&log_levels, marker);
-        }
-    } else {
-        if (marker) {
-            model_map_set(&log_levels, marker, (void *) (uintptr_t) level);
-            if (strcmp(marker, TLSUV_MODULE) == 0) {
-                tlsuv_set_debug(level, tlsuv_logger);
-            }
-        } else {
-            ziti_log_lvl = level;
-        }
+    if (marker) {
+        set_marker_level(marker, level);
+    } else if (level != ZITI_LOG_DEFAULT_LEVEL) {
+        ziti_log_lvl = level;
     }
 
     if (logger) {
         int l = level == ZITI_LOG_DEFAULT_LEVEL ? ziti_log_lvl : level;
         const char *lbl = level_labels[l];
         ZITI_LOG(INFO, "set log level: %s=%d/%s", marker ? marker : "root", l, lbl);
+        if (l > ZITI_LOG_MIN_LEVEL) {
+            ZITI_LOG(WARN, "SDK was built without log statements above %s", level_labels[ZITI_LOG_MIN_LEVEL]);
+        }
+    }
+}
+
+bool ziti_log_limit_check(ziti_log_limit *limit, unsigned int max_per_sec, unsigned int *suppressed) {
+    uint64_t now = uv_hrtime() / 1000000;
+    *suppressed = 0;
+    if (now - limit->window_start >= 1000) {
+        limit->window_start = now;
+        limit->count = 0;
+        *suppressed = limit->suppressed;
+        limit->suppressed = 0;
+    }
+
+    if (limit->count < max_per_sec) {
+        limit->count++;
+        return true;
     }
+    limit->suppressed++;
+    return false;
 }
 
 int ziti_log_level(const char *module, const char *file) {
@@ -251,7 +297,11 @@ static void init_uv_mbed_log() {
     }
 }
 
+static void log_ring_reset(void);
+
 static void child_init() {
+    // writer thread does not exist in the child
+    log_ring_reset();
     log_initialized = false;
     log_pid = uv_os_getpid();
 }
@@ -286,7 +336,9 @@ static void init_debug(uv_loop_t *loop) {
         char *eq = strchr(lvl, '=');
         if (eq) {
             l = (int) strtol(eq + 1, NULL, 10);
-            model_map_set_key(&log_levels, lvl, eq - lvl, (void *) (intptr_t) l);
+            char marker[64];
+            snprintf(marker, sizeof(marker), "%.*s", (int) (eq - lvl), lvl);
+            set_marker_level(marker, l);
         }
         else {
             l = (int) strtol(lvl, NULL, 10);
@@ -304,6 +356,12 @@ static void init_debug(uv_loop_t *loop) {
 
     starttime = uv_now(loop);
 
+    const char *async = getenv("ZITI_LOG_ASYNC");
+    if (async) {
+        long capacity = strtol(async, NULL, 10);
+        ziti_log_set_async(capacity > 0 ? (size_t) capacity : LOG_RING_DEFAULT);
+    }
+
     uv_prepare_init(loop, &log_flusher);
     uv_unref((uv_handle_t *) &log_flusher);
     uv_prepare_start(&log_flusher, flush_log);
@@ -323,19 +381,8 @@ static const char *basename(const char *path) {
     return path;
 }
 
-void ziti_logger(int level, const char *module, const char *file, unsigned int line, const char *func, FORMAT_STRING(const char *fmt), ...) {
-    static size_t loglinelen = 1024;
-
-    log_writer logfunc = logger;
-    if (logfunc == NULL) { return; }
-
-    char *logbuf = (char *) uv_key_get(&logbufs);
-    if (!logbuf) {
-        logbuf = malloc(loglinelen);
-        uv_key_set(&logbufs, logbuf);
-    }
-
-    char location[128];
+static void format_location(char *location, size_t maxlen, const char *module, const char *file,
+                            unsigned int line, const char *func) {
     char *last_slash = strrchr(file, DIR_SEP);
 
     int modlen = 16;
@@ -361,13 +408,272 @@ void ziti_logger(int level, const char *module, const char *file, unsigned int l
         file = last_slash + 1;
     }
     if (func && func[0]) {
-        snprintf(location, sizeof(location), "%.*s:%s:%u %s()", modlen, module, file, line, func);
+        snprintf(location, maxlen, "%.*s:%s:%u %s()", modlen, module, file, line, func);
     }
     else {
-        snprintf(location, sizeof(location), "%.*s:%s:%u", modlen, module, file, line);
+        snprintf(location, maxlen, "%.*s:%s:%u", modlen, module, file, line);
+    }
+}
+
+/*
+ * Asynchronous logging: bounded lock-free MPSC ring of pre-formatted messages.
+ * Producers claim a slot, format the message in place and publish it, location is formatted by the writer thread.
+ * If the ring is full the message is dropped and counted.
+ */
+#if _WIN32
+#define THREAD_LOCAL __declspec(thread)
+typedef volatile LONG64 log_atomic;
+#define log_load(p) InterlockedCompareExchange64((p), 0, 0)
+#define log_store(p, v) InterlockedExchange64((p), (v))
+#define log_cas(p, e, v) (InterlockedCompareExchange64((p), (v), (e)) == (e))
+#define log_inc(p) InterlockedIncrement64(p)
+#define log_dec(p) InterlockedDecrement64(p)
+#define log_load_sc(p) log_load(p)
+#define log_xchg(p, v) InterlockedExchange64((p), (v))
+#else
+#include <stdatomic.h>
+#define THREAD_LOCAL __thread
+typedef atomic_llong log_atomic;
+#define log_load(p) atomic_load_explicit((p), memory_order_acquire)
+#define log_store(p, v) atomic_store_explicit((p), (v), memory_order_release)
+#define log_cas(p, e, v) log_cas_((p), (e), (v))
+#define log_inc(p) atomic_fetch_add((p), 1)
+#define log_dec(p) atomic_fetch_sub((p), 1)
+#define log_load_sc(p) atomic_load(p)
+#define log_xchg(p, v) atomic_exchange((p), (v))
+static inline bool log_cas_(log_atomic *p, long long e, long long v) {
+    return atomic_compare_exchange_weak(p, &e, v);
+}
+#endif
+
+#define LOG_RECORD_MSG_LEN 1024
+
+struct log_record {
+    log_atomic seq;
+    int level;
+    unsigned int line;
+    const char *module;
+    const char *file;
+    const char *func;
+    uint64_t time;
+    size_t len;
+    char msg[LOG_RECORD_MSG_LEN];
+};
+
+struct log_ring {
+    struct log_record *records;
+    size_t mask;
+    log_atomic head; // next slot to claim
+    size_t tail; // next slot to consume, writer thread only
+    log_atomic dropped;
+    uv_sem_t pending;
+    uv_thread_t writer;
+    volatile bool stopping;
+};
+
+static THREAD_LOCAL uint64_t log_record_time;
+
+/*
+ * Active ring (as integer, so it can use log_atomic operations).
+ * Threads using the ring are counted per epoch: a retired ring is freed only after the epoch is advanced and
+ * every thread that entered the previous epoch is done, later threads can only see the ring that replaced it.
+ */
+static log_atomic log_ring_ref;
+static log_atomic log_epoch;
+static log_atomic log_producers[2];
+
+static struct log_ring *log_ring_enter(long long *epoch) {
+    for (;;) {
+        long long e = log_load_sc(&log_epoch);
+        log_inc(&log_producers[e & 1]);
+        // epoch advanced before it was counted, retiring thread may not have waited for it
+        if (log_load_sc(&log_epoch) == e) {
+            *epoch = e;
+            return (struct log_ring *) (intptr_t) log_load_sc(&log_ring_ref);
+        }
+        log_dec(&log_producers[e & 1]);
+    }
+}
+
+static void log_ring_exit(long long epoch) {
+    log_dec(&log_producers[epoch & 1]);
+}
+
+static void log_ring_reset(void) {
+    log_store(&log_ring_ref, 0);
+    log_store(&log_producers[0], 0);
+    log_store(&log_producers[1], 0);
+}
+
+static struct log_record *log_ring_claim(struct log_ring *r) {
+    long long pos = log_load(&r->head);
+    for (;;) {
+        struct log_record *rec = &r->records[pos & r->mask];
+        long long seq = log_load(&rec->seq);
+        long long dif = seq - pos;
+        if (dif == 0) {
+            if (log_cas(&r->head, pos, pos + 1)) {
+                return rec;
+            }
+            pos = log_load(&r->head);
+        } else if (dif < 0) {
+            log_inc(&r->dropped);
+            return NULL;
+        } else {
+            pos = log_load(&r->head);
+        }
+    }
+}
+
+static void log_ring_publish(struct log_ring *r, struct log_record *rec) {
+    log_store(&rec->seq, log_load(&rec->seq) + 1);
+    uv_sem_post(&r->pending);
+}
+
+static void log_ring_write(struct log_record *rec) {
+    log_writer logfunc = logger;
+    if (logfunc) {
+        char location[128];
+        format_location(location, sizeof(location), rec->module, rec->file, rec->line, rec->func);
+        log_record_time = rec->time;
+        logfunc(rec->level, location, rec->msg, rec->len);
+        log_record_time = 0;
+    }
+}
+
+static void log_ring_run(void *arg) {
+    struct log_ring *r = arg;
+    long long reported = 0;
+    for (;;) {
+        uv_sem_wait(&r->pending);
+
+        struct log_record *rec = &r->records[r->tail & r->mask];
+        // woken by stop request, all published records are consumed
+        if (log_load(&rec->seq) != (long long) r->tail + 1) {
+            if (r->stopping) break;
+            // slot claimed by a producer that is still writing it, sem was posted by a later slot
+            while (log_load(&rec->seq) != (long long) r->tail + 1) {
+                uv_sleep(0);
+            }
+        }
+
+        log_ring_write(rec);
+        log_store(&rec->seq, (long long) (r->tail + r->mask + 1));
+        r->tail++;
+
+        long long dropped = log_load(&r->dropped);
+        if (dropped != reported && logger) {
+            char msg[64];
+            int len = snprintf(msg, sizeof(msg), "dropped %lld log messages", dropped - reported);
+            logger(WARN, "ziti_log", msg, len);
+            reported = dropped;
+        }
+        if (logger == default_log_writer) {
+            fflush(ziti_debug_out);
+        }
+    }
+}
+
+int ziti_log_set_async(size_t capacity) {
+    struct log_ring *r = (struct log_ring *) (intptr_t) log_xchg(&log_ring_ref, 0);
+    if (r != NULL) {
+        // wait for threads that may still be writing into it
+        long long e = log_load_sc(&log_epoch);
+        log_inc(&log_epoch);
+        while (log_load_sc(&log_producers[e & 1]) != 0) {
+            uv_sleep(0);
+        }
+
+        // drain and stop current writer
+        r->stopping = true;
+        uv_sem_post(&r->pending);
+        uv_thread_join(&r->writer);
+        uv_sem_destroy(&r->pending);
+        free(r->records);
+        free(r);
     }
 
+    if (capacity == 0) {
+        return 0;
+    }
+
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+
+    r = calloc(1, sizeof(*r));
+    r->records = calloc(size, sizeof(struct log_record));
+    if (r->records == NULL) {
+        free(r);
+        return UV_ENOMEM;
+    }
+    r->mask = size - 1;
+    for (size_t i = 0; i < size; i++) {
+        log_store(&r->records[i].seq, (long long) i);
+    }
+    uv_sem_init(&r->pending, 0);
+
+    int rc = uv_thread_create(&r->writer, log_ring_run, r);
+    if (rc != 0) {
+        uv_sem_destroy(&r->pending);
+        free(r->records);
+        free(r);
+        return rc;
+    }
+    log_store(&log_ring_ref, (long long) (intptr_t) r);
+    return 0;
+}
+
+uint64_t ziti_log_dropped(void) {
+    long long epoch;
+    struct log_ring *r = log_ring_enter(&epoch);
+    uint64_t dropped = r ? (uint64_t) log_load(&r->dropped) : 0;
+    log_ring_exit(epoch);
+    return dropped;
+}
+
+void ziti_logger(int level, const char *module, const char *file, unsigned int line, const char *func, FORMAT_STRING(const char *fmt), ...) {
+    static size_t loglinelen = 1024;
+
+    log_writer logfunc = logger;
+    if (logfunc == NULL) { return; }
+
     va_list argp;
+    long long epoch;
+    struct log_ring *ring = log_ring_enter(&epoch);
+    if (ring) {
+        struct log_record *rec = log_ring_claim(ring);
+        if (rec == NULL) {
+            log_ring_exit(epoch);
+            return;
+        }
+
+        rec->level = level;
+        rec->module = module;
+        rec->file = file;
+        rec->line = line;
+        rec->func = func;
+        rec->time = ts_loop ? uv_now(ts_loop) : 0;
+
+        va_start(argp, fmt);
+        int len = vsnprintf(rec->msg, sizeof(rec->msg), fmt, argp);
+        va_end(argp);
+        rec->len = len < 0 ? 0 : len >= (int) sizeof(rec->msg) ? sizeof(rec->msg) - 1 : (size_t) len;
+
+        log_ring_publish(ring, rec);
+        log_ring_exit(epoch);
+        return;
+    }
+    log_ring_exit(epoch);
+
+    char *logbuf = (char *) uv_key_get(&logbufs);
+    if (!logbuf) {
+        logbuf = malloc(loglinelen);
+        uv_key_set(&logbufs, logbuf);
+    }
+
+    char location[128];
+    format_location(location, sizeof(location), module, file, line, func);
+
     va_start(argp, fmt);
     int len = vsnprintf(logbuf, loglinelen, fmt, argp);
     va_end(argp);
@@ -393,7 +699,7 @@ static void flush_log(uv_prepare_t *p) {
 }
 
 static const char *get_elapsed_time() {
-    uint64_t now = uv_now(ts_loop);
+    uint64_t now = log_record_time ? log_record_time : uv_now(ts_loop);
     if (now > last_update) {
         last_update = now;
         unsigned long long elapsed = now - starttime;
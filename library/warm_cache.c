@@ -0,0 +1,277 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <stdlib.h>
+#include <string.h>
+#include <inttypes.h>
+
+#include "utils.h"
+#include "zt_internal.h"
+
+// coalesce bursts of updates (services, routers, sessions arrive close to each other)
+#define CACHE_WRITE_DELAY 1000
+
+// cached api session is not used if it is going to expire soon
+#define CACHE_MIN_API_SESSION_TTL 120
+
+static uint64_t cache_hash(uint64_t h, const char *s) {
+    for (; s && *s; s++) {
+        h = (h ^ (uint8_t) *s) * 1099511628211ULL;
+    }
+    return (h ^ '\n') * 1099511628211ULL;
+}
+
+// cache file is specific to identity and controller
+static int cache_path(ziti_context ztx, char *path, size_t maxlen, const char *suffix) {
+    if (ztx->opts.cache_dir == NULL) {
+        return -1;
+    }
+
+    uint64_t h = 14695981039346656037ULL;
+    h = cache_hash(h, ztx->config.controller_url);
+    h = cache_hash(h, ztx->config.id.cert);
+    h = cache_hash(h, ztx->config.cfg_source);
+
+    int len = snprintf(path, maxlen, "%s/ziti-%016" PRIx64 ".cache%s", ztx->opts.cache_dir, h, suffix);
+    return (len < 0 || (size_t) len >= maxlen) ? -1 : 0;
+}
+
+ziti_warm_cache *ziti_cache_read(ziti_context ztx) {
+    char path[1024];
+    if (cache_path(ztx, path, sizeof(path), "") != 0) {
+        return NULL;
+    }
+
+    uv_fs_t req;
+    int rc = uv_fs_stat(NULL, &req, path, NULL);
+    uv_fs_req_cleanup(&req);
+    if (rc != 0) {
+        ZTX_LOG(DEBUG, "no warm start cache[%s]", path);
+        return NULL;
+    }
+
+    char *content = NULL;
+    size_t len = 0;
+    if (load_file(path, strlen(path), &content, &len) != 0) {
+        return NULL;
+    }
+
+    ziti_warm_cache *cache = NULL;
+    if (parse_ziti_warm_cache_ptr(&cache, content, len) < 0) {
+        ZTX_LOG(WARN, "invalid warm start cache[%s]", path);
+        free(content);
+        ziti_cache_remove(ztx);
+        return NULL;
+    }
+    free(content);
+
+    uv_timeval64_t now;
+    uv_gettimeofday(&now);
+    const char *reason = NULL;
+    if (cache->controller == NULL || strcmp(cache->controller, ztx->config.controller_url) != 0) {
+        reason = "controller does not match";
+    } else if (cache->api_session == NULL || cache->api_session->token == NULL || cache->api_session_expires == NULL) {
+        reason = "no api session";
+    } else if (cache->api_session_expires->tv_sec < now.tv_sec + CACHE_MIN_API_SESSION_TTL) {
+        reason = "api session expired";
+    }
+
+    if (reason) {
+        ZTX_LOG(DEBUG, "not using warm start cache[%s]: %s", path, reason);
+        free_ziti_warm_cache_ptr(cache);
+        return NULL;
+    }
+
+    // posture queries are cached in map form, service processing expects the (empty) array
+    for (int i = 0; cache->services && cache->services[i]; i++) {
+        if (cache->services[i]->posture_query_set == NULL) {
+            cache->services[i]->posture_query_set = calloc(1, sizeof(ziti_posture_query_set *));
+        }
+    }
+
+    ZTX_LOG(DEBUG, "loaded warm start cache[%s]", path);
+    return cache;
+}
+
+// cache is written on threadpool, context is detached if it is freed (or cache is removed) before completion
+struct cache_write_s {
+    uv_work_t w;
+    ziti_context ztx;
+    bool removed;
+    char path[1024];
+    char tmp_path[1024];
+    char *json;
+    size_t len;
+    int rc;
+};
+
+static int write_file(const char *path, const char *content, size_t len) {
+    uv_fs_t req;
+    // cache contains api session token
+    uv_file f = uv_fs_open(NULL, &req, path, UV_FS_O_WRONLY | UV_FS_O_CREAT | UV_FS_O_TRUNC, 0600, NULL);
+    uv_fs_req_cleanup(&req);
+    if (f < 0) {
+        return f;
+    }
+
+    int rc = 0;
+    size_t written = 0;
+    while (rc >= 0 && written < len) {
+        uv_buf_t buf = uv_buf_init((char *) content + written, (unsigned int) (len - written));
+        rc = uv_fs_write(NULL, &req, f, &buf, 1, -1, NULL);
+        uv_fs_req_cleanup(&req);
+        if (rc > 0) {
+            written += rc;
+        } else if (rc == 0) {
+            // no progress, e.g. device is full
+            rc = UV_EIO;
+        }
+    }
+
+    uv_fs_close(NULL, &req, f, NULL);
+    uv_fs_req_cleanup(&req);
+    return rc < 0 ? rc : 0;
+}
+
+static void cache_write_work(uv_work_t *w) {
+    struct cache_write_s *job = w->data;
+    uv_fs_t req;
+    job->rc = write_file(job->tmp_path, job->json, job->len);
+    if (job->rc == 0) {
+        job->rc = uv_fs_rename(NULL, &req, job->tmp_path, job->path, NULL);
+        uv_fs_req_cleanup(&req);
+    }
+
+    if (job->rc != 0) {
+        uv_fs_unlink(NULL, &req, job->tmp_path, NULL);
+        uv_fs_req_cleanup(&req);
+    }
+}
+
+static void cache_write_done(uv_work_t *w, int status) {
+    struct cache_write_s *job = w->data;
+    ziti_context ztx = job->ztx;
+    uv_fs_t req;
+
+    if (job->removed) {
+        // removed while it was being written
+        uv_fs_unlink(NULL, &req, job->path, NULL);
+        uv_fs_req_cleanup(&req);
+    } else if (ztx != NULL && job->rc != 0) {
+        ZTX_LOG(WARN, "failed to write warm start cache[%s]: %s", job->path, uv_strerror(job->rc));
+    } else if (ztx != NULL) {
+        ZTX_LOG(VERBOSE, "updated warm start cache[%s] %zd bytes", job->path, job->len);
+    }
+
+    if (ztx != NULL) {
+        ztx->cache_write = NULL;
+    }
+    free(job->json);
+    free(job);
+}
+
+static void cache_write(wheel_timer_t *t) {
+    ziti_context ztx = t->data;
+
+    if (ztx->api_session == NULL || ztx->api_session_state != ZitiApiSessionStateFullyAuthenticated) {
+        ZTX_LOG(VERBOSE, "not writing warm start cache: not authenticated");
+        return;
+    }
+
+    if (ztx->cache_write != NULL) {
+        // previous write is still running, try again later
+        ziti_cache_update(ztx);
+        return;
+    }
+
+    NEWP(job, struct cache_write_s);
+    if (cache_path(ztx, job->path, sizeof(job->path), "") != 0 ||
+        cache_path(ztx, job->tmp_path, sizeof(job->tmp_path), ".tmp") != 0) {
+        free(job);
+        return;
+    }
+
+    timestamp expires = {
+            .tv_sec = (long) ztx->api_session_expires_at.tv_sec,
+    };
+
+    // all members are borrowed from context
+    ziti_warm_cache cache = {
+            .controller = ztx->config.controller_url,
+            .api_session = ztx->api_session,
+            .api_session_expires = &expires,
+            .services = calloc(model_map_size(&ztx->services) + 1, sizeof(ziti_service *)),
+            .sessions = ztx->sessions,
+            .edge_routers = ztx->edge_routers,
+            .router_rtt = ztx->router_rtt,
+    };
+
+    int idx = 0;
+    __attribute__((unused)) const char *name;
+    ziti_service *s;
+    MODEL_MAP_FOREACH(name, s, &ztx->services) {
+        cache.services[idx++] = s;
+    }
+
+    job->json = ziti_warm_cache_to_json(&cache, MODEL_JSON_COMPACT, &job->len);
+    free(cache.services);
+    if (job->json == NULL) {
+        ZTX_LOG(WARN, "failed to serialize warm start cache");
+        free(job);
+        return;
+    }
+
+    job->w.data = job;
+    job->ztx = ztx;
+    int rc = uv_queue_work(ztx->loop, &job->w, cache_write_work, cache_write_done);
+    if (rc != 0) {
+        ZTX_LOG(WARN, "failed to schedule warm start cache write: %s", uv_strerror(rc));
+        free(job->json);
+        free(job);
+        return;
+    }
+    ztx->cache_write = job;
+}
+
+void ziti_cache_update(ziti_context ztx) {
+    if (ztx->opts.cache_dir == NULL || ztx->closing || wheel_timer_is_active(&ztx->cache_timer)) {
+        return;
+    }
+    wheel_timer_start(&ztx->timers, &ztx->cache_timer, CACHE_WRITE_DELAY, cache_write, ztx);
+}
+
+void ziti_cache_remove(ziti_context ztx) {
+    char path[1024];
+    if (cache_path(ztx, path, sizeof(path), "") != 0) {
+        return;
+    }
+
+    wheel_timer_stop(&ztx->cache_timer);
+    if (ztx->cache_write) {
+        ztx->cache_write->removed = true;
+    }
+
+    uv_fs_t req;
+    if (uv_fs_unlink(NULL, &req, path, NULL) == 0) {
+        ZTX_LOG(DEBUG, "removed warm start cache[%s]", path);
+    }
+    uv_fs_req_cleanup(&req);
+}
+
+void ziti_cache_free(ziti_context ztx) {
+    if (ztx->cache_write) {
+        ztx->cache_write->ztx = NULL;
+        ztx->cache_write = NULL;
+    }
+}
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <inttypes.h>
+#include <limits.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -20,6 +21,7 @@
 #include <uv.h>
 #include "utils.h"
 #include "zt_internal.h"
+#include "connect.h"
 #include <posture.h>
 #include <auth_queries.h>
 
@@ -41,6 +43,22 @@
 
 #define ztx_controller(ztx) ((ztx)->controller.url ? (ztx)->controller.url : (ztx)->config.controller_url)
 
+// granularity of shared write/connect/reply timeouts
+#define ZTX_TIMER_RESOLUTION 100
+
+// graceful drain: connections half-closed per loop iteration, and how often closed connections are counted
+#define DRAIN_BATCH 1024
+#define DRAIN_CHECK_INTERVAL 100
+
+// delay between connecting to the best edge routers, and to the rest of them
+#define ROUTER_CONNECT_STAGGER 250
+#define MEM_CHECK_INTERVAL 250
+#define ROUTER_CONNECT_INTERVAL 1000
+
+// write requests kept for reuse, more outstanding writes are allocated from the heap
+#define WRITE_REQ_POOL_SIZE 4096
+#define WRITE_REQ_SLAB_COUNT 64
+
 static const char *ALL_CONFIG_TYPES[] = {
         "all",
         NULL
@@ -66,6 +84,8 @@ static void api_session_cb(ziti_api_session *session, const ziti_error *err, voi
 
 static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, void *ctx);
 
+static void update_services(ziti_service_array services, const ziti_error *error, void *ctx);
+
 static void ziti_init_async(ziti_context ztx, void *data);
 
 static void ziti_re_auth(ziti_context ztx);
@@ -79,12 +99,22 @@ static void ziti_stop_internal(ziti_context ztx, void *data);
 
 static void ziti_start_internal(ziti_context ztx, void *init_req);
 
+static void ziti_warm_start(ziti_context ztx, ziti_warm_cache *cache);
+
 static void set_service_posture_policy_map(ziti_service *service);
 
 static void api_session_refresh(uv_timer_t *t);
 
 static void shutdown_and_free(ziti_context ztx);
 
+static void on_mem_check(wheel_timer_t *t);
+
+static void on_hibernate_check(wheel_timer_t *t);
+
+static int drain_remaining(ziti_context ztx);
+
+static void drain_done(ziti_context ztx, int remaining);
+
 static uint32_t ztx_seq;
 
 static const char *all_configs[] = { "all", NULL };
@@ -95,6 +125,14 @@ static ziti_options default_options = {
         .refresh_interval = 0,
         .router_keepalive = 15,
         .api_page_size = 25,
+        .api_page_window = 4,
+        .router_connections = 1,
+        .router_handshake_limit = 16,
+        .pq_process_jobs = 2,
+        .read_buf_size = DEFAULT_SLAB_BUF_SIZE,
+        .read_buf_count = 16,
+        .max_frame_size = 16 * 1024 * 1024,
+        .out_msg_pool_cap = 32,
 };
 
 static size_t parse_ref(const char *val, const char **res) {
@@ -189,7 +227,7 @@ int ziti_set_client_cert(ziti_context ztx, const char *cert_buf, size_t cert_len
     }
 
     if (ztx->tlsCtx->load_cert(&c, cert_buf, cert_len)) {
-        pk->free(pk);
+        (pk->free)(pk);
         return ZITI_INVALID_AUTHENTICATOR_CERT;
     }
 
@@ -239,10 +277,9 @@ int ziti_init_opts(ziti_options *options, uv_loop_t *loop) {
     ctx->ziti_timeout = ZITI_DEFAULT_TIMEOUT;
     ctx->ctrl_status = ZITI_WTF;
 
-    STAILQ_INIT(&ctx->w_queue);
+    mpsc_init(&ctx->w_queue);
     uv_async_init(loop, &ctx->w_async, ztx_work_async);
     ctx->w_async.data = ctx;
-    uv_mutex_init(&ctx->w_lock);
 
     NEWP(init_req, struct ziti_init_req);
     init_req->start = !options->disabled;
@@ -286,7 +323,7 @@ void ziti_set_unauthenticated(ziti_context ztx) {
             ztx->sessionCert = NULL;
         }
 
-        ztx->sessionKey->free(ztx->sessionKey);
+        (ztx->sessionKey->free)(ztx->sessionKey);
         ztx->sessionKey = NULL;
     }
 
@@ -301,6 +338,7 @@ void ziti_set_impossible_to_authenticate(ziti_context ztx) {
     ztx->api_session_state = ZitiApiSessionImpossibleToAuthenticate;
 
     ziti_ctrl_clear_api_session(&ztx->controller);
+    ziti_cache_remove(ztx);
 }
 
 void ziti_set_partially_authenticated(ziti_context ztx) {
@@ -340,6 +378,7 @@ static void logout_cb(void *resp, const ziti_error *err, void *ctx) {
     ziti_close_channels(ztx, ZITI_DISABLED);
 
     model_map_clear(&ztx->sessions, (_free_f) free_ziti_net_session_ptr);
+    intercept_index_clear(&ztx->intercepts);
     model_map_clear(&ztx->services, (_free_f) free_ziti_service_ptr);
 
     if (ztx->closing) {
@@ -389,19 +428,26 @@ static void ziti_stop_internal(ziti_context ztx, void *data) {
         // close all channels
         ziti_close_channels(ztx, ZITI_DISABLED);
 
+        // report drain that has not completed yet
+        if (ztx->drain) {
+            drain_done(ztx, drain_remaining(ztx));
+        }
+
         const char *svc_name;
         ziti_service *svc;
+        ztx_service_events_flush(ztx);
         ziti_event_t ev = {0};
         ev.type = ZitiServiceEvent;
         ev.event.service.removed = calloc(model_map_size(&ztx->services) + 1, sizeof(ziti_service *));
         int idx = 0;
+        intercept_index_clear(&ztx->intercepts);
         it = model_map_iterator(&ztx->services);
         while (it) {
             ev.event.service.removed[idx++] = model_map_it_value(it);
             it = model_map_it_remove(it);
         }
 
-        ziti_send_event(ztx, &ev);
+        ztx_service_event(ztx, &ev);
         free_ziti_service_array(&ev.event.service.removed);
 
         ziti_ctrl_cancel(&ztx->controller);
@@ -422,10 +468,66 @@ static void ziti_start_internal(ziti_context ztx, void *init_req) {
         ztx->enabled = true;
         uv_prepare_start(ztx->prepper, ztx_prepare);
         ziti_ctrl_get_version(&ztx->controller, version_cb, ztx);
-        ziti_set_unauthenticated(ztx);
 
-        ziti_re_auth(ztx);
+        ziti_warm_cache *cache = ztx->opts.cache_dir ? ziti_cache_read(ztx) : NULL;
+        if (cache) {
+            ziti_warm_start(ztx, cache);
+        } else {
+            ziti_set_unauthenticated(ztx);
+            ziti_re_auth(ztx);
+        }
+    }
+}
+
+// resume from cached state, and verify cached api session with controller in the background
+static void ziti_warm_start(ziti_context ztx, ziti_warm_cache *cache) {
+    ZTX_LOG(INFO, "warm start with cached api session[%s]", cache->api_session->id);
+
+    ztx->api_session = cache->api_session;
+    cache->api_session = NULL;
+    uv_gettimeofday(&ztx->session_received_at);
+    ztx->api_session_expires_at.tv_sec = cache->api_session_expires->tv_sec;
+    ztx->api_session_expires_at.tv_usec = 0;
+    ziti_ctrl_set_api_session(&ztx->controller, ztx->api_session);
+    ziti_set_fully_authenticated(ztx);
+
+    long delay_seconds = (long) (ztx->api_session_expires_at.tv_sec - ztx->session_received_at.tv_sec) -
+                         API_SESSION_DELAY_WINDOW_SECONDS;
+    if (delay_seconds < API_SESSION_MINIMUM_REFRESH_DELAY_SECONDS) {
+        delay_seconds = API_SESSION_MINIMUM_REFRESH_DELAY_SECONDS;
+    }
+    ziti_schedule_api_session_refresh(ztx, delay_seconds * 1000);
+
+    model_map_iter it = model_map_iterator(&cache->sessions);
+    while (it != NULL) {
+        ziti_net_session *ns = model_map_it_value(it);
+        if (ns->service_id == NULL) {
+            ns->service_id = strdup(model_map_it_key(it));
+        }
+        ziti_net_session *old = model_map_set(&ztx->sessions, ns->service_id, ns);
+        free_ziti_net_session_ptr(old);
+        it = model_map_it_remove(it);
+    }
+    ziti_session_refresh_schedule(ztx);
+
+    model_map_clear(&ztx->router_rtt, free);
+    ztx->router_rtt = cache->router_rtt;
+    memset(&cache->router_rtt, 0, sizeof(cache->router_rtt));
+    edge_routers_cb(cache->edge_routers, NULL, ztx);
+    cache->edge_routers = NULL;
+
+    if (cache->services) {
+        update_services(cache->services, NULL, ztx);
+        cache->services = NULL;
     }
+
+    free_ziti_warm_cache_ptr(cache);
+
+    NEWP(req, struct ziti_init_req);
+    req->ztx = ztx;
+    req->start = true;
+    ztx->active_session_request = true;
+    ziti_ctrl_current_api_session(&ztx->controller, api_session_cb, req);
 }
 
 static void on_ctrl_change(const char *new_addr, void *ctx) {
@@ -461,6 +563,10 @@ static void ziti_init_async(ziti_context ztx, void *data) {
     if (ztx->opts.api_page_size != 0) {
         ziti_ctrl_set_page_size(&ztx->controller, ztx->opts.api_page_size);
     }
+    if (ztx->opts.api_page_window != 0) {
+        ziti_ctrl_set_page_window(&ztx->controller, ztx->opts.api_page_window);
+    }
+    ziti_ctrl_set_service_filter(&ztx->controller, ztx->opts.service_names);
 
     ztx->api_session_timer = new_ztx_timer(ztx);
     ztx->service_refresh_timer = new_ztx_timer(ztx);
@@ -470,9 +576,36 @@ static void ziti_init_async(ziti_context ztx, void *data) {
     ztx->prepper->data = ztx;
     uv_unref((uv_handle_t *) ztx->prepper);
 
+    timer_wheel_init(&ztx->timers, loop, ZTX_TIMER_RESOLUTION);
+    if (ztx->opts.memory_limit > 0) {
+        wheel_timer_start(&ztx->timers, &ztx->mem_timer, MEM_CHECK_INTERVAL, on_mem_check, ztx);
+    }
+    if (ztx->opts.conn_hibernate_ms > 0) {
+        wheel_timer_start(&ztx->timers, &ztx->hibernate_timer, ztx->opts.conn_hibernate_ms, on_hibernate_check, ztx);
+    }
+
+    ztx->conn_flusher = calloc(1, sizeof(uv_idle_t));
+    uv_idle_init(loop, ztx->conn_flusher);
+    ztx->conn_flusher->data = ztx;
+    TAILQ_INIT(&ztx->flush_queue);
+    TAILQ_INIT(&ztx->close_queue);
+    LIST_INIT(&ztx->write_blocked);
+    LIST_INIT(&ztx->conn_pool);
+    ztx->intercepts.strings = &ztx->strings;
+    if (ztx->opts.share_resources) {
+        ztx_share_join(ztx);
+    } else {
+        ztx->keys = key_pool_new(loop);
+        ztx->read_bufs = buffer_slab_new(ztx->opts.read_buf_size, ztx->opts.read_buf_count);
+        ztx->out_msgs = msg_pools_new(ztx->opts.out_msg_pool_cap);
+    }
+
     ZTX_LOG(DEBUG, "using metrics interval: %d", (int) ztx->opts.metrics_type);
-    metrics_rate_init(&ztx->up_rate, ztx->opts.metrics_type);
-    metrics_rate_init(&ztx->down_rate, ztx->opts.metrics_type);
+    metrics_rate_init_loop(ztx->loop, &ztx->up_rate, ztx->opts.metrics_type);
+    metrics_rate_init_loop(ztx->loop, &ztx->down_rate, ztx->opts.metrics_type);
+
+    ztx->write_reqs = pool_new_slab(sizeof(struct ziti_write_req_s), WRITE_REQ_POOL_SIZE, WRITE_REQ_SLAB_COUNT, 0, false,
+                                    NULL);
 
     if (init_req->start) {
         ziti_start_internal(ztx, NULL);
@@ -537,6 +670,186 @@ void ziti_get_transfer_rates(ziti_context ztx, double *up, double *down) {
     *down = metrics_rate_get(&ztx->down_rate);
 }
 
+struct service_xfer *ziti_service_xfer(ziti_context ztx, const char *service) {
+    if (!ztx->opts.service_metrics || service == NULL) {
+        return NULL;
+    }
+
+    struct service_xfer *x = model_map_get(&ztx->service_xfers, service);
+    if (x == NULL) {
+        x = calloc(1, sizeof(*x));
+        metrics_rate_init_loop(ztx->loop, &x->up_rate, ztx->opts.metrics_type);
+        metrics_rate_init_loop(ztx->loop, &x->down_rate, ztx->opts.metrics_type);
+        model_map_set(&ztx->service_xfers, service, x);
+    }
+    return x;
+}
+
+static void free_service_xfer(struct service_xfer *x) {
+    metrics_rate_close(&x->up_rate);
+    metrics_rate_close(&x->down_rate);
+    free(x);
+}
+
+int ziti_service_get_transfer_stats(ziti_context ztx, const char *service, ziti_transfer_stats *stats) {
+    if (!ztx->opts.service_metrics) {
+        return ZITI_INVALID_STATE;
+    }
+
+    struct service_xfer *x = model_map_get(&ztx->service_xfers, service);
+    if (x == NULL) {
+        return ZITI_SERVICE_UNAVAILABLE;
+    }
+
+    *stats = (ziti_transfer_stats) {
+            .bytes_up = x->bytes_up,
+            .bytes_down = x->bytes_down,
+            .msgs_up = x->msgs_up,
+            .msgs_down = x->msgs_down,
+            .rate_up = metrics_rate_get(&x->up_rate),
+            .rate_down = metrics_rate_get(&x->down_rate),
+    };
+    return ZITI_OK;
+}
+
+void ziti_get_path_stats(ziti_context ztx, ziti_path_stats *stats) {
+    *stats = ztx->path_stats;
+}
+
+static size_t channel_mem(ziti_channel_t *ch, size_t *outbound) {
+    size_t in = ch->incoming ? buffer_available(ch->incoming) : 0;
+    *outbound += ch->out_q_bytes;
+    for (int i = 0; i < ch->num_stripes; i++) {
+        in += channel_mem(ch->stripes[i], outbound);
+    }
+    return in;
+}
+
+static void get_memory_usage(ziti_context ztx, ziti_memory_usage *u) {
+    memset(u, 0, sizeof(*u));
+    u->limit = ztx->opts.memory_limit;
+
+    __attribute__((unused)) const char *url;
+    ziti_channel_t *ch;
+    MODEL_MAP_FOREACH(url, ch, &ztx->channels) {
+        u->channels += channel_mem(ch, &u->outbound);
+    }
+
+    model_map_iter it = model_map_iterator(&ztx->connections);
+    while (it != NULL) {
+        struct ziti_conn *conn = model_map_it_value(it);
+        if (conn->type == Transport) {
+            if (conn->inbound) {
+                u->inbound += buffer_available(conn->inbound);
+            }
+            message *m;
+            TAILQ_FOREACH(m, &conn->in_q, _next) {
+                u->inbound += m->msgbuflen;
+            }
+            struct ziti_write_req_s *req;
+            TAILQ_FOREACH(req, &conn->wreqs, _next) {
+                u->outbound += req->len;
+            }
+        }
+        it = model_map_it_next(it);
+    }
+
+    u->pools = ztx->conn_pool_size * sizeof(struct ziti_conn) +
+               key_pool_available(ztx->keys) * sizeof(struct key_pair) +
+               (size_t) ztx->opts.read_buf_count * ztx->opts.read_buf_size;
+    struct msg_pool_stats stats[MSG_SIZE_CLASSES];
+    uint64_t oversize;
+    msg_pools_stats(ztx->out_msgs, stats, &oversize);
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        u->pools += stats[i].high_water * stats[i].size;
+    }
+    size_t write_reqs_max;
+    pool_usage(ztx->write_reqs, NULL, &write_reqs_max);
+    u->pools += write_reqs_max * sizeof(struct ziti_write_req_s);
+
+    u->total = u->channels + u->inbound + u->outbound + u->pools;
+}
+
+int ziti_get_memory_usage(ziti_context ztx, ziti_memory_usage *usage) {
+    if (ztx == NULL || usage == NULL) {
+        return ZITI_INVALID_STATE;
+    }
+    get_memory_usage(ztx, usage);
+    return ZITI_OK;
+}
+
+// over the limit until usage drops under 7/8 of it, so that the state does not flap
+static void on_mem_check(wheel_timer_t *t) {
+    ziti_context ztx = t->data;
+    ziti_memory_usage u;
+    get_memory_usage(ztx, &u);
+
+    bool over = ztx->mem_over ? u.total >= u.limit - u.limit / 8 : u.total >= u.limit;
+    // pausing reads only helps if received data is what uses the memory,
+    // queued writes still drain while reads are paused
+    ztx->mem_read_paused = over && u.channels + u.inbound >= u.outbound;
+
+    if (over != ztx->mem_over) {
+        ztx->mem_over = over;
+        if (over) {
+            ZTX_LOG(WARN, "memory limit[%zu] reached: channels[%zu] inbound[%zu] outbound[%zu] pools[%zu]",
+                    u.limit, u.channels, u.inbound, u.outbound, u.pools);
+        } else {
+            ZTX_LOG(INFO, "memory usage[%zu] is back under limit[%zu]", u.total, u.limit);
+        }
+        ziti_event_t ev = {
+                .type = ZitiMemoryEvent,
+                .event.memory = {
+                        .over_limit = over,
+                        .limit = u.limit,
+                        .used = u.total,
+                },
+        };
+        ziti_send_event(ztx, &ev);
+    }
+
+    wheel_timer_start(&ztx->timers, &ztx->mem_timer, MEM_CHECK_INTERVAL, on_mem_check, ztx);
+}
+
+static void on_hibernate_check(wheel_timer_t *t) {
+    ziti_context ztx = t->data;
+    conn_hibernate_idle(ztx);
+    wheel_timer_start(&ztx->timers, &ztx->hibernate_timer, ztx->opts.conn_hibernate_ms, on_hibernate_check, ztx);
+}
+
+void ziti_get_read_buf_stats(ziti_context ztx, uint64_t *hits, uint64_t *misses) {
+    buffer_slab_stats(ztx->read_bufs, hits, misses);
+}
+
+void ziti_get_out_msg_stats(ziti_context ztx, uint64_t *hits, uint64_t *misses, size_t *high_water) {
+    struct msg_pool_stats stats[MSG_SIZE_CLASSES];
+    uint64_t oversize;
+    msg_pools_stats(ztx->out_msgs, stats, &oversize);
+
+    uint64_t h = 0, m = oversize;
+    size_t hw = 0;
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        h += stats[i].hits;
+        m += stats[i].misses;
+        hw += stats[i].high_water;
+    }
+    if (hits) *hits = h;
+    if (misses) *misses = m;
+    if (high_water) *high_water = hw;
+}
+
+int ziti_get_router_rtt(ziti_context ztx, const char *router, ziti_rtt_stats *stats) {
+    const char *url;
+    ziti_channel_t *ch;
+    MODEL_MAP_FOREACH(url, ch, &ztx->channels) {
+        if (strcmp(url, router) == 0 || (ch->name && strcmp(ch->name, router) == 0)) {
+            ziti_channel_rtt_stats(ch, stats);
+            return ZITI_OK;
+        }
+    }
+    return ZITI_NOT_FOUND;
+}
+
 int ziti_set_timeout(ziti_context ztx, int timeout) {
     if (timeout > 0) {
         ztx->ziti_timeout = timeout;
@@ -554,13 +867,32 @@ static void free_ztx(uv_handle_t *h) {
 
     ziti_auth_query_free(ztx->auth_queries);
     ziti_posture_checks_free(ztx->posture_checks);
+    intercept_index_clear(&ztx->intercepts);
+    ztx_service_events_free(ztx);
+    ziti_cache_free(ztx);
     model_map_clear(&ztx->services, (_free_f) free_ziti_service_ptr);
+    model_map_clear(&ztx->session_fetches, NULL);
     model_map_clear(&ztx->sessions, (_free_f) free_ziti_net_session_ptr);
+    FREE(ztx->pending_routers);
+    free_ziti_edge_router_array(&ztx->edge_routers);
+    model_map_clear(&ztx->router_rtt, free);
+    ziti_metrics_sink_free(ztx);
+    model_map_clear(&ztx->service_xfers, (_free_f) free_service_xfer);
     ziti_set_unauthenticated(ztx);
     free_ziti_identity_data(ztx->identity_data);
     FREE(ztx->identity_data);
     FREE(ztx->last_update);
     free_ziti_config(&ztx->config);
+    ztx_share_leave(ztx);
+    buffer_slab_free(ztx->read_bufs);
+    conn_pool_free(ztx);
+    key_pool_free(ztx->keys);
+    msg_pools_free(ztx->out_msgs);
+    if (ztx->write_reqs) {
+        // requests still in flight are freed when returned
+        pool_destroy(ztx->write_reqs);
+    }
+    str_intern_clear(&ztx->strings);
 
     ziti_event_t ev = {0};
     ev.type = ZitiContextEvent;
@@ -586,6 +918,9 @@ static void shutdown_and_free(ziti_context ztx) {
 
     grim_reaper(ztx);
     CLOSE_AND_NULL(ztx->prepper);
+    CLOSE_AND_NULL(ztx->conn_flusher);
+    CLOSE_AND_NULL(ztx->drainer);
+    timer_wheel_close(&ztx->timers);
     CLOSE_AND_NULL(ztx->api_session_timer);
     CLOSE_AND_NULL(ztx->service_refresh_timer);
 
@@ -601,6 +936,138 @@ int ziti_shutdown(ziti_context ztx) {
     return ZITI_OK;
 }
 
+struct ztx_drain_s {
+    uint64_t timeout;
+    uint64_t deadline;
+    ziti_drain_cb cb;
+    void *ctx;
+
+    // connections to half-close
+    uint32_t *ids;
+    size_t count;
+    size_t pos;
+
+    wheel_timer_t timer;
+};
+
+// connections that have not been closed by either side
+static int drain_remaining(ziti_context ztx) {
+    int count = 0;
+    __attribute__((unused)) const char *id;
+    struct ziti_conn *conn;
+    MODEL_MAP_FOREACH(id, conn, &ztx->connections) {
+        if (conn->type == Transport && !conn->close && conn->state < Timedout) {
+            count++;
+        }
+    }
+    return count;
+}
+
+static void drain_done(ziti_context ztx, int remaining) {
+    struct ztx_drain_s *d = ztx->drain;
+    ztx->drain = NULL;
+
+    wheel_timer_stop(&d->timer);
+    if (ztx->drainer) {
+        uv_idle_stop(ztx->drainer);
+    }
+
+    ZTX_LOG(INFO, "drain is complete, %d connection(s) remaining", remaining);
+    if (d->cb) {
+        d->cb(ztx, remaining, d->ctx);
+    }
+    free(d->ids);
+    free(d);
+}
+
+static void on_drain_check(wheel_timer_t *t) {
+    ziti_context ztx = t->data;
+    struct ztx_drain_s *d = ztx->drain;
+
+    int remaining = drain_remaining(ztx);
+    if (remaining == 0 || uv_now(ztx->loop) >= d->deadline) {
+        drain_done(ztx, remaining);
+        return;
+    }
+
+    ZTX_LOG(DEBUG, "draining: waiting for %d connection(s) to close", remaining);
+    wheel_timer_start(&ztx->timers, &d->timer, DRAIN_CHECK_INTERVAL, on_drain_check, ztx);
+}
+
+static void on_drain_batch(uv_idle_t *idle) {
+    ziti_context ztx = idle->data;
+    struct ztx_drain_s *d = ztx->drain;
+
+    // connections could be closed (and their ids reused) since drain started, look them up again
+    size_t end = MIN(d->pos + DRAIN_BATCH, d->count);
+    for (; d->pos < end; d->pos++) {
+        struct ziti_conn *conn = model_map_getl(&ztx->connections, (long) d->ids[d->pos]);
+        if (conn && conn->type == Transport && !conn->close && conn->state == Connected) {
+            ziti_close_write(conn);
+        }
+    }
+
+    if (d->pos == d->count) {
+        uv_idle_stop(idle);
+        ZTX_LOG(DEBUG, "draining: sent FIN to %zd connection(s)", d->count);
+        d->timer.data = ztx;
+        on_drain_check(&d->timer);
+    }
+}
+
+static void ziti_drain_internal(ziti_context ztx, void *data) {
+    struct ztx_drain_s *d = data;
+    d->deadline = uv_now(ztx->loop) + d->timeout;
+    ztx->drain = d;
+
+    if (!ztx->enabled) {
+        drain_done(ztx, drain_remaining(ztx));
+        return;
+    }
+
+    size_t servers = 0;
+    d->ids = calloc(model_map_size(&ztx->connections) + 1, sizeof(uint32_t));
+
+    __attribute__((unused)) const char *id;
+    struct ziti_conn *conn;
+    MODEL_MAP_FOREACH(id, conn, &ztx->connections) {
+        if (conn->close) {
+            continue;
+        }
+        if (conn->type == Server) {
+            // remove terminators, server connection stays open until application closes it
+            ziti_close_server(conn);
+            servers++;
+        } else if (conn->type == Transport) {
+            d->ids[d->count++] = conn->conn_id;
+        }
+    }
+    ZTX_LOG(INFO, "draining %zd connection(s), unbinding %zd server(s)", d->count, servers);
+
+    if (ztx->drainer == NULL) {
+        ztx->drainer = calloc(1, sizeof(uv_idle_t));
+        uv_idle_init(ztx->loop, ztx->drainer);
+        ztx->drainer->data = ztx;
+    }
+    uv_idle_start(ztx->drainer, on_drain_batch);
+}
+
+int ziti_drain(ziti_context ztx, uint64_t timeout, ziti_drain_cb drain_cb, void *ctx) {
+    if (ztx->closing || ztx->draining) {
+        return ZITI_INVALID_STATE;
+    }
+
+    ZTX_LOG(INFO, "draining, timeout[%" PRIu64 "ms]", timeout);
+    ztx->draining = true;
+
+    NEWP(d, struct ztx_drain_s);
+    d->timeout = timeout;
+    d->cb = drain_cb;
+    d->ctx = ctx;
+    ziti_queue_work(ztx, ziti_drain_internal, d);
+    return ZITI_OK;
+}
+
 const char *ziti_get_appdata_raw(ziti_context ztx, const char *key) {
     if (ztx->identity_data == NULL) return NULL;
 
@@ -621,12 +1088,24 @@ int ziti_get_appdata(ziti_context ztx, const char *key, void *data,
 }
 
 
+static void dump_histogram(const histogram_t *h, int (*printer)(void *arg, const char *fmt, ...), void *ctx) {
+    printer(ctx, "latency[avg=%.1f p50=%" PRIu64 " p90=%" PRIu64 " p99=%" PRIu64 " max=%" PRIu64 "]\n",
+            metrics_hist_mean(h), metrics_hist_percentile(h, 50), metrics_hist_percentile(h, 90),
+            metrics_hist_percentile(h, 99), h->max);
+}
+
 void ziti_dump(ziti_context ztx, int (*printer)(void *arg, const char *fmt, ...), void *ctx) {
     printer(ctx, "\n=================\nZiti Context:\n");
     printer(ctx, "ID:\t%d\n", ztx->id);
     printer(ctx, "Enabled:\t%s\n", ziti_is_enabled(ztx) ? "true" : "false");
     printer(ctx, "Config:\t%s\n", ztx->opts.config);
     printer(ctx, "Controller:\t%s\n", ztx_controller(ztx));
+    for (int lane = 0; lane < CTRL_LANES; lane++) {
+        const struct ctrl_req_stats *st = &ztx->controller.stats[lane];
+        printer(ctx, "\t%s requests[count=%" PRIu64 " errors=%u last=%" PRIu64 "ms] ",
+                ziti_ctrl_lane_name(lane), st->latency.count, st->errors, st->last);
+        dump_histogram(&st->latency, printer, ctx);
+    }
     printer(ctx, "Config types:\n");
     for (int i = 0; ztx->opts.config_types && ztx->opts.config_types[i]; i++) {
         printer(ctx, "\t%s\n", ztx->opts.config_types[i]);
@@ -685,27 +1164,85 @@ void ziti_dump(ziti_context ztx, int (*printer)(void *arg, const char *fmt, ...)
     }
 
     printer(ctx, "\n==================\nChannels:\n");
+    uint64_t buf_hits, buf_misses;
+    buffer_slab_stats(ztx->read_bufs, &buf_hits, &buf_misses);
+    printer(ctx, "read buffers: hits[%" PRIu64 "] misses[%" PRIu64 "]\n", buf_hits, buf_misses);
+    struct msg_pool_stats msg_stats[MSG_SIZE_CLASSES];
+    uint64_t msg_oversize;
+    msg_pools_stats(ztx->out_msgs, msg_stats, &msg_oversize);
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        printer(ctx, "outbound messages[<=%zu]: hits[%" PRIu64 "] misses[%" PRIu64 "] high_water[%zu]\n",
+                msg_stats[i].size, msg_stats[i].hits, msg_stats[i].misses, msg_stats[i].high_water);
+    }
+    printer(ctx, "outbound messages[oversize]: %" PRIu64 "\n", msg_oversize);
+    const ziti_path_stats *ps = &ztx->path_stats;
+    printer(ctx, "data path: framed[%" PRIu64 " in_place=%" PRIu64 "] dispatched[data=%" PRIu64 " state=%" PRIu64
+                 " replies=%" PRIu64 " other=%" PRIu64 "] copied[%" PRIu64 "] allocs[%" PRIu64 "] read_stalls[%" PRIu64
+                 "] flush_budget_hits[%" PRIu64 "] bridge_writes[%" PRIu64 " chunks=%" PRIu64
+                 "] dgrams_dropped[%" PRIu64 "] dials_shed[%" PRIu64 "] writes_coalesced[%" PRIu64 "] crypto_offloaded[%" PRIu64
+                 "] early_writes[%" PRIu64 "] raced_dials[%" PRIu64 " wins=%" PRIu64 "] hibernated[%" PRIu64
+                 " woken=%" PRIu64 "] bind_migrations[%" PRIu64 "] e2e_aes_gcm[%" PRIu64 "] write_blocks[%" PRIu64 "]\n",
+            ps->msgs_framed, ps->msgs_framed_in_place, ps->msgs_data, ps->msgs_state, ps->msgs_replies, ps->msgs_other,
+            ps->bytes_copied, ps->allocs, ps->read_stalls, ps->flush_budget_hits,
+            ps->bridge_writes, ps->bridge_write_chunks, ps->dgrams_dropped, ps->dials_shed,
+            ps->writes_coalesced, ps->crypto_offloaded, ps->early_writes, ps->raced_dials, ps->race_wins,
+            ps->conns_hibernated, ps->conns_woken, ps->bind_migrations, ps->e2e_aes_gcm, ps->write_blocks);
+    ziti_memory_usage mem;
+    get_memory_usage(ztx, &mem);
+    printer(ctx, "memory: total[%zu] limit[%zu]%s channels[%zu] inbound[%zu] outbound[%zu] pools[%zu]\n",
+            mem.total, mem.limit, ztx->mem_over ? " OVER" : "",
+            mem.channels, mem.inbound, mem.outbound, mem.pools);
     ziti_channel_t *ch;
     const char *url;
     MODEL_MAP_FOREACH(url, ch, &ztx->channels) {
         printer(ctx, "ch[%d](%s@%s) ", ch->id, ch->name, url);
         if (ziti_channel_is_connected(ch)) {
-            printer(ctx, "connected [latency=%" PRIu64 "]\n", ch->latency);
+            ziti_rtt_stats rtt;
+            ziti_channel_rtt_stats(ch, &rtt);
+            int health = ziti_channel_health(ch);
+            printer(ctx, "connected [latency=%" PRIu64 "] rtt[min=%" PRIu64 " avg=%" PRIu64
+                         " p50=%" PRIu64 " p99=%" PRIu64 " samples=%zd] health[%d%s]\n",
+                    ch->latency, rtt.min, rtt.avg, rtt.p50, rtt.p99, rtt.samples,
+                    health, ch->degraded ? " degraded" : "");
         }
         else {
-            printer(ctx, "Disconnected\n");
+            printer(ctx, "Disconnected reconnect[attempt=%u delay=%" PRIu64 "ms]%s\n",
+                    ch->reconnect_count, ch->reconnect_delay, ch->reconnect_queued ? " waiting for handshake slot" : "");
+        }
+        if (ch->handshakes > 0) {
+            printer(ctx, "\ttls handshakes[count=%u last=%" PRIu64 "ms avg=%" PRIu64 "ms]\n",
+                    ch->handshakes, ch->handshake_last, ch->handshake_total / ch->handshakes);
+        }
+        if (ch->write_delay.count > 0) {
+            printer(ctx, "\twrite delay ");
+            dump_histogram(&ch->write_delay, printer, ctx);
+        }
+        for (int i = 0; i < ch->num_stripes; i++) {
+            ziti_channel_t *stripe = ch->stripes[i];
+            printer(ctx, "\tstripe ch[%d] %s\n", stripe->id,
+                    ziti_channel_is_connected(stripe) ? "connected" : "Disconnected");
         }
     }
 
+    printer(ctx, "\ndial time[count=%" PRIu64 "] ", ztx->dial_time.count);
+    dump_histogram(&ztx->dial_time, printer, ctx);
+    for (int i = 0; ztx->opts.dial_timings && i < DIAL_PHASES; i++) {
+        printer(ctx, "\tphase[%s] ", ziti_dial_phase_name(i));
+        dump_histogram(&ztx->dial_phases[i], printer, ctx);
+    }
+
     printer(ctx, "\n==================\nConnections:\n");
     ziti_connection conn;
     const char *id;
     MODEL_MAP_FOREACH(id, conn, &ztx->connections) {
         if (conn->type == Transport && conn->parent == NULL) {
-            printer(ctx, "conn[%d]: state[%s] service[%s] using ch[%d] %s\n",
+            printer(ctx, "conn[%d]: state[%s] service[%s] using ch[%d] %s inbound[%zu max=%zu pinned=%zu]%s\n",
                     conn->conn_id, ziti_conn_state(conn), conn->service,
                     FIELD_OR_ELSE(conn->channel, id, -1),
-                    FIELD_OR_ELSE(conn->channel, name, "(none)")
+                    FIELD_OR_ELSE(conn->channel, name, "(none)"),
+                    conn->inbound ? buffer_available(conn->inbound) : 0, conn->inbound_max,
+                    conn->inbound ? buffer_owned_chunks(conn->inbound) : 0,
+                    conn->recv_overflow ? " receive window exceeded" : ""
             );
         }
 
@@ -729,6 +1266,172 @@ void ziti_dump(ziti_context ztx, int (*printer)(void *arg, const char *fmt, ...)
     printer(ctx, "\n==================\n\n");
 }
 
+static void json_str(string_buf_t *b, const char *s) {
+    if (s == NULL) {
+        string_buf_append(b, "null");
+    } else {
+        get_string_meta()->jsonifier(s, b, 0, 0);
+    }
+}
+
+static void json_histogram(string_buf_t *b, const histogram_t *h) {
+    string_buf_fmt(b, "{\"count\":%" PRIu64 ",\"avg\":%.1f,\"p50\":%" PRIu64 ",\"p90\":%" PRIu64
+                      ",\"p99\":%" PRIu64 ",\"max\":%" PRIu64 "}",
+                   h->count, metrics_hist_mean(h), metrics_hist_percentile(h, 50),
+                   metrics_hist_percentile(h, 90), metrics_hist_percentile(h, 99), h->max);
+}
+
+static void json_channel(string_buf_t *b, ziti_channel_t *ch) {
+    bool connected = ziti_channel_is_connected(ch);
+    string_buf_fmt(b, "{\"id\":%u,\"name\":", ch->id);
+    json_str(b, ch->name);
+    string_buf_append(b, ",\"url\":");
+    json_str(b, ch->url);
+    string_buf_fmt(b, ",\"connected\":%s,\"latency\":%" PRIu64 ",\"reconnects\":%u",
+                   connected ? "true" : "false", ch->latency, ch->reconnect_count);
+    if (connected) {
+        ziti_rtt_stats rtt;
+        ziti_channel_rtt_stats(ch, &rtt);
+        string_buf_fmt(b, ",\"rtt\":{\"min\":%" PRIu64 ",\"avg\":%" PRIu64 ",\"p50\":%" PRIu64
+                          ",\"p99\":%" PRIu64 ",\"samples\":%zd}",
+                       rtt.min, rtt.avg, rtt.p50, rtt.p99, rtt.samples);
+        int health = ziti_channel_health(ch);
+        string_buf_fmt(b, ",\"health\":%d,\"degraded\":%s", health, ch->degraded ? "true" : "false");
+    }
+
+    size_t in_use = 0, in_max = 0;
+    if (ch->in_msg_pool) {
+        pool_usage(ch->in_msg_pool, &in_use, &in_max);
+    }
+    string_buf_fmt(b, ",\"out_q\":%zu,\"out_q_bytes\":%zu,\"out_inflight\":%zu"
+                      ",\"in_msg_pool\":{\"in_use\":%zu,\"max\":%zu},\"receivers\":%zu,\"write_delay\":",
+                   ch->out_q, ch->out_q_bytes, ch->out_inflight, in_use, in_max,
+                   model_map_size(&ch->receivers));
+    json_histogram(b, &ch->write_delay);
+
+    if (ch->num_stripes > 0) {
+        string_buf_append(b, ",\"stripes\":[");
+        for (int i = 0; i < ch->num_stripes; i++) {
+            if (i > 0) string_buf_append_byte(b, ',');
+            json_channel(b, ch->stripes[i]);
+        }
+        string_buf_append_byte(b, ']');
+    }
+    string_buf_append_byte(b, '}');
+}
+
+static void json_conn(string_buf_t *b, ziti_connection conn) {
+    string_buf_fmt(b, "{\"id\":%u,\"state\":\"%s\",\"service\":", conn->conn_id, ziti_conn_state(conn));
+    json_str(b, conn->service);
+    if (conn->type == Server) {
+        string_buf_fmt(b, ",\"server\":true,\"terminators\":%zu,\"children\":%zu}",
+                       model_map_size(&conn->server.bindings), model_map_size(&conn->server.children));
+        return;
+    }
+
+    string_buf_fmt(b, ",\"channel\":%d,\"inbound\":%zu,\"inbound_max\":%zu,\"write_reqs\":%d"
+                      ",\"bytes_up\":%" PRIu64 ",\"bytes_down\":%" PRIu64
+                      ",\"msgs_up\":%" PRIu64 ",\"msgs_down\":%" PRIu64 "%s}",
+                   conn->channel ? (int) conn->channel->id : -1,
+                   conn->inbound ? buffer_available(conn->inbound) : 0, conn->inbound_max, conn->write_reqs,
+                   conn->bytes_up, conn->bytes_down, conn->msgs_up, conn->msgs_down,
+                   conn->parent ? ",\"accepted\":true" : "");
+}
+
+char *ziti_dump_json(ziti_context ztx, size_t *len) {
+    string_buf_t b;
+    string_buf_init_sized(&b, ztx->dump_json_size ? ztx->dump_json_size : 4096);
+
+    string_buf_fmt(&b, "{\"id\":%u,\"enabled\":%s,\"controller\":", ztx->id, ziti_is_enabled(ztx) ? "true" : "false");
+    json_str(&b, ztx_controller(ztx));
+    string_buf_fmt(&b, ",\"api_session_state\":%d", ztx->api_session_state);
+
+    string_buf_append(&b, ",\"controller_requests\":{");
+    for (int lane = 0; lane < CTRL_LANES; lane++) {
+        const struct ctrl_req_stats *st = &ztx->controller.stats[lane];
+        string_buf_fmt(&b, "%s\"%s\":{\"errors\":%u,\"last\":%" PRIu64 ",\"latency\":",
+                       lane > 0 ? "," : "", ziti_ctrl_lane_name(lane), st->errors, st->last);
+        json_histogram(&b, &st->latency);
+        string_buf_append_byte(&b, '}');
+    }
+    string_buf_append_byte(&b, '}');
+
+    uint64_t buf_hits, buf_misses;
+    buffer_slab_stats(ztx->read_bufs, &buf_hits, &buf_misses);
+    string_buf_fmt(&b, ",\"pools\":{\"read_buffers\":{\"hits\":%" PRIu64 ",\"misses\":%" PRIu64 "},\"out_messages\":[",
+                   buf_hits, buf_misses);
+    struct msg_pool_stats msg_stats[MSG_SIZE_CLASSES];
+    uint64_t msg_oversize;
+    msg_pools_stats(ztx->out_msgs, msg_stats, &msg_oversize);
+    for (int i = 0; i < MSG_SIZE_CLASSES; i++) {
+        string_buf_fmt(&b, "%s{\"size\":%zu,\"hits\":%" PRIu64 ",\"misses\":%" PRIu64 ",\"high_water\":%zu}",
+                       i > 0 ? "," : "", msg_stats[i].size, msg_stats[i].hits, msg_stats[i].misses,
+                       msg_stats[i].high_water);
+    }
+    string_buf_fmt(&b, "],\"out_messages_oversize\":%" PRIu64 "}", msg_oversize);
+
+    const ziti_path_stats *ps = &ztx->path_stats;
+    string_buf_fmt(&b, ",\"data_path\":{\"msgs_framed\":%" PRIu64 ",\"msgs_framed_in_place\":%" PRIu64
+                       ",\"msgs_data\":%" PRIu64 ",\"msgs_state\":%" PRIu64 ",\"msgs_replies\":%" PRIu64
+                       ",\"msgs_other\":%" PRIu64 ",\"bytes_copied\":%" PRIu64 ",\"allocs\":%" PRIu64
+                       ",\"read_stalls\":%" PRIu64 ",\"flush_budget_hits\":%" PRIu64
+                       ",\"bridge_writes\":%" PRIu64 ",\"bridge_write_chunks\":%" PRIu64
+                       ",\"dgrams_dropped\":%" PRIu64 ",\"dials_shed\":%" PRIu64 ",\"writes_coalesced\":%" PRIu64 ",\"crypto_offloaded\":%" PRIu64
+                       ",\"early_writes\":%" PRIu64 ",\"raced_dials\":%" PRIu64 ",\"race_wins\":%" PRIu64
+                       ",\"conns_hibernated\":%" PRIu64 ",\"conns_woken\":%" PRIu64
+                       ",\"bind_migrations\":%" PRIu64 ",\"e2e_aes_gcm\":%" PRIu64 ",\"write_blocks\":%" PRIu64 "}",
+                   ps->msgs_framed, ps->msgs_framed_in_place, ps->msgs_data, ps->msgs_state, ps->msgs_replies,
+                   ps->msgs_other, ps->bytes_copied, ps->allocs, ps->read_stalls, ps->flush_budget_hits,
+                   ps->bridge_writes, ps->bridge_write_chunks, ps->dgrams_dropped, ps->dials_shed,
+                   ps->writes_coalesced, ps->crypto_offloaded, ps->early_writes, ps->raced_dials, ps->race_wins,
+                   ps->conns_hibernated, ps->conns_woken, ps->bind_migrations, ps->e2e_aes_gcm, ps->write_blocks);
+
+    string_buf_fmt(&b, ",\"services\":%zu,\"sessions\":%zu,\"dial_time\":",
+                   model_map_size(&ztx->services), model_map_size(&ztx->sessions));
+    json_histogram(&b, &ztx->dial_time);
+    if (ztx->opts.dial_timings) {
+        string_buf_append(&b, ",\"dial_phases\":{");
+        for (int i = 0; i < DIAL_PHASES; i++) {
+            string_buf_fmt(&b, "%s\"%s\":", i > 0 ? "," : "", ziti_dial_phase_name(i));
+            json_histogram(&b, &ztx->dial_phases[i]);
+        }
+        string_buf_append_byte(&b, '}');
+    }
+
+    string_buf_append(&b, ",\"channels\":[");
+    bool first = true;
+    ziti_channel_t *ch;
+    __attribute__((unused)) const char *url;
+    MODEL_MAP_FOREACH(url, ch, &ztx->channels) {
+        if (!first) string_buf_append_byte(&b, ',');
+        first = false;
+        json_channel(&b, ch);
+    }
+
+    string_buf_append(&b, "],\"connections\":[");
+    first = true;
+    ziti_connection conn;
+    __attribute__((unused)) const char *id;
+    MODEL_MAP_FOREACH(id, conn, &ztx->connections) {
+        if (conn->type != Transport && conn->type != Server) {
+            continue;
+        }
+        if (!first) string_buf_append_byte(&b, ',');
+        first = false;
+        json_conn(&b, conn);
+    }
+    string_buf_append(&b, "]}");
+
+    size_t out_len;
+    char *json = string_buf_to_string(&b, &out_len);
+    string_buf_free(&b);
+    ztx->dump_json_size = out_len + 1;
+    if (len) {
+        *len = out_len;
+    }
+    return json;
+}
+
 int ziti_conn_init(ziti_context ztx, ziti_connection *conn, void *data) {
     struct ziti_ctx *ctx = ztx;
     NEWP(c, struct ziti_conn);
@@ -771,7 +1474,7 @@ void ziti_send_event(ziti_context ztx, const ziti_event_t *e) {
 
 struct service_req_s {
     struct ziti_ctx *ztx;
-    char *service;
+    const char *service; // interned
     ziti_service_cb cb;
     void *cb_ctx;
 };
@@ -803,7 +1506,7 @@ static void service_cb(ziti_service *s, const ziti_error *err, void *ctx) {
     }
 
     req->cb(req->ztx, s, rc, req->cb_ctx);
-    FREE(req->service);
+    str_intern_release(&req->ztx->strings, req->service);
     free(req);
 }
 
@@ -818,7 +1521,7 @@ int ziti_service_available(ziti_context ztx, const char *service, ziti_service_c
 
     NEWP(req, struct service_req_s);
     req->ztx = ztx;
-    req->service = strdup(service);
+    req->service = str_intern_get(&ztx->strings, service);
     req->cb = cb;
     req->cb_ctx = ctx;
 
@@ -836,35 +1539,8 @@ const ziti_service *ziti_service_for_addr_str(ziti_context ztx, ziti_protocol pr
 }
 
 const ziti_service *ziti_service_for_addr(ziti_context ztx, ziti_protocol proto, const ziti_address *addr, int port) {
-    int best_score = -1;
-    ziti_service *best = NULL;
-
-    ziti_service *srv;
-    const char *name;
-    MODEL_MAP_FOREACH(name, srv, &ztx->services) {
-        ziti_intercept_cfg_v1 intercept = {0};
-        ziti_client_cfg_v1 clt_cfg = {0};
-        if (ziti_service_get_config(srv, ZITI_INTERCEPT_CFG_V1, &intercept, (parse_service_cfg_f) parse_ziti_intercept_cfg_v1) == ZITI_OK ||
-                (ziti_service_get_config(srv, ZITI_CLIENT_CFG_V1, &clt_cfg, (parse_service_cfg_f) parse_ziti_client_cfg_v1) == ZITI_OK &&
-                 ziti_intercept_from_client_cfg(&intercept, &clt_cfg) == ZITI_OK
-                )
-        ) {
-            int match = ziti_intercept_match2(&intercept, proto, addr, port);
-
-            if (match == -1) { continue; }
-
-            // best possible match
-            if (match == 0) { return srv; }
-
-            if (best_score == -1 || best_score > match) {
-                best_score = match;
-                best = srv;
-            }
-        }
-        free_ziti_intercept_cfg_v1(&intercept);
-        free_ziti_client_cfg_v1(&clt_cfg);
-    }
-    return best;
+    const char *name = intercept_index_lookup(&ztx->intercepts, proto, addr, port);
+    return name ? model_map_get(&ztx->services, name) : NULL;
 }
 
 
@@ -1113,6 +1789,10 @@ static void update_services(ziti_service_array services, const ziti_error *error
     }
     update_ctrl_status(ztx, ZITI_OK, NULL);
 
+    if (services == NULL) {
+        ZTX_LOG(VERBOSE, "services not modified");
+        return;
+    }
 
     ZTX_LOG(VERBOSE, "processing service updates");
 
@@ -1144,7 +1824,11 @@ static void update_services(ziti_service_array services, const ziti_error *error
         ziti_service *updt = model_map_remove(&updates, model_map_it_key(it));
 
         if (updt != NULL) {
-            if (is_service_updated(ztx, updt, model_map_it_value(it)) != 0) {
+            ziti_service *current = model_map_it_value(it);
+            // same content hash: skip full compare unless service update is forced
+            bool same = ziti_service_cached_hash(updt) == ziti_service_cached_hash(current) &&
+                        model_map_get(&ztx->service_forced_updates, updt->id) == NULL;
+            if (!same && is_service_updated(ztx, updt, current) != 0) {
                 ev.event.service.changed[chIdx++] = updt;
             } else {
                 // no changes detected, just discard it
@@ -1158,6 +1842,7 @@ static void update_services(ziti_service_array services, const ziti_error *error
             ZTX_LOG(DEBUG, "service[%s] is not longer available", model_map_it_key(it));
             s = model_map_it_value(it);
             ev.event.service.removed[remIdx++] = s;
+            intercept_index_remove(&ztx->intercepts, s->name);
 
             ziti_net_session *session = model_map_remove(&ztx->sessions, s->id);
             if (session) {
@@ -1180,6 +1865,7 @@ static void update_services(ziti_service_array services, const ziti_error *error
     for (idx = 0; ev.event.service.changed[idx] != NULL; idx++) {
         s = ev.event.service.changed[idx];
         ziti_service *old = model_map_set(&ztx->services, s->name, s);
+        intercept_index_update(&ztx->intercepts, s);
         free_ziti_service(old);
         FREE(old);
     }
@@ -1188,30 +1874,28 @@ static void update_services(ziti_service_array services, const ziti_error *error
     for (idx = 0; ev.event.service.added[idx] != NULL; idx++) {
         s = ev.event.service.added[idx];
         model_map_set(&ztx->services, s->name, s);
+        intercept_index_update(&ztx->intercepts, s);
     }
 
     if (!ztx->services_loaded || (addIdx + remIdx + chIdx) > 0) {
         ZTX_LOG(DEBUG, "sending service event initial[%s] %zd added, %zd removed, %zd changed",
                 ztx->services_loaded ? "false" : "true", addIdx, remIdx, chIdx);
-        ziti_send_event(ztx, &ev);
+        // removed services are freed once reported
+        ztx_services_update(ztx, &ev);
         ztx->services_loaded = true;
     } else {
         ZTX_LOG(VERBOSE, "no services added, changed, or removed");
     }
 
     // cleanup
-    for (idx = 0; ev.event.service.removed[idx] != NULL; idx++) {
-        s = ev.event.service.removed[idx];
-        free_ziti_service(s);
-        free(s);
-    }
-
     free(ev.event.service.removed);
     free(ev.event.service.added);
     free(ev.event.service.changed);
 
     model_map_clear(&updates, NULL);
     model_map_clear(&ztx->service_forced_updates, NULL);
+
+    ziti_cache_update(ztx);
 }
 
 // set_service_posture_policy_map checks to see if the controller
@@ -1280,6 +1964,11 @@ static void refresh_cb(uv_timer_t *t) {
         ziti_ctrl_current_edge_routers(&ztx->controller, edge_routers_cb, ztx);
     }
 
+    // forced updates need the full list
+    if (model_map_size(&ztx->service_forced_updates) > 0) {
+        ziti_ctrl_reset_etags(&ztx->controller);
+    }
+
     if (ztx->no_service_updates_api) {
         ziti_ctrl_get_services(&ztx->controller, update_services, ztx);
     } else {
@@ -1299,6 +1988,52 @@ void ziti_services_refresh(ziti_context ztx, bool now) {
     }
 }
 
+struct router_rank {
+    ziti_edge_router *er;
+    int rtt;
+};
+
+static int cmp_router_rank(const void *l, const void *r) {
+    const struct router_rank *lr = l;
+    const struct router_rank *rr = r;
+    return (lr->rtt > rr->rtt) - (lr->rtt < rr->rtt);
+}
+
+// edge routers with best known RTT are connected first, a little apart,
+// the rest are connected slowly (dials connect the routers they need right away)
+static void connect_next_router(ziti_context ztx);
+
+static void router_connect_cb(wheel_timer_t *t) {
+    connect_next_router(t->data);
+}
+
+static void connect_next_router(ziti_context ztx) {
+    if (ztx->pending_routers == NULL || ztx->closing) {
+        return;
+    }
+
+    ziti_edge_router *er;
+    while ((er = ztx->pending_routers[ztx->pending_router_idx]) != NULL) {
+        ztx->pending_router_idx++;
+        const char *tls = model_map_get(&er->protocols, "tls");
+        if (model_map_get(&ztx->channels, tls) == NULL) {
+            ZTX_LOG(TRACE, "connecting to %s(%s)", er->name, tls);
+            ziti_channel_connect(ztx, er->name, tls, NULL, NULL);
+            break;
+        }
+    }
+
+    if (ztx->pending_routers[ztx->pending_router_idx] == NULL) {
+        FREE(ztx->pending_routers);
+        ztx->pending_router_idx = 0;
+        return;
+    }
+
+    uint64_t delay = model_map_size(&ztx->channels) < ztx->opts.router_connect_first ?
+                     ROUTER_CONNECT_STAGGER : ROUTER_CONNECT_INTERVAL;
+    wheel_timer_start(&ztx->timers, &ztx->router_connect_timer, delay, router_connect_cb, ztx);
+}
+
 static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, void *ctx) {
     ziti_context ztx = ctx;
 
@@ -1312,7 +2047,7 @@ static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, v
     }
 
     if (ers == NULL) {
-        ZTX_LOG(INFO, "no edge routers found");
+        ZTX_LOG(VERBOSE, "edge routers not modified");
         return;
     }
 
@@ -1328,6 +2063,11 @@ static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, v
         model_map_set(&curr_routers, er_url, (void *) er_url);
     }
 
+    size_t er_count = 0;
+    while (ers[er_count]) er_count++;
+    struct router_rank *pending = calloc(er_count + 1, sizeof(struct router_rank));
+    int pending_count = 0;
+
     ziti_edge_router **erp = ers;
     while (*erp) {
         ziti_edge_router *er = *erp;
@@ -1336,18 +2076,42 @@ static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, v
         if (tls) {
             // check if it is already in the list
             if (model_map_remove(&curr_routers, tls) == NULL) {
-                ZTX_LOG(TRACE, "connecting to %s(%s)", er->name, tls);
-                ziti_channel_connect(ztx, er->name, tls, NULL, NULL);
+                if (ztx->opts.router_connect_first > 0) {
+                    int *rtt = model_map_get(&ztx->router_rtt, er->name);
+                    pending[pending_count].er = er;
+                    pending[pending_count].rtt = rtt ? *rtt : INT_MAX;
+                    pending_count++;
+                } else {
+                    ZTX_LOG(TRACE, "connecting to %s(%s)", er->name, tls);
+                    ziti_channel_connect(ztx, er->name, tls, NULL, NULL);
+                }
             }
         } else {
             ZTX_LOG(DEBUG, "edge router %s does not have TLS edge listener", er->name);
         }
 
-        free_ziti_edge_router(er);
-        free(er);
         erp++;
     }
-    free(ers);
+
+    // pending routers point into the new list
+    wheel_timer_stop(&ztx->router_connect_timer);
+    FREE(ztx->pending_routers);
+    ztx->pending_router_idx = 0;
+    if (pending_count > 0) {
+        qsort(pending, pending_count, sizeof(struct router_rank), cmp_router_rank);
+        ztx->pending_routers = calloc(pending_count + 1, sizeof(ziti_edge_router *));
+        for (int i = 0; i < pending_count; i++) {
+            ztx->pending_routers[i] = pending[i].er;
+        }
+        ZTX_LOG(DEBUG, "connecting to %d edge routers, best %u first", pending_count,
+                ztx->opts.router_connect_first);
+    }
+    free(pending);
+
+    // keep current list for warm start cache
+    free_ziti_edge_router_array(&ztx->edge_routers);
+    ztx->edge_routers = ers;
+    connect_next_router(ztx);
 
     model_map_iter it = model_map_iterator(&curr_routers);
     while (it != NULL) {
@@ -1357,6 +2121,8 @@ static void edge_routers_cb(ziti_edge_router_array ers, const ziti_error *err, v
         ziti_channel_close(ch, ZITI_GATEWAY_UNAVAILABLE);
         it = model_map_it_remove(it);
     }
+
+    ziti_cache_update(ztx);
 }
 
 static void update_identity_data(ziti_identity_data *data, const ziti_error *err, void *ctx) {
@@ -1412,6 +2178,32 @@ static void on_create_cert(ziti_create_api_cert_resp *resp, const ziti_error *e,
     FREE(ztx->sessionCsr);
 }
 
+void ztx_update_ca_bundle(ziti_context ztx, const char *pem) {
+    if (ztx->config.id.ca == NULL || strcmp(pem, ztx->config.id.ca) == 0) {
+        return;
+    }
+
+    char *old_ca = ztx->config.id.ca;
+    ztx->config.id.ca = strdup(pem);
+
+    tls_context *new_tls = NULL;
+    if (load_tls(&ztx->config, &new_tls) == 0) {
+        ziti_send_event(ztx, &(ziti_event_t){
+                .type = ZitiAPIEvent,
+                .event.api = {
+                        .new_ca_bundle = ztx->config.id.ca,
+                }
+        });
+        free(old_ca);
+        ztx->tlsCtx = new_tls;
+        ziti_ctrl_set_tls(&ztx->controller, ztx->tlsCtx);
+    } else {
+        free(ztx->config.id.ca);
+        ztx->config.id.ca = old_ca;
+        ZITI_LOG(ERROR, "failed to create TLS context with updated CA bundle");
+    }
+}
+
 static void ca_bundle_cb(char *pkcs7, const ziti_error *err, void *ctx) {
     ziti_context ztx = ctx;
     tls_cert new_bundle = NULL;
@@ -1427,33 +2219,13 @@ static void ca_bundle_cb(char *pkcs7, const ziti_error *err, void *ctx) {
             ZITI_LOG(ERROR, "failed to format new CA bundle");
             goto error;
         }
-
-        if (ztx->config.id.ca && strcmp(new_pem, ztx->config.id.ca) != 0) {
-            char *old_ca = ztx->config.id.ca;
-            ztx->config.id.ca = new_pem;
-
-            tls_context *new_tls = NULL;
-            if (load_tls(&ztx->config, &new_tls) == 0) {
-                ziti_send_event(ztx, &(ziti_event_t){
-                        .type = ZitiAPIEvent,
-                        .event.api = {
-                                .new_ca_bundle = new_pem,
-                        }
-                });
-                free(old_ca);
-                ztx->tlsCtx = new_tls;
-                ztx->controller.client->tls = ztx->tlsCtx;
-                new_pem = NULL; // owned by ztx->config
-            } else {
-                ztx->config.id.ca = old_ca;
-                ZITI_LOG(ERROR, "failed to create TLS context with updated CA bundle");
-            }
-        }
     } else {
         ZITI_LOG(ERROR, "failed to get CA bundle from controller: %s", err->message);
     }
 
     error:
+    // also applies it to contexts sharing the fetch
+    ztx_share_ca_bundle_done(ztx, new_pem);
     free(pkcs7);
     free(new_pem);
     if (new_bundle) {
@@ -1471,7 +2243,9 @@ static void session_post_auth_query_cb(ziti_context ztx, int status, void *ctx)
 
         update_ctrl_status(ztx, ZITI_OK, NULL);
 
-        ziti_ctrl_get_well_known_certs(&ztx->controller, ca_bundle_cb, ztx);
+        if (!ztx_share_ca_bundle_lookup(ztx)) {
+            ziti_ctrl_get_well_known_certs(&ztx->controller, ca_bundle_cb, ztx);
+        }
         ziti_ctrl_current_identity(&ztx->controller, update_identity_data, ztx);
 
         //if we had auth queries, refresh state to zero out
@@ -1574,6 +2348,7 @@ void ziti_set_api_session(ziti_context ztx, ziti_api_session *session) {
 
     free_ziti_api_session(old_session);
     FREE(old_session);
+    ziti_cache_update(ztx);
 }
 
 static void api_session_cb(ziti_api_session *session, const ziti_error *err, void *ctx) {
@@ -1611,6 +2386,7 @@ static void api_session_cb(ziti_api_session *session, const ziti_error *err, voi
 
                 ZTX_LOG(ERROR, "identity[%s] cannot authenticate with ctrl[%s]", ztx->config.cfg_source,
                         ztx_controller(ztx));
+                ztx_service_events_flush(ztx);
                 ziti_event_t service_event = {
                         .type = ZitiServiceEvent,
                         .event.service = {
@@ -1627,7 +2403,9 @@ static void api_session_cb(ziti_api_session *session, const ziti_error *err, voi
                     service_event.event.service.removed[idx++] = srv;
                 }
 
-                ziti_send_event(ztx, &service_event);
+                ztx_service_event(ztx, &service_event);
+                free(service_event.event.service.removed);
+                intercept_index_clear(&ztx->intercepts);
                 model_map_clear(&ztx->services, (_free_f) free_ziti_service_ptr);
 
                 ziti_stop_api_session_refresh(ztx);
@@ -1716,24 +2494,28 @@ const ziti_version *ziti_get_version() {
 }
 
 static void grim_reaper(ziti_context ztx) {
-
-    size_t total = model_map_size(&ztx->connections);
+    // only connections queued before this pass,
+    // connections that are not ready to be disposed go to the back of the queue
+    size_t pending = ztx->close_queue_len;
     size_t count = 0;
 
-    if (total == 0 && !ztx->enabled) {
-        // context disabled and no connections
-        return;
-    }
+    while (pending-- > 0 && !TAILQ_EMPTY(&ztx->close_queue)) {
+        ziti_connection conn = TAILQ_FIRST(&ztx->close_queue);
+        TAILQ_REMOVE(&ztx->close_queue, conn, close_next);
+        ztx->close_queue_len--;
 
-    model_map_iter it = model_map_iterator(&ztx->connections);
-    while (it != NULL) {
-        ziti_connection conn = model_map_it_value(it);
-        int closed = conn->close ? conn->disposer(conn) : 0;
-        it = closed ? model_map_it_remove(it) : model_map_it_next(it);
-        count += closed;
+        // disposer frees or recycles connection
+        uint32_t conn_id = conn->conn_id;
+        if (conn->disposer(conn)) {
+            model_map_removel(&ztx->connections, (long) conn_id);
+            count++;
+        } else {
+            TAILQ_INSERT_TAIL(&ztx->close_queue, conn, close_next);
+            ztx->close_queue_len++;
+        }
     }
     if (count > 0) {
-        ZTX_LOG(DEBUG, "reaped %zd closed (out of %zd total) connections", count, total);
+        ZTX_LOG(DEBUG, "reaped %zd closed (out of %zd total) connections", count, model_map_size(&ztx->connections));
     }
 }
 
@@ -1766,6 +2548,8 @@ void ziti_on_channel_event(ziti_channel_t *ch, ziti_router_status status, ziti_c
                     .address = ch->host,
                     .version = ch->version,
                     .status = status,
+                    .reconnect_attempt = ch->reconnect_count,
+                    .reconnect_delay = ch->reconnect_delay,
             }
     };
 
@@ -1781,18 +2565,10 @@ void ziti_on_channel_event(ziti_channel_t *ch, ziti_router_status status, ziti_c
 
 static void ztx_work_async(uv_async_t *ar) {
     ziti_context ztx = ar->data;
-    ztx_work_q work;
-    STAILQ_INIT(&work);
 
-    struct ztx_work_s *w;
-    uv_mutex_lock(&ztx->w_lock);
-    work = ztx->w_queue;
-    STAILQ_INIT(&ztx->w_queue);
-    uv_mutex_unlock(&ztx->w_lock);
-
-    while (!STAILQ_EMPTY(&work)) {
-        w = STAILQ_FIRST(&work);
-        STAILQ_REMOVE_HEAD(&work, _next);
+    mpsc_node_t *n;
+    while ((n = mpsc_pop(&ztx->w_queue)) != NULL) {
+        struct ztx_work_s *w = container_of((char *) n, struct ztx_work_s, _node);
 
         w->w(ztx, w->w_data);
 
@@ -1805,10 +2581,7 @@ void ziti_queue_work(ziti_context ztx, ztx_work_f w, void *data) {
     wrk->w = w;
     wrk->w_data = data;
 
-    uv_mutex_trylock(&ztx->w_lock);
-    STAILQ_INSERT_TAIL(&ztx->w_queue, wrk, _next);
-    uv_mutex_unlock(&ztx->w_lock);
-
+    mpsc_push(&ztx->w_queue, &wrk->_node);
     uv_async_send(&ztx->w_async);
 }
 
@@ -1863,17 +2636,42 @@ int ziti_context_set_options(ziti_context ztx, const ziti_options *options) {
 
         copy_opt(disabled);
         copy_opt(config_types);
+        copy_opt(service_names);
         copy_opt(refresh_interval);
         copy_opt(metrics_type);
         copy_opt(api_page_size);
+        copy_opt(api_page_window);
         copy_opt(event_cb);
         copy_opt(events);
         copy_opt(app_ctx);
         copy_opt(router_keepalive);
+        copy_opt(router_connections);
+        copy_opt(router_connect_first);
+        copy_opt(router_handshake_limit);
+        copy_opt(read_buf_size);
+        copy_opt(read_buf_count);
+        copy_opt(max_frame_size);
+        copy_opt(conn_recv_window);
+        copy_opt(out_msg_pool_cap);
+        copy_opt(crypto_offload_rate);
+        copy_opt(memory_limit);
+        copy_opt(cache_dir);
         copy_opt(pq_domain_cb);
         copy_opt(pq_mac_cb);
         copy_opt(pq_os_cb);
         copy_opt(pq_process_cb);
+        copy_opt(pq_process_jobs);
+        copy_opt(pq_change_notify);
+        copy_opt(service_metrics);
+        copy_opt(conn_hibernate_ms);
+        copy_opt(dial_timings);
+        copy_opt(share_resources);
+        copy_opt(e2e_aes_gcm);
+        copy_opt(service_event_window);
+        copy_opt(conn_write_high_water);
+        copy_opt(conn_write_low_water);
+        copy_opt(channel_write_high_water);
+        copy_opt(channel_write_low_water);
 
 #undef copy_opt
     }
@@ -1894,10 +2692,9 @@ int ziti_context_run(ziti_context ztx, uv_loop_t *loop) {
     ztx->ziti_timeout = ZITI_DEFAULT_TIMEOUT;
     ztx->ctrl_status = ZITI_WTF;
 
-    STAILQ_INIT(&ztx->w_queue);
+    mpsc_init(&ztx->w_queue);
     uv_async_init(loop, &ztx->w_async, ztx_work_async);
     ztx->w_async.data = ztx;
-    uv_mutex_init(&ztx->w_lock);
 
     NEWP(init_req, struct ziti_init_req);
     init_req->start = !ztx->opts.disabled;
@@ -0,0 +1,89 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+// wrappers call the real functions
+#define ZITI_ALLOC_IMPL
+#include "ziti_alloc.h"
+
+#if _WIN32
+#include <windows.h>
+#define counter_add(p, n) InterlockedExchangeAdd64((LONG64 volatile *)(p), (LONG64)(n))
+#define counter_load(p) ((uint64_t) InterlockedCompareExchange64((LONG64 volatile *)(p), 0, 0))
+#else
+#define counter_add(p, n) __atomic_fetch_add((p), (n), __ATOMIC_RELAXED)
+#define counter_load(p) __atomic_load_n((p), __ATOMIC_RELAXED)
+#endif
+
+// counters are shared by all loops (and threads) using the SDK
+static ziti_alloc_stats alloc_stats;
+
+#if defined(ZITI_ALLOC_TRACKING)
+#define count(field, n) counter_add(&alloc_stats.field, (n))
+#else
+#define count(field, n) ((void)0)
+#endif
+
+void ziti_alloc_get_stats(ziti_alloc_stats *stats) {
+    stats->allocs = counter_load(&alloc_stats.allocs);
+    stats->reallocs = counter_load(&alloc_stats.reallocs);
+    stats->frees = counter_load(&alloc_stats.frees);
+    stats->bytes = counter_load(&alloc_stats.bytes);
+}
+
+void *ziti_alloc_malloc(size_t size) {
+    count(allocs, 1);
+    count(bytes, size);
+    return malloc(size);
+}
+
+void *ziti_alloc_calloc(size_t c, size_t size) {
+    count(allocs, 1);
+    count(bytes, c * size);
+    return calloc(c, size);
+}
+
+void *ziti_alloc_realloc(void *ptr, size_t size) {
+    if (ptr == NULL) {
+        count(allocs, 1);
+    } else {
+        count(reallocs, 1);
+    }
+    count(bytes, size);
+    return realloc(ptr, size);
+}
+
+void ziti_alloc_free(void *ptr) {
+    if (ptr != NULL) {
+        count(frees, 1);
+    }
+    free(ptr);
+}
+
+char *ziti_alloc_strdup(const char *s) {
+    return ziti_alloc_strndup(s, strlen(s));
+}
+
+char *ziti_alloc_strndup(const char *s, size_t n) {
+    size_t len = 0;
+    while (len < n && s[len] != '\0') {
+        len++;
+    }
+
+    char *copy = ziti_alloc_malloc(len + 1);
+    if (copy) {
+        memcpy(copy, s, len);
+        copy[len] = '\0';
+    }
+    return copy;
+}
@@ -13,6 +13,7 @@
 // limitations under the License.
 
 #include <stdlib.h>
+#include <ctype.h>
 #include "utils.h"
 #include "zt_internal.h"
 #include <ziti_ctrl.h>
@@ -20,6 +21,7 @@
 
 
 #define DEFAULT_PAGE_SIZE 25
+#define DEFAULT_PAGE_WINDOW 4
 #define ZITI_CTRL_KEEPALIVE 0
 #define ZITI_CTRL_TIMEOUT 15000
 
@@ -107,14 +109,28 @@ struct ctrl_resp {
     bool resp_text_plain;
     uv_timeval64_t start;
     uv_timeval64_t all_start;
+    enum ctrl_lane lane;
 
     bool paging;
     const char *base_path;
+    char *etag; // of the first page, stored when the whole list was received in that page
+    bool not_modified;
+    type_meta *paging_meta; // element type, used to discard pages on failure
     unsigned int limit;
     unsigned int total;
     unsigned int recd;
     void **resp_array;
 
+    // paging state: pages are requested concurrently and merged in order when all are done
+    struct ctrl_resp *pager; // set on page requests
+    unsigned int page;
+    unsigned int page_client;
+    void ***pages;
+    unsigned int page_count;
+    unsigned int next_page;
+    unsigned int in_flight;
+    ziti_error page_err;
+
     body_parse_fn body_parse_func;
     ctrl_resp_cb_t resp_cb;
 
@@ -138,10 +154,51 @@ static tlsuv_http_req_t *
 start_request(tlsuv_http_t *http, const char *method, const char *path, tlsuv_http_resp_cb cb, struct ctrl_resp *resp) {
     ziti_controller *ctrl = resp->ctrl;
     uv_gettimeofday(&resp->start);
+    resp->lane = http == ctrl->dial_client ? CTRL_LANE_DIAL : CTRL_LANE_DEFAULT;
     CTRL_LOG(VERBOSE, "starting %s[%s]", method, path);
     return tlsuv_http_req(http, method, path, cb, resp);
 }
 
+#define CTRL_CLIENTS (2 + CTRL_PAGE_CLIENTS)
+
+// all HTTP clients of the controller, they share URL, TLS and session header
+static int ctrl_clients(ziti_controller *ctrl, tlsuv_http_t *clients[CTRL_CLIENTS]) {
+    int n = 0;
+    clients[n++] = ctrl->client;
+    clients[n++] = ctrl->dial_client;
+    for (int i = 0; i < CTRL_PAGE_CLIENTS; i++) {
+        clients[n++] = ctrl->page_clients[i];
+    }
+    return n;
+}
+
+static void ctrl_header(ziti_controller *ctrl, const char *name, const char *value) {
+    tlsuv_http_t *clients[CTRL_CLIENTS];
+    int n = ctrl_clients(ctrl, clients);
+    for (int i = 0; i < n; i++) {
+        tlsuv_http_header(clients[i], name, value);
+    }
+}
+
+static void ctrl_req_done(ziti_controller *ctrl, struct ctrl_resp *resp, const ziti_error *e) {
+    uv_timeval64_t now;
+    uv_gettimeofday(&now);
+    uint64_t elapsed = (now.tv_sec * 1000 + now.tv_usec / 1000) - (resp->start.tv_sec * 1000 + resp->start.tv_usec / 1000);
+
+    struct ctrl_req_stats *st = &ctrl->stats[resp->lane];
+    if (e) st->errors++;
+    st->last = elapsed;
+    metrics_hist_record(&st->latency, elapsed);
+}
+
+const char *ziti_ctrl_lane_name(enum ctrl_lane lane) {
+    switch (lane) {
+        case CTRL_LANE_DIAL: return "dial";
+        case CTRL_LANE_DEFAULT: return "default";
+        default: return "unknown";
+    }
+}
+
 static const char *find_header(tlsuv_http_resp_t *r, const char *name) {
     tlsuv_http_hdr *h;
     LIST_FOREACH(h, &r->headers, _next) {
@@ -190,6 +247,14 @@ static void ctrl_resp_cb(tlsuv_http_resp_t *r, void *data) {
             resp->new_address = strdup(new_addr);
         }
 
+        const char *etag = find_header(r, "ETag");
+        if (resp->pager && resp->page == 0) {
+            FREE(resp->pager->etag);
+            if (etag && r->code == 200) {
+                resp->pager->etag = strdup(etag);
+            }
+        }
+
         const char *instance_id = find_header(r, "ziti-instance-id");
 
         if (instance_id &&
@@ -201,17 +266,23 @@ static void ctrl_resp_cb(tlsuv_http_resp_t *r, void *data) {
 }
 
 static void ctrl_default_cb(void *s, const ziti_error *e, struct ctrl_resp *resp) {
+    ziti_controller *ctrl = resp->ctrl;
+    ctrl_req_done(ctrl, resp, e);
+
     if (resp->resp_cb) {
         resp->resp_cb(s, e, resp->ctx);
     }
-    ziti_controller *ctrl = resp->ctrl;
     if (resp->new_address && strcmp(resp->new_address, ctrl->url) != 0) {
         CTRL_LOG(INFO, "controller supplied new address[%s]", resp->new_address);
 
         FREE(ctrl->url);
         ctrl->url = resp->new_address;
         resp->new_address = NULL;
-        tlsuv_http_set_url(ctrl->client, ctrl->url);
+        tlsuv_http_t *clients[CTRL_CLIENTS];
+        int n = ctrl_clients(ctrl, clients);
+        for (int i = 0; i < n; i++) {
+            tlsuv_http_set_url(clients[i], ctrl->url);
+        }
 
         if (resp->ctrl->redirect_cb) {
             ctrl->redirect_cb(ctrl->url, ctrl->redirect_ctx);
@@ -237,7 +308,11 @@ static void ctrl_version_cb(ziti_version *v, ziti_error *e, struct ctrl_resp *re
         if (v->api_versions) {
             api_path *path = model_map_get(&v->api_versions->edge, "v1");
             if (path) {
-                tlsuv_http_set_path_prefix(resp->ctrl->client, path->path);
+                tlsuv_http_t *clients[CTRL_CLIENTS];
+                int n = ctrl_clients(ctrl, clients);
+                for (int i = 0; i < n; i++) {
+                    tlsuv_http_set_path_prefix(clients[i], path->path);
+                }
             } else {
                 CTRL_LOG(WARN, "controller did not provide expected(v1) API version path");
             }
@@ -246,11 +321,19 @@ static void ctrl_version_cb(ziti_version *v, ziti_error *e, struct ctrl_resp *re
     ctrl_default_cb(v, e, resp);
 }
 
+void ziti_ctrl_set_api_session(ziti_controller *ctrl, const ziti_api_session *session) {
+    ziti_ctrl_reset_etags(ctrl);
+    FREE(ctrl->api_session_token);
+    ctrl->api_session_token = strdup(session->token);
+    ctrl_header(ctrl, "zt-session", session->token);
+}
+
 void ziti_ctrl_clear_api_session(ziti_controller *ctrl) {
+    ziti_ctrl_reset_etags(ctrl);
     FREE(ctrl->api_session_token);
     if (ctrl->client) {
         CTRL_LOG(DEBUG, "clearing api session token for ziti_controller");
-        tlsuv_http_header(ctrl->client, "zt-session", NULL);
+        ctrl_header(ctrl, "zt-session", NULL);
     }
 }
 
@@ -263,9 +346,10 @@ static void ctrl_login_cb(ziti_api_session *s, ziti_error *e, struct ctrl_resp *
 
     if (s) {
         CTRL_LOG(DEBUG, "authenticated successfully session[%s]", s->id);
+        ziti_ctrl_reset_etags(ctrl);
         FREE(resp->ctrl->api_session_token);
         resp->ctrl->api_session_token = strdup(s->token);
-        tlsuv_http_header(resp->ctrl->client, "zt-session", s->token);
+        ctrl_header(ctrl, "zt-session", s->token);
     }
     ctrl_default_cb(s, e, resp);
 }
@@ -275,7 +359,7 @@ static void ctrl_logout_cb(void *s, ziti_error *e, struct ctrl_resp *resp) {
     CTRL_LOG(DEBUG, "logged out");
 
     FREE(resp->ctrl->api_session_token);
-    tlsuv_http_header(resp->ctrl->client, "zt-session", NULL);
+    ctrl_header(ctrl, "zt-session", NULL);
     ctrl_default_cb(s, e, resp);
 }
 
@@ -303,6 +387,14 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
     else if (len == UV_EOF) {
         void *resp_obj = NULL;
 
+        if (resp->status == 304) {
+            CTRL_LOG(VERBOSE, "not modified %s[%s]", req->method, req->path);
+            FREE(resp->body);
+            resp->not_modified = true;
+            resp->ctrl_cb(NULL, NULL, resp);
+            return;
+        }
+
         api_resp cr = {0};
         if (resp->resp_text_plain && resp->status < 300) {
             resp_obj = calloc(1, resp->received + 1);
@@ -328,34 +420,7 @@ static void ctrl_body_cb(tlsuv_http_req_t *req, char *b, ssize_t len) {
                     uint64_t elapsed = (now.tv_sec * 1000000 + now.tv_usec) - (resp->start.tv_sec * 1000000 + resp->start.tv_usec);
                     CTRL_LOG(DEBUG, "completed %s[%s] in %ld.%03ld s", req->method, req->path, elapsed / 1000000, (elapsed / 1000) % 1000);
                     if (resp->paging) {
-                        bool last_page = cr.meta.pagination.total <= cr.meta.pagination.offset + cr.meta.pagination.limit;
-                        if (cr.meta.pagination.total > resp->total) {
-                            resp->total = cr.meta.pagination.total;
-                            resp->resp_array = realloc(resp->resp_array, (resp->total + 1) * sizeof(void *));
-                        }
-                        // empty result
-                        if (resp->resp_array == NULL) {
-                            resp->resp_array = calloc(1, sizeof(void *));
-                        }
-
-                        void **chunk = resp_obj;
-                        while (*chunk != NULL) {
-                            resp->resp_array[resp->recd++] = *chunk++;
-                        }
-                        CTRL_LOG(DEBUG, "received %d/%d for paging request GET[%s]", resp->recd, cr.meta.pagination.total, resp->base_path);
-                        resp->resp_array[resp->recd] = NULL;
-                        FREE(resp_obj);
-                        resp->received = 0;
-                        FREE(resp->body);
-
-                        free_api_resp(&cr);
-                        if (!last_page) {
-                            ctrl_paging_req(resp);
-                            return;
-                        }
-                        elapsed = (now.tv_sec * 1000000 + now.tv_usec) - (resp->all_start.tv_sec * 1000000 + resp->all_start.tv_usec);
-                        CTRL_LOG(DEBUG, "completed paging request GET[%s] in %ld.%03ld s", resp->base_path, elapsed / 1000000, (elapsed / 1000) % 1000);
-                        resp_obj = resp->resp_array;
+                        resp->total = cr.meta.pagination.total;
                     }
                 }
             }
@@ -394,18 +459,33 @@ int ziti_ctrl_init(uv_loop_t *loop, ziti_controller *ctrl, const char *url, tls_
     ctrl->page_size = DEFAULT_PAGE_SIZE;
     ctrl->loop = loop;
     ctrl->url = strdup(url);
+    ctrl->page_window = DEFAULT_PAGE_WINDOW;
     memset(&ctrl->version, 0, sizeof(ctrl->version));
+    memset(&ctrl->stats, 0, sizeof(ctrl->stats));
+    memset(&ctrl->etags, 0, sizeof(ctrl->etags));
+    ctrl->services_path = NULL;
+    memset(ctrl->page_reqs, 0, sizeof(ctrl->page_reqs));
     ctrl->client = calloc(1, sizeof(tlsuv_http_t));
-
-    if (tlsuv_http_init(loop, ctrl->client, url) != 0) {
-        return ZITI_INVALID_CONFIG;
+    ctrl->dial_client = calloc(1, sizeof(tlsuv_http_t));
+    for (int i = 0; i < CTRL_PAGE_CLIENTS; i++) {
+        ctrl->page_clients[i] = calloc(1, sizeof(tlsuv_http_t));
     }
 
-    ctrl->client->data = ctrl;
-    tlsuv_http_set_ssl(ctrl->client, tls);
-    tlsuv_http_idle_keepalive(ctrl->client, ZITI_CTRL_KEEPALIVE);
-    tlsuv_http_connect_timeout(ctrl->client, ZITI_CTRL_TIMEOUT);
-    tlsuv_http_header(ctrl->client, "Accept", "application/json");
+    // connections are established on first request
+    tlsuv_http_t *clients[CTRL_CLIENTS];
+    int n = ctrl_clients(ctrl, clients);
+    for (int i = 0; i < n; i++) {
+        if (tlsuv_http_init(loop, clients[i], url) != 0) {
+            return ZITI_INVALID_CONFIG;
+        }
+    }
+    for (int i = 0; i < n; i++) {
+        clients[i]->data = ctrl;
+        tlsuv_http_set_ssl(clients[i], tls);
+        tlsuv_http_idle_keepalive(clients[i], ZITI_CTRL_KEEPALIVE);
+        tlsuv_http_connect_timeout(clients[i], ZITI_CTRL_TIMEOUT);
+        tlsuv_http_header(clients[i], "Accept", "application/json");
+    }
     ctrl->api_session_token = NULL;
     ctrl->instance_id = NULL;
 
@@ -418,6 +498,70 @@ void ziti_ctrl_set_page_size(ziti_controller *ctrl, unsigned int size) {
     ctrl->page_size = size;
 }
 
+void ziti_ctrl_set_page_window(ziti_controller *ctrl, unsigned int window) {
+    if (window > CTRL_PAGE_CLIENTS) {
+        CTRL_LOG(WARN, "page window[%u] is limited to %d concurrent page requests", window, CTRL_PAGE_CLIENTS);
+        window = CTRL_PAGE_CLIENTS;
+    }
+    ctrl->page_window = window;
+}
+
+static void url_encode(string_buf_t *buf, const char *s) {
+    static const char hex[] = "0123456789ABCDEF";
+    for (; *s; s++) {
+        unsigned char c = (unsigned char) *s;
+        if (isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~') {
+            string_buf_append_byte(buf, (char) c);
+        } else {
+            string_buf_append_byte(buf, '%');
+            string_buf_append_byte(buf, hex[c >> 4]);
+            string_buf_append_byte(buf, hex[c & 0xf]);
+        }
+    }
+}
+
+void ziti_ctrl_set_service_filter(ziti_controller *ctrl, const char **service_names) {
+    FREE(ctrl->services_path);
+    if (service_names == NULL || service_names[0] == NULL) {
+        return;
+    }
+
+    string_buf_t filter;
+    string_buf_init(&filter);
+    string_buf_append(&filter, "name in [");
+    for (int i = 0; service_names[i]; i++) {
+        if (i > 0) {
+            string_buf_append_byte(&filter, ',');
+        }
+        // names are quoted string literals in the filter expression
+        string_buf_append_byte(&filter, '"');
+        for (const char *c = service_names[i]; *c; c++) {
+            if (*c == '"' || *c == '\\') {
+                string_buf_append_byte(&filter, '\\');
+            }
+            string_buf_append_byte(&filter, *c);
+        }
+        string_buf_append_byte(&filter, '"');
+    }
+    string_buf_append(&filter, "]");
+    char *f = string_buf_to_string(&filter, NULL);
+
+    string_buf_t path;
+    string_buf_init(&path);
+    string_buf_append(&path, "/services?filter=");
+    url_encode(&path, f);
+    ctrl->services_path = string_buf_to_string(&path, NULL);
+    CTRL_LOG(DEBUG, "services are limited to %s", f);
+
+    free(f);
+    string_buf_free(&filter);
+    string_buf_free(&path);
+}
+
+void ziti_ctrl_reset_etags(ziti_controller *ctrl) {
+    model_map_clear(&ctrl->etags, free);
+}
+
 void ziti_ctrl_set_redirect_cb(ziti_controller *ctrl, ziti_ctrl_redirect_cb cb, void *ctx) {
     ctrl->redirect_cb = cb;
     ctrl->redirect_ctx = ctx;
@@ -428,16 +572,37 @@ static void on_http_close(tlsuv_http_t *clt) {
 }
 
 int ziti_ctrl_cancel(ziti_controller *ctrl) {
+    tlsuv_http_t *clients[CTRL_CLIENTS];
+    int n = ctrl_clients(ctrl, clients);
+    for (int i = 1; i < n; i++) {
+        tlsuv_http_cancel_all(clients[i]);
+    }
     return tlsuv_http_cancel_all(ctrl->client);
 }
 
+void ziti_ctrl_set_tls(ziti_controller *ctrl, tls_context *tls) {
+    tlsuv_http_t *clients[CTRL_CLIENTS];
+    int n = ctrl_clients(ctrl, clients);
+    for (int i = 0; i < n; i++) {
+        clients[i]->tls = tls;
+    }
+}
+
 int ziti_ctrl_close(ziti_controller *ctrl) {
     free_ziti_version(&ctrl->version);
     FREE(ctrl->api_session_token);
     FREE(ctrl->instance_id);
     FREE(ctrl->url);
-    tlsuv_http_close(ctrl->client, on_http_close);
+    FREE(ctrl->services_path);
+    ziti_ctrl_reset_etags(ctrl);
+    tlsuv_http_t *clients[CTRL_CLIENTS];
+    int n = ctrl_clients(ctrl, clients);
+    for (int i = 0; i < n; i++) {
+        tlsuv_http_close(clients[i], on_http_close);
+    }
     ctrl->client = NULL;
+    ctrl->dial_client = NULL;
+    memset(ctrl->page_clients, 0, sizeof(ctrl->page_clients));
     return ZITI_OK;
 }
 
@@ -535,7 +700,8 @@ void ziti_ctrl_get_services(ziti_controller *ctrl, void (*cb)(ziti_service_array
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, parse_ziti_service_array, ctx);
 
     resp->paging = true;
-    resp->base_path = "/services";
+    resp->base_path = ctrl->services_path ? ctrl->services_path : "/services";
+    resp->paging_meta = get_ziti_service_meta();
     ctrl_paging_req(resp);
 }
 
@@ -546,6 +712,7 @@ void ziti_ctrl_current_edge_routers(ziti_controller *ctrl, void (*cb)(ziti_edge_
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, parse_ziti_edge_router_array, ctx);
     resp->paging = true;
     resp->base_path = "/current-identity/edge-routers";
+    resp->paging_meta = get_ziti_edge_router_meta();
     ctrl_paging_req(resp);
 }
 
@@ -560,7 +727,7 @@ ziti_ctrl_get_service(ziti_controller *ctrl, const char *service_name, void (*cb
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, parse_ziti_service_array, ctx);
     resp->ctrl_cb = (ctrl_cb_t) ctrl_service_cb;
 
-    start_request(ctrl->client, "GET", path, ctrl_resp_cb, resp);
+    start_request(ctrl->dial_client, "GET", path, ctrl_resp_cb, resp);
 }
 
 void ziti_ctrl_get_session(
@@ -573,7 +740,7 @@ void ziti_ctrl_get_session(
     snprintf(req_path, sizeof(req_path), "/sessions/%s", session_id);
 
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, parse_ziti_net_session_ptr, ctx);
-    tlsuv_http_req_t *req = start_request(ctrl->client, "GET", req_path, ctrl_resp_cb, resp);
+    tlsuv_http_req_t *req = start_request(ctrl->dial_client, "GET", req_path, ctrl_resp_cb, resp);
     tlsuv_http_req_header(req, "Content-Type", "application/json");
 }
 
@@ -589,7 +756,7 @@ void ziti_ctrl_create_session(
                           service_id, ziti_session_types.name(type));
 
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, parse_ziti_net_session_ptr, ctx);
-    tlsuv_http_req_t *req = start_request(ctrl->client, "POST", "/sessions", ctrl_resp_cb, resp);
+    tlsuv_http_req_t *req = start_request(ctrl->dial_client, "POST", "/sessions", ctrl_resp_cb, resp);
     tlsuv_http_req_header(req, "Content-Type", "application/json");
     tlsuv_http_req_data(req, content, len, free_body_cb);
 }
@@ -601,6 +768,7 @@ void ziti_ctrl_get_sessions(
     struct ctrl_resp *resp = MAKE_RESP(ctrl, cb, parse_ziti_net_session_array, ctx);
     resp->paging = true;
     resp->base_path = "/sessions";
+    resp->paging_meta = get_ziti_net_session_meta();
     ctrl_paging_req(resp);
 }
 
@@ -687,20 +855,173 @@ void ziti_pr_post_bulk(ziti_controller *ctrl, char *body, size_t body_len,
     tlsuv_http_req_data(req, body, body_len, free_body_cb);
 }
 
+static void page_req(struct ctrl_resp *pager, unsigned int page);
+
+static void discard_page(struct ctrl_resp *pager, void **chunk) {
+    for (int i = 0; chunk && chunk[i] != NULL; i++) {
+        model_free(chunk[i], pager->paging_meta);
+        free(chunk[i]);
+    }
+    free(chunk);
+}
+
+static void paging_done(struct ctrl_resp *pager) {
+    ziti_controller *ctrl = pager->ctrl;
+    const ziti_error *err = pager->page_err.err != 0 ? &pager->page_err : NULL;
+
+    if (err == NULL) {
+        pager->resp_array = calloc(pager->recd + 1, sizeof(void *));
+        unsigned int idx = 0;
+        for (unsigned int p = 0; p < pager->page_count; p++) {
+            for (int i = 0; pager->pages[p] && pager->pages[p][i] != NULL; i++) {
+                pager->resp_array[idx++] = pager->pages[p][i];
+            }
+            FREE(pager->pages[p]);
+        }
+
+        uv_timeval64_t now;
+        uv_gettimeofday(&now);
+        uint64_t elapsed = (now.tv_sec * 1000000 + now.tv_usec) - (pager->all_start.tv_sec * 1000000 + pager->all_start.tv_usec);
+        CTRL_LOG(DEBUG, "completed paging request GET[%s] %d pages in %ld.%03ld s", pager->base_path, pager->page_count,
+                 elapsed / 1000000, (elapsed / 1000) % 1000);
+
+        // a 304 on the first page says nothing about the other pages,
+        // so conditional requests are only used for lists that fit in one page
+        if (pager->not_modified) {
+            // stored etag is still current
+        } else if (pager->etag && pager->page_count == 1) {
+            free(model_map_set(&ctrl->etags, pager->base_path, pager->etag));
+            pager->etag = NULL;
+        } else {
+            free(model_map_remove(&ctrl->etags, pager->base_path));
+        }
+    } else {
+        for (unsigned int p = 0; p < pager->page_count; p++) {
+            discard_page(pager, pager->pages[p]);
+        }
+    }
+    FREE(pager->pages);
+
+    // unchanged lists are reported as NULL
+    void *result = pager->not_modified ? NULL : pager->resp_array;
+    if (pager->not_modified) {
+        FREE(pager->resp_array);
+        CTRL_LOG(VERBOSE, "paging request GET[%s] not modified", pager->base_path);
+    }
+    pager->resp_array = NULL;
+    FREE(pager->etag);
+    pager->ctrl_cb(result, err, pager);
+
+    FREE(pager->page_err.code);
+    FREE(pager->page_err.message);
+}
+
+// result of a single page request, [chunk] is owned by pager afterwards
+static void page_result(struct ctrl_resp *page_resp, void **chunk, const ziti_error *err) {
+    struct ctrl_resp *pager = page_resp->pager;
+    ziti_controller *ctrl = pager->ctrl;
+    pager->in_flight--;
+    ctrl->page_reqs[page_resp->page_client]--;
+
+    if (err) {
+        if (pager->page_err.err == 0) {
+            pager->page_err.err = err->err;
+            pager->page_err.http_code = err->http_code;
+            pager->page_err.code = err->code ? strdup(err->code) : NULL;
+            pager->page_err.message = err->message ? strdup(err->message) : NULL;
+        }
+        discard_page(pager, chunk);
+    } else if (page_resp->not_modified) {
+        // only the first page of a single page list is conditional, see paging_done()
+        pager->not_modified = true;
+    } else {
+        // controller may report different total while paging is in progress
+        unsigned int pages = page_resp->total == 0 ? 1 : (page_resp->total + pager->limit - 1) / pager->limit;
+        if (pages > pager->page_count) {
+            pager->pages = realloc(pager->pages, pages * sizeof(void **));
+            memset(pager->pages + pager->page_count, 0, (pages - pager->page_count) * sizeof(void **));
+            pager->page_count = pages;
+            pager->total = page_resp->total;
+        }
+
+        if (page_resp->page < pager->page_count && pager->pages[page_resp->page] == NULL) {
+            pager->pages[page_resp->page] = chunk;
+            for (int i = 0; chunk && chunk[i] != NULL; i++) {
+                pager->recd++;
+            }
+        } else {
+            discard_page(pager, chunk);
+        }
+        CTRL_LOG(DEBUG, "received page %d/%d for paging request GET[%s]",
+                 page_resp->page + 1, pager->page_count, pager->base_path);
+    }
+
+    unsigned int window = ctrl->page_window > 0 ? ctrl->page_window : 1;
+    while (pager->page_err.err == 0 && pager->in_flight < window && pager->next_page < pager->page_count) {
+        page_req(pager, pager->next_page++);
+    }
+
+    if (pager->in_flight == 0 && (pager->page_err.err != 0 || pager->next_page >= pager->page_count)) {
+        paging_done(pager);
+    }
+}
+
+static void page_error_cb(void *obj, const ziti_error *err, void *ctx) {
+    page_result(ctx, obj, err);
+}
+
+static void page_body_cb(void **chunk, const ziti_error *err, struct ctrl_resp *page_resp) {
+    page_result(page_resp, chunk, err);
+    page_resp->resp_cb = NULL;
+    ctrl_default_cb(NULL, NULL, page_resp);
+}
+
+static void page_req(struct ctrl_resp *pager, unsigned int page) {
+    ziti_controller *ctrl = pager->ctrl;
+
+    struct ctrl_resp *resp = prepare_resp(ctrl, page_error_cb, pager->body_parse_func, NULL);
+    resp->ctx = resp;
+    resp->ctrl_cb = (ctrl_cb_t) page_body_cb;
+    resp->paging = true;
+    resp->pager = pager;
+    resp->page = page;
+    pager->in_flight++;
+
+    // least busy client, page requests of other lists may be in progress
+    unsigned int c = 0;
+    for (unsigned int i = 1; i < CTRL_PAGE_CLIENTS; i++) {
+        if (ctrl->page_reqs[i] < ctrl->page_reqs[c]) {
+            c = i;
+        }
+    }
+    resp->page_client = c;
+    ctrl->page_reqs[c]++;
+
+    char query = strchr(pager->base_path, '?') ? '&' : '?';
+    size_t path_len = strlen(pager->base_path) + 64;
+    char *path = malloc(path_len);
+    snprintf(path, path_len, "%s%climit=%d&offset=%d", pager->base_path, query, pager->limit, page * pager->limit);
+    CTRL_LOG(VERBOSE, "requesting %s", path);
+    tlsuv_http_req_t *req = start_request(ctrl->page_clients[c], "GET", path, ctrl_resp_cb, resp);
+    free(path);
+
+    const char *etag = page == 0 ? model_map_get(&ctrl->etags, pager->base_path) : NULL;
+    if (etag) {
+        tlsuv_http_req_header(req, "If-None-Match", etag);
+    }
+}
+
 static void ctrl_paging_req(struct ctrl_resp *resp) {
     ziti_controller *ctrl = resp->ctrl;
     if (resp->limit == 0) {
         resp->limit = ctrl->page_size;
     }
-    if (resp->recd == 0) {
-        uv_gettimeofday(&resp->all_start);
-        CTRL_LOG(DEBUG, "starting paging request GET[%s]", resp->base_path);
-    }
-    char query = strchr(resp->base_path, '?') ? '&' : '?';
-    char path[128];
-    snprintf(path, sizeof(path), "%s%climit=%d&offset=%d", resp->base_path, query, resp->limit, resp->recd);
-    CTRL_LOG(VERBOSE, "requesting %s", path);
-    start_request(resp->ctrl->client, "GET", path, ctrl_resp_cb, resp);
+    uv_gettimeofday(&resp->all_start);
+    CTRL_LOG(DEBUG, "starting paging request GET[%s]", resp->base_path);
+
+    // first page tells how many more to request
+    resp->next_page = 1;
+    page_req(resp, 0);
 }
 
 
@@ -14,8 +14,13 @@
 
 #include <ziti/ziti_src.h>
 #include <ziti/ziti_log.h>
+#include <tlsuv/queue.h>
 #include <string.h>
 
+#define POOL_MAX_IDLE_PER_TARGET 4
+#define POOL_MAX_IDLE 64
+#define POOL_IDLE_TIMEOUT 30000
+
 /**
  * Inherits from uv_lint_t and used to register as source link for `um_http`,
  * sening HTTP traffic over a Ziti connection.
@@ -25,8 +30,42 @@ typedef struct ziti_link_s {
     ziti_context ztx;
     ziti_connection conn;
     char *service;
+
+    // pooled source
+    tlsuv_src_t *src;
+    ziti_src_pool *pool;
+    char *key; // service and target address
+    bool reusable; // connected, no errors or EOF seen
+    bool ready_queued;
+    TAILQ_ENTRY(ziti_link_s) ready_next;
 } ziti_link_t;
 
+struct pooled_conn_s {
+    ziti_src_pool *pool;
+    ziti_connection conn;
+    char *key;
+    uint64_t idle_since;
+    TAILQ_ENTRY(pooled_conn_s) _next;
+};
+
+struct ziti_src_pool_s {
+    uv_loop_t *loop;
+    ziti_context ztx;
+    ziti_src_pool_opts opts;
+    ziti_src_pool_stats stats;
+
+    // most recently returned first
+    TAILQ_HEAD(pooled_conn_list, pooled_conn_s) idle;
+    uv_timer_t sweep;
+
+    // sources that got an idle connection, connect callback is called on the next loop iteration
+    TAILQ_HEAD(, ziti_link_s) ready;
+    uv_idle_t notify;
+
+    bool closing;
+    int open_handles;
+};
+
 // connect and release method for um_http custom source link
 static int ziti_src_connect(tlsuv_src_t *src, const char *, const char *, tlsuv_src_connect_cb cb, void *conn_ctx);
 
@@ -68,7 +107,7 @@ int ziti_src_init(uv_loop_t *l, tlsuv_src_t *st, const char *svc, ziti_context z
     st->connect = ziti_src_connect;
     st->connect_cb = NULL;
     st->release = ziti_src_release;
-    st->link = malloc(sizeof(ziti_link_t));
+    st->link = calloc(1, sizeof(ziti_link_t));
     uv_link_init(st->link, &ziti_link_methods);
 
     ziti_link_t *zl = (ziti_link_t *) st->link;
@@ -78,10 +117,172 @@ int ziti_src_init(uv_loop_t *l, tlsuv_src_t *st, const char *svc, ziti_context z
     else
         zl->service = NULL;
     zl->ztx = ztx;
+    zl->src = st;
     
     return 0; 
 }
 
+int ziti_src_init_pooled(uv_loop_t *l, tlsuv_src_t *st, const char *svc, ziti_src_pool *pool) {
+    int rc = ziti_src_init(l, st, svc, pool->ztx);
+    if (rc == 0) {
+        ((ziti_link_t *) st->link)->pool = pool;
+    }
+    return rc;
+}
+
+static void pool_evict(ziti_src_pool *pool, struct pooled_conn_s *pc) {
+    TAILQ_REMOVE(&pool->idle, pc, _next);
+    pool->stats.idle--;
+    pool->stats.evicted++;
+    ziti_close(pc->conn, NULL);
+    free(pc->key);
+    free(pc);
+}
+
+// idle connection is not expected to receive anything, data or EOF means it cannot be reused
+static ssize_t pool_idle_data_cb(ziti_connection conn, const uint8_t *data, ssize_t length) {
+    struct pooled_conn_s *pc = ziti_conn_data(conn);
+    ZITI_LOG(DEBUG, "idle connection to %s received %s", pc->key, length < 0 ? ziti_errorstr(length) : "data");
+    pool_evict(pc->pool, pc);
+    return length < 0 ? 0 : length;
+}
+
+static void pool_put(ziti_src_pool *pool, ziti_connection conn, const char *key) {
+    if (pool->closing) {
+        ziti_close(conn, NULL);
+        return;
+    }
+
+    // least recently used connections make room
+    int same = 0;
+    struct pooled_conn_s *oldest = NULL, *pc;
+    TAILQ_FOREACH(pc, &pool->idle, _next) {
+        if (strcmp(pc->key, key) == 0) {
+            same++;
+            oldest = pc;
+        }
+    }
+    if (oldest && same >= pool->opts.max_idle_per_target) {
+        pool_evict(pool, oldest);
+    }
+    if (!TAILQ_EMPTY(&pool->idle) && (int) pool->stats.idle >= pool->opts.max_idle) {
+        pool_evict(pool, TAILQ_LAST(&pool->idle, pooled_conn_list));
+    }
+
+    pc = calloc(1, sizeof(*pc));
+    pc->pool = pool;
+    pc->conn = conn;
+    pc->key = strdup(key);
+    pc->idle_since = uv_now(pool->loop);
+    ziti_conn_set_data(conn, pc);
+    ziti_conn_set_data_cb(conn, pool_idle_data_cb);
+    TAILQ_INSERT_HEAD(&pool->idle, pc, _next);
+    pool->stats.idle++;
+    pool->stats.returned++;
+}
+
+static ziti_connection pool_take(ziti_src_pool *pool, const char *key) {
+    uint64_t now = uv_now(pool->loop);
+    struct pooled_conn_s *pc = TAILQ_FIRST(&pool->idle);
+    while (pc) {
+        struct pooled_conn_s *next = TAILQ_NEXT(pc, _next);
+        if (now - pc->idle_since >= pool->opts.idle_timeout_ms) {
+            pool_evict(pool, pc);
+        } else if (strcmp(pc->key, key) == 0) {
+            ziti_connection conn = pc->conn;
+            TAILQ_REMOVE(&pool->idle, pc, _next);
+            pool->stats.idle--;
+            pool->stats.hits++;
+            free(pc->key);
+            free(pc);
+            return conn;
+        }
+        pc = next;
+    }
+    pool->stats.misses++;
+    return NULL;
+}
+
+static void pool_sweep_cb(uv_timer_t *t) {
+    ziti_src_pool *pool = t->data;
+    uint64_t now = uv_now(pool->loop);
+    struct pooled_conn_s *pc = TAILQ_FIRST(&pool->idle);
+    while (pc) {
+        struct pooled_conn_s *next = TAILQ_NEXT(pc, _next);
+        if (now - pc->idle_since >= pool->opts.idle_timeout_ms) {
+            ZITI_LOG(DEBUG, "closing idle connection to %s", pc->key);
+            pool_evict(pool, pc);
+        }
+        pc = next;
+    }
+}
+
+static void pool_notify_cb(uv_idle_t *h) {
+    ziti_src_pool *pool = h->data;
+    uv_idle_stop(h);
+    while (!TAILQ_EMPTY(&pool->ready)) {
+        ziti_link_t *zl = TAILQ_FIRST(&pool->ready);
+        TAILQ_REMOVE(&pool->ready, zl, ready_next);
+        zl->ready_queued = false;
+        zl->src->connect_cb(zl->src, ZITI_OK, zl->src->connect_ctx);
+    }
+}
+
+ziti_src_pool *ziti_src_pool_new(uv_loop_t *l, ziti_context ztx, const ziti_src_pool_opts *opts) {
+    ziti_src_pool *pool = calloc(1, sizeof(*pool));
+    pool->loop = l;
+    pool->ztx = ztx;
+    if (opts) {
+        pool->opts = *opts;
+    }
+    if (pool->opts.max_idle_per_target <= 0) {
+        pool->opts.max_idle_per_target = POOL_MAX_IDLE_PER_TARGET;
+    }
+    if (pool->opts.max_idle <= 0) {
+        pool->opts.max_idle = POOL_MAX_IDLE;
+    }
+    if (pool->opts.idle_timeout_ms == 0) {
+        pool->opts.idle_timeout_ms = POOL_IDLE_TIMEOUT;
+    }
+    TAILQ_INIT(&pool->idle);
+    TAILQ_INIT(&pool->ready);
+
+    uv_timer_init(l, &pool->sweep);
+    pool->sweep.data = pool;
+    uint64_t sweep_interval = pool->opts.idle_timeout_ms / 2 + 1;
+    uv_timer_start(&pool->sweep, pool_sweep_cb, sweep_interval, sweep_interval);
+    uv_unref((uv_handle_t *) &pool->sweep);
+
+    uv_idle_init(l, &pool->notify);
+    pool->notify.data = pool;
+    pool->open_handles = 2;
+    return pool;
+}
+
+void ziti_src_pool_get_stats(ziti_src_pool *pool, ziti_src_pool_stats *stats) {
+    *stats = pool->stats;
+}
+
+static void pool_handle_close_cb(uv_handle_t *h) {
+    ziti_src_pool *pool = h->data;
+    if (--pool->open_handles == 0) {
+        free(pool);
+    }
+}
+
+void ziti_src_pool_free(ziti_src_pool *pool) {
+    if (pool == NULL || pool->closing) {
+        return;
+    }
+
+    pool->closing = true;
+    while (!TAILQ_EMPTY(&pool->idle)) {
+        pool_evict(pool, TAILQ_FIRST(&pool->idle));
+    }
+    uv_close((uv_handle_t *) &pool->sweep, pool_handle_close_cb);
+    uv_close((uv_handle_t *) &pool->notify, pool_handle_close_cb);
+}
+
 static int
 ziti_src_connect(tlsuv_src_t *src, const char *host, const char *port, tlsuv_src_connect_cb cb, void *conn_ctx) {
     ziti_link_t *zl = (ziti_link_t *) src->link;
@@ -104,6 +305,26 @@ ziti_src_connect(tlsuv_src_t *src, const char *host, const char *port, tlsuv_src
     src->connect_cb = cb;
     src->connect_ctx = conn_ctx;
 
+    if (zl->pool) {
+        size_t key_len = strlen(zl->service) + strlen(host) + strlen(port) + 3;
+        free(zl->key);
+        zl->key = malloc(key_len);
+        snprintf(zl->key, key_len, "%s|%s:%s", zl->service, host, port);
+
+        ziti_connection idle = pool_take(zl->pool, zl->key);
+        if (idle) {
+            ZITI_LOG(TRACE, "reusing idle connection to %s", zl->key);
+            zl->conn = idle;
+            zl->reusable = true;
+            ziti_conn_set_data(idle, src);
+            ziti_conn_set_data_cb(idle, zlnf_data_cb);
+            TAILQ_INSERT_TAIL(&zl->pool->ready, zl, ready_next);
+            zl->ready_queued = true;
+            uv_idle_start(&zl->pool->notify, pool_notify_cb);
+            return 0;
+        }
+    }
+
     int status = ziti_conn_init(zl->ztx, &zl->conn, src);
     if (status != ZITI_OK) {
         return status;
@@ -130,12 +351,17 @@ ziti_src_connect(tlsuv_src_t *src, const char *host, const char *port, tlsuv_src
 
 static void ziti_src_release(tlsuv_src_t *src) {
     ziti_link_t *zl = (ziti_link_t *) src->link;
+    if (zl->ready_queued) {
+        TAILQ_REMOVE(&zl->pool->ready, zl, ready_next);
+    }
+    free(zl->key);
     free(zl->service);
     free(src->link);
 }
 
 static void zlnf_conn_cb(ziti_connection conn, int status) {
     tlsuv_src_t *src = (tlsuv_src_t *) ziti_conn_data(conn);
+    ((ziti_link_t *) src->link)->reusable = status == ZITI_OK;
     src->connect_cb(src, status, src->connect_ctx);
 }
 
@@ -144,6 +370,10 @@ static ssize_t zlnf_data_cb(ziti_connection conn, const uint8_t *data, ssize_t l
     tlsuv_src_t *src = (tlsuv_src_t *) ziti_conn_data(conn);
     uv_buf_t read_buf;
 
+    if (length < 0) {
+        ((ziti_link_t *) src->link)->reusable = false;
+    }
+
     if (length == ZITI_EOF) {
         ZITI_LOG(TRACE, "ZITI_EOF");
         uv_link_propagate_read_cb(src->link, UV_EOF, NULL);
@@ -172,6 +402,9 @@ static ssize_t zlnf_data_cb(ziti_connection conn, const uint8_t *data, ssize_t l
 
 static void zlnf_write_cb(ziti_connection conn, ssize_t status, void *ctx) {
     struct zl_write_req_s *req = ctx;
+    if (status < 0) {
+        req->zl->reusable = false;
+    }
     req->cb((uv_link_t *) req->zl, (int) status, req->arg);
     free(req);
 }
@@ -198,7 +431,13 @@ void zl_close(uv_link_t* link, uv_link_t* source, uv_link_close_cb link_close_cb
     ziti_link_t *zl = (ziti_link_t *)link;
 
     ZITI_LOG(TRACE, "%s", zl->service);
-    ziti_close(zl->conn, NULL);
+    if (zl->pool && zl->reusable && zl->conn) {
+        pool_put(zl->pool, zl->conn, zl->key);
+    } else {
+        ziti_close(zl->conn, NULL);
+    }
+    zl->conn = NULL;
+    zl->reusable = false;
     link_close_cb((uv_link_t *) zl);
 }
 
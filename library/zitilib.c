@@ -35,16 +35,39 @@ typedef uint16_t in_port_t;
 #include <ziti/ziti.h>
 #include <ziti/ziti_log.h>
 #include "zt_internal.h"
+#include "pool.h"
+#include "resolve_cache.h"
 
 static bool is_blocking(ziti_socket_t s);
 
 ZITI_FUNC
 const char *Ziti_lookup(in_addr_t addr);
 
+#if _WIN32
+typedef volatile LONG future_atomic;
+#define future_load(p) InterlockedCompareExchange((p), 0, 0)
+#define future_store(p, v) InterlockedExchange((p), (v))
+#define future_cas(p, e, v) (InterlockedCompareExchange((p), (v), (e)) == (e))
+#define future_add(p, v) InterlockedExchangeAdd((p), (v))
+#else
+#include <stdatomic.h>
+typedef atomic_int future_atomic;
+#define future_load(p) atomic_load(p)
+#define future_store(p, v) atomic_store((p), (v))
+#define future_add(p, v) atomic_fetch_add((p), (v))
+static inline bool future_cas(future_atomic *p, int e, int v) {
+    return atomic_compare_exchange_strong(p, &e, v);
+}
+#endif
+
+enum future_state {
+    FUTURE_PENDING,
+    FUTURE_COMPLETING,
+    FUTURE_DONE,
+};
+
 typedef struct future_s {
-    uv_mutex_t lock;
-    uv_cond_t cond;
-    bool completed;
+    future_atomic state;
     void *result;
     int err;
 
@@ -58,23 +81,47 @@ static const char *configs[] = {
 };
 
 
-static future_t *new_future() {
-    future_t *f = calloc(1, sizeof(future_t));
-    int rc = uv_mutex_init(&f->lock);
-    if (rc != 0) {
-        fprintf(stderr, "failed to init lock %d/%s\n", rc, uv_strerror(rc));
-    }
-    rc = uv_cond_init(&f->cond);
-    if (rc != 0) {
-        fprintf(stderr, "failed to init cond %d/%s\n", rc, uv_strerror(rc));
+// futures and loop queue elements are allocated by caller threads and freed on the loop thread (or vice versa)
+#define LIB_POOL_CAPACITY 256
+static mt_pool_t *future_pool;
+static mt_pool_t *elem_pool;
+
+/*
+ * Futures are completed with atomic state change, so most of them (completed before caller gets to await)
+ * never touch a lock. Blocked callers park on one of the shared slots picked by future address.
+ * Completer only looks at the slot after the future is done: waiter is free to destroy it at that point.
+ */
+#define FUTURE_PARK_SLOTS 16
+
+static struct park_slot_s {
+    uv_mutex_t lock;
+    uv_cond_t cond;
+    future_atomic waiters;
+} park_slots[FUTURE_PARK_SLOTS];
+
+static struct park_slot_s *park_slot(future_t *f) {
+    uintptr_t h = (uintptr_t) f;
+    return &park_slots[(h >> 4) % FUTURE_PARK_SLOTS];
+}
+
+static void init_park_slots(void) {
+    for (int i = 0; i < FUTURE_PARK_SLOTS; i++) {
+        uv_mutex_init(&park_slots[i].lock);
+        uv_cond_init(&park_slots[i].cond);
+        park_slots[i].waiters = 0;
     }
-    return f;
+}
+
+static future_t *new_future() {
+    return mt_pool_alloc(future_pool);
 }
 
 static void destroy_future(future_t *f) {
-    uv_mutex_destroy(&f->lock);
-    uv_cond_destroy(&f->cond);
-    free(f);
+    mt_pool_free(f);
+}
+
+static bool future_done(future_t *f) {
+    return future_load(&f->state) == FUTURE_DONE;
 }
 
 static int await_future(future_t *f) {
@@ -82,69 +129,92 @@ static int await_future(future_t *f) {
         return 0;
     }
 
-    uv_mutex_lock(&f->lock);
-    while (!f->completed) {
-        uv_cond_wait(&f->cond, &f->lock);
+    if (!future_done(f)) {
+        struct park_slot_s *slot = park_slot(f);
+        future_add(&slot->waiters, 1);
+        uv_mutex_lock(&slot->lock);
+        while (!future_done(f)) {
+            uv_cond_wait(&slot->cond, &slot->lock);
+        }
+        uv_mutex_unlock(&slot->lock);
+        future_add(&slot->waiters, -1);
     }
-    int err = f->err;
-    uv_mutex_unlock(&f->lock);
-    return err;
+    return f->err;
 }
 
-static int complete_future(future_t *f, void *result) {
+static int settle_future(future_t *f, void *result, int err) {
     if (f == NULL) return 0;
 
-    int rc = UV_EINVAL;
-    uv_mutex_lock(&f->lock);
-    if (!f->completed) {
-        f->completed = true;
-        f->result = result;
-        uv_cond_broadcast(&f->cond);
-        rc = 0;
+    if (!future_cas(&f->state, FUTURE_PENDING, FUTURE_COMPLETING)) {
+        return UV_EINVAL;
     }
-    uv_mutex_unlock(&f->lock);
-    return rc;
-}
 
-static int fail_future(future_t *f, int err) {
-    if (f == NULL) return 0;
+    struct park_slot_s *slot = park_slot(f);
+    f->result = result;
+    f->err = err;
+    future_store(&f->state, FUTURE_DONE);
 
-    int rc = UV_EINVAL;
-    uv_mutex_lock(&f->lock);
-    if (!f->completed) {
-        f->completed = true;
-        f->err = err;
-        uv_cond_broadcast(&f->cond);
-        rc = 0;
+    // f must not be touched from here on
+    if (future_load(&slot->waiters) > 0) {
+        uv_mutex_lock(&slot->lock);
+        uv_cond_broadcast(&slot->cond);
+        uv_mutex_unlock(&slot->lock);
     }
-    uv_mutex_unlock(&f->lock);
-    return rc;
+    return 0;
+}
+
+static int complete_future(future_t *f, void *result) {
+    return settle_future(f, result, 0);
+}
+
+static int fail_future(future_t *f, int err) {
+    return settle_future(f, NULL, err);
 }
 
 typedef void (*loop_work_cb)(void *arg, future_t *f, uv_loop_t *l);
 
 typedef struct queue_elem_s {
+    mpsc_node_t _node;
     loop_work_cb cb;
     void *arg;
     future_t *f;
-    LIST_ENTRY(queue_elem_s) _next;
 } queue_elem_t;
 
+// each worker loop runs its own set of contexts, together with their channels and bridged sockets
+typedef struct lib_loop_s {
+    uv_loop_t *loop;
+    uv_thread_t thread;
+    uv_async_t q_async;
+    mpsc_queue_t q;
+
+    // (child process) contexts inherited from parent are loaded
+    future_t *init_f;
+
+    // ztx_wrap_t owned by this loop, only touched on its thread
+    model_list contexts;
+} lib_loop_t;
+
+#define LIB_LOOPS_MAX 64
+
 static void internal_init();
 
-static future_t *schedule_on_loop(loop_work_cb cb, void *arg, bool wait);
+// w == NULL schedules on the first(main) loop
+static future_t *schedule_on_loop(lib_loop_t *w, loop_work_cb cb, void *arg, bool wait);
 
 static void do_shutdown(void *args, future_t *f, uv_loop_t *l);
 
 static uv_once_t init;
-static uv_loop_t *lib_loop;
-static uv_thread_t lib_thread;
+// read by application threads directly, see lookup_service()
+static resolve_cache lib_resolve_cache;
+static int lib_loops_requested = 1;
+static int lib_loops_count;
+static lib_loop_t *lib_loops;
 static uv_key_t err_key;
-static uv_mutex_t q_mut;
-static uv_async_t q_async;
-static LIST_HEAD(loop_queue, queue_elem_s) loop_q;
 
-static future_t *child_init_future;
+// guards ziti_contexts and ziti_sockets, they are shared by all loops
+static uv_mutex_t lib_lock;
+
+#define loop_worker(l) ((lib_loop_t *) (l)->data)
 
 
 #if _WIN32
@@ -162,6 +232,7 @@ struct sockaddr_un {
 typedef struct ztx_wrap {
     ziti_options opts;
     ziti_context ztx;
+    lib_loop_t *loop;
     TAILQ_HEAD(futures, future_s) futures;
 
     future_t *services_loaded;
@@ -176,12 +247,18 @@ struct backlog_entry_s {
     TAILQ_ENTRY(backlog_entry_s) _next;
 };
 
+struct sock_info_s {
+    ziti_socket_t fd;
+    char *peer;
+};
+
 typedef struct ziti_sock_s {
     ziti_socket_t fd;
     ziti_socket_t ziti_fd;
     future_t *f;
     ziti_context ztx;
     ziti_connection conn;
+    lib_loop_t *loop;
 
     char *service;
     bool server;
@@ -189,6 +266,16 @@ typedef struct ziti_sock_s {
     model_list backlog;
     TAILQ_HEAD(, future_s) accept_q;
 
+    // non-blocking connect, see Ziti_check_socket()
+    bool async;
+    bool connecting; // guarded by lib_lock
+    int conn_err;    // guarded by lib_lock
+    size_t filler;
+    int sndbuf;
+
+    // non-blocking server: clients accepted ahead of Ziti_accept(), guarded by lib_lock
+    model_list ready;
+    int accepting;
 } ziti_sock_t;
 
 static model_map ziti_contexts;
@@ -196,12 +283,80 @@ static model_map ziti_contexts;
 static model_map ziti_sockets;
 
 void Ziti_lib_init(void) {
+    const char *loops = getenv("ZITI_LIB_LOOPS");
+    Ziti_lib_init_loops(loops ? (int) strtol(loops, NULL, 10) : 1);
+}
+
+void Ziti_lib_init_loops(int count) {
+    lib_loops_requested = count;
     uv_once(&init, internal_init);
 }
 
 ZITI_FUNC
 uv_thread_t Ziti_lib_thread() {
-    return lib_thread;
+    return lib_loops[0].thread;
+}
+
+// identity is always handled by the same loop, so that repeated loads find the existing context
+static lib_loop_t *identity_loop(const char *identity) {
+    uint64_t h = 14695981039346656037ULL;
+    for (const char *p = identity; p && *p; p++) {
+        h = (h ^ (uint8_t) *p) * 1099511628211ULL;
+    }
+    return &lib_loops[h % lib_loops_count];
+}
+
+static lib_loop_t *ztx_loop(ziti_context ztx) {
+    ztx_wrap_t *wrap = ziti_app_ctx(ztx);
+    return wrap ? wrap->loop : NULL;
+}
+
+static ziti_sock_t *sock_get(ziti_socket_t fd) {
+    uv_mutex_lock(&lib_lock);
+    ziti_sock_t *zs = model_map_get_key(&ziti_sockets, &fd, sizeof(fd));
+    uv_mutex_unlock(&lib_lock);
+    return zs;
+}
+
+static void sock_set(ziti_sock_t *zs) {
+    uv_mutex_lock(&lib_lock);
+    model_map_set_key(&ziti_sockets, &zs->fd, sizeof(zs->fd), zs);
+    uv_mutex_unlock(&lib_lock);
+}
+
+static ziti_sock_t *sock_remove(ziti_socket_t fd) {
+    uv_mutex_lock(&lib_lock);
+    ziti_sock_t *zs = model_map_remove_key(&ziti_sockets, &fd, sizeof(fd));
+    uv_mutex_unlock(&lib_lock);
+    return zs;
+}
+
+// same as sock_remove(), but also releases socket of failed non-blocking connect
+// -- it is never bridged, so nothing else would free it
+static ziti_sock_t *sock_remove_live(ziti_socket_t fd) {
+    ziti_sock_t *failed = NULL;
+    uv_mutex_lock(&lib_lock);
+    ziti_sock_t *zs = model_map_remove_key(&ziti_sockets, &fd, sizeof(fd));
+    if (zs && zs->async && zs->conn_err != 0) {
+        failed = zs;
+        zs = NULL;
+    }
+    uv_mutex_unlock(&lib_lock);
+
+    if (failed) {
+        free(failed->service);
+        free(failed);
+    }
+    return zs;
+}
+
+// loop that owns the socket, NULL if fd is not a ziti socket
+static lib_loop_t *sock_loop(ziti_socket_t fd) {
+    uv_mutex_lock(&lib_lock);
+    ziti_sock_t *zs = model_map_get_key(&ziti_sockets, &fd, sizeof(fd));
+    lib_loop_t *w = zs ? zs->loop : NULL;
+    uv_mutex_unlock(&lib_lock);
+    return w;
 }
 
 int Ziti_last_error() {
@@ -215,6 +370,8 @@ static void set_error(int err) {
 
 static void on_ctx_event(ziti_context ztx, const ziti_event_t *ev) {
     ztx_wrap_t *wrap = ziti_app_ctx(ztx);
+    // cached lookups may point to changed services or to this context
+    resolve_cache_invalidate(&lib_resolve_cache);
     if (ev->type == ZitiContextEvent) {
         int err = ev->event.ctx.ctrl_status;
         if (err == ZITI_OK) {
@@ -276,15 +433,16 @@ static void on_ctx_event(ziti_context ztx, const ziti_event_t *ev) {
             FREE(intercept);
         }
 
-        if (!wrap->services_loaded->completed) {
-            complete_future(wrap->services_loaded, NULL);
-        }
+        // no-op after the first service update
+        complete_future(wrap->services_loaded, NULL);
     }
 }
 
 static void load_ziti_ctx(void *arg, future_t *f, uv_loop_t *l) {
     int rc = 0;
+    uv_mutex_lock(&lib_lock);
     struct ztx_wrap *wrap = model_map_get(&ziti_contexts, arg);
+    uv_mutex_unlock(&lib_lock);
 
 
     if (wrap) {
@@ -310,6 +468,7 @@ static void load_ziti_ctx(void *arg, future_t *f, uv_loop_t *l) {
     if (rc != ZITI_OK) goto error;
 
     wrap = calloc(1, sizeof(struct ztx_wrap));
+    wrap->loop = loop_worker(l);
     rc = ziti_context_set_options(ztx, &(ziti_options){
             .app_ctx = wrap,
             .event_cb = on_ctx_event,
@@ -327,7 +486,10 @@ static void load_ziti_ctx(void *arg, future_t *f, uv_loop_t *l) {
     rc = ziti_context_run(ztx, l);
     if (rc != ZITI_OK) goto error;
 
+    uv_mutex_lock(&lib_lock);
     model_map_set(&ziti_contexts, arg, wrap);
+    uv_mutex_unlock(&lib_lock);
+    model_list_append(&wrap->loop->contexts, wrap);
 
 error:
 
@@ -343,7 +505,7 @@ error:
 }
 
 ziti_context Ziti_load_context(const char *identity) {
-    future_t *f = schedule_on_loop(load_ziti_ctx, (void *) identity, true);
+    future_t *f = schedule_on_loop(identity_loop(identity), load_ziti_ctx, (void *) identity, true);
     int err = await_future(f);
     set_error(err);
     ziti_context ztx = (ziti_context) f->result;
@@ -497,6 +659,8 @@ static int connect_socket(ziti_socket_t clt_sock, ziti_socket_t *ziti_sock) {
         return errno;
     }
 
+    // new socket replaces the application's, keep its blocking mode
+    int clt_flags = fcntl(clt_sock, F_GETFL, 0);
     rc = dup2(fds[0], clt_sock);
     if (rc == -1) {
         ZITI_LOG(WARN, "dup2 failed[%d/%s]", errno, strerror(errno));
@@ -505,6 +669,9 @@ static int connect_socket(ziti_socket_t clt_sock, ziti_socket_t *ziti_sock) {
         return errno;
     }
     close(fds[0]);
+    if (clt_flags != -1 && (clt_flags & O_NONBLOCK)) {
+        fcntl(clt_sock, F_SETFL, fcntl(clt_sock, F_GETFL, 0) | O_NONBLOCK);
+    }
 #if defined(SO_NOSIGPIPE)
     int nosig = 1;
     setsockopt(fds[1], SOL_SOCKET, SO_NOSIGPIPE, (void *)&nosig, sizeof(int));
@@ -521,7 +688,7 @@ static int connect_socket(ziti_socket_t clt_sock, ziti_socket_t *ziti_sock) {
 static void check_socket(void *arg, future_t *f, uv_loop_t *l) {
     ziti_socket_t fd = (ziti_socket_t) (uintptr_t) arg;
     ZITI_LOG(VERBOSE, "checking client fd[%d]", fd);
-    ziti_sock_t *s = model_map_remove_key(&ziti_sockets, &fd, sizeof(fd));
+    ziti_sock_t *s = sock_remove_live(fd);
     if (s) {
         ZITI_LOG(VERBOSE, "stale ziti_sock_t[fd=%d]", fd);
         s->fd = SOCKET_ERROR;
@@ -532,8 +699,9 @@ static void check_socket(void *arg, future_t *f, uv_loop_t *l) {
 ziti_socket_t Ziti_socket(int type) {
     ziti_socket_t fd = socket(AF_INET, type, 0);
     set_error(fd < 0 ? errno : 0);
-    if (fd > 0) {
-        future_t *f = schedule_on_loop(check_socket, (void *) (uintptr_t) fd, true);
+    lib_loop_t *w;
+    if (fd > 0 && (w = sock_loop(fd)) != NULL) {
+        future_t *f = schedule_on_loop(w, check_socket, (void *) (uintptr_t) fd, true);
         await_future(f);
         destroy_future(f);
     }
@@ -543,7 +711,22 @@ ziti_socket_t Ziti_socket(int type) {
 static void close_work(void *arg, future_t *f, uv_loop_t *l) {
     ziti_socket_t fd = (ziti_socket_t) (uintptr_t) arg;
     ZITI_LOG(DEBUG, "closing client fd[%d]", fd);
-    ziti_sock_t *s = model_map_remove_key(&ziti_sockets, &fd, sizeof(fd));
+    ziti_sock_t *s = sock_remove_live(fd);
+    if (s && s->server) {
+        // clients accepted for non-blocking server, but never picked up
+        struct sock_info_s *si;
+        while ((si = model_list_pop(&s->ready)) != NULL) {
+            if (sock_remove(si->fd) != NULL) {
+#if _WIN32
+                closesocket(si->fd);
+#else
+                close(si->fd);
+#endif
+            }
+            free(si->peer);
+            free(si);
+        }
+    }
 #if _WIN32
     closesocket(fd);
 #else
@@ -553,10 +736,10 @@ static void close_work(void *arg, future_t *f, uv_loop_t *l) {
 }
 
 int Ziti_close(ziti_socket_t fd) {
-    ziti_sock_t *s = model_map_get_key(&ziti_sockets, &fd, sizeof(fd));
-    if (s) {
+    lib_loop_t *w = sock_loop(fd);
+    if (w) {
         ZITI_LOG(DEBUG, "closing ziti socket[%d]", fd);
-        future_t *f = schedule_on_loop(close_work, (void *) (uintptr_t) fd, true);
+        future_t *f = schedule_on_loop(w, close_work, (void *) (uintptr_t) fd, true);
         await_future(f);
         destroy_future(f);
         return 0;
@@ -578,7 +761,7 @@ struct conn_req_s {
 static void on_bridge_close(void *ctx) {
     ziti_sock_t *zs = ctx;
     ZITI_LOG(DEBUG, "closed conn for socket(%d)", zs->fd);
-    model_map_remove_key(&ziti_sockets, &zs->fd, sizeof(zs->fd));
+    sock_remove(zs->fd);
 #if _WIN32
     closesocket(zs->ziti_fd);
 #else
@@ -588,8 +771,93 @@ static void on_bridge_close(void *ctx) {
     free(zs);
 }
 
+#if !_WIN32
+/*
+ * Non-blocking connect.
+ * Client socket is connected to its bridge socket right away, so that application can register it with epoll/poll.
+ * Its (minimized) send buffer is then filled up, and the socket only becomes writable once dial succeeds
+ * and the loop drains the filler. Failed socket is hung up, the error is reported by Ziti_check_socket().
+ */
+static int sock_async_prepare(ziti_sock_t *zs) {
+    int rc = connect_socket(zs->fd, &zs->ziti_fd);
+    if (rc != 0) {
+        return rc;
+    }
+
+    socklen_t optlen = sizeof(zs->sndbuf);
+    getsockopt(zs->fd, SOL_SOCKET, SO_SNDBUF, &zs->sndbuf, &optlen);
+#if defined(__linux__)
+    zs->sndbuf /= 2; // linux reports doubled value
+#endif
+    int min_buf = 1;
+    setsockopt(zs->fd, SOL_SOCKET, SO_SNDBUF, &min_buf, sizeof(min_buf));
+
+    static const char filler[4096];
+    ssize_t n;
+    while ((n = send(zs->fd, filler, sizeof(filler), 0)) > 0) {
+        zs->filler += n;
+    }
+    zs->async = true;
+    zs->connecting = true;
+    return 0;
+}
+
+static void sock_async_connected(ziti_sock_t *zs) {
+    uv_mutex_lock(&lib_lock);
+    zs->connecting = false;
+    uv_mutex_unlock(&lib_lock);
+
+    char buf[4096];
+    while (zs->filler > 0) {
+        ssize_t n = read(zs->ziti_fd, buf, MIN(sizeof(buf), zs->filler));
+        if (n <= 0) break;
+        zs->filler -= n;
+    }
+    setsockopt(zs->fd, SOL_SOCKET, SO_SNDBUF, &zs->sndbuf, sizeof(zs->sndbuf));
+}
+
+static void sock_async_failed(ziti_sock_t *zs, int err) {
+    // once conn_err is set, whoever removes the socket frees it
+    uv_mutex_lock(&lib_lock);
+    bool registered = model_map_get_key(&ziti_sockets, &zs->fd, sizeof(zs->fd)) == zs;
+    ziti_socket_t ziti_fd = zs->ziti_fd;
+    zs->ziti_fd = SOCKET_ERROR;
+    zs->connecting = false;
+    zs->conn_err = err;
+    uv_mutex_unlock(&lib_lock);
+
+    // application sees hang up, socket stays registered to report the error
+    if (ziti_fd != SOCKET_ERROR) {
+        close(ziti_fd);
+    }
+
+    // application already closed it
+    if (!registered) {
+        free(zs->service);
+        free(zs);
+    }
+}
+#endif
+
 static void on_ziti_connect(ziti_connection conn, int status) {
     ziti_sock_t *zs = ziti_conn_data(conn);
+#if !_WIN32
+    if (zs->async) {
+        if (status == ZITI_OK) {
+            sock_async_connected(zs);
+            ZITI_LOG(DEBUG, "bridge connected to ziti fd[%d]->ziti_fd[%d]->conn[%d]->service[%s]",
+                     zs->fd, zs->ziti_fd, zs->conn->conn_id, zs->service);
+            ziti_conn_bridge_fds(conn, (uv_os_fd_t) zs->ziti_fd, (uv_os_fd_t) zs->ziti_fd, on_bridge_close, zs);
+        } else {
+            ZITI_LOG(WARN, "failed to establish ziti connection: %d(%s)", status, ziti_errorstr(status));
+            ziti_close(zs->conn, NULL);
+            zs->conn = NULL;
+            sock_async_failed(zs, status);
+        }
+        return;
+    }
+#endif
+
     if (status == ZITI_OK) {
         int rc = connect_socket(zs->fd, &zs->ziti_fd);
         if (rc != 0) {
@@ -660,90 +928,306 @@ static const char* find_service(ztx_wrap_t *wrap, int type, const char *host, ui
     return best;
 }
 
-static void do_ziti_connect(struct conn_req_s *req, future_t *f, uv_loop_t *l) {
-    ZITI_LOG(DEBUG, "connecting fd[%d] to %s:%d", req->fd, req->host, req->port);
-    ziti_sock_t *zs = model_map_get_key(&ziti_sockets, &req->fd, sizeof(req->fd));
-    if (zs != NULL) {
-        ZITI_LOG(WARN, "socket %lu already connecting/connected", (unsigned long) req->fd);
-        fail_future(f, EALREADY);
-        return;
-    }
-
+static int socket_type(ziti_socket_t fd) {
     int proto = 0;
     socklen_t optlen = sizeof(proto);
-    if (getsockopt(req->fd, SOL_SOCKET, SO_TYPE, &proto, &optlen)) {
-        ZITI_LOG(WARN, "unknown socket type fd[%d]: %d(%s)", req->fd, errno, strerror(errno));
+    if (getsockopt(fd, SOL_SOCKET, SO_TYPE, &proto, &optlen)) {
+        ZITI_LOG(WARN, "unknown socket type fd[%d]: %d(%s)", fd, errno, strerror(errno));
     }
+    return proto;
+}
 
-    in_addr_t ip;
-    const char *host = NULL;
-    if (uv_inet_pton(AF_INET, req->host, &ip) == 0) { // try reverse lookup
-        host = Ziti_lookup(ip);
+struct lookup_req_s {
+    int type;
+    const char *host;
+    uint16_t port;
+
+    ziti_context ztx;
+    char *service;
+};
+
+// looks for the service among contexts owned by this loop, other loops are not held up
+static void do_find_service(void *arg, future_t *f, uv_loop_t *l) {
+    struct lookup_req_s *req = arg;
+    lib_loop_t *w = loop_worker(l);
+
+    ztx_wrap_t *wrap;
+    MODEL_LIST_FOREACH(wrap, w->contexts) {
+        if (wrap->ztx == NULL) continue;
+
+        const char *service_name = find_service(wrap, req->type, req->host, req->port);
+        if (service_name != NULL) {
+            // service may go away before it is dialed on its loop
+            req->ztx = wrap->ztx;
+            req->service = strdup(service_name);
+            break;
+        }
     }
-    if (host == NULL) {
-        host = req->host;
+    complete_future(f, NULL);
+}
+
+static bool cached_service(struct lookup_req_s *req) {
+    char service[RESOLVE_CACHE_STR_WORDS * sizeof(uint64_t)];
+    void *ztx;
+    if (req->ztx == NULL &&
+        resolve_cache_get(&lib_resolve_cache, req->type, req->host, req->port, &ztx, service, NULL)) {
+        req->ztx = ztx;
+        req->service = strdup(service);
+        return true;
     }
+    return false;
+}
 
-    if (req->ztx == NULL) {
-        MODEL_MAP_FOR(it, ziti_contexts) {
-            ztx_wrap_t *wrap = model_map_it_value(it);
-            const char *service_name = find_service(wrap, proto, host, req->port);
+// service data belongs to the loops, so all of them are asked at once -- unless it was looked up before.
+// first loop with a match wins, same as asking them in turn
+static int lookup_service(struct lookup_req_s *req) {
+    if (cached_service(req)) {
+        return 0;
+    }
 
-            if (service_name != NULL) {
-                req->ztx = wrap->ztx;
-                req->service = service_name;
-                break;
-            }
+    uint64_t gen = resolve_cache_gen(&lib_resolve_cache);
+    struct lookup_req_s *reqs = calloc(lib_loops_count, sizeof(*reqs));
+    future_t **futures = calloc(lib_loops_count, sizeof(*futures));
+    for (int i = 0; i < lib_loops_count; i++) {
+        reqs[i] = *req;
+        futures[i] = schedule_on_loop(&lib_loops[i], do_find_service, &reqs[i], true);
+    }
+    for (int i = 0; i < lib_loops_count; i++) {
+        await_future(futures[i]);
+        destroy_future(futures[i]);
+        if (req->ztx == NULL && reqs[i].ztx != NULL) {
+            req->ztx = reqs[i].ztx;
+            req->service = reqs[i].service;
+        } else {
+            free(reqs[i].service);
         }
     }
+    free(futures);
+    free(reqs);
+
+    if (req->ztx) {
+        resolve_cache_put(&lib_resolve_cache, gen, req->type, req->host, req->port, req->ztx, req->service, 0);
+    }
+    return req->ztx ? 0 : -1;
+}
+
+static void await_contexts(void) {
+    for (int i = 0; i < lib_loops_count; i++) {
+        await_future(lib_loops[i].init_f);
+    }
+
+    uv_mutex_lock(&lib_lock);
+    size_t count = model_map_size(&ziti_contexts);
+    future_t **loaded = calloc(count + 1, sizeof(future_t *));
+    size_t idx = 0;
+    MODEL_MAP_FOR(it, ziti_contexts) {
+        ztx_wrap_t *wrap = model_map_it_value(it);
+        loaded[idx++] = wrap->services_loaded;
+    }
+    uv_mutex_unlock(&lib_lock);
+
+    // must not hold the lock here: loops need it to make progress
+    for (idx = 0; loaded[idx] != NULL; idx++) {
+        await_future(loaded[idx]);
+    }
+    free(loaded);
+}
 
+static void sock_dial(ziti_sock_t *zs, struct conn_req_s *req, int proto) {
     const char *proto_str = proto == SOCK_DGRAM ? "udp" : "tcp";
+    ziti_conn_init(req->ztx, &zs->conn, zs);
+    char app_data[1024];
+    size_t len = snprintf(app_data, sizeof(app_data),
+                          "{\"dst_protocol\": \"%s\", \"dst_hostname\": \"%s\", \"dst_port\": \"%u\"}",
+                          proto_str, req->host, req->port);
+    ziti_dial_opts opts = {
+            .app_data = app_data,
+            .app_data_sz = len,
+            .identity = (char *) req->terminator, // copied by ziti_dial_with_options()
+            .datagram = proto == SOCK_DGRAM,
+    };
+    ZITI_LOG(DEBUG, "connecting fd[%d] to service[%s]", zs->fd, req->service);
+    ziti_dial_with_options(zs->conn, req->service, &opts, on_ziti_connect, NULL);
+}
+
+static void do_ziti_connect(struct conn_req_s *req, future_t *f, uv_loop_t *l) {
+    ZITI_LOG(DEBUG, "connecting fd[%d] to %s:%d", req->fd, req->host, req->port);
+    ziti_sock_t *zs = sock_get(req->fd);
+    if (zs != NULL) {
+        ZITI_LOG(WARN, "socket %lu already connecting/connected", (unsigned long) req->fd);
+        fail_future(f, EALREADY);
+        return;
+    }
+
+    int proto = socket_type(req->fd);
     if (req->ztx != NULL) {
         zs = calloc(1, sizeof(*zs));
         zs->fd = req->fd;
         zs->f = f;
+        zs->loop = loop_worker(l);
         zs->service = strdup(req->service);
 
-        model_map_set_key(&ziti_sockets, &zs->fd, sizeof(zs->fd), zs);
-
-        ziti_conn_init(req->ztx, &zs->conn, zs);
-        char app_data[1024];
-        size_t len = snprintf(app_data, sizeof(app_data),
-                              "{\"dst_protocol\": \"%s\", \"dst_hostname\": \"%s\", \"dst_port\": \"%u\"}",
-                              proto_str, req->host, req->port);
-        ziti_dial_opts opts = {
-                .app_data = app_data,
-                .app_data_sz = len,
-                .identity = req->terminator,
-        };
-        ZITI_LOG(DEBUG, "connecting fd[%d] to service[%s]", zs->fd, req->service);
-        ziti_dial_with_options(zs->conn, req->service, &opts, on_ziti_connect, NULL);
+        sock_set(zs);
+        sock_dial(zs, req, proto);
     } else {
-        ZITI_LOG(WARN, "no service for target address[%s:%s:%d]", proto_str, req->host, req->port);
+        ZITI_LOG(WARN, "no service for target address[%s:%s:%d]", proto == SOCK_DGRAM ? "udp" : "tcp", req->host, req->port);
         fail_future(f, ECONNREFUSED);
     }
 }
 
+#if !_WIN32
+// non-blocking connect request, it is passed from loop to loop until one of them has the service
+struct async_conn_s {
+    ziti_sock_t *zs;
+    int proto;
+    int loop_idx;
+    struct lookup_req_s lookup;
+
+    ziti_context ztx;
+    char *service;
+    char *terminator;
+    char *host;
+    uint16_t port;
+};
+
+static void free_async_conn(struct async_conn_s *ac) {
+    free((char *) ac->lookup.host);
+    free(ac->lookup.service);
+    free(ac->service);
+    free(ac->terminator);
+    free(ac->host);
+    free(ac);
+}
+
+static void do_async_connect(void *arg, future_t *f, uv_loop_t *l) {
+    struct async_conn_s *ac = arg;
+    ziti_sock_t *zs = ac->zs;
+
+    if (ac->ztx == NULL) {
+        do_find_service(&ac->lookup, NULL, l);
+        if (ac->lookup.ztx == NULL && ++ac->loop_idx < lib_loops_count) {
+            schedule_on_loop(&lib_loops[ac->loop_idx], do_async_connect, ac, false);
+            return;
+        }
+        ac->ztx = ac->lookup.ztx;
+        ac->service = ac->lookup.service;
+        ac->lookup.service = NULL;
+    }
+
+    if (ac->ztx == NULL) {
+        ZITI_LOG(WARN, "no service for target address[%s:%s:%d]", ac->proto == SOCK_DGRAM ? "udp" : "tcp", ac->host, ac->port);
+        sock_async_failed(zs, ECONNREFUSED);
+    } else {
+        uv_mutex_lock(&lib_lock);
+        zs->loop = loop_worker(l);
+        uv_mutex_unlock(&lib_lock);
+        zs->service = strdup(ac->service);
+        struct conn_req_s req = {
+                .fd = zs->fd,
+                .ztx = ac->ztx,
+                .service = ac->service,
+                .terminator = ac->terminator,
+                .host = ac->host,
+                .port = ac->port,
+        };
+        sock_dial(zs, &req, ac->proto);
+    }
+    free_async_conn(ac);
+}
+
+/**
+ * start connect without waiting for the loop
+ * @return -1 with EINPROGRESS error
+ */
+static int async_connect(ziti_socket_t fd, ziti_context ztx, const char *service, const char *terminator,
+                         const char *host, const char *lookup_host, uint16_t port) {
+    NEWP(zs, ziti_sock_t);
+    zs->fd = fd;
+    zs->ziti_fd = SOCKET_ERROR;
+    zs->loop = ztx ? ztx_loop(ztx) : &lib_loops[0];
+
+    int proto = socket_type(fd);
+    uv_mutex_lock(&lib_lock);
+    bool exists = model_map_get_key(&ziti_sockets, &fd, sizeof(fd)) != NULL;
+    if (!exists) {
+        model_map_set_key(&ziti_sockets, &zs->fd, sizeof(zs->fd), zs);
+    }
+    uv_mutex_unlock(&lib_lock);
+    if (exists) {
+        free(zs);
+        set_error(EALREADY);
+        return -1;
+    }
+
+    int rc = sock_async_prepare(zs);
+    if (rc != 0) {
+        ZITI_LOG(ERROR, "failed to connect client socket: %d/%s", rc, strerror(rc));
+        sock_remove(fd);
+        free(zs);
+        set_error(rc);
+        return -1;
+    }
+
+    NEWP(ac, struct async_conn_s);
+    ac->zs = zs;
+    ac->proto = proto;
+    ac->ztx = ztx;
+    ac->service = service ? strdup(service) : NULL;
+    ac->terminator = terminator ? strdup(terminator) : NULL;
+    ac->host = host ? strdup(host) : NULL;
+    ac->port = port;
+    ac->lookup.type = proto;
+    ac->lookup.host = lookup_host ? strdup(lookup_host) : NULL;
+    ac->lookup.port = port;
+
+    ZITI_LOG(DEBUG, "connecting non-blocking fd[%d]", fd);
+    schedule_on_loop(zs->loop, do_async_connect, ac, false);
+    set_error(EINPROGRESS);
+    return -1;
+}
+#endif
+
 int Ziti_connect_addr(ziti_socket_t socket, const char *host, unsigned int port) {
     if (host == NULL) { return EINVAL; }
     if (port == 0 || port > UINT16_MAX) { return EINVAL; }
 
-    await_future(child_init_future);
+    in_addr_t ip;
+    struct lookup_req_s lookup = {
+            .type = socket_type(socket),
+            .host = NULL,
+            .port = port,
+    };
+    if (uv_inet_pton(AF_INET, host, &ip) == 0) { // try reverse lookup
+        lookup.host = Ziti_lookup(ip);
+    }
+    if (lookup.host == NULL) {
+        lookup.host = host;
+    }
+
+    if (!cached_service(&lookup)) {
+        await_contexts();
+    }
 
-    const char *id;
-    ztx_wrap_t *wrap;
-    MODEL_MAP_FOREACH(id, wrap, &ziti_contexts) {
-        await_future(wrap->services_loaded);
+#if !_WIN32
+    if (!is_blocking(socket)) {
+        int rc = async_connect(socket, lookup.ztx, lookup.service, NULL, host, lookup.host, port);
+        free(lookup.service);
+        return rc;
     }
+#endif
+    lookup_service(&lookup);
 
     struct conn_req_s req = {
             .fd = socket,
+            .ztx = lookup.ztx,
+            .service = lookup.service,
             .host = host,
             .port = port,
     };
 
-
-    future_t *f = schedule_on_loop((loop_work_cb) do_ziti_connect, &req, true);
+    // no service: fails on the main loop
+    lib_loop_t *w = req.ztx ? ztx_loop(req.ztx) : NULL;
+    future_t *f = schedule_on_loop(w, (loop_work_cb) do_ziti_connect, &req, true);
 
     int err = 0;
     if (f) {
@@ -751,6 +1235,7 @@ int Ziti_connect_addr(ziti_socket_t socket, const char *host, unsigned int port)
         set_error(err);
         destroy_future(f);
     }
+    free(lookup.service);
     return err ? -1 : 0;
 }
 
@@ -759,6 +1244,12 @@ int Ziti_connect(ziti_socket_t socket, ziti_context ztx, const char *service, co
     if (ztx == NULL) return EINVAL;
     if (service == NULL) return EINVAL;
 
+#if !_WIN32
+    if (!is_blocking(socket)) {
+        return async_connect(socket, ztx, service, terminator, NULL, NULL, 0);
+    }
+#endif
+
     struct conn_req_s req = {
             .fd = socket,
             .ztx = ztx,
@@ -766,7 +1257,7 @@ int Ziti_connect(ziti_socket_t socket, ziti_context ztx, const char *service, co
             .terminator = terminator,
     };
 
-    future_t *f = schedule_on_loop((loop_work_cb) do_ziti_connect, &req, true);
+    future_t *f = schedule_on_loop(ztx_loop(ztx), (loop_work_cb) do_ziti_connect, &req, true);
     int err = await_future(f);
     set_error(err);
     destroy_future(f);
@@ -801,19 +1292,35 @@ static bool is_blocking(ziti_socket_t s) {
 #endif
 }
 
-struct sock_info_s {
-    ziti_socket_t fd;
-    char *peer;
-};
+static void server_preaccept(ziti_sock_t *server);
+
+static void preaccept_done(ziti_sock_t *server, struct sock_info_s *si) {
+    uv_mutex_lock(&lib_lock);
+    server->accepting--;
+    if (si) {
+        model_list_append(&server->ready, si);
+        // notify under the lock: server socket has one byte for every ready client, see take_ready()
+        char notify = 1;
+        send(server->ziti_fd, &notify, sizeof(notify), 0);
+    }
+    uv_mutex_unlock(&lib_lock);
+
+    if (si == NULL) {
+        server_preaccept(server);
+    }
+}
 
 static void on_ziti_accept(ziti_connection client, int status) {
     struct backlog_entry_s *pending = ziti_conn_data(client);
     if (status != ZITI_OK) {
         ZITI_LOG(WARN, "ziti_accept failed!");
-        // ziti accept failed, so just put the accept future back into accept_q
-        TAILQ_INSERT_HEAD(&pending->parent->accept_q, pending->accept_f, _next);
-
         ziti_close(client, NULL);
+        if (pending->accept_f == NULL) {
+            preaccept_done(pending->parent, NULL);
+        } else {
+            // ziti accept failed, so just put the accept future back into accept_q
+            TAILQ_INSERT_HEAD(&pending->parent->accept_q, pending->accept_f, _next);
+        }
         free(pending->caller_id);
         free(pending);
         return;
@@ -824,7 +1331,11 @@ static void on_ziti_accept(ziti_connection client, int status) {
     int rc = connect_socket(fd, &ziti_fd);
     if (rc != 0) {
         ZITI_LOG(WARN, "failed to connect client socket[%d]: %d", fd, rc);
-        fail_future(pending->accept_f, rc);
+        if (pending->accept_f) {
+            fail_future(pending->accept_f, rc);
+        } else {
+            preaccept_done(pending->parent, NULL);
+        }
         ziti_close(client, NULL);
         free(pending->caller_id);
         free(pending);
@@ -836,26 +1347,73 @@ static void on_ziti_accept(ziti_connection client, int status) {
     NEWP(zs, ziti_sock_t);
     zs->fd = fd;
     zs->ziti_fd = ziti_fd;
+    zs->loop = pending->parent->loop;
     ziti_conn_set_data(client, zs);
-    model_map_set_key(&ziti_sockets, &zs->fd, sizeof(zs->fd), zs);
+    sock_set(zs);
     ziti_conn_bridge_fds(client, (uv_os_fd_t) zs->ziti_fd, (uv_os_fd_t) zs->ziti_fd, on_bridge_close, zs);
     NEWP(si, struct sock_info_s);
     si->fd = zs->fd;
     si->peer = pending->caller_id;
 
-    ZITI_LOG(DEBUG, "completing accept future[%p] with fd[%d]", pending->accept_f, fd);
-    complete_future(pending->accept_f, si);
+    if (pending->accept_f == NULL) {
+        ZITI_LOG(DEBUG, "server[%d]: client fd[%d] is ready", pending->parent->fd, fd);
+        preaccept_done(pending->parent, si);
+    } else {
+        ZITI_LOG(DEBUG, "completing accept future[%p] with fd[%d]", pending->accept_f, fd);
+        complete_future(pending->accept_f, si);
+    }
     free(pending);
 }
 
-static void on_ziti_client(ziti_connection server, ziti_connection client, int status, ziti_client_ctx *clt_ctx) {
-    ziti_sock_t *server_sock = ziti_conn_data(server);
+/*
+ * Non-blocking server accepts backlog clients ahead of Ziti_accept(),
+ * so that it can pick them up without a round trip to the loop.
+ */
+static void server_preaccept(ziti_sock_t *server) {
+    while (model_list_size(&server->backlog) > 0) {
+        uv_mutex_lock(&lib_lock);
+        bool room = model_list_size(&server->ready) + server->accepting < server->max_pending;
+        if (room) {
+            server->accepting++;
+        }
+        uv_mutex_unlock(&lib_lock);
+        if (!room) {
+            return;
+        }
 
-    if (status != ZITI_OK) {
-        ZITI_LOG(ERROR, "closing server fd[%d]: failed to accept client [%d/%s]", server_sock->fd, status, ziti_errorstr(status));
-        on_bridge_close(server_sock);
-        return;
-    }
+        struct backlog_entry_s *pending = model_list_pop(&server->backlog);
+        pending->accept_f = NULL;
+        ziti_conn_set_data(pending->conn, pending);
+        int rc = ziti_accept(pending->conn, on_ziti_accept, NULL);
+        if (rc != ZITI_OK) {
+            ZITI_LOG(DEBUG, "failed to accept: client conn[%d] gone? [%d/%s]", pending->conn->conn_id, rc, ziti_errorstr(rc));
+            ziti_close(pending->conn, NULL);
+            free(pending->caller_id);
+            free(pending);
+            uv_mutex_lock(&lib_lock);
+            server->accepting--;
+            uv_mutex_unlock(&lib_lock);
+        }
+    }
+}
+
+static void do_preaccept(void *arg, future_t *f, uv_loop_t *l) {
+    ziti_socket_t server_fd = (ziti_socket_t) (uintptr_t) arg;
+    ziti_sock_t *zs = sock_get(server_fd);
+    if (zs && zs->server) {
+        server_preaccept(zs);
+    }
+    complete_future(f, NULL);
+}
+
+static void on_ziti_client(ziti_connection server, ziti_connection client, int status, ziti_client_ctx *clt_ctx) {
+    ziti_sock_t *server_sock = ziti_conn_data(server);
+
+    if (status != ZITI_OK) {
+        ZITI_LOG(ERROR, "closing server fd[%d]: failed to accept client [%d/%s]", server_sock->fd, status, ziti_errorstr(status));
+        on_bridge_close(server_sock);
+        return;
+    }
     ZITI_LOG(DEBUG, "incoming client[%s] for service[%s]/fd[%d]", clt_ctx->caller_id, server_sock->service, server_sock->fd);
 
     char notify = 1;
@@ -886,6 +1444,20 @@ static void on_ziti_client(ziti_connection server, ziti_connection client, int s
         return;
     }
 
+    if (!is_blocking(server_sock->fd)) {
+        // notify is sent once client is accepted and bridged
+        model_list_append(&server_sock->backlog, pending);
+        server_preaccept(server_sock);
+        if (model_list_size(&server_sock->backlog) > 0) {
+            ZITI_LOG(DEBUG, "accept backlog is full, client[%s] rejected", clt_ctx->caller_id);
+            struct backlog_entry_s *last = model_list_pop(&server_sock->backlog);
+            ziti_close(last->conn, NULL);
+            free(last->caller_id);
+            free(last);
+        }
+        return;
+    }
+
     if (model_list_size(&server_sock->backlog) < server_sock->max_pending) {
         ZITI_LOG(DEBUG, "server[%d] no active accept: putting connection in backlog and sending notify", server_sock->fd);
         model_list_append(&server_sock->backlog, pending);
@@ -906,7 +1478,7 @@ static void on_ziti_bind(ziti_connection server, int status) {
         free(zs);
     } else {
         connect_socket(zs->fd, &zs->ziti_fd);
-        model_map_set_key(&ziti_sockets, &zs->fd, sizeof(zs->fd), zs);
+        sock_set(zs);
 
         ZITI_LOG(DEBUG, "successfully bound fd[%d] to service[%s]", zs->fd, zs->service);
         complete_future(zs->f, server);
@@ -914,7 +1486,7 @@ static void on_ziti_bind(ziti_connection server, int status) {
 }
 
 static void do_ziti_bind(struct conn_req_s *req, future_t *f, uv_loop_t *l) {
-    ziti_sock_t *zs = model_map_get_key(&ziti_sockets, &req->fd, sizeof(req->fd));
+    ziti_sock_t *zs = sock_get(req->fd);
     if (zs) {
         fail_future(f, EALREADY);
         return;
@@ -925,10 +1497,11 @@ static void do_ziti_bind(struct conn_req_s *req, future_t *f, uv_loop_t *l) {
         zs->fd = req->fd;
         zs->service = strdup(req->service);
         zs->f = f;
+        zs->loop = loop_worker(l);
 
         ZITI_LOG(DEBUG, "requesting bind fd[%d] to service[%s@%s]", zs->fd, req->terminator ? req->terminator : "", req->service);
         ziti_listen_opts opts = {
-                .identity = req->terminator,
+                .identity = (char *) req->terminator, // copied by ziti_listen_with_options()
         };
         ziti_conn_init(req->ztx, &zs->conn, zs);
         ziti_listen_with_options(zs->conn, req->service, &opts, on_ziti_bind, on_ziti_client);
@@ -950,7 +1523,7 @@ int Ziti_bind(ziti_socket_t socket, ziti_context ztx, const char *service, const
             .terminator = terminator,
     };
 
-    future_t *f = schedule_on_loop((loop_work_cb) do_ziti_bind, &req, true);
+    future_t *f = schedule_on_loop(ztx_loop(ztx), (loop_work_cb) do_ziti_bind, &req, true);
     int err = await_future(f);
     set_error(err);
     destroy_future(f);
@@ -964,7 +1537,7 @@ struct listen_req_s {
 
 static void do_ziti_listen(void *arg, future_t *f, uv_loop_t *l) {
     struct listen_req_s *req = arg;
-    ziti_sock_t *zs = model_map_get_key(&ziti_sockets, &req->fd, sizeof(req->fd));
+    ziti_sock_t *zs = sock_get(req->fd);
     if (zs == NULL) {
         fail_future(f, EBADF);
     } else {
@@ -983,7 +1556,7 @@ int Ziti_listen(ziti_socket_t socket, int backlog) {
     }
 
     struct listen_req_s req = {.fd = socket, .backlog = backlog};
-    future_t *f = schedule_on_loop(do_ziti_listen, &req, true);
+    future_t *f = schedule_on_loop(sock_loop(socket), do_ziti_listen, &req, true);
 
     int err = await_future(f);
     set_error(err);
@@ -993,7 +1566,7 @@ int Ziti_listen(ziti_socket_t socket, int backlog) {
 
 static void do_ziti_accept(void *r, future_t *f, uv_loop_t *l) {
     ziti_socket_t server_fd = (ziti_socket_t) (uintptr_t) r;
-    ziti_sock_t *zs = model_map_get_key(&ziti_sockets, &server_fd, sizeof(server_fd));
+    ziti_sock_t *zs = sock_get(server_fd);
     if (zs == NULL) {
         ZITI_LOG(WARN, "fd[%d] is not a ziti socket", server_fd);
         fail_future(f, EINVAL);
@@ -1041,8 +1614,63 @@ static void do_ziti_accept(void *r, future_t *f, uv_loop_t *l) {
 
 }
 
+/*
+ * Picks up to [count] pre-accepted clients of a non-blocking server, along with their notify bytes.
+ * Returns number of clients taken, or -1 if [server] is not a ziti server socket.
+ */
+static int take_ready(ziti_socket_t server, struct sock_info_s **si, int count, lib_loop_t **loop) {
+    int taken = -1;
+    uv_mutex_lock(&lib_lock);
+    ziti_sock_t *zs = model_map_get_key(&ziti_sockets, &server, sizeof(server));
+    if (zs && zs->server) {
+        *loop = zs->loop;
+        taken = 0;
+        while (taken < count && (si[taken] = model_list_pop(&zs->ready)) != NULL) {
+            taken++;
+        }
+
+        char buf[64];
+        int left = taken;
+        while (left > 0) {
+            int rc = (int) recv(server, buf, MIN(left, (int) sizeof(buf)), 0);
+            if (rc <= 0) break;
+            left -= rc;
+        }
+        if (model_list_size(&zs->ready) == 0) {
+            // whatever is left belongs to clients already taken, do not leave the socket readable
+            while (recv(server, buf, sizeof(buf), 0) > 0) {}
+        }
+    }
+    uv_mutex_unlock(&lib_lock);
+    return taken;
+}
+
 ziti_socket_t Ziti_accept(ziti_socket_t server, char *caller, int caller_len) {
-    future_t *f = schedule_on_loop(do_ziti_accept, (void *) (uintptr_t) server, true);
+    if (!is_blocking(server)) {
+        struct sock_info_s *si = NULL;
+        lib_loop_t *w = NULL;
+        int taken = take_ready(server, &si, 1, &w);
+
+        if (taken > 0) {
+            if (caller != NULL) {
+                strncpy(caller, si->peer, caller_len);
+            }
+            ziti_socket_t clt = si->fd;
+            free(si->peer);
+            free(si);
+            // room in the ready queue, accept more from the backlog
+            schedule_on_loop(w, do_preaccept, (void *) (uintptr_t) server, false);
+            set_error(0);
+            return clt;
+        }
+
+        if (taken == 0) {
+            set_error(EWOULDBLOCK);
+            return -1;
+        }
+    }
+
+    future_t *f = schedule_on_loop(sock_loop(server), do_ziti_accept, (void *) (uintptr_t) server, true);
     ZITI_LOG(DEBUG, "fd[%d] waiting for future[%p]", server, f);
     ziti_socket_t clt = -1;
     int err = await_future(f);
@@ -1069,15 +1697,80 @@ ziti_socket_t Ziti_accept(ziti_socket_t server, char *caller, int caller_len) {
     return clt;
 }
 
+int Ziti_accept_many(ziti_socket_t server, ziti_accepted out[], int count) {
+    if (out == NULL || count <= 0) {
+        set_error(EINVAL);
+        return -1;
+    }
+
+    if (is_blocking(server)) {
+        // blocking servers do not accept ahead, only one client can be waited for
+        out[0].socket = Ziti_accept(server, out[0].caller, sizeof(out[0].caller));
+        return out[0].socket == SOCKET_ERROR ? -1 : 1;
+    }
+
+    struct sock_info_s *si[64];
+    lib_loop_t *w = NULL;
+    int total = 0;
+    while (total < count) {
+        int chunk = MIN(count - total, (int) (sizeof(si) / sizeof(si[0])));
+        int taken = take_ready(server, si, chunk, &w);
+        if (taken < 0) {
+            break;
+        }
+
+        for (int i = 0; i < taken; i++) {
+            ziti_accepted *a = &out[total++];
+            a->socket = si[i]->fd;
+            strncpy(a->caller, si[i]->peer, sizeof(a->caller) - 1);
+            a->caller[sizeof(a->caller) - 1] = 0;
+            free(si[i]->peer);
+            free(si[i]);
+        }
+        if (taken < chunk) {
+            break;
+        }
+    }
+
+    if (total > 0) {
+        // accept more from the backlog, once for the whole batch
+        schedule_on_loop(w, do_preaccept, (void *) (uintptr_t) server, false);
+        set_error(0);
+        return total;
+    }
+
+    if (w == NULL) {
+        // not a ziti server, let Ziti_accept() report it
+        ziti_socket_t clt = Ziti_accept(server, out[0].caller, sizeof(out[0].caller));
+        if (clt == SOCKET_ERROR) {
+            return -1;
+        }
+        out[0].socket = clt;
+        return 1;
+    }
+
+    set_error(EWOULDBLOCK);
+    return -1;
+}
 
 void Ziti_lib_shutdown(void) {
-    future_t *f = schedule_on_loop(do_shutdown, NULL, true);
-    await_future(f);
-    uv_thread_join(&lib_thread);
+    for (int i = 0; i < lib_loops_count; i++) {
+        lib_loop_t *w = &lib_loops[i];
+        future_t *f = schedule_on_loop(w, do_shutdown, NULL, true);
+        await_future(f);
+        uv_thread_join(&w->thread);
+        destroy_future(f);
+        if (w->init_f) {
+            destroy_future(w->init_f);
+        }
+    }
+    free(lib_loops);
+    lib_loops = NULL;
+    lib_loops_count = 0;
+
     uv_once_t child_once = UV_ONCE_INIT;
     memcpy(&init, &child_once, sizeof(child_once));
     uv_key_delete(&err_key);
-    destroy_future(f);
 }
 
 static void looper(void *arg) {
@@ -1087,39 +1780,30 @@ static void looper(void *arg) {
     ZITI_LOG(DEBUG, "loop is done");
 }
 
-future_t *schedule_on_loop(loop_work_cb cb, void *arg, bool wait) {
-    queue_elem_t *el = calloc(1, sizeof(queue_elem_t));
+future_t *schedule_on_loop(lib_loop_t *w, loop_work_cb cb, void *arg, bool wait) {
+    if (w == NULL) {
+        w = &lib_loops[0];
+    }
+
+    queue_elem_t *el = mt_pool_alloc(elem_pool);
     el->cb = cb;
     el->arg = arg;
-    if (wait) {
-        el->f = new_future();
-    }
+    el->f = wait ? new_future() : NULL;
 
-    uv_mutex_lock(&q_mut);
-    LIST_INSERT_HEAD(&loop_q, el, _next);
-    uv_mutex_unlock(&q_mut);
-    uv_async_send(&q_async);
+    mpsc_push(&w->q, &el->_node);
+    uv_async_send(&w->q_async);
 
     return el->f;
 }
 
 void process_on_loop(uv_async_t *async) {
-    LIST_HEAD(loop_queue, queue_elem_s) q = {0};
-
-    // drain q
-    uv_mutex_lock(&q_mut);
-    while (!LIST_EMPTY(&loop_q)) {
-        queue_elem_t *el = LIST_FIRST(&loop_q);
-        LIST_REMOVE(el, _next);
-        LIST_INSERT_HEAD(&q, el, _next);
-    }
-    uv_mutex_unlock(&q_mut);
+    lib_loop_t *w = async->data;
 
-    while (!LIST_EMPTY(&q)) {
-        queue_elem_t *el = LIST_FIRST(&q);
-        LIST_REMOVE(el, _next);
+    mpsc_node_t *n;
+    while ((n = mpsc_pop(&w->q)) != NULL) {
+        queue_elem_t *el = container_of((char *) n, queue_elem_t, _node);
         el->cb(el->arg, el->f, async->loop);
-        free(el);
+        mt_pool_free(el);
     }
 }
 
@@ -1135,22 +1819,38 @@ static void child_load_contexts(void *load_list, future_t *f, uv_loop_t *l) {
     complete_future(f, NULL);
 }
 
+static void start_loop(lib_loop_t *w) {
+    // (child process) contexts of the parent's loop are loaded again
+    memset(&w->contexts, 0, sizeof(w->contexts));
+    w->loop = uv_loop_new();
+    w->loop->data = w;
+    mpsc_init(&w->q);
+    uv_async_init(w->loop, &w->q_async, process_on_loop);
+    w->q_async.data = w;
+}
+
 static void child_init() {
-    lib_loop = uv_loop_new();
-    memset(&loop_q, 0, sizeof(loop_q));
-    ziti_log_init(lib_loop, -1, NULL);
-    uv_async_init(lib_loop, &q_async, process_on_loop);
+    // threads are not inherited, all loops are restarted
+    uv_mutex_init(&lib_lock);
+    init_park_slots();
+    for (int i = 0; i < lib_loops_count; i++) {
+        start_loop(&lib_loops[i]);
+    }
+    ziti_log_init(lib_loops[0].loop, -1, NULL);
 
+    model_list *idents = calloc(lib_loops_count, sizeof(*idents));
     model_map_iter it = model_map_iterator(&ziti_contexts);
-    model_list *idents = calloc(1, sizeof(*idents));
     while (it) {
         const char *ident = model_map_it_key(it);
-        model_list_append(idents, strdup(ident));
+        model_list_append(&idents[identity_loop(ident) - lib_loops], strdup(ident));
         it = model_map_it_remove(it);
     }
 
-    child_init_future = schedule_on_loop(child_load_contexts, idents, true);
-    uv_thread_create(&lib_thread, looper, lib_loop);
+    for (int i = 0; i < lib_loops_count; i++) {
+        lib_loop_t *w = &lib_loops[i];
+        w->init_f = schedule_on_loop(w, child_load_contexts, &idents[i], true);
+        uv_thread_create(&w->thread, looper, w->loop);
+    }
 }
 
 
@@ -1160,31 +1860,451 @@ static void internal_init() {
 #endif
     init_in4addr_loopback();
     uv_key_create(&err_key);
-    uv_mutex_init(&q_mut);
-    lib_loop = uv_loop_new();
-    ziti_log_init(lib_loop, -1, NULL);
-    uv_async_init(lib_loop, &q_async, process_on_loop);
-    uv_thread_create(&lib_thread, looper, lib_loop);
+    uv_mutex_init(&lib_lock);
+    resolve_cache_init(&lib_resolve_cache);
+    if (future_pool == NULL) {
+        init_park_slots();
+        future_pool = mt_pool_new(sizeof(future_t), LIB_POOL_CAPACITY);
+        elem_pool = mt_pool_new(sizeof(queue_elem_t), LIB_POOL_CAPACITY);
+    }
+
+    int count = lib_loops_requested;
+    if (count <= 0) {
+        uv_cpu_info_t *cpus;
+        count = 1;
+        if (uv_cpu_info(&cpus, &count) == 0) {
+            uv_free_cpu_info(cpus, count);
+        }
+    }
+    lib_loops_count = MAX(1, MIN(count, LIB_LOOPS_MAX));
+    lib_loops = calloc(lib_loops_count, sizeof(lib_loop_t));
+    for (int i = 0; i < lib_loops_count; i++) {
+        start_loop(&lib_loops[i]);
+    }
+    ziti_log_init(lib_loops[0].loop, -1, NULL);
+    ZITI_LOG(DEBUG, "starting %d loop(s)", lib_loops_count);
+
+    for (int i = 0; i < lib_loops_count; i++) {
+        uv_thread_create(&lib_loops[i].thread, looper, lib_loops[i].loop);
+    }
 }
 
+// shuts down contexts owned by this loop and lets it exit
 void do_shutdown(void *args, future_t *f, uv_loop_t *l) {
+    lib_loop_t *w = loop_worker(l);
+    model_list wraps = {0};
+
+    uv_mutex_lock(&lib_lock);
     model_map_iter *it = model_map_iterator(&ziti_contexts);
     while (it) {
-        ztx_wrap_t *w = model_map_it_value(it);
-        it = model_map_it_remove(it);
-        if (w->ztx) {
-            ziti_shutdown(w->ztx);
+        ztx_wrap_t *wrap = model_map_it_value(it);
+        if (wrap->loop == w) {
+            model_list_append(&wraps, wrap);
+            it = model_map_it_remove(it);
+        } else {
+            it = model_map_it_next(it);
         }
-        model_map_clear(&w->intercepts, (void (*)(void *)) free_ziti_intercept_cfg_v1_ptr);
     }
+    uv_mutex_unlock(&lib_lock);
+
+    model_list_clear(&w->contexts, NULL);
+
+    ztx_wrap_t *wrap;
+    MODEL_LIST_FOREACH(wrap, wraps) {
+        if (wrap->ztx) {
+            ziti_shutdown(wrap->ztx);
+        }
+        model_map_clear(&wrap->intercepts, (void (*)(void *)) free_ziti_intercept_cfg_v1_ptr);
+    }
+    model_list_clear(&wraps, NULL);
+
     complete_future(f, NULL);
-    uv_close((uv_handle_t *) &q_async, NULL);
+    uv_close((uv_handle_t *) &w->q_async, NULL);
 
 #if _WIN32
-    uv_stop(q_async.loop);
+    uv_stop(l);
 #endif
 }
 
+#if !_WIN32
+/*
+ * Direct(socket-less) streams.
+ * Application thread and the loop exchange data via two single-producer/single-consumer rings:
+ * - rx: loop pulls connection data into it (ziti_conn_read), application reads from it
+ * - tx: application writes into it, loop passes ring memory to ziti_write() and releases it on write completion
+ * Loop is woken with per-stream uv_async, application waits on eventfd(or pipe as fallback) doorbell.
+ */
+#include <stdatomic.h>
+#include "stream_io.h"
+
+#define STREAM_RING_SIZE (256 * 1024) // must be power of 2
+#define STREAM_WRITE_CHUNK (32 * 1024)
+
+enum stream_state {
+    STREAM_OPEN = 0,
+    STREAM_RX_EOF = 1,   // all received data is in rx ring
+    STREAM_CLOSED = 2,   // connection failed or closed, see err
+};
+
+struct ziti_stream_s {
+    lib_loop_t *loop;
+    ziti_context ztx;
+    ziti_connection conn;
+    future_t *connect_f;
+
+    stream_ring *rx;
+    stream_ring *tx;
+
+    atomic_int state;
+    int err;
+    atomic_bool nonblocking;
+
+    // loop doorbell
+    uv_async_t wake;
+    atomic_bool rx_stalled;
+    atomic_bool shutdown_req;
+
+    // application doorbell
+    stream_bell *bell;
+
+    // loop only
+    size_t tx_sent;           // tx position handed to ziti_write
+    size_t tx_pending;        // number of ziti_write() in flight
+    bool write_closed;
+    bool closing;
+};
+
+static void stream_free(uv_handle_t *h) {
+    struct ziti_stream_s *s = h->data;
+    stream_bell_free(s->bell);
+    stream_ring_free(s->rx);
+    stream_ring_free(s->tx);
+    free(s);
+}
+
+// called on loop whenever application may be able to make progress
+static void stream_notify(struct ziti_stream_s *s) {
+    stream_bell_notify(s->bell);
+}
+
+static void stream_set_closed(struct ziti_stream_s *s, int err) {
+    if (atomic_load(&s->state) != STREAM_CLOSED) {
+        s->err = err;
+        atomic_store(&s->state, STREAM_CLOSED);
+        stream_notify(s);
+    }
+}
+
+static void stream_pull(struct ziti_stream_s *s) {
+    bool produced = false;
+    while (s->conn && atomic_load(&s->state) == STREAM_OPEN) {
+        uint8_t *p;
+        size_t avail = stream_ring_free_region(s->rx, &p);
+        if (avail == 0) {
+            // application kicks the loop once it frees some space
+            atomic_store(&s->rx_stalled, true);
+            avail = stream_ring_free_region(s->rx, &p);
+            if (avail == 0) break;
+            atomic_store(&s->rx_stalled, false);
+        }
+
+        ssize_t n = ziti_conn_read(s->conn, p, avail);
+        if (n > 0) {
+            stream_ring_produce(s->rx, n);
+            produced = true;
+        } else {
+            if (n == ZITI_EOF) {
+                atomic_store(&s->state, STREAM_RX_EOF);
+                produced = true;
+            }
+            break;
+        }
+    }
+
+    if (produced) {
+        stream_notify(s);
+    }
+}
+
+static void stream_push(struct ziti_stream_s *s);
+
+static void on_stream_write(ziti_connection conn, ssize_t status, void *ctx) {
+    struct ziti_stream_s *s = ziti_conn_data(conn);
+    s->tx_pending--;
+    if (status < 0) {
+        stream_set_closed(s, (int) status);
+        return;
+    }
+
+    stream_ring_release(s->tx, (size_t) (uintptr_t) ctx);
+    stream_notify(s);
+    // pending shutdown waits for the last write
+    stream_push(s);
+}
+
+static void stream_push(struct ziti_stream_s *s) {
+    if (s->conn == NULL || s->write_closed || atomic_load(&s->state) == STREAM_CLOSED) {
+        return;
+    }
+
+    uint8_t *p;
+    size_t len;
+    while ((len = stream_ring_peek(s->tx, s->tx_sent, &p)) > 0) {
+        len = MIN(len, STREAM_WRITE_CHUNK);
+
+        // ring memory stays put until the write completes
+        int rc = ziti_write(s->conn, p, len, on_stream_write, (void *) (uintptr_t) len);
+        if (rc != ZITI_OK) {
+            stream_set_closed(s, rc);
+            return;
+        }
+        s->tx_sent += len;
+        s->tx_pending++;
+    }
+
+    if (atomic_load(&s->shutdown_req) && s->tx_pending == 0) {
+        s->write_closed = true;
+        ziti_close_write(s->conn);
+    }
+}
+
+static void on_stream_wake(uv_async_t *a) {
+    struct ziti_stream_s *s = a->data;
+    stream_push(s);
+    stream_pull(s);
+}
+
+static void on_stream_readable(ziti_connection conn, size_t available) {
+    stream_pull(ziti_conn_data(conn));
+}
+
+// data is pulled with ziti_conn_read(), this only gets EOF and errors (or data that arrived before pull mode was on)
+static ssize_t on_stream_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    struct ziti_stream_s *s = ziti_conn_data(conn);
+    if (len > 0) {
+        size_t n = stream_ring_write(s->rx, data, len);
+        if (n > 0) {
+            stream_notify(s);
+        }
+        return (ssize_t) n;
+    }
+
+    if (len == ZITI_EOF) {
+        if (atomic_load(&s->state) == STREAM_OPEN) {
+            atomic_store(&s->state, STREAM_RX_EOF);
+            stream_notify(s);
+        }
+    } else {
+        stream_set_closed(s, (int) len);
+    }
+    return 0;
+}
+
+static void on_stream_conn_close(ziti_connection conn) {
+    struct ziti_stream_s *s = ziti_conn_data(conn);
+    uv_close((uv_handle_t *) &s->wake, stream_free);
+}
+
+static void on_stream_connect(ziti_connection conn, int status) {
+    struct ziti_stream_s *s = ziti_conn_data(conn);
+    future_t *f = s->connect_f;
+    s->connect_f = NULL;
+
+    if (status != ZITI_OK) {
+        ZITI_LOG(WARN, "failed to establish ziti connection: %d(%s)", status, ziti_errorstr(status));
+        fail_future(f, status);
+        ziti_close(conn, on_stream_conn_close);
+        return;
+    }
+
+    ziti_conn_set_readable_cb(conn, on_stream_readable);
+    complete_future(f, s);
+}
+
+static void do_stream_connect(struct conn_req_s *req, future_t *f, uv_loop_t *l) {
+    stream_bell *bell = stream_bell_new();
+    if (bell == NULL) {
+        fail_future(f, errno);
+        return;
+    }
+
+    struct ziti_stream_s *s = calloc(1, sizeof(*s));
+    s->bell = bell;
+
+    s->loop = loop_worker(l);
+    s->ztx = req->ztx;
+    s->rx = stream_ring_new(STREAM_RING_SIZE);
+    s->tx = stream_ring_new(STREAM_RING_SIZE);
+    s->connect_f = f;
+    uv_async_init(l, &s->wake, on_stream_wake);
+    s->wake.data = s;
+
+    ziti_conn_init(req->ztx, &s->conn, s);
+    ziti_dial_opts opts = {
+            .identity = (char *) req->terminator, // copied by ziti_dial_with_options()
+    };
+    ZITI_LOG(DEBUG, "connecting stream to service[%s]", req->service);
+    int rc = ziti_dial_with_options(s->conn, req->service, &opts, on_stream_connect, on_stream_data);
+    if (rc != ZITI_OK) {
+        s->connect_f = NULL;
+        fail_future(f, rc);
+        ziti_close(s->conn, on_stream_conn_close);
+    }
+}
+
+ziti_stream Ziti_stream_connect(ziti_context ztx, const char *service, const char *terminator) {
+    if (ztx == NULL || service == NULL) {
+        set_error(EINVAL);
+        return NULL;
+    }
+
+    struct conn_req_s req = {
+            .ztx = ztx,
+            .service = service,
+            .terminator = terminator,
+    };
+
+    future_t *f = schedule_on_loop(ztx_loop(ztx), (loop_work_cb) do_stream_connect, &req, true);
+    int err = await_future(f);
+    ziti_stream s = err ? NULL : f->result;
+    set_error(err);
+    destroy_future(f);
+    return s;
+}
+
+// returns false if application should not block
+static bool stream_wait(ziti_stream s, unsigned int seq) {
+    return stream_bell_wait(s->bell, seq, !atomic_load(&s->nonblocking));
+}
+
+long Ziti_stream_read(ziti_stream s, void *buf, size_t len) {
+    if (s == NULL) {
+        set_error(EINVAL);
+        return -1;
+    }
+
+    for (;;) {
+        unsigned int seq = stream_bell_seq(s->bell);
+        // state is checked before the ring: data produced before EOF is not lost
+        int state = atomic_load(&s->state);
+        size_t n = stream_ring_read(s->rx, buf, len);
+        if (n > 0 || len == 0) {
+            if (atomic_exchange(&s->rx_stalled, false)) {
+                uv_async_send(&s->wake);
+            }
+            set_error(0);
+            return (long) n;
+        }
+
+        if (state == STREAM_RX_EOF) {
+            set_error(0);
+            return 0;
+        }
+        if (state == STREAM_CLOSED) {
+            set_error(s->err == ZITI_EOF || s->err == ZITI_CONN_CLOSED ? 0 : s->err);
+            return s->err == ZITI_EOF || s->err == ZITI_CONN_CLOSED ? 0 : -1;
+        }
+
+        if (!stream_wait(s, seq)) {
+            set_error(EWOULDBLOCK);
+            return -1;
+        }
+    }
+}
+
+long Ziti_stream_write(ziti_stream s, const void *buf, size_t len) {
+    if (s == NULL) {
+        set_error(EINVAL);
+        return -1;
+    }
+
+    for (;;) {
+        unsigned int seq = stream_bell_seq(s->bell);
+        if (atomic_load(&s->state) == STREAM_CLOSED || atomic_load(&s->shutdown_req)) {
+            set_error(EPIPE);
+            return -1;
+        }
+
+        size_t n = stream_ring_write(s->tx, buf, len);
+        if (n > 0 || len == 0) {
+            uv_async_send(&s->wake);
+            set_error(0);
+            return (long) n;
+        }
+
+        if (!stream_wait(s, seq)) {
+            set_error(EWOULDBLOCK);
+            return -1;
+        }
+    }
+}
+
+int Ziti_stream_set_nonblocking(ziti_stream s, int nonblocking) {
+    if (s == NULL) return EINVAL;
+    atomic_store(&s->nonblocking, nonblocking != 0);
+    return 0;
+}
+
+int Ziti_stream_fd(ziti_stream s) {
+    return s ? stream_bell_fd(s->bell) : -1;
+}
+
+int Ziti_stream_shutdown(ziti_stream s) {
+    if (s == NULL) return EINVAL;
+    atomic_store(&s->shutdown_req, true);
+    uv_async_send(&s->wake);
+    return 0;
+}
+
+static void do_stream_close(void *arg, future_t *f, uv_loop_t *l) {
+    struct ziti_stream_s *s = arg;
+    ZITI_LOG(DEBUG, "closing stream conn[%d]", s->conn->conn_id);
+    ziti_close(s->conn, on_stream_conn_close);
+    complete_future(f, NULL);
+}
+
+int Ziti_stream_close(ziti_stream s) {
+    if (s == NULL) return EINVAL;
+    future_t *f = schedule_on_loop(s->loop, do_stream_close, s, true);
+    await_future(f);
+    destroy_future(f);
+    return 0;
+}
+
+#else
+
+ziti_stream Ziti_stream_connect(ziti_context ztx, const char *service, const char *terminator) {
+    set_error(ENOTSUP);
+    return NULL;
+}
+
+long Ziti_stream_read(ziti_stream s, void *buf, size_t len) {
+    set_error(ENOTSUP);
+    return -1;
+}
+
+long Ziti_stream_write(ziti_stream s, const void *buf, size_t len) {
+    set_error(ENOTSUP);
+    return -1;
+}
+
+int Ziti_stream_set_nonblocking(ziti_stream s, int nonblocking) {
+    return ENOTSUP;
+}
+
+int Ziti_stream_fd(ziti_stream s) {
+    return -1;
+}
+
+int Ziti_stream_shutdown(ziti_stream s) {
+    return ENOTSUP;
+}
+
+int Ziti_stream_close(ziti_stream s) {
+    return ENOTSUP;
+}
+#endif
+
 static void on_enroll(const ziti_config *cfg, int status, const char *error, void *ctx) {
     future_t *f = ctx;
     if (status != ZITI_OK) {
@@ -1205,7 +2325,7 @@ int Ziti_enroll_identity(const char *jwt, const char *key, const char *cert, cha
             .enroll_key = key,
             .enroll_cert = cert,
     };
-    future_t *f = schedule_on_loop((loop_work_cb) do_enroll, &opts, true);
+    future_t *f = schedule_on_loop(NULL, (loop_work_cb) do_enroll, &opts, true);
     int rc = await_future(f);
     if (rc == ZITI_OK) {
         *id_json = f->result;
@@ -1219,32 +2339,27 @@ static model_map host_to_ip;
 static model_map ip_to_host;
 
 static in_addr_t addr_counter = 0x64400000; // 100.64.0.0
+// service lookup is done before, by the caller thread
 static void resolve_cb(void *r, future_t *f) {
-    struct conn_req_s *req = r;
+    struct lookup_req_s *req = r;
 
     ZITI_LOG(DEBUG, "resolving %s", req->host);
+    uv_mutex_lock(&lib_lock);
     in_addr_t ip = (in_addr_t)(intptr_t)model_map_get(&host_to_ip, req->host);
     if (ip == 0) {
-        const char *service_name;
-        MODEL_MAP_FOR(it, ziti_contexts) {
-            ztx_wrap_t *wrap = model_map_it_value(it);
-            service_name = find_service(wrap, 0, req->host, req->port);
-            if (service_name) {
-                ZITI_LOG(DEBUG, "%s:%d => %s", req->host, req->port, service_name);
-                break;
-            }
-        }
-
-        if (service_name == NULL) {
+        if (req->service == NULL) {
+            uv_mutex_unlock(&lib_lock);
             fail_future(f, EAI_NONAME);
             return;
         }
+        ZITI_LOG(DEBUG, "%s:%d => %s", req->host, req->port, req->service);
 
         ip = htonl(++addr_counter);
         ZITI_LOG(DEBUG, "assigned %s => %x", req->host, ip);
         model_map_set(&host_to_ip, req->host, (void *) (uintptr_t) ip);
         model_map_set_key(&ip_to_host, &ip, sizeof(ip), strdup(req->host));
     }
+    uv_mutex_unlock(&lib_lock);
 
     complete_future(f, (void *) (uintptr_t) ip);
 }
@@ -1257,6 +2372,8 @@ void Ziti_freeaddrinfo(struct addrinfo *addrlist) {
 static bool is_internal(const char *host) {
     // refuse resolving controller/router addresses here
     // this way Ziti context can operate even if resolve was high-jacked (e.g. zitify)
+    bool internal = false;
+    uv_mutex_lock(&lib_lock);
     MODEL_MAP_FOR(it, ziti_contexts) {
         ztx_wrap_t *wrap = model_map_it_value(it);
         if (wrap->ztx == NULL) continue;
@@ -1266,19 +2383,21 @@ static bool is_internal(const char *host) {
         tlsuv_parse_url(&url, ctrl);
 
         if (strncmp(host, url.hostname, url.hostname_len) == 0) {
-            return true;
+            internal = true;
+            break;
         }
 
-        if (wrap->ztx) {
-            MODEL_MAP_FOR(chit, wrap->ztx->channels) {
-                ziti_channel_t *ch = model_map_it_value(chit);
-                if (strcmp(ch->host, host) == 0) {
-                    return true;
-                }
+        MODEL_MAP_FOR(chit, wrap->ztx->channels) {
+            ziti_channel_t *ch = model_map_it_value(chit);
+            if (strcmp(ch->host, host) == 0) {
+                internal = true;
+                break;
             }
         }
+        if (internal) break;
     }
-    return false;
+    uv_mutex_unlock(&lib_lock);
+    return internal;
 }
 
 ZITI_FUNC
@@ -1333,28 +2452,44 @@ int Ziti_resolve(const char *host, const char *port, const struct addrinfo *hint
         return 0;
     }
 
-    MODEL_MAP_FOR(it, ziti_contexts) {
-        ztx_wrap_t *ztx = model_map_it_value(it);
-        await_future(ztx->services_loaded);
-    }
+    char service[RESOLVE_CACHE_STR_WORDS * sizeof(uint64_t)];
+    void *cached_ztx;
+    uint32_t cached_ip = 0;
+    future_t *f = NULL;
+    int err = 0;
+    if (resolve_cache_get(&lib_resolve_cache, 0, host, portnum, &cached_ztx, service, &cached_ip) && cached_ip != 0) {
+        ZITI_LOG(VERBOSE, "host[%s] cached => %x", host, cached_ip);
+        set_error(0);
+    } else {
+        await_contexts();
 
-    struct conn_req_s req = {
-            .host = host,
-            .port = portnum,
-    };
+        uint64_t gen = resolve_cache_gen(&lib_resolve_cache);
+        struct lookup_req_s req = {
+                .host = host,
+                .port = portnum,
+        };
+        lookup_service(&req);
 
-    future_t *f = schedule_on_loop((loop_work_cb) resolve_cb, &req, true);
-    int err = await_future(f);
-    set_error(err);
+        f = schedule_on_loop(NULL, (loop_work_cb) resolve_cb, &req, true);
+        err = await_future(f);
+        set_error(err);
+        if (err == 0) {
+            cached_ip = (uint32_t) (uintptr_t) f->result;
+            if (req.ztx) {
+                resolve_cache_put(&lib_resolve_cache, gen, 0, host, portnum, req.ztx, req.service, cached_ip);
+            }
+        }
+        free(req.service);
+    }
 
     if (err == 0) {
         addr4->sin_family = AF_INET;
         addr4->sin_port = htons(portnum);
-        addr4->sin_addr.s_addr = (in_addr_t)(uintptr_t)f->result;
+        addr4->sin_addr.s_addr = (in_addr_t) cached_ip;
 
         res->ai_family = AF_INET;
         res->ai_addr = (struct sockaddr *) addr4;
-        res->ai_socktype = hints->ai_socktype;
+        res->ai_socktype = socktype;
 
         res->ai_addrlen = sizeof(*addr4);
         *addrlist = res;
@@ -1368,15 +2503,32 @@ int Ziti_resolve(const char *host, const char *port, const struct addrinfo *hint
 }
 
 int Ziti_check_socket(ziti_socket_t fd) {
+    int rc = 1;
+    int err = 0;
+    uv_mutex_lock(&lib_lock);
     ziti_sock_t *sock = model_map_get_key(&ziti_sockets, &fd, sizeof(fd));
-    if (sock == NULL) return 0;
-    if (sock->server) return 2;
-    return 1;
+    if (sock == NULL) {
+        rc = 0;
+    } else if (sock->server) {
+        rc = 2;
+    } else if (sock->connecting) {
+        rc = 3;
+    } else if (sock->conn_err != 0) {
+        rc = -1;
+        err = sock->conn_err;
+    }
+    uv_mutex_unlock(&lib_lock);
+
+    set_error(err);
+    return rc;
 }
 
 ZITI_FUNC
 const char *Ziti_lookup(in_addr_t addr) {
+    // entries are never removed, hostname stays valid after unlock
+    uv_mutex_lock(&lib_lock);
     const char *hostname = model_map_get_key(&ip_to_host, &addr, sizeof(addr));
+    uv_mutex_unlock(&lib_lock);
     return hostname;
 }
 
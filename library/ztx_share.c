@@ -0,0 +1,244 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "zt_internal.h"
+#include "utils.h"
+
+// contexts of the share use CA bundle fetched by another one for this long
+#define CA_BUNDLE_SHARE_TTL (60 * 60 * 1000)
+
+struct ca_bundle_s {
+    LIST_ENTRY(ca_bundle_s) _next;
+    char *controller;
+    char *trust; // CA bundle the fetching context had
+    char *bundle; // NULL until the first fetch completes
+    ziti_context fetcher; // set while fetch is in progress
+    uint64_t fetched;
+};
+
+struct ztx_share_s {
+    uv_loop_t *loop;
+    LIST_ENTRY(ztx_share_s) _next;
+    LIST_HEAD(, ziti_ctx) members;
+
+    // pool sizes, from options of the first context
+    unsigned int read_buf_size;
+    unsigned int read_buf_count;
+    unsigned int out_msg_pool_cap;
+
+    key_pool *keys;
+    buffer_slab *read_bufs;
+    msg_pools *out_msgs;
+
+    LIST_HEAD(, ca_bundle_s) ca_bundles;
+};
+
+// shares are looked up by loop, loops may run on different threads
+static LIST_HEAD(, ztx_share_s) shares = LIST_HEAD_INITIALIZER(shares);
+static uv_once_t shares_once = UV_ONCE_INIT;
+static uv_mutex_t shares_lock;
+
+static void init_shares_lock(void) {
+    uv_mutex_init(&shares_lock);
+}
+
+static ztx_share *get_share(ziti_context ztx) {
+    uv_once(&shares_once, init_shares_lock);
+    uv_mutex_lock(&shares_lock);
+
+    ztx_share *s;
+    LIST_FOREACH(s, &shares, _next) {
+        if (s->loop == ztx->loop) {
+            break;
+        }
+    }
+
+    if (s == NULL) {
+        s = calloc(1, sizeof(*s));
+        s->loop = ztx->loop;
+        s->read_buf_size = ztx->opts.read_buf_size;
+        s->read_buf_count = ztx->opts.read_buf_count;
+        s->out_msg_pool_cap = ztx->opts.out_msg_pool_cap;
+        s->keys = key_pool_new(ztx->loop);
+        s->read_bufs = buffer_slab_new(s->read_buf_size, s->read_buf_count);
+        s->out_msgs = msg_pools_new(s->out_msg_pool_cap);
+        LIST_INIT(&s->members);
+        LIST_INIT(&s->ca_bundles);
+        LIST_INSERT_HEAD(&shares, s, _next);
+    }
+
+    uv_mutex_unlock(&shares_lock);
+    return s;
+}
+
+static void free_ca_bundle(struct ca_bundle_s *b) {
+    LIST_REMOVE(b, _next);
+    free(b->controller);
+    free(b->trust);
+    free(b->bundle);
+    free(b);
+}
+
+void ztx_share_join(ziti_context ztx) {
+    ztx_share *s = get_share(ztx);
+    ztx->share = s;
+    LIST_INSERT_HEAD(&s->members, ztx, share_next);
+
+    ztx->keys = s->keys;
+    if (ztx->opts.read_buf_size == s->read_buf_size && ztx->opts.read_buf_count == s->read_buf_count) {
+        ztx->read_bufs = s->read_bufs;
+    } else {
+        ztx->read_bufs = buffer_slab_new(ztx->opts.read_buf_size, ztx->opts.read_buf_count);
+    }
+    if (ztx->opts.out_msg_pool_cap == s->out_msg_pool_cap) {
+        ztx->out_msgs = s->out_msgs;
+    } else {
+        ztx->out_msgs = msg_pools_new(ztx->opts.out_msg_pool_cap);
+    }
+    ZTX_LOG(DEBUG, "joined shared resources of the loop");
+}
+
+void ztx_share_leave(ziti_context ztx) {
+    ztx_share *s = ztx->share;
+    if (s == NULL) {
+        return;
+    }
+
+    // context's own pools are freed with it
+    if (ztx->keys == s->keys) ztx->keys = NULL;
+    if (ztx->read_bufs == s->read_bufs) ztx->read_bufs = NULL;
+    if (ztx->out_msgs == s->out_msgs) ztx->out_msgs = NULL;
+
+    struct ca_bundle_s *b = LIST_FIRST(&s->ca_bundles);
+    while (b != NULL) {
+        struct ca_bundle_s *next = LIST_NEXT(b, _next);
+        if (b->fetcher == ztx) {
+            b->fetcher = NULL;
+            if (b->bundle == NULL) {
+                free_ca_bundle(b);
+            }
+        }
+        b = next;
+    }
+
+    LIST_REMOVE(ztx, share_next);
+    ztx->share = NULL;
+
+    uv_mutex_lock(&shares_lock);
+    bool last = LIST_EMPTY(&s->members);
+    if (last) {
+        LIST_REMOVE(s, _next);
+    }
+    uv_mutex_unlock(&shares_lock);
+
+    if (last) {
+        while (!LIST_EMPTY(&s->ca_bundles)) {
+            free_ca_bundle(LIST_FIRST(&s->ca_bundles));
+        }
+        key_pool_free(s->keys);
+        buffer_slab_free(s->read_bufs);
+        msg_pools_free(s->out_msgs);
+        free(s);
+    }
+}
+
+bool ztx_share_ca_bundle_lookup(ziti_context ztx) {
+    ztx_share *s = ztx->share;
+    const char *ca = ztx->config.id.ca;
+    const char *ctrl = ztx->config.controller_url;
+    if (s == NULL || ca == NULL || ctrl == NULL) {
+        return false;
+    }
+
+    struct ca_bundle_s *b;
+    LIST_FOREACH(b, &s->ca_bundles, _next) {
+        if (strcmp(b->controller, ctrl) != 0) {
+            continue;
+        }
+
+        bool trusted = strcmp(b->trust, ca) == 0;
+        bool current = b->bundle && strcmp(b->bundle, ca) == 0;
+        if (!trusted && !current) {
+            continue;
+        }
+
+        // result will be applied to all contexts trusting the same CA
+        if (b->fetcher) {
+            ZTX_LOG(DEBUG, "CA bundle is being fetched by ztx[%u]", b->fetcher->id);
+            return true;
+        }
+
+        if (uv_now(s->loop) - b->fetched < CA_BUNDLE_SHARE_TTL) {
+            ZTX_LOG(DEBUG, "using shared CA bundle");
+            if (trusted) {
+                ztx_update_ca_bundle(ztx, b->bundle);
+            }
+            return true;
+        }
+
+        b->fetcher = ztx;
+        return false;
+    }
+
+    NEWP(nb, struct ca_bundle_s);
+    nb->controller = strdup(ctrl);
+    nb->trust = strdup(ca);
+    nb->fetcher = ztx;
+    LIST_INSERT_HEAD(&s->ca_bundles, nb, _next);
+    return false;
+}
+
+void ztx_share_ca_bundle_done(ziti_context ztx, const char *pem) {
+    ztx_share *s = ztx->share;
+    struct ca_bundle_s *b = NULL;
+    if (s) {
+        LIST_FOREACH(b, &s->ca_bundles, _next) {
+            if (b->fetcher == ztx) {
+                break;
+            }
+        }
+    }
+
+    if (b == NULL) {
+        if (pem) {
+            ztx_update_ca_bundle(ztx, pem);
+        }
+        return;
+    }
+
+    b->fetcher = NULL;
+    if (pem == NULL) {
+        // next context to authenticate will try again
+        if (b->bundle == NULL) {
+            free_ca_bundle(b);
+        }
+        return;
+    }
+
+    char *prev = b->bundle;
+    b->bundle = strdup(pem);
+    b->fetched = uv_now(s->loop);
+
+    ziti_context m;
+    LIST_FOREACH(m, &s->members, share_next) {
+        const char *ca = m->config.id.ca;
+        if (ca == NULL || m->config.controller_url == NULL || strcmp(m->config.controller_url, b->controller) != 0) {
+            continue;
+        }
+        if (strcmp(ca, b->trust) == 0 || (prev && strcmp(ca, prev) == 0)) {
+            ztx_update_ca_bundle(m, pem);
+        }
+    }
+    free(prev);
+}
@@ -15,6 +15,7 @@
 
 #include <uv.h>
 
+#include <inttypes.h>
 #include <stdlib.h>
 #include <string.h>
 
@@ -495,6 +496,18 @@ static void on_ziti_event(ziti_context ztx, const ziti_event_t *event) {
                 case EdgeRouterUnavailable:
                     ZITI_LOG(INFO, "edge router %s is not available", event->event.router.name);
                     break;
+                case EdgeRouterReconnecting:
+                    ZITI_LOG(INFO, "reconnecting to edge router %s in %" PRIu64 "ms (attempt %u)",
+                             event->event.router.name, event->event.router.reconnect_delay,
+                             event->event.router.reconnect_attempt);
+                    break;
+            }
+            break;
+        case ZitiMemoryEvent:
+            if (event->event.memory.over_limit) {
+                ZITI_LOG(WARN, "memory usage %zu is over limit %zu", event->event.memory.used, event->event.memory.limit);
+            } else {
+                ZITI_LOG(INFO, "memory usage %zu is back under limit %zu", event->event.memory.used, event->event.memory.limit);
             }
             break;
         case ZitiMfaAuthEvent:
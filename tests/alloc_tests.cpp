@@ -0,0 +1,180 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "catch2_includes.hpp"
+
+// needs library built with -DZITI_ALLOC_TRACKING=ON
+#if defined(ZITI_ALLOC_TRACKING)
+
+#include "mock_edge.h"
+#include "ziti_alloc.h"
+
+#include <cstring>
+#include <vector>
+
+#include <ziti/ziti.h>
+
+static const char *const SERVICE = "alloc-echo";
+
+// allocations are expected while pools warm up
+static const int WARMUP_ROUNDS = 200;
+static const int MEASURED_ROUNDS = 1000;
+
+struct ping_pong {
+    uv_loop_t *loop;
+    mock_edge *mock;
+    ziti_context ztx;
+    uv_timer_t timer;
+    std::vector<uint8_t> payload;
+
+    bool started;
+    int rounds;
+    size_t received;
+    int writes_completed;
+    int error;
+
+    ziti_alloc_stats before;
+    ziti_alloc_stats after;
+};
+
+static void pp_finish(ping_pong *p) {
+    ziti_shutdown(p->ztx);
+    uv_timer_start(&p->timer, [](uv_timer_t *t) {
+        auto p = (ping_pong *) t->data;
+        mock_edge_free(p->mock);
+        uv_close((uv_handle_t *) t, nullptr);
+    }, 500, 0);
+}
+
+static void pp_write_cb(ziti_connection, ssize_t status, void *ctx) {
+    auto p = (ping_pong *) ctx;
+    if (status < 0) {
+        p->error = (int) status;
+    } else {
+        p->writes_completed++;
+    }
+}
+
+static void pp_send(ziti_connection conn, ping_pong *p) {
+    int rc = ziti_write(conn, p->payload.data(), p->payload.size(), pp_write_cb, p);
+    if (rc != ZITI_OK) {
+        p->error = rc;
+        ziti_close(conn, nullptr);
+        pp_finish(p);
+    }
+}
+
+static ssize_t pp_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto p = (ping_pong *) ziti_conn_data(conn);
+    if (len < 0) {
+        p->error = (int) len;
+        ziti_close(conn, nullptr);
+        pp_finish(p);
+        return 0;
+    }
+
+    p->received += len;
+    if (p->received < p->payload.size()) {
+        return len;
+    }
+
+    p->received = 0;
+    p->rounds++;
+    if (p->rounds == WARMUP_ROUNDS) {
+        ziti_alloc_get_stats(&p->before);
+    }
+    if (p->rounds == WARMUP_ROUNDS + MEASURED_ROUNDS) {
+        ziti_alloc_get_stats(&p->after);
+        ziti_close(conn, nullptr);
+        pp_finish(p);
+        return len;
+    }
+
+    pp_send(conn, p);
+    return len;
+}
+
+static void pp_connected(ziti_connection conn, int status) {
+    auto p = (ping_pong *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        p->error = status;
+        ziti_close(conn, nullptr);
+        pp_finish(p);
+        return;
+    }
+    pp_send(conn, p);
+}
+
+static void pp_event(ziti_context ztx, const ziti_event_t *ev) {
+    auto p = (ping_pong *) ziti_app_ctx(ztx);
+    if (ev->type != ZitiServiceEvent || p->started) {
+        return;
+    }
+
+    for (int i = 0; ev->event.service.added && ev->event.service.added[i]; i++) {
+        if (strcmp(ev->event.service.added[i]->name, SERVICE) == 0) {
+            p->started = true;
+            ziti_connection conn;
+            ziti_conn_init(ztx, &conn, p);
+            ziti_dial(conn, SERVICE, pp_connected, pp_data);
+            return;
+        }
+    }
+}
+
+static void run_ping_pong(ping_pong &p) {
+    p.loop = uv_loop_new();
+    p.mock = mock_edge_new(p.loop);
+    mock_edge_add_router(p.mock, "alloc-router");
+    mock_edge_add_service(p.mock, SERVICE);
+
+    ziti_config cfg;
+    REQUIRE(mock_edge_config(p.mock, &cfg) == ZITI_OK);
+    REQUIRE(ziti_context_init(&p.ztx, &cfg) == ZITI_OK);
+    free_ziti_config(&cfg);
+    mock_edge_attach(p.mock, p.ztx);
+
+    ziti_options opts = {};
+    opts.app_ctx = &p;
+    opts.events = ZitiServiceEvent;
+    opts.event_cb = pp_event;
+    REQUIRE(ziti_context_set_options(p.ztx, &opts) == ZITI_OK);
+
+    uv_timer_init(p.loop, &p.timer);
+    p.timer.data = &p;
+    REQUIRE(ziti_context_run(p.ztx, p.loop) == ZITI_OK);
+
+    uv_run(p.loop, UV_RUN_DEFAULT);
+    uv_loop_delete(p.loop);
+}
+
+TEST_CASE("steady state data path does not allocate", "[mock][alloc]") {
+    size_t size = GENERATE(64, 1024, 16 * 1024);
+
+    ping_pong p = {};
+    p.payload.assign(size, 'x');
+    run_ping_pong(p);
+
+    REQUIRE(p.error == 0);
+    REQUIRE(p.rounds == WARMUP_ROUNDS + MEASURED_ROUNDS);
+    CHECK(p.writes_completed >= WARMUP_ROUNDS + MEASURED_ROUNDS - 1);
+
+    INFO("payload " << size << " bytes: " << (p.after.allocs - p.before.allocs) << " allocations, "
+                    << (p.after.reallocs - p.before.reallocs) << " reallocations in "
+                    << MEASURED_ROUNDS << " write/echo rounds");
+    CHECK(p.after.allocs == p.before.allocs);
+    CHECK(p.after.reallocs == p.before.reallocs);
+}
+
+#endif
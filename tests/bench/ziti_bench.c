@@ -0,0 +1,362 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+/*
+ * Microbenchmarks of the data path primitives.
+ *
+ * usage: ziti-bench [-q] [filter]
+ *   filter  only run benchmarks with names containing it
+ *   -q      quick run (1/10 of the iterations), for smoke testing
+ *
+ * Every result is printed as one JSON object per line:
+ *   {"bench":"buffer.append_get","iterations":1000000,"total_ns":...,"ns_per_op":...,"ops_per_sec":...,"bytes_per_sec":...}
+ * bytes_per_sec is only reported for benchmarks that move data.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <uv.h>
+#include <sodium.h>
+
+#include <ziti/model_collections.h>
+#include <ziti/ziti_buffer.h>
+#include <ziti/ziti_model.h>
+
+#include "buffer.h"
+#include "e2e_stream.h"
+#include "edge_protocol.h"
+#include "message.h"
+#include "pool.h"
+
+static const char *filter;
+static unsigned long scale = 1;
+
+// defeats dead code elimination of benchmarked calls
+static volatile uintptr_t sink;
+
+struct bench_s {
+    const char *name;
+    // runs [n] operations, returns number of bytes processed (0 if not applicable)
+    size_t (*run)(size_t n);
+    size_t iterations;
+};
+
+static void report(const char *name, size_t n, uint64_t ns, size_t bytes) {
+    double per_op = n ? (double) ns / (double) n : 0;
+    double secs = (double) ns / 1e9;
+    printf("{\"bench\":\"%s\",\"iterations\":%zu,\"total_ns\":%llu,\"ns_per_op\":%.2f,\"ops_per_sec\":%.0f",
+           name, n, (unsigned long long) ns, per_op, secs > 0 ? (double) n / secs : 0);
+    if (bytes > 0) {
+        printf(",\"bytes_per_sec\":%.0f", secs > 0 ? (double) bytes / secs : 0);
+    }
+    printf("}\n");
+    fflush(stdout);
+}
+
+static size_t bench_message_new(size_t n) {
+    pool_t *p = pool_new(sizeof(message) + 256, 16, (void (*)(void *)) message_free);
+    int32_t conn_id = 42;
+    uint32_t seq = 1;
+    hdr_t headers[] = {
+            {.header_id = ConnIdHeader, .length = sizeof(conn_id), .value = (uint8_t *) &conn_id},
+            {.header_id = SeqHeader, .length = sizeof(seq), .value = (uint8_t *) &seq},
+    };
+
+    for (size_t i = 0; i < n; i++) {
+        message *m = message_new(p, ContentTypeData, headers, 2, 128);
+        sink += (uintptr_t) m->body;
+        pool_return_obj(m);
+    }
+    pool_destroy(p);
+    return 0;
+}
+
+static size_t bench_parse_hdrs(size_t n) {
+    int32_t conn_id = 42;
+    uint32_t seq = 1;
+    int32_t flags = 0;
+    const char *caller = "bench-identity";
+    hdr_t headers[] = {
+            {.header_id = ConnIdHeader, .length = sizeof(conn_id), .value = (uint8_t *) &conn_id},
+            {.header_id = SeqHeader, .length = sizeof(seq), .value = (uint8_t *) &seq},
+            {.header_id = FlagsHeader, .length = sizeof(flags), .value = (uint8_t *) &flags},
+            {.header_id = CallerIdHeader, .length = (uint32_t) strlen(caller), .value = (uint8_t *) caller},
+    };
+    message *m = message_new(NULL, ContentTypeData, headers, 4, 0);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        hdr_t *hdrs = NULL;
+        int count = parse_hdrs(m->headers, m->header.headers_len, &hdrs);
+        sink += (uintptr_t) count;
+        free(hdrs);
+        bytes += m->header.headers_len;
+    }
+    pool_return_obj(m);
+    return bytes;
+}
+
+static void no_release(void *p) {
+    (void) p;
+}
+
+static size_t bench_buffer(size_t n) {
+    static uint8_t data[16 * 1024];
+    buffer *b = new_buffer();
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        buffer_append_owned(b, data, sizeof(data), NULL, no_release);
+        uint8_t *p;
+        ssize_t len;
+        // typical consumer taking data as it fits in app buffer
+        while ((len = buffer_get_next(b, 4096, &p)) > 0) {
+            sink += (uintptr_t) p;
+            bytes += (size_t) len;
+        }
+    }
+    free_buffer(b);
+    return bytes;
+}
+
+static size_t bench_pool(size_t n) {
+    pool_t *p = pool_new(512, 64, NULL);
+    void *objs[8];
+
+    for (size_t i = 0; i < n; i += 8) {
+        for (int j = 0; j < 8; j++) {
+            objs[j] = pool_alloc_obj(p);
+        }
+        for (int j = 0; j < 8; j++) {
+            pool_return_obj(objs[j]);
+        }
+    }
+    pool_destroy(p);
+    return 0;
+}
+
+#define MAP_KEYS 100000
+
+static char map_keys[MAP_KEYS][40];
+static model_map lookup_map;
+
+// populated once, during the warm up run
+static void init_lookup_map(void) {
+    if (model_map_size(&lookup_map) > 0) {
+        return;
+    }
+    for (int i = 0; i < MAP_KEYS; i++) {
+        snprintf(map_keys[i], sizeof(map_keys[i]), "4aba8ab0-df3f-45fd-%04x-%012x", i % 0xffff, i);
+        model_map_set(&lookup_map, map_keys[i], map_keys[i]);
+    }
+}
+
+static size_t bench_model_map(size_t n) {
+    init_lookup_map();
+    for (size_t i = 0; i < n; i++) {
+        sink += (uintptr_t) model_map_get(&lookup_map, map_keys[(i * 7919) % MAP_KEYS]);
+    }
+    return 0;
+}
+
+static size_t bench_model_map_set(size_t n) {
+    model_map m = {0};
+    char key[40];
+    for (size_t i = 0; i < n; i++) {
+        snprintf(key, sizeof(key), "svc-%zu", i % MAP_KEYS);
+        model_map_set(&m, key, (void *) (uintptr_t) (i + 1));
+    }
+    model_map_clear(&m, NULL);
+    return 0;
+}
+
+#define PARSE_SERVICES 5000
+
+static char *parse_json;
+static size_t parse_json_len;
+
+// generated once, during the warm up run
+static void init_services_json(void) {
+    if (parse_json != NULL) {
+        return;
+    }
+
+    string_buf_t *b = new_string_buf();
+    string_buf_append(b, "[");
+    for (int i = 0; i < PARSE_SERVICES; i++) {
+        string_buf_fmt(b,
+                       "%s{\"id\":\"4aba8ab0-df3f-45fd-bed7-%012d\",\"name\":\"service-%d\","
+                       "\"createdAt\":\"2023-01-10T17:04:30.679489183Z\",\"updatedAt\":\"2023-01-10T17:04:30.679489183Z\","
+                       "\"encryptionRequired\":true,\"permissions\":[\"Dial\",\"Bind\"],"
+                       "\"postureQueries\":[{\"policyId\":\"pol-%d\",\"isPassing\":true,\"postureQueries\":"
+                       "[{\"id\":\"pq-%d\",\"isPassing\":true,\"queryType\":\"OS\",\"timeout\":-1,\"timeoutRemaining\":-1}]}],"
+                       "\"config\":{\"intercept.v1\":{\"protocols\":[\"tcp\",\"udp\"],\"addresses\":[\"service-%d.ziti\",\"100.64.%d.%d\"],"
+                       "\"portRanges\":[{\"low\":80,\"high\":80},{\"low\":443,\"high\":443}]},"
+                       "\"host.v1\":{\"protocol\":\"tcp\",\"address\":\"10.0.%d.%d\",\"port\":8080}},"
+                       "\"tags\":{\"team\":\"bench\"}}",
+                       i ? "," : "", i, i, i % 100, i % 100, i, i / 256, i % 256, i / 256, i % 256);
+    }
+    string_buf_append(b, "]");
+    parse_json = string_buf_to_string(b, &parse_json_len);
+    delete_string_buf(b);
+}
+
+static size_t bench_model_parse(size_t n) {
+    init_services_json();
+    size_t bytes = 0;
+
+    for (size_t i = 0; i < n; i++) {
+        ziti_service_array arr = NULL;
+        int rc = parse_ziti_service_array(&arr, parse_json, parse_json_len);
+        if (rc < 0) {
+            fprintf(stderr, "failed to parse services json: %d\n", rc);
+            exit(1);
+        }
+        sink += (uintptr_t) arr[PARSE_SERVICES - 1];
+        free_ziti_service_array(&arr);
+        bytes += parse_json_len;
+    }
+    return bytes;
+}
+
+static size_t bench_secretstream(size_t n) {
+    enum { CHUNK = 16 * 1024 };
+    static uint8_t plain[CHUNK];
+    static uint8_t cipher[CHUNK + crypto_secretstream_xchacha20poly1305_ABYTES];
+    static uint8_t out[CHUNK];
+    uint8_t key[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+    uint8_t header[crypto_secretstream_xchacha20poly1305_HEADERBYTES];
+    crypto_secretstream_xchacha20poly1305_state push, pull;
+
+    crypto_secretstream_xchacha20poly1305_keygen(key);
+    crypto_secretstream_xchacha20poly1305_init_push(&push, header, key);
+    crypto_secretstream_xchacha20poly1305_init_pull(&pull, header, key);
+
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        unsigned long long clen, mlen;
+        uint8_t tag;
+        crypto_secretstream_xchacha20poly1305_push(&push, cipher, &clen, plain, sizeof(plain), NULL, 0, 0);
+        if (crypto_secretstream_xchacha20poly1305_pull(&pull, out, &mlen, &tag, cipher, clen, NULL, 0) != 0) {
+            fprintf(stderr, "secretstream pull failed\n");
+            exit(1);
+        }
+        bytes += (size_t) mlen;
+    }
+    return bytes;
+}
+
+// connected pair of e2e streams, switched to AES-256-GCM if [aes] is set
+static void e2e_pair(struct e2e_stream *out, struct e2e_stream *in, bool aes) {
+    uint8_t key[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+    uint8_t header[E2E_HEADER_BYTES];
+    uint8_t ctl[E2E_ABYTES];
+    uint8_t scratch[E2E_ABYTES];
+    size_t len;
+
+    crypto_secretstream_xchacha20poly1305_keygen(key);
+    e2e_init_push(out, header, key, aes);
+    e2e_init_pull(in, header, key, aes);
+    if (aes) {
+        e2e_push_offer(out, ctl);
+        e2e_pull(in, scratch, &len, ctl, sizeof(ctl));
+        e2e_push_switch(out, ctl);
+        e2e_pull(in, scratch, &len, ctl, sizeof(ctl));
+    }
+}
+
+static size_t bench_e2e(size_t n, bool aes) {
+    enum { CHUNK = 16 * 1024 };
+    static uint8_t msg[CHUNK + E2E_ABYTES];
+    struct e2e_stream out, in;
+
+    e2e_pair(&out, &in, aes);
+    size_t bytes = 0;
+    for (size_t i = 0; i < n; i++) {
+        size_t len;
+        // in place, as on the data path
+        e2e_push(&out, msg, msg + 1, CHUNK);
+        if (e2e_pull(&in, msg + 1, &len, msg, sizeof(msg)) != 0) {
+            fprintf(stderr, "e2e pull failed\n");
+            exit(1);
+        }
+        bytes += len;
+    }
+    e2e_stream_free(&out);
+    e2e_stream_free(&in);
+    return bytes;
+}
+
+static size_t bench_e2e_xchacha20(size_t n) {
+    return bench_e2e(n, false);
+}
+
+static size_t bench_e2e_aes256gcm(size_t n) {
+    if (!e2e_aes_available()) {
+        fprintf(stderr, "AES-256-GCM is not hardware accelerated on this host, skipping\n");
+        return 0;
+    }
+    return bench_e2e(n, true);
+}
+
+static struct bench_s benchmarks[] = {
+        {"message.new", bench_message_new, 2000000},
+        {"message.parse_hdrs", bench_parse_hdrs, 2000000},
+        {"buffer.append_get", bench_buffer, 500000},
+        {"pool.alloc_return", bench_pool, 5000000},
+        {"model_map.get_100k", bench_model_map, 5000000},
+        {"model_map.set", bench_model_map_set, 1000000},
+        {"model.parse_5k_services", bench_model_parse, 10},
+        {"secretstream.push_pull_16k", bench_secretstream, 50000},
+        {"e2e.xchacha20poly1305_16k", bench_e2e_xchacha20, 50000},
+        {"e2e.aes256gcm_16k", bench_e2e_aes256gcm, 50000},
+};
+
+int main(int argc, char *argv[]) {
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "-q") == 0) {
+            scale = 10;
+        } else {
+            filter = argv[i];
+        }
+    }
+
+    if (sodium_init() == -1) {
+        fprintf(stderr, "failed to initialize libsodium\n");
+        return 1;
+    }
+
+    for (size_t i = 0; i < sizeof(benchmarks) / sizeof(benchmarks[0]); i++) {
+        struct bench_s *b = &benchmarks[i];
+        if (filter && strstr(b->name, filter) == NULL) {
+            continue;
+        }
+
+        size_t n = b->iterations / scale;
+        if (n == 0) n = 1;
+
+        // warm up caches and pools
+        b->run(n / 10 + 1);
+
+        uint64_t start = uv_hrtime();
+        size_t bytes = b->run(n);
+        report(b->name, n, uv_hrtime() - start, bytes);
+    }
+
+    model_map_clear(&lookup_map, NULL);
+    free(parse_json);
+    return 0;
+}
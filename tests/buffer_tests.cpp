@@ -18,6 +18,7 @@ limitations under the License.
 
 #include <buffer.h>
 #include <iostream>
+#include <cstring>
 
 TEST_CASE("fixed buffer overflow", "[util]") {
     char b[10];
@@ -103,3 +104,92 @@ TEST_CASE("buffer fmt", "[util]") {
 
 
 
+TEST_CASE("read buffer slab", "[util]") {
+    auto slab = buffer_slab_new(1024, 2);
+    uint64_t hits, misses;
+    size_t len;
+
+    auto b1 = buffer_slab_alloc(slab, &len);
+    CHECK(len == 1024);
+    auto b2 = buffer_slab_alloc(slab, &len);
+    auto b3 = buffer_slab_alloc(slab, &len);
+    buffer_slab_stats(slab, &hits, &misses);
+    CHECK(hits == 0);
+    CHECK(misses == 3);
+
+    // only two buffers are kept for reuse
+    buffer_slab_release(b3);
+    buffer_slab_release(b2);
+
+    auto in = new_buffer();
+    buffer_append_slab(in, b1, 10);
+    uint8_t *p;
+    CHECK(buffer_get_next(in, 20, &p) == 10);
+    CHECK(p == b1);
+    buffer_cleanup(in);
+
+    CHECK(buffer_slab_alloc(slab, &len) == b1);
+    CHECK(buffer_slab_alloc(slab, &len) == b2);
+    buffer_slab_stats(slab, &hits, &misses);
+    CHECK(hits == 2);
+    CHECK(misses == 3);
+
+    buffer_slab_release(b2);
+    // slab is freed after last buffer is released
+    buffer_slab_free(slab);
+    buffer_slab_release(b1);
+    free_buffer(in);
+}
+
+TEST_CASE("buffer iov", "[util]") {
+    auto in = new_buffer();
+    buffer_append(in, (uint8_t *) strdup("hello"), 5);
+    buffer_append(in, (uint8_t *) strdup(", "), 2);
+    buffer_append(in, (uint8_t *) strdup("world"), 5);
+
+    uv_buf_t iov[BUFFER_IOV_MAX];
+    REQUIRE(buffer_peek_iov(in, iov, BUFFER_IOV_MAX) == 3);
+    CHECK(std::string(iov[0].base, iov[0].len) == "hello");
+    CHECK(std::string(iov[2].base, iov[2].len) == "world");
+    CHECK(buffer_peek_iov(in, iov, 2) == 2);
+
+    // consume across chunk boundary
+    CHECK(buffer_consume(in, 6) == 6);
+    CHECK(buffer_available(in) == 6);
+    REQUIRE(buffer_peek_iov(in, iov, BUFFER_IOV_MAX) == 2);
+    CHECK(std::string(iov[0].base, iov[0].len) == " ");
+
+    char out[16] = {};
+    CHECK(buffer_copy_out(in, (uint8_t *) out, sizeof(out)) == 6);
+    CHECK(std::string(out) == " world");
+    CHECK(buffer_available(in) == 0);
+    CHECK(buffer_peek_iov(in, iov, BUFFER_IOV_MAX) == 0);
+    CHECK(buffer_consume(in, 1) == 0);
+
+    free_buffer(in);
+}
+
+TEST_CASE("contiguous string buffer", "[util]") {
+    string_buf_t buf;
+    string_buf_init_sized(&buf, 4);
+
+    CHECK(string_buf_append(&buf, "hello") == 0);
+    CHECK(string_buf_append_byte(&buf, ',') == 0);
+    CHECK(string_buf_fmt(&buf, " %s #%d", "world", 42) == 10);
+    CHECK(string_buf_size(&buf) == 16);
+
+    size_t len;
+    char *s = string_buf_to_string(&buf, &len);
+    CHECK(len == 16);
+    CHECK(std::string(s) == "hello, world #42");
+    free(s);
+
+    // buffer is reusable after its content was handed over
+    CHECK(string_buf_size(&buf) == 0);
+    CHECK(string_buf_appendn(&buf, "again", 5) == 0);
+    s = string_buf_to_string(&buf, &len);
+    CHECK(std::string(s) == "again");
+    free(s);
+
+    string_buf_free(&buf);
+}
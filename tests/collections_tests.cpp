@@ -16,6 +16,8 @@
 
 #include <ziti/model_collections.h>
 #include <string.h>
+#include <map>
+#include <string>
 
 
 static const int buckets = 64;
@@ -115,6 +117,60 @@ TEST_CASE("it remove last element", "[model]") {
     REQUIRE(m.impl == nullptr);
 }
 
+TEST_CASE("map interleaved insert and remove", "[model]") {
+    model_map m = {nullptr};
+    std::map<std::string, intptr_t> ref;
+
+    // mix of inline and long keys, removals shift colliding entries back
+    for (int round = 0; round < 4; round++) {
+        for (int i = 0; i < 2000; i++) {
+            std::string key = (i % 3 == 0 ? "a-rather-long-key-that-is-not-stored-inline-" : "k") + std::to_string(i);
+            model_map_set(&m, key.c_str(), (void *) (intptr_t) (i + round));
+            ref[key] = i + round;
+        }
+        for (int i = round; i < 2000; i += 2) {
+            std::string key = (i % 3 == 0 ? "a-rather-long-key-that-is-not-stored-inline-" : "k") + std::to_string(i);
+            CHECK((intptr_t) model_map_remove(&m, key.c_str()) == ref[key]);
+            ref.erase(key);
+        }
+
+        CHECK(model_map_size(&m) == ref.size());
+        for (auto &e: ref) {
+            CHECK((intptr_t) model_map_get(&m, e.first.c_str()) == e.second);
+        }
+
+        size_t count = 0;
+        const char *k;
+        void *v;
+        MODEL_MAP_FOREACH(k, v, &m) {
+            REQUIRE(ref.count(k) == 1);
+            CHECK(ref[k] == (intptr_t) v);
+            count++;
+        }
+        CHECK(count == ref.size());
+    }
+
+    // remove every other element while iterating
+    auto it = model_map_iterator(&m);
+    bool drop = true;
+    while (it) {
+        if (drop) {
+            ref.erase(model_map_it_key(it));
+            it = model_map_it_remove(it);
+        } else {
+            it = model_map_it_next(it);
+        }
+        drop = !drop;
+    }
+    CHECK(model_map_size(&m) == ref.size());
+    for (auto &e: ref) {
+        CHECK((intptr_t) model_map_get(&m, e.first.c_str()) == e.second);
+    }
+
+    model_map_clear(&m, nullptr);
+    CHECK(m.impl == nullptr);
+}
+
 TEST_CASE("list tests", "[model]") {
     model_list l = {nullptr};
     void *msg;
@@ -124,6 +124,28 @@ TEST_CASE("invalid_controller", "[controller][GH-44]") {
     uv_run(loop, UV_RUN_DEFAULT);
 }
 
+TEST_CASE("service filter", "[controller]") {
+    ziti_controller ctrl;
+    uv_loop_t *loop = uv_default_loop();
+    REQUIRE(ziti_ctrl_init(loop, &ctrl, "https://ctrl.example.com", nullptr) == ZITI_OK);
+
+    const char *names[] = {"web app", "db", nullptr};
+    ziti_ctrl_set_service_filter(&ctrl, names);
+    REQUIRE_THAT(ctrl.services_path,
+                 Equals("/services?filter=name%20in%20%5B%22web%20app%22%2C%22db%22%5D"));
+
+    const char *quoted[] = {"say \"hi\"", "c:\\tmp", nullptr};
+    ziti_ctrl_set_service_filter(&ctrl, quoted);
+    REQUIRE_THAT(ctrl.services_path,
+                 Equals("/services?filter=name%20in%20%5B%22say%20%5C%22hi%5C%22%22%2C%22c%3A%5C%5Ctmp%22%5D"));
+
+    ziti_ctrl_set_service_filter(&ctrl, nullptr);
+    REQUIRE(ctrl.services_path == nullptr);
+
+    ziti_ctrl_close(&ctrl);
+    uv_run(loop, UV_RUN_DEFAULT);
+}
+
 TEST_CASE("controller_test","[integ]") {
     char *conf = getenv("ZITI_SDK_CONFIG");
     if (conf == nullptr) {
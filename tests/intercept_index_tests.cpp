@@ -0,0 +1,132 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "catch2/catch_test_macros.hpp"
+#include "catch2/matchers/catch_matchers_string.hpp"
+#include "intercept_index.h"
+
+#include <cstring>
+#include <string>
+
+using namespace Catch::Matchers;
+
+static ziti_service *make_service(const std::string &name, const std::string &addresses,
+                                  const std::string &ports = R"({"low": 1, "high": 65535})") {
+    std::string json = R"({"id": ")" + name + R"(-id", "name": ")" + name + R"(",
+        "permissions": ["Dial"],
+        "config": {
+          "intercept.v1": {
+            "protocols": ["tcp"],
+            "addresses": [)" + addresses + R"(],
+            "portRanges": [)" + ports + R"(]
+          }
+        }})";
+
+    auto s = (ziti_service *) calloc(1, sizeof(ziti_service));
+    REQUIRE(parse_ziti_service(s, json.c_str(), json.size()) > 0);
+    return s;
+}
+
+static const char *lookup(intercept_index *idx, const char *address, int port, ziti_protocol proto = ziti_protocols.tcp) {
+    ziti_address addr;
+    REQUIRE(parse_ziti_address_str(&addr, address) == 0);
+    return intercept_index_lookup(idx, proto, &addr, port);
+}
+
+static void free_service(ziti_service *s) {
+    free_ziti_service(s);
+    free(s);
+}
+
+TEST_CASE("intercept index hostnames", "[intercept]") {
+    intercept_index idx = {};
+
+    auto exact = make_service("exact", R"("Web.Example.COM")");
+    auto wild = make_service("wild", R"("*.example.com")");
+    auto sub = make_service("sub", R"("*.web.example.com")");
+    intercept_index_update(&idx, exact);
+    intercept_index_update(&idx, wild);
+    intercept_index_update(&idx, sub);
+
+    CHECK_THAT(lookup(&idx, "web.example.com", 80), Equals("exact"));
+    CHECK_THAT(lookup(&idx, "www.example.com", 80), Equals("wild"));
+    CHECK_THAT(lookup(&idx, "example.com", 80), Equals("wild"));
+    CHECK_THAT(lookup(&idx, "a.web.example.com", 80), Equals("sub"));
+    CHECK_THAT(lookup(&idx, "a.b.example.com", 80), Equals("wild"));
+    CHECK(lookup(&idx, "example.org", 80) == nullptr);
+    CHECK(lookup(&idx, "web.example.com", 80, ziti_protocols.udp) == nullptr);
+
+    intercept_index_remove(&idx, "exact");
+    CHECK_THAT(lookup(&idx, "web.example.com", 80), Equals("sub"));
+    intercept_index_remove(&idx, "sub");
+    CHECK_THAT(lookup(&idx, "web.example.com", 80), Equals("wild"));
+
+    intercept_index_clear(&idx);
+    CHECK(lookup(&idx, "www.example.com", 80) == nullptr);
+    CHECK(model_map_size(&idx.services) == 0);
+
+    free_service(exact);
+    free_service(wild);
+    free_service(sub);
+}
+
+TEST_CASE("intercept index cidr", "[intercept]") {
+    intercept_index idx = {};
+
+    auto wide = make_service("wide", R"("10.0.0.0/8")");
+    auto net = make_service("net", R"("10.1.0.0/16")");
+    auto host = make_service("host", R"("10.1.2.3")", R"({"low": 443, "high": 443})");
+    auto v6 = make_service("v6", R"("fd00::/8")");
+    intercept_index_update(&idx, wide);
+    intercept_index_update(&idx, net);
+    intercept_index_update(&idx, host);
+    intercept_index_update(&idx, v6);
+
+    CHECK_THAT(lookup(&idx, "10.1.2.3", 443), Equals("host"));
+    CHECK_THAT(lookup(&idx, "10.1.2.3", 80), Equals("net"));
+    CHECK_THAT(lookup(&idx, "10.1.9.9", 80), Equals("net"));
+    CHECK_THAT(lookup(&idx, "10.200.0.1", 80), Equals("wide"));
+    CHECK(lookup(&idx, "11.0.0.1", 80) == nullptr);
+    CHECK_THAT(lookup(&idx, "fd12::1", 80), Equals("v6"));
+    CHECK(lookup(&idx, "fe80::1", 80) == nullptr);
+
+    // update replaces previous addresses
+    auto moved = make_service("net", R"("192.168.0.0/24")");
+    intercept_index_update(&idx, moved);
+    CHECK_THAT(lookup(&idx, "10.1.9.9", 80), Equals("wide"));
+    CHECK_THAT(lookup(&idx, "192.168.0.7", 80), Equals("net"));
+
+    intercept_index_clear(&idx);
+
+    free_service(wide);
+    free_service(net);
+    free_service(host);
+    free_service(v6);
+    free_service(moved);
+}
+
+TEST_CASE("intercept index ties", "[intercept]") {
+    intercept_index idx = {};
+
+    auto b = make_service("b-svc", R"("same.host")");
+    auto a = make_service("a-svc", R"("same.host")");
+    intercept_index_update(&idx, b);
+    intercept_index_update(&idx, a);
+
+    CHECK_THAT(lookup(&idx, "same.host", 22), Equals("a-svc"));
+
+    intercept_index_clear(&idx);
+    free_service(a);
+    free_service(b);
+}
@@ -146,4 +146,170 @@ TEST_CASE("large unpooled", "[model]") {
     pool_return_obj(m2);
 
     pool_destroy(p);
-}
\ No newline at end of file
+}
+TEST_CASE("in place from chunk", "[model]") {
+    auto p = pool_new(sizeof(message), 3, (void (*)(void *)) message_free);
+
+    hdr_t headers[] = {
+            {
+                    .header_id = 1,
+                    .length = 3,
+                    .value = (uint8_t *) "foo"
+            },
+    };
+    uint32_t seq = 3333;
+    auto content1 = "this message is read in place";
+    auto m1 = message_new(p, ContentTypeData, headers, 1, strlen(content1));
+    strncpy(reinterpret_cast<char *>(m1->body), content1, strlen(content1));
+    message_set_seq(m1, &seq);
+
+    // two frames in one read chunk
+    auto data = (uint8_t *) malloc(2 * m1->msgbuflen);
+    memcpy(data, m1->msgbufp, m1->msgbuflen);
+    memcpy(data + m1->msgbuflen, m1->msgbufp, m1->msgbuflen);
+
+    auto in = new_buffer();
+    buffer_append(in, data, 2 * m1->msgbuflen);
+
+    uint8_t *ptr;
+    REQUIRE(buffer_peek(in, &ptr) == 2 * m1->msgbuflen);
+    auto m2 = message_new_from_chunk(p, ptr, buffer_retain_head(in));
+    CHECK(buffer_get_next(in, m1->msgbuflen, &ptr) == m1->msgbuflen);
+
+    REQUIRE(buffer_peek(in, &ptr) == m1->msgbuflen);
+    auto m3 = message_new_from_chunk(p, ptr, buffer_retain_head(in));
+    CHECK(buffer_get_next(in, m1->msgbuflen, &ptr) == m1->msgbuflen);
+
+    // chunk is consumed, and buffer is gone
+    buffer_cleanup(in);
+    CHECK(buffer_available(in) == 0);
+    free_buffer(in);
+
+    CHECK(m2->msgbufp == data);
+    CHECK(m3->msgbufp == data + m1->msgbuflen);
+    CHECK(m3->header.seq == 3334);
+    m3->nhdrs = parse_hdrs(m3->headers, m3->header.headers_len, &m3->hdrs);
+    CHECK(m3->nhdrs == 1);
+
+    uint8_t *hdrval;
+    size_t hdrlen;
+    CHECK(message_get_bytes_header(m3, 1, &hdrval, &hdrlen));
+    CHECK(strncmp((const char *) headers[0].value, (const char *) hdrval, hdrlen) == 0);
+    CHECK(strncmp(content1, (const char *) m3->body, m3->header.body_len) == 0);
+
+    pool_return_obj(m1);
+    pool_return_obj(m2);
+    pool_return_obj(m3);
+
+    pool_destroy(p);
+}
+
+TEST_CASE("parse headers in place", "[model]") {
+    int32_t conn_id = 42;
+    int32_t reply_for = 7;
+    hdr_t headers[MSG_INLINE_HDRS + 4];
+    uint32_t vals[MSG_INLINE_HDRS];
+    int n = 0;
+    for (; n < MSG_INLINE_HDRS; n++) {
+        vals[n] = n;
+        headers[n] = {
+                .header_id = (uint32_t) (2000 + n),
+                .length = sizeof(vals[n]),
+                .value = (uint8_t *) &vals[n],
+        };
+    }
+    headers[n++] = {.header_id = ConnIdHeader, .length = sizeof(conn_id), .value = (uint8_t *) &conn_id};
+    headers[n++] = {.header_id = ReplyForHeader, .length = sizeof(reply_for), .value = (uint8_t *) &reply_for};
+
+    uint32_t seq = 0;
+    auto m1 = message_new(nullptr, ContentTypeData, headers, n, 0);
+    message_set_seq(m1, &seq);
+
+    auto m2 = message_new_from_header(nullptr, m1->msgbufp);
+    memcpy(m2->msgbufp, m1->msgbufp, m1->msgbuflen);
+    CHECK(message_parse_hdrs(m2) == n);
+    CHECK(m2->hdrs != m2->hdr_table);
+
+    int32_t v;
+    CHECK(message_get_int32_header(m2, ConnIdHeader, &v));
+    CHECK(v == conn_id);
+    CHECK(message_get_int32_header(m2, ReplyForHeader, &v));
+    CHECK(v == reply_for);
+    CHECK_FALSE(message_get_int32_header(m2, SeqHeader, &v));
+    CHECK(message_get_int32_header(m2, 2003, &v));
+    CHECK(v == 3);
+
+    auto m3 = message_new(nullptr, ContentTypeData, &headers[MSG_INLINE_HDRS], 1, 0);
+    message_set_seq(m3, &seq);
+    CHECK(message_parse_hdrs(m3) == 1);
+    CHECK(m3->hdrs == m3->hdr_table);
+    CHECK(message_get_int32_header(m3, ConnIdHeader, &v));
+    CHECK(v == conn_id);
+
+    pool_return_obj(m1);
+    pool_return_obj(m2);
+    pool_return_obj(m3);
+}
+
+TEST_CASE("message data handed to buffer", "[model]") {
+    auto p = pool_new(sizeof(message) + 200, 1, (void (*)(void *)) message_free);
+
+    const char *content = "message body is consumed from the buffer";
+    auto m = message_new(p, ContentTypeData, nullptr, 0, strlen(content));
+    memcpy(m->body, content, strlen(content));
+
+    auto b = new_buffer();
+    buffer_append_owned(b, m->body, m->header.body_len, message_retain(m), (void (*)(void *)) message_release);
+    CHECK(buffer_owned_chunks(b) == 1);
+
+    // owner's reference is dropped, buffer keeps the message
+    message_release(m);
+    CHECK_FALSE(pool_has_available(p));
+
+    uint8_t *data;
+    ssize_t len = buffer_get_next(b, 1024, &data);
+    CHECK(len == strlen(content));
+    CHECK(strncmp((const char *) data, content, len) == 0);
+
+    buffer_cleanup(b);
+    CHECK(pool_has_available(p));
+    CHECK(buffer_owned_chunks(b) == 0);
+
+    free_buffer(b);
+    pool_destroy(p);
+}
+
+TEST_CASE("outbound size class pools", "[model]") {
+    auto pools = msg_pools_new(1);
+
+    auto small = message_new_out(pools, ContentTypeData, nullptr, 0, 100);
+    auto medium = message_new_out(pools, ContentTypeData, nullptr, 0, 1000);
+    // small class is at capacity
+    auto small2 = message_new_out(pools, ContentTypeData, nullptr, 0, 10);
+    auto huge = message_new_out(pools, ContentTypeData, nullptr, 0, 1024 * 1024);
+    CHECK(huge->header.body_len == 1024 * 1024);
+
+    struct msg_pool_stats stats[MSG_SIZE_CLASSES];
+    uint64_t oversize;
+    msg_pools_stats(pools, stats, &oversize);
+    CHECK(stats[0].hits == 1);
+    CHECK(stats[0].misses == 1);
+    CHECK(stats[0].high_water == 1);
+    CHECK(stats[1].hits == 1);
+    CHECK(stats[2].hits == 0);
+    CHECK(oversize == 1);
+
+    pool_return_obj(small);
+    auto small3 = message_new_out(pools, ContentTypeData, nullptr, 0, 10);
+    msg_pools_stats(pools, stats, &oversize);
+    CHECK(stats[0].hits == 2);
+    CHECK(stats[0].high_water == 1);
+
+    pool_return_obj(small2);
+    pool_return_obj(huge);
+    pool_return_obj(medium);
+
+    // pools are released once outstanding messages are returned
+    msg_pools_free(pools);
+    pool_return_obj(small3);
+}
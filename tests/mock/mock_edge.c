@@ -0,0 +1,914 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "mock_edge.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include <tlsuv/tlsuv.h>
+#include <tlsuv/queue.h>
+
+#include "zt_internal.h"
+#include "e2e_stream.h"
+#include "edge_protocol.h"
+#include "message.h"
+#include "utils.h"
+
+#define MOCK_MAX_ROUTERS 16
+#define MOCK_MAX_SERVICES 64
+#define MOCK_ROUTER_PORT_BASE 30000
+
+#define MOCK_TS "2023-01-01T00:00:00.000Z"
+
+struct bytes {
+    uint8_t *p;
+    size_t len;
+    size_t cap;
+};
+
+static void bytes_append(struct bytes *b, const void *data, size_t len) {
+    if (b->len + len > b->cap) {
+        b->cap = MAX(b->cap * 2, b->len + len);
+        b->p = realloc(b->p, b->cap);
+    }
+    memcpy(b->p + b->len, data, len);
+    b->len += len;
+}
+
+static void put_le32(uint8_t *b, uint32_t v) {
+    b[0] = (uint8_t) v;
+    b[1] = (uint8_t) (v >> 8);
+    b[2] = (uint8_t) (v >> 16);
+    b[3] = (uint8_t) (v >> 24);
+}
+
+static void bytes_consume(struct bytes *b, size_t len) {
+    memmove(b->p, b->p + len, b->len - len);
+    b->len -= len;
+}
+
+struct mock_router_s {
+    char *name;
+    int port;
+    enum mock_router_mode mode;
+    mock_router_stats stats;
+    uint32_t seq;
+    uint64_t e2e_sent; // encrypted Data messages echoed
+    uint64_t corrupt_at; // encrypted Data message to corrupt (1-based), 0 - none
+
+    // latest Bind, target of mock_edge_dial()
+    struct mock_link *bind_link;
+    uint8_t bind_conn_id[4];
+};
+
+// end-to-end encryption state of a connection, router acts as the hosting side
+struct mock_e2e {
+    uint8_t rx[crypto_kx_SESSIONKEYBYTES];
+    uint8_t tx[crypto_kx_SESSIONKEYBYTES];
+    struct e2e_stream in;
+    struct e2e_stream out;
+    bool header_recv;
+};
+
+// channel connected to a mock router
+struct mock_link {
+    ziti_channel_t *ch;
+    struct mock_router_s *router;
+    bool connecting;
+    bool pending;
+    struct bytes in;  // channel => router
+    struct bytes out; // router => channel
+    model_map e2e; // map<conn_id, struct mock_e2e>
+    LIST_ENTRY(mock_link) _next;
+    TAILQ_ENTRY(mock_link) _pending;
+};
+
+struct ctrl_client {
+    uv_tcp_t tcp;
+    mock_edge *m;
+    struct bytes in;
+    LIST_ENTRY(ctrl_client) _next;
+};
+
+struct ctrl_write {
+    uv_write_t req;
+    char *data;
+};
+
+struct mock_edge_s {
+    uv_loop_t *loop;
+    uv_tcp_t server;
+    int port;
+    char *key_pem;
+
+    struct mock_router_s routers[MOCK_MAX_ROUTERS];
+    int num_routers;
+    char *services[MOCK_MAX_SERVICES];
+    bool encrypted[MOCK_MAX_SERVICES];
+    int num_services;
+    char *posture_query; // JSON of posture query required by all services
+    uint32_t session_seq;
+
+    // map<path, uint64_t*>
+    model_map requests;
+
+    LIST_HEAD(, mock_link) links;
+    TAILQ_HEAD(, mock_link) pending;
+    uv_idle_t flusher;
+
+    LIST_HEAD(, ctrl_client) clients;
+    int open_handles;
+};
+
+static const ziti_channel_transport mock_transport;
+
+static void on_handle_close(uv_handle_t *h) {
+    mock_edge *m = h->data;
+    if (--m->open_handles == 0) {
+        model_map_clear(&m->requests, free);
+        for (int i = 0; i < m->num_routers; i++) {
+            free(m->routers[i].name);
+        }
+        for (int i = 0; i < m->num_services; i++) {
+            free(m->services[i]);
+        }
+        free(m->posture_query);
+        free(m->key_pem);
+        free(m);
+    }
+}
+
+/*
+ * edge router
+ */
+
+static void router_send(struct mock_link *l, uint32_t content, const hdr_t *hdrs, int nhdrs,
+                        const uint8_t *body, uint32_t body_len) {
+    header_t h;
+    header_init(&h, l->router->seq++);
+    h.content = content;
+    h.headers_len = 0;
+    for (int i = 0; i < nhdrs; i++) {
+        h.headers_len += 2 * sizeof(uint32_t) + hdrs[i].length;
+    }
+    h.body_len = body_len;
+
+    size_t frame_len = HEADER_SIZE + h.headers_len + body_len;
+    uint8_t *frame = malloc(frame_len);
+    header_to_buffer(&h, frame);
+    uint8_t *p = frame + HEADER_SIZE;
+    for (int i = 0; i < nhdrs; i++) {
+        p = write_hdr(&hdrs[i], p);
+    }
+    if (body_len > 0) {
+        memcpy(p, body, body_len);
+    }
+    bytes_append(&l->out, frame, frame_len);
+    free(frame);
+}
+
+static const hdr_t *find_hdr(const hdr_t *hdrs, int nhdrs, uint32_t id) {
+    for (int i = 0; i < nhdrs; i++) {
+        if (hdrs[i].header_id == id) {
+            return &hdrs[i];
+        }
+    }
+    return NULL;
+}
+
+static void router_reply(struct mock_link *l, uint32_t content, const header_t *req, const hdr_t *hdrs, int nhdrs,
+                         const hdr_t *extra, int nextra, const uint8_t *body, uint32_t body_len) {
+    uint8_t reply_for[4];
+    put_le32(reply_for, req->seq);
+    hdr_t out[8] = {
+            {.header_id = ReplyForHeader, .length = sizeof(reply_for), .value = reply_for},
+    };
+    int n = 1;
+    const hdr_t *conn_id = find_hdr(hdrs, nhdrs, ConnIdHeader);
+    if (conn_id) {
+        out[n++] = *conn_id;
+    }
+    for (int i = 0; i < nextra && n < 8; i++) {
+        out[n++] = extra[i];
+    }
+    router_send(l, content, out, n, body, body_len);
+}
+
+static void mock_e2e_free(void *p) {
+    struct mock_e2e *e = p;
+    e2e_stream_free(&e->in);
+    e2e_stream_free(&e->out);
+    free(e);
+}
+
+static long hdr_conn_id(const hdr_t *hdrs, int nhdrs) {
+    const hdr_t *h = find_hdr(hdrs, nhdrs, ConnIdHeader);
+    if (h == NULL || h->length != sizeof(uint32_t)) {
+        return -1;
+    }
+    return (long) (h->value[0] | h->value[1] << 8 | h->value[2] << 16 | (uint32_t) h->value[3] << 24);
+}
+
+static struct mock_e2e *link_e2e(struct mock_link *l, const hdr_t *hdrs, int nhdrs) {
+    long id = hdr_conn_id(hdrs, nhdrs);
+    return id < 0 ? NULL : model_map_getl(&l->e2e, id);
+}
+
+static void link_e2e_remove(struct mock_link *l, const hdr_t *hdrs, int nhdrs) {
+    long id = hdr_conn_id(hdrs, nhdrs);
+    struct mock_e2e *e = id < 0 ? NULL : model_map_removel(&l->e2e, id);
+    if (e) {
+        mock_e2e_free(e);
+    }
+}
+
+// Connect with dialer's key is answered with router's key, as the hosting SDK would
+static void router_connect(struct mock_link *l, const header_t *h, const hdr_t *hdrs, int nhdrs) {
+    const hdr_t *peer_key = find_hdr(hdrs, nhdrs, PublicKeyHeader);
+    long id = hdr_conn_id(hdrs, nhdrs);
+    if (peer_key == NULL || peer_key->length != crypto_kx_PUBLICKEYBYTES || id < 0) {
+        router_reply(l, ContentTypeStateConnected, h, hdrs, nhdrs, NULL, 0, NULL, 0);
+        return;
+    }
+
+    uint8_t pk[crypto_kx_PUBLICKEYBYTES];
+    uint8_t sk[crypto_kx_SECRETKEYBYTES];
+    struct mock_e2e *e = calloc(1, sizeof(*e));
+    crypto_kx_keypair(pk, sk);
+    crypto_kx_server_session_keys(e->rx, e->tx, pk, sk, peer_key->value);
+    link_e2e_remove(l, hdrs, nhdrs);
+    model_map_setl(&l->e2e, id, e);
+
+    hdr_t key = {.header_id = PublicKeyHeader, .length = sizeof(pk), .value = pk};
+    router_reply(l, ContentTypeStateConnected, h, hdrs, nhdrs, &key, 1, NULL, 0);
+}
+
+static void router_send_data(struct mock_link *l, const hdr_t *hdrs, int nhdrs, const uint8_t *body, uint32_t len) {
+    const hdr_t *conn_id = find_hdr(hdrs, nhdrs, ConnIdHeader);
+    uint8_t seq[4];
+    put_le32(seq, l->router->seq);
+    hdr_t out[2] = {
+            {.header_id = SeqHeader, .length = sizeof(seq), .value = seq},
+            *conn_id,
+    };
+    router_send(l, ContentTypeData, out, 2, body, len);
+}
+
+// decrypt and echo encrypted data, dialer's crypto header is answered with router's
+static void router_e2e_echo(struct mock_link *l, struct mock_e2e *e, const hdr_t *hdrs, int nhdrs,
+                            const uint8_t *body, uint32_t len) {
+    struct mock_router_s *r = l->router;
+    if (!e->header_recv) {
+        if (len != E2E_HEADER_BYTES || e2e_init_pull(&e->in, body, e->rx, false) != 0) {
+            return;
+        }
+        e->header_recv = true;
+
+        uint8_t header[E2E_HEADER_BYTES];
+        e2e_init_push(&e->out, header, e->tx, false);
+        router_send_data(l, hdrs, nhdrs, header, sizeof(header));
+        return;
+    }
+
+    uint8_t *plain = malloc(len);
+    size_t plain_len = 0;
+    if (e2e_pull(&e->in, plain, &plain_len, body, len) == 0 && plain_len > 0) {
+        uint8_t *c = malloc(plain_len + E2E_ABYTES);
+        e2e_push(&e->out, c, plain, plain_len);
+        if (++r->e2e_sent == r->corrupt_at) {
+            c[plain_len / 2 + 1] ^= 0xff;
+        }
+        router_send_data(l, hdrs, nhdrs, c, (uint32_t) (plain_len + E2E_ABYTES));
+        free(c);
+    }
+    free(plain);
+}
+
+static void router_process(struct mock_link *l, const header_t *h, uint8_t *headers, const uint8_t *body) {
+    struct mock_router_s *r = l->router;
+    hdr_t *hdrs = NULL;
+    int nhdrs = parse_hdrs(headers, h->headers_len, &hdrs);
+    uint8_t success = 1;
+    hdr_t ok = {.header_id = ResultSuccessHeader, .length = 1, .value = &success};
+
+    switch (h->content) {
+        case ContentTypeHelloType: {
+            r->stats.hellos++;
+            hdr_t extra[] = {
+                    ok,
+                    {.header_id = HelloVersionHeader, .length = strlen("mock"), .value = (uint8_t *) "mock"},
+            };
+            router_reply(l, ContentTypeResultType, h, hdrs, nhdrs, extra, 2, NULL, 0);
+            break;
+        }
+        case ContentTypeLatencyType: {
+            r->stats.latency_probes++;
+            const hdr_t *ts = find_hdr(hdrs, nhdrs, LatencyProbeTime);
+            hdr_t extra[] = {ok, ts ? *ts : ok};
+            router_reply(l, ContentTypeResultType, h, hdrs, nhdrs, extra, ts ? 2 : 1, NULL, 0);
+            break;
+        }
+        case ContentTypeConnect:
+            r->stats.connects++;
+            if (r->mode != MockRouterStall) {
+                router_connect(l, h, hdrs, nhdrs);
+            }
+            break;
+        case ContentTypeBind: {
+            r->stats.binds++;
+            const hdr_t *conn_id = find_hdr(hdrs, nhdrs, ConnIdHeader);
+            if (conn_id && conn_id->length == sizeof(r->bind_conn_id)) {
+                r->bind_link = l;
+                memcpy(r->bind_conn_id, conn_id->value, sizeof(r->bind_conn_id));
+            }
+            if (r->mode != MockRouterStall) {
+                router_reply(l, ContentTypeStateConnected, h, hdrs, nhdrs, NULL, 0, NULL, 0);
+            }
+            break;
+        }
+        case ContentTypeUnbind:
+            r->stats.unbinds++;
+            if (r->bind_link == l) {
+                r->bind_link = NULL;
+            }
+            router_reply(l, ContentTypeResultType, h, hdrs, nhdrs, &ok, 1, NULL, 0);
+            break;
+        case ContentTypeUpdateBind:
+            router_reply(l, ContentTypeResultType, h, hdrs, nhdrs, &ok, 1, NULL, 0);
+            break;
+        case ContentTypeDialSuccess:
+            r->stats.dials_accepted++;
+            router_reply(l, ContentTypeStateConnected, h, hdrs, nhdrs, NULL, 0, NULL, 0);
+            break;
+        case ContentTypeDialFailed:
+            r->stats.dials_failed++;
+            break;
+        case ContentTypeData: {
+            r->stats.data_msgs++;
+            r->stats.data_bytes += h->body_len;
+            struct mock_e2e *e2e = link_e2e(l, hdrs, nhdrs);
+            if (r->mode == MockRouterEcho && e2e != NULL && h->body_len > 0) {
+                router_e2e_echo(l, e2e, hdrs, nhdrs, body, h->body_len);
+            } else if (r->mode == MockRouterEcho) {
+                const hdr_t *conn_id = find_hdr(hdrs, nhdrs, ConnIdHeader);
+                const hdr_t *flags = find_hdr(hdrs, nhdrs, FlagsHeader);
+                uint8_t seq[4];
+                put_le32(seq, r->seq);
+                hdr_t out[3] = {
+                        {.header_id = SeqHeader, .length = sizeof(seq), .value = seq},
+                };
+                int n = 1;
+                if (conn_id) out[n++] = *conn_id;
+                if (flags) out[n++] = *flags;
+                router_send(l, ContentTypeData, out, n, body, h->body_len);
+            }
+            break;
+        }
+        case ContentTypeStateClosed:
+            r->stats.closes++;
+            r->stats.close_data_msgs = r->stats.data_msgs;
+            link_e2e_remove(l, hdrs, nhdrs);
+            break;
+        default:
+            break;
+    }
+    free(hdrs);
+}
+
+static void on_flush(uv_idle_t *fl);
+
+static void link_schedule(mock_edge *m, struct mock_link *l) {
+    if (!l->pending) {
+        l->pending = true;
+        TAILQ_INSERT_TAIL(&m->pending, l, _pending);
+        uv_idle_start(&m->flusher, on_flush);
+    }
+}
+
+static struct mock_link *find_link(mock_edge *m, ziti_channel_t *ch) {
+    struct mock_link *l;
+    LIST_FOREACH(l, &m->links, _next) {
+        if (l->ch == ch) return l;
+    }
+    return NULL;
+}
+
+static void link_free(mock_edge *m, struct mock_link *l) {
+    if (l->pending) {
+        TAILQ_REMOVE(&m->pending, l, _pending);
+    }
+    LIST_REMOVE(l, _next);
+    if (!l->connecting) {
+        l->router->stats.links--;
+    }
+    if (l->router->bind_link == l) {
+        l->router->bind_link = NULL;
+    }
+    model_map_clear(&l->e2e, mock_e2e_free);
+    free(l->in.p);
+    free(l->out.p);
+    free(l);
+}
+
+static int mock_connect(void *ctx, ziti_channel_t *ch, const char *host, int port) {
+    mock_edge *m = ctx;
+    struct mock_router_s *r = NULL;
+    for (int i = 0; i < m->num_routers; i++) {
+        if (m->routers[i].port == port) {
+            r = &m->routers[i];
+        }
+    }
+    if (r == NULL) {
+        return UV_ECONNREFUSED;
+    }
+
+    struct mock_link *old = find_link(m, ch);
+    if (old) {
+        link_free(m, old);
+    }
+
+    struct mock_link *l = calloc(1, sizeof(*l));
+    l->ch = ch;
+    l->router = r;
+    l->connecting = true;
+    LIST_INSERT_HEAD(&m->links, l, _next);
+    link_schedule(m, l);
+    return 0;
+}
+
+static int mock_write(void *ctx, ziti_channel_t *ch, const uint8_t *data, size_t len) {
+    mock_edge *m = ctx;
+    struct mock_link *l = find_link(m, ch);
+    if (l == NULL) {
+        return UV_ENOTCONN;
+    }
+
+    l->router->stats.writes++;
+    bytes_append(&l->in, data, len);
+    while (l->in.len >= HEADER_SIZE) {
+        header_t h;
+        header_from_buffer(&h, l->in.p);
+        size_t frame_len = HEADER_SIZE + (size_t) h.headers_len + h.body_len;
+        if (l->in.len < frame_len) {
+            break;
+        }
+        uint8_t *headers = l->in.p + HEADER_SIZE;
+        router_process(l, &h, headers, headers + h.headers_len);
+        bytes_consume(&l->in, frame_len);
+    }
+
+    if (l->out.len > 0) {
+        link_schedule(m, l);
+    }
+    return 0;
+}
+
+static void mock_close(void *ctx, ziti_channel_t *ch) {
+    mock_edge *m = ctx;
+    struct mock_link *l = find_link(m, ch);
+    if (l) {
+        link_free(m, l);
+    }
+}
+
+static const ziti_channel_transport mock_transport = {
+        .connect = mock_connect,
+        .write = mock_write,
+        .close = mock_close,
+};
+
+// deliver connect completions and router output, channel callbacks may close (and free) the link
+static void on_flush(uv_idle_t *fl) {
+    mock_edge *m = fl->data;
+    uv_idle_stop(fl);
+
+    struct mock_link *l;
+    while ((l = TAILQ_FIRST(&m->pending)) != NULL) {
+        TAILQ_REMOVE(&m->pending, l, _pending);
+        l->pending = false;
+        ziti_channel_t *ch = l->ch;
+
+        if (l->connecting) {
+            l->connecting = false;
+            l->router->stats.links++;
+            if (l->out.len > 0) {
+                link_schedule(m, l);
+            }
+            ziti_channel_transport_connected(ch, 0);
+            continue;
+        }
+
+        struct bytes out = l->out;
+        memset(&l->out, 0, sizeof(l->out));
+        if (out.len > 0) {
+            ziti_channel_transport_input(ch, out.p, (ssize_t) out.len);
+        }
+        free(out.p);
+    }
+}
+
+void mock_edge_drop_links(mock_edge *m) {
+    struct mock_link *l;
+    while ((l = LIST_FIRST(&m->links)) != NULL) {
+        ziti_channel_t *ch = l->ch;
+        bool connecting = l->connecting;
+        link_free(m, l);
+        if (connecting) {
+            ziti_channel_transport_connected(ch, UV_ECONNRESET);
+        } else {
+            ziti_channel_transport_input(ch, NULL, UV_EOF);
+        }
+    }
+}
+
+/*
+ * controller
+ */
+
+static void count_request(mock_edge *m, const char *path) {
+    size_t len = strcspn(path, "?");
+    char key[256];
+    snprintf(key, sizeof(key), "%.*s", (int) MIN(len, sizeof(key) - 1), path);
+    uint64_t *c = model_map_get(&m->requests, key);
+    if (c == NULL) {
+        c = calloc(1, sizeof(*c));
+        model_map_set(&m->requests, key, c);
+    }
+    (*c)++;
+}
+
+static void routers_json(mock_edge *m, string_buf_t *b) {
+    string_buf_append(b, "[");
+    for (int i = 0; i < m->num_routers; i++) {
+        string_buf_fmt(b, "%s{\"name\":\"%s\",\"hostname\":\"127.0.0.1\","
+                          "\"supportedProtocols\":{\"tls\":\"tls://127.0.0.1:%d\"}}",
+                       i > 0 ? "," : "", m->routers[i].name, m->routers[i].port);
+    }
+    string_buf_append(b, "]");
+}
+
+static void services_json(mock_edge *m, string_buf_t *b) {
+    string_buf_append(b, "[");
+    for (int i = 0; i < m->num_services; i++) {
+        string_buf_fmt(b, "%s{\"id\":\"svc-%d\",\"name\":\"%s\",\"permissions\":[\"Dial\",\"Bind\"],"
+                          "\"encryptionRequired\":%s,\"config\":{},",
+                       i > 0 ? "," : "", i, m->services[i], m->encrypted[i] ? "true" : "false");
+        if (m->posture_query) {
+            string_buf_fmt(b, "\"postureQueries\":[%s],\"posturePolicies\":{\"mock-policy\":%s},",
+                           m->posture_query, m->posture_query);
+        } else {
+            string_buf_append(b, "\"postureQueries\":[],");
+        }
+        string_buf_append(b, "\"updatedAt\":\"" MOCK_TS "\"}");
+    }
+    string_buf_append(b, "]");
+}
+
+static void list_meta(string_buf_t *b, int count) {
+    string_buf_fmt(b, ",\"meta\":{\"pagination\":{\"limit\":%d,\"offset\":0,\"totalCount\":%d}}", MAX(count, 1), count);
+}
+
+static bool starts_with(const char *path, const char *prefix) {
+    return strncmp(path, prefix, strlen(prefix)) == 0;
+}
+
+static bool path_is(const char *path, const char *p) {
+    size_t len = strlen(p);
+    return strncmp(path, p, len) == 0 && (path[len] == '\0' || path[len] == '?');
+}
+
+static bool body_contains(const char *body, size_t len, const char *s) {
+    size_t slen = strlen(s);
+    for (size_t i = 0; i + slen <= len; i++) {
+        if (memcmp(body + i, s, slen) == 0) return true;
+    }
+    return false;
+}
+
+// returns HTTP status, response JSON is written into [b]
+static int ctrl_handle(mock_edge *m, const char *method, const char *path, const char *body, size_t body_len,
+                       string_buf_t *b) {
+    count_request(m, path);
+
+    if (path_is(path, "/version")) {
+        string_buf_append(b, "{\"data\":{\"version\":\"v0.0.0-mock\",\"revision\":\"mock\","
+                             "\"buildDate\":\"" MOCK_TS "\"},\"meta\":{}}");
+    } else if (path_is(path, "/authenticate") ||
+               (path_is(path, "/current-api-session") && strcmp(method, "GET") == 0)) {
+        string_buf_append(b, "{\"data\":{\"id\":\"mock-api-session\",\"token\":\"mock-api-token\","
+                             "\"expiresAt\":\"2099-01-01T00:00:00.000Z\",\"expirationSeconds\":3600,"
+                             "\"updatedAt\":\"" MOCK_TS "\",\"cachedLastActivityAt\":\"" MOCK_TS "\","
+                             "\"identity\":{\"id\":\"mock-id\",\"name\":\"mock-identity\"},"
+                             "\"authQueries\":[]},\"meta\":{}}");
+    } else if (path_is(path, "/current-api-session")) {
+        string_buf_append(b, "{\"data\":{},\"meta\":{}}");
+    } else if (path_is(path, "/current-api-session/service-updates")) {
+        string_buf_append(b, "{\"data\":{\"lastChangeAt\":\"" MOCK_TS "\"},\"meta\":{}}");
+    } else if (path_is(path, "/current-identity")) {
+        string_buf_append(b, "{\"data\":{\"id\":\"mock-id\",\"name\":\"mock-identity\",\"appData\":{}},\"meta\":{}}");
+    } else if (path_is(path, "/current-identity/edge-routers")) {
+        string_buf_append(b, "{\"data\":");
+        routers_json(m, b);
+        list_meta(b, m->num_routers);
+        string_buf_append(b, "}");
+    } else if (path_is(path, "/services")) {
+        string_buf_append(b, "{\"data\":");
+        services_json(m, b);
+        list_meta(b, m->num_services);
+        string_buf_append(b, "}");
+    } else if (path_is(path, "/sessions") && strcmp(method, "POST") == 0) {
+        uint32_t id = m->session_seq++;
+        string_buf_fmt(b, "{\"data\":{\"id\":\"session-%u\",\"token\":\"token-%u\",\"type\":\"%s\","
+                          "\"edgeRouters\":", id, id,
+                       body_contains(body, body_len, "Bind") ? "Bind" : "Dial");
+        routers_json(m, b);
+        string_buf_append(b, "},\"meta\":{}}");
+    } else if (path_is(path, "/sessions")) {
+        string_buf_append(b, "{\"data\":[]");
+        list_meta(b, 0);
+        string_buf_append(b, "}");
+    } else if (starts_with(path, "/posture-response")) {
+        string_buf_append(b, "{\"data\":{},\"meta\":{}}");
+    } else {
+        string_buf_fmt(b, "{\"error\":{\"code\":\"NOT_FOUND\",\"message\":\"%s %s is not mocked\"},\"meta\":{}}",
+                       method, path);
+        return 404;
+    }
+    return 200;
+}
+
+static void on_ctrl_write(uv_write_t *req, int status) {
+    struct ctrl_write *w = (struct ctrl_write *) req;
+    free(w->data);
+    free(w);
+}
+
+static void ctrl_client_close(struct ctrl_client *c) {
+    if (!uv_is_closing((uv_handle_t *) &c->tcp)) {
+        LIST_REMOVE(c, _next);
+        uv_close((uv_handle_t *) &c->tcp, (uv_close_cb) free);
+        free(c->in.p);
+        c->in.p = NULL;
+    }
+}
+
+static size_t content_length(const char *hdrs, size_t len) {
+    const char *p = hdrs;
+    const char *end = hdrs + len;
+    while (p < end) {
+        const char *eol = p;
+        while (eol < end && *eol != '\n') eol++;
+        if (eol - p > 15 && strncasecmp(p, "Content-Length:", 15) == 0) {
+            return strtoul(p + 15, NULL, 10);
+        }
+        p = eol + 1;
+    }
+    return 0;
+}
+
+static void ctrl_process(struct ctrl_client *c) {
+    while (c->in.len > 0) {
+        size_t hdr_len = 0;
+        for (size_t i = 0; i + 4 <= c->in.len; i++) {
+            if (memcmp(c->in.p + i, "\r\n\r\n", 4) == 0) {
+                hdr_len = i + 4;
+                break;
+            }
+        }
+        if (hdr_len == 0) {
+            return;
+        }
+
+        const char *req = (const char *) c->in.p;
+        size_t body_len = content_length(req, hdr_len);
+        if (c->in.len < hdr_len + body_len) {
+            return;
+        }
+
+        char method[16] = "";
+        char path[1024] = "";
+        sscanf(req, "%15s %1023s", method, path);
+
+        string_buf_t *b = new_string_buf();
+        int code = ctrl_handle(c->m, method, path, req + hdr_len, body_len, b);
+        size_t json_len;
+        char *json = string_buf_to_string(b, &json_len);
+        delete_string_buf(b);
+
+        struct ctrl_write *w = calloc(1, sizeof(*w));
+        size_t resp_max = json_len + 256;
+        w->data = malloc(resp_max);
+        int resp_len = snprintf(w->data, resp_max,
+                                "HTTP/1.1 %d %s\r\n"
+                                "Content-Type: application/json\r\n"
+                                "Content-Length: %zd\r\n"
+                                "\r\n%s", code, code == 200 ? "OK" : "Not Found", json_len, json);
+        free(json);
+
+        uv_buf_t buf = uv_buf_init(w->data, resp_len);
+        if (uv_write(&w->req, (uv_stream_t *) &c->tcp, &buf, 1, on_ctrl_write) != 0) {
+            free(w->data);
+            free(w);
+        }
+        bytes_consume(&c->in, hdr_len + body_len);
+    }
+}
+
+static void ctrl_alloc(uv_handle_t *h, size_t suggested, uv_buf_t *buf) {
+    buf->base = malloc(suggested);
+    buf->len = suggested;
+}
+
+static void ctrl_read(uv_stream_t *s, ssize_t len, const uv_buf_t *buf) {
+    struct ctrl_client *c = s->data;
+    if (len < 0) {
+        ctrl_client_close(c);
+    } else if (len > 0) {
+        bytes_append(&c->in, buf->base, (size_t) len);
+        ctrl_process(c);
+    }
+    free(buf->base);
+}
+
+static void on_ctrl_connection(uv_stream_t *server, int status) {
+    mock_edge *m = server->data;
+    if (status != 0) {
+        return;
+    }
+
+    struct ctrl_client *c = calloc(1, sizeof(*c));
+    c->m = m;
+    uv_tcp_init(m->loop, &c->tcp);
+    c->tcp.data = c;
+    if (uv_accept(server, (uv_stream_t *) &c->tcp) != 0) {
+        uv_close((uv_handle_t *) &c->tcp, (uv_close_cb) free);
+        return;
+    }
+    LIST_INSERT_HEAD(&m->clients, c, _next);
+    uv_read_start((uv_stream_t *) &c->tcp, ctrl_alloc, ctrl_read);
+}
+
+/*
+ * harness
+ */
+
+mock_edge *mock_edge_new(uv_loop_t *loop) {
+    mock_edge *m = calloc(1, sizeof(*m));
+    m->loop = loop;
+    LIST_INIT(&m->links);
+    TAILQ_INIT(&m->pending);
+    LIST_INIT(&m->clients);
+
+    struct sockaddr_in addr;
+    uv_ip4_addr("127.0.0.1", 0, &addr);
+    uv_tcp_init(loop, &m->server);
+    m->server.data = m;
+    m->open_handles++;
+    if (uv_tcp_bind(&m->server, (const struct sockaddr *) &addr, 0) != 0 ||
+        uv_listen((uv_stream_t *) &m->server, 128, on_ctrl_connection) != 0) {
+        ZITI_LOG(ERROR, "mock controller failed to listen");
+    }
+
+    struct sockaddr_storage bound;
+    int len = sizeof(bound);
+    uv_tcp_getsockname(&m->server, (struct sockaddr *) &bound, &len);
+    m->port = ntohs(((struct sockaddr_in *) &bound)->sin_port);
+
+    uv_idle_init(loop, &m->flusher);
+    m->flusher.data = m;
+    m->open_handles++;
+    return m;
+}
+
+int mock_edge_add_router(mock_edge *m, const char *name) {
+    if (m->num_routers == MOCK_MAX_ROUTERS) {
+        return -1;
+    }
+    struct mock_router_s *r = &m->routers[m->num_routers];
+    r->name = strdup(name);
+    r->port = MOCK_ROUTER_PORT_BASE + m->num_routers;
+    r->mode = MockRouterEcho;
+    return m->num_routers++;
+}
+
+void mock_edge_add_service(mock_edge *m, const char *name) {
+    if (m->num_services < MOCK_MAX_SERVICES) {
+        m->services[m->num_services++] = strdup(name);
+    }
+}
+
+void mock_edge_add_encrypted_service(mock_edge *m, const char *name) {
+    if (m->num_services < MOCK_MAX_SERVICES) {
+        m->encrypted[m->num_services] = true;
+        m->services[m->num_services++] = strdup(name);
+    }
+}
+
+void mock_edge_corrupt_data(mock_edge *m, int router, uint64_t nth) {
+    m->routers[router].corrupt_at = nth;
+}
+
+void mock_edge_set_posture_query(mock_edge *m, const char *type, const char *process) {
+    string_buf_t *b = new_string_buf();
+    string_buf_fmt(b, "{\"policyId\":\"mock-policy\",\"isPassing\":false,\"policyType\":\"Dial\","
+                      "\"postureQueries\":[{\"id\":\"mock-query\",\"isPassing\":false,\"queryType\":\"%s\",",
+                   type);
+    if (process) {
+        string_buf_fmt(b, "\"process\":{\"path\":\"%s\"},", process);
+    }
+    string_buf_append(b, "\"timeout\":-1,\"updatedAt\":\"" MOCK_TS "\"}]}");
+    free(m->posture_query);
+    m->posture_query = string_buf_to_string(b, NULL);
+    delete_string_buf(b);
+}
+
+int mock_edge_dial(mock_edge *m, int router) {
+    struct mock_router_s *r = &m->routers[router];
+    struct mock_link *l = r->bind_link;
+    if (l == NULL) {
+        return -1;
+    }
+
+    hdr_t hdrs[] = {
+            {.header_id = ConnIdHeader, .length = sizeof(r->bind_conn_id), .value = r->bind_conn_id},
+    };
+    r->stats.dials++;
+    router_send(l, ContentTypeDial, hdrs, 1, NULL, 0);
+    link_schedule(m, l);
+    return 0;
+}
+
+void mock_edge_set_router_mode(mock_edge *m, int router, enum mock_router_mode mode) {
+    m->routers[router].mode = mode;
+}
+
+int mock_edge_config(mock_edge *m, ziti_config *cfg) {
+    if (m->key_pem == NULL) {
+        tls_context *tls = default_tls_context(NULL, 0);
+        tlsuv_private_key_t pk = NULL;
+        size_t len;
+        int rc = tls->generate_key(&pk);
+        if (rc == 0) {
+            rc = pk->to_pem(pk, &m->key_pem, &len);
+            pk->free(pk);
+        }
+        tls->free_ctx(tls);
+        if (rc != 0) {
+            return ZITI_KEY_GENERATION_FAILED;
+        }
+    }
+
+    char url[64];
+    snprintf(url, sizeof(url), "http://127.0.0.1:%d", m->port);
+    memset(cfg, 0, sizeof(*cfg));
+    cfg->controller_url = strdup(url);
+    cfg->id.key = strdup(m->key_pem);
+    return ZITI_OK;
+}
+
+void mock_edge_attach(mock_edge *m, ziti_context ztx) {
+    ziti_set_channel_transport(ztx, &mock_transport, m);
+}
+
+void mock_edge_router_stats(mock_edge *m, int router, mock_router_stats *stats) {
+    *stats = m->routers[router].stats;
+}
+
+uint64_t mock_edge_ctrl_requests(mock_edge *m, const char *path_prefix) {
+    uint64_t total = 0;
+    const char *path;
+    uint64_t *count;
+    MODEL_MAP_FOREACH(path, count, &m->requests) {
+        if (starts_with(path, path_prefix)) {
+            total += *count;
+        }
+    }
+    return total;
+}
+
+void mock_edge_free(mock_edge *m) {
+    struct mock_link *l;
+    while ((l = LIST_FIRST(&m->links)) != NULL) {
+        link_free(m, l);
+    }
+    while (!LIST_EMPTY(&m->clients)) {
+        ctrl_client_close(LIST_FIRST(&m->clients));
+    }
+
+    uv_close((uv_handle_t *) &m->flusher, on_handle_close);
+    uv_close((uv_handle_t *) &m->server, on_handle_close);
+}
@@ -0,0 +1,112 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef ZITI_SDK_MOCK_EDGE_H
+#define ZITI_SDK_MOCK_EDGE_H
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <uv.h>
+#include <ziti/ziti.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * Loopback test harness: synthetic controller and edge routers in the test process.
+ *
+ * The controller is a plain HTTP server on 127.0.0.1 answering the endpoints used by ziti_ctrl.c
+ * with canned data (one identity, configured services and routers, sessions on request).
+ * Edge routers are not listening sockets: channels of an attached context are routed
+ * through ziti_channel_transport into router logic that speaks the channel protocol
+ * (Hello, latency probes, Connect/Bind, Data, Close), so TLS is not involved.
+ */
+typedef struct mock_edge_s mock_edge;
+
+enum mock_router_mode {
+    MockRouterEcho, // Data is sent back on the same connection
+    MockRouterSink, // Data is counted and dropped
+    MockRouterStall, // Connect/Bind requests are not answered
+};
+
+typedef struct mock_router_stats_s {
+    uint64_t writes; // channel writes from the SDK, each may carry several messages
+    uint64_t hellos;
+    uint64_t latency_probes;
+    uint64_t connects;
+    uint64_t binds;
+    uint64_t data_msgs;
+    uint64_t data_bytes;
+    uint64_t closes;
+    uint64_t close_data_msgs; // data_msgs when the last StateClosed arrived
+    uint64_t unbinds;
+    uint64_t dials; // sent with mock_edge_dial()
+    uint64_t dials_accepted; // DialSuccess from hosting SDK
+    uint64_t dials_failed; // DialFailed from hosting SDK
+    size_t links; // connected channels
+} mock_router_stats;
+
+/** start controller listener on [loop] */
+mock_edge *mock_edge_new(uv_loop_t *loop);
+
+/** add edge router, returns its index */
+int mock_edge_add_router(mock_edge *m, const char *name);
+
+/** add service the identity can dial and bind */
+void mock_edge_add_service(mock_edge *m, const char *name);
+
+/**
+ * add service that requires end-to-end encryption.
+ * routers in echo mode act as the hosting side: they complete key exchange, decrypt and echo data encrypted
+ * for the dialer. AES-256-GCM is not offered, streams stay on xchacha20poly1305
+ */
+void mock_edge_add_encrypted_service(mock_edge *m, const char *name);
+
+/** flip a byte in the [nth] (1-based) encrypted Data message echoed by [router] */
+void mock_edge_corrupt_data(mock_edge *m, int router, uint64_t nth);
+
+void mock_edge_set_router_mode(mock_edge *m, int router, enum mock_router_mode mode);
+
+/** all services require posture query of [type] (e.g. "MAC", "PROCESS"), [process] is the path for "PROCESS" */
+void mock_edge_set_posture_query(mock_edge *m, const char *type, const char *process);
+
+/**
+ * send Dial to the latest binding on [router], as if a client dialed the hosted service.
+ * @return -1 if nothing is bound on [router]
+ */
+int mock_edge_dial(mock_edge *m, int router);
+
+/** fill in controller URL and generated identity key */
+int mock_edge_config(mock_edge *m, ziti_config *cfg);
+
+/** route channels of [ztx] to mock routers, call before ziti_context_run() */
+void mock_edge_attach(mock_edge *m, ziti_context ztx);
+
+void mock_edge_router_stats(mock_edge *m, int router, mock_router_stats *stats);
+
+/** number of requests the controller received for paths starting with [path_prefix] */
+uint64_t mock_edge_ctrl_requests(mock_edge *m, const char *path_prefix);
+
+/** disconnect all router links (as if routers went away) */
+void mock_edge_drop_links(mock_edge *m);
+
+/** close listener and handles, [m] is freed once they are closed */
+void mock_edge_free(mock_edge *m);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif //ZITI_SDK_MOCK_EDGE_H
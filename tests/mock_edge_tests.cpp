@@ -0,0 +1,1922 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "catch2_includes.hpp"
+#include "mock_edge.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <algorithm>
+#include <cstring>
+#include <vector>
+
+#if !defined(_WIN32)
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#endif
+
+#include <ziti/ziti.h>
+
+static const char *const ECHO_SERVICE = "mock-echo";
+
+// a test that does not complete in time fails instead of hanging uv_run()
+#define MOCK_TEST_TIMEOUT 30000
+// time given to contexts to close their channels before routers go away
+#define MOCK_TEARDOWN_DELAY 500
+
+/**
+ * Contexts running against a mock edge with ECHO_SERVICE, on a private loop.
+ * Test is driven from [on_ready], called for each context once the service is available,
+ * and ends with mock_harness_finish().
+ */
+struct mock_harness {
+    uv_loop_t *loop;
+    mock_edge *mock;
+    std::vector<ziti_context> contexts;
+    std::vector<bool> ready;
+    uv_timer_t teardown;
+    uv_timer_t watchdog;
+    bool finishing;
+    bool timed_out;
+
+    void *test; // test state, see mock_test_state()
+    void (*on_ready)(mock_harness *h, ziti_context ztx);
+};
+
+template<typename T>
+static T *mock_test_state(ziti_context ztx) {
+    return (T *) ((mock_harness *) ziti_app_ctx(ztx))->test;
+}
+
+static void mock_harness_finish(mock_harness *h) {
+    if (h->finishing) {
+        return;
+    }
+    h->finishing = true;
+    uv_timer_stop(&h->watchdog);
+
+    for (auto ztx: h->contexts) {
+        ziti_shutdown(ztx);
+    }
+    uv_timer_start(&h->teardown, [](uv_timer_t *t) {
+        auto h = (mock_harness *) t->data;
+        mock_edge_free(h->mock);
+        uv_close((uv_handle_t *) &h->teardown, nullptr);
+        uv_close((uv_handle_t *) &h->watchdog, nullptr);
+    }, MOCK_TEARDOWN_DELAY, 0);
+}
+
+static void mock_harness_watchdog(uv_timer_t *t) {
+    auto h = (mock_harness *) t->data;
+    h->timed_out = true;
+    if (h->finishing) {
+        // teardown is stuck as well
+        uv_stop(h->loop);
+        return;
+    }
+    mock_harness_finish(h);
+    uv_timer_start(&h->watchdog, mock_harness_watchdog, MOCK_TEST_TIMEOUT / 10, 0);
+}
+
+static void mock_harness_event(ziti_context ztx, const ziti_event_t *ev) {
+    auto h = (mock_harness *) ziti_app_ctx(ztx);
+    if (ev->type != ZitiServiceEvent || h->on_ready == nullptr || h->finishing) {
+        return;
+    }
+
+    size_t idx = 0;
+    while (h->contexts[idx] != ztx) idx++;
+    for (int i = 0; !h->ready[idx] && ev->event.service.added && ev->event.service.added[i]; i++) {
+        if (strcmp(ev->event.service.added[i]->name, ECHO_SERVICE) == 0) {
+            h->ready[idx] = true;
+            h->on_ready(h, ztx);
+        }
+    }
+}
+
+static void mock_harness_init(mock_harness &h, void *test, int routers, uint64_t timeout = MOCK_TEST_TIMEOUT) {
+    h.test = test;
+    h.loop = uv_loop_new();
+    h.mock = mock_edge_new(h.loop);
+    for (int i = 0; i < routers; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "mock-router-%d", i);
+        mock_edge_add_router(h.mock, name);
+    }
+    mock_edge_add_service(h.mock, ECHO_SERVICE);
+
+    uv_timer_init(h.loop, &h.teardown);
+    h.teardown.data = &h;
+    uv_timer_init(h.loop, &h.watchdog);
+    h.watchdog.data = &h;
+    uv_timer_start(&h.watchdog, mock_harness_watchdog, timeout, 0);
+}
+
+// [opts] app_ctx and event callback are set by harness
+static ziti_context mock_harness_add_context(mock_harness &h, ziti_options opts) {
+    ziti_context ztx;
+    ziti_config cfg;
+    REQUIRE(mock_edge_config(h.mock, &cfg) == ZITI_OK);
+    REQUIRE(ziti_context_init(&ztx, &cfg) == ZITI_OK);
+    free_ziti_config(&cfg);
+    mock_edge_attach(h.mock, ztx);
+
+    opts.app_ctx = &h;
+    opts.events |= ZitiServiceEvent;
+    opts.event_cb = mock_harness_event;
+    REQUIRE(ziti_context_set_options(ztx, &opts) == ZITI_OK);
+
+    h.contexts.push_back(ztx);
+    h.ready.push_back(false);
+    return ztx;
+}
+
+static void mock_harness_run(mock_harness &h) {
+    for (auto ztx: h.contexts) {
+        REQUIRE(ziti_context_run(ztx, h.loop) == ZITI_OK);
+    }
+    uv_run(h.loop, UV_RUN_DEFAULT);
+
+    CHECK_FALSE(h.timed_out);
+    // stuck test may leave active handles behind, its loop is leaked
+    if (!h.timed_out) {
+        uv_loop_delete(h.loop);
+    }
+}
+
+struct echo_load {
+    mock_harness h;
+    ziti_context ztx;
+
+    int conns;
+    int msgs; // per connection
+    std::vector<uint8_t> payload;
+    ziti_dial_opts *dial_opts;
+    int stall_router; // index of router not answering Connect requests, -1 for none
+    uint64_t timeout;
+
+    int connected;
+    int completed;
+    int failed;
+    int closed;
+    uint64_t start;
+    uint64_t all_connected;
+    uint64_t done;
+    ziti_path_stats path;
+};
+
+struct echo_conn {
+    echo_load *load;
+    size_t expect;
+    size_t received;
+};
+
+static void echo_finish(echo_load *l) {
+    l->done = uv_now(l->h.loop);
+    ziti_get_path_stats(l->ztx, &l->path);
+    mock_harness_finish(&l->h);
+}
+
+static void echo_closed(ziti_connection conn) {
+    auto c = (echo_conn *) ziti_conn_data(conn);
+    auto l = c->load;
+    delete c;
+    if (++l->closed == l->conns) {
+        echo_finish(l);
+    }
+}
+
+static ssize_t echo_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto c = (echo_conn *) ziti_conn_data(conn);
+    if (len < 0) {
+        if (c->received < c->expect) {
+            c->load->failed++;
+        }
+        ziti_close(conn, echo_closed);
+        return 0;
+    }
+
+    c->received += len;
+    if (c->received == c->expect) {
+        c->load->completed++;
+        ziti_close(conn, echo_closed);
+    }
+    return len;
+}
+
+static void echo_connected(ziti_connection conn, int status) {
+    auto c = (echo_conn *) ziti_conn_data(conn);
+    auto l = c->load;
+    if (status != ZITI_OK) {
+        l->failed++;
+        ziti_close(conn, echo_closed);
+        return;
+    }
+
+    if (++l->connected == l->conns) {
+        l->all_connected = uv_now(l->h.loop);
+    }
+    for (int i = 0; i < l->msgs; i++) {
+        ziti_write(conn, l->payload.data(), l->payload.size(), nullptr, nullptr);
+    }
+}
+
+static void echo_ready(mock_harness *h, ziti_context ztx) {
+    auto l = mock_test_state<echo_load>(ztx);
+    l->start = uv_now(h->loop);
+    for (int i = 0; i < l->conns; i++) {
+        auto c = new echo_conn{l, l->payload.size() * l->msgs, 0};
+        ziti_connection conn;
+        ziti_conn_init(ztx, &conn, c);
+        ziti_dial_with_options(conn, ECHO_SERVICE, l->dial_opts, echo_connected, echo_data);
+    }
+}
+
+static void run_echo_load(echo_load &l, int routers) {
+    mock_harness_init(l.h, &l, routers, l.timeout ? l.timeout : MOCK_TEST_TIMEOUT);
+    if (l.stall_router >= 0) {
+        mock_edge_set_router_mode(l.h.mock, l.stall_router, MockRouterStall);
+    }
+    l.h.on_ready = echo_ready;
+    l.ztx = mock_harness_add_context(l.h, {});
+    mock_harness_run(l.h);
+}
+
+TEST_CASE("mock edge: dial, echo and close", "[mock]") {
+    echo_load l = {};
+    l.stall_router = -1;
+    l.conns = 50;
+    l.msgs = 4;
+    l.payload.assign(1024, 'x');
+
+    run_echo_load(l, 2);
+
+    CHECK(l.connected == l.conns);
+    CHECK(l.completed == l.conns);
+    CHECK(l.failed == 0);
+    CHECK(l.closed == l.conns);
+}
+
+TEST_CASE("mock edge: racing dial avoids stalled router", "[mock]") {
+    ziti_dial_opts opts = {};
+    opts.connect_timeout_seconds = 10;
+    opts.race_delay_ms = 200;
+
+    echo_load l = {};
+    l.conns = 20;
+    l.msgs = 2;
+    l.payload.assign(512, 'x');
+    l.dial_opts = &opts;
+    l.stall_router = 0;
+
+    run_echo_load(l, 2);
+
+    CHECK(l.completed == l.conns);
+    CHECK(l.failed == 0);
+    // every dial that went to the stalled router first was completed by the raced Connect
+    CHECK(l.path.race_wins > 0);
+    CHECK(l.path.race_wins <= l.path.raced_dials);
+    // no dial waited for connect timeout
+    CHECK(l.done - l.start < (uint64_t) opts.connect_timeout_seconds * 1000);
+}
+
+struct hibernate_test {
+    mock_harness h;
+    ziti_context ztx;
+    ziti_connection conn;
+    uv_timer_t idle_timer;
+
+    int echoes;
+    size_t received;
+    int err;
+    ziti_path_stats idle; // taken while the connection sat idle
+    ziti_path_stats done;
+};
+
+static void hibernate_finish(hibernate_test *t) {
+    ziti_get_path_stats(t->ztx, &t->done);
+    ziti_close(t->conn, nullptr);
+    uv_close((uv_handle_t *) &t->idle_timer, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+static ssize_t hibernate_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (hibernate_test *) ziti_conn_data(conn);
+    if (len < 0) {
+        t->err = (int) len;
+        hibernate_finish(t);
+        return 0;
+    }
+
+    t->received += len;
+    if (t->received < 5) {
+        return len;
+    }
+    t->received = 0;
+    if (++t->echoes == 2) {
+        hibernate_finish(t);
+        return len;
+    }
+
+    // stay idle for a few hibernation checks, then write again
+    uv_timer_start(&t->idle_timer, [](uv_timer_t *timer) {
+        auto t = (hibernate_test *) timer->data;
+        ziti_get_path_stats(t->ztx, &t->idle);
+        ziti_write(t->conn, (uint8_t *) "hello", 5, nullptr, nullptr);
+    }, 1000, 0);
+    return len;
+}
+
+TEST_CASE("mock edge: idle connection hibernates and wakes up", "[mock]") {
+    hibernate_test t = {};
+    mock_harness_init(t.h, &t, 1);
+    uv_timer_init(t.h.loop, &t.idle_timer);
+    t.idle_timer.data = &t;
+
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<hibernate_test>(ztx);
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial(t->conn, ECHO_SERVICE, [](ziti_connection conn, int status) {
+            auto t = (hibernate_test *) ziti_conn_data(conn);
+            if (status != ZITI_OK) {
+                t->err = status;
+                hibernate_finish(t);
+                return;
+            }
+            ziti_write(conn, (uint8_t *) "hello", 5, nullptr, nullptr);
+        }, hibernate_data);
+    };
+
+    ziti_options opts = {};
+    opts.conn_hibernate_ms = 200;
+    t.ztx = mock_harness_add_context(t.h, opts);
+    mock_harness_run(t.h);
+
+    CHECK(t.err == 0);
+    CHECK(t.echoes == 2);
+    CHECK(t.idle.conns_hibernated == 1);
+    CHECK(t.idle.conns_woken == 0);
+    CHECK(t.done.conns_woken == 1);
+}
+
+struct shared_ztx_test {
+    mock_harness h;
+    int echoed;
+    int failed;
+};
+
+static void shared_ztx_done(shared_ztx_test *t) {
+    if (t->echoed + t->failed == (int) t->h.contexts.size()) {
+        mock_harness_finish(&t->h);
+    }
+}
+
+TEST_CASE("mock edge: contexts sharing loop resources", "[mock]") {
+    shared_ztx_test t = {};
+    mock_harness_init(t.h, &t, 1);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<shared_ztx_test>(ztx);
+        ziti_connection conn;
+        ziti_conn_init(ztx, &conn, t);
+        ziti_dial(conn, ECHO_SERVICE, [](ziti_connection conn, int status) {
+            auto t = (shared_ztx_test *) ziti_conn_data(conn);
+            if (status != ZITI_OK) {
+                t->failed++;
+                ziti_close(conn, nullptr);
+                shared_ztx_done(t);
+                return;
+            }
+            ziti_write(conn, (uint8_t *) "hello", 5, nullptr, nullptr);
+        }, [](ziti_connection conn, const uint8_t *data, ssize_t len) -> ssize_t {
+            auto t = (shared_ztx_test *) ziti_conn_data(conn);
+            if (len < 0) {
+                t->failed++;
+            } else {
+                t->echoed++;
+            }
+            ziti_close(conn, nullptr);
+            shared_ztx_done(t);
+            return len < 0 ? 0 : len;
+        });
+    };
+
+    ziti_options opts = {};
+    opts.share_resources = true;
+    for (int i = 0; i < 3; i++) {
+        mock_harness_add_context(t.h, opts);
+    }
+    mock_harness_run(t.h);
+
+    CHECK(t.failed == 0);
+    CHECK(t.echoed == 3);
+}
+
+struct drain_test {
+    mock_harness h;
+    ziti_context ztx;
+    int conns;
+    int connected;
+    int eof;
+    int drained; // connections remaining when drain completed
+    int drain_rc; // second drain request
+};
+
+static ssize_t drain_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (drain_test *) ziti_conn_data(conn);
+    if (len == ZITI_EOF) {
+        t->eof++;
+    }
+    if (len < 0) {
+        ziti_close(conn, nullptr);
+        return 0;
+    }
+    return len;
+}
+
+static void drain_connected(ziti_connection conn, int status) {
+    auto t = (drain_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        ziti_close(conn, nullptr);
+    }
+    if (status != ZITI_OK || ++t->connected < t->conns) {
+        return;
+    }
+
+    ziti_drain(t->ztx, 5000, [](ziti_context ztx, int remaining, void *ctx) {
+        auto t = (drain_test *) ctx;
+        t->drained = remaining;
+        mock_harness_finish(&t->h);
+    }, t);
+    t->drain_rc = ziti_drain(t->ztx, 5000, nullptr, nullptr);
+}
+
+TEST_CASE("mock edge: drain half-closes connections", "[mock]") {
+    drain_test t = {};
+    t.conns = 50;
+    t.drained = -1;
+    mock_harness_init(t.h, &t, 1);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<drain_test>(ztx);
+        for (int c = 0; c < t->conns; c++) {
+            ziti_connection conn;
+            ziti_conn_init(ztx, &conn, t);
+            ziti_dial(conn, ECHO_SERVICE, drain_connected, drain_data);
+        }
+    };
+    t.ztx = mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+
+    CHECK(t.connected == t.conns);
+    // mock router echoes FIN back
+    CHECK(t.eof == t.conns);
+    CHECK(t.drained == 0);
+    CHECK(t.drain_rc == ZITI_INVALID_STATE);
+}
+
+struct subscribe_test {
+    mock_harness h;
+    int notified;
+    int immediate;
+    int unavailable;
+};
+
+static void subscribe_late_cb(ziti_context ztx, ziti_service *s, int status, void *ctx) {
+    auto t = (subscribe_test *) ctx;
+    if (status == ZITI_OK) {
+        t->immediate++;
+    }
+}
+
+static void subscribe_cb(ziti_context ztx, ziti_service *s, int status, void *ctx) {
+    auto t = (subscribe_test *) ctx;
+    if (status != ZITI_OK) {
+        t->unavailable++;
+        return;
+    }
+    t->notified++;
+
+    // service is known now, late subscriber is called right away
+    ziti_service_subscribe(ztx, ECHO_SERVICE, subscribe_late_cb, t);
+    ziti_service_unsubscribe(ztx, ECHO_SERVICE, subscribe_late_cb, t);
+    ziti_service_unsubscribe(ztx, ECHO_SERVICE, subscribe_cb, t);
+
+    mock_harness_finish(&t->h);
+}
+
+TEST_CASE("mock edge: service subscription", "[mock]") {
+    subscribe_test t = {};
+    mock_harness_init(t.h, &t, 1);
+
+    ziti_options opts = {};
+    opts.service_event_window = 200;
+    ziti_context ztx = mock_harness_add_context(t.h, opts);
+
+    REQUIRE(ziti_service_subscribe(ztx, ECHO_SERVICE, subscribe_cb, &t) == ZITI_OK);
+    CHECK(ziti_service_unsubscribe(ztx, "not-subscribed", subscribe_cb, &t) == ZITI_NOT_FOUND);
+
+    mock_harness_run(t.h);
+
+    CHECK(t.notified == 1);
+    CHECK(t.immediate == 1);
+    // unsubscribed before services were removed on shutdown
+    CHECK(t.unavailable == 0);
+}
+
+struct backpressure_test {
+    mock_harness h;
+    ziti_context ztx;
+    std::vector<uint8_t> payload;
+    int err;
+    int blocked;
+    int unblocked;
+    size_t queued_when_blocked;
+    int completed;
+    ziti_path_stats path;
+};
+
+static void backpressure_finish(backpressure_test *t) {
+    ziti_get_path_stats(t->ztx, &t->path);
+    mock_harness_finish(&t->h);
+}
+
+static void backpressure_writable(ziti_connection conn, bool writable) {
+    auto t = (backpressure_test *) ziti_conn_data(conn);
+    if (!writable) {
+        t->blocked++;
+        t->queued_when_blocked = ziti_conn_write_queue_size(conn);
+        return;
+    }
+
+    t->unblocked++;
+    CHECK(ziti_conn_is_writable(conn));
+    ziti_close(conn, nullptr);
+    backpressure_finish(t);
+}
+
+static void backpressure_connected(ziti_connection conn, int status) {
+    auto t = (backpressure_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        t->err = status;
+        ziti_close(conn, nullptr);
+        backpressure_finish(t);
+        return;
+    }
+
+    ziti_conn_set_writable_cb(conn, backpressure_writable);
+    // 256K queued at once, high mark is 64K
+    for (int i = 0; i < 16; i++) {
+        ziti_write(conn, t->payload.data(), t->payload.size(), [](ziti_connection c, ssize_t status, void *ctx) {
+            auto t = (backpressure_test *) ctx;
+            if (status > 0) {
+                t->completed++;
+            }
+        }, t);
+    }
+    CHECK_FALSE(ziti_conn_is_writable(conn));
+}
+
+TEST_CASE("mock edge: write backpressure", "[mock]") {
+    backpressure_test t = {};
+    t.payload.assign(16 * 1024, 'x');
+    mock_harness_init(t.h, &t, 1);
+    mock_edge_set_router_mode(t.h.mock, 0, MockRouterSink);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<backpressure_test>(ztx);
+        ziti_connection conn;
+        ziti_conn_init(ztx, &conn, t);
+        ziti_dial(conn, ECHO_SERVICE, backpressure_connected,
+                  [](ziti_connection c, const uint8_t *, ssize_t len) -> ssize_t {
+                      return len < 0 ? 0 : len;
+                  });
+    };
+
+    ziti_options opts = {};
+    opts.conn_write_high_water = 64 * 1024;
+    opts.conn_write_low_water = 16 * 1024;
+    t.ztx = mock_harness_add_context(t.h, opts);
+    mock_harness_run(t.h);
+
+    CHECK(t.err == 0);
+    CHECK(t.blocked == 1);
+    CHECK(t.unblocked == 1);
+    CHECK(t.queued_when_blocked > 64 * 1024);
+    // writable again once queue drained to the low mark
+    CHECK(t.completed >= 15);
+    CHECK(t.path.write_blocks == 1);
+}
+
+struct frame_limit_test {
+    mock_harness h;
+    std::vector<uint8_t> payload;
+    int connected;
+    size_t received;
+    int err;
+};
+
+TEST_CASE("mock edge: oversized frame closes channel", "[mock]") {
+    frame_limit_test t = {};
+    t.payload.assign(8 * 1024, 'x');
+    mock_harness_init(t.h, &t, 1);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<frame_limit_test>(ztx);
+        ziti_connection conn;
+        ziti_conn_init(ztx, &conn, t);
+        ziti_dial(conn, ECHO_SERVICE, [](ziti_connection conn, int status) {
+            auto t = (frame_limit_test *) ziti_conn_data(conn);
+            if (status != ZITI_OK) {
+                t->err = status;
+                ziti_close(conn, nullptr);
+                mock_harness_finish(&t->h);
+                return;
+            }
+            t->connected++;
+            // echoed back in one frame, larger than the limit
+            ziti_write(conn, t->payload.data(), t->payload.size(), nullptr, nullptr);
+        }, [](ziti_connection conn, const uint8_t *data, ssize_t len) -> ssize_t {
+            auto t = (frame_limit_test *) ziti_conn_data(conn);
+            if (len >= 0) {
+                t->received += len;
+                return len;
+            }
+            t->err = (int) len;
+            ziti_close(conn, nullptr);
+            mock_harness_finish(&t->h);
+            return 0;
+        });
+    };
+
+    ziti_options opts = {};
+    opts.max_frame_size = 4 * 1024;
+    mock_harness_add_context(t.h, opts);
+    mock_harness_run(t.h);
+
+    CHECK(t.connected == 1);
+    CHECK(t.received == 0);
+    CHECK(t.err != 0);
+}
+
+struct write_buf_test {
+    mock_harness h;
+    int null_iov_rc;
+    int foreign_rc;
+    int write_rc;
+    int resubmit_rc;
+    size_t received;
+    int err;
+};
+
+static void write_buf_done(ziti_connection conn, write_buf_test *t) {
+    ziti_close(conn, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+TEST_CASE("mock edge: write argument validation", "[mock]") {
+    write_buf_test t = {};
+    mock_harness_init(t.h, &t, 1);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<write_buf_test>(ztx);
+        ziti_connection conn;
+        ziti_conn_init(ztx, &conn, t);
+        ziti_dial(conn, ECHO_SERVICE, [](ziti_connection conn, int status) {
+            auto t = (write_buf_test *) ziti_conn_data(conn);
+            if (status != ZITI_OK) {
+                t->err = status;
+                write_buf_done(conn, t);
+                return;
+            }
+
+            t->null_iov_rc = ziti_writev(conn, nullptr, 1, nullptr, nullptr);
+
+            uint8_t foreign[256] = {};
+            t->foreign_rc = ziti_write_buf(conn, foreign + 128, 5, nullptr, nullptr);
+
+            uint8_t *buf = ziti_alloc_write_buf(conn, 1024);
+            memcpy(buf, "hello", 5);
+            t->write_rc = ziti_write_buf(conn, buf, 5, nullptr, nullptr);
+            // buffer belongs to the SDK now
+            t->resubmit_rc = ziti_write_buf(conn, buf, 5, nullptr, nullptr);
+        }, [](ziti_connection conn, const uint8_t *data, ssize_t len) -> ssize_t {
+            auto t = (write_buf_test *) ziti_conn_data(conn);
+            if (len < 0) {
+                t->err = (int) len;
+                write_buf_done(conn, t);
+                return 0;
+            }
+            t->received += len;
+            if (t->received == 5) {
+                write_buf_done(conn, t);
+            }
+            return len;
+        });
+    };
+    mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+
+    CHECK(t.err == 0);
+    CHECK(t.null_iov_rc == ZITI_INVALID_ARGUMENT);
+    CHECK(t.foreign_rc == ZITI_INVALID_ARGUMENT);
+    CHECK(t.write_rc == ZITI_OK);
+    CHECK(t.resubmit_rc == ZITI_INVALID_ARGUMENT);
+    CHECK(t.received == 5);
+}
+
+struct rebind_test {
+    mock_harness h;
+    ziti_connection server;
+    ziti_connection first; // dialed while service is bound
+    ziti_connection second; // dialed after server is closed
+    int listen_status;
+    bool server_closed;
+    size_t received;
+    int err;
+};
+
+static void rebind_finish(rebind_test *t, int err) {
+    t->err = err;
+    if (t->first) ziti_close(t->first, nullptr);
+    if (t->second) ziti_close(t->second, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+static ssize_t rebind_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (rebind_test *) ziti_conn_data(conn);
+    if (len < 0) {
+        rebind_finish(t, (int) len);
+        return 0;
+    }
+    t->received += len;
+    if (t->received == 5) {
+        rebind_finish(t, 0);
+    }
+    return len;
+}
+
+static void rebind_second_connected(ziti_connection conn, int status) {
+    auto t = (rebind_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        rebind_finish(t, status);
+        return;
+    }
+    ziti_write(conn, (uint8_t *) "hello", 5, nullptr, nullptr);
+}
+
+static void rebind_first_connected(ziti_connection conn, int status) {
+    auto t = (rebind_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        rebind_finish(t, status);
+        return;
+    }
+
+    // server and dialer share interned service name
+    ziti_close(t->server, [](ziti_connection server) {
+        auto t = (rebind_test *) ziti_conn_data(server);
+        t->server_closed = true;
+        ziti_conn_init(ziti_conn_context(server), &t->second, t);
+        ziti_dial(t->second, ECHO_SERVICE, rebind_second_connected, rebind_data);
+    });
+}
+
+TEST_CASE("mock edge: dial after closing server of the same service", "[mock]") {
+    rebind_test t = {};
+    t.listen_status = -1;
+    mock_harness_init(t.h, &t, 1);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<rebind_test>(ztx);
+        ziti_conn_init(ztx, &t->server, t);
+        ziti_listen(t->server, ECHO_SERVICE, [](ziti_connection server, int status) {
+            auto t = (rebind_test *) ziti_conn_data(server);
+            t->listen_status = status;
+            if (status != ZITI_OK) {
+                rebind_finish(t, status);
+                return;
+            }
+            ziti_conn_init(ziti_conn_context(server), &t->first, t);
+            ziti_dial(t->first, ECHO_SERVICE, rebind_first_connected, rebind_data);
+        }, [](ziti_connection server, ziti_connection client, int status, ziti_client_ctx *ctx) {
+            ziti_close(client, nullptr);
+        });
+    };
+    mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+
+    CHECK(t.listen_status == ZITI_OK);
+    CHECK(t.server_closed);
+    CHECK(t.err == 0);
+    CHECK(t.received == 5);
+}
+
+struct recv_window_test {
+    mock_harness h;
+    std::vector<uint8_t> payload;
+    int writes;
+    uv_timer_t resume_timer;
+    ziti_connection conn;
+    size_t received;
+    int err;
+};
+
+static void recv_window_finish(recv_window_test *t, int err) {
+    if (t->h.finishing) {
+        return;
+    }
+    t->err = err;
+    ziti_close(t->conn, nullptr);
+    uv_close((uv_handle_t *) &t->resume_timer, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+static ssize_t recv_window_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (recv_window_test *) ziti_conn_data(conn);
+    if (len < 0) {
+        recv_window_finish(t, (int) len);
+        return 0;
+    }
+    t->received += len;
+    if (t->received == t->payload.size() * t->writes) {
+        recv_window_finish(t, 0);
+    }
+    return len;
+}
+
+// application does not read while all echoed data arrives
+static void run_recv_window(recv_window_test &t, unsigned int window) {
+    t.payload.assign(16 * 1024, 'x');
+    t.writes = 4;
+    mock_harness_init(t.h, &t, 1);
+    uv_timer_init(t.h.loop, &t.resume_timer);
+    t.resume_timer.data = &t;
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<recv_window_test>(ztx);
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial(t->conn, ECHO_SERVICE, [](ziti_connection conn, int status) {
+            auto t = (recv_window_test *) ziti_conn_data(conn);
+            if (status != ZITI_OK) {
+                recv_window_finish(t, status);
+                return;
+            }
+            ziti_conn_pause_read(conn);
+            for (int i = 0; i < t->writes; i++) {
+                ziti_write(conn, t->payload.data(), t->payload.size(), nullptr, nullptr);
+            }
+            uv_timer_start(&t->resume_timer, [](uv_timer_t *timer) {
+                auto t = (recv_window_test *) timer->data;
+                ziti_conn_resume_read(t->conn);
+            }, 500, 0);
+        }, recv_window_data);
+    };
+
+    ziti_options opts = {};
+    opts.conn_recv_window = window;
+    mock_harness_add_context(t.h, opts);
+    mock_harness_run(t.h);
+}
+
+TEST_CASE("mock edge: receive window exceeded", "[mock]") {
+    recv_window_test t = {};
+    run_recv_window(t, 32 * 1024);
+
+    CHECK(t.err == ZITI_CONNABORT);
+    // data that fit into the window is still delivered
+    CHECK(t.received > 0);
+    CHECK(t.received <= 32 * 1024);
+}
+
+TEST_CASE("mock edge: data within receive window", "[mock]") {
+    recv_window_test t = {};
+    run_recv_window(t, 128 * 1024);
+
+    CHECK(t.err == 0);
+    CHECK(t.received == t.payload.size() * t.writes);
+}
+
+static const char *const E2E_SERVICE = "mock-e2e";
+
+#define OFFLOAD_WRITE_LEN (8 * 1024)
+#define OFFLOAD_ROUND_WRITES 8
+// stream byte at offset [o] is (o % OFFLOAD_PATTERN), prime so that it does not line up with writes
+#define OFFLOAD_PATTERN 251
+
+/**
+ * Encrypted echo with crypto offload enabled at the lowest rate.
+ * Writes go in rounds, so that offload kicks in after the first rate interval and writes batch up.
+ */
+struct offload_test {
+    mock_harness h;
+    uint8_t pattern[OFFLOAD_WRITE_LEN + OFFLOAD_PATTERN];
+    uv_timer_t writer;
+    ziti_context ztx;
+    ziti_connection conn;
+    int rounds;
+    bool close_offloaded; // close right after the first round that went to a worker
+    size_t sent;
+    size_t received;
+    int writes;
+    int write_cbs;
+    bool out_of_order;
+    bool closed;
+    int err;
+    ziti_path_stats path;
+};
+
+static void offload_finish(offload_test *t) {
+    if (t->h.finishing) {
+        return;
+    }
+    ziti_get_path_stats(t->ztx, &t->path);
+    uv_close((uv_handle_t *) &t->writer, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+static void offload_closed(ziti_connection conn) {
+    auto t = (offload_test *) ziti_conn_data(conn);
+    t->closed = true;
+    offload_finish(t);
+}
+
+static void offload_close(offload_test *t, int err) {
+    if (t->closed || t->conn == nullptr) {
+        return;
+    }
+    t->err = err;
+    uv_timer_stop(&t->writer);
+    ziti_close(t->conn, offload_closed);
+    t->conn = nullptr;
+}
+
+static ssize_t offload_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (offload_test *) ziti_conn_data(conn);
+    if (len < 0) {
+        offload_close(t, (int) len);
+        return 0;
+    }
+    for (ssize_t i = 0; i < len; i++) {
+        if (data[i] != (t->received + i) % OFFLOAD_PATTERN) {
+            t->out_of_order = true;
+            break;
+        }
+    }
+    t->received += len;
+    if (t->rounds == 0 && t->received == t->sent) {
+        offload_close(t, 0);
+    }
+    return len;
+}
+
+static void offload_write_round(uv_timer_t *timer) {
+    auto t = (offload_test *) timer->data;
+    if (t->rounds == 0) {
+        uv_timer_stop(timer);
+        return;
+    }
+    t->rounds--;
+
+    ziti_path_stats stats;
+    ziti_get_path_stats(t->ztx, &stats);
+    for (int i = 0; i < OFFLOAD_ROUND_WRITES; i++) {
+        const uint8_t *p = t->pattern + t->sent % OFFLOAD_PATTERN;
+        t->writes++;
+        ziti_write(t->conn, (uint8_t *) p, OFFLOAD_WRITE_LEN, [](ziti_connection conn, ssize_t status, void *ctx) {
+            ((offload_test *) ctx)->write_cbs++;
+        }, t);
+        t->sent += OFFLOAD_WRITE_LEN;
+    }
+    if (t->close_offloaded && stats.crypto_offloaded > 0) {
+        offload_close(t, 0);
+    }
+}
+
+// [corrupt] - encrypted echo (1-based) damaged by the router, 0 for none
+static void run_offload(offload_test &t, int rounds, uint64_t corrupt = 0) {
+    for (size_t i = 0; i < sizeof(t.pattern); i++) {
+        t.pattern[i] = i % OFFLOAD_PATTERN;
+    }
+    t.rounds = rounds;
+    mock_harness_init(t.h, &t, 1);
+    mock_edge_add_encrypted_service(t.h.mock, E2E_SERVICE);
+    mock_edge_corrupt_data(t.h.mock, 0, corrupt);
+    uv_timer_init(t.h.loop, &t.writer);
+    t.writer.data = &t;
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<offload_test>(ztx);
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial(t->conn, E2E_SERVICE, [](ziti_connection conn, int status) {
+            auto t = (offload_test *) ziti_conn_data(conn);
+            if (status != ZITI_OK) {
+                t->err = status;
+                offload_finish(t);
+                return;
+            }
+            uv_timer_start(&t->writer, offload_write_round, 0, 200);
+        }, offload_data);
+    };
+
+    ziti_options opts = {};
+    opts.crypto_offload_rate = 1;
+    t.ztx = mock_harness_add_context(t.h, opts);
+    mock_harness_run(t.h);
+}
+
+TEST_CASE("mock edge: offloaded crypto keeps stream order", "[mock]") {
+    offload_test t = {};
+    run_offload(t, 10);
+
+    CHECK(t.err == 0);
+    CHECK(t.closed);
+    CHECK_FALSE(t.out_of_order);
+    CHECK(t.received == t.sent);
+    CHECK(t.path.crypto_offloaded > 0);
+}
+
+TEST_CASE("mock edge: decrypt failure in offloaded batch", "[mock]") {
+    offload_test t = {};
+    // mid-way through the last round, well after offload is on
+    uint64_t corrupt = 9 * OFFLOAD_ROUND_WRITES + 3;
+    run_offload(t, 10, corrupt);
+
+    CHECK(t.err == ZITI_CRYPTO_FAIL);
+    CHECK_FALSE(t.out_of_order);
+    // nothing from the bad message on is delivered
+    CHECK(t.received <= (corrupt - 1) * OFFLOAD_WRITE_LEN);
+    CHECK(t.path.crypto_offloaded > 0);
+}
+
+TEST_CASE("mock edge: close with offloaded crypto job pending", "[mock]") {
+    offload_test t = {};
+    t.close_offloaded = true;
+    run_offload(t, 10);
+
+    CHECK(t.err == 0);
+    CHECK(t.closed);
+    CHECK_FALSE(t.h.timed_out);
+    // every write is completed, sent or failed
+    CHECK(t.write_cbs == t.writes);
+    CHECK_FALSE(t.out_of_order);
+}
+
+/**
+ * Hosting ECHO_SERVICE, with clients dialing through mock_edge_dial().
+ * [on_bound] is called once the service is bound, test proceeds from [timer].
+ */
+struct hosting_test {
+    mock_harness h;
+    ziti_listen_opts opts;
+    int routers;
+    ziti_context ztx;
+    ziti_connection server;
+    uv_timer_t timer;
+    void (*on_bound)(hosting_test *t);
+
+    int listen_status;
+    int clients;
+    ziti_connection pending_client;
+    int accepted;
+
+    uint64_t binds_start; // binds once the service was bound
+    mock_router_stats total; // all routers, when test finished
+    ziti_path_stats path;
+    int load;
+};
+
+static mock_router_stats hosting_totals(hosting_test *t) {
+    mock_router_stats total = {};
+    for (int i = 0; i < t->routers; i++) {
+        mock_router_stats rs;
+        mock_edge_router_stats(t->h.mock, i, &rs);
+        total.binds += rs.binds;
+        total.unbinds += rs.unbinds;
+        total.dials += rs.dials;
+        total.dials_accepted += rs.dials_accepted;
+        total.dials_failed += rs.dials_failed;
+    }
+    return total;
+}
+
+static void hosting_finish(hosting_test *t) {
+    if (t->h.finishing) {
+        return;
+    }
+    t->total = hosting_totals(t);
+    t->load = ziti_listen_load(t->server);
+    ziti_get_path_stats(t->ztx, &t->path);
+    uv_close((uv_handle_t *) &t->timer, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+// dial through whichever router has the service bound
+static int hosting_dial(hosting_test *t) {
+    for (int i = 0; i < t->routers; i++) {
+        if (mock_edge_dial(t->h.mock, i) == 0) {
+            return 0;
+        }
+    }
+    return -1;
+}
+
+static void run_hosting(hosting_test &t, int routers) {
+    t.listen_status = -1;
+    t.routers = routers;
+    mock_harness_init(t.h, &t, routers);
+    uv_timer_init(t.h.loop, &t.timer);
+    t.timer.data = &t;
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<hosting_test>(ztx);
+        ziti_conn_init(ztx, &t->server, t);
+        ziti_listen_with_options(t->server, ECHO_SERVICE, &t->opts, [](ziti_connection server, int status) {
+            auto t = (hosting_test *) ziti_conn_data(server);
+            if (t->listen_status == ZITI_OK) {
+                return;
+            }
+            t->listen_status = status;
+            if (status != ZITI_OK) {
+                hosting_finish(t);
+                return;
+            }
+            t->on_bound(t);
+        }, [](ziti_connection server, ziti_connection client, int status, ziti_client_ctx *ctx) {
+            auto t = (hosting_test *) ziti_conn_data(server);
+            if (status == ZITI_OK) {
+                t->clients++;
+                t->pending_client = client;
+                ziti_conn_set_data(client, t);
+            }
+        });
+    };
+    t.ztx = mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+}
+
+TEST_CASE("mock edge: dials over max_pending are shed", "[mock]") {
+    hosting_test t = {};
+    t.opts.max_pending = 2;
+    t.on_bound = [](hosting_test *t) {
+        uv_timer_start(&t->timer, [](uv_timer_t *timer) {
+            auto t = (hosting_test *) timer->data;
+            for (int i = 0; i < 5; i++) {
+                hosting_dial(t);
+            }
+            // clients are never accepted, so they stay pending
+            uv_timer_start(timer, [](uv_timer_t *timer) {
+                hosting_finish((hosting_test *) timer->data);
+            }, 500, 0);
+        }, 100, 0);
+    };
+    run_hosting(t, 1);
+
+    CHECK(t.listen_status == ZITI_OK);
+    CHECK(t.total.dials == 5);
+    CHECK(t.clients == 2);
+    CHECK(t.total.dials_failed == 3);
+    CHECK(t.path.dials_shed == 3);
+    CHECK(t.load == 100);
+}
+
+TEST_CASE("mock edge: adaptive bindings scale up on accept latency", "[mock]") {
+    hosting_test t = {};
+    t.opts.min_bindings = 1;
+    t.opts.max_bindings = 3;
+    t.on_bound = [](hosting_test *t) {
+        uv_timer_start(&t->timer, [](uv_timer_t *timer) {
+            auto t = (hosting_test *) timer->data;
+            t->binds_start = hosting_totals(t).binds;
+            hosting_dial(t);
+
+            // slow accept, over the scale up latency
+            uv_timer_start(timer, [](uv_timer_t *timer) {
+                auto t = (hosting_test *) timer->data;
+                if (t->pending_client) {
+                    ziti_accept(t->pending_client, [](ziti_connection clt, int status) {
+                        auto t = (hosting_test *) ziti_conn_data(clt);
+                        if (status == ZITI_OK) {
+                            t->accepted++;
+                        }
+                    }, [](ziti_connection clt, const uint8_t *data, ssize_t len) {
+                        return len;
+                    });
+                }
+                // load is checked every 10s since the service was bound
+                uv_timer_start(timer, [](uv_timer_t *timer) {
+                    hosting_finish((hosting_test *) timer->data);
+                }, 10000, 0);
+            }, 400, 0);
+        }, 500, 0);
+    };
+    run_hosting(t, 3);
+
+    CHECK(t.listen_status == ZITI_OK);
+    // starts at min_bindings
+    CHECK(t.binds_start == 1);
+    CHECK(t.clients == 1);
+    CHECK(t.accepted == 1);
+    CHECK(t.total.dials_accepted == 1);
+    CHECK(t.total.binds == 2);
+}
+
+#if !defined(_WIN32)
+#define UDP_BRIDGE_DATAGRAMS 8
+
+/**
+ * Local UDP socket ([app]) talks to a socket bridged to ECHO_SERVICE, both on loopback.
+ * With [refuse], [app] goes away while an echo is on its way back, and comes back on the same port.
+ */
+struct udp_bridge_test {
+    mock_harness h;
+    bool refuse;
+    uv_udp_t *app;
+    struct sockaddr_in app_addr;
+    struct sockaddr_in bridge_addr;
+    uv_timer_t timer;
+    ziti_connection conn;
+    int sent;
+    int received;
+    bool bridge_closed;
+    int err;
+};
+
+static void udp_bridge_finish(udp_bridge_test *t, int err) {
+    if (t->h.finishing) {
+        return;
+    }
+    t->err = err;
+    uv_close((uv_handle_t *) &t->timer, nullptr);
+    if (t->app) {
+        uv_close((uv_handle_t *) t->app, [](uv_handle_t *h) { delete (uv_udp_t *) h; });
+        t->app = nullptr;
+    }
+    // bridge and its socket go away with the context
+    mock_harness_finish(&t->h);
+}
+
+static void udp_bridge_send(udp_bridge_test *t, int count) {
+    for (int i = 0; i < count; i++) {
+        char msg[32];
+        int len = snprintf(msg, sizeof(msg), "datagram-%d", t->sent++);
+        uv_buf_t b = uv_buf_init(msg, len);
+        if (uv_udp_try_send(t->app, &b, 1, nullptr) != len) {
+            udp_bridge_finish(t, -1);
+            return;
+        }
+    }
+}
+
+// bound to [app_addr], connected to [bridge_addr] once it is known
+static int udp_bridge_open_app(udp_bridge_test *t) {
+    t->app = new uv_udp_t;
+    uv_udp_init(t->h.loop, t->app);
+    t->app->data = t;
+    int rc = uv_udp_bind(t->app, (const struct sockaddr *) &t->app_addr, 0);
+    if (rc != 0) {
+        return rc;
+    }
+    int len = sizeof(t->app_addr);
+    uv_udp_getsockname(t->app, (struct sockaddr *) &t->app_addr, &len);
+    uv_udp_recv_start(t->app, [](uv_handle_t *, size_t, uv_buf_t *b) {
+        static char buf[2048];
+        *b = uv_buf_init(buf, sizeof(buf));
+    }, [](uv_udp_t *udp, ssize_t len, const uv_buf_t *, const struct sockaddr *addr, unsigned int) {
+        auto t = (udp_bridge_test *) udp->data;
+        if (len > 0) {
+            if (++t->received == UDP_BRIDGE_DATAGRAMS) {
+                udp_bridge_finish(t, 0);
+            }
+        } else if (len < 0 && len != UV_ECONNREFUSED) {
+            udp_bridge_finish(t, (int) len);
+        }
+    });
+    return t->bridge_addr.sin_port != 0 ? uv_udp_connect(t->app, (const struct sockaddr *) &t->bridge_addr) : 0;
+}
+
+static void udp_bridge_connected(ziti_connection conn, int status) {
+    auto t = (udp_bridge_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        udp_bridge_finish(t, status);
+        return;
+    }
+
+    uv_ip4_addr("127.0.0.1", 0, &t->app_addr);
+    int rc = udp_bridge_open_app(t);
+    if (rc != 0) {
+        udp_bridge_finish(t, rc);
+        return;
+    }
+
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    t->bridge_addr = t->app_addr;
+    t->bridge_addr.sin_port = 0;
+    socklen_t len = sizeof(t->bridge_addr);
+    if (bind(fd, (struct sockaddr *) &t->bridge_addr, len) != 0 ||
+        getsockname(fd, (struct sockaddr *) &t->bridge_addr, &len) != 0 ||
+        connect(fd, (struct sockaddr *) &t->app_addr, sizeof(t->app_addr)) != 0 ||
+        uv_udp_connect(t->app, (const struct sockaddr *) &t->bridge_addr) != 0) {
+        close(fd);
+        udp_bridge_finish(t, -1);
+        return;
+    }
+
+    rc = ziti_conn_bridge_fds(conn, fd, fd, [](void *ctx) {
+        auto t = (udp_bridge_test *) ctx;
+        if (!t->h.finishing) {
+            t->bridge_closed = true;
+            udp_bridge_finish(t, -1);
+        }
+    }, t);
+    if (rc != ZITI_OK) {
+        close(fd);
+        udp_bridge_finish(t, rc);
+        return;
+    }
+
+    if (!t->refuse) {
+        udp_bridge_send(t, UDP_BRIDGE_DATAGRAMS);
+        return;
+    }
+
+    // echo of this one finds nobody listening
+    udp_bridge_send(t, 1);
+    uv_close((uv_handle_t *) t->app, [](uv_handle_t *h) { delete (uv_udp_t *) h; });
+    t->app = nullptr;
+    uv_timer_start(&t->timer, [](uv_timer_t *timer) {
+        auto t = (udp_bridge_test *) timer->data;
+        int rc = udp_bridge_open_app(t);
+        if (rc != 0) {
+            udp_bridge_finish(t, rc);
+            return;
+        }
+        udp_bridge_send(t, UDP_BRIDGE_DATAGRAMS);
+    }, 500, 0);
+}
+
+static void run_udp_bridge(udp_bridge_test &t) {
+    mock_harness_init(t.h, &t, 1);
+    uv_timer_init(t.h.loop, &t.timer);
+    t.timer.data = &t;
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<udp_bridge_test>(ztx);
+        ziti_dial_opts opts = {};
+        opts.datagram = true;
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial_with_options(t->conn, ECHO_SERVICE, &opts, udp_bridge_connected, nullptr);
+    };
+    mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+}
+
+TEST_CASE("mock edge: UDP bridge over loopback", "[mock]") {
+    udp_bridge_test t = {};
+    run_udp_bridge(t);
+
+    CHECK(t.err == 0);
+    CHECK_FALSE(t.bridge_closed);
+    CHECK(t.received == UDP_BRIDGE_DATAGRAMS);
+}
+
+TEST_CASE("mock edge: UDP bridge survives refused datagram", "[mock]") {
+    udp_bridge_test t = {};
+    t.refuse = true;
+    run_udp_bridge(t);
+
+    CHECK(t.err == 0);
+    CHECK_FALSE(t.bridge_closed);
+    CHECK(t.received == UDP_BRIDGE_DATAGRAMS);
+}
+#endif
+
+#if !defined(_WIN32)
+// fits into a pipe, so that the test can write all of it before the loop runs
+#define FD_BRIDGE_PAYLOAD (32 * 1024)
+
+/**
+ * ECHO_SERVICE bridged with ziti_conn_bridge_fds(): input is a pipe written by the test or a regular file,
+ * output is a pipe read by the test until EOF.
+ */
+struct fd_bridge_test {
+    mock_harness h;
+    bool file_input;
+    std::vector<uint8_t> payload;
+    int in_fd; // test's end of the input pipe
+    int bridge_in;
+    int bridge_out;
+    uv_pipe_t out; // test's end of the output pipe
+    std::vector<uint8_t> received;
+    ziti_context ztx;
+    ziti_connection conn;
+    bool eof;
+    int err;
+    ziti_path_stats path;
+};
+
+static void fd_bridge_finish(fd_bridge_test *t, int err) {
+    if (t->h.finishing) {
+        return;
+    }
+    t->err = err;
+    ziti_get_path_stats(t->ztx, &t->path);
+    uv_close((uv_handle_t *) &t->out, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+static void fd_bridge_connected(ziti_connection conn, int status) {
+    auto t = (fd_bridge_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        close(t->bridge_in);
+        close(t->bridge_out);
+        fd_bridge_finish(t, status);
+        return;
+    }
+
+    uv_read_start((uv_stream_t *) &t->out, [](uv_handle_t *, size_t, uv_buf_t *b) {
+        static char buf[16 * 1024];
+        *b = uv_buf_init(buf, sizeof(buf));
+    }, [](uv_stream_t *s, ssize_t len, const uv_buf_t *b) {
+        auto t = (fd_bridge_test *) s->data;
+        if (len > 0) {
+            t->received.insert(t->received.end(), b->base, b->base + len);
+        } else if (len == UV_EOF) {
+            t->eof = true;
+            fd_bridge_finish(t, 0);
+        } else if (len < 0) {
+            fd_bridge_finish(t, (int) len);
+        }
+    });
+
+    int rc = ziti_conn_bridge_fds(conn, t->bridge_in, t->bridge_out, nullptr, nullptr);
+    if (rc != ZITI_OK) {
+        fd_bridge_finish(t, rc);
+        return;
+    }
+    if (t->file_input) {
+        return;
+    }
+
+    // smallest read buffers, so that every read is a message of its own
+    ziti_conn_bridge_buffers(conn, 1024, 1024);
+    size_t off = 0;
+    while (off < t->payload.size()) {
+        size_t len = std::min<size_t>(4096, t->payload.size() - off);
+        ssize_t n = write(t->in_fd, t->payload.data() + off, len);
+        if (n <= 0) {
+            fd_bridge_finish(t, -1);
+            return;
+        }
+        off += n;
+    }
+    close(t->in_fd);
+}
+
+static void run_fd_bridge(fd_bridge_test &t) {
+    t.payload.resize(FD_BRIDGE_PAYLOAD);
+    for (size_t i = 0; i < t.payload.size(); i++) {
+        t.payload[i] = (uint8_t) (i % 251);
+    }
+
+    int in[2];
+    int out[2];
+    REQUIRE(pipe(out) == 0);
+    if (t.file_input) {
+        char path[] = "/tmp/mock-bridge-XXXXXX";
+        int fd = mkstemp(path);
+        REQUIRE(fd >= 0);
+        unlink(path);
+        REQUIRE(write(fd, t.payload.data(), t.payload.size()) == (ssize_t) t.payload.size());
+        lseek(fd, 0, SEEK_SET);
+        t.bridge_in = fd;
+    } else {
+        REQUIRE(pipe(in) == 0);
+        t.bridge_in = in[0];
+        t.in_fd = in[1];
+    }
+    t.bridge_out = out[1];
+
+    mock_harness_init(t.h, &t, 1);
+    uv_pipe_init(t.h.loop, &t.out, 0);
+    uv_pipe_open(&t.out, out[0]);
+    t.out.data = &t;
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<fd_bridge_test>(ztx);
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial(t->conn, ECHO_SERVICE, fd_bridge_connected, nullptr);
+    };
+    t.ztx = mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+}
+
+TEST_CASE("mock edge: bridge coalesces writes to local stream", "[mock]") {
+    fd_bridge_test t = {};
+    run_fd_bridge(t);
+
+    CHECK(t.err == 0);
+    CHECK(t.eof);
+    CHECK(t.received == t.payload);
+    // echoed messages arrive in bursts, each burst goes out in one write
+    CHECK(t.path.bridge_writes > 0);
+    CHECK(t.path.bridge_write_chunks > t.path.bridge_writes);
+}
+
+TEST_CASE("mock edge: bridge reads regular file input", "[mock]") {
+    fd_bridge_test t = {};
+    t.file_input = true;
+    run_fd_bridge(t);
+
+    CHECK(t.err == 0);
+    CHECK(t.eof);
+    CHECK(t.received == t.payload);
+}
+#endif
+
+struct posture_test {
+    mock_harness h;
+    uv_timer_t timer;
+    uint64_t deadline;
+    uint64_t responses;
+};
+
+// process checks run on the thread pool and finish after the posture tick,
+// their responses must not wait for the next tick (10 minutes with change notifications)
+TEST_CASE("mock edge: process posture response is submitted once collected", "[mock]") {
+    posture_test t = {};
+    char exe[1024];
+    size_t exe_len = sizeof(exe);
+    REQUIRE(uv_exepath(exe, &exe_len) == 0);
+
+    mock_harness_init(t.h, &t, 1);
+    mock_edge_set_posture_query(t.h.mock, "PROCESS", exe);
+    uv_timer_init(t.h.loop, &t.timer);
+    t.timer.data = &t;
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<posture_test>(ztx);
+        t->deadline = uv_now(h->loop) + 5000;
+        uv_timer_start(&t->timer, [](uv_timer_t *timer) {
+            auto t = (posture_test *) timer->data;
+            t->responses = mock_edge_ctrl_requests(t->h.mock, "/posture-response");
+            if (t->responses > 0 || uv_now(t->h.loop) >= t->deadline) {
+                uv_close((uv_handle_t *) timer, nullptr);
+                mock_harness_finish(&t->h);
+            }
+        }, 100, 100);
+    };
+
+    ziti_options opts = {};
+    opts.pq_change_notify = true;
+    mock_harness_add_context(t.h, opts);
+    mock_harness_run(t.h);
+
+    CHECK_FALSE(t.h.timed_out);
+    CHECK(t.responses > 0);
+}
+
+#define BATCH_WRITES 32
+#define BATCH_WRITE_LEN 512
+
+struct batch_test {
+    mock_harness h;
+    uint8_t payload[BATCH_WRITE_LEN];
+    ziti_connection conn;
+    size_t received;
+    mock_router_stats before;
+    mock_router_stats after;
+    int err;
+};
+
+static void batch_finish(batch_test *t, int err) {
+    if (t->h.finishing) {
+        return;
+    }
+    t->err = err;
+    mock_edge_router_stats(t->h.mock, 0, &t->after);
+    mock_harness_finish(&t->h);
+}
+
+static ssize_t batch_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (batch_test *) ziti_conn_data(conn);
+    if (len < 0) {
+        batch_finish(t, (int) len);
+        return 0;
+    }
+    t->received += len;
+    if (t->received == BATCH_WRITES * BATCH_WRITE_LEN) {
+        batch_finish(t, 0);
+    }
+    return len;
+}
+
+static void batch_connected(ziti_connection conn, int status) {
+    auto t = (batch_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        batch_finish(t, status);
+        return;
+    }
+
+    mock_edge_router_stats(t->h.mock, 0, &t->before);
+    for (int i = 0; i < BATCH_WRITES; i++) {
+        ziti_write(conn, t->payload, sizeof(t->payload), nullptr, nullptr);
+    }
+}
+
+// messages queued in one loop iteration go out in a single channel write
+TEST_CASE("mock edge: channel batches queued messages into one write", "[mock]") {
+    batch_test t = {};
+    memset(t.payload, 'x', sizeof(t.payload));
+
+    mock_harness_init(t.h, &t, 1);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<batch_test>(ztx);
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial(t->conn, ECHO_SERVICE, batch_connected, batch_data);
+    };
+    mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+
+    CHECK_FALSE(t.h.timed_out);
+    CHECK(t.err == 0);
+    CHECK(t.received == BATCH_WRITES * BATCH_WRITE_LEN);
+    CHECK(t.after.data_msgs - t.before.data_msgs == BATCH_WRITES);
+    CHECK(t.after.writes - t.before.writes < BATCH_WRITES / 4);
+}
+
+#define FAIRNESS_WRITES 1000
+#define FAIRNESS_WRITE_LEN 1024
+
+struct fairness_test {
+    mock_harness h;
+    uint8_t payload[FAIRNESS_WRITE_LEN];
+    ziti_connection big;
+    ziti_connection small;
+    int connected;
+    size_t big_received;
+    size_t big_at_small; // echoed to the big connection by the time the small one got its reply
+    bool small_done;
+    int err;
+};
+
+static void fairness_finish(fairness_test *t, int err) {
+    if (t->h.finishing) {
+        return;
+    }
+    t->err = err;
+    mock_harness_finish(&t->h);
+}
+
+static ssize_t fairness_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (fairness_test *) ziti_conn_data(conn);
+    if (len < 0) {
+        fairness_finish(t, (int) len);
+        return 0;
+    }
+    if (conn == t->big) {
+        t->big_received += len;
+    } else if (!t->small_done) {
+        t->small_done = true;
+        t->big_at_small = t->big_received;
+    }
+    if (t->small_done && t->big_received == FAIRNESS_WRITES * FAIRNESS_WRITE_LEN) {
+        fairness_finish(t, 0);
+    }
+    return len;
+}
+
+static void fairness_connected(ziti_connection conn, int status) {
+    auto t = (fairness_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        fairness_finish(t, status);
+        return;
+    }
+    if (++t->connected < 2) {
+        return;
+    }
+
+    for (int i = 0; i < FAIRNESS_WRITES; i++) {
+        ziti_write(t->big, t->payload, sizeof(t->payload), nullptr, nullptr);
+    }
+    ziti_write(t->small, t->payload, 16, nullptr, nullptr);
+}
+
+// a connection with a deep write queue does not hold back the others sharing the flusher
+TEST_CASE("mock edge: busy connection does not starve others", "[mock]") {
+    fairness_test t = {};
+    memset(t.payload, 'f', sizeof(t.payload));
+
+    mock_harness_init(t.h, &t, 1);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<fairness_test>(ztx);
+        ziti_conn_init(ztx, &t->big, t);
+        ziti_conn_init(ztx, &t->small, t);
+        ziti_dial(t->big, ECHO_SERVICE, fairness_connected, fairness_data);
+        ziti_dial(t->small, ECHO_SERVICE, fairness_connected, fairness_data);
+    };
+    mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+
+    CHECK_FALSE(t.h.timed_out);
+    CHECK(t.err == 0);
+    CHECK(t.small_done);
+    CHECK(t.big_received == FAIRNESS_WRITES * FAIRNESS_WRITE_LEN);
+    CHECK(t.big_at_small < FAIRNESS_WRITES * FAIRNESS_WRITE_LEN / 2);
+}
+
+#define PULL_PAYLOAD (16 * 1024)
+#define PULL_READ_LEN 1000
+
+struct pull_test {
+    mock_harness h;
+    uv_timer_t resume;
+    std::vector<uint8_t> payload;
+    std::vector<uint8_t> received;
+    ziti_connection conn;
+    int notifications;
+    int paused_notifications;
+    bool paused;
+    size_t pushed; // bytes passed to data callback
+    bool eof;
+    int err;
+};
+
+static void pull_finish(pull_test *t, int err) {
+    if (t->h.finishing) {
+        return;
+    }
+    t->err = err;
+    uv_close((uv_handle_t *) &t->resume, nullptr);
+    mock_harness_finish(&t->h);
+}
+
+static ssize_t pull_data(ziti_connection conn, const uint8_t *data, ssize_t len) {
+    auto t = (pull_test *) ziti_conn_data(conn);
+    if (len == ZITI_EOF) {
+        t->eof = true;
+        pull_finish(t, 0);
+    } else if (len < 0) {
+        pull_finish(t, (int) len);
+    } else {
+        t->pushed += len;
+    }
+    return len < 0 ? 0 : len;
+}
+
+static void pull_readable(ziti_connection conn, size_t available) {
+    auto t = (pull_test *) ziti_conn_data(conn);
+    t->notifications++;
+    if (t->paused) {
+        t->paused_notifications++;
+    }
+
+    // leave the first batch buffered while reading is paused
+    if (t->notifications == 1) {
+        t->paused = true;
+        ziti_conn_pause_read(conn);
+        uv_timer_start(&t->resume, [](uv_timer_t *timer) {
+            auto t = (pull_test *) timer->data;
+            t->paused = false;
+            ziti_conn_resume_read(t->conn);
+        }, 100, 0);
+        return;
+    }
+
+    uint8_t buf[PULL_READ_LEN];
+    for (;;) {
+        ssize_t n = ziti_conn_read(conn, buf, sizeof(buf));
+        if (n > 0) {
+            t->received.insert(t->received.end(), buf, buf + n);
+        } else if (n == 0) {
+            break;
+        } else {
+            t->eof = n == ZITI_EOF;
+            pull_finish(t, t->eof ? 0 : (int) n);
+            break;
+        }
+    }
+}
+
+static void pull_connected(ziti_connection conn, int status) {
+    auto t = (pull_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        pull_finish(t, status);
+        return;
+    }
+
+    int rc = ziti_conn_set_readable_cb(conn, pull_readable);
+    if (rc != ZITI_OK) {
+        pull_finish(t, rc);
+        return;
+    }
+    ziti_write(conn, t->payload.data(), t->payload.size(), nullptr, nullptr);
+    ziti_close_write(conn);
+}
+
+// in pull mode data stays buffered until the application reads it
+TEST_CASE("mock edge: pull mode reads buffered data", "[mock]") {
+    pull_test t = {};
+    t.payload.resize(PULL_PAYLOAD);
+    for (size_t i = 0; i < t.payload.size(); i++) {
+        t.payload[i] = (uint8_t) (i % 251);
+    }
+
+    mock_harness_init(t.h, &t, 1);
+    uv_timer_init(t.h.loop, &t.resume);
+    t.resume.data = &t;
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<pull_test>(ztx);
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial(t->conn, ECHO_SERVICE, pull_connected, pull_data);
+    };
+    mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+
+    CHECK_FALSE(t.h.timed_out);
+    CHECK(t.err == 0);
+    CHECK(t.eof);
+    CHECK(t.pushed == 0);
+    CHECK(t.received == t.payload);
+    CHECK(t.notifications >= 2);
+    CHECK(t.paused_notifications == 0);
+}
+
+#define CLOSE_ORDER_WRITES 1000
+
+struct close_order_test {
+    mock_harness h;
+    uint8_t payload[1024];
+    ziti_connection conn;
+    bool closed;
+    int err;
+    mock_router_stats stats;
+};
+
+static void close_order_connected(ziti_connection conn, int status) {
+    auto t = (close_order_test *) ziti_conn_data(conn);
+    if (status != ZITI_OK) {
+        t->err = status;
+        mock_harness_finish(&t->h);
+        return;
+    }
+
+    for (int i = 0; i < CLOSE_ORDER_WRITES; i++) {
+        ziti_write(conn, t->payload, sizeof(t->payload), nullptr, nullptr);
+    }
+    ziti_close(conn, [](ziti_connection conn) {
+        auto t = (close_order_test *) ziti_conn_data(conn);
+        t->closed = true;
+        mock_edge_router_stats(t->h.mock, 0, &t->stats);
+        mock_harness_finish(&t->h);
+    });
+}
+
+// StateClosed is a control message, but it must not overtake data queued for its connection
+TEST_CASE("mock edge: close follows queued data", "[mock]") {
+    close_order_test t = {};
+    memset(t.payload, 'c', sizeof(t.payload));
+
+    mock_harness_init(t.h, &t, 1);
+    mock_edge_set_router_mode(t.h.mock, 0, MockRouterSink);
+    t.h.on_ready = [](mock_harness *h, ziti_context ztx) {
+        auto t = mock_test_state<close_order_test>(ztx);
+        ziti_conn_init(ztx, &t->conn, t);
+        ziti_dial(t->conn, ECHO_SERVICE, close_order_connected,
+                  [](ziti_connection, const uint8_t *, ssize_t len) -> ssize_t { return len < 0 ? 0 : len; });
+    };
+    mock_harness_add_context(t.h, {});
+    mock_harness_run(t.h);
+
+    CHECK_FALSE(t.h.timed_out);
+    CHECK(t.err == 0);
+    CHECK(t.closed);
+    CHECK(t.stats.closes == 1);
+    CHECK(t.stats.close_data_msgs == CLOSE_ORDER_WRITES);
+}
+
+static int env_int(const char *name, int def) {
+    const char *v = getenv(name);
+    return v ? atoi(v) : def;
+}
+
+// not run by default: MOCK_CONNS=20000 MOCK_MSGS=10 MOCK_MSG_SIZE=16384 all_tests "[load]"
+TEST_CASE("mock edge: concurrent connections load", "[.][load]") {
+    echo_load l = {};
+    l.stall_router = -1;
+    l.conns = env_int("MOCK_CONNS", 10000);
+    l.msgs = env_int("MOCK_MSGS", 10);
+    l.payload.assign(env_int("MOCK_MSG_SIZE", 4096), 'x');
+    l.timeout = env_int("MOCK_TIMEOUT_MS", 600000);
+
+    run_echo_load(l, env_int("MOCK_ROUTERS", 4));
+
+    CHECK(l.completed == l.conns);
+    CHECK(l.failed == 0);
+
+    double dial_secs = (double) (l.all_connected - l.start) / 1000.0;
+    double total_secs = (double) (l.done - l.start) / 1000.0;
+    double bytes = 2.0 * (double) l.conns * l.msgs * l.payload.size();
+    printf("connections: %d dial rate: %.0f/s throughput: %.1f MB/s (%.3fs)\n",
+           l.conns, dial_secs > 0 ? l.conns / dial_secs : 0.0,
+           total_secs > 0 ? bytes / total_secs / (1024 * 1024) : 0.0, total_secs);
+}
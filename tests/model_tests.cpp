@@ -241,6 +241,40 @@ TEST_CASE("parse array", "[model]") {
     free_Bar_array(&bars);
 }
 
+TEST_CASE("parse large array with arena", "[model]") {
+    // enough tokens to grow the arena several times
+    std::string json = "[";
+    for (int i = 0; i < 2000; i++) {
+        if (i > 0) json += ",";
+        json += R"({"num":)" + std::to_string(i) + R"(, "codes": [1, 2, 3], "msg": "m"})";
+    }
+    json += "]";
+
+    auto arena = model_tok_arena_new(16);
+    for (int round = 0; round < 2; round++) {
+        Bar_array bars = nullptr;
+        int rc = model_parse_array_with_toks((void ***) &bars, json.c_str(), json.size(), get_Bar_meta(), arena);
+        CHECK(rc == json.size());
+        CHECK(bars[0]->num == 0);
+        CHECK(bars[1999]->num == 1999);
+        CHECK(*bars[1999]->codes[2] == 3);
+        CHECK(bars[2000] == nullptr);
+        free_Bar_array(&bars);
+    }
+
+    Bar bar;
+    CHECK(model_parse_with_toks(&bar, BAR1, strlen(BAR1), get_Bar_meta(), arena) == strlen(BAR1));
+    CHECK(bar.num == 42);
+    free_Bar(&bar);
+    model_tok_arena_free(arena);
+
+    // default per-thread arena
+    Bar_array bars = nullptr;
+    CHECK(parse_Bar_array(&bars, json.c_str(), json.size()) == json.size());
+    CHECK(bars[1000]->num == 1000);
+    free_Bar_array(&bars);
+}
+
 TEST_CASE("parse bad array", "[model]") {
     const char *json = R"([{
         "msg":"\thello\n\"world\"!"
@@ -804,3 +838,62 @@ TEST_CASE("parse duration", "[model]") {
         // check it matches the pre-calculated data
     REQUIRE(d.timeout == expected_output);
 }
+
+TEST_CASE("parse into memory arena", "[model]") {
+    const char *json = "[" BAR1 "," BAR1 "]";
+
+    auto arena = model_arena_new(256);
+    Bar_array bars = nullptr;
+    int rc = model_parse_array_arena((void ***) &bars, json, strlen(json), get_Bar_meta(), arena);
+    CHECK(rc == strlen(json));
+    REQUIRE(bars != nullptr);
+    CHECK(bars[1]->num == 42);
+    CHECK_THAT(bars[1]->msg, Equals("this is a message"));
+    CHECK(bars[1]->ts->tv_usec == 666666);
+    CHECK_THAT(bars[0]->errors[1], Equals("error2"));
+    CHECK(*bars[0]->codes[1] == 403);
+    CHECK(model_list_size(&bars[0]->shoes) == 3);
+    CHECK(bars[2] == nullptr);
+
+    const char *tags_json = R"({"tags": {"key1": "val1", "key2": "val2"}})";
+    tagged t;
+    CHECK(model_parse_arena(&t, tags_json, strlen(tags_json), get_tagged_meta(), arena) == strlen(tags_json));
+    CHECK_THAT((const char *) model_map_get(&t.tags, "key2"), Equals("val2"));
+
+    // partial results are released with the arena
+    const char *bad = R"([{"msg": "first"}, {"msg": 56}])";
+    Bar_array bad_bars = nullptr;
+    CHECK(model_parse_array_arena((void ***) &bad_bars, bad, strlen(bad), get_Bar_meta(), arena) < 0);
+    CHECK(bad_bars == nullptr);
+
+    model_arena_free(arena);
+}
+
+TEST_CASE("model to caller supplied buffer", "[model]") {
+    Bar bar;
+    REQUIRE(parse_Bar(&bar, BAR1, strlen(BAR1)) == strlen(BAR1));
+
+    size_t len;
+    char *json = Bar_to_json(&bar, MODEL_JSON_COMPACT, &len);
+    REQUIRE(json != nullptr);
+    CHECK(strlen(json) == len);
+
+    auto buf = new_string_buf();
+    CHECK(string_buf_append(buf, "[") == 0);
+    CHECK(model_to_json_buf(&bar, get_Bar_meta(), MODEL_JSON_COMPACT, buf) == 0);
+    CHECK(string_buf_append(buf, "]") == 0);
+    size_t buf_len;
+    char *out = string_buf_to_string(buf, &buf_len);
+    CHECK(buf_len == len + 2);
+    CHECK(std::string(out) == "[" + std::string(json) + "]");
+
+    // size hint from previous output
+    char *json2 = Bar_to_json(&bar, MODEL_JSON_COMPACT, &len);
+    CHECK_THAT(json2, Equals(json));
+
+    free(json);
+    free(json2);
+    free(out);
+    delete_string_buf(buf);
+    free_Bar(&bar);
+}
@@ -16,7 +16,10 @@ limitations under the License.
 
 #include "catch2_includes.hpp"
 #include <pool.h>
+#include <mpsc.h>
 #include <cstring>
+#include <vector>
+#include <uv.h>
 
 struct foo {
     uint32_t num;
@@ -84,3 +87,206 @@ TEST_CASE("return after destroy", "[util]") {
     pool_return_obj(f1);
     pool_return_obj(f2);
 }
+
+TEST_CASE("slab pool", "[util]") {
+    pool_t *pool = pool_new_slab(sizeof(foo) + 64, 5, 2, sizeof(foo), false, clear_foo);
+
+    CHECK(pool_reserve(pool, 3) == 3);
+
+    auto f1 = (foo *) pool_alloc_obj(pool);
+    auto f2 = (foo *) pool_alloc_obj(pool);
+    // objects in a slab are contiguous
+    CHECK(pool_obj_size(f1) == sizeof(foo) + 64);
+    CHECK((char *) f2 > (char *) f1);
+
+    f1->num = 42;
+    f1->str = strdup("clear me");
+    auto tail = (char *) (f1 + 1);
+    strcpy(tail, "not cleared");
+    pool_return_obj(f1);
+
+    // most recently returned object is reused, only its header is cleared
+    auto f3 = (foo *) pool_alloc_obj(pool);
+    CHECK(f3 == f1);
+    CHECK(f3->num == 0);
+    CHECK(f3->str == nullptr);
+    CHECK(strcmp((char *) (f3 + 1), "not cleared") == 0);
+
+    std::vector<foo *> all{f2, f3};
+    foo *f;
+    while ((f = (foo *) pool_alloc_obj(pool)) != nullptr) {
+        all.push_back(f);
+    }
+    CHECK(all.size() == 5);
+    size_t out, max_out;
+    pool_usage(pool, &out, &max_out);
+    CHECK(out == 5);
+    CHECK(max_out == 5);
+
+    pool_destroy(pool);
+    for (auto o: all) {
+        pool_return_obj(o);
+    }
+}
+
+TEST_CASE("concurrent pool", "[util]") {
+    mt_pool_t *pool = mt_pool_new(sizeof(foo), 128);
+
+    auto f1 = (foo *) mt_pool_alloc(pool);
+    f1->num = 42;
+    mt_pool_free(f1);
+    auto f2 = (foo *) mt_pool_alloc(pool);
+    CHECK(f2 == f1);
+    CHECK(f2->num == 0);
+    mt_pool_free(f2);
+
+    // producers allocate, main thread frees
+    struct producer {
+        mt_pool_t *pool;
+        std::vector<foo *> objs;
+    };
+    const int count = 10000;
+    std::vector<producer> producers(4, producer{pool, {}});
+    std::vector<uv_thread_t> threads(producers.size());
+    for (size_t i = 0; i < producers.size(); i++) {
+        uv_thread_create(&threads[i], [](void *arg) {
+            auto p = (producer *) arg;
+            for (int j = 0; j < count; j++) {
+                auto f = (foo *) mt_pool_alloc(p->pool);
+                f->num = j;
+                p->objs.push_back(f);
+                if (j % 3 == 0) {
+                    mt_pool_free(p->objs.back());
+                    p->objs.pop_back();
+                }
+            }
+        }, &producers[i]);
+    }
+
+    for (auto &t: threads) {
+        uv_thread_join(&t);
+    }
+
+    size_t total = 0;
+    for (auto &p: producers) {
+        total += p.objs.size();
+        for (auto o: p.objs) {
+            mt_pool_free(o);
+        }
+    }
+    CHECK(total == producers.size() * (count - (count + 2) / 3));
+
+    // freed objects went back into the depot and are reused
+    uint64_t hits, misses, hits2, misses2;
+    mt_pool_stats(pool, &hits, &misses);
+    std::vector<foo *> again;
+    for (int i = 0; i < 64; i++) {
+        again.push_back((foo *) mt_pool_alloc(pool));
+    }
+    mt_pool_stats(pool, &hits2, &misses2);
+    CHECK(hits2 - hits == 64);
+    CHECK(misses2 == misses);
+    for (auto o: again) {
+        mt_pool_free(o);
+    }
+
+    mt_pool_destroy(pool);
+}
+
+TEST_CASE("concurrent pool releases cache of exited thread", "[util]") {
+    mt_pool_t *pool = mt_pool_new(sizeof(foo), 128);
+
+    uv_thread_t t;
+    uv_thread_create(&t, [](void *arg) {
+        auto pool = (mt_pool_t *) arg;
+        std::vector<foo *> objs;
+        for (int i = 0; i < 64; i++) {
+            objs.push_back((foo *) mt_pool_alloc(pool));
+        }
+        for (auto o: objs) {
+            mt_pool_free(o);
+        }
+    }, pool);
+    uv_thread_join(&t);
+
+    // stats of exited thread are kept
+    uint64_t hits, misses;
+    mt_pool_stats(pool, &hits, &misses);
+    CHECK(hits == 0);
+    CHECK(misses == 64);
+
+    // objects cached by exited thread are available to others
+    std::vector<foo *> objs;
+    for (int i = 0; i < 64; i++) {
+        objs.push_back((foo *) mt_pool_alloc(pool));
+    }
+    mt_pool_stats(pool, &hits, &misses);
+    CHECK(hits == 64);
+    CHECK(misses == 64);
+    for (auto o: objs) {
+        mt_pool_free(o);
+    }
+
+    mt_pool_destroy(pool);
+}
+
+TEST_CASE("mpsc queue", "[util]") {
+    struct item {
+        mpsc_node_t node;
+        int producer;
+        int seq;
+    };
+
+    mpsc_queue_t q;
+    mpsc_init(&q);
+    CHECK(mpsc_pop(&q) == nullptr);
+
+    item one{{}, 0, 1}, two{{}, 0, 2};
+    mpsc_push(&q, &one.node);
+    mpsc_push(&q, &two.node);
+    CHECK(mpsc_pop(&q) == &one.node);
+    CHECK(mpsc_pop(&q) == &two.node);
+    CHECK(mpsc_pop(&q) == nullptr);
+
+    // producers push concurrently, consumer pops while they run
+    struct producer {
+        mpsc_queue_t *q;
+        int id;
+        std::vector<item> items;
+    };
+    const int count = 10000;
+    std::vector<producer> producers(4);
+    std::vector<uv_thread_t> threads(producers.size());
+    for (size_t i = 0; i < producers.size(); i++) {
+        producers[i].q = &q;
+        producers[i].id = (int) i;
+        producers[i].items.resize(count);
+        uv_thread_create(&threads[i], [](void *arg) {
+            auto p = (producer *) arg;
+            for (int j = 0; j < count; j++) {
+                p->items[j].producer = p->id;
+                p->items[j].seq = j;
+                mpsc_push(p->q, &p->items[j].node);
+            }
+        }, &producers[i]);
+    }
+
+    std::vector<int> next(producers.size(), 0);
+    size_t total = 0;
+    bool ordered = true;
+    while (total < producers.size() * count) {
+        mpsc_node_t *n = mpsc_pop(&q);
+        if (n == nullptr) continue;
+
+        auto it = (item *) n;
+        ordered = ordered && it->seq == next[it->producer];
+        next[it->producer] = it->seq + 1;
+        total++;
+    }
+
+    for (auto &t: threads) {
+        uv_thread_join(&t);
+    }
+    CHECK(ordered);
+    CHECK(mpsc_pop(&q) == nullptr);
+}
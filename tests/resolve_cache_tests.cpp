@@ -0,0 +1,116 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "catch2/catch_test_macros.hpp"
+#include "resolve_cache.h"
+
+#include <atomic>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+static char SVC_BUF[RESOLVE_CACHE_STR_WORDS * sizeof(uint64_t)];
+
+TEST_CASE("resolve cache lookups", "[util]") {
+    auto cache = std::unique_ptr<resolve_cache>(new resolve_cache);
+    resolve_cache_init(cache.get());
+
+    void *ztx = nullptr;
+    uint32_t addr = 0;
+    int dummy;
+
+    CHECK_FALSE(resolve_cache_get(cache.get(), 1, "foo.ziti", 80, &ztx, SVC_BUF, &addr));
+
+    resolve_cache_put(cache.get(), resolve_cache_gen(cache.get()), 1, "foo.ziti", 80, &dummy, "foo-service", 0x01020304);
+    REQUIRE(resolve_cache_get(cache.get(), 1, "foo.ziti", 80, &ztx, SVC_BUF, &addr));
+    CHECK(ztx == &dummy);
+    CHECK(addr == 0x01020304);
+    CHECK(std::string(SVC_BUF) == "foo-service");
+
+    // key is type, host, and port
+    CHECK_FALSE(resolve_cache_get(cache.get(), 2, "foo.ziti", 80, &ztx, SVC_BUF, &addr));
+    CHECK_FALSE(resolve_cache_get(cache.get(), 1, "foo.ziti", 443, &ztx, SVC_BUF, &addr));
+    CHECK_FALSE(resolve_cache_get(cache.get(), 1, "foo.ziti.", 80, &ztx, SVC_BUF, &addr));
+
+    SECTION("invalidate") {
+        uint64_t stale = resolve_cache_gen(cache.get());
+        resolve_cache_invalidate(cache.get());
+        CHECK_FALSE(resolve_cache_get(cache.get(), 1, "foo.ziti", 80, &ztx, SVC_BUF, &addr));
+
+        // result computed before invalidation is not used
+        resolve_cache_put(cache.get(), stale, 1, "foo.ziti", 80, &dummy, "foo-service", 0);
+        CHECK_FALSE(resolve_cache_get(cache.get(), 1, "foo.ziti", 80, &ztx, SVC_BUF, &addr));
+    }
+
+    SECTION("long names are not cached") {
+        std::string long_host(200, 'a');
+        resolve_cache_put(cache.get(), resolve_cache_gen(cache.get()), 1, long_host.c_str(), 80, &dummy, "svc", 0);
+        CHECK_FALSE(resolve_cache_get(cache.get(), 1, long_host.c_str(), 80, &ztx, SVC_BUF, &addr));
+
+        std::string long_svc(200, 's');
+        resolve_cache_put(cache.get(), resolve_cache_gen(cache.get()), 1, "bar.ziti", 80, &dummy, long_svc.c_str(), 0);
+        CHECK_FALSE(resolve_cache_get(cache.get(), 1, "bar.ziti", 80, &ztx, SVC_BUF, &addr));
+    }
+}
+
+TEST_CASE("resolve cache concurrent access", "[util]") {
+    auto cache = std::unique_ptr<resolve_cache>(new resolve_cache);
+    resolve_cache_init(cache.get());
+
+    const int hosts = 2000;
+    std::atomic<bool> done{false};
+    std::atomic<long> torn{0};
+    std::atomic<long> hits{0};
+
+    // every entry carries its host as the service name, any other value would mean a torn read
+    auto writer = [&](int seed) {
+        for (int n = 0; n < 200000; n++) {
+            int h = (n * 7 + seed) % hosts;
+            std::string host = "host" + std::to_string(h) + ".ziti";
+            resolve_cache_put(cache.get(), resolve_cache_gen(cache.get()), 1, host.c_str(), 80,
+                              (void *) (uintptr_t) (h + 1), host.c_str(), (uint32_t) h);
+            if (n % 50000 == 0) resolve_cache_invalidate(cache.get());
+        }
+    };
+
+    auto reader = [&]() {
+        char svc[RESOLVE_CACHE_STR_WORDS * sizeof(uint64_t)];
+        int n = 0;
+        while (!done) {
+            int h = n++ % hosts;
+            std::string host = "host" + std::to_string(h) + ".ziti";
+            void *ztx;
+            uint32_t addr;
+            if (resolve_cache_get(cache.get(), 1, host.c_str(), 80, &ztx, svc, &addr)) {
+                hits++;
+                if (host != svc || ztx != (void *) (uintptr_t) (h + 1) || addr != (uint32_t) h) {
+                    torn++;
+                }
+            }
+        }
+    };
+
+    std::vector<std::thread> readers;
+    for (int i = 0; i < 3; i++) readers.emplace_back(reader);
+    std::thread w1(writer, 1), w2(writer, 2);
+    w1.join();
+    w2.join();
+    done = true;
+    for (auto &t: readers) t.join();
+
+    CHECK(torn == 0);
+    CHECK(hits > 0);
+}
@@ -0,0 +1,124 @@
+// Copyright (c) 2023.  NetFoundry Inc.
+//
+// Licensed under the Apache License, Version 2.0 (the "License");
+// you may not use this file except in compliance with the License.
+// You may obtain a copy of the License at
+//
+// https://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#if !_WIN32
+#include "catch2_includes.hpp"
+#include <stream_io.h>
+
+#include <cstring>
+#include <poll.h>
+#include <uv.h>
+#include <vector>
+
+static bool fd_readable(int fd) {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    return poll(&pfd, 1, 0) == 1;
+}
+
+TEST_CASE("stream ring wrap-around", "[stream]") {
+    auto r = stream_ring_new(16);
+    uint8_t data[12], out[12];
+    for (int i = 0; i < 12; i++) data[i] = (uint8_t) i;
+
+    CHECK(stream_ring_write(r, data, 12) == 12);
+    CHECK(stream_ring_read(r, out, 8) == 8);
+
+    // second write wraps
+    CHECK(stream_ring_write(r, data, 12) == 12);
+    CHECK(stream_ring_write(r, data, 12) == 0);
+
+    // data is handed out in contiguous regions
+    uint8_t *p;
+    CHECK(stream_ring_peek(r, 8, &p) == 8);
+    CHECK(memcmp(p, data + 8, 4) == 0);
+    CHECK(memcmp(p + 4, data, 4) == 0);
+    CHECK(stream_ring_peek(r, 16, &p) == 8);
+    CHECK(memcmp(p, data + 4, 8) == 0);
+    CHECK(stream_ring_peek(r, 24, &p) == 0);
+
+    stream_ring_release(r, 8);
+    CHECK(stream_ring_read(r, out, sizeof(out)) == 8);
+    CHECK(memcmp(out, data + 4, 8) == 0);
+    CHECK(stream_ring_read(r, out, sizeof(out)) == 0);
+
+    stream_ring_free(r);
+}
+
+TEST_CASE("stream ring concurrent producer and consumer", "[stream]") {
+    struct ring_test {
+        stream_ring *ring;
+        size_t total;
+    } t = {stream_ring_new(1024), 1024 * 1024};
+
+    // odd sized writes make regions wrap at different offsets
+    uv_thread_t producer;
+    uv_thread_create(&producer, [](void *arg) {
+        auto t = (ring_test *) arg;
+        uint8_t chunk[97];
+        size_t pos = 0;
+        while (pos < t->total) {
+            size_t len = std::min(sizeof(chunk), t->total - pos);
+            for (size_t i = 0; i < len; i++) chunk[i] = (uint8_t) ((pos + i) % 251);
+            size_t n = 0;
+            while (n < len) {
+                n += stream_ring_write(t->ring, chunk + n, len - n);
+            }
+            pos += len;
+        }
+    }, &t);
+
+    size_t pos = 0;
+    size_t errors = 0;
+    uint8_t buf[61];
+    while (pos < t.total) {
+        size_t n = stream_ring_read(t.ring, buf, sizeof(buf));
+        for (size_t i = 0; i < n; i++) {
+            if (buf[i] != (uint8_t) ((pos + i) % 251)) errors++;
+        }
+        pos += n;
+    }
+    uv_thread_join(&producer);
+
+    CHECK(errors == 0);
+    CHECK(pos == t.total);
+    stream_ring_free(t.ring);
+}
+
+TEST_CASE("stream bell non-blocking wait", "[stream]") {
+    auto b = stream_bell_new();
+    REQUIRE(b != nullptr);
+    int fd = stream_bell_fd(b);
+
+    unsigned int seq = stream_bell_seq(b);
+    CHECK_FALSE(stream_bell_wait(b, seq, false));
+    CHECK_FALSE(fd_readable(fd));
+
+    stream_bell_notify(b);
+    CHECK(fd_readable(fd));
+
+    // next non-blocking wait clears the descriptor, so poll() does not spin
+    seq = stream_bell_seq(b);
+    CHECK_FALSE(stream_bell_wait(b, seq, false));
+    CHECK_FALSE(fd_readable(fd));
+
+    // notification without armed waiter only bumps the sequence
+    stream_bell_notify(b);
+    stream_bell_notify(b);
+    CHECK(fd_readable(fd));
+    CHECK(stream_bell_wait(b, seq, false));
+    CHECK_FALSE(fd_readable(fd));
+
+    stream_bell_free(b);
+}
+#endif
@@ -17,6 +17,8 @@ limitations under the License.
 #include "catch2_includes.hpp"
 #include <metrics.h>
 #include <cstring>
+#include <thread>
+#include <vector>
 #include <ziti/enums.h>
 
 extern "C" {
@@ -51,3 +53,143 @@ TEST_CASE("init-metrics", "[metrics]") {
     metrics_rate_close(&m1);
     metrics_rate_close(&m1);
 }
+
+TEST_CASE("histogram percentiles", "[histogram]") {
+    histogram_t h;
+    metrics_hist_reset(&h);
+    CHECK(metrics_hist_percentile(&h, 50) == 0);
+
+    for (uint64_t v = 1; v <= 1000; v++) {
+        metrics_hist_record(&h, v);
+    }
+    CHECK(h.count == 1000);
+    CHECK(h.min == 1);
+    CHECK(h.max == 1000);
+    CHECK(metrics_hist_mean(&h) == 500.5);
+
+    // relative error is bounded by bucket width
+    uint64_t p50 = metrics_hist_percentile(&h, 50);
+    uint64_t p99 = metrics_hist_percentile(&h, 99);
+    CHECK(p50 >= 500);
+    CHECK(p50 <= 500 + 500 / HIST_SUB_BUCKETS);
+    CHECK(p99 >= 990);
+    CHECK(p99 <= 1000);
+    CHECK(metrics_hist_percentile(&h, 100) == 1000);
+    CHECK(metrics_hist_percentile(&h, 0) == 1);
+}
+
+TEST_CASE("histogram small values are exact", "[histogram]") {
+    histogram_t h;
+    metrics_hist_reset(&h);
+    for (uint64_t v = 0; v < HIST_SUB_BUCKETS; v++) {
+        metrics_hist_record(&h, v);
+    }
+    for (uint64_t v = 0; v < HIST_SUB_BUCKETS; v++) {
+        CHECK(metrics_hist_percentile(&h, 100.0 * (v + 1) / HIST_SUB_BUCKETS) == v);
+    }
+}
+
+TEST_CASE("histogram merge", "[histogram]") {
+    histogram_t a, b;
+    metrics_hist_reset(&a);
+    metrics_hist_reset(&b);
+
+    metrics_hist_record(&a, 10);
+    metrics_hist_record(&b, 5);
+    metrics_hist_record(&b, UINT64_MAX);
+
+    metrics_hist_merge(&a, &b);
+    CHECK(a.count == 3);
+    CHECK(a.min == 5);
+    CHECK(a.max == UINT64_MAX);
+    CHECK(metrics_hist_percentile(&a, 50) == 10);
+    CHECK(metrics_hist_percentile(&a, 100) == UINT64_MAX);
+}
+
+TEST_CASE("rate updates from multiple threads", "[rate]") {
+    rate_t r;
+    memset(&r, 0, sizeof(r));
+    metrics_rate_init(&r, INSTANT);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&r] {
+            for (int i = 0; i < 10000; i++) {
+                metrics_rate_update(&r, 1);
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    metrics_rate_update(&r, 10000);
+
+    // all shards are collected on tick, rate is per second over default 5s interval
+    tick_all();
+    CHECK(metrics_rate_get(&r) == 50000.0 / 5);
+
+    tick_all();
+    CHECK(metrics_rate_get(&r) == 0);
+
+    metrics_rate_close(&r);
+}
+
+TEST_CASE("loop rates are ticked by loop timer", "[rate]") {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    rate_t r;
+    memset(&r, 0, sizeof(r));
+    metrics_init(&loop, 1);
+    metrics_rate_init_loop(&loop, &r, INSTANT);
+    metrics_rate_update(&r, 1000);
+
+    uv_timer_t stop;
+    uv_timer_init(&loop, &stop);
+    uv_timer_start(&stop, [](uv_timer_t *t) { uv_close((uv_handle_t *) t, nullptr); }, 1100, 0);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    CHECK(metrics_rate_get(&r) == 1000.0);
+
+    // ticker is released with the last rate, loop can be closed
+    metrics_rate_close(&r);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    CHECK(uv_loop_close(&loop) == 0);
+}
+
+TEST_CASE("tick hook is called after rates are ticked", "[rate]") {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    struct hook_ctx {
+        rate_t r;
+        int calls;
+        double rate;
+    } ctx{};
+    metrics_init(&loop, 1);
+    metrics_rate_init_loop(&loop, &ctx.r, INSTANT);
+    metrics_rate_update(&ctx.r, 500);
+
+    metrics_tick_hook hook{};
+    hook.data = &ctx;
+    hook.cb = [](metrics_tick_hook *h) {
+        auto c = (hook_ctx *) h->data;
+        c->calls++;
+        c->rate = metrics_rate_get(&c->r);
+        metrics_tick_hook_remove(h);
+    };
+    metrics_tick_hook_add(&loop, &hook);
+
+    uv_timer_t stop;
+    uv_timer_init(&loop, &stop);
+    uv_timer_start(&stop, [](uv_timer_t *t) { uv_close((uv_handle_t *) t, nullptr); }, 2100, 0);
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    CHECK(ctx.calls == 1);
+    CHECK(ctx.rate == 500.0);
+    CHECK(hook.ticker == nullptr);
+
+    metrics_rate_close(&ctx.r);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    CHECK(uv_loop_close(&loop) == 0);
+}
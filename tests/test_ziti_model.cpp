@@ -33,6 +33,7 @@
 #endif
 
 #include "internal_model.h"
+#include "ziti/errors.h"
 
 using Catch::Matchers::Equals;
 
@@ -605,6 +606,166 @@ TEST_CASE("config change", "[model]") {
     free_ziti_service(&s2);
 }
 
+TEST_CASE("service content hash", "[model]") {
+    const char *j1 = R"({
+    "id": "svc-id", "name": "hello-svc", "updatedAt": "2020-05-12T02:56:36.860Z",
+    "config": {
+      "ziti-tunneler-client.v1": { "hostname": "hello.ziti", "port": 80 },
+      "intercept.v1": { "protocols": [ "tcp" ], "addresses": [ "hello.ziti" ] }
+    },
+    "posturePolicies": {
+      "p1": { "policyId": "p1", "isPassing": true, "postureQueries": [ { "id": "q1", "timeout": 10 } ] }
+    }
+  })";
+    // same content, different map order
+    const char *j2 = R"({
+    "id": "svc-id", "name": "hello-svc", "updatedAt": "2020-05-12T02:56:36.860Z",
+    "config": {
+      "intercept.v1": { "protocols": [ "tcp" ], "addresses": [ "hello.ziti" ] },
+      "ziti-tunneler-client.v1": { "hostname": "hello.ziti", "port": 80 }
+    },
+    "posturePolicies": {
+      "p1": { "policyId": "p1", "isPassing": true, "postureQueries": [ { "id": "q1", "timeout": 10 } ] }
+    }
+  })";
+    const char *j3 = R"({
+    "id": "svc-id", "name": "hello-svc", "updatedAt": "2020-05-12T02:56:36.860Z",
+    "config": {
+      "ziti-tunneler-client.v1": { "hostname": "hello.ziti", "port": 8080 },
+      "intercept.v1": { "protocols": [ "tcp" ], "addresses": [ "hello.ziti" ] }
+    },
+    "posturePolicies": {
+      "p1": { "policyId": "p1", "isPassing": true, "postureQueries": [ { "id": "q1", "timeout": 10 } ] }
+    }
+  })";
+    const char *j4 = R"({
+    "id": "svc-id", "name": "hello-svc", "updatedAt": "2020-05-12T02:56:36.860Z",
+    "config": {
+      "ziti-tunneler-client.v1": { "hostname": "hello.ziti", "port": 80 },
+      "intercept.v1": { "protocols": [ "tcp" ], "addresses": [ "hello.ziti" ] }
+    },
+    "posturePolicies": {
+      "p1": { "policyId": "p1", "isPassing": false, "postureQueries": [ { "id": "q1", "timeout": 10 } ] }
+    }
+  })";
+
+    ziti_service s1, s2, s3, s4;
+    REQUIRE(parse_ziti_service(&s1, j1, strlen(j1)) > 0);
+    REQUIRE(parse_ziti_service(&s2, j2, strlen(j2)) > 0);
+    REQUIRE(parse_ziti_service(&s3, j3, strlen(j3)) > 0);
+    REQUIRE(parse_ziti_service(&s4, j4, strlen(j4)) > 0);
+
+    uint64_t h1 = ziti_service_content_hash(&s1);
+    CHECK(h1 == ziti_service_content_hash(&s1));
+    CHECK(h1 == ziti_service_content_hash(&s2));
+    CHECK(h1 != ziti_service_content_hash(&s3));
+    CHECK(h1 != ziti_service_content_hash(&s4));
+
+    free_ziti_service(&s1);
+    free_ziti_service(&s2);
+    free_ziti_service(&s3);
+    free_ziti_service(&s4);
+}
+
+TEST_CASE("warm cache round trip", "[model]") {
+    const char *j = R"({
+    "controller": "https://ctrl.example.com:1280",
+    "apiSession": { "id": "as-id", "token": "as-token", "identity": { "id": "id-1", "name": "me" } },
+    "apiSessionExpires": "2030-01-01T00:00:00.000Z",
+    "services": [
+      { "id": "svc-id", "name": "hello-svc", "permissions": [ "Dial" ],
+        "config": { "intercept.v1": { "protocols": [ "tcp" ], "addresses": [ "hello.ziti" ] } } }
+    ],
+    "sessions": {
+      "svc-id": { "id": "sess-id", "token": "sess-token", "type": "Dial",
+                  "edgeRouters": [ { "name": "er1", "urls": { "tls": "tls://er1:3022" } } ] }
+    },
+    "edgeRouters": [ { "name": "er1", "hostname": "er1", "supportedProtocols": { "tls": "tls://er1:3022" } } ],
+    "routerRtt": { "er1": 42 }
+  })";
+
+    ziti_warm_cache c1 = {}, c2 = {};
+    REQUIRE(parse_ziti_warm_cache(&c1, j, strlen(j)) > 0);
+
+    size_t len;
+    char *json = ziti_warm_cache_to_json(&c1, MODEL_JSON_COMPACT, &len);
+    REQUIRE(json != nullptr);
+    REQUIRE(parse_ziti_warm_cache(&c2, json, len) > 0);
+    free(json);
+
+    CHECK(cmp_ziti_warm_cache(&c1, &c2) == 0);
+    CHECK_THAT(c2.api_session->token, Equals("as-token"));
+    CHECK(c2.api_session_expires->tv_sec == c1.api_session_expires->tv_sec);
+    REQUIRE(c2.services != nullptr);
+    CHECK_THAT(c2.services[0]->name, Equals("hello-svc"));
+    CHECK(c2.services[1] == nullptr);
+    auto ns = (ziti_net_session *) model_map_get(&c2.sessions, "svc-id");
+    REQUIRE(ns != nullptr);
+    CHECK_THAT(ns->token, Equals("sess-token"));
+    REQUIRE(c2.edge_routers != nullptr);
+    CHECK_THAT((const char *) model_map_get(&c2.edge_routers[0]->protocols, "tls"), Equals("tls://er1:3022"));
+    auto rtt = (int *) model_map_get(&c2.router_rtt, "er1");
+    REQUIRE(rtt != nullptr);
+    CHECK(*rtt == 42);
+
+    free_ziti_warm_cache(&c1);
+    free_ziti_warm_cache(&c2);
+}
+
+TEST_CASE("cached service config", "[model]") {
+    const char *j = R"({
+    "id": "c8c07cb8-5234-4106-92ea-fde5721095fd",
+    "name": "hello-svc",
+    "config": {
+      "ziti-tunneler-client.v1": {
+        "hostname": "hello.ziti",
+        "port": 80
+      },
+      "intercept.v1": {
+        "protocols": [ "tcp" ],
+        "addresses": [ "hello.ziti" ],
+        "portRanges": [ { "low": 80, "high": 80 } ]
+      },
+      "broken.v1": [ "not", "an", "object" ]
+    },
+    "permissions": [ "Dial" ]
+  })";
+
+    ziti_service s, s1;
+    REQUIRE(parse_ziti_service(&s, j, strlen(j)) > 0);
+    REQUIRE(parse_ziti_service(&s1, j, strlen(j)) > 0);
+
+    const void *cfg = nullptr;
+    REQUIRE(ziti_service_get_config_ref(&s, ZITI_INTERCEPT_CFG_V1, get_ziti_intercept_cfg_v1_meta(), &cfg) == ZITI_OK);
+    auto intercept = (const ziti_intercept_cfg_v1 *) cfg;
+    REQUIRE(intercept != nullptr);
+    auto addr = (const ziti_address *) model_list_head(&intercept->addresses);
+    CHECK_THAT(addr->addr.hostname, Equals("hello.ziti"));
+
+    // same object is returned on subsequent calls
+    const void *again = nullptr;
+    CHECK(ziti_service_get_config_ref(&s, ZITI_INTERCEPT_CFG_V1, get_ziti_intercept_cfg_v1_meta(), &again) == ZITI_OK);
+    CHECK(again == cfg);
+
+    const void *clt = nullptr;
+    CHECK(ziti_service_get_config_ref(&s, ZITI_CLIENT_CFG_V1, get_ziti_client_cfg_v1_meta(), &clt) == ZITI_OK);
+    CHECK(((const ziti_client_cfg_v1 *) clt)->port == 80);
+
+    CHECK(ziti_service_get_config_ref(&s, "missing.v1", get_ziti_client_cfg_v1_meta(), &cfg) == ZITI_CONFIG_NOT_FOUND);
+    CHECK(cfg == nullptr);
+    CHECK(ziti_service_get_config_ref(&s, "broken.v1", get_ziti_client_cfg_v1_meta(), &cfg) == ZITI_INVALID_CONFIG);
+    CHECK(cfg == nullptr);
+
+    // cache is internal: it is not part of service identity or JSON
+    CHECK(cmp_ziti_service(&s, &s1) == 0);
+    auto json = ziti_service_to_json(&s, MODEL_JSON_COMPACT, nullptr);
+    CHECK(strstr(json, "NULL") == nullptr);
+    free(json);
+
+    free_ziti_service(&s);
+    free_ziti_service(&s1);
+}
+
 TEST_CASE("parse-ctrl-version", "[model]") {
     const char *json = R"( {
         "apiVersions": {
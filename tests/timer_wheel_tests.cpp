@@ -0,0 +1,105 @@
+/*
+Copyright (c) 2023 NetFoundry, Inc.
+
+Licensed under the Apache License, Version 2.0 (the "License");
+you may not use this file except in compliance with the License.
+You may obtain a copy of the License at
+
+https://www.apache.org/licenses/LICENSE-2.0
+
+Unless required by applicable law or agreed to in writing, software
+distributed under the License is distributed on an "AS IS" BASIS,
+WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+See the License for the specific language governing permissions and
+limitations under the License.
+*/
+
+#include "catch2_includes.hpp"
+#include <timer_wheel.h>
+#include <vector>
+
+struct fired {
+    uv_loop_t *loop;
+    uint64_t armed_at;
+    std::vector<std::pair<int, uint64_t>> events;
+};
+
+struct test_timer {
+    wheel_timer_t t;
+    int id;
+    fired *f;
+};
+
+static void on_fire(wheel_timer_t *t) {
+    auto tt = (test_timer *) t->data;
+    tt->f->events.emplace_back(tt->id, uv_now(tt->f->loop) - tt->f->armed_at);
+}
+
+TEST_CASE("timer wheel expiry order", "[util]") {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    timer_wheel_t wheel;
+    timer_wheel_init(&wheel, &loop, 1);
+
+    fired f{&loop, uv_now(&loop)};
+    // spread over first two levels of the wheel
+    test_timer timers[] = {
+            {{}, 150, &f},
+            {{}, 5, &f},
+            {{}, 70, &f},
+            {{}, 30, &f},
+            {{}, 100, &f},
+    };
+    for (auto &tt: timers) {
+        wheel_timer_start(&wheel, &tt.t, tt.id, on_fire, &tt);
+    }
+    CHECK(wheel.active == 5);
+
+    // cancelled timer does not fire
+    wheel_timer_stop(&timers[4].t);
+    CHECK_FALSE(wheel_timer_is_active(&timers[4].t));
+    CHECK(wheel.active == 4);
+
+    uv_run(&loop, UV_RUN_DEFAULT);
+
+    REQUIRE(f.events.size() == 4);
+    int expected[] = {5, 30, 70, 150};
+    for (int i = 0; i < 4; i++) {
+        CHECK(f.events[i].first == expected[i]);
+        CHECK(f.events[i].second >= (uint64_t) expected[i]);
+    }
+    CHECK(wheel.active == 0);
+    CHECK_FALSE(uv_is_active((uv_handle_t *) wheel.timer));
+
+    timer_wheel_close(&wheel);
+    uv_run(&loop, UV_RUN_DEFAULT);
+    CHECK(uv_loop_close(&loop) == 0);
+}
+
+TEST_CASE("timer wheel re-arm", "[util]") {
+    uv_loop_t loop;
+    uv_loop_init(&loop);
+
+    timer_wheel_t wheel;
+    timer_wheel_init(&wheel, &loop, 1);
+
+    fired f{&loop, uv_now(&loop)};
+    test_timer tt{{}, 1, &f};
+    wheel_timer_start(&wheel, &tt.t, 200, on_fire, &tt);
+    // re-arming moves the timer
+    wheel_timer_start(&wheel, &tt.t, 20, on_fire, &tt);
+    CHECK(wheel.active == 1);
+
+    uv_run(&loop, UV_RUN_DEFAULT);
+    REQUIRE(f.events.size() == 1);
+    CHECK(f.events[0].second < 200);
+
+    // timers still armed on close are dropped
+    wheel_timer_start(&wheel, &tt.t, 1000, on_fire, &tt);
+    timer_wheel_close(&wheel);
+    CHECK_FALSE(wheel_timer_is_active(&tt.t));
+    uv_run(&loop, UV_RUN_DEFAULT);
+    CHECK(f.events.size() == 1);
+    CHECK(uv_loop_close(&loop) == 0);
+}
@@ -18,6 +18,12 @@
 #include "internal_model.h"
 #include "zt_internal.h"
 
+#include <atomic>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
 #if _WIN32
 #include <io.h>
 #define dup2(o,n) _dup2(o,n)
@@ -92,4 +98,283 @@ TEST_CASE("check hostname/domainname") {
 
     printf("hostname = %s\n", info->hostname);
     printf("domain = %s\n", info->domain);
-}
\ No newline at end of file
+}
+static std::atomic<int> async_logged;
+
+TEST_CASE("async logging", "[util]") {
+    async_logged = 0;
+    ziti_log_init(uv_default_loop(), INFO, [](int level, const char *loc, const char *msg, size_t len) {
+        if (len > 8 && strncmp(msg, "message ", 8) == 0) {
+            async_logged++;
+        }
+    });
+    REQUIRE(ziti_log_set_async(16) == 0);
+
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([] {
+            for (int i = 0; i < 1000; i++) {
+                ZITI_LOG(INFO, "message %d", i);
+            }
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+    uint64_t dropped = ziti_log_dropped();
+
+    // drains the ring
+    CHECK(ziti_log_set_async(0) == 0);
+    CHECK(async_logged + dropped == 4000);
+    CHECK(ziti_log_dropped() == 0);
+
+    ziti_log_set_logger(nullptr);
+}
+
+TEST_CASE("async logging reconfigured while logging", "[util]") {
+    async_logged = 0;
+    ziti_log_init(uv_default_loop(), INFO, [](int level, const char *loc, const char *msg, size_t len) {
+        if (len > 8 && strncmp(msg, "message ", 8) == 0) {
+            async_logged++;
+        }
+    });
+
+    std::atomic<bool> done{false};
+    std::vector<std::thread> threads;
+    for (int t = 0; t < 4; t++) {
+        threads.emplace_back([&done] {
+            for (int i = 0; !done; i++) {
+                ZITI_LOG(INFO, "message %d", i);
+            }
+        });
+    }
+
+    // rings are replaced and freed under producers
+    for (int i = 0; i < 50; i++) {
+        REQUIRE(ziti_log_set_async(i % 3 == 2 ? 0 : 8 << (i % 3)) == 0);
+        std::this_thread::yield();
+    }
+    done = true;
+    for (auto &t: threads) {
+        t.join();
+    }
+
+    CHECK(ziti_log_set_async(0) == 0);
+    CHECK(async_logged > 0);
+
+    ziti_log_set_logger(nullptr);
+}
+
+TEST_CASE("log level by subsystem", "[util]") {
+    ziti_log_set_level(DEBUG, "channel");
+    CHECK(ziti_log_level(nullptr, "library/channel.c") == DEBUG);
+    CHECK(ziti_log_level(nullptr, "library/connect.c") != DEBUG);
+
+    ziti_log_set_level(ZITI_LOG_DEFAULT_LEVEL, "channel");
+    CHECK(ziti_log_level(nullptr, "library/channel.c") == ziti_log_level(nullptr, "library/connect.c"));
+}
+
+TEST_CASE("log rate limit", "[util]") {
+    ziti_log_limit limit{};
+    unsigned int suppressed;
+
+    int logged = 0;
+    for (int i = 0; i < 100; i++) {
+        if (ziti_log_limit_check(&limit, 10, &suppressed)) {
+            logged++;
+            CHECK(suppressed == 0);
+        }
+    }
+    CHECK(logged == 10);
+    CHECK(limit.suppressed == 90);
+
+    // next window reports suppressed lines
+    limit.window_start -= 1000;
+    CHECK(ziti_log_limit_check(&limit, 10, &suppressed));
+    CHECK(suppressed == 90);
+    CHECK(limit.suppressed == 0);
+}
+
+TEST_CASE("key pair pool", "[util]") {
+    uv_loop_t *loop = uv_default_loop();
+
+    key_pool *pool = key_pool_new(loop);
+    REQUIRE(pool != nullptr);
+    uv_run(loop, UV_RUN_DEFAULT);
+    size_t full = key_pool_available(pool);
+    REQUIRE(full > 0);
+
+    std::vector<key_pair> keys(full + 1);
+    for (auto &kp: keys) {
+        REQUIRE(key_pool_get(pool, &kp) == 0);
+    }
+    CHECK(key_pool_available(pool) == 0);
+
+    // pool runs out, key pairs are still valid and unique
+    for (size_t i = 0; i < keys.size(); i++) {
+        uint8_t pk[crypto_kx_PUBLICKEYBYTES];
+        crypto_scalarmult_base(pk, keys[i].sk);
+        CHECK(memcmp(pk, keys[i].pk, sizeof(pk)) == 0);
+        if (i > 0) {
+            CHECK(memcmp(keys[i - 1].pk, keys[i].pk, sizeof(pk)) != 0);
+        }
+    }
+
+    SECTION("refilled") {
+        uv_run(loop, UV_RUN_DEFAULT);
+        CHECK(key_pool_available(pool) == full);
+        key_pool_free(pool);
+    }
+
+    SECTION("freed while refilling") {
+        key_pool_free(pool);
+        uv_run(loop, UV_RUN_DEFAULT);
+    }
+}
+
+TEST_CASE("string interning", "[util]") {
+    str_intern t = {};
+
+    std::string name = "my-service";
+    const char *s1 = str_intern_get(&t, name.c_str());
+    const char *s2 = str_intern_get(&t, "my-service");
+    const char *other = str_intern_get(&t, "other-service");
+
+    CHECK(s1 == s2);
+    CHECK(s1 != name.c_str());
+    CHECK(s1 != other);
+    CHECK(str_intern_size(&t) == 2);
+    CHECK(str_intern_refs(&t, "my-service") == 2);
+
+    str_intern_release(&t, s1);
+    CHECK(str_intern_refs(&t, "my-service") == 1);
+    CHECK(str_intern_get(&t, "my-service") == s2);
+    str_intern_release(&t, s2);
+    str_intern_release(&t, s2);
+    CHECK(str_intern_refs(&t, "my-service") == 0);
+    CHECK(str_intern_size(&t) == 1);
+
+    // not from this table
+    str_intern_release(&t, "other-service");
+    CHECK(str_intern_refs(&t, "other-service") == 1);
+
+    CHECK(str_intern_get(&t, nullptr) == nullptr);
+    str_intern_clear(&t);
+    CHECK(str_intern_size(&t) == 0);
+}
+
+TEST_CASE("channel health score", "[util]") {
+    ziti_channel_t ch;
+    memset(&ch, 0, sizeof(ch));
+    ch.loop = uv_default_loop();
+    ch.state = 2; // Connected
+    ch.rtt_min = 10;
+    ch.srtt = 12;
+
+    CHECK(ziti_channel_health(&ch) == 100);
+    CHECK_FALSE(ch.degraded);
+
+    // RTT far over the best one seen
+    ch.srtt = 200;
+    CHECK(ziti_channel_health(&ch) == 60);
+    CHECK_FALSE(ch.degraded);
+
+    // and unanswered requests
+    ch.health_errors = 1;
+    ch.health_errors_ts = uv_now(ch.loop);
+    CHECK(ziti_channel_health(&ch) == 50);
+    CHECK(ch.degraded);
+
+    // stays degraded until the score is well above the threshold
+    ch.srtt = 12;
+    ch.health_errors = 3;
+    CHECK(ziti_channel_health(&ch) == 70);
+    CHECK(ch.degraded);
+
+    ch.health_errors = 0;
+    ch.last_write_delay = 1500;
+    CHECK(ziti_channel_health(&ch) == 85);
+    CHECK_FALSE(ch.degraded);
+
+    // slow writes alone
+    ch.last_write_delay = 10000;
+    CHECK(ziti_channel_health(&ch) == 60);
+    ch.srtt = 100;
+    CHECK(ziti_channel_health(&ch) < 60);
+    CHECK(ch.degraded);
+}
+
+TEST_CASE("e2e stream cipher negotiation", "[util]") {
+    REQUIRE(sodium_init() >= 0);
+    uint8_t a_to_b[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+    uint8_t b_to_a[crypto_secretstream_xchacha20poly1305_KEYBYTES];
+    crypto_secretstream_xchacha20poly1305_keygen(a_to_b);
+    crypto_secretstream_xchacha20poly1305_keygen(b_to_a);
+
+    for (int i = 0; i < 4; i++) {
+        bool a_offer = i & 1;
+        bool b_offer = i & 2;
+        INFO("a offers AES: " << a_offer << ", b offers AES: " << b_offer);
+
+        e2e_stream a_out, a_in, b_out, b_in;
+        uint8_t hdr_a[E2E_HEADER_BYTES], hdr_b[E2E_HEADER_BYTES];
+        REQUIRE(e2e_init_push(&a_out, hdr_a, a_to_b, a_offer) == 0);
+        REQUIRE(e2e_init_push(&b_out, hdr_b, b_to_a, b_offer) == 0);
+        REQUIRE(e2e_init_pull(&b_in, hdr_a, a_to_b, b_offer) == 0);
+        REQUIRE(e2e_init_pull(&a_in, hdr_b, b_to_a, a_offer) == 0);
+
+        // control messages produce no plain text
+        uint8_t ctl[E2E_ABYTES];
+        uint8_t scratch[E2E_ABYTES];
+        size_t len = 1;
+        if (a_out.local_offer) {
+            e2e_push_offer(&a_out, ctl);
+            REQUIRE(e2e_pull(&b_in, scratch, &len, ctl, sizeof(ctl)) == 0);
+            CHECK(len == 0);
+        }
+        if (b_out.local_offer) {
+            e2e_push_offer(&b_out, ctl);
+            REQUIRE(e2e_pull(&a_in, scratch, &len, ctl, sizeof(ctl)) == 0);
+            CHECK(len == 0);
+        }
+        if (e2e_switch_ready(&a_out, &a_in)) {
+            REQUIRE(e2e_push_switch(&a_out, ctl) == 0);
+            REQUIRE(e2e_pull(&b_in, scratch, &len, ctl, sizeof(ctl)) == 0);
+        }
+        if (e2e_switch_ready(&b_out, &b_in)) {
+            REQUIRE(e2e_push_switch(&b_out, ctl) == 0);
+            REQUIRE(e2e_pull(&a_in, scratch, &len, ctl, sizeof(ctl)) == 0);
+        }
+
+        int method = a_offer && b_offer && e2e_aes_available() ? CryptoMethodAES256GCM : CryptoMethodLibsodium;
+        CHECK(a_out.method == method);
+        CHECK(a_in.method == method);
+        CHECK(b_out.method == method);
+        CHECK(b_in.method == method);
+
+        // in place, as on the data path
+        std::string text = "hello, world";
+        std::vector<uint8_t> msg(text.size() + E2E_ABYTES);
+        for (int round = 0; round < 3; round++) {
+            memcpy(msg.data() + 1, text.data(), text.size());
+            e2e_push(&a_out, msg.data(), msg.data() + 1, text.size());
+            REQUIRE(e2e_pull(&b_in, msg.data() + 1, &len, msg.data(), msg.size()) == 0);
+            CHECK(std::string((char *) msg.data() + 1, len) == text);
+
+            memcpy(msg.data() + 1, text.data(), text.size());
+            e2e_push(&b_out, msg.data(), msg.data() + 1, text.size());
+            REQUIRE(e2e_pull(&a_in, msg.data() + 1, &len, msg.data(), msg.size()) == 0);
+            CHECK(std::string((char *) msg.data() + 1, len) == text);
+        }
+
+        memcpy(msg.data() + 1, text.data(), text.size());
+        e2e_push(&a_out, msg.data(), msg.data() + 1, text.size());
+        msg[3] ^= 1;
+        CHECK(e2e_pull(&b_in, msg.data() + 1, &len, msg.data(), msg.size()) != 0);
+
+        e2e_stream_free(&a_out);
+        e2e_stream_free(&a_in);
+        e2e_stream_free(&b_out);
+        e2e_stream_free(&b_in);
+    }
+}
@@ -13,7 +13,9 @@
 // limitations under the License.
 
 #include "catch2_includes.hpp"
+#include "mock_edge.h"
 
+#include <cstring>
 #include <uv.h>
 #include <ziti/ziti.h>
 #include <ziti/ziti_src.h>
@@ -97,3 +99,106 @@ TEST_CASE("httpbin.ziti:ziti_src", "[integ]") {
     CHECK_THAT(test.body, Catch::Matchers::ContainsSubstring(R"("title": "Wake up to WonderWidgets!")"));
     CHECK(test.err == 0);
 }
+
+struct pooled_source_test {
+    uv_loop_t *loop;
+    mock_edge *mock;
+    ziti_context ztx;
+    ziti_src_pool *pool;
+    tlsuv_src_t src;
+    uv_timer_t timer;
+
+    bool started;
+    int connects;
+    int err;
+    ziti_src_pool_stats stats;
+    mock_router_stats router;
+};
+
+static void pooled_src_connect(pooled_source_test *t);
+
+static void pooled_src_finish(pooled_source_test *t) {
+    ziti_src_pool_get_stats(t->pool, &t->stats);
+    mock_edge_router_stats(t->mock, 0, &t->router);
+    ziti_src_pool_free(t->pool);
+    ziti_shutdown(t->ztx);
+    uv_timer_start(&t->timer, [](uv_timer_t *timer) {
+        auto t = (pooled_source_test *) timer->data;
+        mock_edge_free(t->mock);
+        uv_close((uv_handle_t *) timer, nullptr);
+    }, 500, 0);
+}
+
+static void pooled_src_closed(uv_link_t *l) {
+    auto t = (pooled_source_test *) l->data;
+    t->src.release(&t->src);
+    if (t->connects < 2) {
+        pooled_src_connect(t);
+    } else {
+        pooled_src_finish(t);
+    }
+}
+
+static void pooled_src_connect(pooled_source_test *t) {
+    ziti_src_init_pooled(t->loop, &t->src, "pooled-echo", t->pool);
+    int rc = t->src.connect(&t->src, "echo.ziti", "80", [](tlsuv_src_t *src, int status, void *ctx) {
+        auto t = (pooled_source_test *) ctx;
+        t->connects++;
+        if (status != 0) {
+            t->err = status;
+        }
+        // HTTP client done with the connection
+        src->link->data = t;
+        uv_link_close(src->link, pooled_src_closed);
+    }, t);
+    if (rc != 0) {
+        t->err = rc;
+        t->src.release(&t->src);
+        pooled_src_finish(t);
+    }
+}
+
+TEST_CASE("ziti_src: pooled source reuses idle connection", "[mock]") {
+    pooled_source_test t = {};
+    t.loop = uv_loop_new();
+    t.mock = mock_edge_new(t.loop);
+    mock_edge_add_router(t.mock, "src-router");
+    mock_edge_add_service(t.mock, "pooled-echo");
+
+    ziti_config cfg;
+    REQUIRE(mock_edge_config(t.mock, &cfg) == ZITI_OK);
+    REQUIRE(ziti_context_init(&t.ztx, &cfg) == ZITI_OK);
+    free_ziti_config(&cfg);
+    mock_edge_attach(t.mock, t.ztx);
+
+    ziti_options opts = {};
+    opts.app_ctx = &t;
+    opts.events = ZitiServiceEvent;
+    opts.event_cb = [](ziti_context ztx, const ziti_event_t *ev) {
+        auto t = (pooled_source_test *) ziti_app_ctx(ztx);
+        for (int i = 0; !t->started && ev->event.service.added && ev->event.service.added[i]; i++) {
+            if (strcmp(ev->event.service.added[i]->name, "pooled-echo") == 0) {
+                t->started = true;
+                pooled_src_connect(t);
+            }
+        }
+    };
+    REQUIRE(ziti_context_set_options(t.ztx, &opts) == ZITI_OK);
+
+    t.pool = ziti_src_pool_new(t.loop, t.ztx, nullptr);
+    uv_timer_init(t.loop, &t.timer);
+    t.timer.data = &t;
+    REQUIRE(ziti_context_run(t.ztx, t.loop) == ZITI_OK);
+
+    uv_run(t.loop, UV_RUN_DEFAULT);
+
+    uv_loop_delete(t.loop);
+
+    CHECK(t.err == 0);
+    CHECK(t.connects == 2);
+    CHECK(t.stats.misses == 1);
+    CHECK(t.stats.hits == 1);
+    CHECK(t.stats.returned == 2);
+    CHECK(t.stats.evicted == 1); // closed by ziti_src_pool_free
+    CHECK(t.router.connects == 1);
+}
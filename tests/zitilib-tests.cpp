@@ -15,6 +15,9 @@
 #include <catch2/catch_test_macros.hpp>
 #include <catch2/catch_session.hpp>
 
+#include <thread>
+#include <vector>
+
 #include <ziti/zitilib.h>
 #include "catch2/reporters/catch_reporters_all.hpp"
 #include "catch2/matchers/catch_matchers.hpp"
@@ -22,6 +25,8 @@
 
 #if _WIN32
 #else
+#include <fcntl.h>
+#include <poll.h>
 #include <unistd.h>
 #endif
 
@@ -32,7 +37,9 @@ public:
     using Catch::EventListenerBase::EventListenerBase;
 
     void testRunStarting(Catch::TestRunInfo const &) override {
-        Ziti_lib_init();
+        // several loops, so that service lookups go across them
+        const char *loops = getenv("ZITI_LIB_LOOPS");
+        Ziti_lib_init_loops(loops ? atoi(loops) : 3);
         const char *id = getenv("ZITI_TEST_IDENTITY");
         if (id) {
             _ztx = Ziti_load_context(id);
@@ -95,4 +102,47 @@ TEST_CASE("httpbin.ziti", "[zitilib]") {
 
     CHECK_THAT(resp, StartsWith("HTTP/1.1 200 OK"));
     CHECK_THAT(resp, ContainsSubstring(R"("title": "Sample Slide Show")"));
-}
\ No newline at end of file
+}
+
+TEST_CASE("concurrent lookups of unknown address", "[zitilib]") {
+    const int count = 8;
+    std::vector<int> results(count, 0);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < count; i++) {
+        threads.emplace_back([&results, i] {
+            ziti_socket_t sock = Ziti_socket(SOCK_STREAM);
+            results[i] = Ziti_connect_addr(sock, "no-such-service.ziti", 8000 + i);
+#if _WIN32
+            closesocket(sock);
+#else
+            close(sock);
+#endif
+        });
+    }
+    for (auto &t: threads) {
+        t.join();
+    }
+
+    for (int rc: results) {
+        CHECK(rc != 0);
+    }
+}
+
+#if !_WIN32
+TEST_CASE("non-blocking connect to unknown address", "[zitilib]") {
+    ziti_socket_t sock = Ziti_socket(SOCK_STREAM);
+    fcntl(sock, F_SETFL, fcntl(sock, F_GETFL) | O_NONBLOCK);
+
+    CHECK(Ziti_connect_addr(sock, "no-such-service.ziti", 80) == -1);
+    CHECK(Ziti_last_error() == EINPROGRESS);
+
+    // failed connect hangs up the socket, like a refused kernel connect()
+    struct pollfd pfd = {.fd = sock, .events = POLLIN | POLLOUT};
+    REQUIRE(poll(&pfd, 1, 5000) == 1);
+    CHECK((pfd.revents & (POLLHUP | POLLERR | POLLIN)) != 0);
+
+    CHECK(Ziti_check_socket(sock) == -1);
+    CHECK(Ziti_last_error() == ECONNREFUSED);
+    Ziti_close(sock);
+}
+#endif